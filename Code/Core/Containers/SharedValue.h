@@ -0,0 +1,153 @@
+// SharedValue
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Move.h"
+#include "Core/Env/Types.h"
+#include "Core/Mem/Mem.h"
+
+// SharedValue
+//  - A value which can be copied in O(1) by sharing it (reference counted)
+//  - Shared values are immutable; obtaining mutable access takes a private
+//    copy first if the value is shared (copy-on-write)
+//  - Reference counting is not atomic; copies must not be used concurrently
+//    from different threads
+//------------------------------------------------------------------------------
+template <class T>
+class SharedValue
+{
+public:
+    explicit SharedValue() = default;
+    explicit SharedValue( const T & value )
+        : m_Payload( FNEW( Payload( value ) ) )
+    {
+    }
+    explicit SharedValue( T && value )
+        : m_Payload( FNEW( Payload( Move( value ) ) ) )
+    {
+    }
+    explicit SharedValue( const SharedValue<T> & other )
+        : m_Payload( other.m_Payload )
+    {
+        AddRef();
+    }
+    explicit SharedValue( SharedValue<T> && other )
+        : m_Payload( other.m_Payload )
+    {
+        other.m_Payload = nullptr;
+    }
+    ~SharedValue() { Release(); }
+
+    SharedValue<T> & operator=( const SharedValue<T> & other )
+    {
+        // Reference new value before releasing old one, as other may be
+        // owned by the old value
+        Payload * payload = other.m_Payload;
+        if ( payload )
+        {
+            ++payload->m_RefCount;
+        }
+        Release();
+        m_Payload = payload;
+        return *this;
+    }
+    SharedValue<T> & operator=( SharedValue<T> && other )
+    {
+        if ( this != &other )
+        {
+            Release();
+            m_Payload = other.m_Payload;
+            other.m_Payload = nullptr;
+        }
+        return *this;
+    }
+
+    // read access (an empty value is returned if none was set)
+    [[nodiscard]] const T & Get() const
+    {
+        if ( m_Payload )
+        {
+            return m_Payload->m_Value;
+        }
+        static const T sEmpty;
+        return sEmpty;
+    }
+
+    // write access, detaching from other copies if needed
+    [[nodiscard]] T & GetMutable()
+    {
+        if ( m_Payload == nullptr )
+        {
+            m_Payload = FNEW( Payload() );
+        }
+        else if ( m_Payload->m_RefCount > 1 )
+        {
+            Payload * copy = FNEW( Payload( m_Payload->m_Value ) );
+            Release();
+            m_Payload = copy;
+        }
+        return m_Payload->m_Value;
+    }
+
+    // replace the value (the new value may refer to the old one)
+    void Set( const T & value )
+    {
+        Payload * newPayload = FNEW( Payload( value ) );
+        Release();
+        m_Payload = newPayload;
+    }
+    void Set( T && value )
+    {
+        Payload * newPayload = FNEW( Payload( Move( value ) ) );
+        Release();
+        m_Payload = newPayload;
+    }
+
+    void Clear()
+    {
+        Release();
+        m_Payload = nullptr;
+    }
+
+    [[nodiscard]] bool IsShared() const { return m_Payload && ( m_Payload->m_RefCount > 1 ); }
+    [[nodiscard]] uint32_t GetRefCount() const { return m_Payload ? m_Payload->m_RefCount : 0; }
+
+private:
+    class Payload
+    {
+    public:
+        explicit Payload() = default;
+        explicit Payload( const T & value )
+            : m_Value( value )
+        {
+        }
+        explicit Payload( T && value )
+            : m_Value( Move( value ) )
+        {
+        }
+
+        uint32_t m_RefCount = 1;
+        T m_Value;
+    };
+
+    void AddRef()
+    {
+        if ( m_Payload )
+        {
+            ++m_Payload->m_RefCount;
+        }
+    }
+    void Release()
+    {
+        if ( m_Payload && ( --m_Payload->m_RefCount == 0 ) )
+        {
+            FDELETE m_Payload;
+        }
+    }
+
+    Payload * m_Payload = nullptr;
+};
+
+//------------------------------------------------------------------------------
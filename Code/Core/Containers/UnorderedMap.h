@@ -15,6 +15,14 @@ namespace UnorderedMapKeyHashingFunctions
     {
         return xxHash3::Calc32( key );
     }
+    inline uint32_t Hash( int32_t key )
+    {
+        return xxHash3::Calc32( &key, sizeof( key ) );
+    }
+    inline uint32_t Hash( uint64_t key )
+    {
+        return xxHash3::Calc32( &key, sizeof( key ) );
+    }
 }
 
 // UnorderedMap
@@ -61,6 +69,9 @@ public:
     // Add items to the map
     KeyValue & Insert( const KEY & key, const VALUE & value );
 
+    // Remove an item from the map (returns false if not found)
+    bool Erase( const KEY & key );
+
 protected:
     inline static const uint32_t kTableSizePower = 16;
     inline static const uint32_t kTableSize = ( 1 << kTableSizePower );
@@ -180,4 +191,40 @@ typename UnorderedMap<KEY, VALUE>::KeyValue & UnorderedMap<KEY, VALUE>::Insert(
     return *newKeyValue;
 }
 
+// Erase
+//------------------------------------------------------------------------------
+template <class KEY, class VALUE>
+bool UnorderedMap<KEY, VALUE>::Erase( const KEY & key )
+{
+    // Handle empty
+    if ( m_Buckets == nullptr )
+    {
+        return false;
+    }
+
+    // Hash the key
+    const uint32_t hash = UnorderedMapKeyHashingFunctions::Hash( key );
+
+    // Find the bucket
+    const uint32_t bucketId = ( hash & kTableSizeMask );
+
+    // Unlink the item from the bucket
+    KeyValue ** link = &m_Buckets[ bucketId ];
+    while ( *link )
+    {
+        KeyValue * keyValue = *link;
+        if ( keyValue->m_Key == key )
+        {
+            *link = keyValue->m_Next;
+            FDELETE keyValue;
+            m_Count--;
+            return true;
+        }
+        link = &keyValue->m_Next;
+    }
+
+    // Not found
+    return false;
+}
+
 //------------------------------------------------------------------------------
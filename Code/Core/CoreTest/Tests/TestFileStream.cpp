@@ -96,6 +96,41 @@ TEST_CASE( TestFileStream, ReadOnly )
     TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
 }
 
+//------------------------------------------------------------------------------
+TEST_CASE( TestFileStream, ReadWriteAt )
+{
+    AStackString fileName;
+    GenerateTempFileName( fileName );
+
+    const AStackString dataA( "Some Data" );
+    const AStackString dataB( "More Data" );
+
+    FileStream f;
+    TEST_ASSERT( f.Open( fileName.Get(), FileStream::OPEN_OR_CREATE_READ_WRITE ) == true );
+
+    // Write out of order
+    TEST_ASSERT( f.WriteBufferAt( dataB.Get(), dataB.GetLength(), dataA.GetLength() ) == dataB.GetLength() );
+    TEST_ASSERT( f.WriteBufferAt( dataA.Get(), dataA.GetLength(), 0 ) == dataA.GetLength() );
+    TEST_ASSERT( f.GetFileSize() == ( dataA.GetLength() + dataB.GetLength() ) );
+
+    // Read back
+    AStackString buffer;
+    buffer.SetLength( dataB.GetLength() );
+    TEST_ASSERT( f.ReadBufferAt( buffer.Get(), dataB.GetLength(), dataA.GetLength() ) == dataB.GetLength() );
+    TEST_ASSERT( dataB == buffer );
+    buffer.SetLength( dataA.GetLength() );
+    TEST_ASSERT( f.ReadBufferAt( buffer.Get(), dataA.GetLength(), 0 ) == dataA.GetLength() );
+    TEST_ASSERT( dataA == buffer );
+
+    // Reading past the end returns what is available
+    TEST_ASSERT( f.ReadBufferAt( buffer.Get(), dataA.GetLength(), f.GetFileSize() ) == 0 );
+
+    f.Close();
+
+    // Clean up
+    TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
+}
+
 //------------------------------------------------------------------------------
 void TestFileStream::GenerateTempFileName( AString & outTempFileName ) const
 {
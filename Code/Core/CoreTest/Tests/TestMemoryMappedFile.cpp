@@ -0,0 +1,102 @@
+// TestMemoryMappedFile.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "TestFramework/TestGroup.h"
+
+// Core
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryMappedFile.h"
+#include "Core/Process/Process.h"
+#include "Core/Strings/AStackString.h"
+
+// system
+#include <string.h> // for memcmp
+
+//------------------------------------------------------------------------------
+TEST_GROUP( TestMemoryMappedFile, TestGroupTest )
+{
+public:
+    // Helpers
+    mutable uint32_t m_TempFileId = 0;
+    void GenerateTempFileName( AString & outTempFileName ) const;
+};
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestMemoryMappedFile, Map )
+{
+    AStackString fileName;
+    GenerateTempFileName( fileName );
+
+    const AStackString data( "Some Data To Store In A File" );
+
+    // Create a file and put some data in it
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( fileName.Get(), FileStream::WRITE_ONLY ) == true );
+        TEST_ASSERT( f.WriteBuffer( data.Get(), data.GetLength() ) == data.GetLength() );
+    }
+
+    // Map it
+    {
+        MemoryMappedFile mmf;
+        TEST_ASSERT( mmf.IsOpen() == false );
+        TEST_ASSERT( mmf.Open( fileName.Get() ) );
+        TEST_ASSERT( mmf.IsOpen() );
+
+        // Check contents
+        TEST_ASSERT( mmf.GetSize() == data.GetLength() );
+        TEST_ASSERT( memcmp( mmf.GetData(), data.Get(), data.GetLength() ) == 0 );
+
+        mmf.Close();
+        TEST_ASSERT( mmf.IsOpen() == false );
+        TEST_ASSERT( mmf.GetData() == nullptr );
+        TEST_ASSERT( mmf.GetSize() == 0 );
+    }
+
+    // Clean up
+    TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestMemoryMappedFile, MissingOrEmpty )
+{
+    AStackString fileName;
+    GenerateTempFileName( fileName );
+
+    // Missing file
+    {
+        MemoryMappedFile mmf;
+        TEST_ASSERT( mmf.Open( fileName.Get() ) == false );
+        TEST_ASSERT( mmf.IsOpen() == false );
+    }
+
+    // Empty file can't be mapped
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( fileName.Get(), FileStream::WRITE_ONLY ) == true );
+    }
+    {
+        MemoryMappedFile mmf;
+        TEST_ASSERT( mmf.Open( fileName.Get() ) == false );
+        TEST_ASSERT( mmf.IsOpen() == false );
+    }
+
+    // Clean up
+    TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
+}
+
+// GenerateTempFileName
+//------------------------------------------------------------------------------
+void TestMemoryMappedFile::GenerateTempFileName( AString & outTempFileName ) const
+{
+    // Get system temp folder
+    VERIFY( FileIO::GetTempDir( outTempFileName ) );
+
+    // add process unique identifier
+    outTempFileName.AppendFormat( "TestMemoryMappedFile.%u.%u", Process::GetCurrentId(), m_TempFileId++ );
+}
+
+//------------------------------------------------------------------------------
@@ -7,7 +7,9 @@
 
 // Core
 #include "Core/Containers/Array.h"
+#include "Core/Network/HTTPClient.h"
 #include "Core/Network/Network.h"
+#include "Core/Strings/AStackString.h"
 #include "Core/Strings/AString.h"
 
 //------------------------------------------------------------------------------
@@ -36,3 +38,26 @@ TEST_CASE( TestNetwork, GetIPv4Addresses )
 }
 
 //------------------------------------------------------------------------------
+TEST_CASE( TestNetwork, ParseURL )
+{
+    AStackString host;
+    uint16_t port;
+    AStackString path;
+
+    TEST_ASSERT( HTTPClient::ParseURL( AStackString( "http://server" ), host, port, path ) );
+    TEST_ASSERT( ( host == "server" ) && ( port == 80 ) && ( path == "/" ) );
+
+    TEST_ASSERT( HTTPClient::ParseURL( AStackString( "HTTP://server.domain:8080/cache/fastbuild" ), host, port, path ) );
+    TEST_ASSERT( ( host == "server.domain" ) && ( port == 8080 ) && ( path == "/cache/fastbuild" ) );
+
+    TEST_ASSERT( HTTPClient::ParseURL( AStackString( "http://127.0.0.1:1/" ), host, port, path ) );
+    TEST_ASSERT( ( host == "127.0.0.1" ) && ( port == 1 ) && ( path == "/" ) );
+
+    // Invalid
+    TEST_ASSERT( HTTPClient::ParseURL( AStackString( "https://server" ), host, port, path ) == false );
+    TEST_ASSERT( HTTPClient::ParseURL( AStackString( "http://" ), host, port, path ) == false );
+    TEST_ASSERT( HTTPClient::ParseURL( AStackString( "http://server:/" ), host, port, path ) == false );
+    TEST_ASSERT( HTTPClient::ParseURL( AStackString( "http://server:70000/" ), host, port, path ) == false );
+}
+
+//------------------------------------------------------------------------------
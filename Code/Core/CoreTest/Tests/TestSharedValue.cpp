@@ -0,0 +1,117 @@
+// TestSharedValue.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "TestFramework/TestGroup.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Containers/SharedValue.h"
+#include "Core/Strings/AString.h"
+
+//------------------------------------------------------------------------------
+TEST_GROUP( TestSharedValue, TestGroupTest )
+{
+public:
+};
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestSharedValue, Empty )
+{
+    SharedValue<AString> s;
+    TEST_ASSERT( s.Get().IsEmpty() );
+    TEST_ASSERT( s.GetRefCount() == 0 );
+    TEST_ASSERT( s.IsShared() == false );
+
+    // Copies of an empty value are also empty
+    SharedValue<AString> s2( s );
+    TEST_ASSERT( s2.Get().IsEmpty() );
+    TEST_ASSERT( s2.GetRefCount() == 0 );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestSharedValue, CopyShares )
+{
+    SharedValue<AString> s( AString( "str" ) );
+    TEST_ASSERT( s.GetRefCount() == 1 );
+
+    SharedValue<AString> s2( s );
+    TEST_ASSERT( s.IsShared() );
+    TEST_ASSERT( s2.GetRefCount() == 2 );
+    TEST_ASSERT( &s.Get() == &s2.Get() ); // Same storage
+
+    // Assignment shares too
+    SharedValue<AString> s3;
+    s3 = s2;
+    TEST_ASSERT( s.GetRefCount() == 3 );
+    TEST_ASSERT( s3.Get() == "str" );
+
+    // Self-assignment is harmless
+    const SharedValue<AString> & s3Ref = s3;
+    s3 = s3Ref;
+    TEST_ASSERT( s.GetRefCount() == 3 );
+
+    // Releasing a copy leaves the others intact
+    s2.Clear();
+    TEST_ASSERT( s.GetRefCount() == 2 );
+    TEST_ASSERT( s2.Get().IsEmpty() );
+    TEST_ASSERT( s.Get() == "str" );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestSharedValue, MoveTakesOwnership )
+{
+    SharedValue<AString> s( AString( "str" ) );
+    SharedValue<AString> s2( Move( s ) );
+    TEST_ASSERT( s.GetRefCount() == 0 );
+    TEST_ASSERT( s2.GetRefCount() == 1 );
+    TEST_ASSERT( s2.Get() == "str" );
+
+    SharedValue<AString> s3;
+    s3 = Move( s2 );
+    TEST_ASSERT( s2.GetRefCount() == 0 );
+    TEST_ASSERT( s3.Get() == "str" );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestSharedValue, WriteDetaches )
+{
+    SharedValue<Array<AString>> a;
+    a.GetMutable().Append( AString( "one" ) );
+    TEST_ASSERT( a.GetRefCount() == 1 );
+
+    // Unshared value is modified in place
+    const Array<AString> * storage = &a.Get();
+    a.GetMutable().Append( AString( "two" ) );
+    TEST_ASSERT( &a.Get() == storage );
+
+    // Shared value is copied before being modified
+    SharedValue<Array<AString>> b( a );
+    b.GetMutable().Append( AString( "three" ) );
+    TEST_ASSERT( a.IsShared() == false );
+    TEST_ASSERT( b.IsShared() == false );
+    TEST_ASSERT( a.Get().GetSize() == 2 );
+    TEST_ASSERT( b.Get().GetSize() == 3 );
+    TEST_ASSERT( b.Get()[ 0 ] == "one" );
+    TEST_ASSERT( b.Get()[ 2 ] == "three" );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestSharedValue, Set )
+{
+    SharedValue<AString> s( AString( "old" ) );
+    SharedValue<AString> s2( s );
+
+    // Replacing a shared value doesn't affect other copies
+    s.Set( AString( "new" ) );
+    TEST_ASSERT( s.Get() == "new" );
+    TEST_ASSERT( s2.Get() == "old" );
+    TEST_ASSERT( s2.GetRefCount() == 1 );
+
+    // Value may be set from itself
+    s.Set( s.Get() );
+    TEST_ASSERT( s.Get() == "new" );
+}
+
+//------------------------------------------------------------------------------
@@ -17,6 +17,9 @@
 #include "Core/Tracing/Tracing.h"
 
 #include <memory.h> // for memset
+#if defined( __LINUX__ )
+    #include <sys/resource.h>
+#endif
 
 // Defines
 //------------------------------------------------------------------------------
@@ -42,6 +45,27 @@ TEST_GROUP( TestTCPConnectionPool, TestGroupTest )
 {
 public:
     static uint32_t TestConnectionStuckDuringSend_ThreadFunc( void * userData );
+    static const ConnectionInfo * ConnectWithRetry( TCPConnectionPool & pool,
+                                                    uint16_t port,
+                                                    uint32_t index,
+                                                    void * userData = nullptr );
+
+    // Raises the open file limit for the duration of a test, if needed
+    class ConnectionLimit
+    {
+    public:
+        explicit ConnectionLimit( uint32_t desired );
+        ~ConnectionLimit();
+
+        uint32_t GetMaxConnections() const { return m_MaxConnections; }
+
+    private:
+        uint32_t m_MaxConnections;
+#if defined( __LINUX__ )
+        bool m_Restore = false;
+        struct rlimit m_OriginalLimit;
+#endif
+    };
 };
 
 // Helper Macros
@@ -318,3 +342,298 @@ TEST_CASE( TestTCPConnectionPool, ConnectionFailure )
 }
 
 //------------------------------------------------------------------------------
+TEST_CASE( TestTCPConnectionPool, ManyConnections )
+{
+    // a server which echoes all received data back
+    class EchoServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~EchoServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo * ci, void * data, uint32_t size, bool & ) override
+        {
+            TEST_ASSERT( Send( ci, data, size ) );
+        }
+    };
+
+    // clients which check the echoed data
+    class EchoClient : public TCPConnectionPool
+    {
+    public:
+        virtual ~EchoClient() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo * ci, void * data, uint32_t size, bool & ) override
+        {
+            const uint32_t index = static_cast<uint32_t>( reinterpret_cast<size_t>( ci->GetUserData() ) );
+            TEST_ASSERT( size == GetMessageSize( index ) );
+            TEST_ASSERT( memcmp( data, m_Data + ( index % 251 ), size ) == 0 );
+            m_NumReceived.Increment();
+        }
+        static uint32_t GetMessageSize( uint32_t index )
+        {
+            // mostly small messages, with some large enough to fill socket buffers
+            return ( ( index % 64 ) == 0 ) ? ( 1024 * 1024 ) : ( ( index * 37 ) % 4096 );
+        }
+        const char * m_Data = nullptr;
+        Atomic<uint32_t> m_NumReceived;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    const ConnectionLimit connectionLimit( 4000 );
+#else
+    const ConnectionLimit connectionLimit( 64 ); // thread per connection
+#endif
+    const uint32_t numConnections = connectionLimit.GetMaxConnections();
+    const uint32_t numMessagesPerConnection = 4;
+
+    // data to send, initialized to some known pattern
+    const size_t dataSize = ( 1024 * 1024 ) + 256;
+    UniquePtr<char, FreeDeletor> data( (char *)ALLOC( dataSize ) );
+    for ( size_t i = 0; i < dataSize; ++i )
+    {
+        data.Get()[ i ] = (char)( i * 7 );
+    }
+
+    EchoServer server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    EchoClient client;
+    client.m_Data = data.Get();
+
+    // connect many clients
+    const Timer timer;
+    Array<const ConnectionInfo *> connections;
+    connections.SetCapacity( numConnections );
+    for ( uint32_t i = 0; i < numConnections; ++i )
+    {
+        connections.Append( ConnectWithRetry( client, testPort, i, reinterpret_cast<void *>( static_cast<size_t>( i ) ) ) );
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == numConnections );
+    const float connectTime = timer.GetElapsed();
+
+    // send on all connections
+    for ( uint32_t j = 0; j < numMessagesPerConnection; ++j )
+    {
+        for ( uint32_t i = 0; i < numConnections; ++i )
+        {
+            TEST_ASSERT( client.Send( connections[ i ], data.Get() + ( i % 251 ), EchoClient::GetMessageSize( i ) ) );
+        }
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( client.m_NumReceived.Load() == ( numConnections * numMessagesPerConnection ) );
+    const float totalTime = timer.GetElapsed();
+
+    OUTPUT( "Connections    : %u\n", numConnections );
+    OUTPUT( "Connect time   : %2.3f s\n", (double)connectTime );
+    OUTPUT( "Echo time      : %2.3f s\n", (double)( totalTime - connectTime ) );
+
+    // disconnect all clients
+    client.ShutdownAllConnections();
+    TEST_ASSERT( client.GetNumConnections() == 0 );
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == 0 );
+    server.ShutdownAllConnections();
+}
+
+// ConnectWithRetry
+//------------------------------------------------------------------------------
+/*static*/ const ConnectionInfo * TestTCPConnectionPool::ConnectWithRetry( TCPConnectionPool & pool,
+                                                                          uint16_t port,
+                                                                          uint32_t index,
+                                                                          void * userData )
+{
+    // Allow each connection to be retried in case of local resource exhaustion
+    const Timer t;
+    const ConnectionInfo * ci;
+    while ( ( ci = pool.Connect( AStackString( "127.0.0.1" ), port, kDefaultConnectionTimeoutMS, userData ) ) == nullptr )
+    {
+        TEST_ASSERTM( t.GetElapsed() < 5.0f, "Failed to connect. (Connection %u)", index );
+        Thread::Sleep( 50 );
+    }
+    return ci;
+}
+
+// CONSTRUCTOR - ConnectionLimit
+//------------------------------------------------------------------------------
+TestTCPConnectionPool::ConnectionLimit::ConnectionLimit( uint32_t desired )
+    : m_MaxConnections( desired )
+{
+#if defined( __LINUX__ )
+    // Each loopback connection uses two file descriptors, so ensure enough are
+    // available, leaving some spare for anything else
+    const rlim_t spare = 256;
+    struct rlimit limit;
+    if ( getrlimit( RLIMIT_NOFILE, &limit ) != 0 )
+    {
+        m_MaxConnections = 64;
+        return;
+    }
+    const rlim_t needed = ( ( desired * 2 ) + spare );
+    if ( limit.rlim_cur < needed )
+    {
+        m_OriginalLimit = limit;
+        limit.rlim_cur = ( limit.rlim_max < needed ) ? limit.rlim_max : needed;
+        m_Restore = ( setrlimit( RLIMIT_NOFILE, &limit ) == 0 );
+        getrlimit( RLIMIT_NOFILE, &limit );
+    }
+    if ( limit.rlim_cur < needed )
+    {
+        m_MaxConnections = ( limit.rlim_cur > ( spare * 2 ) ) ? static_cast<uint32_t>( ( limit.rlim_cur - spare ) / 2 ) : 64;
+    }
+#endif
+}
+
+// DESTRUCTOR - ConnectionLimit
+//------------------------------------------------------------------------------
+TestTCPConnectionPool::ConnectionLimit::~ConnectionLimit()
+{
+#if defined( __LINUX__ )
+    if ( m_Restore )
+    {
+        setrlimit( RLIMIT_NOFILE, &m_OriginalLimit );
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestTCPConnectionPool, ManyPools )
+{
+    // a server which echoes all received data back
+    class EchoServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~EchoServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo * ci, void * data, uint32_t size, bool & ) override
+        {
+            TEST_ASSERT( Send( ci, data, size ) );
+        }
+    };
+
+    // a pool per connection, as the Client has a pool per worker
+    class EchoClient : public TCPConnectionPool
+    {
+    public:
+        virtual ~EchoClient() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo *, void * data, uint32_t size, bool & ) override
+        {
+            TEST_ASSERT( ( size == sizeof( uint32_t ) ) && ( *static_cast<uint32_t *>( data ) == m_Value ) );
+            m_NumReceived.Increment();
+        }
+        uint32_t m_Value = 0;
+        Atomic<uint32_t> m_NumReceived;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+    const uint32_t numPools = 32;
+
+    EchoServer server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    Array<EchoClient *> clients;
+    clients.SetCapacity( numPools );
+    for ( uint32_t i = 0; i < numPools; ++i )
+    {
+        EchoClient * client = FNEW( EchoClient );
+        client->m_Value = i;
+        clients.Append( client );
+
+        const ConnectionInfo * ci = ConnectWithRetry( *client, testPort, i );
+        TEST_ASSERT( client->Send( ci, &i, sizeof( i ) ) );
+    }
+    for ( EchoClient * client : clients )
+    {
+        WAIT_UNTIL_WITH_TIMEOUT( client->m_NumReceived.Load() == 1 );
+    }
+
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    // All pools share the same I/O threads
+    TEST_ASSERT( TCPConnectionPool::GetNumIOThreads() <= kMaxIOThreads );
+#endif
+
+    for ( EchoClient * client : clients )
+    {
+        client->ShutdownAllConnections();
+        FDELETE client;
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == 0 );
+    server.ShutdownAllConnections();
+
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    // Stopped once no pools use them
+    TEST_ASSERT( TCPConnectionPool::GetNumIOThreads() == 0 );
+#endif
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestTCPConnectionPool, SlowHandler )
+{
+    // a server which echoes all received data back, except for one message
+    // which blocks until released
+    class BlockingServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~BlockingServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo * ci, void * data, uint32_t size, bool & ) override
+        {
+            if ( *static_cast<uint32_t *>( data ) == m_BlockValue )
+            {
+                m_Blocked.Store( true );
+                m_Release.Wait();
+                return;
+            }
+            TEST_ASSERT( Send( ci, data, size ) );
+        }
+        const uint32_t m_BlockValue = 0xFFFFFFFF;
+        Atomic<bool> m_Blocked;
+        Semaphore m_Release;
+    };
+
+    class EchoClient : public TCPConnectionPool
+    {
+    public:
+        virtual ~EchoClient() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo *, void *, uint32_t, bool & ) override
+        {
+            m_NumReceived.Increment();
+        }
+        Atomic<uint32_t> m_NumReceived;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+    const uint32_t numPools = 16; // More than the number of I/O threads
+
+    BlockingServer server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    // block the handling of one connection
+    TCPConnectionPool blocker;
+    const ConnectionInfo * blockerCI = blocker.Connect( AStackString( "127.0.0.1" ), testPort );
+    TEST_ASSERT( blockerCI );
+    TEST_ASSERT( blocker.Send( blockerCI, &server.m_BlockValue, sizeof( uint32_t ) ) );
+    WAIT_UNTIL_WITH_TIMEOUT( server.m_Blocked.Load() );
+
+    // other connections, including those sharing an I/O thread with the blocked
+    // one, are still serviced
+    Array<EchoClient *> clients;
+    clients.SetCapacity( numPools );
+    for ( uint32_t i = 0; i < numPools; ++i )
+    {
+        EchoClient * client = FNEW( EchoClient );
+        clients.Append( client );
+
+        const ConnectionInfo * ci = ConnectWithRetry( *client, testPort, i );
+        TEST_ASSERT( client->Send( ci, &i, sizeof( i ) ) );
+    }
+    for ( EchoClient * client : clients )
+    {
+        WAIT_UNTIL_WITH_TIMEOUT( client->m_NumReceived.Load() == 1 );
+    }
+
+    server.m_Release.Signal();
+
+    for ( EchoClient * client : clients )
+    {
+        client->ShutdownAllConnections();
+        FDELETE client;
+    }
+    blocker.ShutdownAllConnections();
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == 0 );
+    server.ShutdownAllConnections();
+}
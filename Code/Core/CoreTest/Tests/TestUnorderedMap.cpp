@@ -6,6 +6,7 @@
 #include "TestFramework/TestGroup.h"
 
 #include "Core/Containers/UnorderedMap.h"
+#include "Core/Strings/AStackString.h"
 #include "Core/Strings/AString.h"
 
 //------------------------------------------------------------------------------
@@ -86,3 +87,63 @@ TEST_CASE( TestUnorderedMap, Destruct )
 }
 
 //------------------------------------------------------------------------------
+TEST_CASE( TestUnorderedMap, Erase )
+{
+    // empty
+    {
+        UnorderedMap<AString, AString> map;
+        TEST_ASSERT( map.Erase( AString( "thing" ) ) == false );
+    }
+
+    // not empty
+    {
+        UnorderedMap<AString, AString> map;
+        map.Insert( AString( "Hello" ), AString( "there" ) );
+        map.Insert( AString( "Key" ), AString( "Value" ) );
+
+        // not found
+        TEST_ASSERT( map.Erase( AString( "Thing" ) ) == false );
+        TEST_ASSERT( map.GetSize() == 2 );
+
+        // found
+        TEST_ASSERT( map.Erase( AString( "Hello" ) ) );
+        TEST_ASSERT( map.GetSize() == 1 );
+        TEST_ASSERT( map.Find( AString( "Hello" ) ) == nullptr );
+        TEST_ASSERT( map.Find( AString( "Key" ) ) );
+
+        // re-insert
+        map.Insert( AString( "Hello" ), AString( "again" ) );
+        TEST_ASSERT( map.Find( AString( "Hello" ) )->m_Value == "again" );
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestUnorderedMap, IntegerKeys )
+{
+    UnorderedMap<int32_t, AString> map;
+    for ( int32_t i = 0; i < 1000; ++i )
+    {
+        AStackString value;
+        value.Format( "%i", i );
+        map.Insert( i, value );
+    }
+    TEST_ASSERT( map.GetSize() == 1000 );
+    for ( int32_t i = 0; i < 1000; i += 2 )
+    {
+        TEST_ASSERT( map.Erase( i ) );
+    }
+    TEST_ASSERT( map.GetSize() == 500 );
+    for ( int32_t i = 0; i < 1000; ++i )
+    {
+        const auto * pair = map.Find( i );
+        TEST_ASSERT( ( pair != nullptr ) == ( ( i % 2 ) == 1 ) );
+        if ( pair )
+        {
+            AStackString value;
+            value.Format( "%i", i );
+            TEST_ASSERT( pair->m_Value == value );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
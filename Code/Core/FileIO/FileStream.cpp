@@ -12,6 +12,7 @@
 
 // system
 #include <stdio.h>
+#include <string.h> // for memset
 #if defined( __WINDOWS__ )
     #include "Core/Env/WindowsHeader.h"
 #else
@@ -84,6 +85,12 @@ bool FileStream::Open( const char * fileName, uint32_t fileMode )
         shareMode |= FILE_SHARE_READ; // allow other readers
         creationDisposition |= OPEN_ALWAYS; // open or create
     }
+    else if ( ( fileMode & CREATE_NEW_READ_WRITE ) != 0 )
+    {
+        desiredAccess |= ( GENERIC_READ | GENERIC_WRITE );
+        shareMode |= ( FILE_SHARE_READ | FILE_SHARE_DELETE ); // allow other readers (and stale lock removal)
+        creationDisposition |= CREATE_NEW; // fail if exists
+    }
     else
     {
         ASSERT( false ); // must specify an access mode
@@ -148,6 +155,10 @@ bool FileStream::Open( const char * fileName, uint32_t fileMode )
     {
         flags |= ( O_RDWR | O_CREAT );
     }
+    else if ( ( fileMode & CREATE_NEW_READ_WRITE ) != 0 )
+    {
+        flags |= ( O_RDWR | O_CREAT | O_EXCL );
+    }
     else
     {
         ASSERT( false ); // must specify an access mode
@@ -291,6 +302,103 @@ bool FileStream::IsOpen() const
     return totalBytesWritten;
 }
 
+// ReadBufferAt
+//------------------------------------------------------------------------------
+uint64_t FileStream::ReadBufferAt( void * buffer, uint64_t bytesToRead, uint64_t offset ) const
+{
+    ASSERT( buffer );
+    ASSERT( IsOpen() );
+
+    uint64_t totalBytesRead = 0;
+    do
+    {
+        const uint64_t remaining = ( bytesToRead - totalBytesRead );
+        const uint32_t tryToReadNow = ( remaining > FILESTREAM_READWRITE_SIZE )
+                                          ? FILESTREAM_READWRITE_SIZE
+                                          : static_cast<uint32_t>( remaining );
+        const uint64_t pos = ( offset + totalBytesRead );
+#if defined( __WINDOWS__ )
+        OVERLAPPED overlapped;
+        memset( &overlapped, 0, sizeof( overlapped ) );
+        overlapped.Offset = static_cast<DWORD>( pos );
+        overlapped.OffsetHigh = static_cast<DWORD>( pos >> 32 );
+        uint32_t bytesReadNow = 0;
+        if ( ( FALSE == ReadFile( (HANDLE)m_Handle,
+                                  (char *)buffer + (size_t)totalBytesRead,
+                                  tryToReadNow,
+                                  (LPDWORD)&bytesReadNow,
+                                  &overlapped ) ) ||
+             ( bytesReadNow == 0 ) )
+        {
+            break; // failed
+        }
+#elif defined( __APPLE__ ) || defined( __LINUX__ )
+        const ssize_t readResult = pread( m_Handle,
+                                          static_cast<char *>( buffer ) + totalBytesRead,
+                                          tryToReadNow,
+                                          static_cast<off_t>( pos ) );
+        if ( readResult <= 0 )
+        {
+            break;
+        }
+        const uint32_t bytesReadNow = static_cast<uint32_t>( readResult );
+#else
+    #error Unknown platform
+#endif
+        totalBytesRead += bytesReadNow;
+    } while ( totalBytesRead < bytesToRead );
+
+    return totalBytesRead;
+}
+
+// WriteBufferAt
+//------------------------------------------------------------------------------
+uint64_t FileStream::WriteBufferAt( const void * buffer, uint64_t bytesToWrite, uint64_t offset ) const
+{
+    ASSERT( buffer );
+    ASSERT( IsOpen() );
+
+    uint64_t totalBytesWritten = 0;
+    do
+    {
+        const uint64_t remaining = ( bytesToWrite - totalBytesWritten );
+        const uint32_t tryToWriteNow = ( remaining > FILESTREAM_READWRITE_SIZE )
+                                           ? FILESTREAM_READWRITE_SIZE
+                                           : static_cast<uint32_t>( remaining );
+        const uint64_t pos = ( offset + totalBytesWritten );
+#if defined( __WINDOWS__ )
+        OVERLAPPED overlapped;
+        memset( &overlapped, 0, sizeof( overlapped ) );
+        overlapped.Offset = static_cast<DWORD>( pos );
+        overlapped.OffsetHigh = static_cast<DWORD>( pos >> 32 );
+        uint32_t bytesWrittenNow = 0;
+        if ( FALSE == WriteFile( (HANDLE)m_Handle,
+                                 (const char *)buffer + (size_t)totalBytesWritten,
+                                 tryToWriteNow,
+                                 (LPDWORD)&bytesWrittenNow,
+                                 &overlapped ) )
+        {
+            break; // failed
+        }
+#elif defined( __APPLE__ ) || defined( __LINUX__ )
+        const ssize_t writeResult = pwrite( m_Handle,
+                                            static_cast<const char *>( buffer ) + totalBytesWritten,
+                                            tryToWriteNow,
+                                            static_cast<off_t>( pos ) );
+        if ( writeResult < 0 )
+        {
+            break;
+        }
+        const uint32_t bytesWrittenNow = static_cast<uint32_t>( writeResult );
+#else
+    #error Unknown platform
+#endif
+        totalBytesWritten += bytesWrittenNow;
+    } while ( totalBytesWritten < bytesToWrite );
+
+    return totalBytesWritten;
+}
+
 // Flush
 //------------------------------------------------------------------------------
 /*virtual*/ void FileStream::Flush()
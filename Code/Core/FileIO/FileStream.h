@@ -19,6 +19,7 @@ public:
         WRITE_ONLY = 0x2,
         OPEN_OR_CREATE_READ_WRITE = 0x4,
         TEMP = 0x8,
+        CREATE_NEW_READ_WRITE = 0x10, // fails if file exists (usable as a lock, incl. on network shares)
         NO_RETRY_ON_SHARING_VIOLATION = 0x80,
     };
 
@@ -32,6 +33,11 @@ public:
     virtual uint64_t WriteBuffer( const void * buffer, uint64_t bytesToWrite ) override;
     virtual void Flush() override;
 
+    // read/write at an offset, so several threads can share the file
+    //  - the position used by the functions above is left unspecified
+    uint64_t ReadBufferAt( void * buffer, uint64_t bytesToRead, uint64_t offset ) const;
+    uint64_t WriteBufferAt( const void * buffer, uint64_t bytesToWrite, uint64_t offset ) const;
+
     // size/position
     virtual uint64_t Tell() const override;
     virtual bool Seek( uint64_t pos ) const override;
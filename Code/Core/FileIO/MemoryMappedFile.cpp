@@ -0,0 +1,151 @@
+// MemoryMappedFile
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "MemoryMappedFile.h"
+
+// Core
+#include "Core/Env/Assert.h"
+
+// system
+#if defined( __WINDOWS__ )
+    #include "Core/Env/WindowsHeader.h"
+#elif defined( __LINUX__ ) || defined( __APPLE__ )
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+MemoryMappedFile::MemoryMappedFile()
+    : m_Memory( nullptr )
+    , m_Size( 0 )
+#if defined( __WINDOWS__ )
+    , m_File( INVALID_HANDLE_VALUE )
+    , m_MapFile( nullptr )
+#elif defined( __LINUX__ ) || defined( __APPLE__ )
+    , m_File( -1 )
+#else
+    #error Unknown Platform
+#endif
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+MemoryMappedFile::~MemoryMappedFile()
+{
+    Close();
+}
+
+// Open
+//------------------------------------------------------------------------------
+bool MemoryMappedFile::Open( const char * fileName )
+{
+    ASSERT( IsOpen() == false );
+
+#if defined( __WINDOWS__ )
+    m_File = CreateFileA( fileName,
+                          GENERIC_READ,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, // allow other readers, and writers updating or replacing the file
+                          nullptr,
+                          OPEN_EXISTING,
+                          FILE_ATTRIBUTE_NORMAL,
+                          nullptr );
+    if ( m_File == INVALID_HANDLE_VALUE )
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if ( ( GetFileSizeEx( m_File, &size ) == FALSE ) || ( size.QuadPart == 0 ) )
+    {
+        // Empty files can't be mapped
+        Close();
+        return false;
+    }
+
+    m_MapFile = CreateFileMappingA( m_File, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if ( m_MapFile == nullptr )
+    {
+        Close();
+        return false;
+    }
+
+    m_Memory = MapViewOfFile( m_MapFile, FILE_MAP_READ, 0, 0, 0 );
+    if ( m_Memory == nullptr )
+    {
+        Close();
+        return false;
+    }
+    m_Size = (size_t)size.QuadPart;
+    return true;
+#elif defined( __LINUX__ ) || defined( __APPLE__ )
+    m_File = open( fileName, O_RDONLY | O_CLOEXEC );
+    if ( m_File == -1 )
+    {
+        return false;
+    }
+
+    struct stat st;
+    if ( ( fstat( m_File, &st ) != 0 ) || ( st.st_size == 0 ) )
+    {
+        // Empty files can't be mapped
+        Close();
+        return false;
+    }
+
+    void * memory = mmap( nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, m_File, 0 );
+    if ( memory == MAP_FAILED )
+    {
+        Close();
+        return false;
+    }
+    m_Memory = memory;
+    m_Size = (size_t)st.st_size;
+    return true;
+#else
+    #error Unknown Platform
+#endif
+}
+
+// Close
+//------------------------------------------------------------------------------
+void MemoryMappedFile::Close()
+{
+#if defined( __WINDOWS__ )
+    if ( m_Memory )
+    {
+        UnmapViewOfFile( m_Memory );
+    }
+    if ( m_MapFile )
+    {
+        CloseHandle( m_MapFile );
+        m_MapFile = nullptr;
+    }
+    if ( m_File != INVALID_HANDLE_VALUE )
+    {
+        CloseHandle( m_File );
+        m_File = INVALID_HANDLE_VALUE;
+    }
+#elif defined( __LINUX__ ) || defined( __APPLE__ )
+    if ( m_Memory )
+    {
+        munmap( const_cast<void *>( m_Memory ), m_Size );
+    }
+    if ( m_File != -1 )
+    {
+        close( m_File );
+        m_File = -1;
+    }
+#else
+    #error Unknown Platform
+#endif
+    m_Memory = nullptr;
+    m_Size = 0;
+}
+
+//------------------------------------------------------------------------------
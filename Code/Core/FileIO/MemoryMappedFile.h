@@ -0,0 +1,42 @@
+// MemoryMappedFile - read only view of a file's contents
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// MemoryMappedFile
+//------------------------------------------------------------------------------
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile();
+    ~MemoryMappedFile();
+
+    // non-copyable
+    MemoryMappedFile( const MemoryMappedFile & other ) = delete;
+    MemoryMappedFile & operator=( const MemoryMappedFile & other ) = delete;
+
+    bool Open( const char * fileName );
+    void Close();
+
+    bool IsOpen() const { return ( m_Memory != nullptr ); }
+
+    const void * GetData() const { return m_Memory; }
+    size_t GetSize() const { return m_Size; }
+
+private:
+    const void * m_Memory;
+    size_t m_Size;
+#if defined( __WINDOWS__ )
+    void * m_File;
+    void * m_MapFile;
+#elif defined( __LINUX__ ) || defined( __APPLE__ )
+    int m_File;
+#else
+    #error Unknown Platform
+#endif
+};
+
+//------------------------------------------------------------------------------
@@ -6,6 +6,10 @@
 //------------------------------------------------------------------------------
 #include "Core/Env/Types.h"
 
+#if defined( _MSC_VER ) && !defined( __clang__ )
+    #include <intrin.h>
+#endif
+
 // Math
 //------------------------------------------------------------------------------
 namespace Math
@@ -48,6 +52,16 @@ namespace Math
 
         return count;
     }
+    static inline uint32_t CountTrailingZeros( uint64_t value ) // value must be non-zero
+    {
+#if defined( __GNUC__ ) || defined( __clang__ )
+        return static_cast<uint32_t>( __builtin_ctzll( value ) );
+#else
+        unsigned long index;
+        _BitScanForward64( &index, value );
+        return static_cast<uint32_t>( index );
+#endif
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,765 @@
+// HTTPClient
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "HTTPClient.h"
+
+// Core
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Network/Network.h"
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+
+// System
+#if defined( __WINDOWS__ )
+    #include "Core/Env/WindowsHeader.h"
+#elif defined( __APPLE__ ) || defined( __LINUX__ )
+    #include <arpa/inet.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <poll.h>
+    #include <sys/ioctl.h>
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <unistd.h>
+    #define INVALID_SOCKET ( -1 )
+    #define SOCKET_ERROR -1
+#else
+    #error Unknown platform
+#endif
+#include <stdlib.h> // for strtoull
+#include <string.h> // for memcpy
+
+// HTTPConnection - one connection to the server
+//------------------------------------------------------------------------------
+class HTTPConnection
+{
+public:
+    explicit HTTPConnection( TCPSocket socket ) : m_Socket( socket ) {}
+    ~HTTPConnection()
+    {
+#if defined( __WINDOWS__ )
+        closesocket( m_Socket );
+#else
+        close( m_Socket );
+#endif
+    }
+
+    bool Send( const void * data, size_t size );
+    int64_t Recv( void * buffer, size_t size ); // Returns 0 on close, -1 on error
+    bool RecvAll( void * buffer, size_t size );
+    bool ReadUntil( const char * terminator, AString & outData ); // Excluding terminator
+
+    // Data received, but not yet consumed
+    bool HasBufferedData() const { return ( m_BufferEnd > m_BufferStart ); }
+
+private:
+    TCPSocket m_Socket;
+    uint32_t m_BufferStart = 0;
+    uint32_t m_BufferEnd = 0;
+    char m_Buffer[ 16 * 1024 ]; // Max size of response headers
+};
+
+// Send
+//------------------------------------------------------------------------------
+bool HTTPConnection::Send( const void * data, size_t size )
+{
+    const char * pos = static_cast<const char *>( data );
+    while ( size > 0 )
+    {
+        // Large bodies are sent in pieces directly from the caller's memory
+        const size_t toSend = Math::Min( size, HTTPClient::kMaxSendChunk );
+#if defined( __WINDOWS__ )
+        const int sent = send( m_Socket, pos, (int)toSend, 0 );
+#elif defined( __LINUX__ )
+        const ssize_t sent = send( m_Socket, pos, toSend, MSG_NOSIGNAL );
+#else
+        const ssize_t sent = send( m_Socket, pos, toSend, 0 );
+#endif
+        if ( sent <= 0 )
+        {
+            return false; // Closed, timed out or failed
+        }
+        pos += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+// Recv
+//------------------------------------------------------------------------------
+int64_t HTTPConnection::Recv( void * buffer, size_t size )
+{
+    // Consume buffered data first
+    if ( HasBufferedData() )
+    {
+        const size_t available = Math::Min( size, (size_t)( m_BufferEnd - m_BufferStart ) );
+        memcpy( buffer, m_Buffer + m_BufferStart, available );
+        m_BufferStart += (uint32_t)available;
+        return (int64_t)available;
+    }
+
+    // Receive directly into the destination
+    const size_t toRecv = Math::Min( size, HTTPClient::kMaxSendChunk );
+#if defined( __WINDOWS__ )
+    const int received = recv( m_Socket, static_cast<char *>( buffer ), (int)toRecv, 0 );
+#else
+    const ssize_t received = recv( m_Socket, buffer, toRecv, 0 );
+#endif
+    return ( received < 0 ) ? -1 : (int64_t)received;
+}
+
+// RecvAll
+//------------------------------------------------------------------------------
+bool HTTPConnection::RecvAll( void * buffer, size_t size )
+{
+    char * pos = static_cast<char *>( buffer );
+    while ( size > 0 )
+    {
+        const int64_t received = Recv( pos, size );
+        if ( received <= 0 )
+        {
+            return false;
+        }
+        pos += received;
+        size -= (size_t)received;
+    }
+    return true;
+}
+
+// ReadUntil
+//------------------------------------------------------------------------------
+bool HTTPConnection::ReadUntil( const char * terminator, AString & outData )
+{
+    const size_t terminatorLen = AString::StrLen( terminator );
+    size_t searchPos = m_BufferStart;
+    for ( ;; )
+    {
+        // Terminator already received?
+        for ( ; ( searchPos + terminatorLen ) <= m_BufferEnd; ++searchPos )
+        {
+            if ( memcmp( m_Buffer + searchPos, terminator, terminatorLen ) == 0 )
+            {
+                outData.Assign( m_Buffer + m_BufferStart, m_Buffer + searchPos );
+                m_BufferStart = (uint32_t)( searchPos + terminatorLen );
+                return true;
+            }
+        }
+
+        // Make space to receive more
+        if ( m_BufferStart > 0 )
+        {
+            const uint32_t buffered = ( m_BufferEnd - m_BufferStart );
+            memmove( m_Buffer, m_Buffer + m_BufferStart, buffered );
+            searchPos -= m_BufferStart;
+            m_BufferStart = 0;
+            m_BufferEnd = buffered;
+        }
+        if ( m_BufferEnd == sizeof( m_Buffer ) )
+        {
+            return false; // Too long
+        }
+
+#if defined( __WINDOWS__ )
+        const int received = recv( m_Socket, m_Buffer + m_BufferEnd, (int)( sizeof( m_Buffer ) - m_BufferEnd ), 0 );
+#else
+        const ssize_t received = recv( m_Socket, m_Buffer + m_BufferEnd, sizeof( m_Buffer ) - m_BufferEnd, 0 );
+#endif
+        if ( received <= 0 )
+        {
+            return false; // Closed, timed out or failed
+        }
+        m_BufferEnd += (uint32_t)received;
+    }
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+HTTPClient::HTTPClient() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+HTTPClient::~HTTPClient()
+{
+    for ( HTTPConnection * connection : m_IdleConnections )
+    {
+        FDELETE connection;
+    }
+}
+
+// ParseURL
+//------------------------------------------------------------------------------
+/*static*/ bool HTTPClient::ParseURL( const AString & url, AString & outHost, uint16_t & outPort, AString & outPath )
+{
+    if ( url.BeginsWithI( "http://" ) == false )
+    {
+        return false; // Only plain http is supported
+    }
+
+    const char * hostStart = url.Get() + 7;
+    const char * pathStart = url.Find( '/', hostStart );
+    if ( pathStart == nullptr )
+    {
+        pathStart = url.GetEnd();
+    }
+    const char * portStart = url.Find( ':', hostStart, pathStart );
+
+    outHost.Assign( hostStart, portStart ? portStart : pathStart );
+    if ( outHost.IsEmpty() )
+    {
+        return false;
+    }
+
+    outPort = 80;
+    if ( portStart )
+    {
+        AStackString<8> port( portStart + 1, pathStart );
+        uint32_t portValue = 0;
+        if ( ( port.Scan( "%u", &portValue ) != 1 ) || ( portValue == 0 ) || ( portValue > 0xFFFF ) )
+        {
+            return false;
+        }
+        outPort = (uint16_t)portValue;
+    }
+
+    outPath = pathStart;
+    if ( outPath.IsEmpty() )
+    {
+        outPath = "/";
+    }
+    return true;
+}
+
+// SetServer
+//------------------------------------------------------------------------------
+bool HTTPClient::SetServer( const AString & host, uint16_t port, uint32_t timeoutMS )
+{
+    m_Host = host;
+    m_Port = port;
+    m_TimeoutMS = timeoutMS;
+    m_HostIP = Network::GetHostIPFromName( host, timeoutMS );
+    return ( m_HostIP != 0 );
+}
+
+// Request
+//------------------------------------------------------------------------------
+bool HTTPClient::Request( const char * method,
+                          const AString & path,
+                          const void * body,
+                          size_t bodySize,
+                          uint32_t & outStatus,
+                          void ** outBody,
+                          size_t * outBodySize )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( m_HostIP != 0 ); // SetServer must have succeeded
+
+    // A re-used connection may have been closed by the server while idle, in
+    // which case the request is retried once on a new connection
+    bool allowReuse = true;
+    for ( ;; )
+    {
+        bool reused = false;
+        HTTPConnection * connection = AcquireConnection( allowReuse, reused );
+        if ( connection == nullptr )
+        {
+            return false;
+        }
+
+        AStackString<1024> request;
+        FormatRequest( method, path, body, bodySize, request );
+        bool keepAlive = false;
+        if ( connection->Send( request.Get(), request.GetLength() ) &&
+             ( ( body == nullptr ) || connection->Send( body, bodySize ) ) &&
+             ReceiveResponse( connection, method, outStatus, outBody, outBodySize, keepAlive ) )
+        {
+            ReleaseConnection( connection, keepAlive );
+            return true;
+        }
+        ReleaseConnection( connection, false );
+
+        if ( reused == false )
+        {
+            return false;
+        }
+
+        // Other idle connections are likely to have been closed too
+        {
+            MutexHolder mh( m_Mutex );
+            for ( HTTPConnection * idleConnection : m_IdleConnections )
+            {
+                FDELETE idleConnection;
+            }
+            m_IdleConnections.Clear();
+        }
+        allowReuse = false;
+    }
+}
+
+// RequestMany
+//------------------------------------------------------------------------------
+bool HTTPClient::RequestMany( const char * method,
+                              const Array<AString> & paths,
+                              Array<uint32_t> & outStatuses )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( m_HostIP != 0 ); // SetServer must have succeeded
+
+    outStatuses.SetSize( paths.GetSize() );
+
+    // As for Request, a re-used connection which fails before any response
+    // is received is retried once on a new connection. A server may also
+    // close the connection part way through, in which case the unanswered
+    // requests are sent again on another connection.
+    size_t numCompleted = 0;
+    bool allowReuse = true;
+    while ( numCompleted < paths.GetSize() )
+    {
+        bool reused = false;
+        HTTPConnection * connection = AcquireConnection( allowReuse, reused );
+        if ( connection == nullptr )
+        {
+            return false;
+        }
+
+        bool keepAlive = true;
+        bool failed = false;
+        while ( keepAlive && ( failed == false ) && ( numCompleted < paths.GetSize() ) )
+        {
+            // Send a batch of requests together
+            const size_t batchEnd = Math::Min( paths.GetSize(), numCompleted + kMaxPipelinedRequests );
+            AString requests;
+            for ( size_t i = numCompleted; i < batchEnd; ++i )
+            {
+                AStackString<1024> request;
+                FormatRequest( method, paths[ i ], nullptr, 0, request );
+                requests += request;
+            }
+            if ( connection->Send( requests.Get(), requests.GetLength() ) == false )
+            {
+                failed = true;
+                break;
+            }
+
+            // Responses arrive in the same order
+            while ( keepAlive && ( numCompleted < batchEnd ) )
+            {
+                if ( ReceiveResponse( connection, method, outStatuses[ numCompleted ], nullptr, nullptr, keepAlive ) == false )
+                {
+                    failed = true;
+                    break;
+                }
+                ++numCompleted;
+                reused = false; // Connection is known to be good
+            }
+        }
+        ReleaseConnection( connection, ( keepAlive && ( failed == false ) ) );
+
+        if ( failed )
+        {
+            if ( reused == false )
+            {
+                return false;
+            }
+            allowReuse = false;
+        }
+    }
+    return true;
+}
+
+// AcquireConnection
+//------------------------------------------------------------------------------
+HTTPConnection * HTTPClient::AcquireConnection( bool allowReuse, bool & outReused )
+{
+    // Re-use an idle connection if possible
+    if ( allowReuse )
+    {
+        MutexHolder mh( m_Mutex );
+        if ( m_IdleConnections.IsEmpty() == false )
+        {
+            outReused = true;
+            HTTPConnection * connection = m_IdleConnections.Top();
+            m_IdleConnections.Pop();
+            return connection;
+        }
+    }
+    outReused = false;
+
+    PROFILE_SECTION( "Connect" );
+
+#if defined( __LINUX__ )
+    const TCPSocket sockfd = socket( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+#else
+    const TCPSocket sockfd = socket( AF_INET, SOCK_STREAM, 0 );
+#endif
+    if ( sockfd == INVALID_SOCKET )
+    {
+        return nullptr;
+    }
+#if defined( __APPLE__ )
+    VERIFY( fcntl( sockfd, F_SETFD, FD_CLOEXEC ) == 0 );
+    int nosigpipe = 1;
+    VERIFY( setsockopt( sockfd, SOL_SOCKET, SO_NOSIGPIPE, (void *)&nosigpipe, sizeof( int ) ) == 0 );
+#endif
+    HTTPConnection * connection = FNEW( HTTPConnection( sockfd ) ); // Owns socket from here
+
+    // Requests are small and latency sensitive
+    static const int disableNagle = 1;
+    setsockopt( sockfd, IPPROTO_TCP, TCP_NODELAY, (const char *)&disableNagle, sizeof( disableNagle ) );
+
+    // Connect without blocking, so a timeout can be applied
+    u_long nonBlocking = 1;
+#if defined( __WINDOWS__ )
+    VERIFY( ioctlsocket( sockfd, (long)FIONBIO, &nonBlocking ) == 0 );
+#else
+    VERIFY( ioctl( sockfd, FIONBIO, &nonBlocking ) == 0 );
+#endif
+
+    struct sockaddr_in destAddr;
+    memset( &destAddr, 0, sizeof( destAddr ) );
+    destAddr.sin_family = AF_INET;
+    destAddr.sin_port = htons( m_Port );
+    destAddr.sin_addr.s_addr = m_HostIP;
+    if ( connect( sockfd, (struct sockaddr *)&destAddr, sizeof( destAddr ) ) != 0 )
+    {
+#if defined( __WINDOWS__ )
+        const bool inProgress = ( WSAGetLastError() == WSAEWOULDBLOCK );
+#else
+        const bool inProgress = ( errno == EINPROGRESS );
+#endif
+        if ( inProgress == false )
+        {
+            FDELETE connection;
+            return nullptr;
+        }
+
+        // Wait for connection, up to the timeout
+        const Timer timer;
+        for ( ;; )
+        {
+#if defined( __WINDOWS__ )
+            fd_set write, err;
+            FD_ZERO( &write );
+            FD_ZERO( &err );
+            FD_SET( sockfd, &write );
+            FD_SET( sockfd, &err );
+            timeval pollingTimeout;
+            memset( &pollingTimeout, 0, sizeof( timeval ) );
+            pollingTimeout.tv_usec = ( 10 * 1000 );
+            const int ret = select( 0, nullptr, &write, &err, &pollingTimeout );
+            const bool completed = ( ret > 0 );
+            bool failed = ( ret < 0 ) || ( ( ret > 0 ) && FD_ISSET( sockfd, &err ) );
+#else
+            struct pollfd pfd;
+            pfd.fd = sockfd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            const int ret = poll( &pfd, 1, 10 );
+            const bool completed = ( ret > 0 );
+            bool failed = ( ret < 0 );
+            if ( completed )
+            {
+                // Completion does not imply success
+                int32_t error = 0;
+                socklen_t size = sizeof( error );
+                failed = ( getsockopt( sockfd, SOL_SOCKET, SO_ERROR, (char *)&error, &size ) != 0 ) || ( error != 0 );
+            }
+#endif
+            if ( failed ||
+                 ( ( completed == false ) && ( timer.GetElapsedMS() >= (float)m_TimeoutMS ) ) )
+            {
+                FDELETE connection;
+                return nullptr;
+            }
+            if ( completed )
+            {
+                break;
+            }
+        }
+    }
+
+    // Use blocking I/O, with timeouts, from here
+    nonBlocking = 0;
+#if defined( __WINDOWS__ )
+    VERIFY( ioctlsocket( sockfd, (long)FIONBIO, &nonBlocking ) == 0 );
+    const DWORD timeout = m_TimeoutMS;
+#else
+    VERIFY( ioctl( sockfd, FIONBIO, &nonBlocking ) == 0 );
+    struct timeval timeout;
+    timeout.tv_sec = (time_t)( m_TimeoutMS / 1000 );
+    timeout.tv_usec = (suseconds_t)( ( m_TimeoutMS % 1000 ) * 1000 );
+#endif
+    setsockopt( sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof( timeout ) );
+    setsockopt( sockfd, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof( timeout ) );
+
+    m_NumConnectionsOpened.Increment();
+    return connection;
+}
+
+// ReleaseConnection
+//------------------------------------------------------------------------------
+void HTTPClient::ReleaseConnection( HTTPConnection * connection, bool keepAlive )
+{
+    if ( keepAlive )
+    {
+        MutexHolder mh( m_Mutex );
+        if ( m_IdleConnections.GetSize() < kMaxIdleConnections )
+        {
+            m_IdleConnections.Append( connection );
+            return;
+        }
+    }
+    FDELETE connection;
+}
+
+// FormatRequest
+//------------------------------------------------------------------------------
+void HTTPClient::FormatRequest( const char * method,
+                                const AString & path,
+                                const void * body,
+                                size_t bodySize,
+                                AString & outRequest ) const
+{
+    outRequest.Format( "%s %s HTTP/1.1\r\n"
+                       "Host: %s:%u\r\n",
+                       method,
+                       path.Get(),
+                       m_Host.Get(),
+                       (uint32_t)m_Port );
+    if ( body )
+    {
+        outRequest.AppendFormat( "Content-Length: %llu\r\n"
+                                 "Content-Type: application/octet-stream\r\n",
+                                 (unsigned long long)bodySize );
+    }
+    outRequest += "\r\n";
+}
+
+// ReceiveResponse
+//------------------------------------------------------------------------------
+bool HTTPClient::ReceiveResponse( HTTPConnection * connection,
+                                  const char * method,
+                                  uint32_t & outStatus,
+                                  void ** outBody,
+                                  size_t * outBodySize,
+                                  bool & outKeepAlive ) const
+{
+    // Receive response headers (skipping informational responses)
+    AStackString<4096> headers;
+    uint32_t status = 0;
+    uint32_t minorVersion = 0;
+    do
+    {
+        if ( connection->ReadUntil( "\r\n\r\n", headers ) == false )
+        {
+            return false;
+        }
+        if ( headers.Scan( "HTTP/1.%u %u", &minorVersion, &status ) != 2 )
+        {
+            return false; // Not HTTP
+        }
+    } while ( ( status >= 100 ) && ( status < 200 ) );
+
+    // Parse headers of interest
+    bool chunked = false;
+    bool hasContentLength = false;
+    uint64_t contentLength = 0;
+    bool keepAlive = ( minorVersion >= 1 ); // HTTP/1.1 defaults to persistent connections
+    const char * line = headers.Find( "\r\n" );
+    while ( line )
+    {
+        line += 2;
+        const char * lineEnd = headers.Find( "\r\n", line );
+        const AStackString<256> header( line, lineEnd ? lineEnd : headers.GetEnd() );
+        if ( header.BeginsWithI( "Content-Length:" ) )
+        {
+            hasContentLength = true;
+            contentLength = strtoull( header.Get() + 15, nullptr, 10 );
+        }
+        else if ( header.BeginsWithI( "Transfer-Encoding:" ) )
+        {
+            chunked = ( header.FindI( "chunked" ) != nullptr );
+        }
+        else if ( header.BeginsWithI( "Connection:" ) )
+        {
+            if ( header.FindI( "close" ) )
+            {
+                keepAlive = false;
+            }
+            else if ( header.FindI( "keep-alive" ) )
+            {
+                keepAlive = true;
+            }
+        }
+        line = lineEnd;
+    }
+
+    // Receive body
+    void * responseBody = nullptr;
+    size_t responseBodySize = 0;
+    const bool hasBody = ( AString::StrNCmpI( method, "HEAD", 5 ) != 0 ) && ( status != 204 ) && ( status != 304 );
+    if ( hasBody )
+    {
+        const bool untilClose = ( ( chunked == false ) && ( hasContentLength == false ) );
+        if ( untilClose )
+        {
+            keepAlive = false;
+        }
+        bool tooLarge = false;
+        if ( ReadBody( connection, chunked, contentLength, untilClose, &responseBody, &responseBodySize, tooLarge ) == false )
+        {
+            if ( tooLarge == false )
+            {
+                return false;
+            }
+
+            // The rest of the body is not received, so the connection can't be re-used
+            status = kStatusResponseTooLarge;
+            keepAlive = false;
+        }
+    }
+
+    outStatus = status;
+    outKeepAlive = keepAlive;
+    if ( outBody )
+    {
+        *outBody = responseBody;
+        *outBodySize = responseBodySize;
+    }
+    else
+    {
+        FREE( responseBody );
+    }
+    return true;
+}
+
+// ReadBody
+//------------------------------------------------------------------------------
+bool HTTPClient::ReadBody( HTTPConnection * connection,
+                           bool chunked,
+                           uint64_t contentLength,
+                           bool untilClose,
+                           void ** outBody,
+                           size_t * outBodySize,
+                           bool & outTooLarge ) const
+{
+    outTooLarge = false;
+
+    // Known size: receive directly into final buffer
+    if ( ( chunked == false ) && ( untilClose == false ) )
+    {
+        if ( contentLength > m_MaxResponseBodySize )
+        {
+            outTooLarge = true;
+            return false;
+        }
+        void * data = ALLOC( (size_t)contentLength + 1 ); // Never zero sized
+        if ( connection->RecvAll( data, (size_t)contentLength ) == false )
+        {
+            FREE( data );
+            return false;
+        }
+        *outBody = data;
+        *outBodySize = (size_t)contentLength;
+        return true;
+    }
+
+    // Unknown size: grow buffer as data arrives
+    char * data = nullptr;
+    size_t size = 0;
+    size_t capacity = 0;
+    bool ok = true;
+    for ( ;; )
+    {
+        // Determine how much to read next
+        size_t toRead = ( 64 * 1024 );
+        if ( chunked )
+        {
+            AStackString<64> chunkHeader;
+            if ( connection->ReadUntil( "\r\n", chunkHeader ) == false )
+            {
+                ok = false;
+                break;
+            }
+            toRead = (size_t)strtoull( chunkHeader.Get(), nullptr, 16 ); // Ignores chunk extensions
+            if ( toRead == 0 )
+            {
+                // Skip trailers
+                AStackString<256> trailer;
+                do
+                {
+                    if ( connection->ReadUntil( "\r\n", trailer ) == false )
+                    {
+                        ok = false;
+                        break;
+                    }
+                } while ( trailer.IsEmpty() == false );
+                break;
+            }
+        }
+
+        // Grow
+        if ( ( toRead > m_MaxResponseBodySize ) || ( ( size + toRead ) > m_MaxResponseBodySize ) )
+        {
+            outTooLarge = true;
+            ok = false;
+            break;
+        }
+        if ( ( size + toRead ) > capacity )
+        {
+            capacity = Math::Min( Math::Max( capacity * 2, size + toRead ), m_MaxResponseBodySize );
+            char * newData = static_cast<char *>( ALLOC( capacity ) );
+            if ( data )
+            {
+                memcpy( newData, data, size );
+                FREE( data );
+            }
+            data = newData;
+        }
+
+        if ( chunked )
+        {
+            AStackString<8> chunkEnd;
+            if ( ( connection->RecvAll( data + size, toRead ) == false ) ||
+                 ( connection->ReadUntil( "\r\n", chunkEnd ) == false ) )
+            {
+                ok = false;
+                break;
+            }
+            size += toRead;
+        }
+        else
+        {
+            const int64_t received = connection->Recv( data + size, toRead );
+            if ( received < 0 )
+            {
+                ok = false;
+                break;
+            }
+            if ( received == 0 )
+            {
+                break; // Body ends at connection close
+            }
+            size += (size_t)received;
+        }
+    }
+
+    if ( ok == false )
+    {
+        FREE( data );
+        return false;
+    }
+    *outBody = data ? data : ALLOC( 1 ); // Never null on success
+    *outBodySize = size;
+    return true;
+}
+
+//------------------------------------------------------------------------------
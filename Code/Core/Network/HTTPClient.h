@@ -0,0 +1,112 @@
+// HTTPClient
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "NetworkStartupHelper.h"
+
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class HTTPConnection;
+
+// HTTPClient
+//  - Minimal HTTP/1.1 client for a single server
+//  - Connections are kept alive and re-used between requests
+//  - Thread safe: concurrent requests use separate connections
+//  - Request and response bodies are transferred directly to/from the
+//    caller's memory, without intermediate copies
+//  - Response bodies are limited in size (see SetMaxResponseBodySize), so a
+//    bad Content-Length can't cause an allocation of any size
+//------------------------------------------------------------------------------
+class HTTPClient
+{
+public:
+    HTTPClient();
+    ~HTTPClient();
+
+    // Split "http://host[:port][/path]" into its components
+    static bool ParseURL( const AString & url, AString & outHost, uint16_t & outPort, AString & outPath );
+
+    // Set server (resolving host name)
+    bool SetServer( const AString & host, uint16_t port, uint32_t timeoutMS = kDefaultTimeoutMS );
+
+    // Larger responses complete with kStatusResponseTooLarge
+    void SetMaxResponseBodySize( size_t maxSize ) { m_MaxResponseBodySize = maxSize; }
+
+    // Perform a request
+    //  - Returns false if the request could not be completed (no status)
+    //  - Bounded by the timeout only; requests are not interrupted by a build
+    //    abort, so work flushed at the end of a build can complete
+    //  - If outBody is provided, it receives the response body, which must be
+    //    freed with FREE
+    bool Request( const char * method,
+                  const AString & path,
+                  const void * body,
+                  size_t bodySize,
+                  uint32_t & outStatus,
+                  void ** outBody = nullptr,
+                  size_t * outBodySize = nullptr );
+
+    // Perform several requests without bodies (i.e. HEAD), pipelined on one connection
+    //  - One round trip per kMaxPipelinedRequests, instead of one per request
+    //  - Returns false if any request could not be completed
+    //  - Response bodies are discarded
+    bool RequestMany( const char * method,
+                      const Array<AString> & paths,
+                      Array<uint32_t> & outStatuses );
+
+    // Connections opened since creation (for verifying re-use)
+    uint32_t GetNumConnectionsOpened() const { return m_NumConnectionsOpened.Load(); }
+
+    inline static const uint32_t kDefaultTimeoutMS = ( 30 * 1000 );
+    inline static const uint32_t kMaxIdleConnections = 64;
+    inline static const size_t kMaxSendChunk = ( 1024 * 1024 ); // Largest single send()
+    inline static const size_t kDefaultMaxResponseBodySize = ( 1024 * 1024 * 1024 );
+    inline static const uint32_t kMaxPipelinedRequests = 32;
+    inline static const uint32_t kStatusResponseTooLarge = 1000; // Not an HTTP status
+
+private:
+    HTTPConnection * AcquireConnection( bool allowReuse, bool & outReused );
+    void ReleaseConnection( HTTPConnection * connection, bool keepAlive );
+
+    void FormatRequest( const char * method,
+                        const AString & path,
+                        const void * body,
+                        size_t bodySize,
+                        AString & outRequest ) const;
+    bool ReceiveResponse( HTTPConnection * connection,
+                          const char * method,
+                          uint32_t & outStatus,
+                          void ** outBody,
+                          size_t * outBodySize,
+                          bool & outKeepAlive ) const;
+    bool ReadBody( HTTPConnection * connection,
+                   bool chunked,
+                   uint64_t contentLength,
+                   bool untilClose,
+                   void ** outBody,
+                   size_t * outBodySize,
+                   bool & outTooLarge ) const;
+
+    AString m_Host;
+    uint16_t m_Port = 0;
+    uint32_t m_HostIP = 0;
+    uint32_t m_TimeoutMS = kDefaultTimeoutMS;
+    size_t m_MaxResponseBodySize = kDefaultMaxResponseBodySize;
+
+    Mutex m_Mutex;
+    Array<HTTPConnection *> m_IdleConnections;
+    Atomic<uint32_t> m_NumConnectionsOpened;
+
+    // object to manage network subsystem lifetime
+    NetworkStartupHelper m_EnsureNetworkStarted;
+};
+
+//------------------------------------------------------------------------------
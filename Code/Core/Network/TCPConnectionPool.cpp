@@ -7,7 +7,9 @@
 #include "TCPConnectionPool.h"
 
 // Core
+#include "Core/Env/CPUInfo.h"
 #include "Core/Env/ErrorFormat.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Mem/Mem.h"
 #include "Core/Network/Network.h"
 #include "Core/Process/Atomic.h"
@@ -31,6 +33,11 @@
     #include <sys/socket.h>
     #include <sys/uio.h>
     #include <unistd.h>
+    #if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+        #include <poll.h>
+        #include <sys/epoll.h>
+        #include <sys/eventfd.h>
+    #endif
     #define INVALID_SOCKET ( -1 )
     #define SOCKET_ERROR -1
 #else
@@ -127,6 +134,332 @@ protected:
     #define TCP_CONNECTION_POOL_PROFILE_SET_THREAD_NAME( threadType ) (void)0
 #endif
 
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+// Constants
+//------------------------------------------------------------------------------
+static const int kMaxIOEvents = 64;
+static const uint64_t kMaxPendingReceiveBytes = ( 32 * MEGABYTE ); // Per connection, before reading is paused
+static const uint32_t kMaxHandlerThreads = 64;
+static const uint32_t kHandlerIdleTimeoutMS = ( 30 * 1000 );
+
+// TCPIOThread - services events for a subset of all connections, of any pool
+//------------------------------------------------------------------------------
+class TCPIOThread
+{
+public:
+    TCPIOThread()
+    {
+        m_EPollFD = epoll_create1( EPOLL_CLOEXEC );
+        m_WakeFD = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+
+        // Wake events are identified by a null pointer
+        struct epoll_event event;
+        memset( &event, 0, sizeof( event ) );
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        VERIFY( epoll_ctl( m_EPollFD, EPOLL_CTL_ADD, m_WakeFD, &event ) == 0 );
+    }
+    ~TCPIOThread()
+    {
+        close( m_WakeFD );
+        close( m_EPollFD );
+    }
+
+    void Wake()
+    {
+        const uint64_t value = 1;
+        VERIFY( write( m_WakeFD, &value, sizeof( value ) ) == sizeof( value ) );
+    }
+
+    int m_EPollFD;
+    int m_WakeFD;
+    Thread m_Thread;
+    Atomic<bool> m_Quit;
+    Atomic<bool> m_DisconnectPending;
+    Mutex m_NewConnectionsMutex;
+    Array<ConnectionInfo *> m_NewConnections; // Added by other threads, awaiting OnConnected
+    Array<ConnectionInfo *> m_Connections; // Only accessed by this thread
+    Array<ConnectionInfo *> m_PausedConnections; // Only accessed by this thread
+};
+
+// TCPHandlerThreads - run callbacks for connections of all pools
+//  - I/O threads hand events off, so a slow callback only delays its own connection
+//  - Events for a connection are handled in order, by one thread at a time
+//  - Threads are added when none are idle, up to a limit, after which events
+//    wait for a thread to finish its current callback
+//  - Threads idle for a while are retired, and the rest stopped with the I/O threads
+//------------------------------------------------------------------------------
+class TCPHandlerThreads
+{
+public:
+    static void Schedule( ConnectionInfo * ci ); // Caller must hold ci->m_HandlerMutex
+    static void StopThreads();
+
+private:
+    static uint32_t ThreadFunction( void * data );
+    static ConnectionInfo * GetNextReady(); // Caller must hold s_Mutex
+    static void JoinThreads( Array<Thread *> & threads );
+
+    static Mutex s_Mutex;
+    static Semaphore s_Semaphore;
+    static Array<ConnectionInfo *> s_Ready;
+    static size_t s_ReadyHead;
+    static Array<Thread *> s_Threads;
+    static Array<Thread *> s_RetiredThreads;
+    static uint32_t s_NumIdle;
+    static bool s_Stopping;
+};
+/*static*/ Mutex TCPHandlerThreads::s_Mutex;
+/*static*/ Semaphore TCPHandlerThreads::s_Semaphore;
+/*static*/ Array<ConnectionInfo *> TCPHandlerThreads::s_Ready;
+/*static*/ size_t TCPHandlerThreads::s_ReadyHead = 0;
+/*static*/ Array<Thread *> TCPHandlerThreads::s_Threads;
+/*static*/ Array<Thread *> TCPHandlerThreads::s_RetiredThreads;
+/*static*/ uint32_t TCPHandlerThreads::s_NumIdle = 0;
+/*static*/ bool TCPHandlerThreads::s_Stopping = false;
+
+// Schedule
+//------------------------------------------------------------------------------
+/*static*/ void TCPHandlerThreads::Schedule( ConnectionInfo * ci )
+{
+    // Already waiting for (or being handled by) a thread, which will see the
+    // new events before releasing the connection
+    if ( ci->m_HandlerScheduled )
+    {
+        return;
+    }
+    ci->m_HandlerScheduled = true;
+
+    Array<Thread *> retired;
+    {
+        MutexHolder mh( s_Mutex );
+        s_Ready.Append( ci );
+
+        // Each signal is paired with an idle thread. Once the limit is reached,
+        // the event waits for the next thread to finish a callback.
+        if ( s_NumIdle > 0 )
+        {
+            --s_NumIdle;
+            s_Semaphore.Signal();
+        }
+        else if ( s_Threads.GetSize() < kMaxHandlerThreads )
+        {
+            Thread * thread = FNEW( Thread() );
+            thread->Start( &TCPHandlerThreads::ThreadFunction, "TCPHandler", thread );
+            s_Threads.Append( thread );
+            retired.Swap( s_RetiredThreads ); // Reap while starting a replacement
+        }
+    }
+
+    JoinThreads( retired );
+}
+
+// StopThreads
+//------------------------------------------------------------------------------
+/*static*/ void TCPHandlerThreads::StopThreads()
+{
+    // All connections are closed, so nothing else can be scheduled
+    Array<Thread *> threads;
+    Array<Thread *> retired;
+    {
+        MutexHolder mh( s_Mutex );
+        ASSERT( s_ReadyHead == s_Ready.GetSize() );
+        threads.Swap( s_Threads );
+        retired.Swap( s_RetiredThreads );
+        s_Stopping = true;
+    }
+
+    // Threads wake with nothing to do and exit
+    s_Semaphore.Signal( static_cast<uint32_t>( threads.GetSize() ) );
+    JoinThreads( threads );
+    JoinThreads( retired );
+
+    // Threads only stop counting themselves as idle once joined. Any signals
+    // not consumed by exiting threads must be drained before restarting.
+    Array<ConnectionInfo *> ready;
+    MutexHolder mh( s_Mutex );
+    while ( s_Semaphore.Wait( 0 ) )
+    {
+    }
+    ready.Swap( s_Ready );
+    s_ReadyHead = 0;
+    s_NumIdle = 0;
+    s_Stopping = false;
+}
+
+// ThreadFunction
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TCPHandlerThreads::ThreadFunction( void * data )
+{
+    TCP_CONNECTION_POOL_PROFILE_SET_THREAD_NAME( TCPConnectionPoolProfileHelper::THREAD_CONNECTION );
+
+    Thread * self = static_cast<Thread *>( data );
+
+    // Started for an event, so begin without waiting
+    for ( ;; )
+    {
+        // Handle events until none are waiting
+        for ( ;; )
+        {
+            ConnectionInfo * ci;
+            {
+                MutexHolder mh( s_Mutex );
+                ci = GetNextReady();
+                if ( ci == nullptr )
+                {
+                    if ( s_Stopping )
+                    {
+                        return 0;
+                    }
+                    ++s_NumIdle;
+                    break;
+                }
+            }
+
+            TCPConnectionPool::HandleEvents( ci );
+        }
+
+        // Wait for more, retiring if idle for too long
+        if ( s_Semaphore.Wait( kHandlerIdleTimeoutMS ) == false )
+        {
+            {
+                MutexHolder mh( s_Mutex );
+
+                // If no idle threads remain, this one was claimed just as the
+                // wait timed out, so the signal is pending
+                if ( ( s_NumIdle > 0 ) && ( s_Stopping == false ) )
+                {
+                    --s_NumIdle;
+                    VERIFY( s_Threads.FindAndErase( self ) );
+                    s_RetiredThreads.Append( self ); // Joined when threads are next started or stopped
+                    return 0;
+                }
+            }
+            s_Semaphore.Wait();
+        }
+    }
+}
+
+// GetNextReady
+//------------------------------------------------------------------------------
+/*static*/ ConnectionInfo * TCPHandlerThreads::GetNextReady()
+{
+    if ( s_ReadyHead == s_Ready.GetSize() )
+    {
+        return nullptr;
+    }
+    ConnectionInfo * ci = s_Ready[ s_ReadyHead++ ];
+    if ( s_ReadyHead == s_Ready.GetSize() )
+    {
+        s_Ready.Clear();
+        s_ReadyHead = 0;
+    }
+    return ci;
+}
+
+// JoinThreads
+//------------------------------------------------------------------------------
+/*static*/ void TCPHandlerThreads::JoinThreads( Array<Thread *> & threads )
+{
+    for ( Thread * thread : threads )
+    {
+        thread->Join();
+        FDELETE thread;
+    }
+    threads.Clear();
+}
+
+// TCPIOThreads - I/O threads shared by all pools in the process
+//  - The Client has a pool per worker, so per-pool threads would multiply
+//  - Started as needed, and stopped once the last pool using them shuts down
+//------------------------------------------------------------------------------
+class TCPIOThreads
+{
+public:
+    static TCPIOThread * AddPoolConnection( TCPConnectionPool * pool );
+    static void RemovePool();
+    static size_t GetNumThreads();
+
+private:
+    static Mutex s_Mutex;
+    static Array<TCPIOThread *> s_Threads;
+    static uint32_t s_NextThread;
+    static uint32_t s_NumPools;
+};
+/*static*/ Mutex TCPIOThreads::s_Mutex;
+/*static*/ Array<TCPIOThread *> TCPIOThreads::s_Threads;
+/*static*/ uint32_t TCPIOThreads::s_NextThread = 0;
+/*static*/ uint32_t TCPIOThreads::s_NumPools = 0;
+
+// AddPoolConnection
+//------------------------------------------------------------------------------
+/*static*/ TCPIOThread * TCPIOThreads::AddPoolConnection( TCPConnectionPool * pool )
+{
+    MutexHolder mh( s_Mutex );
+
+    if ( pool->m_UsingIOThreads == false )
+    {
+        pool->m_UsingIOThreads = true;
+        ++s_NumPools;
+    }
+
+    // Connections get their own thread until the limit is reached, after
+    // which they share the existing threads
+    static const uint32_t maxIOThreads = Math::Clamp( CPUInfo::Get().GetNumUsefulCores() / 2, 2U, kMaxIOThreads );
+    if ( s_Threads.GetSize() < maxIOThreads )
+    {
+        TCPIOThread * ioThread = FNEW( TCPIOThread() );
+        ioThread->m_Thread.Start( &TCPConnectionPool::IOThreadWrapperFunction, "TCPIO", ioThread );
+        s_Threads.Append( ioThread );
+        return ioThread;
+    }
+    return s_Threads[ s_NextThread++ % s_Threads.GetSize() ];
+}
+
+// RemovePool
+//------------------------------------------------------------------------------
+/*static*/ void TCPIOThreads::RemovePool()
+{
+    // The pool's connections are all closed, so its callbacks can no longer
+    // occur. Threads are only stopped when no pools remain.
+    Array<TCPIOThread *> ioThreads;
+    {
+        MutexHolder mh( s_Mutex );
+        ASSERT( s_NumPools > 0 );
+        if ( --s_NumPools > 0 )
+        {
+            return;
+        }
+        ioThreads.Swap( s_Threads );
+        s_NextThread = 0;
+    }
+
+    for ( TCPIOThread * ioThread : ioThreads )
+    {
+        ioThread->m_Quit.Store( true );
+        ioThread->Wake();
+    }
+    for ( TCPIOThread * ioThread : ioThreads )
+    {
+        ioThread->m_Thread.Join();
+        ASSERT( ioThread->m_Connections.IsEmpty() );
+        ASSERT( ioThread->m_NewConnections.IsEmpty() );
+        FDELETE ioThread;
+    }
+
+    // Callbacks can only be scheduled by I/O threads
+    TCPHandlerThreads::StopThreads();
+}
+
+// GetNumThreads
+//------------------------------------------------------------------------------
+/*static*/ size_t TCPIOThreads::GetNumThreads()
+{
+    MutexHolder mh( s_Mutex );
+    return s_Threads.GetSize();
+}
+#endif
+
 // CONSTRUCTOR - ConnectionInfo
 //------------------------------------------------------------------------------
 ConnectionInfo::ConnectionInfo( TCPConnectionPool * ownerPool )
@@ -145,6 +478,9 @@ ConnectionInfo::ConnectionInfo( TCPConnectionPool * ownerPool )
 TCPConnectionPool::TCPConnectionPool()
     : m_ListenConnection( nullptr )
     , m_ShuttingDown( false )
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    , m_UsingIOThreads( false )
+#endif
 {
     m_Connections.SetCapacity( 8 );
 }
@@ -186,7 +522,10 @@ void TCPConnectionPool::ShutdownAllConnections()
         for ( size_t i = 0; i < m_Connections.GetSize(); ++i )
         {
             const ConnectionInfo * const ci = m_Connections[ i ];
-            Disconnect( ci );
+            if ( ci->m_ThreadQuitNotification.Load() == false )
+            {
+                Disconnect( ci );
+            }
         }
 
         m_ConnectionsMutex.Unlock();
@@ -194,6 +533,14 @@ void TCPConnectionPool::ShutdownAllConnections()
         m_ConnectionsMutex.Lock();
     }
     m_ConnectionsMutex.Unlock();
+
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    if ( m_UsingIOThreads )
+    {
+        m_UsingIOThreads = false;
+        TCPIOThreads::RemovePool();
+    }
+#endif
 }
 
 // GetAddressAsString
@@ -243,7 +590,13 @@ bool TCPConnectionPool::Listen( uint16_t port )
 
     // listen
     TCPDEBUG( "Listen on port %i (%x)\n", port, (uint32_t)sockfd );
-    if ( listen( sockfd, 0 ) == SOCKET_ERROR ) // no backlog
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    // many clients may connect at once and are accepted between other events
+    const int backlog = SOMAXCONN;
+#else
+    const int backlog = 0; // no backlog
+#endif
+    if ( listen( sockfd, backlog ) == SOCKET_ERROR )
     {
         TCPDEBUG( "Listen FAILED %i (%x)\n", port, (uint32_t)sockfd );
         CloseSocket( sockfd );
@@ -252,7 +605,12 @@ bool TCPConnectionPool::Listen( uint16_t port )
 
     // spawn the handler thread
     const uint32_t loopback = 127 & ( 1 << 24 ); // 127.0.0.1
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    SetNonBlocking( sockfd );
+    CreateListenConnection( sockfd, loopback, port );
+#else
     CreateListenThread( sockfd, loopback, port );
+#endif
 
     // everything is ok - we are now listening, managing connections on the other thread
     return true;
@@ -322,19 +680,10 @@ const ConnectionInfo * TCPConnectionPool::Connect( uint32_t hostIP, uint16_t por
     // wait for connection
     for ( ;; )
     {
-        fd_set write, err;
-        FD_ZERO( &write );
-        FD_ZERO( &err );
-        FDSet( sockfd, &write );
-        FDSet( sockfd, &err );
-
-        // check connection every 10ms
-        timeval pollingTimeout;
-        memset( &pollingTimeout, 0, sizeof( timeval ) );
-        pollingTimeout.tv_usec = 10 * 1000;
-
-        // check if the socket is ready
-        const int selRet = Select( sockfd + 1, nullptr, &write, &err, &pollingTimeout );
+        // check if the socket is ready (checking connection every 10ms)
+        bool writable = false;
+        bool failed = false;
+        const int selRet = WaitForConnect( sockfd, 10, writable, failed );
         if ( selRet == SOCKET_ERROR )
         {
             // connection failed
@@ -378,7 +727,7 @@ const ConnectionInfo * TCPConnectionPool::Connect( uint32_t hostIP, uint16_t por
             continue;
         }
 
-        if ( FD_ISSET( sockfd, &err ) )
+        if ( failed )
         {
             // connection failed
 #ifdef TCPCONNECTION_DEBUG
@@ -401,7 +750,7 @@ const ConnectionInfo * TCPConnectionPool::Connect( uint32_t hostIP, uint16_t por
             return nullptr;
         }
 
-        if ( FD_ISSET( sockfd, &write ) )
+        if ( writable )
         {
 #if defined( __APPLE__ ) || defined( __LINUX__ )
             // On Linux a write flag set by select() doesn't mean that
@@ -436,7 +785,11 @@ const ConnectionInfo * TCPConnectionPool::Connect( uint32_t hostIP, uint16_t por
         ASSERT( false ); // should never get here
     }
 
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    return CreateConnection( sockfd, hostIP, port, userData );
+#else
     return CreateConnectionThread( sockfd, hostIP, port, userData );
+#endif
 }
 
 // Disconnect
@@ -454,22 +807,21 @@ void TCPConnectionPool::Disconnect( const ConnectionInfo * ci )
     // ensure the connection thread isn't busy destroying itself
     MutexHolder mh( m_ConnectionsMutex );
 
-    if ( ci == m_ListenConnection )
+    if ( ( ci != m_ListenConnection ) && ( m_Connections.Find( ci ) == nullptr ) )
     {
-        ci->m_ThreadQuitNotification.Store( true );
+        // connection is no longer valid.... we handle this gracefully
+        // as the connection might be lost while trying to disconnect
+        // on another thread
         return;
     }
 
-    const ConnectionInfo * const * iter = m_Connections.Find( ci );
-    if ( iter != nullptr )
-    {
-        ci->m_ThreadQuitNotification.Store( true );
-        return;
-    }
+    ci->m_ThreadQuitNotification.Store( true );
 
-    // connection is no longer valid.... we handle this gracefully
-    // as the connection might be lost while trying to disconnect
-    // on another thread
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    // wake the thread servicing the connection so it can be closed
+    ci->m_IOThread->m_DisconnectPending.Store( true );
+    ci->m_IOThread->Wake();
+#endif
 }
 
 // SetShuttingDown
@@ -487,6 +839,15 @@ size_t TCPConnectionPool::GetNumConnections() const
     return m_Connections.GetSize();
 }
 
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+// GetNumIOThreads
+//------------------------------------------------------------------------------
+/*static*/ size_t TCPConnectionPool::GetNumIOThreads()
+{
+    return TCPIOThreads::GetNumThreads();
+}
+#endif
+
 // Send
 //------------------------------------------------------------------------------
 bool TCPConnectionPool::Send( const ConnectionInfo * connection, const void * data, size_t size, uint32_t timeoutMS )
@@ -545,12 +906,15 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
         return false;
     }
 
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    return SendNonBlocking( connection, buffers, numBuffers, timeoutMS );
+#else
     ASSERT( numBuffers <= 4 ); // Worst case = size + data + payloadSize + payload
-#if defined( __WINDOWS__ )
+    #if defined( __WINDOWS__ )
     WSABUF sendBuffers[ 4 ];
-#else
+    #else
     struct iovec sendBuffers[ 4 ];
-#endif
+    #endif
 
     // Calculate total to send
     uint32_t totalBytes( 0 );
@@ -561,10 +925,10 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
 
     const Timer timer;
 
-#if defined( ASSERTS_ENABLED )
+    #if defined( ASSERTS_ENABLED )
     ASSERT( connection->m_SendSocketInUseThreadId == INVALID_THREAD_ID );
     connection->m_SendSocketInUseThreadId = Thread::GetCurrentThreadId();
-#endif
+    #endif
 
     ASSERT( connection->m_Socket != INVALID_SOCKET );
 
@@ -586,13 +950,13 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
             {
                 // add remaining data for this buffer
                 const uint32_t remainder = ( buffers[ i ].size - overlap );
-#if defined( __WINDOWS__ )
+    #if defined( __WINDOWS__ )
                 sendBuffers[ numSendBuffers ].len = remainder;
                 sendBuffers[ numSendBuffers ].buf = const_cast<CHAR *>( (const char *)buffers[ i ].data + buffers[ i ].size - remainder );
-#else
+    #else
                 sendBuffers[ numSendBuffers ].iov_len = remainder;
                 sendBuffers[ numSendBuffers ].iov_base = const_cast<char *>( (const char *)buffers[ i ].data + buffers[ i ].size - remainder );
-#endif
+    #endif
                 ++numSendBuffers;
             }
             offset += buffers[ i ].size;
@@ -601,14 +965,14 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
         ASSERT( numSendBuffers > 0 ); // shouldn't be in loop if there was no data to send!
 
         // Try send
-#if defined( __WINDOWS__ )
+    #if defined( __WINDOWS__ )
         uint32_t sent( 0 );
         const int result = WSASend( connection->m_Socket, sendBuffers, numSendBuffers, (LPDWORD)&sent, 0, nullptr, nullptr );
         if ( result == SOCKET_ERROR )
-#else
+    #else
         ssize_t sent = writev( connection->m_Socket, sendBuffers, static_cast<int32_t>( numSendBuffers ) );
         if ( sent <= 0 )
-#endif
+    #endif
         {
             if ( WouldBlock() )
             {
@@ -637,10 +1001,11 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
         bytesSent += sent;
     }
 
-#if defined( ASSERTS_ENABLED )
+    #if defined( ASSERTS_ENABLED )
     connection->m_SendSocketInUseThreadId = INVALID_THREAD_ID;
-#endif
+    #endif
     return sendOK;
+#endif
 }
 
 // Broadcast
@@ -809,6 +1174,39 @@ int TCPConnectionPool::Select( TCPSocket socket,
                    a_TimeOut );
 }
 
+// WaitForConnect
+//------------------------------------------------------------------------------
+int TCPConnectionPool::WaitForConnect( TCPSocket socket, uint32_t timeoutMS, bool & outWritable, bool & outError ) const
+{
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    // poll() has no limit on socket values (unlike select() with FD_SETSIZE)
+    // Failures are detected via SO_ERROR once the socket is writable
+    struct pollfd pfd;
+    pfd.fd = socket;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    const int ret = poll( &pfd, 1, static_cast<int>( timeoutMS ) );
+    outWritable = ( ret > 0 ) && ( ( pfd.revents & ( POLLOUT | POLLERR | POLLHUP ) ) != 0 );
+    outError = false;
+    return ret;
+#else
+    fd_set write, err;
+    FD_ZERO( &write );
+    FD_ZERO( &err );
+    FDSet( socket, &write );
+    FDSet( socket, &err );
+
+    timeval pollingTimeout;
+    memset( &pollingTimeout, 0, sizeof( timeval ) );
+    pollingTimeout.tv_usec = static_cast<int32_t>( timeoutMS * 1000 );
+
+    const int ret = Select( socket + 1, nullptr, &write, &err, &pollingTimeout );
+    outWritable = ( ret > 0 ) && FD_ISSET( socket, &write );
+    outError = ( ret > 0 ) && FD_ISSET( socket, &err );
+    return ret;
+#endif
+}
+
 // Accept
 //------------------------------------------------------------------------------
 TCPSocket TCPConnectionPool::Accept( TCPSocket socket,
@@ -1141,6 +1539,611 @@ void TCPConnectionPool::ConnectionThreadFunction( ConnectionInfo * ci )
     TCPDEBUG( "connection thread exited\n" );
 }
 
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+// CreateListenConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::CreateListenConnection( TCPSocket socket, uint32_t host, uint16_t port )
+{
+    MutexHolder mh( m_ConnectionsMutex );
+
+    m_ListenConnection = FNEW( ConnectionInfo( this ) );
+    m_ListenConnection->m_Socket = socket;
+    m_ListenConnection->m_RemoteAddress = host;
+    m_ListenConnection->m_RemotePort = port;
+    m_ListenConnection->m_ThreadQuitNotification.Store( false );
+    m_ListenConnection->m_Listening = true;
+
+    AddToIOThread( m_ListenConnection );
+}
+
+// CreateConnection
+//------------------------------------------------------------------------------
+ConnectionInfo * TCPConnectionPool::CreateConnection( TCPSocket socket, uint32_t host, uint16_t port, void * userData )
+{
+    MutexHolder mh( m_ConnectionsMutex );
+
+    ConnectionInfo * ci = FNEW( ConnectionInfo( this ) );
+    ci->m_Socket = socket;
+    ci->m_RemoteAddress = host;
+    ci->m_RemotePort = port;
+    ci->m_ThreadQuitNotification.Store( false );
+    ci->m_UserData = userData;
+
+    #ifdef TCPCONNECTION_DEBUG
+    AStackString<32> addr;
+    GetAddressAsString( ci->m_RemoteAddress, addr );
+    TCPDEBUG( "Connected to %s : %i (%x)\n", addr.Get(), port, (uint32_t)socket );
+    #endif
+
+    m_Connections.Append( ci );
+
+    AddToIOThread( ci );
+
+    return ci;
+}
+
+// AddToIOThread
+//------------------------------------------------------------------------------
+void TCPConnectionPool::AddToIOThread( ConnectionInfo * ci )
+{
+    TCPIOThread * ioThread = TCPIOThreads::AddPoolConnection( this );
+    ci->m_IOThread = ioThread;
+
+    // The I/O thread takes ownership of new connections before handling any
+    // events, so it must be able to see the connection before it is registered
+    {
+        MutexHolder mh( ioThread->m_NewConnectionsMutex );
+        ioThread->m_NewConnections.Append( ci );
+    }
+
+    // Register for (edge triggered) events
+    struct epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events = ci->m_Listening ? ( EPOLLIN | EPOLLET )
+                                   : ( EPOLLIN | EPOLLRDHUP | EPOLLET );
+    event.data.ptr = ci;
+    if ( epoll_ctl( ioThread->m_EPollFD, EPOLL_CTL_ADD, ci->m_Socket, &event ) != 0 )
+    {
+        TCPDEBUG( "epoll_ctl() failed. Error: %s (Socket: %x)\n", LAST_NETWORK_ERROR_STR, (uint32_t)( ci->m_Socket ) );
+        ci->m_ThreadQuitNotification.Store( true ); // I/O thread will close it
+        ioThread->m_DisconnectPending.Store( true );
+    }
+
+    ioThread->Wake();
+}
+
+// IOThreadWrapperFunction
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TCPConnectionPool::IOThreadWrapperFunction( void * data )
+{
+    TCP_CONNECTION_POOL_PROFILE_SET_THREAD_NAME( TCPConnectionPoolProfileHelper::THREAD_CONNECTION );
+    PROFILE_FUNCTION;
+
+    IOThreadFunction( static_cast<TCPIOThread *>( data ) );
+    return 0;
+}
+
+// IOThreadFunction
+//------------------------------------------------------------------------------
+/*static*/ void TCPConnectionPool::IOThreadFunction( TCPIOThread * ioThread )
+{
+    struct epoll_event events[ kMaxIOEvents ];
+    Array<ConnectionInfo *> newConnections;
+    Array<ConnectionInfo *> connectionsToClose;
+
+    while ( ioThread->m_Quit.Load() == false )
+    {
+        const int num = epoll_wait( ioThread->m_EPollFD, events, kMaxIOEvents, 100 );
+
+        // Take ownership of new connections
+        {
+            MutexHolder mh( ioThread->m_NewConnectionsMutex );
+            newConnections.Swap( ioThread->m_NewConnections );
+        }
+        for ( ConnectionInfo * ci : newConnections )
+        {
+            ci->m_IOThreadIndex = static_cast<uint32_t>( ioThread->m_Connections.GetSize() );
+            ioThread->m_Connections.Append( ci );
+            if ( ci->m_Listening == false )
+            {
+                MutexHolder mh( ci->m_HandlerMutex );
+                ci->m_ConnectedPending = true; // Do callback
+                TCPHandlerThreads::Schedule( ci );
+            }
+
+            // Disconnect() may have been called before we took ownership, in
+            // which case the connection was missed when handling it
+            if ( ci->m_ThreadQuitNotification.Load() )
+            {
+                ci->m_Closing = true;
+                connectionsToClose.Append( ci );
+            }
+        }
+        newConnections.Clear();
+
+        // Handle socket events
+        for ( int i = 0; i < num; ++i )
+        {
+            ConnectionInfo * ci = static_cast<ConnectionInfo *>( events[ i ].data.ptr );
+            if ( ci == nullptr )
+            {
+                // Woken by another thread
+                uint64_t value;
+                const ssize_t ret = read( ioThread->m_WakeFD, &value, sizeof( value ) );
+                (void)ret;
+                continue;
+            }
+
+            if ( ci->m_Closing || ci->m_ThreadQuitNotification.Load() )
+            {
+                continue; // don't bother handling events if closing
+            }
+
+            TCPConnectionPool * pool = ci->m_TCPConnectionPool;
+            bool ok;
+            if ( ci->m_Listening )
+            {
+                ok = pool->HandleAccept( ci );
+            }
+            else
+            {
+                ok = pool->HandleReadNonBlocking( ci );
+            }
+            if ( ok == false )
+            {
+                ci->m_Closing = true;
+                connectionsToClose.Append( ci );
+            }
+        }
+
+        // Read data which arrived while reading was paused (events are edge
+        // triggered, so there won't be another event for it)
+        for ( size_t i = 0; i < ioThread->m_PausedConnections.GetSize(); )
+        {
+            ConnectionInfo * ci = ioThread->m_PausedConnections[ i ];
+            if ( ci->m_ReadPaused.Load() )
+            {
+                ++i;
+                continue;
+            }
+            ioThread->m_PausedConnections.EraseIndex( i );
+            ci->m_OnPausedList = false;
+            if ( ( ci->m_Closing == false ) && ( ci->m_TCPConnectionPool->HandleReadNonBlocking( ci ) == false ) )
+            {
+                ci->m_Closing = true;
+                connectionsToClose.Append( ci );
+            }
+        }
+
+        // Close connections flagged by Disconnect()
+        if ( ioThread->m_DisconnectPending.Load() )
+        {
+            ioThread->m_DisconnectPending.Store( false );
+            for ( ConnectionInfo * ci : ioThread->m_Connections )
+            {
+                if ( ( ci->m_Closing == false ) && ci->m_ThreadQuitNotification.Load() )
+                {
+                    ci->m_Closing = true;
+                    connectionsToClose.Append( ci );
+                }
+            }
+        }
+
+        // Closing is deferred until all events are handled, as events
+        // can refer to any connection
+        for ( ConnectionInfo * ci : connectionsToClose )
+        {
+            ci->m_TCPConnectionPool->CloseConnection( ioThread, ci );
+        }
+        connectionsToClose.Clear();
+    }
+
+    TCPDEBUG( "I/O thread exited\n" );
+}
+
+// HandleAccept
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::HandleAccept( ConnectionInfo * ci )
+{
+    ASSERT( ci->m_Socket != INVALID_SOCKET );
+
+    // Accept all pending connections (events are edge triggered)
+    while ( ci->m_ThreadQuitNotification.Load() == false )
+    {
+        struct sockaddr_in remoteAddrInfo;
+        int remoteAddrInfoSize = sizeof( remoteAddrInfo );
+
+        // get a socket for the new connection
+        const TCPSocket newSocket = Accept( ci->m_Socket, (struct sockaddr *)&remoteAddrInfo, &remoteAddrInfoSize );
+        if ( newSocket == INVALID_SOCKET )
+        {
+            if ( WouldBlock() )
+            {
+                return true; // no more pending connections
+            }
+            if ( ( errno == EINTR ) || ( errno == ECONNABORTED ) )
+            {
+                continue;
+            }
+            TCPDEBUG( "accept() failed. Error: %s\n", LAST_NETWORK_ERROR_STR );
+            return false;
+        }
+
+        #ifdef TCPCONNECTION_DEBUG
+        AStackString<32> addr;
+        GetAddressAsString( remoteAddrInfo.sin_addr.s_addr, addr );
+        TCPDEBUG( "Connection accepted from %s : %i (%x)\n", addr.Get(), ntohs( remoteAddrInfo.sin_port ), (uint32_t)newSocket );
+        #endif
+
+        // Configure socket
+        DisableSigPipe( newSocket );        // Prevent socket inheritence by child processes
+        DisableNagle( newSocket );          // Disable Nagle's algorithm
+        SetLargeBufferSizes( newSocket );   // Set send/recv buffer sizes
+        SetNonBlocking( newSocket );        // Set non-blocking
+
+        // keep the new connected socket
+        CreateConnection( newSocket,
+                          remoteAddrInfo.sin_addr.s_addr,
+                          ntohs( remoteAddrInfo.sin_port ) );
+    }
+    return true;
+}
+
+// HandleReadNonBlocking
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::HandleReadNonBlocking( ConnectionInfo * ci )
+{
+    PROFILE_FUNCTION;
+
+    // Leave data in the socket while handlers catch up
+    if ( ci->m_ReadPaused.Load() )
+    {
+        return true;
+    }
+
+    // Read until no more data is available (events are edge triggered),
+    // resuming any partially received message
+    while ( ci->m_ThreadQuitNotification.Load() == false )
+    {
+        // Read into size or message as appropriate
+        const bool readingSize = ( ci->m_RecvSizeBytes < sizeof( uint32_t ) );
+        char * dest;
+        uint32_t bytesToRead;
+        if ( readingSize )
+        {
+            dest = reinterpret_cast<char *>( &ci->m_RecvSize ) + ci->m_RecvSizeBytes;
+            bytesToRead = ( sizeof( uint32_t ) - ci->m_RecvSizeBytes );
+        }
+        else
+        {
+            dest = static_cast<char *>( ci->m_RecvBuffer ) + ci->m_RecvBytes;
+            bytesToRead = ( ci->m_RecvSize - ci->m_RecvBytes );
+        }
+
+        if ( bytesToRead > 0 )
+        {
+            const ssize_t numBytes = recv( ci->m_Socket, dest, bytesToRead, 0 );
+            if ( numBytes <= 0 )
+            {
+                if ( numBytes < 0 )
+                {
+                    if ( errno == EINTR )
+                    {
+                        continue;
+                    }
+                    if ( WouldBlock() )
+                    {
+                        return true; // wait for more data
+                    }
+                }
+                TCPDEBUG( "recv() failed. Error: %s (Read: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, (int)numBytes, (uint32_t)( ci->m_Socket ) );
+                return false;
+            }
+
+            if ( readingSize )
+            {
+                ci->m_RecvSizeBytes += static_cast<uint32_t>( numBytes );
+                if ( ci->m_RecvSizeBytes < sizeof( uint32_t ) )
+                {
+                    continue;
+                }
+
+                TCPDEBUG( "Handle read: %i (%x)\n", ci->m_RecvSize, (uint32_t)( ci->m_Socket ) );
+
+                // get output location
+                ci->m_RecvBuffer = AllocBuffer( ci->m_RecvSize );
+                ASSERT( ci->m_RecvBuffer );
+                ci->m_RecvBytes = 0;
+                continue;
+            }
+
+            ci->m_RecvBytes += static_cast<uint32_t>( numBytes );
+            if ( ci->m_RecvBytes < ci->m_RecvSize )
+            {
+                continue;
+            }
+        }
+
+        // Message is complete
+        void * buffer = ci->m_RecvBuffer;
+        const uint32_t size = ci->m_RecvSize;
+        ci->m_RecvBuffer = nullptr;
+        ci->m_RecvSizeBytes = 0;
+        ci->m_RecvBytes = 0;
+
+        // hand the message off, to tell user the data is in their buffer
+        bool pause;
+        {
+            MutexHolder mh( ci->m_HandlerMutex );
+            ConnectionInfo::ReceivedMessage message;
+            message.m_Data = buffer;
+            message.m_Size = size;
+            ci->m_Received.Append( message );
+            ci->m_ReceivedSize += size;
+            TCPHandlerThreads::Schedule( ci );
+
+            pause = ( ci->m_ReceivedSize > kMaxPendingReceiveBytes );
+            if ( pause )
+            {
+                ci->m_ReadPaused.Store( true );
+            }
+        }
+        if ( pause )
+        {
+            // Handler will wake us once it has caught up
+            if ( ci->m_OnPausedList == false )
+            {
+                ci->m_OnPausedList = true;
+                ci->m_IOThread->m_PausedConnections.Append( ci );
+            }
+            return true;
+        }
+    }
+    return true;
+}
+
+// CloseConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::CloseConnection( TCPIOThread * ioThread, ConnectionInfo * ci )
+{
+    ASSERT( ci->m_Closing );
+
+    // stop receiving events
+    epoll_ctl( ioThread->m_EPollFD, EPOLL_CTL_DEL, ci->m_Socket, nullptr );
+
+    // remove from I/O thread
+    ConnectionInfo * last = ioThread->m_Connections.Top();
+    ioThread->m_Connections[ ci->m_IOThreadIndex ] = last;
+    last->m_IOThreadIndex = ci->m_IOThreadIndex;
+    ioThread->m_Connections.Pop();
+    if ( ci->m_OnPausedList )
+    {
+        ioThread->m_PausedConnections.Erase( ioThread->m_PausedConnections.Find( ci ) );
+        ci->m_OnPausedList = false;
+    }
+
+    if ( ci->m_Listening )
+    {
+        // close the socket
+        CloseSocket( ci->m_Socket );
+        ci->m_Socket = INVALID_SOCKET;
+
+        MutexHolder mh( m_ConnectionsMutex );
+        ASSERT( m_ListenConnection == ci );
+        m_ListenConnection = nullptr;
+        FDELETE ci;
+        m_ShutdownSemaphore.Signal(); // Wake main thread which may be waiting on shutdown
+        return;
+    }
+
+    // senders on other threads should give up
+    ci->m_ThreadQuitNotification.Store( true );
+
+    // The rest happens on a handler thread, after any messages already received
+    // have been handled (see FinishCloseConnection)
+    MutexHolder mh( ci->m_HandlerMutex );
+    ci->m_ClosePending = true;
+    TCPHandlerThreads::Schedule( ci );
+}
+
+// SendNonBlocking
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::SendNonBlocking( const ConnectionInfo * connection, const SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( numBuffers <= 4 ); // Worst case = size + data + payloadSize + payload
+    ASSERT( connection->m_Socket != INVALID_SOCKET );
+
+    // Calculate total to send
+    uint32_t totalBytes( 0 );
+    for ( uint32_t i = 0; i < numBuffers; ++i )
+    {
+        totalBytes += buffers[ i ].size;
+    }
+
+    TCPDEBUG( "Send: %i (%x)\n", totalBytes, (uint32_t)( connection->m_Socket ) );
+
+    #if defined( ASSERTS_ENABLED )
+    ASSERT( connection->m_SendSocketInUseThreadId == INVALID_THREAD_ID );
+    connection->m_SendSocketInUseThreadId = Thread::GetCurrentThreadId();
+    #endif
+
+    bool sendOK = true;
+    {
+        // Messages from different threads must not be interleaved. Data is sent
+        // straight from the caller's buffers, so nothing is held in memory for
+        // a slow receiver beyond what the caller already owns.
+        MutexHolder mh( connection->m_SendMutex );
+
+        const Timer timer;
+
+        // Repeat until all bytes sent
+        uint32_t bytesSent = 0;
+        while ( bytesSent < totalBytes )
+        {
+            // Fill buffers for any unsent data
+            struct iovec sendBuffers[ 4 ];
+            int numSendBuffers = 0;
+            uint32_t offset = 0;
+            for ( uint32_t i = 0; i < numBuffers; ++i )
+            {
+                const uint32_t overlap = bytesSent > offset ? ( bytesSent - offset ) : 0;
+                if ( overlap < buffers[ i ].size )
+                {
+                    sendBuffers[ numSendBuffers ].iov_base = const_cast<char *>( (const char *)buffers[ i ].data + overlap );
+                    sendBuffers[ numSendBuffers ].iov_len = ( buffers[ i ].size - overlap );
+                    ++numSendBuffers;
+                }
+                offset += buffers[ i ].size;
+            }
+
+            const ssize_t sent = writev( connection->m_Socket, sendBuffers, numSendBuffers );
+            if ( sent >= 0 )
+            {
+                bytesSent += static_cast<uint32_t>( sent );
+                continue;
+            }
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            if ( WouldBlock() == false )
+            {
+                TCPDEBUG( "send() failed (A). Error: %s (Socket: %x)\n", LAST_NETWORK_ERROR_STR, (uint32_t)( connection->m_Socket ) );
+                sendOK = false;
+                break;
+            }
+
+            if ( connection->m_ThreadQuitNotification.Load() || AtomicLoadRelaxed( &m_ShuttingDown ) )
+            {
+                sendOK = false;
+                break;
+            }
+
+            if ( timer.GetElapsedMS() > (float)timeoutMS )
+            {
+                sendOK = false;
+                break;
+            }
+
+            // wait for the socket to become writable
+            struct pollfd pfd;
+            pfd.fd = connection->m_Socket;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            poll( &pfd, 1, 10 );
+        }
+    }
+
+    #if defined( ASSERTS_ENABLED )
+    connection->m_SendSocketInUseThreadId = INVALID_THREAD_ID;
+    #endif
+
+    if ( sendOK == false )
+    {
+        // Failed or timed out (harmless if already disconnecting)
+        Disconnect( connection );
+    }
+    return sendOK;
+}
+
+// HandleEvents
+//------------------------------------------------------------------------------
+/*static*/ void TCPConnectionPool::HandleEvents( ConnectionInfo * ci )
+{
+    PROFILE_FUNCTION;
+
+    TCPConnectionPool * pool = ci->m_TCPConnectionPool;
+
+    // Handle events until none remain, in the order they occurred
+    Array<ConnectionInfo::ReceivedMessage> received;
+    for ( ;; )
+    {
+        bool connected;
+        bool close;
+        {
+            MutexHolder mh( ci->m_HandlerMutex );
+            connected = ci->m_ConnectedPending;
+            close = ci->m_ClosePending;
+            if ( ( connected == false ) && ( close == false ) && ci->m_Received.IsEmpty() )
+            {
+                ci->m_HandlerScheduled = false; // I/O thread will schedule it again
+                return;
+            }
+            ci->m_ConnectedPending = false;
+            received.Swap( ci->m_Received );
+        }
+
+        if ( connected )
+        {
+            pool->OnConnected( ci ); // Do callback
+        }
+
+        // tell user the data is in their buffer
+        uint64_t handledSize = 0;
+        for ( const ConnectionInfo::ReceivedMessage & message : received )
+        {
+            bool keepMemory = false;
+            pool->OnReceive( ci, message.m_Data, message.m_Size, keepMemory ); // Do callback
+            if ( !keepMemory )
+            {
+                pool->FreeBuffer( message.m_Data );
+            }
+            handledSize += message.m_Size;
+        }
+        received.Clear();
+
+        // Close is always the last event
+        if ( close )
+        {
+            pool->FinishCloseConnection( ci );
+            return;
+        }
+
+        // Resume reading once enough has been handled
+        MutexHolder mh( ci->m_HandlerMutex );
+        ci->m_ReceivedSize -= handledSize;
+        if ( ci->m_ReadPaused.Load() && ( ci->m_ReceivedSize <= ( kMaxPendingReceiveBytes / 2 ) ) )
+        {
+            ci->m_ReadPaused.Store( false );
+            ci->m_IOThread->Wake();
+        }
+    }
+}
+
+// FinishCloseConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::FinishCloseConnection( ConnectionInfo * ci )
+{
+    OnDisconnected( ci ); // Do callback
+
+    if ( ci->m_RecvBuffer )
+    {
+        FreeBuffer( ci->m_RecvBuffer );
+    }
+
+    // close the socket (once any sender has given up)
+    {
+        MutexHolder mh( ci->m_SendMutex );
+        CloseSocket( ci->m_Socket );
+        ci->m_Socket = INVALID_SOCKET;
+    }
+
+    {
+        MutexHolder mh( m_ConnectionsMutex );
+        ConnectionInfo ** iter = m_Connections.Find( ci );
+        ASSERT( iter );
+        m_Connections.Erase( iter );
+        FDELETE ci;
+        if ( AtomicLoadRelaxed( &m_ShuttingDown ) )
+        {
+            m_ShutdownSemaphore.Signal(); // Wake main thread which will be waiting on shutdown
+        }
+    }
+}
+#endif
+
 // AllowSocketReuse
 //------------------------------------------------------------------------------
 void TCPConnectionPool::AllowSocketReuse( TCPSocket socket ) const
@@ -14,9 +14,22 @@
 #include "Core/Process/Thread.h"
 #include "Core/Strings/AString.h"
 
+// Defines
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ )
+    // Service connections with an event loop on a small fixed pool of threads,
+    // instead of a thread per connection
+    #define TCPCONNECTIONPOOL_USE_EPOLL
+#endif
+
 // Forward Declarations
 //------------------------------------------------------------------------------
 class TCPConnectionPool;
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+class TCPHandlerThreads;
+class TCPIOThread;
+class TCPIOThreads;
+#endif
 
 #if defined( __WINDOWS__ )
 typedef uintptr_t TCPSocket;
@@ -30,6 +43,9 @@ namespace
 {
     static const uint32_t kDefaultConnectionTimeoutMS = ( 2 * 1000 );
     static const uint32_t kDefaultSendTimeoutMS = ( 10 * 60 * 1000 );
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    static const uint32_t kMaxIOThreads = 8; // Shared by all pools
+#endif
 }
 
 // ConnectionInfo - one connection in the pool
@@ -49,6 +65,9 @@ public:
 
 private:
     friend class TCPConnectionPool;
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    friend class TCPHandlerThreads;
+#endif
 
     TCPSocket m_Socket;
     uint32_t m_RemoteAddress;
@@ -61,6 +80,39 @@ private:
     // sanity check we aren't sending from multiple threads unsafely
     mutable Thread::ThreadId m_SendSocketInUseThreadId = INVALID_THREAD_ID;
 #endif
+
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    // I/O thread servicing this connection (set once on creation)
+    TCPIOThread * m_IOThread = nullptr;
+    uint32_t m_IOThreadIndex = 0; // Index in I/O thread's list of connections
+    bool m_Listening = false; // Listen socket, accepting new connections
+    bool m_Closing = false;
+
+    // Partially received message
+    uint32_t m_RecvSize = 0;
+    uint32_t m_RecvSizeBytes = 0; // Bytes of m_RecvSize received so far
+    uint32_t m_RecvBytes = 0;
+    void * m_RecvBuffer = nullptr;
+
+    bool m_OnPausedList = false; // In I/O thread's list of paused connections
+
+    // Senders write directly from their own buffers, one at a time
+    mutable Mutex m_SendMutex;
+
+    // Events waiting for a handler thread (see TCPHandlerThreads)
+    struct ReceivedMessage
+    {
+        void * m_Data;
+        uint32_t m_Size;
+    };
+    Mutex m_HandlerMutex;
+    Array<ReceivedMessage> m_Received;
+    uint64_t m_ReceivedSize = 0; // Bytes received but not yet handled
+    bool m_ConnectedPending = false;
+    bool m_ClosePending = false;
+    bool m_HandlerScheduled = false; // Waiting for, or owned by, a handler thread
+    Atomic<bool> m_ReadPaused; // Too much received data is waiting to be handled
+#endif
 };
 
 // TCPConnectionPool
@@ -90,6 +142,9 @@ public:
 
     // query connection state
     size_t GetNumConnections() const;
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    static size_t GetNumIOThreads(); // Over all pools
+#endif
 
     // transmit data
     bool Send( const ConnectionInfo * connection,
@@ -144,6 +199,26 @@ private:
     };
     bool SendInternal( const ConnectionInfo * connection, const SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS );
 
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    // event loop management (on I/O threads shared by all pools - see TCPIOThreads)
+    friend class TCPHandlerThreads;
+    friend class TCPIOThreads;
+    void CreateListenConnection( TCPSocket socket, uint32_t host, uint16_t port );
+    ConnectionInfo * CreateConnection( TCPSocket socket, uint32_t host, uint16_t port, void * userData = nullptr );
+    void AddToIOThread( ConnectionInfo * ci );
+    static uint32_t IOThreadWrapperFunction( void * data );
+    static void IOThreadFunction( TCPIOThread * ioThread );
+    bool HandleAccept( ConnectionInfo * ci );
+    bool HandleReadNonBlocking( ConnectionInfo * ci );
+    void CloseConnection( TCPIOThread * ioThread, ConnectionInfo * ci );
+    bool SendNonBlocking( const ConnectionInfo * connection, const SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS );
+
+    // callbacks (on handler threads - see TCPHandlerThreads)
+    static void HandleEvents( ConnectionInfo * ci );
+    void FinishCloseConnection( ConnectionInfo * ci );
+#endif
+    int WaitForConnect( TCPSocket socket, uint32_t timeoutMS, bool & outWritable, bool & outError ) const;
+
     // thread management
     void CreateListenThread( TCPSocket socket, uint32_t host, uint16_t port );
     static uint32_t ListenThreadWrapperFunction( void * data );
@@ -169,6 +244,11 @@ private:
     bool m_ShuttingDown;
     Semaphore m_ShutdownSemaphore;
 
+#if defined( TCPCONNECTIONPOOL_USE_EPOLL )
+    // Connections have been added to the shared I/O threads
+    bool m_UsingIOThreads;
+#endif
+
     // object to manage network subsystem lifetime
 protected:
     NetworkStartupHelper m_EnsureNetworkStarted;
@@ -32,6 +32,7 @@ private:
 #elif defined( __LINUX__ ) || defined( __APPLE__ )
     int m_MapFile;
     size_t m_Length;
+    bool m_Created; // Only the creator removes the name
     AString m_Name;
 #else
     #error Unknown Platform
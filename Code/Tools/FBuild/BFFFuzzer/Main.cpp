@@ -63,7 +63,7 @@ extern "C" int LLVMFuzzerTestOneInput( const uint8_t * data, size_t size )
     // But we need to reset some of its state so it wont leak between different runs.
     env.fbuild.ResetState();
 
-    NodeGraph ng( 8 ); // Use smaller hash table to speed up fuzzing.
+    NodeGraph ng; // Node map starts empty and grows as needed, so is cheap to create
     BFFParser p( ng );
     p.ParseFromString( "fuzz.bff", str.Get() );
 
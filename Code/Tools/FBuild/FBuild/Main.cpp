@@ -7,6 +7,7 @@
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
 #include "Tools/FBuild/FBuildCore/Helpers/CtrlCHandler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FileWatcher.h"
 
 #include "Core/Process/Process.h"
 #include "Core/Process/SharedMemory.h"
@@ -36,6 +37,7 @@ enum ReturnCodes
     FBUILD_WRAPPER_CRASHED = -7,
     FBUILD_FAILED_TO_WSL_WRAPPER = -8,
     FBUILD_FAILED_TO_WRITE_PROFILE_JSON = -9,
+    FBUILD_FAILED_TO_START_FILEWATCHER = -10,
 };
 
 // Headers
@@ -43,6 +45,7 @@ enum ReturnCodes
 int WrapperMainProcess( const AString & args, const FBuildOptions & options, SystemMutex & finalProcess );
 int WrapperIntermediateProcess( const FBuildOptions & options );
 int32_t WrapperModeForWSL( const FBuildOptions & options );
+int FileWatcherMode( const FBuildOptions & options );
 int Main( int argc, char * argv[] );
 
 // Misc
@@ -104,6 +107,12 @@ int Main( int argc, char * argv[] )
     VERIFY( setvbuf( stdout, nullptr, _IONBF, 0 ) == 0 );
     VERIFY( setvbuf( stderr, nullptr, _IONBF, 0 ) == 0 );
 
+    // FileWatcher runs alongside builds, so is not subject to the single instance lock
+    if ( options.m_RunFileWatcher )
+    {
+        return FileWatcherMode( options );
+    }
+
     // ensure only one FASTBuild instance is running at a time
     SystemMutex mainProcess( options.GetMainProcessMutexName().Get() );
 
@@ -356,4 +365,28 @@ int32_t WrapperModeForWSL( const FBuildOptions & options )
     return p.WaitForExit();
 }
 
+// FileWatcherMode
+//------------------------------------------------------------------------------
+int FileWatcherMode( const FBuildOptions & options )
+{
+    // Serve the same DB a build with these options would use
+    AStackString dbFile;
+    FBuild::GetDependencyGraphFileName( options, dbFile );
+    AStackString instanceName;
+    FileWatcher::GetInstanceName( options.GetWorkingDir(), dbFile, instanceName );
+
+    FileWatcher watcher;
+    if ( watcher.Init( instanceName ) == false )
+    {
+        return FBUILD_FAILED_TO_START_FILEWATCHER;
+    }
+
+    // Run until Ctrl-C
+    while ( FBuild::GetStopBuild() == false )
+    {
+        watcher.Update( 500 );
+    }
+    return FBUILD_OK;
+}
+
 //------------------------------------------------------------------------------
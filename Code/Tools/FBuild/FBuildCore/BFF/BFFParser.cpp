@@ -277,9 +277,14 @@ bool BFFParser::ParseNamedVariableDeclaration( BFFTokenRange & iter )
 
     // check if points to a previous declaration in a parent scope
     const BFFVariable * parentVar = nullptr;
-    BFFStackFrame * frame = ( parentScope )
-                                ? BFFStackFrame::GetParentDeclaration( varName, nullptr, parentVar )
-                                : nullptr;
+    BFFStackFrame * frame = nullptr;
+    if ( parentScope )
+    {
+        // Use hash from tokenizer if name was known then
+        const uint32_t varNameHash = varToken->GetVariableNameHash() ? varToken->GetVariableNameHash()
+                                                                      : BFFVariable::CalcNameHash( varName );
+        frame = BFFStackFrame::GetParentDeclaration( varName, varNameHash, nullptr, parentVar );
+    }
 
     if ( parentScope )
     {
@@ -1213,7 +1218,8 @@ bool BFFParser::StoreVariableStruct( const AString & name,
     }
 
     // get variables defined in the scope
-    Array<BFFVariable *> & structMembers = stackFrame.GetLocalVariables();
+    Array<BFFVariable *> structMembers;
+    stackFrame.TakeLocalVariables( structMembers );
 
     // Register this variable
     BFFStackFrame::SetVarStruct( name, *operatorToken, Move( structMembers ), frame ? frame : stackFrame.GetParent() );
@@ -1332,6 +1338,17 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, const BFFToken
         if ( ( dstType == BFFVariable::VAR_ARRAY_OF_STRINGS || dstIsEmpty ) &&
              ( srcType == BFFVariable::VAR_STRING ) )
         {
+            // Append in place if possible
+            if ( concat && !dstIsEmpty )
+            {
+                StackArray<AString> newValues;
+                newValues.Append( varSrc->GetString() );
+                if ( BFFStackFrame::AppendVarArrayOfStrings( dstName, newValues, dstFrame ) )
+                {
+                    return true;
+                }
+            }
+
             StackArray<AString> values;
             values.SetCapacity( varDst->GetArrayOfStrings().GetSize() + 1 );
             if ( concat )
@@ -1423,14 +1440,14 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, const BFFToken
         // ArrayOfStrings to empty array, assignment or concatenation
         if ( dstIsEmpty && srcType == BFFVariable::VAR_ARRAY_OF_STRINGS && !subtract )
         {
-            BFFStackFrame::SetVarArrayOfStrings( dstName, varSrc->GetToken(), varSrc->GetArrayOfStrings(), dstFrame );
+            BFFStackFrame::SetVar( varSrc, varSrc->GetToken(), dstName, dstFrame );
             return true;
         }
 
         // ArrayOfStructs to empty array, assignment or concatenation
         if ( dstIsEmpty && srcType == BFFVariable::VAR_ARRAY_OF_STRUCTS && !subtract )
         {
-            BFFStackFrame::SetVarArrayOfStructs( dstName, varSrc->GetToken(), varSrc->GetArrayOfStructs(), dstFrame );
+            BFFStackFrame::SetVar( varSrc, varSrc->GetToken(), dstName, dstFrame );
             return true;
         }
     }
@@ -1442,9 +1459,13 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, const BFFToken
         {
             if ( concat )
             {
-                AStackString<2048> finalValue( varDst->GetString() );
-                finalValue += varSrc->GetString();
-                BFFStackFrame::SetVarString( dstName, varSrc->GetToken(), finalValue, dstFrame );
+                // Append in place if possible
+                if ( BFFStackFrame::AppendVarString( dstName, varSrc->GetString(), dstFrame ) == false )
+                {
+                    AStackString<2048> finalValue( varDst->GetString() );
+                    finalValue += varSrc->GetString();
+                    BFFStackFrame::SetVarString( dstName, varSrc->GetToken(), finalValue, dstFrame );
+                }
             }
             else if ( subtract )
             {
@@ -1454,7 +1475,7 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, const BFFToken
             }
             else
             {
-                BFFStackFrame::SetVarString( dstName, varSrc->GetToken(), varSrc->GetString(), dstFrame );
+                BFFStackFrame::SetVar( varSrc, varSrc->GetToken(), dstName, dstFrame );
             }
             return true;
         }
@@ -1463,16 +1484,20 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, const BFFToken
         {
             if ( concat )
             {
-                const unsigned int num = (unsigned int)( varSrc->GetArrayOfStrings().GetSize() + varDst->GetArrayOfStrings().GetSize() );
-                StackArray<AString> values;
-                values.SetCapacity( num );
-                values.Append( varDst->GetArrayOfStrings() );
-                values.Append( varSrc->GetArrayOfStrings() );
-                BFFStackFrame::SetVarArrayOfStrings( dstName, varSrc->GetToken(), values, dstFrame );
+                // Append in place if possible
+                if ( BFFStackFrame::AppendVarArrayOfStrings( dstName, varSrc->GetArrayOfStrings(), dstFrame ) == false )
+                {
+                    const unsigned int num = (unsigned int)( varSrc->GetArrayOfStrings().GetSize() + varDst->GetArrayOfStrings().GetSize() );
+                    StackArray<AString> values;
+                    values.SetCapacity( num );
+                    values.Append( varDst->GetArrayOfStrings() );
+                    values.Append( varSrc->GetArrayOfStrings() );
+                    BFFStackFrame::SetVarArrayOfStrings( dstName, varSrc->GetToken(), values, dstFrame );
+                }
             }
             else
             {
-                BFFStackFrame::SetVarArrayOfStrings( dstName, varSrc->GetToken(), varSrc->GetArrayOfStrings(), dstFrame );
+                BFFStackFrame::SetVar( varSrc, varSrc->GetToken(), dstName, dstFrame );
             }
             return true;
         }
@@ -1490,7 +1515,7 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, const BFFToken
             }
             else
             {
-                BFFStackFrame::SetVarArrayOfStructs( dstName, varSrc->GetToken(), varSrc->GetArrayOfStructs(), dstFrame );
+                BFFStackFrame::SetVar( varSrc, varSrc->GetToken(), dstName, dstFrame );
             }
             return true;
         }
@@ -1520,7 +1545,6 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, const BFFToken
 
         if ( ( srcType == BFFVariable::VAR_STRUCT ) && !subtract )
         {
-            const Array<const BFFVariable *> & srcMembers = varSrc->GetStructMembers();
             if ( concat )
             {
                 const BFFVariable * const newVar = BFFStackFrame::ConcatVars( dstName, varDst, varSrc, dstFrame, operatorToken );
@@ -1532,7 +1556,7 @@ bool BFFParser::StoreVariableToVariable( const AString & dstName, const BFFToken
             else
             {
                 // Register this variable
-                BFFStackFrame::SetVarStruct( dstName, varSrc->GetToken(), srcMembers, dstFrame );
+                BFFStackFrame::SetVar( varSrc, varSrc->GetToken(), dstName, dstFrame );
             }
             return true;
         }
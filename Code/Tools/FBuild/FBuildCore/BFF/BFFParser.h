@@ -17,6 +17,7 @@
 //------------------------------------------------------------------------------
 class BFFFile;
 class BFFToken;
+class BFFTokenCache;
 class BFFTokenRange;
 class BFFUserFunction;
 class FileStream;
@@ -36,6 +37,9 @@ public:
     bool ParseFromString( const char * fileName, const char * fileContents );
     bool Parse( BFFTokenRange & tokenRange );
 
+    // Re-use tokens from a previous parse where possible (optional)
+    void SetTokenCache( BFFTokenCache * tokenCache ) { m_Tokenizer.SetTokenCache( tokenCache ); }
+
     const Array<BFFFile *> & GetUsedFiles() const { return m_Tokenizer.GetUsedFiles(); }
 
     inline static const char kBFFCommentSemicolon = ';';
@@ -9,6 +9,7 @@
 #include "Tools/FBuild/FBuildCore/BFF/Functions/Function.h"
 #include "Tools/FBuild/FBuildCore/BFF/Tokenizer/BFFToken.h"
 
+#include "Core/Math/xxHash.h"
 #include "Core/Mem/Mem.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Tracing/Tracing.h"
@@ -84,7 +85,7 @@ void BFFStackFrame::DisconnectStackChain()
 
     // variable not found at this level, so create it
     BFFVariable * v = FNEW( BFFVariable( name, token, value ) );
-    frame->m_Variables.Append( v );
+    frame->AddVar( v );
 }
 
 // SetVarArrayOfStrings
@@ -106,7 +107,7 @@ void BFFStackFrame::DisconnectStackChain()
 
     // variable not found at this level, so create it
     BFFVariable * v = FNEW( BFFVariable( name, token, values ) );
-    frame->m_Variables.Append( v );
+    frame->AddVar( v );
 }
 
 // SetVarBool
@@ -128,7 +129,7 @@ void BFFStackFrame::DisconnectStackChain()
 
     // variable not found at this level, so create it
     BFFVariable * v = FNEW( BFFVariable( name, token, value ) );
-    frame->m_Variables.Append( v );
+    frame->AddVar( v );
 }
 
 // SetVarInt
@@ -150,7 +151,7 @@ void BFFStackFrame::DisconnectStackChain()
 
     // variable not found at this level, so create it
     BFFVariable * v = FNEW( BFFVariable( name, token, value ) );
-    frame->m_Variables.Append( v );
+    frame->AddVar( v );
 }
 
 // SetVarStruct
@@ -172,7 +173,7 @@ void BFFStackFrame::DisconnectStackChain()
 
     // variable not found at this level, so create it
     BFFVariable * v = FNEW( BFFVariable( name, token, members ) );
-    frame->m_Variables.Append( v );
+    frame->AddVar( v );
 }
 
 // SetVarStruct
@@ -194,7 +195,7 @@ void BFFStackFrame::DisconnectStackChain()
 
     // variable not found at this level, so create it
     BFFVariable * v = FNEW( BFFVariable( name, token, Move( members ) ) );
-    frame->m_Variables.Append( v );
+    frame->AddVar( v );
 }
 
 // SetVarArrayOfStructs
@@ -216,7 +217,7 @@ void BFFStackFrame::DisconnectStackChain()
 
     // variable not found at this level, so create it
     BFFVariable * v = FNEW( BFFVariable( name, token, structs, BFFVariable::VAR_ARRAY_OF_STRUCTS ) );
-    frame->m_Variables.Append( v );
+    frame->AddVar( v );
 }
 
 // SetVar
@@ -240,17 +241,55 @@ void BFFStackFrame::DisconnectStackChain()
 
     ASSERT( srcVar );
 
-    switch ( srcVar->GetType() )
+    // The value is shared rather than copied
+    BFFVariable * var = frame->GetVarMutableNoRecurse( dstName );
+    if ( var )
     {
-        case BFFVariable::VAR_ANY: ASSERT( false ); break;
-        case BFFVariable::VAR_STRING: SetVarString( dstName, token, srcVar->GetString(), frame ); break;
-        case BFFVariable::VAR_BOOL: SetVarBool( dstName, token, srcVar->GetBool(), frame ); break;
-        case BFFVariable::VAR_ARRAY_OF_STRINGS: SetVarArrayOfStrings( dstName, token, srcVar->GetArrayOfStrings(), frame ); break;
-        case BFFVariable::VAR_INT: SetVarInt( dstName, token, srcVar->GetInt(), frame ); break;
-        case BFFVariable::VAR_STRUCT: SetVarStruct( dstName, token, srcVar->GetStructMembers(), frame ); break;
-        case BFFVariable::VAR_ARRAY_OF_STRUCTS: SetVarArrayOfStructs( dstName, token, srcVar->GetArrayOfStructs(), frame ); break;
-        case BFFVariable::MAX_VAR_TYPES: ASSERT( false ); break;
+        var->SetValue( *srcVar );
+        return;
     }
+
+    // variable not found at this level, so create it
+    BFFVariable * v = FNEW( BFFVariable( dstName, token, *srcVar ) );
+    frame->AddVar( v );
+}
+
+// AppendVarString
+//------------------------------------------------------------------------------
+/*static*/ bool BFFStackFrame::AppendVarString( const AString & name,
+                                                const AString & value,
+                                                BFFStackFrame * frame )
+{
+    frame = frame ? frame : s_StackHead;
+    ASSERT( frame );
+
+    BFFVariable * var = frame->GetVarMutableNoRecurse( name );
+    if ( ( var == nullptr ) || ( var->IsString() == false ) || ( &var->GetString() == &value ) )
+    {
+        return false;
+    }
+
+    var->AppendValueString( value );
+    return true;
+}
+
+// AppendVarArrayOfStrings
+//------------------------------------------------------------------------------
+/*static*/ bool BFFStackFrame::AppendVarArrayOfStrings( const AString & name,
+                                                        const Array<AString> & values,
+                                                        BFFStackFrame * frame )
+{
+    frame = frame ? frame : s_StackHead;
+    ASSERT( frame );
+
+    BFFVariable * var = frame->GetVarMutableNoRecurse( name );
+    if ( ( var == nullptr ) || ( var->IsArrayOfStrings() == false ) || ( &var->GetArrayOfStrings() == &values ) )
+    {
+        return false;
+    }
+
+    var->AppendValueArrayOfStrings( values );
+    return true;
 }
 
 // ConcatVars
@@ -288,6 +327,13 @@ BFFVariable * BFFStackFrame::ConcatVars( const AString & name,
 // GetVar
 //------------------------------------------------------------------------------
 /*static*/ const BFFVariable * BFFStackFrame::GetVar( const AString & name, BFFStackFrame * frame )
+{
+    return GetVar( name, BFFVariable::CalcNameHash( name ), frame );
+}
+
+// GetVar
+//------------------------------------------------------------------------------
+/*static*/ const BFFVariable * BFFStackFrame::GetVar( const AString & name, uint32_t nameHash, BFFStackFrame * frame )
 {
     // we shouldn't be calling this if there aren't any stack frames
     ASSERT( s_StackHead );
@@ -295,12 +341,12 @@ BFFVariable * BFFStackFrame::ConcatVars( const AString & name,
     if ( frame )
     {
         // no recursion, specific frame provided
-        return frame->GetVarMutableNoRecurse( name );
+        return frame->GetVarNoRecurse( name, nameHash );
     }
     else
     {
         // recurse up the stack
-        return s_StackHead->GetVariableRecurse( name );
+        return s_StackHead->GetVariableRecurse( name, nameHash );
     }
 }
 
@@ -308,21 +354,23 @@ BFFVariable * BFFStackFrame::ConcatVars( const AString & name,
 //------------------------------------------------------------------------------
 const BFFVariable * BFFStackFrame::GetVariableRecurse( const AString & name ) const
 {
-    // look at this scope level
-    for ( const BFFVariable * var : m_Variables )
+    return GetVariableRecurse( name, BFFVariable::CalcNameHash( name ) );
+}
+
+// GetVariableRecurse
+//------------------------------------------------------------------------------
+const BFFVariable * BFFStackFrame::GetVariableRecurse( const AString & name, uint32_t nameHash ) const
+{
+    // look at each scope level, from this one up
+    for ( const BFFStackFrame * frame = this; frame; frame = frame->m_Next )
     {
-        if ( var->GetName() == name )
+        const uint32_t index = frame->FindVarIndex( name, nameHash );
+        if ( index != kInvalidIndex )
         {
-            return var;
+            return frame->m_Variables[ index ];
         }
     }
 
-    // look at parent
-    if ( m_Next )
-    {
-        return m_Next->GetVariableRecurse( name );
-    }
-
     // not found
     return nullptr;
 }
@@ -332,7 +380,16 @@ const BFFVariable * BFFStackFrame::GetVariableRecurse( const AString & name ) co
 const BFFVariable * BFFStackFrame::GetLocalVar( const AString & name ) const
 {
     // look at this scope level
-    return GetVarNoRecurse( name );
+    return GetVarNoRecurse( name, BFFVariable::CalcNameHash( name ) );
+}
+
+// TakeLocalVariables
+//------------------------------------------------------------------------------
+void BFFStackFrame::TakeLocalVariables( Array<BFFVariable *> & outVariables )
+{
+    ASSERT( outVariables.IsEmpty() );
+    outVariables.Swap( m_Variables );
+    m_Index.Clear();
 }
 
 // GetParentDeclaration
@@ -346,6 +403,13 @@ const BFFVariable * BFFStackFrame::GetLocalVar( const AString & name ) const
 // GetParentDeclaration
 //------------------------------------------------------------------------------
 /*static*/ BFFStackFrame * BFFStackFrame::GetParentDeclaration( const AString & name, BFFStackFrame * frame, const BFFVariable *& variable )
+{
+    return GetParentDeclaration( name, BFFVariable::CalcNameHash( name ), frame, variable );
+}
+
+// GetParentDeclaration
+//------------------------------------------------------------------------------
+/*static*/ BFFStackFrame * BFFStackFrame::GetParentDeclaration( const AString & name, uint32_t nameHash, BFFStackFrame * frame, const BFFVariable *& variable )
 {
     // we shouldn't be calling this if there aren't any stack frames
     ASSERT( s_StackHead );
@@ -357,7 +421,7 @@ const BFFVariable * BFFStackFrame::GetLocalVar( const AString & name ) const
     // look for the scope containing the original variable
     for ( ; parentFrame; parentFrame = parentFrame->GetParent() )
     {
-        if ( ( variable = parentFrame->GetLocalVar( name ) ) != nullptr )
+        if ( ( variable = parentFrame->GetVarNoRecurse( name, nameHash ) ) != nullptr )
         {
             return parentFrame;
         }
@@ -387,92 +451,193 @@ const BFFVariable * BFFStackFrame::GetVariableRecurse( const AString & nameOnly,
 {
     ASSERT( nameOnly.BeginsWith( '.' ) == false ); // Should not include . : TODO:C Resolve the inconsistency
 
-    // look at this scope level
-    for ( const BFFVariable * var : m_Variables )
+    // Hash is of name without the . so matches that of the full name
+    const uint32_t nameHash = xxHash3::Calc32( nameOnly );
+
+    // look at each scope level, from this one up
+    for ( const BFFStackFrame * frame = this; frame; frame = frame->m_Next )
     {
-        // if name only (minus type prefix) length matches
-        if ( var->GetName().GetLength() == ( nameOnly.GetLength() + 1 ) )
+        const uint32_t index = frame->FindVarIndex( 0, nameOnly.Get(), nameOnly.GetLength(), nameHash, type );
+        if ( index != kInvalidIndex )
         {
-            //types match?
-            if ( ( type == BFFVariable::VAR_ANY ) ||
-                 ( type == var->GetType() ) )
-            {
-                // compare names
-                if ( nameOnly == ( var->GetName().Get() + 1 ) )
-                {
-                    return var;
-                }
-            }
+            return frame->m_Variables[ index ];
         }
     }
 
-    // look at parent
-    if ( m_Next )
-    {
-        return m_Next->GetVariableRecurse( nameOnly, type );
-    }
-
     // not found
     return nullptr;
 }
 
 // GetVarNoRecurse
 //------------------------------------------------------------------------------
-const BFFVariable * BFFStackFrame::GetVarNoRecurse( const AString & name ) const
+BFFVariable * BFFStackFrame::GetVarNoRecurse( const AString & name, uint32_t nameHash ) const
 {
     ASSERT( s_StackHead ); // we shouldn't be calling this if there aren't any stack frames
 
     // look at this scope level
-    for ( const BFFVariable * var : m_Variables )
-    {
-        if ( var->GetName() == name )
-        {
-            return var;
-        }
-    }
-
-    return nullptr;
+    const uint32_t index = FindVarIndex( name, nameHash );
+    return ( index != kInvalidIndex ) ? m_Variables[ index ] : nullptr;
 }
 
 // GetVarMutableNoRecurse
 //------------------------------------------------------------------------------
 BFFVariable * BFFStackFrame::GetVarMutableNoRecurse( const AString & name )
+{
+    return GetVarNoRecurse( name, BFFVariable::CalcNameHash( name ) );
+}
+
+// CreateOrReplaceVarMutableNoRecurse
+//------------------------------------------------------------------------------
+void BFFStackFrame::CreateOrReplaceVarMutableNoRecurse( BFFVariable * var )
 {
     ASSERT( s_StackHead ); // we shouldn't be calling this if there aren't any stack frames
+    ASSERT( var );
 
     // look at this scope level
-    for ( BFFVariable * var : m_Variables )
+    const uint32_t index = FindVarIndex( var->GetName(), var->GetNameHash() );
+    if ( index != kInvalidIndex )
+    {
+        // Same name, so index is still valid
+        FDELETE m_Variables[ index ];
+        m_Variables[ index ] = var;
+        return;
+    }
+
+    AddVar( var );
+}
+
+// AddVar
+//------------------------------------------------------------------------------
+void BFFStackFrame::AddVar( BFFVariable * var )
+{
+    m_Variables.Append( var );
+
+    if ( m_Index.IsEmpty() )
     {
-        if ( var->GetName() == name )
+        // Small scopes are searched linearly
+        if ( m_Variables.GetSize() >= kMinVariablesToIndex )
         {
-            return var;
+            BuildIndex( kMinVariablesToIndex * 4 );
         }
+        return;
     }
 
-    return nullptr;
+    // Keep load at or below 1/2
+    if ( ( m_Variables.GetSize() * 2 ) > m_Index.GetSize() )
+    {
+        BuildIndex( (uint32_t)m_Index.GetSize() * 2 );
+        return;
+    }
+    AddToIndex( (uint32_t)( m_Variables.GetSize() - 1 ) );
 }
 
-// CreateOrReplaceVarMutableNoRecurse
+// BuildIndex
 //------------------------------------------------------------------------------
-void BFFStackFrame::CreateOrReplaceVarMutableNoRecurse( BFFVariable * var )
+void BFFStackFrame::BuildIndex( uint32_t size )
 {
-    ASSERT( s_StackHead ); // we shouldn't be calling this if there aren't any stack frames
-    ASSERT( var );
+    ASSERT( ( size & ( size - 1 ) ) == 0 ); // Must be a power of 2
+    ASSERT( size >= ( m_Variables.GetSize() * 2 ) );
 
-    // look at this scope level
-    Array<BFFVariable *>::Iter i = m_Variables.Begin();
-    Array<BFFVariable *>::Iter end = m_Variables.End();
-    for ( ; i < end; ++i )
+    m_Index.SetSize( size );
+    for ( IndexEntry & entry : m_Index )
+    {
+        entry.m_VarIndex = kInvalidIndex;
+    }
+    for ( size_t i = 0; i < m_Variables.GetSize(); ++i )
+    {
+        AddToIndex( (uint32_t)i );
+    }
+}
+
+// AddToIndex
+//------------------------------------------------------------------------------
+void BFFStackFrame::AddToIndex( uint32_t varIndex )
+{
+    const uint32_t nameHash = m_Variables[ varIndex ]->GetNameHash();
+    const uint32_t mask = (uint32_t)( m_Index.GetSize() - 1 );
+    uint32_t i = ( nameHash & mask );
+    while ( m_Index[ i ].m_VarIndex != kInvalidIndex )
+    {
+        i = ( ( i + 1 ) & mask );
+    }
+    m_Index[ i ].m_NameHash = nameHash;
+    m_Index[ i ].m_VarIndex = varIndex;
+}
+
+// FindVarIndex
+//------------------------------------------------------------------------------
+uint32_t BFFStackFrame::FindVarIndex( const AString & name, uint32_t nameHash ) const
+{
+    ASSERT( nameHash == BFFVariable::CalcNameHash( name ) );
+    if ( name.IsEmpty() )
+    {
+        return kInvalidIndex;
+    }
+    return FindVarIndex( name[ 0 ], name.Get() + 1, name.GetLength() - 1, nameHash, BFFVariable::VAR_ANY );
+}
+
+// FindVarIndex
+//------------------------------------------------------------------------------
+uint32_t BFFStackFrame::FindVarIndex( char prefix,
+                                      const char * nameOnly,
+                                      size_t nameOnlyLength,
+                                      uint32_t nameHash,
+                                      BFFVariable::VarType type ) const
+{
+    if ( m_Index.IsEmpty() )
     {
-        if ( ( *i )->GetName() == var->GetName() )
+        for ( size_t i = 0; i < m_Variables.GetSize(); ++i )
         {
-            FDELETE *i;
-            *i = var;
-            return;
+            if ( IsMatch( m_Variables[ i ], prefix, nameOnly, nameOnlyLength, nameHash, type ) )
+            {
+                return (uint32_t)i;
+            }
         }
+        return kInvalidIndex;
     }
 
-    m_Variables.Append( var );
+    const uint32_t mask = (uint32_t)( m_Index.GetSize() - 1 );
+    for ( uint32_t i = ( nameHash & mask );; i = ( ( i + 1 ) & mask ) )
+    {
+        const IndexEntry & entry = m_Index[ i ];
+        if ( entry.m_VarIndex == kInvalidIndex )
+        {
+            return kInvalidIndex;
+        }
+        if ( ( entry.m_NameHash == nameHash ) &&
+             IsMatch( m_Variables[ entry.m_VarIndex ], prefix, nameOnly, nameOnlyLength, nameHash, type ) )
+        {
+            return entry.m_VarIndex;
+        }
+    }
+}
+
+// IsMatch
+//------------------------------------------------------------------------------
+/*static*/ bool BFFStackFrame::IsMatch( const BFFVariable * var,
+                                        char prefix,
+                                        const char * nameOnly,
+                                        size_t nameOnlyLength,
+                                        uint32_t nameHash,
+                                        BFFVariable::VarType type )
+{
+    // Names (minus the leading .) must match
+    const AString & varName = var->GetName();
+    if ( ( var->GetNameHash() != nameHash ) ||
+         ( varName.GetLength() != ( nameOnlyLength + 1 ) ) ||
+         ( AString::StrNCmp( varName.Get() + 1, nameOnly, nameOnlyLength ) != 0 ) )
+    {
+        return false;
+    }
+
+    // Leading . must match, if specified
+    if ( prefix && ( varName[ 0 ] != prefix ) )
+    {
+        return false;
+    }
+
+    // Types must match, if specified
+    return ( ( type == BFFVariable::VAR_ANY ) || ( type == var->GetType() ) );
 }
 
 //------------------------------------------------------------------------------
@@ -63,6 +63,15 @@ public:
                         const AString & dstName,
                         BFFStackFrame * frame );
 
+    // append to a variable at this level in place (returns false if there is no
+    // such variable of the same type, or if the value is the variable itself)
+    static bool AppendVarString( const AString & name,
+                                 const AString & value,
+                                 BFFStackFrame * frame );
+    static bool AppendVarArrayOfStrings( const AString & name,
+                                         const Array<AString> & values,
+                                         BFFStackFrame * frame );
+
     // set from two existing variable
     static BFFVariable * ConcatVars( const AString & name,
                                      const BFFVariable * lhs,
@@ -73,13 +82,16 @@ public:
     // get a variable (caller passes complete name indicating type (user vs system))
     static const BFFVariable * GetVar( const char * name, BFFStackFrame * frame = nullptr );
     static const BFFVariable * GetVar( const AString & name, BFFStackFrame * frame = nullptr );
+    static const BFFVariable * GetVar( const AString & name, uint32_t nameHash, BFFStackFrame * frame = nullptr );
 
     // get a variable by name, either user or system
     static const BFFVariable * GetVarAny( const AString & nameOnly );
 
     // get all variables at this stack level only
     const Array<const BFFVariable *> & GetLocalVariables() const { RETURN_CONSTIFIED_BFF_VARIABLE_ARRAY( m_Variables ); }
-    Array<BFFVariable *> & GetLocalVariables() { return m_Variables; }
+
+    // take ownership of all variables at this stack level
+    void TakeLocalVariables( Array<BFFVariable *> & outVariables );
 
     // get a variable at this stack level only
     const BFFVariable * GetLocalVar( const AString & name ) const;
@@ -89,10 +101,12 @@ public:
 
     static BFFStackFrame * GetParentDeclaration( const char * name, BFFStackFrame * frame, const BFFVariable *& variable );
     static BFFStackFrame * GetParentDeclaration( const AString & name, BFFStackFrame * frame, const BFFVariable *& variable );
+    static BFFStackFrame * GetParentDeclaration( const AString & name, uint32_t nameHash, BFFStackFrame * frame, const BFFVariable *& variable );
 
     BFFStackFrame * GetParent() const { return m_Next; }
 
     const BFFVariable * GetVariableRecurse( const AString & name ) const;
+    const BFFVariable * GetVariableRecurse( const AString & name, uint32_t nameHash ) const;
 
     const AString & GetLastVariableSeen() const { return m_LastVariableSeen; }
     BFFStackFrame * GetLastVariableSeenFrame() const { return m_LastVariableSeenFrame; }
@@ -106,14 +120,43 @@ private:
     const BFFVariable * GetVariableRecurse( const AString & nameOnly,
                                             BFFVariable::VarType type ) const;
 
-    const BFFVariable * GetVarNoRecurse( const AString & name ) const;
+    BFFVariable * GetVarNoRecurse( const AString & name, uint32_t nameHash ) const;
     BFFVariable * GetVarMutableNoRecurse( const AString & name );
 
     void CreateOrReplaceVarMutableNoRecurse( BFFVariable * var );
+    void AddVar( BFFVariable * var );
+
+    // Hash index of variables at current scope
+    void BuildIndex( uint32_t size );
+    void AddToIndex( uint32_t varIndex );
+    uint32_t FindVarIndex( const AString & name, uint32_t nameHash ) const;
+    uint32_t FindVarIndex( char prefix, // 0 to match any
+                           const char * nameOnly,
+                           size_t nameOnlyLength,
+                           uint32_t nameHash,
+                           BFFVariable::VarType type ) const;
+    static bool IsMatch( const BFFVariable * var,
+                         char prefix,
+                         const char * nameOnly,
+                         size_t nameOnlyLength,
+                         uint32_t nameHash,
+                         BFFVariable::VarType type );
 
     // variables at current scope
     Array<BFFVariable *> m_Variables;
 
+    // open addressing table of indices into m_Variables, used once there are
+    // too many variables to search linearly (i.e. large generated scopes)
+    class IndexEntry
+    {
+    public:
+        uint32_t m_NameHash;
+        uint32_t m_VarIndex;
+    };
+    Array<IndexEntry> m_Index;
+    inline static const uint32_t kMinVariablesToIndex = 16;
+    inline static const uint32_t kInvalidIndex = 0xFFFFFFFF;
+
     // pointer to parent scope
     BFFStackFrame * m_Next;
     BFFStackFrame * m_OldHeadToRestore;
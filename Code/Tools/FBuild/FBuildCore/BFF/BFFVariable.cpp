@@ -7,6 +7,7 @@
 #include "Tools/FBuild/FBuildCore/Error.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 
+#include "Core/Math/xxHash.h"
 #include "Core/Mem/Mem.h"
 
 // Static Data
@@ -28,6 +29,7 @@
 //------------------------------------------------------------------------------
 BFFVariable::BFFVariable( const AString & name, const BFFToken & token, VarType type )
     : m_Name( name )
+    , m_NameHash( CalcNameHash( name ) )
     , m_Type( type )
     , m_Token( token )
 {
@@ -37,20 +39,34 @@ BFFVariable::BFFVariable( const AString & name, const BFFToken & token, VarType
 //------------------------------------------------------------------------------
 BFFVariable::BFFVariable( const BFFVariable & other )
     : m_Name( other.m_Name )
+    , m_NameHash( other.m_NameHash )
     , m_Type( other.m_Type )
+    , m_BoolValue( other.m_BoolValue )
+    , m_IntValue( other.m_IntValue )
+    , m_StringValue( other.m_StringValue )
+    , m_ArrayValues( other.m_ArrayValues )
+    , m_SubVariables( other.m_SubVariables )
     , m_Token( other.m_Token )
 {
-    switch ( m_Type )
-    {
-        case VAR_ANY: ASSERT( false ); break;
-        case VAR_STRING: SetValueString( other.GetString() ); break;
-        case VAR_BOOL: SetValueBool( other.GetBool() ); break;
-        case VAR_ARRAY_OF_STRINGS: SetValueArrayOfStrings( other.GetArrayOfStrings() ); break;
-        case VAR_INT: SetValueInt( other.GetInt() ); break;
-        case VAR_STRUCT: SetValueStruct( other.GetStructMembers() ); break;
-        case VAR_ARRAY_OF_STRUCTS: SetValueArrayOfStructs( other.GetArrayOfStructs() ); break;
-        case MAX_VAR_TYPES: ASSERT( false ); break;
-    }
+    ASSERT( ( m_Type != VAR_ANY ) && ( m_Type != MAX_VAR_TYPES ) );
+}
+
+// CONSTRUCTOR (copy of value)
+//------------------------------------------------------------------------------
+BFFVariable::BFFVariable( const AString & name,
+                          const BFFToken & token,
+                          const BFFVariable & other )
+    : m_Name( name )
+    , m_NameHash( CalcNameHash( name ) )
+    , m_Type( other.m_Type )
+    , m_BoolValue( other.m_BoolValue )
+    , m_IntValue( other.m_IntValue )
+    , m_StringValue( other.m_StringValue )
+    , m_ArrayValues( other.m_ArrayValues )
+    , m_SubVariables( other.m_SubVariables )
+    , m_Token( token )
+{
+    ASSERT( ( m_Type != VAR_ANY ) && ( m_Type != MAX_VAR_TYPES ) );
 }
 
 // CONSTRUCTOR
@@ -59,6 +75,7 @@ BFFVariable::BFFVariable( const AString & name,
                           const BFFToken & token,
                           const AString & value )
     : m_Name( name )
+    , m_NameHash( CalcNameHash( name ) )
     , m_Type( VAR_STRING )
     , m_StringValue( value )
     , m_Token( token )
@@ -71,6 +88,7 @@ BFFVariable::BFFVariable( const AString & name,
                           const BFFToken & token,
                           bool value )
     : m_Name( name )
+    , m_NameHash( CalcNameHash( name ) )
     , m_Type( VAR_BOOL )
     , m_BoolValue( value )
     , m_Token( token )
@@ -83,6 +101,7 @@ BFFVariable::BFFVariable( const AString & name,
                           const BFFToken & token,
                           const Array<AString> & values )
     : m_Name( name )
+    , m_NameHash( CalcNameHash( name ) )
     , m_Type( VAR_ARRAY_OF_STRINGS )
     , m_ArrayValues( values )
     , m_Token( token )
@@ -95,6 +114,7 @@ BFFVariable::BFFVariable( const AString & name,
                           const BFFToken & token,
                           int32_t i )
     : m_Name( name )
+    , m_NameHash( CalcNameHash( name ) )
     , m_Type( VAR_INT )
     , m_IntValue( i )
     , m_Token( token )
@@ -107,10 +127,10 @@ BFFVariable::BFFVariable( const AString & name,
                           const BFFToken & token,
                           const Array<const BFFVariable *> & values )
     : m_Name( name )
+    , m_NameHash( CalcNameHash( name ) )
     , m_Type( VAR_STRUCT )
     , m_Token( token )
 {
-    m_SubVariables.SetCapacity( values.GetSize() );
     SetValueStruct( values );
 }
 
@@ -120,8 +140,9 @@ BFFVariable::BFFVariable( const AString & name,
                           const BFFToken & token,
                           Array<BFFVariable *> && values )
     : m_Name( name )
+    , m_NameHash( CalcNameHash( name ) )
     , m_Type( VAR_STRUCT )
-    , m_SubVariables( Move( values ) )
+    , m_SubVariables( SubVariables( Move( values ) ) )
     , m_Token( token )
 {
 }
@@ -133,11 +154,10 @@ BFFVariable::BFFVariable( const AString & name,
                           const Array<const BFFVariable *> & structs,
                           VarType type ) // type for disambiguation
     : m_Name( name )
+    , m_NameHash( CalcNameHash( name ) )
     , m_Type( VAR_ARRAY_OF_STRUCTS )
     , m_Token( token )
 {
-    m_SubVariables.SetCapacity( structs.GetSize() );
-
     // type for disambiguation only - sanity check it's the right type
     ASSERT( type == VAR_ARRAY_OF_STRUCTS );
     (void)type;
@@ -145,24 +165,25 @@ BFFVariable::BFFVariable( const AString & name,
     SetValueArrayOfStructs( structs );
 }
 
-// DESTRUCTOR
+// CalcNameHash
 //------------------------------------------------------------------------------
-BFFVariable::~BFFVariable()
+/*static*/ uint32_t BFFVariable::CalcNameHash( const AString & name )
 {
-    // clean up sub variables
-    for ( BFFVariable * var : m_SubVariables )
-    {
-        FDELETE var;
-    }
+    // Skip the leading . (or other prefix)
+    return name.IsEmpty() ? 0 : xxHash3::Calc32( name.Get() + 1, name.GetLength() - 1 );
 }
 
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+BFFVariable::~BFFVariable() = default;
+
 // SetValueString
 //------------------------------------------------------------------------------
 void BFFVariable::SetValueString( const AString & value )
 {
     ASSERT( 0 == m_FreezeCount );
     m_Type = VAR_STRING;
-    m_StringValue = value;
+    m_StringValue.Set( value );
 }
 
 // SetValueBool
@@ -180,7 +201,7 @@ void BFFVariable::SetValueArrayOfStrings( const Array<AString> & values )
 {
     ASSERT( 0 == m_FreezeCount );
     m_Type = VAR_ARRAY_OF_STRINGS;
-    m_ArrayValues = values;
+    m_ArrayValues.Set( values );
 }
 
 // SetValueInt
@@ -199,24 +220,16 @@ void BFFVariable::SetValueStruct( const Array<const BFFVariable *> & values )
     ASSERT( 0 == m_FreezeCount );
 
     // build list of new members, but don't touch old ones yet to gracefully
-    // handle self-assignment
+    // handle self-assignment (copying each member is cheap as values are shared)
     Array<BFFVariable *> newVars;
     newVars.SetCapacity( values.GetSize() );
-
-    m_Type = VAR_STRUCT;
     for ( const BFFVariable * var : values )
     {
         newVars.Append( FNEW( BFFVariable( *var ) ) );
     }
 
-    // free old members
-    for ( BFFVariable * var : m_SubVariables )
-    {
-        FDELETE var;
-    }
-
-    // swap
-    m_SubVariables.Swap( newVars );
+    m_Type = VAR_STRUCT;
+    m_SubVariables.Set( SubVariables( Move( newVars ) ) );
 }
 
 // SetValueStruct
@@ -225,18 +238,9 @@ void BFFVariable::SetValueStruct( Array<BFFVariable *> && values )
 {
     ASSERT( 0 == m_FreezeCount );
 
-    // Take a copy of the old pointers
-    Array<BFFVariable *> oldVars;
-    oldVars.Swap( m_SubVariables );
-
     // Take ownership of new variables
-    m_SubVariables = Move( values );
-
-    // Free old variables
-    for ( BFFVariable * var : oldVars )
-    {
-        FDELETE var;
-    }
+    m_Type = VAR_STRUCT;
+    m_SubVariables.Set( SubVariables( Move( values ) ) );
 }
 
 // SetValueArrayOfStructs
@@ -245,24 +249,57 @@ void BFFVariable::SetValueArrayOfStructs( const Array<const BFFVariable *> & val
 {
     ASSERT( 0 == m_FreezeCount );
 
-    // build list of new members, but don't touch old ones yet to gracefully
-    // handle self-assignment
+    // build list of new structs, but don't touch old ones yet to gracefully
+    // handle self-assignment (copying each struct is cheap as values are shared)
     Array<BFFVariable *> newVars;
     newVars.SetCapacity( values.GetSize() );
-
-    m_Type = VAR_ARRAY_OF_STRUCTS;
     for ( const BFFVariable * var : values )
     {
         newVars.Append( FNEW( BFFVariable( *var ) ) );
     }
 
-    // free old members
-    for ( BFFVariable * var : m_SubVariables )
-    {
-        FDELETE var;
-    }
+    m_Type = VAR_ARRAY_OF_STRUCTS;
+    m_SubVariables.Set( SubVariables( Move( newVars ) ) );
+}
+
+// SetValue
+//------------------------------------------------------------------------------
+void BFFVariable::SetValue( const BFFVariable & other )
+{
+    ASSERT( 0 == m_FreezeCount );
+    ASSERT( ( other.m_Type != VAR_ANY ) && ( other.m_Type != MAX_VAR_TYPES ) );
+
+    // Keep the current value alive until done, as other may be part of it
+    // (i.e. a struct member replacing the struct)
+    const SharedValue<SubVariables> oldSubVariables( m_SubVariables );
+
+    // Share the value
+    m_Type = other.m_Type;
+    m_BoolValue = other.m_BoolValue;
+    m_IntValue = other.m_IntValue;
+    m_StringValue = other.m_StringValue;
+    m_ArrayValues = other.m_ArrayValues;
+    m_SubVariables = other.m_SubVariables;
+}
+
+// AppendValueString
+//------------------------------------------------------------------------------
+void BFFVariable::AppendValueString( const AString & value )
+{
+    ASSERT( 0 == m_FreezeCount );
+    ASSERT( IsString() );
+    ASSERT( &value != &m_StringValue.Get() ); // Caller must handle appending to self
+    m_StringValue.GetMutable() += value;
+}
 
-    m_SubVariables.Swap( newVars );
+// AppendValueArrayOfStrings
+//------------------------------------------------------------------------------
+void BFFVariable::AppendValueArrayOfStrings( const Array<AString> & values )
+{
+    ASSERT( 0 == m_FreezeCount );
+    ASSERT( IsArrayOfStrings() );
+    ASSERT( &values != &m_ArrayValues.Get() ); // Caller must handle appending to self
+    m_ArrayValues.GetMutable().Append( values );
 }
 
 // GetMemberByName
@@ -339,15 +376,7 @@ BFFVariable * BFFVariable::ConcatVarsRecurse( const AString & dstName, const BFF
              ( ( ( srcType == BFFVariable::VAR_ARRAY_OF_STRUCTS ) || ( srcType == BFFVariable::VAR_ARRAY_OF_STRINGS ) ) && dstIsEmpty ) )
         {
             const BFFVariable * src = srcIsEmpty ? varDst : varSrc;
-            BFFVariable * result = FNEW( BFFVariable( dstName, m_Token, src->m_Type ) );
-            if ( src->m_Type == BFFVariable::VAR_ARRAY_OF_STRINGS )
-            {
-                result->SetValueArrayOfStrings( src->GetArrayOfStrings() );
-            }
-            else
-            {
-                result->SetValueArrayOfStructs( src->GetArrayOfStructs() );
-            }
+            BFFVariable * result = FNEW( BFFVariable( dstName, m_Token, *src ) );
             return result;
         }
 
@@ -421,8 +450,8 @@ BFFVariable * BFFVariable::ConcatVarsRecurse( const AString & dstName, const BFF
             const Array<const BFFVariable *> & dstMembers = varDst->GetStructMembers();
 
             BFFVariable * const result = FNEW( BFFVariable( dstName, varSrc->m_Token, BFFVariable::VAR_STRUCT ) );
-            result->m_SubVariables.SetCapacity( srcMembers.GetSize() + dstMembers.GetSize() );
-            Array<BFFVariable *> & allMembers = result->m_SubVariables;
+            Array<BFFVariable *> & allMembers = result->m_SubVariables.GetMutable().m_Variables;
+            allMembers.SetCapacity( srcMembers.GetSize() + dstMembers.GetSize() );
 
             // keep original (dst) members where member is only present in original (dst)
             // or concatenate recursively members where the name exists in both
@@ -442,7 +471,7 @@ BFFVariable * BFFVariable::ConcatVarsRecurse( const AString & dstName, const BFF
                 }
                 else
                 {
-                    newVar = FNEW( BFFVariable( **it ) );
+                    newVar = FNEW( BFFVariable( **it ) ); // Shares value
                 }
 
                 allMembers.Append( newVar );
@@ -467,4 +496,40 @@ BFFVariable * BFFVariable::ConcatVarsRecurse( const AString & dstName, const BFF
     return nullptr;
 }
 
+// SubVariables CONSTRUCTOR (copy)
+//------------------------------------------------------------------------------
+BFFVariable::SubVariables::SubVariables( const SubVariables & other )
+{
+    // Copying each variable is cheap as values are shared
+    m_Variables.SetCapacity( other.m_Variables.GetSize() );
+    for ( const BFFVariable * var : other.m_Variables )
+    {
+        m_Variables.Append( FNEW( BFFVariable( *var ) ) );
+    }
+}
+
+// SubVariables CONSTRUCTOR (&&)
+//------------------------------------------------------------------------------
+BFFVariable::SubVariables::SubVariables( SubVariables && other )
+    : m_Variables( Move( other.m_Variables ) )
+{
+}
+
+// SubVariables CONSTRUCTOR (&&)
+//------------------------------------------------------------------------------
+BFFVariable::SubVariables::SubVariables( Array<BFFVariable *> && variables )
+    : m_Variables( Move( variables ) )
+{
+}
+
+// SubVariables DESTRUCTOR
+//------------------------------------------------------------------------------
+BFFVariable::SubVariables::~SubVariables()
+{
+    for ( BFFVariable * var : m_Variables )
+    {
+        FDELETE var;
+    }
+}
+
 //------------------------------------------------------------------------------
@@ -5,6 +5,7 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "Core/Containers/Array.h"
+#include "Core/Containers/SharedValue.h"
 #include "Core/Strings/AString.h"
 
 // Forward Declarations
@@ -30,16 +31,20 @@ class BFFVariable
 {
 public:
     const AString & GetName() const { return m_Name; }
+    uint32_t GetNameHash() const { return m_NameHash; }
+
+    // Hash of name, excluding the leading . (matches ReflectedProperty::GetNameCRC)
+    static uint32_t CalcNameHash( const AString & name );
 
     const AString & GetString() const
     {
         ASSERT( IsString() );
-        return m_StringValue;
+        return m_StringValue.Get();
     }
     const Array<AString> & GetArrayOfStrings() const
     {
         ASSERT( IsArrayOfStrings() );
-        return m_ArrayValues;
+        return m_ArrayValues.Get();
     }
     int32_t GetInt() const
     {
@@ -54,12 +59,12 @@ public:
     const Array<const BFFVariable *> & GetStructMembers() const
     {
         ASSERT( IsStruct() );
-        RETURN_CONSTIFIED_BFF_VARIABLE_ARRAY( m_SubVariables );
+        RETURN_CONSTIFIED_BFF_VARIABLE_ARRAY( m_SubVariables.Get().m_Variables );
     }
     const Array<const BFFVariable *> & GetArrayOfStructs() const
     {
         ASSERT( IsArrayOfStructs() );
-        RETURN_CONSTIFIED_BFF_VARIABLE_ARRAY( m_SubVariables );
+        RETURN_CONSTIFIED_BFF_VARIABLE_ARRAY( m_SubVariables.Get().m_Variables );
     }
 
     enum VarType : uint8_t
@@ -102,6 +107,7 @@ private:
     friend class BFFStackFrame;
 
     explicit BFFVariable( const BFFVariable & other );
+    explicit BFFVariable( const AString & name, const BFFToken & token, const BFFVariable & other ); // value of other
 
     explicit BFFVariable( const AString & name, const BFFToken & token, VarType type );
     explicit BFFVariable( const AString & name, const BFFToken & token, const AString & value );
@@ -122,8 +128,29 @@ private:
     void SetValueStruct( const Array<const BFFVariable *> & members );
     void SetValueStruct( Array<BFFVariable *> && members );
     void SetValueArrayOfStructs( const Array<const BFFVariable *> & values );
+    void SetValue( const BFFVariable & other );
+
+    // modify in place (other copies of the value are unaffected)
+    void AppendValueString( const AString & value );
+    void AppendValueArrayOfStrings( const Array<AString> & values );
+
+    // Struct members or structs in an array (owned)
+    class SubVariables
+    {
+    public:
+        explicit SubVariables() = default;
+        explicit SubVariables( const SubVariables & other );
+        explicit SubVariables( SubVariables && other );
+        explicit SubVariables( Array<BFFVariable *> && variables );
+        ~SubVariables();
+
+        SubVariables & operator=( const SubVariables & other ) = delete;
+
+        Array<BFFVariable *> m_Variables;
+    };
 
     AString m_Name;
+    uint32_t m_NameHash; // Calculated once, for fast lookups in BFFStackFrame
     VarType m_Type;
 
     mutable uint8_t m_FreezeCount = 0;
@@ -131,9 +158,12 @@ private:
     //
     bool m_BoolValue = false;
     int32_t m_IntValue = 0;
-    AString m_StringValue;
-    Array<AString> m_ArrayValues;
-    Array<BFFVariable *> m_SubVariables; // Used for struct members of arrays of structs
+
+    // Larger values are shared between copies of a variable (copy-on-write), so
+    // passing them between scopes (Using, ForEach, assignment etc) is cheap
+    SharedValue<AString> m_StringValue;
+    SharedValue<Array<AString>> m_ArrayValues;
+    SharedValue<SubVariables> m_SubVariables; // Used for struct members of arrays of structs
     const BFFToken & m_Token;
 
     static const char * s_TypeNames[ MAX_VAR_TYPES ];
@@ -1124,8 +1124,8 @@ bool Function::PopulateProperties( NodeGraph & nodeGraph, const BFFToken * iter,
             AStackString propertyName( "." );
             propertyName += property.GetName();
 
-            // Find the value for this property from the BFF
-            const BFFVariable * v = BFFStackFrame::GetVar( propertyName );
+            // Find the value for this property from the BFF (property name hash matches variable name hash)
+            const BFFVariable * v = BFFStackFrame::GetVar( propertyName, property.GetNameCRC() );
 
             if ( !PopulateProperty( nodeGraph, iter, base, property, v ) )
             {
@@ -1686,7 +1686,7 @@ bool Function::PopulateArrayOfStructsElement( NodeGraph & nodeGraph,
                 // If not found, check for inheritance from containing frame
                 if ( property.HasMetaData<Meta_InheritFromOwner>() )
                 {
-                    var = BFFStackFrame::GetVar( propertyName );
+                    var = BFFStackFrame::GetVar( propertyName, property.GetNameCRC() );
                 }
             }
             if ( !PopulateProperty( nodeGraph, iter, structBase, property, var ) )
@@ -5,6 +5,10 @@
 //------------------------------------------------------------------------------
 #include "BFFToken.h"
 
+// Core
+#include "Core/Math/xxHash.h"
+
+// system
 #include <stdio.h>
 
 //------------------------------------------------------------------------------
@@ -159,4 +163,18 @@ void BFFToken::GetPosInfo( uint32_t & outLine,
     outColumn = (uint32_t)( ( p - outLineStart ) + 1 );
 }
 
+// CalcVariableNameHash
+//------------------------------------------------------------------------------
+/*static*/ uint32_t BFFToken::CalcVariableNameHash( const AString & variable )
+{
+    // Names of the ."String" form can contain variables to substitute
+    if ( ( variable.GetLength() < 2 ) || ( variable[ 1 ] == '"' ) || ( variable[ 1 ] == '\'' ) )
+    {
+        return 0;
+    }
+
+    // Hash the name without the leading . or ^ (see BFFVariable::CalcNameHash)
+    return xxHash3::Calc32( variable.Get() + 1, variable.GetLength() - 1 );
+}
+
 //------------------------------------------------------------------------------
@@ -147,6 +147,7 @@ public:
 
     // Variable
     [[nodiscard]] bool IsVariable() const { return ( m_Type == BFFTokenType::Variable ); }
+    [[nodiscard]] uint32_t GetVariableNameHash() const; // See BFFVariable::CalcNameHash. 0 if name is only known when parsing (."$Var$" form)
 
     // Generic Access
     BFFTokenType GetType() const { return m_Type; }
@@ -172,10 +173,13 @@ private:
         BFFKeyword::Type m_KeywordType;
         bool m_Boolean;
     };
+    uint32_t m_VariableNameHash = 0; // Not in union, as brace checks rely on the union being 0 for other types
     mutable AString m_String;
     const BFFFile & m_BFFFile;
     const char * m_SourcePos = nullptr;
 
+    static uint32_t CalcVariableNameHash( const AString & variable );
+
     // Static Data
     static const BFFFile s_BuiltInFile;
     static const BFFToken s_BuiltInToken;
@@ -222,6 +226,7 @@ inline BFFToken::BFFToken( VariableType /*variableType*/, const BFFFile & file,
     , m_BFFFile( file )
     , m_SourcePos( sourcePos )
 {
+    m_VariableNameHash = CalcVariableNameHash( m_String );
 }
 
 //------------------------------------------------------------------------------
@@ -231,6 +236,7 @@ inline BFFToken::BFFToken( VariableType /*variableType*/, const BFFFile & file,
     , m_BFFFile( file )
     , m_SourcePos( sourcePos )
 {
+    m_VariableNameHash = CalcVariableNameHash( m_String );
 }
 
 //------------------------------------------------------------------------------
@@ -335,6 +341,13 @@ inline int32_t BFFToken::GetValueInt() const
     return m_Integer;
 }
 
+//------------------------------------------------------------------------------
+inline uint32_t BFFToken::GetVariableNameHash() const
+{
+    ASSERT( IsVariable() );
+    return m_VariableNameHash;
+}
+
 //------------------------------------------------------------------------------
 inline BFFKeyword::Type BFFToken::GetKeywordType() const
 {
@@ -0,0 +1,474 @@
+// BFFTokenCache.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "BFFTokenCache.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/BFF/Tokenizer/BFFToken.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Env/ErrorFormat.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/Profile/Profile.h"
+
+// Header
+//------------------------------------------------------------------------------
+class BFFTokenCache::Header
+{
+public:
+    Header()
+    {
+        m_Identifier[ 0 ] = 'B';
+        m_Identifier[ 1 ] = 'T';
+        m_Identifier[ 2 ] = 'C';
+        m_Version = kCurrentVersion;
+        m_NumEntries = 0;
+    }
+
+    // NOTE: Bump when tokenization changes (including new keywords and functions)
+    inline static const uint8_t kCurrentVersion = 1;
+
+    bool IsValid() const
+    {
+        return ( ( m_Identifier[ 0 ] == 'B' ) &&
+                 ( m_Identifier[ 1 ] == 'T' ) &&
+                 ( m_Identifier[ 2 ] == 'C' ) &&
+                 ( m_Version == kCurrentVersion ) );
+    }
+
+    char m_Identifier[ 3 ];
+    uint8_t m_Version;
+    uint32_t m_NumEntries;
+};
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+BFFTokenCache::BFFTokenCache()
+    : m_NewRecords( 64 * 1024, 1024 * 1024 )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+BFFTokenCache::~BFFTokenCache() = default;
+
+// Load
+//------------------------------------------------------------------------------
+bool BFFTokenCache::Load( const char * fileName )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( m_File.IsOpen() == false );
+    if ( m_File.Open( fileName ) == false )
+    {
+        return false; // No cache (first parse, or DB was deleted)
+    }
+
+    // Check header and table fit
+    const size_t fileSize = m_File.GetSize();
+    const Header * header = static_cast<const Header *>( m_File.GetData() );
+    if ( ( fileSize < sizeof( Header ) ) ||
+         ( header->IsValid() == false ) ||
+         ( ( fileSize - sizeof( Header ) ) < ( (uint64_t)header->m_NumEntries * sizeof( Entry ) ) ) )
+    {
+        FLOG_VERBOSE( "BFF token cache '%s' is incompatible or corrupt - ignoring", fileName );
+        m_File.Close();
+        return false;
+    }
+
+    m_Entries = reinterpret_cast<const Entry *>( header + 1 );
+    m_NumEntries = header->m_NumEntries;
+    m_Records = reinterpret_cast<const char *>( m_Entries + m_NumEntries );
+    m_RecordsSize = ( fileSize - (size_t)( m_Records - static_cast<const char *>( m_File.GetData() ) ) );
+    m_Used.SetSize( m_NumEntries );
+    for ( bool & used : m_Used )
+    {
+        used = false;
+    }
+    return true;
+}
+
+// Save
+//------------------------------------------------------------------------------
+bool BFFTokenCache::Save( const char * fileName )
+{
+    PROFILE_FUNCTION;
+
+    if ( IsDirty() == false )
+    {
+        return true; // Everything was retrieved from the existing cache
+    }
+
+    // Runs from the existing cache which are still in use
+    Array<Entry> entries;
+    entries.SetCapacity( m_NumEntries + m_NewEntries.GetSize() );
+    MemoryStream records( m_RecordsSize + m_NewRecords.GetSize() );
+    for ( size_t i = 0; i < m_NumEntries; ++i )
+    {
+        if ( m_Used[ i ] )
+        {
+            Entry & entry = entries.EmplaceBack( m_Entries[ i ] );
+            entry.m_Offset = (uint32_t)records.Tell();
+            records.WriteBuffer( m_Records + m_Entries[ i ].m_Offset, m_Entries[ i ].m_Size );
+        }
+    }
+
+    // New runs
+    for ( const Entry & newEntry : m_NewEntries )
+    {
+        Entry & entry = entries.EmplaceBack( newEntry );
+        entry.m_Offset = (uint32_t)records.Tell();
+        records.WriteBuffer( static_cast<const char *>( m_NewRecords.GetData() ) + newEntry.m_Offset, newEntry.m_Size );
+    }
+
+    // Offsets are 32-bit
+    if ( records.GetSize() > 0xFFFFFFFF )
+    {
+        FLOG_WARN( "BFF token cache too large to save (%" PRIu64 " bytes)", (uint64_t)records.GetSize() );
+        return false;
+    }
+
+    entries.Sort();
+
+    Header header;
+    header.m_NumEntries = (uint32_t)entries.GetSize();
+
+    // Release existing mapping so the file can be replaced
+    m_File.Close();
+    m_Entries = nullptr;
+    m_NumEntries = 0;
+    m_Records = nullptr;
+    m_RecordsSize = 0;
+    m_Used.Clear();
+
+    FileStream f;
+    if ( ( f.Open( fileName, FileStream::WRITE_ONLY ) == false ) ||
+         ( f.WriteBuffer( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( f.WriteBuffer( entries.Begin(), entries.GetSize() * sizeof( Entry ) ) != ( entries.GetSize() * sizeof( Entry ) ) ) ||
+         ( f.WriteBuffer( records.GetData(), records.GetSize() ) != records.GetSize() ) )
+    {
+        FLOG_WARN( "Failed to save BFF token cache '%s'. Error: %s", fileName, LAST_ERROR_STR );
+        if ( f.IsOpen() )
+        {
+            f.Close();
+        }
+        FileIO::FileDelete( fileName ); // Don't leave a partial cache
+        return false;
+    }
+    f.Close();
+
+    m_NewEntries.Clear();
+    m_NewRecords.Reset();
+    return true;
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+bool BFFTokenCache::Retrieve( const BFFFile & file,
+                              const char * start,
+                              const char * end,
+                              Array<BFFToken> & outTokens,
+                              const char *& outStop )
+{
+    const char * contents = file.GetSourceFileContents().Get();
+    const Entry * entry = Find( file.GetHash(), (uint32_t)( start - contents ), (uint32_t)( end - contents ) );
+    if ( ( entry == nullptr ) ||
+         ( entry->m_Stop > entry->m_End ) ||
+         ( ( entry->m_Stop < entry->m_End ) && ( contents[ entry->m_Stop ] != '#' ) ) ||
+         ( ( (uint64_t)entry->m_Offset + entry->m_Size ) > m_RecordsSize ) )
+    {
+        ++m_NumMisses;
+        return false;
+    }
+
+    // Discard partially read tokens if record is corrupt
+    const size_t numTokens = outTokens.GetSize();
+    if ( ReadTokens( file, *entry, m_Records + entry->m_Offset, outTokens ) == false )
+    {
+        while ( outTokens.GetSize() > numTokens )
+        {
+            outTokens.Pop(); // Avoiding use of SetSize as this requires a default constructor
+        }
+        ++m_NumMisses;
+        return false;
+    }
+
+    m_Used[ (size_t)( entry - m_Entries ) ] = true;
+    outStop = ( contents + entry->m_Stop );
+    ++m_NumHits;
+    return true;
+}
+
+// Store
+//------------------------------------------------------------------------------
+void BFFTokenCache::Store( const BFFFile & file,
+                           const char * start,
+                           const char * end,
+                           const char * stop,
+                           const BFFToken * tokens,
+                           size_t numTokens )
+{
+    const char * contents = file.GetSourceFileContents().Get();
+
+    Entry & entry = m_NewEntries.EmplaceBack();
+    entry.m_FileHash = file.GetHash();
+    entry.m_Start = (uint32_t)( start - contents );
+    entry.m_End = (uint32_t)( end - contents );
+    entry.m_Stop = (uint32_t)( stop - contents );
+    entry.m_NumTokens = (uint32_t)numTokens;
+    entry.m_Offset = (uint32_t)m_NewRecords.GetSize();
+    for ( size_t i = 0; i < numTokens; ++i )
+    {
+        WriteToken( file, tokens[ i ], m_NewRecords );
+    }
+    entry.m_Size = (uint32_t)( m_NewRecords.GetSize() - entry.m_Offset );
+}
+
+// IsDirty
+//------------------------------------------------------------------------------
+bool BFFTokenCache::IsDirty() const
+{
+    if ( m_NewEntries.IsEmpty() == false )
+    {
+        return true;
+    }
+    for ( const bool used : m_Used )
+    {
+        if ( used == false )
+        {
+            return true; // Stale runs to remove
+        }
+    }
+    return false;
+}
+
+// GetCacheFileName
+//------------------------------------------------------------------------------
+/*static*/ void BFFTokenCache::GetCacheFileName( const char * nodeGraphDBFile, AString & outFileName )
+{
+    outFileName = nodeGraphDBFile;
+    outFileName += ".bfftokens";
+}
+
+// Entry::operator <
+//------------------------------------------------------------------------------
+bool BFFTokenCache::Entry::operator<( const Entry & other ) const
+{
+    if ( m_FileHash != other.m_FileHash )
+    {
+        return ( m_FileHash < other.m_FileHash );
+    }
+    if ( m_Start != other.m_Start )
+    {
+        return ( m_Start < other.m_Start );
+    }
+    return ( m_End < other.m_End );
+}
+
+// Find
+//------------------------------------------------------------------------------
+const BFFTokenCache::Entry * BFFTokenCache::Find( uint64_t fileHash, uint32_t start, uint32_t end ) const
+{
+    // Binary search for entry
+    Entry key;
+    key.m_FileHash = fileHash;
+    key.m_Start = start;
+    key.m_End = end;
+    size_t low = 0;
+    size_t high = m_NumEntries;
+    while ( low < high )
+    {
+        const size_t mid = ( low + high ) / 2;
+        if ( m_Entries[ mid ] < key )
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    if ( ( low < m_NumEntries ) &&
+         ( m_Entries[ low ].m_FileHash == fileHash ) &&
+         ( m_Entries[ low ].m_Start == start ) &&
+         ( m_Entries[ low ].m_End == end ) )
+    {
+        return &m_Entries[ low ];
+    }
+    return nullptr;
+}
+
+// ReadTokens
+//------------------------------------------------------------------------------
+/*static*/ bool BFFTokenCache::ReadTokens( const BFFFile & file,
+                                          const Entry & entry,
+                                          const char * record,
+                                          Array<BFFToken> & outTokens )
+{
+    const AString & contents = file.GetSourceFileContents();
+    if ( entry.m_Stop > contents.GetLength() )
+    {
+        return false;
+    }
+
+    ConstMemoryStream stream( record, entry.m_Size );
+    AString string;
+    for ( uint32_t i = 0; i < entry.m_NumTokens; ++i )
+    {
+        uint8_t type;
+        uint32_t offset;
+        if ( ( stream.Read( type ) == false ) ||
+             ( stream.Read( offset ) == false ) ||
+             ( offset > entry.m_Stop ) )
+        {
+            return false;
+        }
+        const char * sourcePos = ( contents.Get() + offset );
+
+        switch ( static_cast<BFFTokenType>( type ) )
+        {
+            case BFFTokenType::Operator:
+            case BFFTokenType::Brace:
+            case BFFTokenType::Keyword:
+            case BFFTokenType::Boolean:
+            {
+                uint8_t value;
+                if ( stream.Read( value ) == false )
+                {
+                    return false;
+                }
+                // Values out of range mean the cache is corrupt
+                if ( type == (uint8_t)BFFTokenType::Operator )
+                {
+                    if ( value >= (uint8_t)BFFOperator::Type::Count )
+                    {
+                        return false;
+                    }
+                    outTokens.EmplaceBack( static_cast<BFFOperator::Type>( value ), file, sourcePos );
+                }
+                else if ( type == (uint8_t)BFFTokenType::Brace )
+                {
+                    if ( IsValidBraceType( value ) == false )
+                    {
+                        return false;
+                    }
+                    outTokens.EmplaceBack( static_cast<BFFToken::BraceType>( value ), file, sourcePos );
+                }
+                else if ( type == (uint8_t)BFFTokenType::Keyword )
+                {
+                    if ( value >= (uint8_t)BFFKeyword::Type::Count )
+                    {
+                        return false;
+                    }
+                    outTokens.EmplaceBack( static_cast<BFFKeyword::Type>( value ), file, sourcePos );
+                }
+                else
+                {
+                    outTokens.EmplaceBack( ( value != 0 ), file, sourcePos );
+                }
+                break;
+            }
+            case BFFTokenType::Number:
+            {
+                int32_t value;
+                if ( stream.Read( value ) == false )
+                {
+                    return false;
+                }
+                outTokens.EmplaceBack( value, file, sourcePos );
+                break;
+            }
+            case BFFTokenType::Comma:
+            {
+                outTokens.EmplaceBack( BFFToken::CommaType::eComma, file, sourcePos );
+                break;
+            }
+            case BFFTokenType::Identifier:
+            case BFFTokenType::Function:
+            case BFFTokenType::Variable:
+            case BFFTokenType::String:
+            {
+                if ( stream.Read( string ) == false )
+                {
+                    return false;
+                }
+                if ( type == (uint8_t)BFFTokenType::Identifier )
+                {
+                    outTokens.EmplaceBack( BFFToken::IdentifierType::eIdentifier, file, sourcePos, string );
+                }
+                else if ( type == (uint8_t)BFFTokenType::Function )
+                {
+                    outTokens.EmplaceBack( BFFToken::FunctionType::eFunction, file, sourcePos, string );
+                }
+                else if ( type == (uint8_t)BFFTokenType::Variable )
+                {
+                    outTokens.EmplaceBack( BFFToken::VariableType::eVariable, file, sourcePos, string );
+                }
+                else
+                {
+                    outTokens.EmplaceBack( string, file, sourcePos );
+                }
+                break;
+            }
+            case BFFTokenType::Invalid:
+            case BFFTokenType::EndOfFile:
+            default:
+            {
+                return false; // Never stored
+            }
+        }
+    }
+    return true;
+}
+
+// IsValidBraceType
+//------------------------------------------------------------------------------
+/*static*/ bool BFFTokenCache::IsValidBraceType( uint8_t value )
+{
+    switch ( static_cast<BFFToken::BraceType>( value ) )
+    {
+        case BFFToken::BraceType::eRoundLeft:
+        case BFFToken::BraceType::eRoundRight:
+        case BFFToken::BraceType::eCurlyLeft:
+        case BFFToken::BraceType::eCurlyRight:
+        case BFFToken::BraceType::eSquareLeft:
+        case BFFToken::BraceType::eSquareRight: return true;
+    }
+    return false;
+}
+
+// WriteToken
+//------------------------------------------------------------------------------
+/*static*/ void BFFTokenCache::WriteToken( const BFFFile & file, const BFFToken & token, MemoryStream & stream )
+{
+    ASSERT( &token.GetSourceFile() == &file );
+
+    const uint8_t type = (uint8_t)token.GetType();
+    const uint32_t offset = (uint32_t)( token.GetSourcePos() - file.GetSourceFileContents().Get() );
+    stream.Write( type );
+    stream.Write( offset );
+
+    switch ( token.GetType() )
+    {
+        case BFFTokenType::Operator: stream.Write( (uint8_t)token.GetOperatorType() ); break;
+        case BFFTokenType::Brace: stream.Write( (uint8_t)token.GetBraceType() ); break;
+        case BFFTokenType::Keyword: stream.Write( (uint8_t)token.GetKeywordType() ); break;
+        case BFFTokenType::Boolean: stream.Write( (uint8_t)( token.GetBoolean() ? 1 : 0 ) ); break;
+        case BFFTokenType::Number: stream.Write( token.GetValueInt() ); break;
+        case BFFTokenType::Comma: break;
+        case BFFTokenType::Identifier:
+        case BFFTokenType::Function:
+        case BFFTokenType::Variable:
+        case BFFTokenType::String: stream.Write( token.GetValueString() ); break;
+        case BFFTokenType::Invalid:
+        case BFFTokenType::EndOfFile: ASSERT( false ); break; // Not expected between directives
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,102 @@
+// BFFTokenCache.h
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/FileIO/MemoryMappedFile.h"
+#include "Core/FileIO/MemoryStream.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+class BFFFile;
+class BFFToken;
+
+// BFFTokenCache
+//  - Tokens of a bff file between directives depend only on the file contents,
+//    so are kept from one parse to the next, keyed by the hash of the contents
+//  - Directives are always evaluated (results can depend on defines, the
+//    environment and other files)
+//  - Persisted alongside the DB
+//------------------------------------------------------------------------------
+class BFFTokenCache
+{
+public:
+    explicit BFFTokenCache();
+    ~BFFTokenCache();
+
+    // Map a previously saved cache (returns false if missing or incompatible)
+    bool Load( const char * fileName );
+
+    // Save runs used by this parse (previous runs not used are discarded)
+    bool Save( const char * fileName );
+
+    // Append tokens for the given range of a file, up to the first directive
+    // (returns false if not cached)
+    bool Retrieve( const BFFFile & file,
+                   const char * start,
+                   const char * end,
+                   Array<BFFToken> & outTokens,
+                   const char *& outStop );
+
+    // Record tokens for the given range of a file, up to the first directive
+    void Store( const BFFFile & file,
+                const char * start,
+                const char * end,
+                const char * stop,
+                const BFFToken * tokens,
+                size_t numTokens );
+
+    bool IsDirty() const;
+
+    uint32_t GetNumHits() const { return m_NumHits; }
+    uint32_t GetNumMisses() const { return m_NumMisses; }
+
+    // Cache lives alongside the DB (i.e. fbuild.fdb -> fbuild.fdb.bfftokens)
+    static void GetCacheFileName( const char * nodeGraphDBFile, AString & outFileName );
+
+private:
+    class Header;
+    class Entry
+    {
+    public:
+        bool operator<( const Entry & other ) const;
+
+        uint64_t m_FileHash; // Hash of the file contents
+        uint32_t m_Start; // Offsets within file
+        uint32_t m_End;
+        uint32_t m_Stop; // Directive or m_End
+        uint32_t m_NumTokens;
+        uint32_t m_Offset; // Offset of record, relative to start of records
+        uint32_t m_Size; // Size of record
+    };
+
+    const Entry * Find( uint64_t fileHash, uint32_t start, uint32_t end ) const;
+    static bool ReadTokens( const BFFFile & file,
+                            const Entry & entry,
+                            const char * record,
+                            Array<BFFToken> & outTokens );
+    static void WriteToken( const BFFFile & file, const BFFToken & token, MemoryStream & stream );
+    static bool IsValidBraceType( uint8_t value );
+
+    // Previously saved runs
+    MemoryMappedFile m_File;
+    const Entry * m_Entries = nullptr;
+    size_t m_NumEntries = 0;
+    const char * m_Records = nullptr;
+    size_t m_RecordsSize = 0;
+    Array<bool> m_Used; // Which of m_Entries have been retrieved
+
+    // Runs tokenized by this parse
+    Array<Entry> m_NewEntries;
+    MemoryStream m_NewRecords;
+
+    uint32_t m_NumHits = 0;
+    uint32_t m_NumMisses = 0;
+};
+
+//------------------------------------------------------------------------------
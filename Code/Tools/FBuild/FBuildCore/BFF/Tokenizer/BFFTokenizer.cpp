@@ -9,6 +9,7 @@
 #include "Tools/FBuild/FBuildCore/BFF/BFFKeywords.h"
 #include "Tools/FBuild/FBuildCore/BFF/BFFParser.h"
 #include "Tools/FBuild/FBuildCore/BFF/Functions/Function.h"
+#include "Tools/FBuild/FBuildCore/BFF/Tokenizer/BFFTokenCache.h"
 #include "Tools/FBuild/FBuildCore/BFF/Tokenizer/BFFTokenRange.h"
 #include "Tools/FBuild/FBuildCore/Error.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
@@ -263,6 +264,47 @@ bool BFFTokenizer::Tokenize( const BFFFile * file )
 // Tokenize
 //------------------------------------------------------------------------------
 bool BFFTokenizer::Tokenize( const BFFFile & file, const char * pos, const char * end )
+{
+    while ( pos < end )
+    {
+        // Tokens up to the next directive depend only on the file contents, so
+        // can be re-used from a previous parse
+        const bool useCache = ( m_TokenCache && ( m_ParsingDirective == false ) );
+        const char * runStart = pos;
+        if ( useCache && m_TokenCache->Retrieve( file, runStart, end, m_Tokens, pos ) )
+        {
+            ASSERT( ( pos >= runStart ) && ( pos <= end ) );
+        }
+        else
+        {
+            const size_t firstToken = m_Tokens.GetSize();
+            if ( TokenizeToDirective( file, pos, end ) == false )
+            {
+                return false; // TokenizeToDirective will have emitted an error
+            }
+            if ( useCache )
+            {
+                m_TokenCache->Store( file, runStart, end, pos, ( m_Tokens.Begin() + firstToken ), ( m_Tokens.GetSize() - firstToken ) );
+            }
+        }
+
+        // # directive (non-recursive)
+        if ( pos < end )
+        {
+            ASSERT( IsDirective( *pos ) && ( m_ParsingDirective == false ) );
+            if ( HandleDirective( pos, end, file ) == false )
+            {
+                return false; // HandleDirective will have emitted an error
+            }
+        }
+    }
+
+    return true;
+}
+
+// TokenizeToDirective
+//------------------------------------------------------------------------------
+bool BFFTokenizer::TokenizeToDirective( const BFFFile & file, const char *& pos, const char * end )
 {
     while ( pos < end )
     {
@@ -428,14 +470,10 @@ bool BFFTokenizer::Tokenize( const BFFFile & file, const char * pos, const char
             continue;
         }
 
-        // # directive (non-recursive)
+        // # directive (non-recursive) - handled by caller
         if ( IsDirective( c ) && ( m_ParsingDirective == false ) )
         {
-            if ( HandleDirective( pos, end, file ) == false )
-            {
-                return false; // HandleDirective will have emitted an error
-            }
-            continue;
+            return true;
         }
 
         // Invalid input - record problem character
@@ -14,6 +14,7 @@
 // Forward Declarations
 //------------------------------------------------------------------------------
 class AString;
+class BFFTokenCache;
 class BFFTokenRange;
 
 // BFFTokenizer
@@ -31,6 +32,9 @@ public:
     // Process from a buffer in memory (for tests)
     bool TokenizeFromString( const AString & fileName, const AString & fileContents );
 
+    // Re-use tokens from a previous parse where possible (optional)
+    void SetTokenCache( BFFTokenCache * tokenCache ) { m_TokenCache = tokenCache; }
+
     // Access results
     const Array<BFFToken> & GetTokens() const { return m_Tokens; }
     const Array<BFFFile *> & GetUsedFiles() const { return m_Files; }
@@ -39,6 +43,7 @@ protected:
     bool Tokenize( const AString & fileName, const BFFToken * token );
     bool Tokenize( const BFFFile * file );
     bool Tokenize( const BFFFile & file, const char * pos, const char * end );
+    bool TokenizeToDirective( const BFFFile & file, const char *& pos, const char * end );
 
     bool GetQuotedString( const BFFFile & file, const char *& pos, AString & outString ) const;
     bool GetDirective( const BFFFile & file, const char *& pos, AString & outDirectiveName ) const;
@@ -81,6 +86,7 @@ protected:
     Array<BFFToken> m_Tokens;
     Array<BFFFile *> m_Files;
     BFFMacros m_Macros;
+    BFFTokenCache * m_TokenCache = nullptr;
     uint32_t m_Depth = 0;
     bool m_ParsingDirective = false;
 };
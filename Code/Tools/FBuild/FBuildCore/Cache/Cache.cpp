@@ -40,6 +40,10 @@ public:
     }
 };
 
+// Static Data
+//------------------------------------------------------------------------------
+/*static*/ const char * const Cache::kSizeEstimateFileName = "local.size";
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 /*explicit*/ Cache::Cache() = default;
@@ -169,6 +173,21 @@ public:
     return false;
 }
 
+// Query
+//------------------------------------------------------------------------------
+/*virtual*/ bool Cache::Query( const Array<AString> & cacheIds, Array<bool> & outFound )
+{
+    outFound.SetSize( cacheIds.GetSize() );
+
+    AStackString fullPath;
+    for ( size_t i = 0; i < cacheIds.GetSize(); ++i )
+    {
+        GetFullPathForCacheEntry( cacheIds[ i ], fullPath );
+        outFound[ i ] = FileIO::FileExists( fullPath.Get() );
+    }
+    return true;
+}
+
 // FreeMemory
 //------------------------------------------------------------------------------
 /*virtual*/ void Cache::FreeMemory( void * data, size_t /*dataSize*/ )
@@ -244,20 +263,49 @@ public:
 // Trim
 //------------------------------------------------------------------------------
 /*virtual*/ bool Cache::Trim( bool showProgress, uint32_t sizeMiB )
+{
+    uint64_t sizeAfter;
+    const bool outputInfo = true;
+    TrimInternal( showProgress, sizeMiB, outputInfo, sizeAfter );
+    return true;
+}
+
+// EnforceSizeLimit
+//------------------------------------------------------------------------------
+uint64_t Cache::EnforceSizeLimit( uint32_t sizeMiB )
+{
+    PROFILE_FUNCTION;
+
+    uint64_t sizeAfter;
+    const bool showProgress = false;
+    const bool outputInfo = false;
+    TrimInternal( showProgress, sizeMiB, outputInfo, sizeAfter );
+    return sizeAfter;
+}
+
+// TrimInternal
+//------------------------------------------------------------------------------
+void Cache::TrimInternal( bool showProgress, uint32_t sizeMiB, bool outputInfo, uint64_t & outSizeAfter )
 {
     // Get all the files
     Array<FileIO::FileInfo> allFiles;
     allFiles.SetCapacity( 1000000 );
     uint64_t totalSize = 0;
     GetCacheFiles( showProgress, allFiles, totalSize );
-    OUTPUT( " - Before: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize(), (uint32_t)( totalSize / MEGABYTE ) );
+    if ( outputInfo )
+    {
+        OUTPUT( " - Before: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize(), (uint32_t)( totalSize / MEGABYTE ) );
+    }
 
     // Sort by age
     OldestFileTimeSorter sorter;
     allFiles.Sort( sorter );
 
     // Do we need to delete anything?
-    OUTPUT( "Trimming to %u MiB:\n", sizeMiB );
+    if ( outputInfo )
+    {
+        OUTPUT( "Trimming to %u MiB:\n", sizeMiB );
+    }
     const uint64_t limit = ( (uint64_t)sizeMiB * MEGABYTE );
     uint32_t numDeleted = 0;
     if ( limit < totalSize )
@@ -307,8 +355,11 @@ public:
         }
     }
 
-    OUTPUT( " - After: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize() - numDeleted, (uint32_t)( totalSize / MEGABYTE ) );
-    return true;
+    if ( outputInfo )
+    {
+        OUTPUT( " - After: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize() - numDeleted, (uint32_t)( totalSize / MEGABYTE ) );
+    }
+    outSizeAfter = totalSize;
 }
 
 // GetCacheFiles
@@ -355,11 +406,19 @@ void Cache::GetCacheFiles( bool showProgress,
         }
     }
 
-    // Calculate totals
+    // Calculate totals (ignoring files which aren't entries)
+    AStackString sizeEstimateFileName;
+    sizeEstimateFileName.Format( "%c%s", NATIVE_SLASH, kSizeEstimateFileName );
     outTotalSize = 0;
-    for ( const FileIO::FileInfo & info : outInfo )
+    for ( size_t i = 0; i < outInfo.GetSize(); )
     {
-        outTotalSize += info.m_Size;
+        if ( outInfo[ i ].m_Name.EndsWithI( sizeEstimateFileName ) )
+        {
+            outInfo.EraseIndex( i );
+            continue;
+        }
+        outTotalSize += outInfo[ i ].m_Size;
+        ++i;
     }
 
     if ( showProgress )
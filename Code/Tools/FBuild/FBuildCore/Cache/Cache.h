@@ -31,8 +31,16 @@ public:
     virtual void FreeMemory( void * data, size_t dataSize ) override;
     virtual bool OutputInfo( bool showProgress ) override;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual bool Query( const Array<AString> & cacheIds, Array<bool> & outFound ) override;
+
+    // Trim without output, returning the remaining size in bytes
+    uint64_t EnforceSizeLimit( uint32_t sizeMiB );
+
+    // Size estimate kept in the cache root by TieredCache (not a cache entry)
+    static const char * const kSizeEstimateFileName;
 
 private:
+    void TrimInternal( bool showProgress, uint32_t sizeMiB, bool outputInfo, uint64_t & outSizeAfter );
     void GetCacheFiles( bool showProgress, Array<FileIO::FileInfo> & outInfo, uint64_t & outTotalSize ) const;
     void GetFullPathForCacheEntry( const AString & cacheId, AString & outFullPath ) const;
 
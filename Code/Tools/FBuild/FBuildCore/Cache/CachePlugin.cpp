@@ -9,6 +9,7 @@
 #include "Tools/FBuild/FBuildCore/FLog.h"
 
 // Core
+#include "Core/Containers/Array.h"
 #include "Core/Env/ErrorFormat.h"
 #include "Core/Mem/Mem.h"
 #include "Core/Tracing/Tracing.h"
@@ -52,6 +53,7 @@
     m_FreeMemoryFunc = (CacheFreeMemoryFunc)GetFunction( "CacheFreeMemory", "?CacheFreeMemory@@YAXPEAX_K@Z" );
     m_OutputInfoFunc = (CacheOutputInfoFunc)GetFunction( "CacheOutputInfo", "?CacheOutputInfo@@YA_N_N@Z", true ); // Optional
     m_TrimFunc = (CacheTrimFunc)GetFunction( "CacheTrim", "?CacheTrim@@YA_N_NI@Z", true ); // Optional
+    m_QueryFunc = (CacheQueryFunc)GetFunction( "CacheQuery", nullptr, true ); // Optional
 }
 
 // DESTRUCTOR
@@ -250,4 +252,29 @@ void * CachePlugin::GetFunction( const char * name, const char * mangledName, bo
     return false;
 }
 
+// Query
+//------------------------------------------------------------------------------
+/*virtual*/ bool CachePlugin::Query( const Array<AString> & cacheIds, Array<bool> & outFound )
+{
+    if ( m_Valid == false )
+    {
+        return false;
+    }
+
+    // Query is optional
+    if ( m_QueryFunc == nullptr )
+    {
+        return false;
+    }
+
+    StackArray<const char *> ids;
+    ids.SetCapacity( cacheIds.GetSize() );
+    for ( const AString & cacheId : cacheIds )
+    {
+        ids.Append( cacheId.Get() );
+    }
+    outFound.SetSize( cacheIds.GetSize() );
+    return ( *m_QueryFunc )( ids.Begin(), static_cast<uint32_t>( ids.GetSize() ), outFound.Begin() );
+}
+
 //------------------------------------------------------------------------------
@@ -32,6 +32,7 @@ public:
     virtual void FreeMemory( void * data, size_t dataSize ) override;
     virtual bool OutputInfo( bool showProgress ) override;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual bool Query( const Array<AString> & cacheIds, Array<bool> & outFound ) override;
 
 private:
     void * GetFunction( const char * friendlyName, const char * mangledName = nullptr, bool optional = false );
@@ -48,6 +49,7 @@ private:
     CacheFreeMemoryFunc m_FreeMemoryFunc = nullptr;
     CacheOutputInfoFunc m_OutputInfoFunc = nullptr;
     CacheTrimFunc m_TrimFunc = nullptr;
+    CacheQueryFunc m_QueryFunc = nullptr;
 };
 
 //------------------------------------------------------------------------------
@@ -97,6 +97,19 @@ using CacheOutputInfoFunc = bool( STDCALL * )( bool showProgress );
 //     sizeMiB      - desired size in MiB
 using CacheTrimFunc = bool( STDCALL * )( bool showProgress, unsigned int sizeMiB );
 
+// CacheQuery (Optional)
+//------------------------------------------------------------------------------
+// Check if items exist in the cache, without retrieving them. Allows lookups
+// to be batched so that round trips to remote storage can be amortized.
+//
+// In:  cacheIds    - array of string names of cache entries
+//      numCacheIds - number of items in cacheIds
+// Out: found       - array of numCacheIds results (true if item exists)
+//      bool        - (return) success. If false, found is ignored
+using CacheQueryFunc = bool( STDCALL * )( const char * const * cacheIds,
+                                          unsigned int numCacheIds,
+                                          bool * found );
+
 } //extern "C"
 
 //------------------------------------------------------------------------------
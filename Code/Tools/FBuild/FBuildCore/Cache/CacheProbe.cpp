@@ -0,0 +1,504 @@
+// CacheProbe - Look up cache entries ahead of compilation
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheProbe.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+#include "Tools/FBuild/FBuildCore/Cache/LightCache.h"
+#include "Tools/FBuild/FBuildCore/Graph/CompilerNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/ObjectListNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Args.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FBuildStats.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
+
+// Core
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AString.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheProbe::CacheProbe( ICache * cache )
+    : m_Cache( cache )
+{
+    for ( Thread & thread : m_Threads )
+    {
+        thread.Start( ThreadFuncStatic, "CacheProbe", this );
+    }
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheProbe::~CacheProbe()
+{
+    m_Quit.Store( true );
+    m_WakeSemaphore.Signal( kNumThreads );
+    for ( Thread & thread : m_Threads )
+    {
+        thread.Join();
+    }
+
+    // Discard lookups which never started (Flush may not have been called
+    // if a build was interrupted)
+    for ( Batch * batch : m_Batches )
+    {
+        for ( Job * job : batch->m_Jobs )
+        {
+            FDELETE job;
+        }
+        FDELETE batch;
+    }
+    for ( ObjectNode * node : m_Nodes )
+    {
+        if ( node->m_CacheProbeData )
+        {
+            m_Cache->FreeMemory( node->m_CacheProbeData, node->m_CacheProbeDataSize );
+            node->m_CacheProbeData = nullptr;
+        }
+        node->m_CacheProbeState = NONE;
+    }
+}
+
+// Queue
+//------------------------------------------------------------------------------
+void CacheProbe::Queue( const Array<Node *> & nodes )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( Thread::IsMainThread() );
+
+    Batch * batch = nullptr;
+    uint32_t numBatches = 0;
+    for ( Node * node : nodes )
+    {
+        if ( IsEligible( node ) == false )
+        {
+            continue;
+        }
+        ObjectNode * objectNode = node->CastTo<ObjectNode>();
+
+        if ( batch == nullptr )
+        {
+            batch = FNEW( Batch );
+            batch->m_Nodes.SetCapacity( kNodesPerBatch );
+            batch->m_Jobs.SetCapacity( kNodesPerBatch );
+        }
+        batch->m_Nodes.Append( objectNode );
+        batch->m_Jobs.Append( FNEW( Job( objectNode ) ) ); // Must be created on main thread
+
+        {
+            MutexHolder mh( m_Mutex );
+            objectNode->m_CacheProbeState = PENDING;
+            objectNode->m_CacheProbeClaimed = false;
+            m_Nodes.Append( objectNode );
+            if ( batch->m_Nodes.GetSize() == kNodesPerBatch )
+            {
+                m_Batches.Append( batch );
+                ++m_NumPending;
+                ++numBatches;
+                batch = nullptr;
+            }
+        }
+    }
+    if ( batch )
+    {
+        MutexHolder mh( m_Mutex );
+        m_Batches.Append( batch );
+        ++m_NumPending;
+        ++numBatches;
+    }
+
+    if ( numBatches > 0 )
+    {
+        m_WakeSemaphore.Signal( numBatches );
+    }
+}
+
+// Claim
+//------------------------------------------------------------------------------
+CacheProbe::State CacheProbe::Claim( ObjectNode * node )
+{
+    for ( ;; )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+            State state = static_cast<State>( node->m_CacheProbeState );
+            if ( state != HASHING )
+            {
+                // Rather than waiting for a network operation, the worker does
+                // its own retrieval (the result of the operation is discarded)
+                if ( state == QUERYING )
+                {
+                    state = KEYED;
+                }
+                else if ( state == FETCHING )
+                {
+                    state = HIT;
+                }
+
+                // Node now belongs to the worker, and will not be touched again
+                node->m_CacheProbeClaimed = true;
+                return state;
+            }
+
+            // The key is being written to the node, which takes about as long as
+            // the worker calculating it itself would
+            ++m_NumClaimsWaiting;
+        }
+
+        PROFILE_SECTION( "WaitForCacheProbe" );
+        m_KeyCalculatedSemaphore.Wait();
+    }
+}
+
+// TakeData
+//------------------------------------------------------------------------------
+void CacheProbe::TakeData( ObjectNode * node, void *& outData, size_t & outDataSize )
+{
+    ASSERT( node->m_CacheProbeClaimed );
+    ASSERT( node->m_CacheProbeData );
+
+    outData = node->m_CacheProbeData;
+    outDataSize = node->m_CacheProbeDataSize;
+    node->m_CacheProbeData = nullptr;
+    node->m_CacheProbeDataSize = 0;
+
+    MutexHolder mh( m_Mutex );
+    m_PrefetchedBytes -= outDataSize;
+}
+
+// Flush
+//------------------------------------------------------------------------------
+void CacheProbe::Flush( FBuildStats & outStats )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( Thread::IsMainThread() );
+
+    // Wait for outstanding lookups
+    for ( ;; )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+            if ( m_NumPending == 0 )
+            {
+                break;
+            }
+        }
+        m_BatchCompleteSemaphore.Wait( 100 );
+    }
+
+    MutexHolder mh( m_Mutex );
+
+    // Release entries which were retrieved but not used (if build was interrupted)
+    for ( ObjectNode * node : m_Nodes )
+    {
+        if ( node->m_CacheProbeData )
+        {
+            m_Cache->FreeMemory( node->m_CacheProbeData, node->m_CacheProbeDataSize );
+            m_PrefetchedBytes -= node->m_CacheProbeDataSize;
+            node->m_CacheProbeData = nullptr;
+            node->m_CacheProbeDataSize = 0;
+        }
+        node->m_CacheProbeState = NONE;
+        node->m_CacheProbeName.Clear();
+    }
+    m_Nodes.Clear();
+    ASSERT( m_PrefetchedBytes == 0 );
+
+    // Record stats for this build and reset for the next one
+    outStats.m_NumCacheProbeKeyed = m_NumKeyed;
+    outStats.m_NumCacheProbeHits = m_NumHits;
+    outStats.m_NumCacheProbeMisses = m_NumMisses;
+    outStats.m_NumCacheProbeFetched = m_NumFetched;
+    m_NumKeyed = 0;
+    m_NumHits = 0;
+    m_NumMisses = 0;
+    m_NumFetched = 0;
+}
+
+// IsEligible
+//------------------------------------------------------------------------------
+/*static*/ bool CacheProbe::IsEligible( const Node * node )
+{
+    if ( node->GetType() != Node::OBJECT_NODE )
+    {
+        return false;
+    }
+
+    // Only LightCache keys can be calculated without invoking the compiler. Creation of
+    // a PCH is excluded as other objects depend on its cache key.
+    const ObjectNode * objectNode = node->CastTo<ObjectNode>();
+    const CompilerNode * compiler = objectNode->GetCompiler();
+    return ( compiler->GetUseLightCache() &&
+             ( compiler->SimpleDistributionMode() == false ) &&
+             ( objectNode->GetDedicatedPreprocessor() == nullptr ) &&
+             ( objectNode->IsCreatingPCH() == false ) &&
+             objectNode->ShouldUseCache() );
+}
+
+// ThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CacheProbe::ThreadFuncStatic( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "CacheProbe" );
+
+    static_cast<CacheProbe *>( param )->ThreadFunc();
+    return 0;
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+void CacheProbe::ThreadFunc()
+{
+    for ( ;; )
+    {
+        // Get next batch
+        Batch * batch = nullptr;
+        {
+            MutexHolder mh( m_Mutex );
+            if ( m_Quit.Load() )
+            {
+                return;
+            }
+            if ( m_Batches.IsEmpty() == false )
+            {
+                batch = m_Batches[ 0 ];
+                m_Batches.PopFront();
+            }
+        }
+        if ( batch == nullptr )
+        {
+            m_WakeSemaphore.Wait();
+            continue;
+        }
+
+        ProcessBatch( *batch );
+
+        for ( Job * job : batch->m_Jobs )
+        {
+            FDELETE job;
+        }
+        FDELETE batch;
+
+        {
+            MutexHolder mh( m_Mutex );
+            --m_NumPending;
+        }
+        m_BatchCompleteSemaphore.Signal();
+    }
+}
+
+// ProcessBatch
+//------------------------------------------------------------------------------
+void CacheProbe::ProcessBatch( Batch & batch )
+{
+    PROFILE_FUNCTION;
+
+    // Calculate keys. Each node is released as soon as it is keyed so a
+    // worker picking it up can use the key immediately.
+    const size_t numNodes = batch.m_Nodes.GetSize();
+    for ( size_t i = 0; i < numNodes; ++i )
+    {
+        ObjectNode * node = batch.m_Nodes[ i ];
+        {
+            MutexHolder mh( m_Mutex );
+            if ( node->m_CacheProbeClaimed || ( node->m_CacheProbeState != PENDING ) )
+            {
+                continue; // Worker got there first
+            }
+            node->m_CacheProbeState = HASHING;
+        }
+
+        const bool keyed = CalculateKey( node, batch.m_Jobs[ i ] );
+
+        MutexHolder mh( m_Mutex );
+        if ( keyed )
+        {
+            node->m_CacheProbeName = batch.m_Jobs[ i ]->GetCacheName();
+            ++m_NumKeyed;
+        }
+        KeyCalculated( node, keyed ? KEYED : NONE );
+    }
+
+    FindEntries( batch );
+    Prefetch( batch );
+}
+
+// CalculateKey
+//------------------------------------------------------------------------------
+bool CacheProbe::CalculateKey( ObjectNode * node, Job * job ) const
+{
+    PROFILE_FUNCTION;
+
+    // Deoptimized compilation uses different args, so leave it to the worker
+    if ( node->ShouldUseDeoptimization() )
+    {
+        return false;
+    }
+
+    // Mirror the args a worker uses for LightCache hashing (see DoBuildWithPreProcessor)
+    Args fullArgs;
+    const bool useDeoptimization = false;
+    const bool showIncludes = false;
+    const bool useSourceMapping = true;
+    const bool finalize = false; // Only raw args are needed (don't write a response file)
+    if ( node->BuildArgs( job, fullArgs, ObjectNode::PASS_PREPROCESSOR_ONLY, useDeoptimization, showIncludes, useSourceMapping, finalize ) == false )
+    {
+        return false;
+    }
+
+    // If hashing fails, the worker will repeat it to report the problem
+    LightCache lc;
+    if ( lc.Hash( node,
+                  node->GetOwnerObjectList().GetCompilerInfo(),
+                  fullArgs.GetRawArgs(),
+                  node->m_LightCacheKey,
+                  node->m_Includes ) == false )
+    {
+        return false;
+    }
+
+    node->GetCacheName( job );
+    return true;
+}
+
+// FindEntries
+//------------------------------------------------------------------------------
+void CacheProbe::FindEntries( Batch & batch )
+{
+    PROFILE_FUNCTION;
+
+    // Gather keys not yet claimed by a worker
+    StackArray<ObjectNode *> nodes;
+    StackArray<AString> cacheIds;
+    {
+        MutexHolder mh( m_Mutex );
+        for ( ObjectNode * node : batch.m_Nodes )
+        {
+            if ( ( node->m_CacheProbeClaimed == false ) && ( node->m_CacheProbeState == KEYED ) )
+            {
+                node->m_CacheProbeState = QUERYING;
+                nodes.Append( node );
+                cacheIds.Append( node->m_CacheProbeName );
+            }
+        }
+    }
+    if ( nodes.IsEmpty() )
+    {
+        return;
+    }
+
+    // One query for the whole batch
+    StackArray<bool> found;
+    const bool supported = m_Cache->Query( cacheIds, found );
+
+    StackArray<const Node *> misses;
+    {
+        MutexHolder mh( m_Mutex );
+        for ( size_t i = 0; i < nodes.GetSize(); ++i )
+        {
+            if ( nodes[ i ]->m_CacheProbeClaimed )
+            {
+                continue; // Worker took over
+            }
+            if ( supported == false )
+            {
+                nodes[ i ]->m_CacheProbeState = KEYED;
+            }
+            else if ( found[ i ] )
+            {
+                nodes[ i ]->m_CacheProbeState = HIT;
+                ++m_NumHits;
+            }
+            else
+            {
+                nodes[ i ]->m_CacheProbeState = MISS;
+                misses.Append( nodes[ i ] );
+                ++m_NumMisses;
+            }
+        }
+    }
+
+    // Misses must be compiled, so when distributing, move them ahead of other
+    // queued objects to be preprocessed and made available to remote workers
+    // sooner. (Hits only need retrieving, which is quick.)
+    if ( ( misses.IsEmpty() == false ) &&
+         FBuild::Get().GetOptions().m_AllowDistributed &&
+         JobQueue::IsValid() )
+    {
+        JobQueue::Get().PrioritizeJobs( misses );
+    }
+}
+
+// Prefetch
+//------------------------------------------------------------------------------
+void CacheProbe::Prefetch( Batch & batch )
+{
+    PROFILE_FUNCTION;
+
+    for ( ObjectNode * node : batch.m_Nodes )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+            if ( node->m_CacheProbeClaimed || ( node->m_CacheProbeState != HIT ) )
+            {
+                continue;
+            }
+            if ( m_PrefetchedBytes >= kPrefetchBudget )
+            {
+                return; // Workers will retrieve the remaining entries themselves
+            }
+            node->m_CacheProbeState = FETCHING;
+        }
+
+        void * data = nullptr;
+        size_t dataSize = 0;
+        const bool retrieved = m_Cache->Retrieve( node->m_CacheProbeName, data, dataSize );
+
+        MutexHolder mh( m_Mutex );
+        if ( node->m_CacheProbeClaimed )
+        {
+            // Worker took over
+            if ( retrieved )
+            {
+                m_Cache->FreeMemory( data, dataSize );
+            }
+        }
+        else if ( retrieved )
+        {
+            node->m_CacheProbeData = data;
+            node->m_CacheProbeDataSize = dataSize;
+            m_PrefetchedBytes += dataSize;
+            ++m_NumFetched;
+            node->m_CacheProbeState = FETCHED;
+        }
+        else
+        {
+            node->m_CacheProbeState = KEYED; // Let the worker try again
+        }
+    }
+}
+
+// KeyCalculated
+//------------------------------------------------------------------------------
+void CacheProbe::KeyCalculated( ObjectNode * node, State state )
+{
+    ASSERT( node->m_CacheProbeState == HASHING );
+    node->m_CacheProbeState = state;
+
+    // Wake workers waiting to claim (each re-checks its own node)
+    if ( m_NumClaimsWaiting > 0 )
+    {
+        m_KeyCalculatedSemaphore.Signal( m_NumClaimsWaiting );
+        m_NumClaimsWaiting = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,109 @@
+// CacheProbe - Look up cache entries ahead of compilation
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+struct FBuildStats;
+class ICache;
+class Job;
+class Node;
+class ObjectNode;
+
+// CacheProbe
+//  - When LightCache compatible objects are queued, their cache keys are
+//    calculated on dedicated threads, before a worker picks them up
+//  - Keys are checked for existence in batches (if the cache supports it)
+//    and entries which exist are retrieved ahead of time
+//  - When distributing, objects which don't exist are moved ahead in the job
+//    queue, so they are ready for remote workers sooner
+//  - A worker claims the result for a node when it starts to build it. A node
+//    not yet being looked up is simply built as normal. A worker only waits for
+//    a key being calculated; nodes being queried or retrieved over the network
+//    are taken over by the worker, which retrieves the entry itself.
+//------------------------------------------------------------------------------
+class CacheProbe
+{
+public:
+    explicit CacheProbe( ICache * cache );
+    ~CacheProbe();
+
+    enum State : uint8_t
+    {
+        NONE,       // Not looked up (or lookup failed)
+        PENDING,    // Queued for lookup
+        HASHING,    // Cache key being calculated (node being written)
+        QUERYING,   // Cache key available, existence being checked
+        FETCHING,   // Cache key available, entry exists, being retrieved
+        KEYED,      // Cache key available
+        HIT,        // Cache key available, entry exists
+        MISS,       // Cache key available, entry does not exist
+        FETCHED,    // Cache key available, entry retrieved
+    };
+
+    // Main thread: begin lookups for eligible nodes about to be queued
+    void Queue( const Array<Node *> & nodes );
+
+    // Worker thread: take ownership of the result of the lookup (if any),
+    // waiting only for a key being calculated
+    State Claim( ObjectNode * node );
+    void TakeData( ObjectNode * node, void *& outData, size_t & outDataSize );
+
+    // Main thread: wait for outstanding lookups, release unused entries and
+    // record stats for the build
+    void Flush( FBuildStats & outStats );
+
+    inline static const uint32_t kNumThreads = 2;
+    inline static const uint32_t kNodesPerBatch = 32;
+    inline static const uint64_t kPrefetchBudget = ( 256 * 1024 * 1024 ); // Max retrieved, but not yet used
+
+private:
+    static bool IsEligible( const Node * node );
+
+    static uint32_t ThreadFuncStatic( void * param );
+    void ThreadFunc();
+
+    class Batch
+    {
+    public:
+        Array<ObjectNode *> m_Nodes;
+        Array<Job *> m_Jobs;
+    };
+    void ProcessBatch( Batch & batch );
+    bool CalculateKey( ObjectNode * node, Job * job ) const;
+    void FindEntries( Batch & batch );
+    void Prefetch( Batch & batch );
+    void KeyCalculated( ObjectNode * node, State state );
+
+    ICache * m_Cache;
+
+    Mutex m_Mutex; // Protects all below, and node state until claimed
+    Array<Batch *> m_Batches;
+    uint32_t m_NumPending = 0; // Batches queued or being processed
+    Array<ObjectNode *> m_Nodes; // All nodes queued this build
+    uint64_t m_PrefetchedBytes = 0;
+    uint32_t m_NumClaimsWaiting = 0; // Workers waiting for keys being calculated
+
+    // Stats for the current build
+    uint32_t m_NumKeyed = 0;
+    uint32_t m_NumHits = 0;
+    uint32_t m_NumMisses = 0;
+    uint32_t m_NumFetched = 0;
+
+    Semaphore m_WakeSemaphore;
+    Semaphore m_BatchCompleteSemaphore;
+    Semaphore m_KeyCalculatedSemaphore;
+    Atomic<bool> m_Quit;
+    Thread m_Threads[ kNumThreads ];
+};
+
+//------------------------------------------------------------------------------
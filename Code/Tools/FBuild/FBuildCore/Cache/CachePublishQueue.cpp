@@ -0,0 +1,209 @@
+// CachePublishQueue - Store to the cache in the background
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CachePublishQueue.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FBuildStats.h"
+
+// Core
+#include "Core/Containers/Move.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Time/Timer.h"
+
+// system
+#include <string.h> // for memcpy
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CachePublishQueue::CachePublishQueue( uint32_t memoryBudgetMiB )
+    : m_MemoryBudget( (uint64_t)memoryBudgetMiB * MEGABYTE )
+{
+    for ( Thread & thread : m_Threads )
+    {
+        thread.Start( ThreadFuncStatic, "CachePublish", this );
+    }
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CachePublishQueue::~CachePublishQueue()
+{
+    // Outstanding items are always completed (Flush may not have been called
+    // if a build was interrupted)
+    m_Quit.Store( true );
+    m_WakeSemaphore.Signal( kNumThreads );
+    for ( Thread & thread : m_Threads )
+    {
+        thread.Join();
+    }
+    ASSERT( m_NumPending == 0 );
+}
+
+// Enqueue
+//------------------------------------------------------------------------------
+bool CachePublishQueue::Enqueue( ObjectNode * node,
+                                 const AString & cacheId,
+                                 const void * data,
+                                 uint64_t dataSize,
+                                 bool isCompressed,
+                                 uint32_t compressionTimeMS )
+{
+    // Reserve space in the budget
+    {
+        MutexHolder mh( m_Mutex );
+        if ( ( m_QueuedBytes + dataSize ) > m_MemoryBudget )
+        {
+            ++m_NumQueueFull;
+            return false;
+        }
+        m_QueuedBytes += dataSize;
+    }
+
+    // Take a copy of the data, outside of the lock
+    Item item;
+    item.m_Node = node;
+    item.m_CacheId = cacheId;
+    item.m_Data = ALLOC( dataSize );
+    memcpy( item.m_Data, data, dataSize );
+    item.m_DataSize = dataSize;
+    item.m_IsCompressed = isCompressed;
+    item.m_CompressionTimeMS = compressionTimeMS;
+
+    {
+        MutexHolder mh( m_Mutex );
+        m_Queue.Append( Move( item ) );
+        ++m_NumPending;
+        ++m_NumQueued;
+        m_MaxDepth = Math::Max( m_MaxDepth, m_NumPending );
+    }
+    m_WakeSemaphore.Signal();
+    return true;
+}
+
+// Flush
+//------------------------------------------------------------------------------
+void CachePublishQueue::Flush( FBuildStats & outStats )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( Thread::IsMainThread() );
+
+    // Wait for outstanding items
+    const Timer t;
+    for ( ;; )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+            if ( m_NumPending == 0 )
+            {
+                break;
+            }
+        }
+        m_ItemCompleteSemaphore.Wait( 100 );
+    }
+    const uint32_t flushTimeMS = (uint32_t)t.GetElapsedMS();
+
+    MutexHolder mh( m_Mutex );
+
+    // Apply results to nodes, now that nothing else is using them
+    for ( const Result & result : m_Results )
+    {
+        result.m_Node->SetStatFlag( Node::STATS_CACHE_STORE );
+        result.m_Node->AddCachingTime( result.m_CachingTimeMS );
+    }
+    m_Results.Clear();
+
+    // Record stats for this build and reset for the next one
+    outStats.m_NumCacheStoresQueued = m_NumQueued;
+    outStats.m_NumCacheStoresQueueFull = m_NumQueueFull;
+    outStats.m_CacheStoreQueueMaxDepth = m_MaxDepth;
+    outStats.m_CacheStoreQueueTimeMS = (uint32_t)m_StoreTimeMS;
+    outStats.m_CacheStoreFlushTimeMS = flushTimeMS;
+    m_NumQueued = 0;
+    m_NumQueueFull = 0;
+    m_MaxDepth = 0;
+    m_StoreTimeMS = 0;
+}
+
+// ThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CachePublishQueue::ThreadFuncStatic( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "CachePublish" );
+
+    static_cast<CachePublishQueue *>( param )->ThreadFunc();
+    return 0;
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+void CachePublishQueue::ThreadFunc()
+{
+    for ( ;; )
+    {
+        // Get next item
+        Item item;
+        {
+            MutexHolder mh( m_Mutex );
+            if ( m_QueueHead < m_Queue.GetSize() )
+            {
+                item = Move( m_Queue[ m_QueueHead++ ] );
+                if ( m_QueueHead == m_Queue.GetSize() )
+                {
+                    m_Queue.Clear(); // Retains memory
+                    m_QueueHead = 0;
+                }
+            }
+            else if ( m_Quit.Load() )
+            {
+                return;
+            }
+        }
+        if ( item.m_Data == nullptr )
+        {
+            m_WakeSemaphore.Wait();
+            continue;
+        }
+
+        PROFILE_SECTION( "Publish" );
+        const Timer t;
+
+        // Compress
+        Compressor c;
+        const void * data = item.m_Data;
+        uint64_t dataSize = item.m_DataSize;
+        uint32_t compressionTimeMS = item.m_CompressionTimeMS;
+        if ( item.m_IsCompressed == false )
+        {
+            compressionTimeMS = ObjectNode::CompressForCache( item.m_Data, item.m_DataSize, c );
+            data = c.GetResult();
+            dataSize = c.GetResultSize();
+        }
+
+        // Store
+        uint32_t cachingTimeMS = 0;
+        const bool stored = item.m_Node->PublishToCache( item.m_CacheId, data, dataSize, compressionTimeMS, cachingTimeMS );
+        FREE( item.m_Data );
+
+        {
+            MutexHolder mh( m_Mutex );
+            if ( stored )
+            {
+                m_Results.Append( Result{ item.m_Node, cachingTimeMS } );
+            }
+            m_QueuedBytes -= item.m_DataSize;
+            --m_NumPending;
+            m_StoreTimeMS += (uint64_t)t.GetElapsedMS();
+        }
+        m_ItemCompleteSemaphore.Signal();
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+// CachePublishQueue - Store to the cache in the background
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+struct FBuildStats;
+class ObjectNode;
+
+// CachePublishQueue
+//  - Compression and publishing of cache entries is done on dedicated threads
+//    so that worker threads are free to continue compiling
+//  - Queued data is limited to a memory budget. When full, callers store the
+//    entry themselves (synchronously)
+//  - Results (stats flags and caching time) are applied to nodes by Flush,
+//    which must be called on the main thread at the end of each build
+//------------------------------------------------------------------------------
+class CachePublishQueue
+{
+public:
+    explicit CachePublishQueue( uint32_t memoryBudgetMiB );
+    ~CachePublishQueue();
+
+    // Returns false (without taking a copy of the data) if the queue is full
+    [[nodiscard]] bool Enqueue( ObjectNode * node,
+                                const AString & cacheId,
+                                const void * data,
+                                uint64_t dataSize,
+                                bool isCompressed,
+                                uint32_t compressionTimeMS );
+
+    // Wait for all queued entries to be stored and record stats for the build
+    void Flush( FBuildStats & outStats );
+
+    inline static const uint32_t kNumThreads = 4;
+
+private:
+    static uint32_t ThreadFuncStatic( void * param );
+    void ThreadFunc();
+
+    class Item
+    {
+    public:
+        ObjectNode * m_Node = nullptr;
+        AString m_CacheId;
+        void * m_Data = nullptr;
+        uint64_t m_DataSize = 0;
+        bool m_IsCompressed = false;
+        uint32_t m_CompressionTimeMS = 0;
+    };
+    class Result
+    {
+    public:
+        ObjectNode * m_Node;
+        uint32_t m_CachingTimeMS;
+    };
+
+    const uint64_t m_MemoryBudget;
+
+    Mutex m_Mutex;
+    Array<Item> m_Queue;
+    size_t m_QueueHead = 0; // Next item to process
+    uint64_t m_QueuedBytes = 0; // Including items being processed
+    uint32_t m_NumPending = 0; // Queued or being processed
+    Array<Result> m_Results; // Successful stores, to apply to nodes in Flush
+
+    // Stats for the current build
+    uint32_t m_NumQueued = 0;
+    uint32_t m_NumQueueFull = 0;
+    uint32_t m_MaxDepth = 0;
+    uint64_t m_StoreTimeMS = 0;
+
+    Semaphore m_WakeSemaphore;
+    Semaphore m_ItemCompleteSemaphore;
+    Atomic<bool> m_Quit;
+    Thread m_Threads[ kNumThreads ];
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,258 @@
+// HTTPCache - Cache on an HTTP server
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "HTTPCache.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Thread.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Tracing/Tracing.h"
+
+// Constants
+//------------------------------------------------------------------------------
+namespace
+{
+    // Delays before retrying a request the server didn't respond to. Gives
+    // a busy or restarting server time to recover before caching is disabled.
+    const uint32_t kRetryDelaysMS[] = { 100, 400, 1600 };
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+/*explicit*/ HTTPCache::HTTPCache() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+/*virtual*/ HTTPCache::~HTTPCache() = default;
+
+// IsHTTPPath
+//------------------------------------------------------------------------------
+/*static*/ bool HTTPCache::IsHTTPPath( const AString & cachePath )
+{
+    return cachePath.BeginsWithI( "http://" );
+}
+
+// Init
+//------------------------------------------------------------------------------
+/*virtual*/ bool HTTPCache::Init( const AString & cachePath,
+                                  const AString & /*cachePathMountPoint*/,
+                                  bool /*cacheRead*/,
+                                  bool /*cacheWrite*/,
+                                  bool cacheVerbose,
+                                  const AString & /*pluginDLLConfig*/ )
+{
+    PROFILE_FUNCTION;
+
+    m_URL = cachePath;
+    m_CacheVerbose = cacheVerbose;
+
+    AStackString host;
+    uint16_t port = 0;
+    if ( HTTPClient::ParseURL( m_URL, host, port, m_BasePath ) == false )
+    {
+        FLOG_WARN( "Cache inaccessible - Caching disabled (Invalid URL '%s')", m_URL.Get() );
+        return false;
+    }
+    if ( m_BasePath.EndsWith( '/' ) == false )
+    {
+        m_BasePath += '/';
+    }
+
+    // Check the server is reachable (any response will do, as servers
+    // differ in how they treat a request for the root)
+    uint32_t status = 0;
+    if ( ( m_Client.SetServer( host, port ) == false ) ||
+         ( m_Client.Request( "HEAD", m_BasePath, nullptr, 0, status ) == false ) )
+    {
+        FLOG_WARN( "Cache inaccessible - Caching disabled (URL '%s')", m_URL.Get() );
+        return false;
+    }
+
+    return true;
+}
+
+// Shutdown
+//------------------------------------------------------------------------------
+/*virtual*/ void HTTPCache::Shutdown()
+{
+    // Nothing to do
+}
+
+// Publish
+//------------------------------------------------------------------------------
+/*virtual*/ bool HTTPCache::Publish( const AString & cacheId, const void * data, size_t dataSize )
+{
+    uint32_t status = 0;
+    if ( Request( "PUT", cacheId, data, dataSize, status ) == false )
+    {
+        return false;
+    }
+    if ( ( status < 200 ) || ( status >= 300 ) )
+    {
+        if ( m_CacheVerbose )
+        {
+            FLOG_OUTPUT( "Cache: Store failed (HTTP %u) '%s'\n", status, cacheId.Get() );
+        }
+        return false;
+    }
+    return true;
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+/*virtual*/ bool HTTPCache::Retrieve( const AString & cacheId, void *& data, size_t & dataSize )
+{
+    data = nullptr;
+    dataSize = 0;
+
+    uint32_t status = 0;
+    void * body = nullptr;
+    size_t bodySize = 0;
+    if ( Request( "GET", cacheId, nullptr, 0, status, &body, &bodySize ) == false )
+    {
+        return false;
+    }
+    if ( status != 200 )
+    {
+        FREE( body );
+        if ( m_CacheVerbose && ( status == HTTPClient::kStatusResponseTooLarge ) )
+        {
+            FLOG_OUTPUT( "Cache: Retrieve failed (Entry too large) '%s'\n", cacheId.Get() );
+        }
+        else if ( m_CacheVerbose && ( status != 404 ) ) // 404 is a normal miss
+        {
+            FLOG_OUTPUT( "Cache: Retrieve failed (HTTP %u) '%s'\n", status, cacheId.Get() );
+        }
+        return false;
+    }
+
+    data = body;
+    dataSize = bodySize;
+    return true;
+}
+
+// FreeMemory
+//------------------------------------------------------------------------------
+/*virtual*/ void HTTPCache::FreeMemory( void * data, size_t /*dataSize*/ )
+{
+    FREE( data );
+}
+
+// OutputInfo
+//------------------------------------------------------------------------------
+/*virtual*/ bool HTTPCache::OutputInfo( bool /*showProgress*/ )
+{
+    // Server side storage is managed by the server
+    OUTPUT( "HTTP cache (%s) does not support OutputInfo.\n", m_URL.Get() );
+    return false;
+}
+
+// Trim
+//------------------------------------------------------------------------------
+/*virtual*/ bool HTTPCache::Trim( bool /*showProgress*/, uint32_t /*sizeMiB*/ )
+{
+    // Server side storage is managed by the server
+    OUTPUT( "HTTP cache (%s) does not support Trim.\n", m_URL.Get() );
+    return false;
+}
+
+// Query
+//------------------------------------------------------------------------------
+/*virtual*/ bool HTTPCache::Query( const Array<AString> & cacheIds, Array<bool> & outFound )
+{
+    PROFILE_FUNCTION;
+
+    // Servers offer no common batched check, so the checks are pipelined
+    // instead, avoiding a round trip per key
+    Array<AString> paths;
+    paths.SetCapacity( cacheIds.GetSize() );
+    for ( const AString & cacheId : cacheIds )
+    {
+        AString & path = paths.EmplaceBack( m_BasePath );
+        path += cacheId;
+    }
+
+    Array<uint32_t> statuses;
+    for ( uint32_t attempt = 0; ; ++attempt )
+    {
+        if ( m_Unavailable.Load() )
+        {
+            return false;
+        }
+        if ( m_Client.RequestMany( "HEAD", paths, statuses ) )
+        {
+            break;
+        }
+        if ( RetryAfterFailure( attempt ) == false )
+        {
+            return false;
+        }
+    }
+
+    outFound.SetSize( cacheIds.GetSize() );
+    for ( size_t i = 0; i < cacheIds.GetSize(); ++i )
+    {
+        outFound[ i ] = ( statuses[ i ] == 200 );
+    }
+    return true;
+}
+
+// Request
+//------------------------------------------------------------------------------
+bool HTTPCache::Request( const char * method,
+                         const AString & cacheId,
+                         const void * body,
+                         size_t bodySize,
+                         uint32_t & outStatus,
+                         void ** outBody,
+                         size_t * outBodySize )
+{
+    PROFILE_FUNCTION;
+
+    AStackString path( m_BasePath );
+    path += cacheId;
+    for ( uint32_t attempt = 0; ; ++attempt )
+    {
+        // Avoid waiting for timeouts on every request once the server is gone
+        if ( m_Unavailable.Load() )
+        {
+            return false;
+        }
+        if ( m_Client.Request( method, path, body, bodySize, outStatus, outBody, outBodySize ) )
+        {
+            return true;
+        }
+        if ( RetryAfterFailure( attempt ) == false )
+        {
+            return false;
+        }
+    }
+}
+
+// RetryAfterFailure
+//------------------------------------------------------------------------------
+bool HTTPCache::RetryAfterFailure( uint32_t attempt )
+{
+    if ( attempt < ARRAY_SIZE( kRetryDelaysMS ) )
+    {
+        Thread::Sleep( kRetryDelaysMS[ attempt ] );
+        return true;
+    }
+
+    if ( m_Unavailable.Load() == false )
+    {
+        m_Unavailable.Store( true );
+        FLOG_WARN( "Cache inaccessible - Caching disabled (URL '%s')", m_URL.Get() );
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
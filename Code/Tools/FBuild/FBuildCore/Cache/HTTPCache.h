@@ -0,0 +1,69 @@
+// HTTPCache - Cache on an HTTP server
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+
+// Core
+#include "Core/Network/HTTPClient.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Strings/AString.h"
+
+// HTTPCache
+//  - Used when the cache path is an http:// URL
+//  - Entries are stored as <url>/<cacheId> using PUT, retrieved using GET and
+//    checked for using HEAD, as supported by common build cache servers
+//  - Connections are kept alive and shared by all threads
+//  - Query pipelines its HEAD requests, as there is no common batched
+//    existence check, so keys are checked in batches of one round trip each
+//  - Failed requests are retried with backoff; caching is only disabled if
+//    the server remains unreachable
+//  - Entries are transferred whole, in memory (no streaming of large entries)
+//    and are limited in size
+//------------------------------------------------------------------------------
+class HTTPCache : public ICache
+{
+public:
+    explicit HTTPCache();
+    virtual ~HTTPCache() override;
+
+    static bool IsHTTPPath( const AString & cachePath );
+
+    virtual bool Init( const AString & cachePath,
+                       const AString & cachePathMountPoint,
+                       bool cacheRead,
+                       bool cacheWrite,
+                       bool cacheVerbose,
+                       const AString & pluginDLLConfig ) override;
+    virtual void Shutdown() override;
+    virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override;
+    virtual bool Retrieve( const AString & cacheId, void *& data, size_t & dataSize ) override;
+    virtual void FreeMemory( void * data, size_t dataSize ) override;
+    virtual bool OutputInfo( bool showProgress ) override;
+    virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual bool Query( const Array<AString> & cacheIds, Array<bool> & outFound ) override;
+
+    // Connections opened since creation (for verifying re-use)
+    uint32_t GetNumConnectionsOpened() const { return m_Client.GetNumConnectionsOpened(); }
+
+private:
+    bool Request( const char * method,
+                  const AString & cacheId,
+                  const void * body,
+                  size_t bodySize,
+                  uint32_t & outStatus,
+                  void ** outBody = nullptr,
+                  size_t * outBodySize = nullptr );
+    bool RetryAfterFailure( uint32_t attempt );
+
+    AString m_URL;
+    AString m_BasePath; // Path on server, with trailing slash
+    bool m_CacheVerbose = false;
+    Atomic<bool> m_Unavailable; // Server stopped responding
+    HTTPClient m_Client;
+};
+
+//------------------------------------------------------------------------------
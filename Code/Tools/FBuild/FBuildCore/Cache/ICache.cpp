@@ -5,8 +5,16 @@
 //------------------------------------------------------------------------------
 #include "ICache.h"
 
+#include <Core/Containers/Array.h>
 #include <Core/Strings/AString.h>
 
+// Query
+//------------------------------------------------------------------------------
+/*virtual*/ bool ICache::Query( const Array<AString> & /*cacheIds*/, Array<bool> & /*outFound*/ )
+{
+    return false; // Not supported by default
+}
+
 // GetCacheId
 //------------------------------------------------------------------------------
 /*static*/ void ICache::GetCacheId( const uint64_t preprocessedSourceKey,
@@ -16,7 +24,7 @@
                                     AString & outCacheId )
 {
     // cache version - bump if cache format is changed
-    const char cacheVersion( 'I' );
+    const char cacheVersion( 'J' );
 
     // format example: 2377DE32AB045A2D_FED872A1_AB62FEAA23498AAC-32A2B04375A2D7DE.7
     outCacheId.Format( "%016" PRIX64 "_%08X_%016" PRIX64 "-%016" PRIX64 ".%c",
@@ -9,6 +9,7 @@
 // Forward Declarations
 //------------------------------------------------------------------------------
 class AString;
+template <class T> class Array;
 
 // Cache
 //------------------------------------------------------------------------------
@@ -31,6 +32,10 @@ public:
     virtual bool OutputInfo( bool showProgress ) = 0;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) = 0;
 
+    // Optional: check for the existence of several entries at once. Returns
+    // false if not supported, in which case outFound is not valid.
+    virtual bool Query( const Array<AString> & cacheIds, Array<bool> & outFound );
+
     // Helper functions
     static void GetCacheId( const uint64_t preprocessedSourceKey,
                             const uint32_t commandLineKey,
@@ -17,16 +17,21 @@
 
 // Core
 #include "Core/Env/ErrorFormat.h"
+#include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryMappedFile.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Math/xxHash.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Process/Mutex.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 
 // System
 #include <stdarg.h> // for va_start
+#include <string.h> // for memcmp, memcpy
 
 // Include Type
 //------------------------------------------------------------------------------
@@ -57,11 +62,18 @@ public:
 
     ~IncludedFile();
 
+    // Persistence in the IncludedFileIndex
+    bool Load( ConstMemoryStream & stream );
+    void Save( IOStream & stream ) const;
+
     uint64_t m_FileNameHash;
     AString m_FileName;
     bool m_Exists;
+    bool m_CanPersist; // Parsed without errors, so can be saved to the index
     uint64_t m_RelativePathHash;
     uint64_t m_ContentHash;
+    uint64_t m_LastWriteTime;
+    uint64_t m_FileSize;
     Array<Include> m_Includes;
     Array<const IncludeDefine *> m_IncludeDefines;
     Array<uint64_t> m_NonIncludeDefines;
@@ -125,6 +137,9 @@ public:
         m_Elts = 0;
     }
 
+    // Access all slots (unused slots are nullptr)
+    const Array<IncludedFile *> & GetSlots() const { return m_Buckets; }
+
 private:
     IncludedFile ** InternalFind( const AString & fileName, uint64_t fileNameHash )
     {
@@ -218,6 +233,91 @@ IncludedFile::~IncludedFile()
     }
 }
 
+// Load
+//------------------------------------------------------------------------------
+bool IncludedFile::Load( ConstMemoryStream & stream )
+{
+    // Is the record still valid? (m_LastWriteTime and m_FileSize must already be set)
+    uint64_t lastWriteTime;
+    uint64_t fileSize;
+    if ( ( stream.Read( lastWriteTime ) == false ) ||
+         ( stream.Read( fileSize ) == false ) ||
+         ( lastWriteTime != m_LastWriteTime ) ||
+         ( fileSize != m_FileSize ) )
+    {
+        return false; // File has changed since it was parsed
+    }
+
+    AString fileName;
+    uint32_t numIncludes = 0;
+    bool ok = stream.Read( m_ContentHash ) &&
+              stream.Read( fileName ) &&
+              stream.Read( numIncludes );
+    for ( uint32_t i = 0; ok && ( i < numIncludes ); ++i )
+    {
+        uint8_t type;
+        AString include;
+        ok = stream.Read( type ) && stream.Read( include );
+        if ( ok )
+        {
+            m_Includes.EmplaceBack( Move( include ), static_cast<IncludeType>( type ) );
+        }
+    }
+    uint32_t numIncludeDefines = 0;
+    ok = ok && stream.Read( numIncludeDefines );
+    for ( uint32_t i = 0; ok && ( i < numIncludeDefines ); ++i )
+    {
+        uint8_t type;
+        AString macro;
+        AString include;
+        ok = stream.Read( type ) && stream.Read( macro ) && stream.Read( include );
+        if ( ok )
+        {
+            m_IncludeDefines.Append( FNEW( IncludeDefine( macro, include, static_cast<IncludeType>( type ) ) ) );
+        }
+    }
+    ok = ok && stream.Read( m_NonIncludeDefines );
+
+    if ( ok == false )
+    {
+        // Corrupt record - discard anything partially loaded
+        m_Includes.Clear();
+        for ( const IncludeDefine * def : m_IncludeDefines )
+        {
+            FDELETE def;
+        }
+        m_IncludeDefines.Clear();
+        m_NonIncludeDefines.Clear();
+        m_ContentHash = 0;
+    }
+    return ok;
+}
+
+// Save
+//------------------------------------------------------------------------------
+void IncludedFile::Save( IOStream & stream ) const
+{
+    // NOTE: IncludedFileIndex relies on the layout of the first 4 fields
+    stream.Write( m_LastWriteTime );
+    stream.Write( m_FileSize );
+    stream.Write( m_ContentHash );
+    stream.Write( m_FileName );
+    stream.Write( (uint32_t)m_Includes.GetSize() );
+    for ( const Include & include : m_Includes )
+    {
+        stream.Write( static_cast<uint8_t>( include.m_Type ) );
+        stream.Write( include.m_Include );
+    }
+    stream.Write( (uint32_t)m_IncludeDefines.GetSize() );
+    for ( const IncludeDefine * def : m_IncludeDefines )
+    {
+        stream.Write( static_cast<uint8_t>( def->m_Type ) );
+        stream.Write( def->m_Macro );
+        stream.Write( def->m_Include );
+    }
+    stream.Write( m_NonIncludeDefines );
+}
+
 // IncludedFileBucket
 //------------------------------------------------------------------------------
 PRAGMA_DISABLE_PUSH_MSVC( 4324 ) // structure was padded due to alignment specifier
@@ -244,6 +344,171 @@ PRAGMA_DISABLE_POP_MSVC // 4324
 #define LIGHTCACHE_HASH_TO_BUCKET( hash ) ( ( ( hash ) >> ( 64ULL - LIGHTCACHE_NUM_BUCKET_BITS ) ) & LIGHTCACHE_BUCKET_MASK_BASE )
 static IncludedFileBucket g_AllIncludedFiles[ LIGHTCACHE_NUM_BUCKETS ];
 
+// IncludedFileIndex
+//------------------------------------------------------------------------------
+// Files parsed by previous builds, persisted to disk and memory-mapped on load.
+// Entries are validated lazily (against the file's last write time and size)
+// the first time they are needed.
+//
+// Layout:
+//  - Header
+//  - Entry table, sorted by file name hash
+//  - Records (IncludedFile data)
+class IncludedFileIndex
+{
+public:
+    class Header
+    {
+    public:
+        Header()
+        {
+            m_Identifier[ 0 ] = 'L';
+            m_Identifier[ 1 ] = 'C';
+            m_Identifier[ 2 ] = 'I';
+            m_Version = kCurrentVersion;
+            m_NumEntries = 0;
+        }
+
+        inline static const uint8_t kCurrentVersion = 1;
+
+        bool IsValid() const
+        {
+            return ( ( m_Identifier[ 0 ] == 'L' ) &&
+                     ( m_Identifier[ 1 ] == 'C' ) &&
+                     ( m_Identifier[ 2 ] == 'I' ) &&
+                     ( m_Version == kCurrentVersion ) );
+        }
+
+        char m_Identifier[ 3 ];
+        uint8_t m_Version;
+        uint32_t m_NumEntries;
+    };
+
+    class Entry
+    {
+    public:
+        bool operator<( const Entry & other ) const { return ( m_FileNameHash < other.m_FileNameHash ); }
+
+        uint64_t m_FileNameHash;
+        uint32_t m_Offset; // Offset of record, relative to start of records
+        uint32_t m_Size; // Size of record
+    };
+
+    bool Load( const char * fileName )
+    {
+        Unload();
+        if ( m_File.Open( fileName ) == false )
+        {
+            return false; // No index (first build, or DB was deleted)
+        }
+
+        // Check header and table fit
+        const size_t fileSize = m_File.GetSize();
+        const Header * header = static_cast<const Header *>( m_File.GetData() );
+        if ( ( fileSize < sizeof( Header ) ) ||
+             ( header->IsValid() == false ) ||
+             ( ( fileSize - sizeof( Header ) ) < ( (uint64_t)header->m_NumEntries * sizeof( Entry ) ) ) )
+        {
+            FLOG_VERBOSE( "LightCache index '%s' is incompatible or corrupt - ignoring", fileName );
+            Unload();
+            return false;
+        }
+
+        m_Entries = reinterpret_cast<const Entry *>( header + 1 );
+        m_NumEntries = header->m_NumEntries;
+        m_Records = reinterpret_cast<const char *>( m_Entries + m_NumEntries );
+        m_RecordsSize = ( fileSize - (size_t)( m_Records - static_cast<const char *>( m_File.GetData() ) ) );
+        return true;
+    }
+
+    void Unload()
+    {
+        m_File.Close();
+        m_Entries = nullptr;
+        m_NumEntries = 0;
+        m_Records = nullptr;
+        m_RecordsSize = 0;
+    }
+
+    // Find the record for the given file (not validated against the file on disk)
+    bool Find( const AString & fileName, uint64_t fileNameHash, ConstMemoryStream & outRecord ) const
+    {
+        // Binary search for first entry with this hash
+        size_t low = 0;
+        size_t high = m_NumEntries;
+        while ( low < high )
+        {
+            const size_t mid = ( low + high ) / 2;
+            if ( m_Entries[ mid ].m_FileNameHash < fileNameHash )
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        // Check all entries with this hash (collisions are possible)
+        for ( size_t i = low; ( i < m_NumEntries ) && ( m_Entries[ i ].m_FileNameHash == fileNameHash ); ++i )
+        {
+            const char * record = GetRecord( m_Entries[ i ] );
+            if ( record && RecordMatches( record, m_Entries[ i ].m_Size, fileName ) )
+            {
+                outRecord.Replace( record, m_Entries[ i ].m_Size, false );
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t GetNumEntries() const { return m_NumEntries; }
+    const Entry & GetEntry( size_t index ) const { return m_Entries[ index ]; }
+
+    // Get record data, or nullptr if entry is out of bounds (corrupt)
+    const char * GetRecord( const Entry & entry ) const
+    {
+        if ( ( (uint64_t)entry.m_Offset + entry.m_Size ) > m_RecordsSize )
+        {
+            return nullptr;
+        }
+        return ( m_Records + entry.m_Offset );
+    }
+
+    // Record layout begins with the last write time, size and content hash,
+    // followed by the file name
+    static const size_t kRecordFileNameOffset = ( sizeof( uint64_t ) * 3 );
+    static bool RecordMatches( const char * record, uint32_t recordSize, const AString & fileName )
+    {
+        if ( recordSize < ( kRecordFileNameOffset + sizeof( uint32_t ) ) )
+        {
+            return false;
+        }
+        uint32_t len;
+        memcpy( &len, record + kRecordFileNameOffset, sizeof( uint32_t ) );
+        if ( ( len != fileName.GetLength() ) ||
+             ( ( kRecordFileNameOffset + sizeof( uint32_t ) + len ) > recordSize ) )
+        {
+            return false;
+        }
+        return ( memcmp( record + kRecordFileNameOffset + sizeof( uint32_t ), fileName.Get(), len ) == 0 );
+    }
+    static bool GetRecordFileName( const char * record, uint32_t recordSize, AString & outFileName )
+    {
+        ConstMemoryStream ms( record, recordSize );
+        return ( ms.Seek( kRecordFileNameOffset ) && ms.Read( outFileName ) );
+    }
+
+private:
+    MemoryMappedFile m_File;
+    const Entry * m_Entries = nullptr;
+    size_t m_NumEntries = 0;
+    const char * m_Records = nullptr;
+    size_t m_RecordsSize = 0;
+};
+static IncludedFileIndex g_IncludedFileIndex;
+static Atomic<bool> g_IncludedFileIndexDirty( false );
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 LightCache::LightCache()
@@ -357,6 +622,131 @@ bool LightCache::Hash( ObjectNode * node,
     {
         bucket.Destruct();
     }
+    g_IncludedFileIndex.Unload();
+    g_IncludedFileIndexDirty.Store( false );
+}
+
+// LoadIndex
+//------------------------------------------------------------------------------
+/*static*/ void LightCache::LoadIndex( const char * nodeGraphDBFile )
+{
+    PROFILE_FUNCTION;
+
+    AStackString indexFile;
+    GetIndexFileName( nodeGraphDBFile, indexFile );
+
+    // Map the index. Entries are validated as they are used.
+    g_IncludedFileIndex.Load( indexFile.Get() );
+}
+
+// SaveIndex
+//------------------------------------------------------------------------------
+/*static*/ void LightCache::SaveIndex( const char * nodeGraphDBFile )
+{
+    PROFILE_FUNCTION;
+
+    // Avoid re-writing the index if nothing new was parsed
+    if ( g_IncludedFileIndexDirty.Load() == false )
+    {
+        return;
+    }
+
+    Array<IncludedFileIndex::Entry> entries;
+    MemoryStream records( 1024 * 1024, 1024 * 1024 );
+
+    // Files handled during this build
+    for ( IncludedFileBucket & bucket : g_AllIncludedFiles )
+    {
+        MutexHolder mh( bucket.m_Mutex );
+        for ( const IncludedFile * file : bucket.m_HashSet.GetSlots() )
+        {
+            if ( ( file == nullptr ) || ( file->m_Exists == false ) || ( file->m_CanPersist == false ) )
+            {
+                continue;
+            }
+            const uint64_t offset = records.Tell();
+            file->Save( records );
+            entries.Append( IncludedFileIndex::Entry{ file->m_FileNameHash,
+                                                      (uint32_t)offset,
+                                                      (uint32_t)( records.Tell() - offset ) } );
+        }
+    }
+
+    // Carry forward entries from previous builds for files not used by this
+    // one (e.g. files only used by other targets or configs). Files handled
+    // this build replace their previous entry (or drop it, if changed or deleted).
+    AString fileName;
+    for ( size_t i = 0; i < g_IncludedFileIndex.GetNumEntries(); ++i )
+    {
+        const IncludedFileIndex::Entry & entry = g_IncludedFileIndex.GetEntry( i );
+        const char * record = g_IncludedFileIndex.GetRecord( entry );
+        if ( ( record == nullptr ) ||
+             ( IncludedFileIndex::GetRecordFileName( record, entry.m_Size, fileName ) == false ) )
+        {
+            continue; // Corrupt entry
+        }
+
+        // Handled this build?
+        IncludedFileBucket & bucket = g_AllIncludedFiles[ LIGHTCACHE_HASH_TO_BUCKET( entry.m_FileNameHash ) ];
+        {
+            MutexHolder mh( bucket.m_Mutex );
+            if ( bucket.m_HashSet.Find( fileName, entry.m_FileNameHash ) )
+            {
+                continue;
+            }
+        }
+
+        const uint64_t offset = records.Tell();
+        records.WriteBuffer( record, entry.m_Size );
+        entries.Append( IncludedFileIndex::Entry{ entry.m_FileNameHash, (uint32_t)offset, entry.m_Size } );
+    }
+
+    // Offsets are 32-bit
+    if ( records.GetSize() > 0xFFFFFFFF )
+    {
+        FLOG_WARN( "LightCache index too large to save (%" PRIu64 " bytes)", (uint64_t)records.GetSize() );
+        return;
+    }
+
+    entries.Sort();
+
+    IncludedFileIndex::Header header;
+    header.m_NumEntries = (uint32_t)entries.GetSize();
+
+    // Release existing mapping so the file can be replaced
+    g_IncludedFileIndex.Unload();
+
+    AStackString indexFile;
+    GetIndexFileName( nodeGraphDBFile, indexFile );
+    FileStream f;
+    if ( ( f.Open( indexFile.Get(), FileStream::WRITE_ONLY ) == false ) ||
+         ( f.WriteBuffer( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( f.WriteBuffer( entries.Begin(), entries.GetSize() * sizeof( IncludedFileIndex::Entry ) ) != ( entries.GetSize() * sizeof( IncludedFileIndex::Entry ) ) ) ||
+         ( f.WriteBuffer( records.GetData(), records.GetSize() ) != records.GetSize() ) )
+    {
+        FLOG_WARN( "Failed to save LightCache index '%s'. Error: %s", indexFile.Get(), LAST_ERROR_STR );
+        if ( f.IsOpen() )
+        {
+            f.Close();
+        }
+        FileIO::FileDelete( indexFile.Get() ); // Don't leave a partial index
+        return;
+    }
+    f.Close();
+
+    g_IncludedFileIndexDirty.Store( false );
+
+    // Keep using the index for subsequent builds in this process
+    g_IncludedFileIndex.Load( indexFile.Get() );
+}
+
+// GetIndexFileName
+//------------------------------------------------------------------------------
+/*static*/ void LightCache::GetIndexFileName( const char * nodeGraphDBFile, AString & outFileName )
+{
+    // Index lives alongside the DB (i.e. fbuild.fdb -> fbuild.fdb.lightcache)
+    outFileName = nodeGraphDBFile;
+    outFileName += ".lightcache";
 }
 
 // Parse
@@ -934,7 +1324,10 @@ const IncludedFile * LightCache::FileExists( const AString & fileName )
     newFile->m_FileNameHash = fileNameHash;
     newFile->m_FileName = fileName;
     newFile->m_Exists = false;
+    newFile->m_CanPersist = false;
     newFile->m_ContentHash = 0;
+    newFile->m_LastWriteTime = 0;
+    newFile->m_FileSize = 0;
     if ( m_BasePath.IsEmpty() == false )
     {
         AStackString relativePath;
@@ -942,6 +1335,30 @@ const IncludedFile * LightCache::FileExists( const AString & fileName )
         newFile->m_RelativePathHash = xxHash3::Calc64( relativePath );
     }
 
+    // Was the file parsed by a previous build, and is that still valid?
+    FileIO::FileInfo fileInfo;
+    const bool gotFileInfo = FileIO::GetFileInfo( fileName, fileInfo );
+    if ( gotFileInfo )
+    {
+        newFile->m_LastWriteTime = fileInfo.m_LastWriteTime;
+        newFile->m_FileSize = fileInfo.m_Size;
+
+        ConstMemoryStream record;
+        if ( g_IncludedFileIndex.Find( fileName, fileNameHash, record ) &&
+             newFile->Load( record ) )
+        {
+            newFile->m_Exists = true;
+            newFile->m_CanPersist = true;
+
+            // Store to shared cache
+            const IncludedFile * retval = bucket.m_HashSet.Insert( newFile );
+
+            m_IncludeDefines.Append( retval->m_IncludeDefines );
+
+            return retval;
+        }
+    }
+
     // Try to open the new file
     FileStream f;
     if ( f.Open( fileName.Get() ) == false )
@@ -952,8 +1369,16 @@ const IncludedFile * LightCache::FileExists( const AString & fileName )
 
     // File exists - parse it
     newFile->m_Exists = true;
+    const uint32_t errorsLength = m_Errors.GetLength();
     Parse( newFile, f );
 
+    // Only files which were fully understood can be persisted
+    if ( gotFileInfo && ( m_Errors.GetLength() == errorsLength ) )
+    {
+        newFile->m_CanPersist = true;
+        g_IncludedFileIndexDirty.Store( true );
+    }
+
     // Store to shared cache
     const IncludedFile * retval = bucket.m_HashSet.Insert( newFile );
 
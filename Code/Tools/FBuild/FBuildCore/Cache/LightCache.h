@@ -40,7 +40,13 @@ public:
 
     static void ClearCachedFiles();
 
+    // Persistence of parsed files between builds
+    static void LoadIndex( const char * nodeGraphDBFile );
+    static void SaveIndex( const char * nodeGraphDBFile );
+
 protected:
+    static void GetIndexFileName( const char * nodeGraphDBFile, AString & outFileName );
+
     void Parse( IncludedFile * file, FileStream & f );
     bool ParseDirective( IncludedFile & file, const char *& pos );
     bool ParseDirective_Include( IncludedFile & file, const char *& pos );
@@ -0,0 +1,1630 @@
+// PackedCache - Cache storing entries in large segment files
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "PackedCache.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/Env/ErrorFormat.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Process.h"
+#include "Core/Process/Thread.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+#include "Core/Time/Timer.h"
+#include "Core/Tracing/Tracing.h"
+
+// system
+#include <string.h> // for memcpy, memcmp
+
+// Constants
+//------------------------------------------------------------------------------
+namespace
+{
+    const uint32_t kSegmentSize = ( 256 * 1024 * 1024 ); // Start a new segment beyond this size
+    const uint32_t kMinBuckets = ( 64 * 1024 );
+    const uint32_t kRecordMagic = ( 'F' | ( 'P' << 8 ) | ( 'C' << 16 ) | ( 'R' << 24 ) );
+
+    // Entries in use are re-written to the newest segment once their copy is
+    // this old, so that segments age in (approximately) least recently used order
+    const uint32_t kPromoteAfterMins = ( 4 * 60 );
+
+    // Access times are only reported in days, so uses within this time of the
+    // previous one aren't recorded
+    const uint32_t kAccessTimeGranularityMins = 60;
+
+    // The index lock is only held while the index is written, so one older than
+    // this was left by a process which exited (or a machine which went away)
+    // while holding it. A holder checks the lock is still its own before
+    // replacing the index, in case it was broken regardless.
+    const uint32_t kStaleLockSecs = ( 10 * 60 );
+
+    // Wait this long for the index lock before giving up
+    const float kLockTimeoutSecs = 10.0f;
+
+    // Changes since the table was written are held in a table of their own
+    const uint32_t kMinOverlayBuckets = 1024;
+
+    // The journal is loaded by every process using the cache, so it is folded
+    // into the table once it reaches this size
+    const uint64_t kMaxJournalSize = ( 1024 * 1024 );
+
+    // Buckets read and written together when the table is updated in place
+    const uint32_t kPatchWindowBuckets = 2048;
+
+    const char * const kIndexFileName = "index.fpci";
+    const char * const kJournalFileName = "index.fpcj";
+    const char * const kLockFileName = "index.fpcl";
+    const char * const kSegmentExtension = ".fpcs";
+    const char * const kSegmentClaimExtension = ".fpcw";
+
+    // Returns index of value, or size of array if not found
+    size_t FindSorted( const Array<uint32_t> & sortedValues, uint32_t value )
+    {
+        size_t begin = 0;
+        size_t end = sortedValues.GetSize();
+        while ( begin < end )
+        {
+            const size_t mid = ( begin + ( end - begin ) / 2 );
+            if ( sortedValues[ mid ] < value )
+            {
+                begin = mid + 1;
+            }
+            else
+            {
+                end = mid;
+            }
+        }
+        return ( ( begin < sortedValues.GetSize() ) && ( sortedValues[ begin ] == value ) ) ? begin : sortedValues.GetSize();
+    }
+    bool ContainsSorted( const Array<uint32_t> & sortedValues, uint32_t value )
+    {
+        return ( FindSorted( sortedValues, value ) < sortedValues.GetSize() );
+    }
+
+    // Read/write consecutive buckets of the table in an index file
+    bool ReadBuckets( const FileStream & f, uint32_t firstBucket, Array<PackedCache::IndexEntry> & outBuckets )
+    {
+        const uint64_t size = ( outBuckets.GetSize() * sizeof( PackedCache::IndexEntry ) );
+        const uint64_t offset = ( sizeof( PackedCache::IndexHeader ) + ( firstBucket * (uint64_t)sizeof( PackedCache::IndexEntry ) ) );
+        return ( f.ReadBufferAt( outBuckets.Begin(), size, offset ) == size );
+    }
+    bool WriteBuckets( const FileStream & f, uint32_t firstBucket, const Array<PackedCache::IndexEntry> & buckets )
+    {
+        const uint64_t size = ( buckets.GetSize() * sizeof( PackedCache::IndexEntry ) );
+        const uint64_t offset = ( sizeof( PackedCache::IndexHeader ) + ( firstBucket * (uint64_t)sizeof( PackedCache::IndexEntry ) ) );
+        return ( f.WriteBufferAt( buckets.Begin(), size, offset ) == size );
+    }
+}
+
+// RecordHeader - Precedes each entry in a segment
+//------------------------------------------------------------------------------
+class PackedCache::RecordHeader
+{
+public:
+    uint32_t m_Magic;
+    uint32_t m_DataSize;
+    char m_CacheId[ 64 ]; // Null terminated
+};
+static_assert( sizeof( PackedCache::IndexHeader ) == 16, "Unexpected IndexHeader size" );
+static_assert( sizeof( PackedCache::IndexEntry ) == 32, "Unexpected IndexEntry size" );
+static_assert( sizeof( PackedCache::JournalRecord ) == 32, "Unexpected JournalRecord size" );
+
+// IndexLock - Held while the index or journal are modified
+//  - A file created exclusively, which works across machines sharing the store
+//------------------------------------------------------------------------------
+class PackedCache::IndexLock
+{
+public:
+    explicit IndexLock( const PackedCache & cache );
+    ~IndexLock();
+
+    bool IsLocked() const { return m_File.IsOpen(); }
+    bool IsStillLocked() const; // Not broken by another process meanwhile
+
+private:
+    AString m_FileName;
+    FileStream m_File;
+    uint64_t m_LockTime = 0;
+};
+
+// IndexLock (CONSTRUCTOR)
+//------------------------------------------------------------------------------
+PackedCache::IndexLock::IndexLock( const PackedCache & cache )
+{
+    cache.GetLockFileName( m_FileName );
+
+    const Timer timer;
+    while ( m_File.Open( m_FileName.Get(), FileStream::CREATE_NEW_READ_WRITE ) == false )
+    {
+        // Remove locks abandoned by processes which didn't exit cleanly
+        const uint64_t lockTime = FileIO::GetFileLastWriteTime( m_FileName );
+        const uint64_t now = Time::FileTimeToSeconds( Time::GetCurrentFileTime() );
+        if ( ( lockTime != 0 ) && ( now > ( Time::FileTimeToSeconds( lockTime ) + kStaleLockSecs ) ) )
+        {
+            FileIO::FileDelete( m_FileName.Get() );
+            continue;
+        }
+
+        if ( timer.GetElapsed() > kLockTimeoutSecs )
+        {
+            // Callers drop their changes, rather than writing without the lock
+            FLOG_WARN( "Timed out waiting for cache index lock '%s'", m_FileName.Get() );
+            return;
+        }
+        Thread::Sleep( 10 );
+    }
+
+    // Identifies our lock, as opposed to one created after ours was removed
+    m_LockTime = FileIO::GetFileLastWriteTime( m_FileName );
+}
+
+// IndexLock (DESTRUCTOR)
+//------------------------------------------------------------------------------
+PackedCache::IndexLock::~IndexLock()
+{
+    if ( m_File.IsOpen() )
+    {
+        const bool stillLocked = IsStillLocked();
+        m_File.Close();
+        if ( stillLocked )
+        {
+            FileIO::FileDelete( m_FileName.Get() ); // Don't remove a lock taken by someone else
+        }
+    }
+}
+
+// IndexLock::IsStillLocked
+//------------------------------------------------------------------------------
+bool PackedCache::IndexLock::IsStillLocked() const
+{
+    return ( IsLocked() &&
+             ( m_LockTime != 0 ) &&
+             ( FileIO::GetFileLastWriteTime( m_FileName ) == m_LockTime ) );
+}
+
+// IndexHeader (CONSTRUCTOR)
+//------------------------------------------------------------------------------
+PackedCache::IndexHeader::IndexHeader()
+{
+    m_Identifier[ 0 ] = 'P';
+    m_Identifier[ 1 ] = 'C';
+    m_Identifier[ 2 ] = 'I';
+    m_Version = kCurrentVersion;
+    m_NumBuckets = 0;
+    m_NumEntries = 0;
+    m_Padding = 0;
+}
+
+// IndexHeader::IsValid
+//------------------------------------------------------------------------------
+bool PackedCache::IndexHeader::IsValid() const
+{
+    return ( ( m_Identifier[ 0 ] == 'P' ) &&
+             ( m_Identifier[ 1 ] == 'C' ) &&
+             ( m_Identifier[ 2 ] == 'I' ) &&
+             ( m_Version == kCurrentVersion ) &&
+             ( m_NumBuckets >= kMinBuckets ) &&
+             ( ( m_NumBuckets & ( m_NumBuckets - 1 ) ) == 0 ) &&
+             ( m_NumEntries < m_NumBuckets ) );
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+/*explicit*/ PackedCache::PackedCache() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+/*virtual*/ PackedCache::~PackedCache() = default;
+
+// Init
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::Init( const AString & cachePath,
+                                    const AString & cachePathMountPoint,
+                                    bool /*cacheRead*/,
+                                    bool cacheWrite,
+                                    bool /*cacheVerbose*/,
+                                    const AString & /*pluginDLLConfig*/ )
+{
+    PROFILE_FUNCTION;
+
+    // Check cache mount point if option is enabled
+#if defined( __WINDOWS__ )
+    (void)cachePathMountPoint; // Not supported on Windows
+#else
+    if ( cachePathMountPoint.IsEmpty() == false )
+    {
+        if ( FileIO::GetDirectoryIsMountPoint( cachePathMountPoint ) == false )
+        {
+            FLOG_WARN( "Caching disabled because '%s' is not a mount point", cachePathMountPoint.Get() );
+            return false;
+        }
+    }
+#endif
+
+    // Kept apart from the entries of a non-packed cache using the same path
+    m_CachePath = cachePath;
+    PathUtils::EnsureTrailingSlash( m_CachePath );
+    m_CachePath += "packed";
+    m_CachePath += NATIVE_SLASH;
+    if ( FileIO::EnsurePathExists( m_CachePath ) == false )
+    {
+        FLOG_WARN( "Cache inaccessible - Caching disabled (Path '%s')", m_CachePath.Get() );
+        return false;
+    }
+
+    m_CacheWrite = cacheWrite;
+
+    MutexHolder mh( m_Mutex );
+    ResetOverlay();
+    OpenIndex();
+
+    // Apply entries and uses journaled since the table was written
+    Array<JournalRecord> records;
+    ReadJournal( records );
+    for ( const JournalRecord & record : records )
+    {
+        ApplyToOverlay( record );
+    }
+    return true;
+}
+
+// Shutdown
+//------------------------------------------------------------------------------
+/*virtual*/ void PackedCache::Shutdown()
+{
+    PROFILE_FUNCTION;
+
+    MutexHolder mh( m_Mutex );
+    CloseSegment();
+    if ( m_IndexDirty || m_AccessTimesDirty )
+    {
+        SaveJournal();
+    }
+}
+
+// Publish
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::Publish( const AString & cacheId, const void * data, size_t dataSize )
+{
+    RecordHeader header;
+    if ( ( cacheId.GetLength() >= sizeof( header.m_CacheId ) ) ||
+         ( dataSize > ( kSegmentSize * (size_t)8 ) ) )
+    {
+        return false; // Unsupported entry
+    }
+    header.m_Magic = kRecordMagic;
+    header.m_DataSize = (uint32_t)dataSize;
+    memset( header.m_CacheId, 0, sizeof( header.m_CacheId ) );
+    memcpy( header.m_CacheId, cacheId.Get(), cacheId.GetLength() );
+
+    const uint64_t keyHash = GetKeyHash( cacheId );
+
+    // Reserve space for the record, and write it without blocking other users
+    uint32_t segmentId;
+    uint32_t offset;
+    {
+        MutexHolder mh( m_Mutex );
+        if ( ReserveRecord( header.m_DataSize, segmentId, offset ) == false )
+        {
+            return false;
+        }
+    }
+    if ( WriteRecord( header, data, offset ) == false )
+    {
+        return false;
+    }
+
+    MutexHolder mh( m_Mutex );
+
+    // Replaces any existing entry
+    IndexEntry * entry = FindOrAddOverlayEntry( keyHash );
+    entry->m_SegmentId = segmentId;
+    entry->m_Offset = offset;
+    entry->m_Size = (uint32_t)dataSize;
+    entry->m_WriteTime = GetCurrentTimeMins();
+    entry->m_AccessTime = entry->m_WriteTime;
+    entry->m_Modified |= MODIFIED_ENTRY;
+    m_IndexDirty = true;
+    return true;
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::Retrieve( const AString & cacheId, void *& data, size_t & dataSize )
+{
+    data = nullptr;
+    dataSize = 0;
+
+    const uint64_t keyHash = GetKeyHash( cacheId );
+
+    // One probe of the index...
+    IndexEntry entry;
+    {
+        MutexHolder mh( m_Mutex );
+        const IndexEntry * found = FindEntry( keyHash );
+        if ( found == nullptr )
+        {
+            return false;
+        }
+        entry = *found;
+    }
+
+    // ...and one read from the segment
+    char * record;
+    if ( ReadRecord( entry, cacheId, record ) == false )
+    {
+        return false;
+    }
+
+    // Note use of entry
+    bool promote = false;
+    uint32_t segmentId = 0;
+    uint32_t offset = 0;
+    {
+        MutexHolder mh( m_Mutex );
+        const IndexEntry * found = FindEntry( keyHash );
+        if ( found && ( found->m_SegmentId == entry.m_SegmentId ) && ( found->m_Offset == entry.m_Offset ) )
+        {
+            const uint32_t now = GetCurrentTimeMins();
+
+            // Move entries still in use out of old segments so they survive trimming
+            if ( m_CacheWrite && ( ( now - found->m_WriteTime ) > kPromoteAfterMins ) )
+            {
+                promote = ReserveRecord( entry.m_Size, segmentId, offset );
+            }
+
+            // Read-only users of the cache leave no trace
+            if ( m_CacheWrite && ( now >= ( found->m_AccessTime + kAccessTimeGranularityMins ) ) )
+            {
+                IndexEntry * overlayEntry = FindOrAddOverlayEntry( keyHash );
+                overlayEntry->m_AccessTime = now;
+                overlayEntry->m_Modified |= MODIFIED_ACCESS_TIME;
+                m_AccessTimesDirty = true;
+            }
+        }
+    }
+
+    // Write the copy without blocking other users, then update the entry (unless
+    // it changed meanwhile)
+    if ( promote && WriteRecord( *reinterpret_cast<const RecordHeader *>( record ), record + sizeof( RecordHeader ), offset ) )
+    {
+        MutexHolder mh( m_Mutex );
+        const IndexEntry * found = FindEntry( keyHash );
+        if ( found && ( found->m_SegmentId == entry.m_SegmentId ) && ( found->m_Offset == entry.m_Offset ) )
+        {
+            IndexEntry * overlayEntry = FindOrAddOverlayEntry( keyHash );
+            overlayEntry->m_SegmentId = segmentId;
+            overlayEntry->m_Offset = offset;
+            overlayEntry->m_WriteTime = GetCurrentTimeMins();
+            overlayEntry->m_Modified |= MODIFIED_ENTRY;
+            m_IndexDirty = true;
+        }
+    }
+
+    data = ( record + sizeof( RecordHeader ) );
+    dataSize = entry.m_Size;
+    return true;
+}
+
+// Query
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::Query( const Array<AString> & cacheIds, Array<bool> & outFound )
+{
+    outFound.SetSize( cacheIds.GetSize() );
+
+    // Index only (a hash collision, or an entry in a trimmed segment, can be
+    // reported which Retrieve will then reject)
+    MutexHolder mh( m_Mutex );
+    for ( size_t i = 0; i < cacheIds.GetSize(); ++i )
+    {
+        outFound[ i ] = ( FindEntry( GetKeyHash( cacheIds[ i ] ) ) != nullptr );
+    }
+    return true;
+}
+
+// FreeMemory
+//------------------------------------------------------------------------------
+/*virtual*/ void PackedCache::FreeMemory( void * data, size_t /*dataSize*/ )
+{
+    // Data follows the record header in the same allocation
+    FREE( static_cast<char *>( data ) - sizeof( RecordHeader ) );
+}
+
+// OutputInfo
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::OutputInfo( bool /*showProgress*/ )
+{
+    Array<FileIO::FileInfo> segments;
+    Array<uint32_t> segmentIds;
+    GetSegments( segments, segmentIds );
+    uint64_t segmentsSize = 0;
+    for ( const FileIO::FileInfo & info : segments )
+    {
+        segmentsSize += info.m_Size;
+    }
+
+    // Count/Size per day (since last use)
+    const uint32_t NUM_DAYS( 30 );
+    uint32_t perDayFiles[ NUM_DAYS ] = {};
+    uint64_t perDayBytes[ NUM_DAYS ] = {};
+    uint32_t totalFiles = 0;
+    uint64_t totalBytes = 0;
+    {
+        MutexHolder mh( m_Mutex );
+
+        // Entries in the table (unless changed since), then those changed since
+        const uint32_t now = GetCurrentTimeMins();
+        const uint64_t numEntries = ( (uint64_t)m_TableNumBuckets + m_Overlay.GetSize() );
+        for ( uint64_t i = 0; i < numEntries; ++i )
+        {
+            const bool inTable = ( i < m_TableNumBuckets );
+            const IndexEntry & entry = inTable ? m_Table[ i ] : m_Overlay[ (size_t)( i - m_TableNumBuckets ) ];
+            if ( ( entry.m_KeyHash == 0 ) ||
+                 ( inTable && FindEntry( m_Overlay, entry.m_KeyHash ) ) ||
+                 ( ContainsSorted( segmentIds, entry.m_SegmentId ) == false ) ) // Trimmed
+            {
+                continue;
+            }
+            uint32_t ageInDays = ( now > entry.m_AccessTime ) ? ( ( now - entry.m_AccessTime ) / ( 24 * 60 ) ) : 0;
+            if ( ageInDays >= NUM_DAYS )
+            {
+                ageInDays = ( NUM_DAYS - 1 );
+            }
+            perDayFiles[ ageInDays ]++;
+            perDayBytes[ ageInDays ] += entry.m_Size;
+            totalFiles++;
+            totalBytes += entry.m_Size;
+        }
+    }
+
+    // Generate cache info string
+    OUTPUT( "================================================================================\n" );
+    OUTPUT( " Last Used (Days) | Entries  | Size (MiB) | %%\n" );
+    OUTPUT( "================================================================================\n" );
+    for ( uint32_t i = 0; i < NUM_DAYS; ++i )
+    {
+        const uint64_t size = perDayBytes[ i ] / MEGABYTE;
+        const float sizePerc = ( totalBytes > 0 ) ? 100.0f * ( (float)perDayBytes[ i ] / (float)totalBytes ) : 0.0f;
+        AStackString graphBar;
+        for ( uint32_t j = 0; j < (uint32_t)( sizePerc ); ++j )
+        {
+            if ( graphBar.GetLength() < 35 )
+            {
+                graphBar += '*';
+            }
+        }
+        OUTPUT( " %2u%c              | %8u | %10" PRIu64 " | %5.1f %s\n", i, ( i == ( NUM_DAYS - 1 ) ) ? '+' : ' ', perDayFiles[ i ], size, (double)sizePerc, graphBar.Get() );
+    }
+    OUTPUT( "================================================================================\n" );
+    OUTPUT( " Total            | %8u | %10" PRIu64 " |\n", totalFiles, totalBytes / MEGABYTE );
+    OUTPUT( " Segments         | %8u | %10" PRIu64 " |\n", (uint32_t)segments.GetSize(), segmentsSize / MEGABYTE );
+    OUTPUT( "================================================================================\n" );
+
+    return true;
+}
+
+// Trim
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::Trim( bool showProgress, uint32_t sizeMiB )
+{
+    PROFILE_FUNCTION;
+
+    // Only segments are enumerated, never individual entries
+    Array<FileIO::FileInfo> segments;
+    Array<uint32_t> segmentIds;
+    GetSegments( segments, segmentIds );
+    uint64_t totalSize = 0;
+    for ( const FileIO::FileInfo & info : segments )
+    {
+        totalSize += info.m_Size;
+    }
+    OUTPUT( " - Before: %u Segments @ %u MiB\n", (uint32_t)segments.GetSize(), (uint32_t)( totalSize / MEGABYTE ) );
+
+    // Oldest first. Entries still in use are moved to newer segments as they
+    // are retrieved, so segments age in least recently used order.
+    segments.Sort( []( const FileIO::FileInfo & a, const FileIO::FileInfo & b ) { return ( a.m_LastWriteTime < b.m_LastWriteTime ); } );
+
+    OUTPUT( "Trimming to %u MiB:\n", sizeMiB );
+    const uint64_t limit = ( (uint64_t)sizeMiB * MEGABYTE );
+    const Timer timer;
+    if ( showProgress )
+    {
+        FLog::OutputProgress( 0.0f, 0.0f, 0, 0, 0, 0 );
+    }
+
+    // Drop whole segments
+    const uint64_t nowSecs = Time::FileTimeToSeconds( Time::GetCurrentFileTime() );
+    Array<FileIO::FileInfo> remaining;
+    Array<uint32_t> remainingIds;
+    remaining.SetCapacity( segments.GetSize() );
+    remainingIds.SetCapacity( segments.GetSize() );
+    for ( const FileIO::FileInfo & info : segments )
+    {
+        uint32_t segmentId = 0;
+        VERIFY( GetSegmentId( info.m_Name, segmentId ) ); // Filtered by GetSegments
+
+        // Segments being written by a process (possibly this one) are kept. A claim
+        // on a segment which hasn't been written for a while was left by a process
+        // which exited without releasing it.
+        AStackString claimFile;
+        GetSegmentClaimFileName( segmentId, claimFile );
+        const bool claimed = ( FileIO::FileExists( claimFile.Get() ) &&
+                               ( ( nowSecs - Time::FileTimeToSeconds( info.m_LastWriteTime ) ) < ( kPromoteAfterMins * 60 ) ) );
+
+        // Try to delete (ok to fail if file is in use)
+        if ( ( totalSize > limit ) && ( claimed == false ) && FileIO::FileDelete( info.m_Name.Get() ) )
+        {
+            totalSize -= info.m_Size;
+
+            // Remove any stale claim
+            if ( FileIO::FileExists( claimFile.Get() ) )
+            {
+                FileIO::FileDelete( claimFile.Get() );
+            }
+            continue;
+        }
+        remaining.Append( info );
+        remainingIds.Append( segmentId );
+    }
+    Array<uint32_t> sortedIds( remainingIds );
+    sortedIds.Sort();
+
+    // Serialize with other processes (possibly on other machines) updating the index
+    IndexLock lock( *this );
+    if ( lock.IsLocked() == false )
+    {
+        // Entries in deleted segments are forgotten by a later Trim
+        if ( showProgress )
+        {
+            FLog::ClearProgress();
+        }
+        return false;
+    }
+
+    // Rebuild the table from the entries journaled by other processes and
+    // changed by this one, forgetting entries in deleted segments
+    Array<JournalRecord> records;
+    ReadJournal( records );
+    {
+        MutexHolder mh( m_Mutex );
+        GetModifiedRecords( records );
+        ClearModified();
+    }
+    Array<IndexEntry> buckets;
+    uint32_t numEntries = 0;
+    BuildTable( records, &sortedIds, buckets, numEntries );
+
+    // Segments which are mostly entries that have been replaced are compacted,
+    // by moving the live entries into the newest segment
+    Array<uint32_t> sortedLiveBytes;
+    sortedLiveBytes.SetSize( sortedIds.GetSize() );
+    memset( sortedLiveBytes.Begin(), 0, sortedLiveBytes.GetSize() * sizeof( uint32_t ) );
+    for ( const IndexEntry & entry : buckets )
+    {
+        if ( entry.m_KeyHash == 0 )
+        {
+            continue;
+        }
+        const size_t index = FindSorted( sortedIds, entry.m_SegmentId );
+        if ( index < sortedIds.GetSize() )
+        {
+            sortedLiveBytes[ index ] += ( entry.m_Size + (uint32_t)sizeof( RecordHeader ) );
+        }
+    }
+    const uint64_t now = Time::FileTimeToSeconds( Time::GetCurrentFileTime() );
+    Array<uint32_t> compactIds;
+    for ( size_t i = 0; ( i + 1 ) < remaining.GetSize(); ++i ) // Never the newest segment
+    {
+        const uint32_t liveBytes = sortedLiveBytes[ FindSorted( sortedIds, remainingIds[ i ] ) ];
+        if ( liveBytes >= ( remaining[ i ].m_Size / 2 ) )
+        {
+            continue;
+        }
+
+        // Avoid segments which might still be being written by another process
+        if ( ( now - Time::FileTimeToSeconds( remaining[ i ].m_LastWriteTime ) ) < ( kPromoteAfterMins * 60 ) )
+        {
+            continue;
+        }
+        AStackString claimFile;
+        GetSegmentClaimFileName( remainingIds[ i ], claimFile );
+        if ( FileIO::FileExists( claimFile.Get() ) )
+        {
+            continue;
+        }
+        compactIds.Append( remainingIds[ i ] );
+    }
+    compactIds.Sort();
+
+    // Move the live entries of those segments (found in a single pass). Only the
+    // space for each copy is reserved with m_Mutex held.
+    Array<bool> compactOk;
+    compactOk.SetSize( compactIds.GetSize() );
+    for ( bool & ok : compactOk )
+    {
+        ok = true;
+    }
+    Array<IndexEntry> moves;
+    if ( compactIds.IsEmpty() == false )
+    {
+        for ( const IndexEntry & entry : buckets )
+        {
+            if ( ( entry.m_KeyHash != 0 ) && ContainsSorted( compactIds, entry.m_SegmentId ) )
+            {
+                moves.Append( entry );
+            }
+        }
+    }
+    for ( const IndexEntry & move : moves )
+    {
+        char * record = nullptr;
+        uint32_t segmentId = 0;
+        uint32_t offset = 0;
+        bool ok = ReadRecord( move, AString::GetEmpty(), record );
+        if ( ok )
+        {
+            MutexHolder mh( m_Mutex );
+            ok = ReserveRecord( move.m_Size, segmentId, offset );
+        }
+        if ( ok && WriteRecord( *reinterpret_cast<const RecordHeader *>( record ), record + sizeof( RecordHeader ), offset ) )
+        {
+            IndexEntry * entry = FindEntry( buckets, move.m_KeyHash );
+            entry->m_SegmentId = segmentId;
+            entry->m_Offset = offset;
+        }
+        else
+        {
+            compactOk[ FindSorted( compactIds, move.m_SegmentId ) ] = false; // Keep segment
+        }
+        FREE( record );
+    }
+    uint32_t numCompacted = 0;
+    for ( size_t i = 0; i < remaining.GetSize(); ++i )
+    {
+        const size_t index = FindSorted( compactIds, remainingIds[ i ] );
+        if ( ( index < compactIds.GetSize() ) && compactOk[ index ] && FileIO::FileDelete( remaining[ i ].m_Name.Get() ) )
+        {
+            totalSize -= remaining[ i ].m_Size;
+            totalSize += sortedLiveBytes[ FindSorted( sortedIds, remainingIds[ i ] ) ];
+            ++numCompacted;
+        }
+    }
+
+    if ( showProgress )
+    {
+        FLog::ClearProgress();
+    }
+
+    {
+        MutexHolder mh( m_Mutex );
+        CloseSegment();
+
+        // Include changes made by this process meanwhile
+        Array<JournalRecord> newRecords;
+        GetModifiedRecords( newRecords );
+        for ( const JournalRecord & record : newRecords )
+        {
+            ApplyRecord( buckets, numEntries, record );
+        }
+
+        // Replace the table, which now holds all changes
+        if ( WriteTable( lock, buckets, numEntries ) )
+        {
+            ResetOverlay();
+        }
+    }
+
+    Array<FileIO::FileInfo> after;
+    GetSegments( after, segmentIds );
+    OUTPUT( " - After: %u Segments @ %u MiB (%u compacted)\n", (uint32_t)after.GetSize(), (uint32_t)( totalSize / MEGABYTE ), numCompacted );
+    return true;
+}
+
+// FindEntry
+//------------------------------------------------------------------------------
+const PackedCache::IndexEntry * PackedCache::FindEntry( uint64_t keyHash )
+{
+    // Changes take precedence over the table
+    const IndexEntry * entry = FindEntry( m_Overlay, keyHash );
+    return entry ? entry : FindTableEntry( keyHash );
+}
+
+// FindTableEntry
+//------------------------------------------------------------------------------
+const PackedCache::IndexEntry * PackedCache::FindTableEntry( uint64_t keyHash ) const
+{
+    // Linear probing, in place in the mapped table (bounded, in case it's corrupt)
+    const uint32_t mask = ( m_TableNumBuckets - 1 );
+    uint32_t index = ( (uint32_t)keyHash & mask );
+    for ( uint32_t i = 0; i < m_TableNumBuckets; ++i )
+    {
+        const IndexEntry & entry = m_Table[ index ];
+        if ( entry.m_KeyHash == keyHash )
+        {
+            return &entry;
+        }
+        if ( entry.m_KeyHash == 0 )
+        {
+            break;
+        }
+        index = ( ( index + 1 ) & mask );
+    }
+    return nullptr;
+}
+
+// FindOrAddOverlayEntry
+//------------------------------------------------------------------------------
+PackedCache::IndexEntry * PackedCache::FindOrAddOverlayEntry( uint64_t keyHash )
+{
+    IndexEntry * entry = FindEntry( m_Overlay, keyHash );
+    if ( entry )
+    {
+        return entry;
+    }
+
+    // Changes to an entry in the table start from a copy of it
+    const IndexEntry * tableEntry = FindTableEntry( keyHash );
+    entry = FindOrAddEntry( m_Overlay, m_OverlayNumEntries, keyHash );
+    if ( tableEntry )
+    {
+        *entry = *tableEntry;
+        entry->m_Modified = 0;
+    }
+    return entry;
+}
+
+// ApplyToOverlay
+//------------------------------------------------------------------------------
+void PackedCache::ApplyToOverlay( const JournalRecord & record )
+{
+    if ( ( record.m_KeyHash == 0 ) ||
+         ( ( record.m_Type != MODIFIED_ENTRY ) && ( FindEntry( record.m_KeyHash ) == nullptr ) ) )
+    {
+        return; // Use of an entry which no longer exists
+    }
+    ApplyRecord( *FindOrAddOverlayEntry( record.m_KeyHash ), record );
+}
+
+// GetModifiedRecords
+//------------------------------------------------------------------------------
+void PackedCache::GetModifiedRecords( Array<JournalRecord> & outRecords ) const
+{
+    for ( const IndexEntry & entry : m_Overlay )
+    {
+        if ( entry.m_Modified != 0 )
+        {
+            const uint32_t type = ( entry.m_Modified & MODIFIED_ENTRY ) ? MODIFIED_ENTRY : MODIFIED_ACCESS_TIME;
+            outRecords.Append( JournalRecord{ entry.m_KeyHash, type, entry.m_SegmentId, entry.m_Offset, entry.m_Size, entry.m_WriteTime, entry.m_AccessTime } );
+        }
+    }
+}
+
+// ClearModified
+//------------------------------------------------------------------------------
+void PackedCache::ClearModified()
+{
+    for ( IndexEntry & entry : m_Overlay )
+    {
+        entry.m_Modified = 0;
+    }
+    m_IndexDirty = false;
+    m_AccessTimesDirty = false;
+}
+
+// ResetOverlay
+//------------------------------------------------------------------------------
+void PackedCache::ResetOverlay()
+{
+    m_Overlay.Clear();
+    m_Overlay.SetSize( kMinOverlayBuckets ); // Zeroed
+    m_OverlayNumEntries = 0;
+    m_IndexDirty = false;
+    m_AccessTimesDirty = false;
+}
+
+// OpenIndex
+//------------------------------------------------------------------------------
+void PackedCache::OpenIndex()
+{
+    PROFILE_FUNCTION;
+
+    m_IndexFile.Close();
+    m_Table = nullptr;
+    m_TableNumBuckets = 0;
+
+    // Probed in place, so opening the index doesn't depend on its size
+    const IndexHeader * header = nullptr;
+    if ( OpenTable( m_IndexFile, header ) )
+    {
+        m_Table = reinterpret_cast<const IndexEntry *>( header + 1 );
+        m_TableNumBuckets = header->m_NumBuckets;
+    }
+}
+
+// OpenTable
+//------------------------------------------------------------------------------
+bool PackedCache::OpenTable( MemoryMappedFile & file, const IndexHeader *& outHeader ) const
+{
+    AStackString indexFile;
+    GetIndexFileName( indexFile );
+    if ( file.Open( indexFile.Get() ) == false )
+    {
+        return false; // No index for a new cache
+    }
+
+    // Check header and table fit
+    const IndexHeader * header = static_cast<const IndexHeader *>( file.GetData() );
+    if ( ( file.GetSize() < sizeof( IndexHeader ) ) ||
+         ( header->IsValid() == false ) ||
+         ( file.GetSize() != ( sizeof( IndexHeader ) + ( (uint64_t)header->m_NumBuckets * sizeof( IndexEntry ) ) ) ) )
+    {
+        FLOG_WARN( "Cache index '%s' is incompatible or corrupt - ignoring", indexFile.Get() );
+        file.Close();
+        return false;
+    }
+    outHeader = header;
+    return true;
+}
+
+// FindEntry
+//------------------------------------------------------------------------------
+/*static*/ PackedCache::IndexEntry * PackedCache::FindEntry( Array<IndexEntry> & buckets, uint64_t keyHash )
+{
+    // Linear probing
+    const uint32_t mask = ( (uint32_t)buckets.GetSize() - 1 );
+    uint32_t index = ( (uint32_t)keyHash & mask );
+    for ( ;; )
+    {
+        IndexEntry & entry = buckets[ index ];
+        if ( entry.m_KeyHash == keyHash )
+        {
+            return &entry;
+        }
+        if ( entry.m_KeyHash == 0 )
+        {
+            return nullptr;
+        }
+        index = ( ( index + 1 ) & mask );
+    }
+}
+
+// FindOrAddEntry
+//------------------------------------------------------------------------------
+/*static*/ PackedCache::IndexEntry * PackedCache::FindOrAddEntry( Array<IndexEntry> & buckets, uint32_t & numEntries, uint64_t keyHash )
+{
+    // Keep load factor below 70%
+    if ( ( ( numEntries + 1 ) * (uint64_t)10 ) > ( buckets.GetSize() * 7 ) )
+    {
+        Rehash( buckets, numEntries, (uint32_t)buckets.GetSize() * 2 );
+    }
+
+    const uint32_t mask = ( (uint32_t)buckets.GetSize() - 1 );
+    uint32_t index = ( (uint32_t)keyHash & mask );
+    for ( ;; )
+    {
+        IndexEntry & entry = buckets[ index ];
+        if ( entry.m_KeyHash == keyHash )
+        {
+            return &entry;
+        }
+        if ( entry.m_KeyHash == 0 )
+        {
+            entry.m_KeyHash = keyHash;
+            ++numEntries;
+            return &entry;
+        }
+        index = ( ( index + 1 ) & mask );
+    }
+}
+
+// Rehash
+//------------------------------------------------------------------------------
+/*static*/ void PackedCache::Rehash( Array<IndexEntry> & buckets, uint32_t & numEntries, uint32_t numBuckets )
+{
+    Array<IndexEntry> oldBuckets;
+    oldBuckets.Swap( buckets );
+
+    buckets.SetSize( numBuckets ); // Zeroed
+    numEntries = 0;
+    for ( const IndexEntry & entry : oldBuckets )
+    {
+        if ( entry.m_KeyHash != 0 )
+        {
+            *FindOrAddEntry( buckets, numEntries, entry.m_KeyHash ) = entry;
+        }
+    }
+}
+
+// ApplyRecord
+//------------------------------------------------------------------------------
+/*static*/ void PackedCache::ApplyRecord( Array<IndexEntry> & buckets, uint32_t & numEntries, const JournalRecord & record )
+{
+    if ( record.m_KeyHash == 0 )
+    {
+        return;
+    }
+
+    // Uses of entries which no longer exist are ignored
+    IndexEntry * entry = ( record.m_Type == MODIFIED_ENTRY ) ? FindOrAddEntry( buckets, numEntries, record.m_KeyHash )
+                                                             : FindEntry( buckets, record.m_KeyHash );
+    if ( entry )
+    {
+        ApplyRecord( *entry, record );
+    }
+}
+
+// ApplyRecord
+//------------------------------------------------------------------------------
+/*static*/ void PackedCache::ApplyRecord( IndexEntry & entry, const JournalRecord & record )
+{
+    // Records are applied in the order they were written, so later ones take precedence
+    if ( record.m_Type == MODIFIED_ENTRY )
+    {
+        entry.m_SegmentId = record.m_SegmentId;
+        entry.m_Offset = record.m_Offset;
+        entry.m_Size = record.m_Size;
+        entry.m_WriteTime = record.m_WriteTime;
+    }
+    entry.m_AccessTime = Math::Max( entry.m_AccessTime, record.m_AccessTime );
+}
+
+// ReadJournal
+//------------------------------------------------------------------------------
+bool PackedCache::ReadJournal( Array<JournalRecord> & outRecords ) const
+{
+    AStackString journalFile;
+    GetJournalFileName( journalFile );
+    FileStream f;
+    if ( f.Open( journalFile.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return true; // Nothing added or used since the table was written
+    }
+
+    // Complete records only (a write may have been cut short)
+    const size_t numRecords = (size_t)( f.GetFileSize() / sizeof( JournalRecord ) );
+    const size_t firstRecord = outRecords.GetSize();
+    outRecords.SetSize( firstRecord + numRecords );
+    const uint64_t recordsSize = ( numRecords * sizeof( JournalRecord ) );
+    if ( f.ReadBuffer( outRecords.Begin() + firstRecord, recordsSize ) != recordsSize )
+    {
+        outRecords.SetSize( firstRecord );
+        return false;
+    }
+    return true;
+}
+
+// SaveJournal
+//------------------------------------------------------------------------------
+bool PackedCache::SaveJournal()
+{
+    PROFILE_FUNCTION;
+
+    Array<JournalRecord> records;
+    GetModifiedRecords( records );
+    const uint64_t recordsSize = ( records.GetSize() * sizeof( JournalRecord ) );
+
+    // Serialize with other processes (possibly on other machines) updating the index
+    IndexLock lock( *this );
+    if ( lock.IsLocked() == false )
+    {
+        return false;
+    }
+
+    {
+        AStackString journalFile;
+        GetJournalFileName( journalFile );
+        FileStream f;
+        if ( f.Open( journalFile.Get(), FileStream::OPEN_OR_CREATE_READ_WRITE ) == false )
+        {
+            FLOG_WARN( "Failed to open cache journal '%s'. Error: %s", journalFile.Get(), LAST_ERROR_STR );
+            return false;
+        }
+
+        // Append, unless the journal has grown large enough to be folded into the table
+        const uint64_t journalSize = f.GetFileSize();
+        if ( ( journalSize + recordsSize ) <= kMaxJournalSize )
+        {
+            // Overwrite any partial record left by an interrupted write
+            const uint64_t end = ( journalSize - ( journalSize % sizeof( JournalRecord ) ) );
+            if ( ( lock.IsStillLocked() == false ) ||
+                 ( f.Seek( end ) == false ) ||
+                 ( f.WriteBuffer( records.Begin(), recordsSize ) != recordsSize ) )
+            {
+                FLOG_WARN( "Failed to update cache journal '%s'. Error: %s", journalFile.Get(), LAST_ERROR_STR );
+                return false;
+            }
+            ClearModified();
+            return true;
+        }
+    }
+
+    // Fold the journal, followed by our changes, into the table
+    Array<JournalRecord> allRecords;
+    if ( ReadJournal( allRecords ) == false )
+    {
+        return false;
+    }
+    allRecords.Append( records );
+    if ( PatchIndex( lock, allRecords ) == false )
+    {
+        return false;
+    }
+    ClearModified();
+    return true;
+}
+
+// PatchIndex
+//------------------------------------------------------------------------------
+bool PackedCache::PatchIndex( const IndexLock & lock, const Array<JournalRecord> & records )
+{
+    PROFILE_FUNCTION;
+
+    AStackString indexFile;
+    GetIndexFileName( indexFile );
+
+    // The table is updated in place, unless there isn't one yet or it needs to grow
+    FileStream f;
+    IndexHeader header;
+    const bool inPlace = ( FileIO::FileExists( indexFile.Get() ) &&
+                           f.Open( indexFile.Get(), FileStream::OPEN_OR_CREATE_READ_WRITE ) &&
+                           ( f.ReadBuffer( &header, sizeof( IndexHeader ) ) == sizeof( IndexHeader ) ) &&
+                           header.IsValid() &&
+                           ( f.GetFileSize() == ( sizeof( IndexHeader ) + ( (uint64_t)header.m_NumBuckets * sizeof( IndexEntry ) ) ) ) &&
+                           ( ( ( header.m_NumEntries + (uint64_t)records.GetSize() ) * 10 ) <= ( header.m_NumBuckets * (uint64_t)7 ) ) );
+    if ( inPlace == false )
+    {
+        if ( f.IsOpen() )
+        {
+            f.Close();
+        }
+        Array<IndexEntry> buckets;
+        uint32_t numEntries = 0;
+        BuildTable( records, nullptr, buckets, numEntries );
+        return WriteTable( lock, buckets, numEntries );
+    }
+
+    // Visit the records in bucket order, so neighbouring records share reads and
+    // writes of the table. Records for the same entry stay in the order written.
+    const uint32_t mask = ( header.m_NumBuckets - 1 );
+    Array<uint64_t> order;
+    order.SetCapacity( records.GetSize() );
+    for ( size_t i = 0; i < records.GetSize(); ++i )
+    {
+        order.Append( ( (uint64_t)( (uint32_t)records[ i ].m_KeyHash & mask ) << 32 ) | i );
+    }
+    order.Sort();
+
+    // Readers of the table (in other processes) can see a partially written
+    // entry, which fails the checks made when its record is read
+    Array<IndexEntry> window;
+    window.SetSize( kPatchWindowBuckets );
+    uint32_t windowStart = 0;
+    bool windowLoaded = false;
+    bool windowDirty = false;
+    bool ok = lock.IsStillLocked();
+    for ( size_t i = 0; ok && ( i < order.GetSize() ); ++i )
+    {
+        const JournalRecord & record = records[ (size_t)( order[ i ] & 0xFFFFFFFF ) ];
+        if ( record.m_KeyHash == 0 )
+        {
+            continue;
+        }
+
+        // Linear probing, as for the mapped table
+        uint32_t index = (uint32_t)( order[ i ] >> 32 );
+        for ( uint32_t probes = 0;; ++probes )
+        {
+            if ( probes == header.m_NumBuckets )
+            {
+                ok = false; // Corrupt
+                break;
+            }
+            if ( ( windowLoaded == false ) || ( ( index - windowStart ) >= kPatchWindowBuckets ) )
+            {
+                if ( windowDirty && ( WriteBuckets( f, windowStart, window ) == false ) )
+                {
+                    ok = false;
+                    break;
+                }
+                windowStart = ( index & ~( kPatchWindowBuckets - 1 ) );
+                windowDirty = false;
+                windowLoaded = ReadBuckets( f, windowStart, window );
+                if ( windowLoaded == false )
+                {
+                    ok = false;
+                    break;
+                }
+            }
+            IndexEntry & entry = window[ index - windowStart ];
+            if ( entry.m_KeyHash == record.m_KeyHash )
+            {
+                ApplyRecord( entry, record );
+                windowDirty = true;
+                break;
+            }
+            if ( entry.m_KeyHash == 0 )
+            {
+                if ( record.m_Type == MODIFIED_ENTRY )
+                {
+                    entry.m_KeyHash = record.m_KeyHash;
+                    ApplyRecord( entry, record );
+                    ++header.m_NumEntries;
+                    windowDirty = true;
+                }
+                break; // Uses of entries which no longer exist are ignored
+            }
+            index = ( ( index + 1 ) & mask );
+        }
+    }
+    if ( ok && windowDirty )
+    {
+        ok = WriteBuckets( f, windowStart, window );
+    }
+    if ( ok )
+    {
+        ok = ( f.WriteBufferAt( &header, sizeof( IndexHeader ), 0 ) == sizeof( IndexHeader ) );
+    }
+    f.Close();
+    if ( ok == false )
+    {
+        // The journal is kept, and applied again by the next update
+        FLOG_WARN( "Failed to update cache index '%s'. Error: %s", indexFile.Get(), LAST_ERROR_STR );
+        return false;
+    }
+
+    // Journaled entries and uses are now part of the table
+    DeleteJournal();
+    return true;
+}
+
+// BuildTable
+//------------------------------------------------------------------------------
+void PackedCache::BuildTable( const Array<JournalRecord> & records,
+                              const Array<uint32_t> * sortedSegmentIds,
+                              Array<IndexEntry> & outBuckets,
+                              uint32_t & outNumEntries ) const
+{
+    PROFILE_FUNCTION;
+
+    // The table may have been updated by other processes since it was mapped by
+    // this one, so it is mapped again
+    MemoryMappedFile file;
+    const IndexHeader * header = nullptr;
+    const IndexEntry * table = nullptr;
+    uint32_t tableNumBuckets = 0;
+    if ( OpenTable( file, header ) )
+    {
+        table = reinterpret_cast<const IndexEntry *>( header + 1 );
+        tableNumBuckets = header->m_NumBuckets;
+    }
+
+    // Size for the remaining entries, with room to grow
+    uint64_t numEntries = records.GetSize();
+    for ( uint32_t i = 0; i < tableNumBuckets; ++i )
+    {
+        if ( ( table[ i ].m_KeyHash != 0 ) &&
+             ( ( sortedSegmentIds == nullptr ) || ContainsSorted( *sortedSegmentIds, table[ i ].m_SegmentId ) ) )
+        {
+            ++numEntries;
+        }
+    }
+    uint32_t numBuckets = kMinBuckets;
+    while ( ( numEntries * 10 ) > ( numBuckets * (uint64_t)5 ) )
+    {
+        numBuckets *= 2;
+    }
+    outBuckets.Clear();
+    outBuckets.SetSize( numBuckets ); // Zeroed
+    outNumEntries = 0;
+
+    // Entries in the table, followed by changes made since
+    for ( uint32_t i = 0; i < tableNumBuckets; ++i )
+    {
+        const IndexEntry & entry = table[ i ];
+        if ( ( entry.m_KeyHash != 0 ) &&
+             ( ( sortedSegmentIds == nullptr ) || ContainsSorted( *sortedSegmentIds, entry.m_SegmentId ) ) )
+        {
+            IndexEntry * newEntry = FindOrAddEntry( outBuckets, outNumEntries, entry.m_KeyHash );
+            *newEntry = entry;
+            newEntry->m_Modified = 0;
+        }
+    }
+    for ( const JournalRecord & record : records )
+    {
+        if ( ( record.m_Type == MODIFIED_ENTRY ) &&
+             sortedSegmentIds &&
+             ( ContainsSorted( *sortedSegmentIds, record.m_SegmentId ) == false ) )
+        {
+            continue; // Entry moved to a segment which has been deleted
+        }
+        ApplyRecord( outBuckets, outNumEntries, record );
+    }
+}
+
+// WriteTable
+//------------------------------------------------------------------------------
+bool PackedCache::WriteTable( const IndexLock & lock, const Array<IndexEntry> & buckets, uint32_t numEntries )
+{
+    PROFILE_FUNCTION;
+
+    IndexHeader header;
+    header.m_NumBuckets = (uint32_t)buckets.GetSize();
+    header.m_NumEntries = numEntries;
+
+    AStackString indexFile;
+    GetIndexFileName( indexFile );
+    AStackString indexFileTmp;
+    indexFileTmp.Format( "%s.%u.tmp", indexFile.Get(), Process::GetCurrentId() );
+    FileStream f;
+    const size_t tableSize = ( buckets.GetSize() * sizeof( IndexEntry ) );
+    if ( ( f.Open( indexFileTmp.Get(), FileStream::WRITE_ONLY ) == false ) ||
+         ( f.WriteBuffer( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( f.WriteBuffer( buckets.Begin(), tableSize ) != tableSize ) )
+    {
+        FLOG_WARN( "Failed to save cache index '%s'. Error: %s", indexFileTmp.Get(), LAST_ERROR_STR );
+        if ( f.IsOpen() )
+        {
+            f.Close();
+        }
+        FileIO::FileDelete( indexFileTmp.Get() );
+        return false;
+    }
+    f.Close();
+
+    // Replace atomically so readers never see a partial index
+    if ( lock.IsStillLocked() == false )
+    {
+        FLOG_WARN( "Lost cache index lock while saving '%s'", indexFile.Get() );
+        FileIO::FileDelete( indexFileTmp.Get() );
+        return false;
+    }
+    m_IndexFile.Close(); // A mapped file can't be replaced on some platforms
+    m_Table = nullptr;
+    m_TableNumBuckets = 0;
+    const bool replaced = FileIO::FileMove( indexFileTmp, indexFile );
+    if ( replaced == false )
+    {
+        FLOG_WARN( "Failed to replace cache index '%s'. Error: %s", indexFile.Get(), LAST_ERROR_STR );
+        FileIO::FileDelete( indexFileTmp.Get() );
+    }
+    OpenIndex();
+    if ( replaced == false )
+    {
+        return false;
+    }
+
+    // Journaled entries and uses are now part of the table
+    DeleteJournal();
+    return true;
+}
+
+// DeleteJournal
+//------------------------------------------------------------------------------
+void PackedCache::DeleteJournal() const
+{
+    AStackString journalFile;
+    GetJournalFileName( journalFile );
+    if ( FileIO::FileExists( journalFile.Get() ) )
+    {
+        FileIO::FileDelete( journalFile.Get() );
+    }
+}
+
+// GetIndexFileName
+//------------------------------------------------------------------------------
+void PackedCache::GetIndexFileName( AString & outFileName ) const
+{
+    outFileName = m_CachePath;
+    outFileName += kIndexFileName;
+}
+
+// GetJournalFileName
+//------------------------------------------------------------------------------
+void PackedCache::GetJournalFileName( AString & outFileName ) const
+{
+    outFileName = m_CachePath;
+    outFileName += kJournalFileName;
+}
+
+// GetLockFileName
+//------------------------------------------------------------------------------
+void PackedCache::GetLockFileName( AString & outFileName ) const
+{
+    outFileName = m_CachePath;
+    outFileName += kLockFileName;
+}
+
+// ReserveRecord
+//------------------------------------------------------------------------------
+bool PackedCache::ReserveRecord( uint32_t dataSize, uint32_t & outSegmentId, uint32_t & outOffset )
+{
+    const uint64_t recordSize = ( sizeof( RecordHeader ) + dataSize );
+
+    // Start a new segment when the current one is full
+    if ( m_Segment.IsOpen() && ( m_SegmentSize > 0 ) && ( ( m_SegmentSize + recordSize ) > kSegmentSize ) )
+    {
+        CloseSegment();
+    }
+    if ( ( m_Segment.IsOpen() == false ) && ( ReuseSegment() == false ) && ( CreateSegment() == false ) )
+    {
+        return false;
+    }
+
+    // Offsets are 32-bit
+    if ( ( m_SegmentSize + recordSize ) > 0xFFFFFFFF )
+    {
+        return false;
+    }
+
+    outSegmentId = m_SegmentId;
+    outOffset = m_SegmentSize;
+    m_SegmentSize += (uint32_t)recordSize;
+    m_SegmentUsers.Increment(); // Released by WriteRecord
+    return true;
+}
+
+// WriteRecord
+//------------------------------------------------------------------------------
+bool PackedCache::WriteRecord( const RecordHeader & header, const void * data, uint32_t offset )
+{
+    // Records are written at their reserved offsets, so writes can overlap. A
+    // failed write leaves a hole which no entry refers to.
+    const bool ok = ( m_Segment.WriteBufferAt( &header, sizeof( RecordHeader ), offset ) == sizeof( RecordHeader ) ) &&
+                    ( m_Segment.WriteBufferAt( data, header.m_DataSize, offset + sizeof( RecordHeader ) ) == header.m_DataSize );
+    m_SegmentUsers.Decrement();
+    return ok;
+}
+
+// ReuseSegment
+//------------------------------------------------------------------------------
+bool PackedCache::ReuseSegment()
+{
+    // Continue a recently written segment with plenty of space left, so each
+    // process doesn't start a segment of its own. Older segments are left alone,
+    // as appending would make their unused entries look recent to Trim.
+    Array<FileIO::FileInfo> segments;
+    Array<uint32_t> segmentIds;
+    GetSegments( segments, segmentIds );
+    segments.Sort( []( const FileIO::FileInfo & a, const FileIO::FileInfo & b ) { return ( a.m_LastWriteTime > b.m_LastWriteTime ); } );
+    const uint64_t now = Time::FileTimeToSeconds( Time::GetCurrentFileTime() );
+    for ( const FileIO::FileInfo & info : segments )
+    {
+        if ( ( now - Time::FileTimeToSeconds( info.m_LastWriteTime ) ) >= ( kPromoteAfterMins * 60 ) )
+        {
+            break; // Remaining segments are older still
+        }
+        uint32_t segmentId = 0;
+        if ( ( info.m_Size >= ( kSegmentSize / 2 ) ) ||
+             ( GetSegmentId( info.m_Name, segmentId ) == false ) ||
+             ( ClaimSegment( segmentId ) == false ) )
+        {
+            continue; // Full, or in use by another process
+        }
+
+        // Append after the existing records
+        if ( ( m_Segment.Open( info.m_Name.Get(), FileStream::OPEN_OR_CREATE_READ_WRITE ) == false ) ||
+             ( m_Segment.GetFileSize() >= ( kSegmentSize / 2 ) ) )
+        {
+            if ( m_Segment.IsOpen() )
+            {
+                m_Segment.Close();
+            }
+            AStackString claimFile;
+            GetSegmentClaimFileName( segmentId, claimFile );
+            FileIO::FileDelete( claimFile.Get() );
+            continue;
+        }
+        m_SegmentId = segmentId;
+        m_SegmentSize = (uint32_t)m_Segment.GetFileSize();
+        return true;
+    }
+    return false;
+}
+
+// CreateSegment
+//------------------------------------------------------------------------------
+bool PackedCache::CreateSegment()
+{
+    // Segments are only written by the process which has claimed them, so
+    // processes (possibly on other machines) don't need to co-ordinate writes
+    static uint32_t s_Counter = 0;
+    for ( uint32_t attempt = 0; attempt < 16; ++attempt )
+    {
+        const uint64_t seed[ 3 ] = { Time::GetCurrentFileTime(), Process::GetCurrentId(), s_Counter++ };
+        const uint32_t segmentId = (uint32_t)xxHash3::Calc64( seed, sizeof( seed ) );
+        if ( segmentId == 0 )
+        {
+            continue;
+        }
+        AStackString segmentFile;
+        GetSegmentFileName( segmentId, segmentFile );
+        if ( FileIO::FileExists( segmentFile.Get() ) || ( ClaimSegment( segmentId ) == false ) )
+        {
+            continue;
+        }
+        if ( m_Segment.Open( segmentFile.Get(), FileStream::OPEN_OR_CREATE_READ_WRITE ) == false )
+        {
+            FLOG_WARN( "Failed to create cache segment '%s'. Error: %s", segmentFile.Get(), LAST_ERROR_STR );
+            AStackString claimFile;
+            GetSegmentClaimFileName( segmentId, claimFile );
+            FileIO::FileDelete( claimFile.Get() );
+            return false;
+        }
+        m_SegmentId = segmentId;
+        m_SegmentSize = 0;
+        return true;
+    }
+    return false;
+}
+
+// ClaimSegment
+//------------------------------------------------------------------------------
+bool PackedCache::ClaimSegment( uint32_t segmentId ) const
+{
+    // Created exclusively, so only one process (on any machine) can succeed
+    AStackString claimFile;
+    GetSegmentClaimFileName( segmentId, claimFile );
+    FileStream f;
+    return f.Open( claimFile.Get(), FileStream::CREATE_NEW_READ_WRITE );
+}
+
+// CloseSegment
+//------------------------------------------------------------------------------
+void PackedCache::CloseSegment()
+{
+    if ( m_Segment.IsOpen() )
+    {
+        // Wait for reads and writes in progress on other threads
+        while ( m_SegmentUsers.Load() > 0 )
+        {
+            Thread::Sleep( 1 );
+        }
+        m_Segment.Close();
+
+        // Let other processes continue the segment
+        AStackString claimFile;
+        GetSegmentClaimFileName( m_SegmentId, claimFile );
+        FileIO::FileDelete( claimFile.Get() );
+    }
+    m_SegmentId = 0;
+    m_SegmentSize = 0;
+}
+
+// ReadRecord
+//------------------------------------------------------------------------------
+bool PackedCache::ReadRecord( const IndexEntry & entry, const AString & cacheId, char *& outRecord )
+{
+    const size_t recordSize = ( sizeof( RecordHeader ) + entry.m_Size );
+    UniquePtr<char, FreeDeletor> record( (char *)ALLOC( recordSize ) );
+
+    bool ok = false;
+    bool activeSegment = false;
+    {
+        MutexHolder mh( m_Mutex );
+        if ( entry.m_SegmentId == m_SegmentId )
+        {
+            activeSegment = true;
+            m_SegmentUsers.Increment(); // Keep segment open while reading
+        }
+    }
+    if ( activeSegment )
+    {
+        // Read the segment being written through the same handle
+        ok = ( m_Segment.ReadBufferAt( record.Get(), recordSize, entry.m_Offset ) == recordSize );
+        m_SegmentUsers.Decrement();
+    }
+    else
+    {
+        AStackString segmentFile;
+        GetSegmentFileName( entry.m_SegmentId, segmentFile );
+        FileStream f;
+        ok = ( f.Open( segmentFile.Get(), FileStream::READ_ONLY ) &&
+               f.Seek( entry.m_Offset ) &&
+               ( f.ReadBuffer( record.Get(), recordSize ) == recordSize ) );
+    }
+    if ( ok == false )
+    {
+        return false; // Segment deleted (trimmed) or truncated
+    }
+
+    // Check record is the one we expected
+    const RecordHeader * header = reinterpret_cast<const RecordHeader *>( record.Get() );
+    if ( ( header->m_Magic != kRecordMagic ) || ( header->m_DataSize != entry.m_Size ) )
+    {
+        return false;
+    }
+    if ( cacheId.IsEmpty() == false )
+    {
+        if ( ( cacheId.GetLength() >= sizeof( header->m_CacheId ) ) ||
+             ( memcmp( header->m_CacheId, cacheId.Get(), cacheId.GetLength() + 1 ) != 0 ) )
+        {
+            return false; // Hash collision
+        }
+    }
+
+    outRecord = record.ReleaseOwnership();
+    return true;
+}
+
+// GetSegments
+//------------------------------------------------------------------------------
+void PackedCache::GetSegments( Array<FileIO::FileInfo> & outSegments, Array<uint32_t> & outSegmentIds ) const
+{
+    StackArray<AString> patterns;
+    patterns.EmplaceBack( "*" );
+    patterns.Top() += kSegmentExtension;
+    FileIO::GetFilesEx( m_CachePath, &patterns, false, &outSegments );
+
+    // Ignore unrelated files
+    outSegmentIds.SetCapacity( outSegments.GetSize() );
+    for ( size_t i = 0; i < outSegments.GetSize(); )
+    {
+        uint32_t segmentId;
+        if ( GetSegmentId( outSegments[ i ].m_Name, segmentId ) )
+        {
+            outSegmentIds.Append( segmentId );
+            ++i;
+        }
+        else
+        {
+            outSegments.EraseIndex( i );
+        }
+    }
+    outSegmentIds.Sort();
+}
+
+// GetSegmentId
+//------------------------------------------------------------------------------
+/*static*/ bool PackedCache::GetSegmentId( const AString & fileName, uint32_t & outSegmentId )
+{
+    // Name is XXXXXXXX.fpcs
+    const size_t nameLength = ( 8 + AString::StrLen( kSegmentExtension ) );
+    if ( ( fileName.GetLength() < nameLength ) || ( fileName.EndsWithI( kSegmentExtension ) == false ) )
+    {
+        return false;
+    }
+    outSegmentId = 0;
+    return ( ( AString::ScanS( fileName.Get() + fileName.GetLength() - nameLength, "%08X", &outSegmentId ) == 1 ) &&
+             ( outSegmentId != 0 ) );
+}
+
+// GetSegmentFileName
+//------------------------------------------------------------------------------
+void PackedCache::GetSegmentFileName( uint32_t segmentId, AString & outFileName ) const
+{
+    outFileName.Format( "%s%08X%s", m_CachePath.Get(), segmentId, kSegmentExtension );
+}
+
+// GetSegmentClaimFileName
+//------------------------------------------------------------------------------
+void PackedCache::GetSegmentClaimFileName( uint32_t segmentId, AString & outFileName ) const
+{
+    outFileName.Format( "%s%08X%s", m_CachePath.Get(), segmentId, kSegmentClaimExtension );
+}
+
+// GetKeyHash
+//------------------------------------------------------------------------------
+/*static*/ uint64_t PackedCache::GetKeyHash( const AString & cacheId )
+{
+    const uint64_t hash = xxHash3::Calc64( cacheId );
+    return ( hash != 0 ) ? hash : 1; // 0 indicates an empty bucket
+}
+
+// GetCurrentTimeMins
+//------------------------------------------------------------------------------
+/*static*/ uint32_t PackedCache::GetCurrentTimeMins()
+{
+    return (uint32_t)( Time::FileTimeToSeconds( Time::GetCurrentFileTime() ) / 60 );
+}
+
+//------------------------------------------------------------------------------
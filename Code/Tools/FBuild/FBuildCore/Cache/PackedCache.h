@@ -0,0 +1,175 @@
+// PackedCache - Cache storing entries in large segment files
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryMappedFile.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// PackedCache
+//  - Entries are appended to large segment files instead of a file per entry
+//  - A hash index, stored as a flat table which is memory mapped and probed in
+//    place, locates entries and tracks when they were last used
+//  - Trimming deletes (or compacts) whole segments, oldest first
+//  - New entries and uses of entries are appended to a journal instead of
+//    re-writing the index. Once the journal grows large, it is folded into the
+//    table by updating the affected buckets in place. The table is only
+//    re-written when it needs to grow, or by Trim.
+//  - Changes to the index and journal are serialized with a lock file, as the
+//    store may be shared by several machines. If the lock can't be taken, the
+//    change is dropped (entries are re-published as needed).
+//  - A segment is written by one process at a time (claimed with a file), and
+//    a recent segment with space left is re-used before a new one is created
+//------------------------------------------------------------------------------
+class PackedCache : public ICache
+{
+public:
+    explicit PackedCache();
+    virtual ~PackedCache() override;
+
+    virtual bool Init( const AString & cachePath,
+                       const AString & cachePathMountPoint,
+                       bool cacheRead,
+                       bool cacheWrite,
+                       bool cacheVerbose,
+                       const AString & pluginDLLConfig ) override;
+    virtual void Shutdown() override;
+    virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override;
+    virtual bool Retrieve( const AString & cacheId, void *& data, size_t & dataSize ) override;
+    virtual void FreeMemory( void * data, size_t dataSize ) override;
+    virtual bool OutputInfo( bool showProgress ) override;
+    virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual bool Query( const Array<AString> & cacheIds, Array<bool> & outFound ) override;
+
+    // Index file layout: IndexHeader followed by m_NumBuckets IndexEntry
+    class IndexHeader
+    {
+    public:
+        IndexHeader();
+
+        inline static const uint8_t kCurrentVersion = 1;
+
+        bool IsValid() const;
+
+        char m_Identifier[ 3 ];
+        uint8_t m_Version;
+        uint32_t m_NumBuckets; // Power of 2
+        uint32_t m_NumEntries;
+        uint32_t m_Padding;
+    };
+    class IndexEntry
+    {
+    public:
+        uint64_t m_KeyHash = 0; // Hash of cacheId (0 for empty bucket)
+        uint32_t m_SegmentId = 0;
+        uint32_t m_Offset = 0; // Offset of record in segment
+        uint32_t m_Size = 0; // Size of data (excluding record header)
+        uint32_t m_WriteTime = 0; // Minutes (when record was written)
+        uint32_t m_AccessTime = 0; // Minutes (when entry was last used)
+        uint32_t m_Modified = 0; // ModifiedFlags: Changed by this process (not persisted)
+    };
+    enum ModifiedFlags : uint32_t
+    {
+        MODIFIED_ENTRY = 0x1, // Added or moved
+        MODIFIED_ACCESS_TIME = 0x2, // Only used
+    };
+
+    // Journal file layout: sequence of JournalRecord
+    class JournalRecord
+    {
+    public:
+        uint64_t m_KeyHash;
+        uint32_t m_Type; // ModifiedFlags: MODIFIED_ENTRY (all fields) or MODIFIED_ACCESS_TIME
+        uint32_t m_SegmentId;
+        uint32_t m_Offset;
+        uint32_t m_Size;
+        uint32_t m_WriteTime;
+        uint32_t m_AccessTime;
+    };
+
+private:
+    class RecordHeader;
+    class IndexLock;
+
+    // Index (m_Mutex must be held)
+    //  - The table is probed in place. Entries changed since it was written (by
+    //    this process, or journaled by others) are held in an overlay, which
+    //    takes precedence.
+    const IndexEntry * FindEntry( uint64_t keyHash );
+    const IndexEntry * FindTableEntry( uint64_t keyHash ) const;
+    IndexEntry * FindOrAddOverlayEntry( uint64_t keyHash );
+    void ApplyToOverlay( const JournalRecord & record );
+    void GetModifiedRecords( Array<JournalRecord> & outRecords ) const;
+    void ClearModified();
+    void ResetOverlay();
+    void OpenIndex();
+    bool OpenTable( MemoryMappedFile & file, const IndexHeader *& outHeader ) const; // m_Mutex not required
+
+    // Hash table helpers
+    static IndexEntry * FindEntry( Array<IndexEntry> & buckets, uint64_t keyHash );
+    static IndexEntry * FindOrAddEntry( Array<IndexEntry> & buckets, uint32_t & numEntries, uint64_t keyHash );
+    static void Rehash( Array<IndexEntry> & buckets, uint32_t & numEntries, uint32_t numBuckets );
+    static void ApplyRecord( Array<IndexEntry> & buckets, uint32_t & numEntries, const JournalRecord & record );
+    static void ApplyRecord( IndexEntry & entry, const JournalRecord & record );
+
+    // Index files (m_Mutex must be held, except where noted)
+    bool ReadJournal( Array<JournalRecord> & outRecords ) const; // m_Mutex not required
+    bool SaveJournal();
+    bool PatchIndex( const IndexLock & lock, const Array<JournalRecord> & records );
+    void BuildTable( const Array<JournalRecord> & records,
+                     const Array<uint32_t> * sortedSegmentIds,
+                     Array<IndexEntry> & outBuckets,
+                     uint32_t & outNumEntries ) const; // m_Mutex not required
+    bool WriteTable( const IndexLock & lock, const Array<IndexEntry> & buckets, uint32_t numEntries );
+    void DeleteJournal() const;
+    void GetIndexFileName( AString & outFileName ) const;
+    void GetJournalFileName( AString & outFileName ) const;
+    void GetLockFileName( AString & outFileName ) const;
+
+    // Segment management (m_Mutex must be held, except where noted)
+    bool ReserveRecord( uint32_t dataSize, uint32_t & outSegmentId, uint32_t & outOffset );
+    bool WriteRecord( const RecordHeader & header, const void * data, uint32_t offset ); // Reserved record, m_Mutex not required
+    bool ReuseSegment();
+    bool CreateSegment();
+    bool ClaimSegment( uint32_t segmentId ) const;
+    void CloseSegment();
+    bool ReadRecord( const IndexEntry & entry, const AString & cacheId, char *& outRecord ); // m_Mutex must not be held
+    void GetSegments( Array<FileIO::FileInfo> & outSegments, Array<uint32_t> & outSegmentIds ) const;
+    void GetSegmentFileName( uint32_t segmentId, AString & outFileName ) const;
+    void GetSegmentClaimFileName( uint32_t segmentId, AString & outFileName ) const;
+
+    static bool GetSegmentId( const AString & fileName, uint32_t & outSegmentId );
+    static uint64_t GetKeyHash( const AString & cacheId );
+    static uint32_t GetCurrentTimeMins();
+
+    AString m_CachePath;
+    bool m_CacheWrite = false;
+
+    Mutex m_Mutex;
+    MemoryMappedFile m_IndexFile;
+    const IndexEntry * m_Table = nullptr; // In m_IndexFile
+    uint32_t m_TableNumBuckets = 0; // Power of 2 (or 0 if there's no table)
+    Array<IndexEntry> m_Overlay; // Changed since the table was written
+    uint32_t m_OverlayNumEntries = 0;
+    bool m_IndexDirty = false; // Entries added, moved or removed
+    bool m_AccessTimesDirty = false; // Entries used
+
+    // Segment new entries are written to
+    //  - Space is reserved with m_Mutex held, and written without it
+    FileStream m_Segment;
+    uint32_t m_SegmentId = 0;
+    uint32_t m_SegmentSize = 0; // Including reserved space
+    Atomic<uint32_t> m_SegmentUsers; // Reads/writes of m_Segment in progress without m_Mutex
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,338 @@
+// TieredCache - Local cache in front of a shared cache
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "TieredCache.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FBuildStats.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+#include "Core/Tracing/Tracing.h"
+
+// system
+#include <string.h> // for memcpy
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+TieredCache::TieredCache( ICache * sharedCache, const AString & localPath, uint32_t localSizeMiB )
+    : m_LocalPath( localPath )
+    , m_LocalSizeMiB( localSizeMiB )
+{
+    m_Tiers[ L2 ] = sharedCache;
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+/*virtual*/ TieredCache::~TieredCache()
+{
+    FDELETE m_LocalCache;
+    FDELETE m_Tiers[ L2 ];
+}
+
+// Init
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Init( const AString & cachePath,
+                                    const AString & cachePathMountPoint,
+                                    bool cacheRead,
+                                    bool cacheWrite,
+                                    bool cacheVerbose,
+                                    const AString & pluginDLLConfig )
+{
+    PROFILE_FUNCTION;
+
+    m_CacheVerbose = cacheVerbose;
+
+    // The shared cache determines if caching is available at all
+    if ( m_Tiers[ L2 ]->Init( cachePath, cachePathMountPoint, cacheRead, cacheWrite, cacheVerbose, pluginDLLConfig ) == false )
+    {
+        return false;
+    }
+
+    // The local cache is private, so is always writable (to hold promoted entries)
+    m_LocalCache = FNEW( Cache() );
+    if ( m_LocalCache->Init( m_LocalPath, AString::GetEmpty(), true, true, cacheVerbose, AString::GetEmpty() ) )
+    {
+        m_Tiers[ L1 ] = m_LocalCache;
+    }
+    else
+    {
+        // Continue with only the shared cache (Init will have emitted a warning)
+        FDELETE m_LocalCache;
+        m_LocalCache = nullptr;
+    }
+    return true;
+}
+
+// Shutdown
+//------------------------------------------------------------------------------
+/*virtual*/ void TieredCache::Shutdown()
+{
+    if ( m_LocalCache )
+    {
+        EnforceLocalSizeLimit();
+        m_LocalCache->Shutdown();
+    }
+    m_Tiers[ L2 ]->Shutdown();
+}
+
+// Publish
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Publish( const AString & cacheId, const void * data, size_t dataSize )
+{
+    bool stored = false;
+    for ( uint32_t tier = L1; tier < NUM_TIERS; ++tier )
+    {
+        if ( m_Tiers[ tier ] == nullptr )
+        {
+            continue;
+        }
+
+        const Timer t;
+        if ( m_Tiers[ tier ]->Publish( cacheId, data, dataSize ) )
+        {
+            m_Stats[ tier ].m_Stores.Increment();
+            if ( tier == L1 )
+            {
+                m_LocalBytesStored.Add( dataSize );
+            }
+            else
+            {
+                stored = true; // Only a store to the shared cache counts as success
+            }
+        }
+        m_Stats[ tier ].m_StoreTimeMS.Add( (uint64_t)t.GetElapsedMS() );
+    }
+    return stored;
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Retrieve( const AString & cacheId, void *& data, size_t & dataSize )
+{
+    data = nullptr;
+    dataSize = 0;
+
+    uint32_t timeMS[ NUM_TIERS ] = { 0, 0 };
+    for ( uint32_t tier = L1; tier < NUM_TIERS; ++tier )
+    {
+        if ( m_Tiers[ tier ] == nullptr )
+        {
+            continue;
+        }
+
+        const Timer t;
+        void * tierData = nullptr;
+        size_t tierDataSize = 0;
+        const bool hit = m_Tiers[ tier ]->Retrieve( cacheId, tierData, tierDataSize );
+        timeMS[ tier ] = (uint32_t)t.GetElapsedMS();
+        m_Stats[ tier ].m_Lookups.Increment();
+        m_Stats[ tier ].m_RetrieveTimeMS.Add( timeMS[ tier ] );
+        if ( hit == false )
+        {
+            continue;
+        }
+        m_Stats[ tier ].m_Hits.Increment();
+
+        if ( tier == L1 )
+        {
+            data = tierData;
+            dataSize = tierDataSize;
+
+            if ( m_CacheVerbose )
+            {
+                FLOG_OUTPUT( "Cache: L1 Hit: L1: %u ms '%s'\n", timeMS[ L1 ], cacheId.Get() );
+            }
+        }
+        else
+        {
+            // Promote to the local cache
+            bool promoted = false;
+            if ( m_LocalCache && m_LocalCache->Publish( cacheId, tierData, tierDataSize ) )
+            {
+                m_Promotions.Increment();
+                m_LocalBytesStored.Add( tierDataSize );
+                promoted = true;
+            }
+
+            // Memory handed out is always freed by the local cache implementation
+            // (the shared cache may be a plugin with its own allocator)
+            data = ALLOC( tierDataSize );
+            memcpy( data, tierData, tierDataSize );
+            dataSize = tierDataSize;
+            m_Tiers[ L2 ]->FreeMemory( tierData, tierDataSize );
+
+            if ( m_CacheVerbose )
+            {
+                FLOG_OUTPUT( "Cache: L2 Hit%s: L1: %u ms - L2: %u ms '%s'\n",
+                             promoted ? " (Promoted to L1)" : "",
+                             timeMS[ L1 ],
+                             timeMS[ L2 ],
+                             cacheId.Get() );
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+// FreeMemory
+//------------------------------------------------------------------------------
+/*virtual*/ void TieredCache::FreeMemory( void * data, size_t /*dataSize*/ )
+{
+    FREE( data ); // See Retrieve
+}
+
+// OutputInfo
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::OutputInfo( bool showProgress )
+{
+    bool ok = true;
+    if ( m_LocalCache )
+    {
+        OUTPUT( "Local Cache (L1):\n" );
+        ok &= m_LocalCache->OutputInfo( showProgress );
+    }
+    OUTPUT( "Shared Cache (L2):\n" );
+    ok &= m_Tiers[ L2 ]->OutputInfo( showProgress );
+    return ok;
+}
+
+// Trim
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Trim( bool showProgress, uint32_t sizeMiB )
+{
+    // The local cache has its own limit
+    bool ok = true;
+    if ( m_LocalCache )
+    {
+        OUTPUT( "Local Cache (L1):\n" );
+        ok &= m_LocalCache->Trim( showProgress, m_LocalSizeMiB );
+    }
+    OUTPUT( "Shared Cache (L2):\n" );
+    ok &= m_Tiers[ L2 ]->Trim( showProgress, sizeMiB );
+    return ok;
+}
+
+// Query
+//------------------------------------------------------------------------------
+/*virtual*/ bool TieredCache::Query( const Array<AString> & cacheIds, Array<bool> & outFound )
+{
+    // Check locally first
+    if ( ( m_LocalCache == nullptr ) || ( m_LocalCache->Query( cacheIds, outFound ) == false ) )
+    {
+        return m_Tiers[ L2 ]->Query( cacheIds, outFound );
+    }
+
+    // Check remaining entries in the shared cache
+    StackArray<AString> remainingIds;
+    StackArray<uint32_t> remainingIndices;
+    for ( size_t i = 0; i < cacheIds.GetSize(); ++i )
+    {
+        if ( outFound[ i ] == false )
+        {
+            remainingIds.Append( cacheIds[ i ] );
+            remainingIndices.Append( (uint32_t)i );
+        }
+    }
+    if ( remainingIds.IsEmpty() )
+    {
+        return true;
+    }
+
+    StackArray<bool> remainingFound;
+    if ( m_Tiers[ L2 ]->Query( remainingIds, remainingFound ) == false )
+    {
+        return false; // Can't tell if other entries exist
+    }
+    for ( size_t i = 0; i < remainingIndices.GetSize(); ++i )
+    {
+        outFound[ remainingIndices[ i ] ] = remainingFound[ i ];
+    }
+    return true;
+}
+
+// GetStats
+//------------------------------------------------------------------------------
+void TieredCache::GetStats( FBuildStats & outStats )
+{
+    outStats.m_CacheTiered = true;
+    for ( uint32_t tier = L1; tier < NUM_TIERS; ++tier )
+    {
+        TierStats & stats = m_Stats[ tier ];
+        FBuildStats::CacheTierStats & out = outStats.m_CacheTiers[ tier ];
+        out.m_Lookups = stats.m_Lookups.Load();
+        out.m_Hits = stats.m_Hits.Load();
+        out.m_RetrieveTimeMS = stats.m_RetrieveTimeMS.Load();
+        out.m_Stores = stats.m_Stores.Load();
+        out.m_StoreTimeMS = stats.m_StoreTimeMS.Load();
+        stats.m_Lookups.Store( 0 );
+        stats.m_Hits.Store( 0 );
+        stats.m_RetrieveTimeMS.Store( 0 );
+        stats.m_Stores.Store( 0 );
+        stats.m_StoreTimeMS.Store( 0 );
+    }
+    outStats.m_CachePromotions = m_Promotions.Load();
+    m_Promotions.Store( 0 );
+}
+
+// EnforceLocalSizeLimit
+//------------------------------------------------------------------------------
+void TieredCache::EnforceLocalSizeLimit()
+{
+    const uint64_t bytesStored = m_LocalBytesStored.Load();
+    if ( bytesStored == 0 )
+    {
+        return;
+    }
+
+    PROFILE_FUNCTION;
+
+    // Scanning the whole cache is expensive, so an estimate of the size is kept
+    // alongside it and the scan only done once the limit is exceeded. Entries
+    // replaced or removed by other processes make this an over-estimate.
+    AStackString sizeFileName( m_LocalPath );
+    PathUtils::EnsureTrailingSlash( sizeFileName );
+    sizeFileName += Cache::kSizeEstimateFileName;
+
+    uint64_t size = 0;
+    {
+        FileStream f;
+        if ( f.Open( sizeFileName.Get(), FileStream::READ_ONLY ) )
+        {
+            if ( f.Read( size ) == false )
+            {
+                size = 0;
+            }
+        }
+    }
+    size += bytesStored;
+
+    const uint64_t limit = ( (uint64_t)m_LocalSizeMiB * MEGABYTE );
+    if ( size > limit )
+    {
+        // Trim below the limit so the scan is not repeated by every build
+        size = m_LocalCache->EnforceSizeLimit( (uint32_t)( ( (uint64_t)m_LocalSizeMiB * 3 ) / 4 ) );
+    }
+
+    FileStream f;
+    if ( f.Open( sizeFileName.Get(), FileStream::WRITE_ONLY ) )
+    {
+        f.Write( size );
+    }
+    m_LocalBytesStored.Store( 0 );
+}
+
+//------------------------------------------------------------------------------
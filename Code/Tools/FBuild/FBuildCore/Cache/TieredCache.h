@@ -0,0 +1,80 @@
+// TieredCache - Local cache in front of a shared cache
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+
+// Core
+#include "Core/Process/Atomic.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class Cache;
+struct FBuildStats;
+
+// TieredCache
+//  - Entries are looked up in a local cache (L1) before the shared cache (L2)
+//  - Entries retrieved from L2 are promoted to L1, so later builds on the
+//    same machine are served at local disk speed
+//  - Entries are written through to both tiers
+//  - L1 is bounded, with the oldest entries removed when it grows too large
+//------------------------------------------------------------------------------
+class TieredCache : public ICache
+{
+public:
+    TieredCache( ICache * sharedCache, const AString & localPath, uint32_t localSizeMiB ); // Takes ownership of sharedCache
+    virtual ~TieredCache() override;
+
+    virtual bool Init( const AString & cachePath,
+                       const AString & cachePathMountPoint,
+                       bool cacheRead,
+                       bool cacheWrite,
+                       bool cacheVerbose,
+                       const AString & pluginDLLConfig ) override;
+    virtual void Shutdown() override;
+    virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override;
+    virtual bool Retrieve( const AString & cacheId, void *& data, size_t & dataSize ) override;
+    virtual void FreeMemory( void * data, size_t dataSize ) override;
+    virtual bool OutputInfo( bool showProgress ) override;
+    virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual bool Query( const Array<AString> & cacheIds, Array<bool> & outFound ) override;
+
+    // Record stats for the build and reset for the next one
+    void GetStats( FBuildStats & outStats );
+
+    enum Tier : uint32_t
+    {
+        L1,     // Local
+        L2,     // Shared
+        NUM_TIERS
+    };
+
+private:
+    void EnforceLocalSizeLimit();
+
+    class TierStats
+    {
+    public:
+        Atomic<uint32_t> m_Lookups;
+        Atomic<uint32_t> m_Hits;
+        Atomic<uint64_t> m_RetrieveTimeMS;
+        Atomic<uint32_t> m_Stores;
+        Atomic<uint64_t> m_StoreTimeMS;
+    };
+
+    ICache * m_Tiers[ NUM_TIERS ] = { nullptr, nullptr };
+    Cache * m_LocalCache = nullptr; // L1, when available
+    AString m_LocalPath;
+    const uint32_t m_LocalSizeMiB;
+    bool m_CacheVerbose = false;
+
+    TierStats m_Stats[ NUM_TIERS ];
+    Atomic<uint32_t> m_Promotions;
+    Atomic<uint64_t> m_LocalBytesStored; // Since startup
+};
+
+//------------------------------------------------------------------------------
@@ -9,8 +9,13 @@
 #include "BFF/Functions/Function.h"
 #include "Cache/Cache.h"
 #include "Cache/CachePlugin.h"
+#include "Cache/CacheProbe.h"
+#include "Cache/CachePublishQueue.h"
+#include "Cache/HTTPCache.h"
 #include "Cache/ICache.h"
 #include "Cache/LightCache.h"
+#include "Cache/PackedCache.h"
+#include "Cache/TieredCache.h"
 #include "FLog.h"
 #include "Graph/Node.h"
 #include "Graph/NodeGraph.h"
@@ -18,6 +23,7 @@
 #include "Graph/SettingsNode.h"
 #include "Helpers/BuildProfiler.h"
 #include "Helpers/CompilationDatabase.h"
+#include "Helpers/CompressionDictionary.h"
 #include "Helpers/SourceFileTargetResolver.h"
 #include "Protocol/Client.h"
 #include "Protocol/Protocol.h"
@@ -112,8 +118,14 @@ FBuild::~FBuild()
 
     Function::Destroy();
 
+    // Complete any outstanding stores before closing the cache (and before
+    // freeing the nodes they refer to)
+    FDELETE m_CacheProbe;
+    FDELETE m_CachePublishQueue;
+
     FDELETE m_DependencyGraph;
     FDELETE m_Client;
+    FDELETE m_CompressionDictionaryTrainer;
     FREE( m_EnvironmentString );
 
     if ( m_Cache )
@@ -162,26 +174,7 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
     }
     else
     {
-        if ( m_Options.m_DBFile.IsEmpty() )
-        {
-            m_DependencyGraphFile = bffFile;
-            if ( m_DependencyGraphFile.EndsWithI( ".bff" ) )
-            {
-                m_DependencyGraphFile.SetLength( m_DependencyGraphFile.GetLength() - 4 );
-            }
-#if defined( __WINDOWS__ )
-            m_DependencyGraphFile += ".windows.fdb";
-#elif defined( __OSX__ )
-            m_DependencyGraphFile += ".osx.fdb";
-#elif defined( __LINUX__ )
-            m_DependencyGraphFile += ".linux.fdb";
-#endif
-        }
-        else
-        {
-            // DB filename explicitly set on command line
-            m_DependencyGraphFile = m_Options.m_DBFile;
-        }
+        GetDependencyGraphFileName( m_Options, m_DependencyGraphFile );
     }
 
     m_DependencyGraph = NodeGraph::Initialize( bffFile, m_DependencyGraphFile.Get(), m_Options.m_ForceDBMigration_Debug );
@@ -191,6 +184,21 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
         return false;
     }
 
+    // Files parsed by the LightCache in previous builds
+    LightCache::LoadIndex( m_DependencyGraphFile.Get() );
+
+    // Input files need only be re-hashed if modified since hashed
+    if ( m_Options.m_UseContentHashStamps )
+    {
+        m_DependencyGraph->LoadContentHashes( m_DependencyGraphFile.Get() );
+    }
+
+    // Input files reported as unchanged need not be checked
+    if ( m_Options.m_UseFileWatcher )
+    {
+        m_DependencyGraph->SyncFileWatcher( m_DependencyGraphFile.Get() );
+    }
+
     const SettingsNode * settings = m_DependencyGraph->GetSettings();
 
     // if the cache is enabled, make sure the path is set and accessible
@@ -200,11 +208,26 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
         {
             m_Cache = FNEW( CachePlugin( settings->GetCachePluginDLL() ) );
         }
+        else if ( HTTPCache::IsHTTPPath( settings->GetCachePath() ) )
+        {
+            m_Cache = FNEW( HTTPCache() );
+        }
+        else if ( settings->GetCachePacked() )
+        {
+            m_Cache = FNEW( PackedCache() );
+        }
         else
         {
             m_Cache = FNEW( Cache() );
         }
 
+        // optionally put a local cache in front of the shared one
+        if ( !settings->GetCacheLocalPath().IsEmpty() )
+        {
+            m_TieredCache = FNEW( TieredCache( m_Cache, settings->GetCacheLocalPath(), settings->GetCacheLocalSizeMiB() ) );
+            m_Cache = m_TieredCache;
+        }
+
         if ( m_Cache->Init( settings->GetCachePath(),
                             settings->GetCachePathMountPoint(),
                             m_Options.m_UseCacheRead,
@@ -216,12 +239,50 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
             m_Options.m_UseCacheWrite = false;
             FDELETE m_Cache;
             m_Cache = nullptr;
+            m_TieredCache = nullptr;
+        }
+        else
+        {
+            if ( m_Options.m_UseCacheWrite && ( m_Options.m_CacheWriteQueueMiB > 0 ) )
+            {
+                m_CachePublishQueue = FNEW( CachePublishQueue( m_Options.m_CacheWriteQueueMiB ) );
+            }
+            if ( m_Options.m_UseCacheRead && m_Options.m_CacheProbe )
+            {
+                m_CacheProbe = FNEW( CacheProbe( m_Cache ) );
+            }
         }
     }
 
     return true;
 }
 
+// GetDependencyGraphFileName
+//------------------------------------------------------------------------------
+/*static*/ void FBuild::GetDependencyGraphFileName( const FBuildOptions & options, AString & outFileName )
+{
+    if ( options.m_DBFile.IsEmpty() == false )
+    {
+        // DB filename explicitly set on command line
+        outFileName = options.m_DBFile;
+        return;
+    }
+
+    outFileName = options.m_ConfigFile.IsEmpty() ? GetDefaultBFFFileName()
+                                                 : options.m_ConfigFile.Get();
+    if ( outFileName.EndsWithI( ".bff" ) )
+    {
+        outFileName.SetLength( outFileName.GetLength() - 4 );
+    }
+#if defined( __WINDOWS__ )
+    outFileName += ".windows.fdb";
+#elif defined( __OSX__ )
+    outFileName += ".osx.fdb";
+#elif defined( __LINUX__ )
+    outFileName += ".linux.fdb";
+#endif
+}
+
 // Build
 //------------------------------------------------------------------------------
 bool FBuild::Build( const char * target )
@@ -354,6 +415,18 @@ bool FBuild::SaveDependencyGraph( const char * nodeGraphDBFile ) const
 
     const Timer t;
 
+    // Append only what has changed since the DB was last saved, if possible
+    if ( m_Options.m_UseDBJournal && m_DependencyGraph->SaveJournal( nodeGraphDBFile ) )
+    {
+        LightCache::SaveIndex( nodeGraphDBFile );
+        m_DependencyGraph->SaveFileWatcherState( nodeGraphDBFile );
+        m_DependencyGraph->SaveContentHashes( nodeGraphDBFile );
+        m_DependencyGraph->SaveTokenCache( nodeGraphDBFile );
+
+        FLOG_VERBOSE( "Saving DepGraph Journal Complete in %2.3fs", (double)t.GetElapsed() );
+        return true;
+    }
+
     // serialize into memory first
     ChainedMemoryStream memoryStream( 8 * 1024 * 1024 );
     m_DependencyGraph->Save( memoryStream, nodeGraphDBFile );
@@ -395,6 +468,22 @@ bool FBuild::SaveDependencyGraph( const char * nodeGraphDBFile ) const
 
     // Truncate if new data is smaller than old data
     fileStream.Truncate();
+    fileStream.Close();
+
+    // Future changes can be journaled against this DB
+    m_DependencyGraph->OnSaved( nodeGraphDBFile, memoryStream );
+
+    // Persist files parsed by the LightCache
+    LightCache::SaveIndex( nodeGraphDBFile );
+
+    // Persist input file stamps (saved after the DB, as they refer to its nodes)
+    m_DependencyGraph->SaveFileWatcherState( nodeGraphDBFile );
+
+    // Persist content hashes of input files
+    m_DependencyGraph->SaveContentHashes( nodeGraphDBFile );
+
+    // Persist tokens of BFF files for the next parse
+    m_DependencyGraph->SaveTokenCache( nodeGraphDBFile );
 
     FLOG_VERBOSE( "Saving DepGraph Complete in %2.3fs", (double)t.GetElapsed() );
     return true;
@@ -416,8 +505,12 @@ void FBuild::SaveDependencyGraph( ChainedMemoryStream & stream, const char * nod
     s_StopBuild.Store( false ); // allow multiple runs in same process
     s_AbortBuild.Store( false ); // allow multiple runs in same process
 
+    // stamp input files in bulk
+    // (must be before JobQueue occupies the ThreadPool)
+    m_DependencyGraph->PrefetchFileNodeStamps( nodeToBuild, m_ThreadPool );
+
     // create worker threads
-    m_JobQueue = FNEW( JobQueue( m_Options.m_NumWorkerThreads, m_ThreadPool ) );
+    m_JobQueue = FNEW( JobQueue( *m_DependencyGraph, m_Options.m_NumWorkerThreads, m_ThreadPool ) );
 
     // create the connection management system if needed
     // (must be after JobQueue is created)
@@ -428,6 +521,11 @@ void FBuild::SaveDependencyGraph( ChainedMemoryStream & stream, const char * nod
                                  m_Options.m_DistributionPort,
                                  settings->GetWorkerConnectionLimit(),
                                  m_Options.m_DistVerbose ) );
+
+        if ( m_Options.m_DistributionDictionary && ( m_CompressionDictionaryTrainer == nullptr ) )
+        {
+            m_CompressionDictionaryTrainer = FNEW( CompressionDictionaryTrainer );
+        }
     }
 
     m_Timer.Restart();
@@ -460,8 +558,11 @@ void FBuild::SaveDependencyGraph( ChainedMemoryStream & stream, const char * nod
 
             if ( !stopping )
             {
-                // do a sweep of the graph to create more jobs
+                // progress the graph to create more jobs
+                // (either resuming woken nodes, or with a full sweep)
+                const Timer passTimer;
                 m_DependencyGraph->DoBuildPass( nodeToBuild );
+                m_BuildStats.m_BuildPassTime += passTimer.GetElapsed();
             }
 
             if ( m_Options.m_NumWorkerThreads == 0 )
@@ -526,9 +627,33 @@ void FBuild::SaveDependencyGraph( ChainedMemoryStream & stream, const char * nod
         // wrap up/free any jobs that come from the last build pass
         m_JobQueue->FinalizeCompletedJobs( *m_DependencyGraph );
 
+        // An incomplete build can leave nodes waiting on dependencies
+        if ( ( m_Options.m_UseSweepScheduler == false ) &&
+             ( nodeToBuild->GetState() != Node::UP_TO_DATE ) )
+        {
+            m_DependencyGraph->ClearPendingDependencies();
+        }
+
+        // Wait for cache lookups still in progress in the background (before
+        // the JobQueue is freed, as they can re-prioritize queued jobs)
+        if ( m_CacheProbe )
+        {
+            m_CacheProbe->Flush( m_BuildStats );
+        }
+
         FDELETE m_JobQueue;
         m_JobQueue = nullptr;
 
+        // Wait for cache stores still in progress in the background
+        if ( m_CachePublishQueue )
+        {
+            m_CachePublishQueue->Flush( m_BuildStats );
+        }
+        if ( m_TieredCache )
+        {
+            m_TieredCache->GetStats( m_BuildStats );
+        }
+
         FLog::StopBuild();
     }
 
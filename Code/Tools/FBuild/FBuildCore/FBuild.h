@@ -19,7 +19,10 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class CacheProbe;
+class CachePublishQueue;
 class Client;
+class CompressionDictionaryTrainer;
 class Dependencies;
 class FileStream;
 class ICache;
@@ -28,6 +31,7 @@ class JobQueue;
 class Node;
 class NodeGraph;
 class ThreadPool;
+class TieredCache;
 
 // FBuild
 //------------------------------------------------------------------------------
@@ -53,10 +57,12 @@ public:
     void SaveDependencyGraph( ChainedMemoryStream & memorySteam, const char * nodeGraphDBFile ) const;
 
     const FBuildOptions & GetOptions() const { return m_Options; }
+    ThreadPool * GetThreadPool() const { return m_ThreadPool; }
 
     const AString & GetWorkingDir() const { return m_Options.GetWorkingDir(); }
 
     static const char * GetDefaultBFFFileName();
+    static void GetDependencyGraphFileName( const FBuildOptions & options, AString & outFileName );
 
     const SettingsNode * GetSettings() const { return m_DependencyGraph->GetSettings(); }
 
@@ -108,6 +114,10 @@ public:
     static Atomic<bool> * GetAbortBuildPointer() { return &s_AbortBuild; }
 
     ICache * GetCache() const { return m_Cache; }
+    CachePublishQueue * GetCachePublishQueue() const { return m_CachePublishQueue; }
+    CacheProbe * GetCacheProbe() const { return m_CacheProbe; }
+
+    CompressionDictionaryTrainer * GetCompressionDictionaryTrainer() const { return m_CompressionDictionaryTrainer; }
 
     static bool GetTempDir( AString & outTempDir );
 
@@ -138,9 +148,13 @@ protected:
     JobQueue * m_JobQueue;
     mutable Mutex m_ClientLifetimeMutex;
     Client * m_Client; // manage connections to worker servers
+    CompressionDictionaryTrainer * m_CompressionDictionaryTrainer = nullptr; // Dictionary for distributed jobs (-distdictionary)
 
     AString m_DependencyGraphFile;
     ICache * m_Cache;
+    CachePublishQueue * m_CachePublishQueue = nullptr; // Cache stores in the background
+    CacheProbe * m_CacheProbe = nullptr; // Cache lookups ahead of compilation
+    TieredCache * m_TieredCache = nullptr; // m_Cache, when a local cache is used
 
     Timer m_Timer;
     float m_LastProgressOutputTime;
@@ -174,6 +174,23 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += argv[ sizeIndex ];
                 continue;
             }
+            else if ( thisArg == "-cachewritequeue" )
+            {
+                const int sizeIndex = ( i + 1 );
+                if ( ( sizeIndex >= argc ) ||
+                     ( AString::ScanS( argv[ sizeIndex ], "%u", &m_CacheWriteQueueMiB ) ) != 1 )
+                {
+                    OUTPUT( "FBuild: Error: Missing or bad <sizeMiB> for '-cachewritequeue' argument\n" );
+                    OUTPUT( "Try \"%s -help\"\n", programName.Get() );
+                    return OPTIONS_ERROR;
+                }
+                i++; // skip extra arg we've consumed
+
+                // add to args we might pass to subprocess
+                m_Args += ' ';
+                m_Args += argv[ sizeIndex ];
+                continue;
+            }
             else if ( thisArg == "-distcompressionlevel" )
             {
                 const int sizeIndex = ( i + 1 );
@@ -223,6 +240,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += '"';
                 continue;
             }
+            else if ( thisArg == "-contenthash" )
+            {
+                m_UseContentHashStamps = true;
+                continue;
+            }
             else if ( thisArg == "-dbfile" )
             {
                 const int32_t pathIndex = ( i + 1 );
@@ -242,6 +264,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += '"';
                 continue;
             }
+            else if ( thisArg == "-dbjournal" )
+            {
+                m_UseDBJournal = true;
+                continue;
+            }
 #if defined( __WINDOWS__ )
             else if ( thisArg == "-debug" )
             {
@@ -254,6 +281,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_AllowDistributed = true;
                 continue;
             }
+            else if ( thisArg == "-distdictionary" )
+            {
+                m_DistributionDictionary = true;
+                continue;
+            }
             else if ( thisArg == "-distverbose" )
             {
                 m_AllowDistributed = true;
@@ -279,6 +311,16 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 OUTPUT( "FBuild: Warning: -fastcancel is deprecated. (\"fastcancel\" is on by default)\n" );
                 continue;
             }
+            else if ( thisArg == "-filewatcher" )
+            {
+                m_UseFileWatcher = true;
+                continue;
+            }
+            else if ( thisArg == "-filewatcherdaemon" )
+            {
+                m_RunFileWatcher = true;
+                continue;
+            }
             else if ( thisArg == "-fixuperrorpaths" )
             {
                 m_FixupErrorPaths = true;
@@ -320,6 +362,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_EnableMonitor = true;
                 continue;
             }
+            else if ( thisArg == "-nocacheprobe" )
+            {
+                m_CacheProbe = false;
+                continue;
+            }
             else if ( thisArg == "-nofastcancel" )
             {
                 m_FastCancel = false;
@@ -445,6 +492,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_ShowSummary = true;
                 continue;
             }
+            else if ( thisArg == "-sweepscheduler" )
+            {
+                m_UseSweepScheduler = true;
+                continue;
+            }
             else if ( thisArg == "-verbose" )
             {
                 m_ShowVerbose = true;
@@ -655,12 +707,19 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             " -cacheinfo        Output cache statistics.\n"
             " -cachetrim <size> Trim the cache to the given size in MiB.\n"
             " -cacheverbose     Emit details about cache interactions.\n"
+            " -cachewritequeue <sizeMiB>\n"
+            "                   Memory for cache stores queued in the background\n"
+            "                   (default: 256). 0 stores before jobs complete.\n"
             " -clean            Force a clean build.\n"
             " -compdb           Generate JSON compilation database for targets.\n"
             " -config <path>    Explicitly specify the config file to use.\n"
+            " -contenthash      Stamp input files with a hash of their contents, so files\n"
+            "                   which are modified but unchanged don't cause rebuilds.\n"
             " -continueafterdbmove\n"
             "       Allow builds after a DB move.\n"
             " -dbfile <path>    Explicitly specify the dependency database file to use.\n"
+            " -dbjournal        Append changes to a journal at the end of the build, instead\n"
+            "                   of resaving the whole dependency database.\n"
             " -debug            (Windows) Break at startup, to attach debugger.\n"
             " -dist             Allow distributed compilation.\n"
             " -distverbose      Print detailed info for distributed compilation.\n"
@@ -669,8 +728,15 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             "                   - <= -1 : less compression, with -128 being the lowest\n"
             "                   - ==  0 : disable compression\n"
             "                   - >=  1 : more compression, with 12 being the highest\n"
+            " -distdictionary   Compress distributed jobs with Zstd, using a dictionary\n"
+            "                   trained on the first jobs of the build.\n"
             " -dot[full]        Emit known dependency tree info for specified targets to an\n"
             "                   fbuild.gv file in DOT format.\n"
+            " -filewatcher      (Linux) Trust input file timestamps from the previous build,\n"
+            "                   except for changes reported by a -filewatcherdaemon.\n"
+            " -filewatcherdaemon\n"
+            "                   (Linux) Run until terminated, recording changes to files\n"
+            "                   used by builds with -filewatcher.\n"
             " -fixuperrorpaths  Reformat error paths to be Visual Studio friendly.\n"
             " -forceremote      Force distributable jobs to only be built remotely.\n"
             " -help             Show this help.\n"
@@ -680,6 +746,7 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             " -j<x>             Explicitly set LOCAL worker thread count X, instead of\n"
             "                   default of hardware thread count.\n"
             " -monitor          Emit a machine-readable file while building.\n"
+            " -nocacheprobe     Disable looking up cache entries ahead of compilation.\n"
             " -nofastcancel     Disable aborting other tasks as soon any task fails.\n"
             " -nolocalrace      Disable local race of remotely started jobs.\n"
             " -noprogress       Don't show the progress bar while building.\n"
@@ -701,6 +768,8 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             " -sourcefile <path[s]>\n"
             "                   Reduce targets to attempt minimal source file builds.\n"
             " -summary          Show a summary at the end of the build.\n"
+            " -sweepscheduler   Find work by sweeping the whole dependency graph, instead\n"
+            "                   of waking nodes as their dependencies complete.\n"
             " -verbose          Show detailed diagnostic info. (Increases built time)\n"
             " -version          Print version and exit.\n"
             " -vs               VisualStudio mode. Same as -ide.\n"
@@ -63,6 +63,11 @@ public:
     bool m_GenerateDotGraphFull = false;
     bool m_GenerateCompilationDatabase = false;
     bool m_NoUnity = false;
+    bool m_UseSweepScheduler = false; // Sweep the whole graph every pass instead of waking dependents
+    bool m_UseDBJournal = false; // Append changes to a journal instead of resaving the whole DB
+    bool m_UseFileWatcher = false; // Only check input files reported as changed by the FileWatcher
+    bool m_RunFileWatcher = false; // Run as the FileWatcher, instead of building
+    bool m_UseContentHashStamps = false; // Stamp input files by content rather than modification time
 
     // Cache
     bool m_UseCacheRead = false;
@@ -71,6 +76,8 @@ public:
     bool m_CacheVerbose = false;
     uint32_t m_CacheTrim = 0;
     int16_t m_CacheCompressionLevel = 1; // See Compressor.h
+    uint32_t m_CacheWriteQueueMiB = 256; // Memory for stores queued in the background (0 = store synchronously)
+    bool m_CacheProbe = true; // Look up cache entries for queued jobs in the background
 
     // Distributed Compilation
     bool m_AllowDistributed = false;
@@ -79,6 +86,7 @@ public:
     bool m_AllowLocalRace = true;
     uint16_t m_DistributionPort = Protocol::kPort;
     int16_t m_DistributionCompressionLevel = -1; // See Compressor.h
+    bool m_DistributionDictionary = false; // Train a dictionary to compress jobs (see CompressionDictionary.h)
 
     // General Output
     bool m_ShowVerbose = false;
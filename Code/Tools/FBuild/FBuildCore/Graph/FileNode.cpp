@@ -9,7 +9,12 @@
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 
 // Core
+#include "Core/Containers/UniquePtr.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
 #include "Core/Strings/AStackString.h"
 
 #include <string.h> // for strstr
@@ -45,11 +50,112 @@ FileNode::~FileNode() = default;
 #endif
 
     // NOTE: Not calling RecordStampFromBuiltFile as this is not a built file
-    m_Stamp = FileIO::GetFileLastWriteTime( m_Name );
+    m_Stamp = CalcStamp();
     // Don't assert m_Stamp != 0 as input file might not exist
     return BuildResult::eOk;
 }
 
+// PrefetchStamp
+//------------------------------------------------------------------------------
+void FileNode::PrefetchStamp()
+{
+    m_PrefetchedStamp = CalcStamp();
+    m_HasPrefetchedStamp = true;
+}
+
+// UsePrefetchedStamp
+//------------------------------------------------------------------------------
+void FileNode::UsePrefetchedStamp()
+{
+    ASSERT( m_HasPrefetchedStamp );
+    m_Stamp = m_PrefetchedStamp;
+    m_HasPrefetchedStamp = false; // Only valid for the build it was gathered for
+}
+
+// SetPrefetchedStamp
+//------------------------------------------------------------------------------
+void FileNode::SetPrefetchedStamp( uint64_t stamp )
+{
+    m_PrefetchedStamp = stamp;
+    m_HasPrefetchedStamp = true;
+}
+
+// SetContentHash
+//------------------------------------------------------------------------------
+void FileNode::SetContentHash( uint64_t lastWriteTime, uint64_t contentHash )
+{
+    m_ContentHashLastWriteTime = lastWriteTime;
+    m_ContentHash = contentHash;
+}
+
+// CalcStamp
+//------------------------------------------------------------------------------
+uint64_t FileNode::CalcStamp()
+{
+    const uint64_t lastWriteTime = FileIO::GetFileLastWriteTime( m_Name );
+    if ( ( lastWriteTime == 0 ) || // Missing files always have a zero stamp
+         ( FBuild::IsValid() == false ) || // Unit Tests
+         ( FBuild::Get().GetOptions().m_UseContentHashStamps == false ) )
+    {
+        return lastWriteTime;
+    }
+
+    // Only files modified since they were last hashed need to be read
+    if ( ( m_ContentHash == 0 ) || ( lastWriteTime != m_ContentHashLastWriteTime ) )
+    {
+        uint64_t contentHash;
+        if ( CalcContentHash( m_Name, contentHash ) == false )
+        {
+            // Can't be equal to a content hash (barring collisions), so dependents
+            // will rebuild and report any problem accessing the file
+            return lastWriteTime;
+        }
+
+        // The time was retrieved before the contents were read, so if the file is
+        // modified again the time will change and the file will be hashed again
+        m_ContentHashLastWriteTime = lastWriteTime;
+        m_ContentHash = contentHash;
+    }
+    return m_ContentHash;
+}
+
+// CalcContentHash
+//------------------------------------------------------------------------------
+/*static*/ bool FileNode::CalcContentHash( const AString & fileName, uint64_t & outHash )
+{
+    FileStream f;
+    if ( f.Open( fileName.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+
+    // Read in chunks (this can run on threads with small stacks)
+    const uint64_t kChunkSize = ( 256 * 1024 );
+    const uint64_t fileSize = f.GetFileSize();
+    const uint32_t bufferSize = static_cast<uint32_t>( Math::Max<uint64_t>( Math::Min( fileSize, kChunkSize ), 1 ) );
+    UniquePtr<char, FreeDeletor> buffer( static_cast<char *>( ALLOC( bufferSize ) ) );
+    xxHash3Accumulator accumulator;
+    uint64_t remaining = fileSize;
+    while ( remaining > 0 )
+    {
+        const uint64_t toRead = Math::Min<uint64_t>( remaining, bufferSize );
+        if ( f.ReadBuffer( buffer.Get(), toRead ) != toRead )
+        {
+            return false;
+        }
+        accumulator.AddDataBig( buffer.Get(), static_cast<size_t>( toRead ) );
+        remaining -= toRead;
+    }
+    outHash = accumulator.Finalize64();
+
+    // Zero is reserved for missing files
+    if ( outHash == 0 )
+    {
+        outHash = 1;
+    }
+    return true;
+}
+
 // HandleWarningsMSVC
 //------------------------------------------------------------------------------
 void FileNode::HandleWarningsMSVC( Job * job, const AString & name, const AString & data )
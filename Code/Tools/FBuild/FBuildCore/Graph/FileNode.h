@@ -19,6 +19,20 @@ public:
 
     virtual bool IsAFile() const override { return true; }
 
+    // Stamps can be gathered in bulk before the build (see NodeGraph::PrefetchFileNodeStamps)
+    void PrefetchStamp(); // safe to call from any thread
+    bool HasPrefetchedStamp() const { return m_HasPrefetchedStamp; }
+    void ClearPrefetchedStamp() { m_HasPrefetchedStamp = false; }
+    void UsePrefetchedStamp();
+    void SetPrefetchedStamp( uint64_t stamp ); // Known without a stat (see NodeGraph::SyncFileWatcher)
+    uint64_t GetPrefetchedStamp() const { return m_PrefetchedStamp; }
+
+    // With -contenthash, stamps are a hash of the file contents, only re-calculated
+    // when the modification time changes (see NodeGraph::LoadContentHashes)
+    void SetContentHash( uint64_t lastWriteTime, uint64_t contentHash );
+    uint64_t GetContentHashLastWriteTime() const { return m_ContentHashLastWriteTime; }
+    uint64_t GetContentHash() const { return m_ContentHash; }
+
     static void HandleWarningsMSVC( Job * job, const AString & name, const AString & data );
     static void HandleWarningsClangCl( Job * job, const AString & name, const AString & data );
     static void HandleWarningsClangGCC( Job * job, const AString & name, const AString & data );
@@ -30,7 +44,15 @@ protected:
     static void DumpOutput( Job * job, const AString & name, const AString & data, bool treatAsWarnings = false );
     static void HandleWarnings( Job * job, const AString & name, const AString & data, const char * warningString );
 
+    uint64_t CalcStamp();
+    static bool CalcContentHash( const AString & fileName, uint64_t & outHash );
+
     friend class Client;
+
+    uint64_t m_PrefetchedStamp = 0;
+    bool m_HasPrefetchedStamp = false;
+    uint64_t m_ContentHashLastWriteTime = 0; // Modification time when m_ContentHash was calculated
+    uint64_t m_ContentHash = 0;
 };
 
 //------------------------------------------------------------------------------
@@ -199,6 +199,14 @@ LinkerNode::~LinkerNode()
         return BuildResult::eFailed; // BuildArgs will have emitted an error
     }
 
+    // Note files written outside the output's directory, so stamps for them gathered
+    // before the build can be discarded (see NodeGraph::OnJobFinalized)
+    m_ExtraOutputFileNames.Clear();
+    if ( GetFlag( LINK_FLAG_MSVC ) || GetFlag( LINK_FLAG_GCC ) )
+    {
+        DetermineExtraOutputFileNames( m_ExtraOutputFileNames );
+    }
+
     // Make sure the implib output directory exists
     if ( m_ImportLibName.IsEmpty() == false )
     {
@@ -1092,6 +1100,62 @@ void LinkerNode::GetImportLibName( const AString & args, AString & importLibName
     }
 }
 
+// DetermineExtraOutputFileNames
+//------------------------------------------------------------------------------
+void LinkerNode::DetermineExtraOutputFileNames( Array<AString> & outFileNames ) const
+{
+    // Files the linker writes in addition to the output, at locations given by the args
+    static const char * const msvcOptions[] = { "IMPLIB:", "PDB:", "PDBSTRIPPED:", "MAP:", "PGD:", "ILK:",
+                                                "IDLOUT:", "TLBOUT:", "WINMDFILE:" };
+    static const char * const gnuOptions[] = { "Map=", "Map", "-Map=", "-Map", "Wl,-Map=", "Wl,-Map,", "Wl,--Map=",
+                                               "-out-implib=", "Wl,--out-implib=", "Wl,--out-implib," };
+
+    const bool msvc = GetFlag( LINK_FLAG_MSVC );
+    const char * const * options = msvc ? msvcOptions : gnuOptions;
+    const size_t numOptions = msvc ? ( sizeof( msvcOptions ) / sizeof( msvcOptions[ 0 ] ) )
+                                   : ( sizeof( gnuOptions ) / sizeof( gnuOptions[ 0 ] ) );
+
+    // split to individual tokens
+    StackArray<AString, 512> tokens;
+    m_LinkerOptions.Tokenize( tokens );
+
+    const AString * const end = tokens.End();
+    for ( const AString * it = tokens.Begin(); it != end; ++it )
+    {
+        for ( size_t i = 0; i < numOptions; ++i )
+        {
+            const bool match = msvc ? IsStartOfLinkerArg_MSVC( *it, options[ i ] )
+                                    : IsStartOfLinkerArg( *it, options[ i ] );
+            if ( match == false )
+            {
+                continue;
+            }
+
+            const char * valueStart = it->Get() + AString::StrLen( options[ i ] ) + 1; // +1 for - or /
+            const char * valueEnd = it->GetEnd();
+
+            // if token is exactly matched then value is next token
+            if ( valueStart == valueEnd )
+            {
+                if ( ( it + 1 ) == end )
+                {
+                    break; // we just pretend it doesn't exist and let the linker complain
+                }
+                ++it;
+                valueStart = it->Get();
+                valueEnd = it->GetEnd();
+            }
+
+            AStackString value;
+            Args::StripQuotes( valueStart, valueEnd, value );
+            value.Replace( "%2", m_Name.Get() ); // Same substitution as when building the args
+
+            NodeGraph::CleanPath( value, outFileNames.EmplaceBack() );
+            break;
+        }
+    }
+}
+
 // GetOtherLibraries
 //------------------------------------------------------------------------------
 /*static*/ bool LinkerNode::GetOtherLibraries( NodeGraph & nodeGraph,
@@ -39,6 +39,8 @@ public:
     };
 
     bool IsADLL() const { return GetFlag( LINK_FLAG_DLL ); }
+    const AString & GetImportLibNameFromArgs() const { return m_ImportLibName; } // Empty if not specified
+    const Array<AString> & GetExtraOutputFileNames() const { return m_ExtraOutputFileNames; } // Noted by the last DoBuild
 
     static uint32_t DetermineLinkerTypeFlags( const AString & linkerType, const AString & linkerName );
     static uint32_t DetermineFlags( const AString & linkerType, const AString & linkerName, const AString & args );
@@ -57,6 +59,7 @@ protected:
     virtual uint8_t GetConcurrencyGroupIndex() const override;
 
     bool DoPreLinkCleanup() const;
+    void DetermineExtraOutputFileNames( Array<AString> & outFileNames ) const;
 
     bool BuildArgs( Args & fullArgs ) const;
     void GetInputFiles( const AString & token, Args & fullArgs ) const;
@@ -123,6 +126,9 @@ protected:
     uint32_t m_AssemblyResourcesNum = 0;
     AString m_ImportLibName;
     mutable const char * m_EnvironmentString = nullptr;
+
+    // Not serialized
+    Array<AString> m_ExtraOutputFileNames; // Side outputs at locations given by the args
 };
 
 //------------------------------------------------------------------------------
@@ -278,6 +278,12 @@ bool Node::DetermineNeedToBuild( const Dependencies & deps ) const
     return BuildResult::eFailed;
 }
 
+// PrepareFinalize
+//------------------------------------------------------------------------------
+/*virtual*/ void Node::PrepareFinalize( NodeGraph & )
+{
+}
+
 // Finalize
 //------------------------------------------------------------------------------
 /*virtual*/ bool Node::Finalize( NodeGraph & )
@@ -353,7 +359,7 @@ void Node::SetLastBuildTime( uint32_t ms )
 }
 
 //------------------------------------------------------------------------------
-/*static*/ void Node::Load( NodeGraph & nodeGraph, ConstMemoryStream & stream )
+/*static*/ Node * Node::Load( ConstMemoryStream & stream )
 {
     // Name of node
     AString name; // Will be moved
@@ -368,9 +374,11 @@ void Node::SetLastBuildTime( uint32_t ms )
     VERIFY( stream.Seek( pos + sizeof( SerializedNodeBasic ) ) );
 
     // Create node
-    VERIFY( nodeGraph.CreateNode( static_cast<Type>( info.m_Type ),
-                                  Move( name ),
-                                  info.m_NameHash ) );
+    Node * node = NodeGraph::AllocateNode( static_cast<Type>( info.m_Type ),
+                                           Move( name ),
+                                           info.m_NameHash );
+    ASSERT( node );
+    return node;
 }
 
 //------------------------------------------------------------------------------
@@ -755,6 +763,7 @@ void Node::SetLastBuildTime( uint32_t ms )
                 uint32_t numNodes;
                 VERIFY( stream.Read( numNodes ) );
                 Array<Node *> & nodes = *property.GetPtrToArray<Node *>( base );
+                nodes.Clear(); // Replaced when re-loaded from the DB journal
                 nodes.SetCapacity( numNodes );
                 for ( uint32_t i = 0; i < numNodes; ++i )
                 {
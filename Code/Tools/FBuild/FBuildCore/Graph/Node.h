@@ -169,7 +169,7 @@ public:
     uint32_t GetProgressAccumulator() const { return m_ProgressAccumulator; }
     void SetProgressAccumulator( uint32_t p ) const { m_ProgressAccumulator = p; }
 
-    static void Load( NodeGraph & nodeGraph, ConstMemoryStream & stream );
+    static Node * Load( ConstMemoryStream & stream ); // Create node (registration with the NodeGraph is left to the caller)
     static void LoadExtended( NodeGraph & nodeGraph, Node * node, ConstMemoryStream & stream );
     static void Save( IOStream & stream, const Node * node );
     static void SaveExtended( IOStream & stream, const Node * node );
@@ -238,6 +238,7 @@ protected:
     virtual bool DoDynamicDependencies( NodeGraph & nodeGraph );
     virtual BuildResult DoBuild( Job * job );
     virtual BuildResult DoBuild2( Job * job, bool racingRemoteJob );
+    virtual void PrepareFinalize( NodeGraph & nodeGraph ); // On the thread completing the job (see JobQueue::FinishedProcessingJob)
     virtual bool Finalize( NodeGraph & nodeGraph );
 
     bool DetermineNeedToBuild( const Dependencies & deps ) const;
@@ -286,19 +287,22 @@ protected:
     uint64_t m_Stamp = 0; // "Stamp" representing this node for dependency comparisons
     uint8_t m_ControlFlags = FLAG_NONE; // Control build behavior special cases - Set by constructor
     bool m_Hidden = false; // Hidden from -showtargets?
-    // Note: Unused 2 bytes here
+    bool m_ChangedSinceSave = false; // Needs saving to the DB journal (built or dynamic deps changed)
+    // Note: Unused 1 byte here
     uint32_t m_RecursiveCost = 0; // Recursive cost used during task ordering
-    Node * m_Next = nullptr; // Node map in-place linked list pointer
     uint32_t m_NameHash; // Hash of mName
     uint32_t m_LastBuildTimeMs = 0; // Time it took to do last known full build of this node
     uint32_t m_ProcessingTime = 0; // Time spent on this node during this build
     uint32_t m_CachingTime = 0; // Time spent caching this node
     mutable uint32_t m_ProgressAccumulator = 0; // Used to estimate build progress percentage
     uint32_t m_SecondaryTag = 0;
+    uint32_t m_PendingDependencies = 0; // Event-driven scheduling: unfinished dependencies being waited on
+    uint32_t m_PendingCost = 0; // Event-driven scheduling: recursive cost to resume with once woken
 
     Dependencies m_PreBuildDependencies;
     Dependencies m_StaticDependencies;
     Dependencies m_DynamicDependencies;
+    Array<Node *> m_WaitingNodes; // Event-driven scheduling: nodes to wake when this node completes
 
     // Static Data
     static uint32_t s_SecondaryTag;
@@ -8,6 +8,7 @@
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/BFF/BFFParser.h"
 #include "Tools/FBuild/FBuildCore/BFF/Functions/FunctionSettings.h"
+#include "Tools/FBuild/FBuildCore/BFF/Tokenizer/BFFTokenCache.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/MetaData/Meta_IgnoreForComparison.h"
@@ -46,10 +47,15 @@
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryMappedFile.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Math/xxHash.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Semaphore.h"
 #include "Core/Process/Thread.h"
+#include "Core/Process/ThreadPool.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Reflection/ReflectedProperty.h"
 #include "Core/Strings/AStackString.h"
@@ -79,18 +85,56 @@ bool NodeGraphHeader::IsValid() const
     return true;
 }
 
+// IsValid (NodeGraphJournalHeader)
+//------------------------------------------------------------------------------
+bool NodeGraphJournalHeader::IsValid() const
+{
+    // Check header token is valid
+    if ( ( m_Identifier[ 0 ] != 'N' ) ||
+         ( m_Identifier[ 1 ] != 'G' ) ||
+         ( m_Identifier[ 2 ] != 'J' ) )
+    {
+        return false;
+    }
+    return true;
+}
+
+// IsValid (NodeGraphFileWatcherHeader)
+//------------------------------------------------------------------------------
+bool NodeGraphFileWatcherHeader::IsValid() const
+{
+    // Check header token is valid
+    if ( ( m_Identifier[ 0 ] != 'N' ) ||
+         ( m_Identifier[ 1 ] != 'G' ) ||
+         ( m_Identifier[ 2 ] != 'W' ) )
+    {
+        return false;
+    }
+    return ( m_Version == NodeGraphHeader::kCurrentVersion );
+}
+
+// IsValid (NodeGraphContentHashHeader)
+//------------------------------------------------------------------------------
+bool NodeGraphContentHashHeader::IsValid() const
+{
+    // Check header token is valid
+    if ( ( m_Identifier[ 0 ] != 'N' ) ||
+         ( m_Identifier[ 1 ] != 'G' ) ||
+         ( m_Identifier[ 2 ] != 'C' ) )
+    {
+        return false;
+    }
+    return ( m_Version == NodeGraphHeader::kCurrentVersion );
+}
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-NodeGraph::NodeGraph( unsigned nodeMapHashBits )
-    : m_NodeMapMaxKey( ( 1u << nodeMapHashBits ) - 1u )
-    , m_Settings( nullptr )
+NodeGraph::NodeGraph( size_t expectedNumNodes )
+    : m_Settings( nullptr )
 {
-    m_AllNodes.SetCapacity( 1024 );
+    m_AllNodes.SetCapacity( Math::Max( expectedNumNodes, (size_t)1024 ) );
     m_UsedFiles.SetCapacity( 16 );
-
-    ASSERT( nodeMapHashBits > 0 && nodeMapHashBits < 32 );
-    m_NodeMap = FNEW_ARRAY( Node * [m_NodeMapMaxKey + 1] );
-    memset( m_NodeMap, 0, sizeof( Node * ) * ( m_NodeMapMaxKey + 1 ) );
+    m_NodeMap.Reserve( expectedNumNodes );
 
 #if defined( ENABLE_FAKE_SYSTEM_FAILURE )
     // Ensure debug flag doesn't linger between test runs
@@ -106,8 +150,11 @@ NodeGraph::~NodeGraph()
     {
         FDELETE( node );
     }
-
-    FDELETE_ARRAY( m_NodeMap );
+    for ( Node * node : m_PendingNodes )
+    {
+        FDELETE( node );
+    }
+    FDELETE( m_TokenCache );
 }
 
 // Initialize
@@ -165,7 +212,7 @@ NodeGraph::~NodeGraph()
             // Create a fresh DB by parsing the BFF
             FDELETE( oldNG );
             NodeGraph * newNG = FNEW( NodeGraph );
-            if ( newNG->ParseFromRoot( bffFile ) == false )
+            if ( newNG->ParseFromRoot( bffFile, nodeGraphDBFile ) == false )
             {
                 FDELETE( newNG );
                 return nullptr; // ParseFromRoot will have emitted an error
@@ -175,8 +222,9 @@ NodeGraph::~NodeGraph()
         case LoadResult::OK_BFF_NEEDS_REPARSING:
         {
             // Create a fresh DB by parsing the modified BFF
-            NodeGraph * newNG = FNEW( NodeGraph );
-            if ( newNG->ParseFromRoot( bffFile ) == false )
+            // (likely to have a similar number of nodes)
+            NodeGraph * newNG = FNEW( NodeGraph( oldNG->GetNodeCount() ) );
+            if ( newNG->ParseFromRoot( bffFile, nodeGraphDBFile ) == false )
             {
                 FDELETE( newNG );
                 FDELETE( oldNG );
@@ -202,15 +250,25 @@ NodeGraph::~NodeGraph()
 
 // ParseFromRoot
 //------------------------------------------------------------------------------
-bool NodeGraph::ParseFromRoot( const char * bffFile )
+bool NodeGraph::ParseFromRoot( const char * bffFile, const char * nodeGraphDBFile )
 {
     ASSERT( m_UsedFiles.IsEmpty() ); // NodeGraph cannot be recycled
 
+    // Files unchanged since the last parse don't need to be tokenized again
+    // (cache is saved along with the DB)
+    AStackString tokenCacheFile;
+    BFFTokenCache::GetCacheFileName( nodeGraphDBFile, tokenCacheFile );
+    m_TokenCache = FNEW( BFFTokenCache );
+    m_TokenCache->Load( tokenCacheFile.Get() );
+
     // re-parse the BFF from scratch, clean build will result
     BFFParser bffParser( *this );
+    bffParser.SetTokenCache( m_TokenCache );
     const bool ok = bffParser.ParseFromFile( bffFile );
     if ( ok )
     {
+        FLOG_VERBOSE( "BFF token cache: %u hits, %u misses", m_TokenCache->GetNumHits(), m_TokenCache->GetNumMisses() );
+
         // Store a pointer to the SettingsNode as defined by the BFF, or create a
         // default instance if needed.
         if ( m_Settings == nullptr )
@@ -243,24 +301,32 @@ bool NodeGraph::ParseFromRoot( const char * bffFile )
 NodeGraph::LoadResult NodeGraph::Load( const char * nodeGraphDBFile )
 {
     // Open previously saved DB
-    FileStream fs;
-    if ( fs.Open( nodeGraphDBFile, FileStream::READ_ONLY ) == false )
+    if ( FileIO::FileExists( nodeGraphDBFile ) == false )
     {
         return LoadResult::MISSING_OR_INCOMPATIBLE;
     }
 
-    // Read it into memory to avoid lots of tiny disk accesses
-    const size_t fileSize = (size_t)fs.GetFileSize();
-    UniquePtr<char, FreeDeletor> memory( (char *)ALLOC( fileSize ) );
-    if ( fs.ReadBuffer( memory.Get(), fileSize ) != fileSize )
+    // Map it into memory to avoid lots of tiny disk accesses and an up-front copy
+    MemoryMappedFile mappedFile;
+    if ( mappedFile.Open( nodeGraphDBFile ) == false )
     {
         FLOG_ERROR( "Could not read Database. Error: %s File: '%s'", LAST_ERROR_STR, nodeGraphDBFile );
         return LoadResult::LOAD_ERROR;
     }
-    ConstMemoryStream ms( memory.Get(), fileSize );
+    ConstMemoryStream ms( mappedFile.GetData(), mappedFile.GetSize() );
+
+    // Map journal of changes made since DB was saved (if there is one)
+    AStackString journalFileName;
+    GetJournalFileName( nodeGraphDBFile, journalFileName );
+    MemoryMappedFile mappedJournal;
+    ConstMemoryStream journal;
+    if ( mappedJournal.Open( journalFileName.Get() ) )
+    {
+        journal.Replace( mappedJournal.GetData(), mappedJournal.GetSize(), false );
+    }
 
     // Load the Old DB
-    const NodeGraph::LoadResult res = Load( ms, nodeGraphDBFile );
+    const NodeGraph::LoadResult res = Load( ms, nodeGraphDBFile, mappedJournal.IsOpen() ? &journal : nullptr );
     if ( res == LoadResult::LOAD_ERROR )
     {
         FLOG_ERROR( "Database corrupt (clean build will occur): '%s'", nodeGraphDBFile );
@@ -270,12 +336,16 @@ NodeGraph::LoadResult NodeGraph::Load( const char * nodeGraphDBFile )
 
 // Load
 //------------------------------------------------------------------------------
-NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char * nodeGraphDBFile )
+NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream,
+                                      const char * nodeGraphDBFile,
+                                      const ConstMemoryStream * journalStream )
 {
     bool compatibleDB;
     bool movedDB;
     Array<UsedFile> usedFiles;
-    if ( ReadHeaderAndUsedFiles( stream, nodeGraphDBFile, usedFiles, compatibleDB, movedDB ) == false )
+    Array<NodeChunk> nodeChunks;
+    uint64_t contentHash = 0;
+    if ( ReadHeaderAndUsedFiles( stream, nodeGraphDBFile, usedFiles, compatibleDB, movedDB, nodeChunks, contentHash ) == false )
     {
         return movedDB ? LoadResult::LOAD_ERROR_MOVED : LoadResult::LOAD_ERROR;
     }
@@ -421,20 +491,53 @@ NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char *
     uint32_t numNodes;
     VERIFY( stream.Read( numNodes ) );
     m_AllNodes.SetCapacity( numNodes );
-    for ( uint32_t i = 0; i < numNodes; ++i )
+    m_NodeMap.Reserve( numNodes );
+    ThreadPool * threadPool = FBuild::Get().GetThreadPool();
+    if ( threadPool && ( nodeChunks.GetSize() > 1 ) )
     {
-        Node::Load( *this, stream ); // Create each node
-        ASSERT( m_AllNodes[ i ] ); // Array is populated as loaded
+        // Large DBs are loaded in chunks, spread over the worker threads
+        LoadNodesParallel( stream, numNodes, nodeChunks, *threadPool );
     }
-    for ( Node * node : m_AllNodes )
+    else
     {
-        // Load extended properties and dependencies
-        // (but not for FileNodes which have none)
-        if ( node->GetType() != Node::FILE_NODE )
+        for ( uint32_t i = 0; i < numNodes; ++i )
         {
-            Node::LoadExtended( *this, node, stream );
+            AddNode( Node::Load( stream ) ); // Create each node
+            ASSERT( m_AllNodes[ i ] ); // Array is populated as loaded
         }
+        for ( Node * node : m_AllNodes )
+        {
+            // Load extended properties and dependencies
+            // (but not for FileNodes which have none)
+            if ( node->GetType() != Node::FILE_NODE )
+            {
+                Node::LoadExtended( *this, node, stream );
+            }
+        }
+    }
+
+    // Apply changes saved to the journal since the DB was saved
+    bool journalOK = true;
+    if ( journalStream )
+    {
+        journalOK = ReplayJournal( *journalStream, contentHash );
+        if ( journalOK == false )
+        {
+            FLOG_WARN( "Database journal is corrupt or out of date. Some changes may be lost." );
+        }
+    }
+
+    // Further changes can be journaled only if the journal is intact
+    if ( journalOK )
+    {
+        m_SavedDBFile = nodeGraphDBFile;
+        NodeGraph::CleanPath( m_SavedDBFile );
+        m_SavedDBContentHash = contentHash;
+        m_SavedDBSize = stream.GetSize();
+        m_SavedJournalSize = journalStream ? journalStream->GetSize() : 0;
+        m_SavedNumNodes = static_cast<uint32_t>( m_AllNodes.GetSize() );
     }
+
     for ( Node * node : m_AllNodes )
     {
         // Dispatch post-load callback
@@ -467,6 +570,157 @@ NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char *
     return LoadResult::OK;
 }
 
+// NodeGraphLoadContext
+//  - State shared between threads loading chunks of nodes
+//------------------------------------------------------------------------------
+class NodeGraphLoadContext
+{
+public:
+    enum class Phase : uint8_t
+    {
+        CREATE_NODES,
+        LOAD_EXTENDED
+    };
+
+    NodeGraphLoadContext( NodeGraph & nodeGraph,
+                          const ConstMemoryStream & stream,
+                          Node ** nodes,
+                          uint32_t numNodes,
+                          uint32_t nodesPerChunk )
+        : m_NodeGraph( nodeGraph )
+        , m_Data( stream.GetData() )
+        , m_DataSize( (size_t)stream.GetSize() )
+        , m_Nodes( nodes )
+        , m_NumNodes( numNodes )
+        , m_NodesPerChunk( nodesPerChunk )
+    {
+    }
+
+    void Process( ThreadPool & threadPool, Phase phase, const Array<uint64_t> & chunkOffsets );
+
+private:
+    static void ThreadFunc( void * userData );
+    void ProcessChunks();
+
+    NodeGraph & m_NodeGraph;
+    const void * m_Data;
+    size_t m_DataSize;
+    Node ** m_Nodes;
+    uint32_t m_NumNodes;
+    uint32_t m_NodesPerChunk;
+    Phase m_Phase = Phase::CREATE_NODES;
+    const Array<uint64_t> * m_ChunkOffsets = nullptr;
+    Atomic<uint32_t> m_NextChunk;
+    Semaphore m_ThreadsDone;
+};
+
+// Process
+//------------------------------------------------------------------------------
+void NodeGraphLoadContext::Process( ThreadPool & threadPool, Phase phase, const Array<uint64_t> & chunkOffsets )
+{
+    m_Phase = phase;
+    m_ChunkOffsets = &chunkOffsets;
+    m_NextChunk.Store( 0 );
+
+    // Main thread participates, so only enough threads for the remainder are needed
+    const uint32_t numChunks = static_cast<uint32_t>( chunkOffsets.GetSize() );
+    const uint32_t numThreads = Math::Min( threadPool.GetNumThreads(), numChunks - 1 );
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        threadPool.EnqueueJob( ThreadFunc, this );
+    }
+    ProcessChunks();
+
+    // Wait for other threads to finish
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        m_ThreadsDone.Wait();
+    }
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraphLoadContext::ThreadFunc( void * userData )
+{
+    NodeGraphLoadContext * context = static_cast<NodeGraphLoadContext *>( userData );
+    context->ProcessChunks();
+    context->m_ThreadsDone.Signal();
+}
+
+// ProcessChunks
+//------------------------------------------------------------------------------
+void NodeGraphLoadContext::ProcessChunks()
+{
+    PROFILE_FUNCTION;
+
+    const uint32_t numChunks = static_cast<uint32_t>( m_ChunkOffsets->GetSize() );
+    for ( ;; )
+    {
+        const uint32_t chunk = ( m_NextChunk.Increment() - 1 );
+        if ( chunk >= numChunks )
+        {
+            return;
+        }
+
+        // Each thread uses an independent view of the DB
+        ConstMemoryStream stream( m_Data, m_DataSize );
+        VERIFY( stream.Seek( ( *m_ChunkOffsets )[ chunk ] ) );
+
+        const uint32_t begin = ( chunk * m_NodesPerChunk );
+        const uint32_t end = Math::Min( begin + m_NodesPerChunk, m_NumNodes );
+        for ( uint32_t i = begin; i < end; ++i )
+        {
+            if ( m_Phase == Phase::CREATE_NODES )
+            {
+                m_Nodes[ i ] = Node::Load( stream );
+            }
+            else if ( m_Nodes[ i ]->GetType() != Node::FILE_NODE )
+            {
+                // Dependencies are resolved by index, so other chunks can be loading concurrently
+                Node::LoadExtended( m_NodeGraph, m_Nodes[ i ], stream );
+            }
+        }
+    }
+}
+
+// LoadNodesParallel
+//------------------------------------------------------------------------------
+void NodeGraph::LoadNodesParallel( ConstMemoryStream & stream,
+                                   uint32_t numNodes,
+                                   const Array<NodeChunk> & nodeChunks,
+                                   ThreadPool & threadPool )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( nodeChunks.GetSize() == ( ( numNodes + kNodesPerLoadChunk - 1 ) / kNodesPerLoadChunk ) );
+
+    Array<uint64_t> basicOffsets;
+    Array<uint64_t> extendedOffsets;
+    basicOffsets.SetCapacity( nodeChunks.GetSize() );
+    extendedOffsets.SetCapacity( nodeChunks.GetSize() );
+    for ( const NodeChunk & chunk : nodeChunks )
+    {
+        basicOffsets.Append( chunk.m_BasicOffset );
+        extendedOffsets.Append( chunk.m_ExtendedOffset );
+    }
+
+    Array<Node *> nodes;
+    nodes.SetSize( numNodes );
+    NodeGraphLoadContext context( *this, stream, nodes.Begin(), numNodes, kNodesPerLoadChunk );
+
+    // Create nodes
+    context.Process( threadPool, NodeGraphLoadContext::Phase::CREATE_NODES, basicOffsets );
+
+    // Register nodes in order (node map is not thread-safe and indices must be preserved)
+    for ( Node * node : nodes )
+    {
+        AddNode( node );
+    }
+
+    // Load extended properties and dependencies
+    context.Process( threadPool, NodeGraphLoadContext::Phase::LOAD_EXTENDED, extendedOffsets );
+}
+
 // Save
 //------------------------------------------------------------------------------
 void NodeGraph::Save( ChainedMemoryStream & stream, const char * nodeGraphDBFile ) const
@@ -527,15 +781,33 @@ void NodeGraph::Save( ChainedMemoryStream & stream, const char * nodeGraphDBFile
     // Write nodes
     const size_t numNodes = m_AllNodes.GetSize();
     stream.Write( (uint32_t)numNodes );
+    Array<NodeChunk> nodeChunks;
+    nodeChunks.SetCapacity( ( numNodes + kNodesPerLoadChunk - 1 ) / kNodesPerLoadChunk );
     uint32_t index = 0;
     for ( const Node * node : m_AllNodes )
     {
+        // Note start of each chunk
+        if ( ( index % kNodesPerLoadChunk ) == 0 )
+        {
+            NodeChunk & chunk = nodeChunks.EmplaceBack();
+            chunk.m_BasicOffset = stream.Tell();
+            chunk.m_ExtendedOffset = 0; // Updated below
+        }
+
         // Save each node
         Node::Save( stream, node );
         node->SetBuildPassTag( index++ ); // Save index for dependency serialization
     }
+    index = 0;
     for ( const Node * node : m_AllNodes )
     {
+        // Note start of each chunk
+        if ( ( index % kNodesPerLoadChunk ) == 0 )
+        {
+            nodeChunks[ index / kNodesPerLoadChunk ].m_ExtendedOffset = stream.Tell();
+        }
+        ++index;
+
         // Save extended properties and dependencies
         // (but not for FileNodes which have none)
         if ( node->GetType() != Node::FILE_NODE )
@@ -544,6 +816,16 @@ void NodeGraph::Save( ChainedMemoryStream & stream, const char * nodeGraphDBFile
         }
     }
 
+    // Write chunk table
+    const uint64_t nodeChunksOffset = stream.Tell();
+    stream.Write( kNodesPerLoadChunk );
+    stream.Write( (uint32_t)nodeChunks.GetSize() );
+    for ( const NodeChunk & chunk : nodeChunks )
+    {
+        stream.Write( chunk.m_BasicOffset );
+        stream.Write( chunk.m_ExtendedOffset );
+    }
+
     // Calculate hash of stream excluding header
     {
         NodeGraphHeader * headerToUpdate = nullptr;
@@ -567,140 +849,783 @@ void NodeGraph::Save( ChainedMemoryStream & stream, const char * nodeGraphDBFile
         }
         const uint64_t hash = accumulator.Finalize64();
 
-        // Update hash in header
+        // Update hash and chunk table location in header
         ASSERT( headerToUpdate ); // Guaranteed to be in first page
         ASSERT( headerToUpdate->GetContentHash() == 0 );
         headerToUpdate->SetContentHash( hash );
+        headerToUpdate->SetNodeChunksOffset( nodeChunksOffset );
     }
 }
 
-// SerializeToText
+// SaveJournal
+//  - Append changes made since the DB was last saved, instead of saving it again
 //------------------------------------------------------------------------------
-void NodeGraph::SerializeToText( const Dependencies & deps, AString & outBuffer ) const
+bool NodeGraph::SaveJournal( const char * nodeGraphDBFile )
 {
-    s_BuildPassTag++;
+    PROFILE_FUNCTION;
 
-    if ( deps.IsEmpty() == false )
+    // Can only extend the DB this graph was loaded from or last saved to
+    if ( m_SavedDBFile.IsEmpty() )
     {
-        for ( const Dependency & dep : deps )
+        return false;
+    }
+    AStackString nodeGraphDBFileClean( nodeGraphDBFile );
+    NodeGraph::CleanPath( nodeGraphDBFileClean );
+    if ( PathUtils::ArePathsEqual( m_SavedDBFile, nodeGraphDBFileClean ) == false )
+    {
+        return false;
+    }
+
+    // Serialize changes
+    ChainedMemoryStream record( 64 * 1024 );
+    SaveJournalRecord( record );
+    const uint32_t recordSize = static_cast<uint32_t>( record.GetFileSize() );
+    if ( recordSize == 0 )
+    {
+        return true; // Nothing changed
+    }
+
+    // Compact journal back into the DB once it grows too large
+    const uint64_t headerSize = ( m_SavedJournalSize == 0 ) ? sizeof( NodeGraphJournalHeader ) : 0;
+    const uint64_t appendSize = ( headerSize + sizeof( uint32_t ) + sizeof( uint64_t ) + recordSize );
+    if ( ( m_SavedJournalSize + appendSize ) > ( m_SavedDBSize / kJournalCompactionRatio ) )
+    {
+        return false;
+    }
+
+    // Hash record so partially written records can be detected
+    xxHash3Accumulator accumulator;
+    for ( uint32_t i = 0; i < record.GetNumPages(); ++i )
+    {
+        uint32_t dataSize = 0;
+        const char * data = record.GetPage( i, dataSize );
+        accumulator.AddDataBig( data, dataSize );
+    }
+    const uint64_t recordHash = accumulator.Finalize64();
+
+    // Open journal, checking it's the one we expect
+    AStackString journalFileName;
+    GetJournalFileName( nodeGraphDBFile, journalFileName );
+    FileIO::FileInfo dbInfo;
+    FileStream fs;
+    if ( ( FileIO::GetFileInfo( nodeGraphDBFileClean, dbInfo ) == false ) ||
+         ( dbInfo.m_Size != m_SavedDBSize ) ||
+         ( fs.Open( journalFileName.Get(), FileStream::OPEN_OR_CREATE_READ_WRITE ) == false ) ||
+         ( fs.GetFileSize() != m_SavedJournalSize ) ||
+         ( fs.Seek( m_SavedJournalSize ) == false ) )
+    {
+        return false; // Modified externally or otherwise inaccessible
+    }
+
+    // Write header for new journal
+    if ( m_SavedJournalSize == 0 )
+    {
+        const NodeGraphJournalHeader header( m_SavedDBContentHash );
+        if ( fs.WriteBuffer( &header, sizeof( header ) ) != sizeof( header ) )
         {
-            SerializeToText( dep.GetNode(), 0, outBuffer );
+            return false;
         }
     }
-    else
+
+    // Append record
+    if ( ( fs.Write( recordSize ) == false ) ||
+         ( fs.Write( recordHash ) == false ) )
     {
-        for ( Node * node : m_AllNodes )
+        return false;
+    }
+    for ( uint32_t i = 0; i < record.GetNumPages(); ++i )
+    {
+        uint32_t dataSize = 0;
+        const char * data = record.GetPage( i, dataSize );
+        if ( fs.WriteBuffer( data, dataSize ) != dataSize )
         {
-            SerializeToText( node, 0, outBuffer );
+            return false;
         }
     }
+
+    // Journal now reflects current state
+    m_SavedJournalSize += appendSize;
+    m_SavedNumNodes = static_cast<uint32_t>( m_AllNodes.GetSize() );
+    for ( Node * node : m_AllNodes )
+    {
+        node->m_ChangedSinceSave = false;
+    }
+    return true;
 }
 
-// SerializeToText
+// SaveJournalRecord
 //------------------------------------------------------------------------------
-/*static*/ void NodeGraph::SerializeToText( Node * node, uint32_t depth, AString & outBuffer )
+void NodeGraph::SaveJournalRecord( ChainedMemoryStream & stream ) const
 {
-    // Print this even if it has been visited before so the edge is visible
-    outBuffer.AppendFormat( "%*s%s %s\n", depth * 4, "", node->GetTypeName(), node->GetName().Get() );
-
-    // Don't descend into already visited nodes
-    if ( node->GetBuildPassTag() == s_BuildPassTag )
+    // Find changes: new nodes and modified existing nodes
+    const uint32_t numNodes = static_cast<uint32_t>( m_AllNodes.GetSize() );
+    ASSERT( numNodes >= m_SavedNumNodes );
+    const uint32_t numNewNodes = ( numNodes - m_SavedNumNodes );
+    uint32_t numChangedNodes = 0;
+    for ( uint32_t i = 0; i < numNodes; ++i )
     {
-        if ( node->GetPreBuildDependencies().GetSize() ||
-             node->GetStaticDependencies().GetSize() ||
-             node->GetDynamicDependencies().GetSize() )
+        const Node * node = m_AllNodes[ i ];
+        node->SetBuildPassTag( i ); // Save index for dependency serialization
+        if ( ( node->GetType() != Node::FILE_NODE ) &&
+             ( node->m_ChangedSinceSave || ( i >= m_SavedNumNodes ) ) )
         {
-            outBuffer.AppendFormat( "%*s...\n", ( depth + 1 ) * 4, "" );
+            ++numChangedNodes;
         }
-        return;
     }
-    node->SetBuildPassTag( s_BuildPassTag );
+    if ( ( numNewNodes == 0 ) && ( numChangedNodes == 0 ) )
+    {
+        return; // Nothing to save
+    }
 
-    // Dependencies
-    SerializeToText( "PreBuild", node->GetPreBuildDependencies(), depth, outBuffer );
-    SerializeToText( "Static", node->GetStaticDependencies(), depth, outBuffer );
-    SerializeToText( "Dynamic", node->GetDynamicDependencies(), depth, outBuffer );
-}
+    // New nodes
+    stream.Write( m_SavedNumNodes );
+    stream.Write( numNewNodes );
+    for ( uint32_t i = m_SavedNumNodes; i < numNodes; ++i )
+    {
+        Node::Save( stream, m_AllNodes[ i ] );
+    }
 
-// SerializeToText
-//------------------------------------------------------------------------------
-/*static*/ void NodeGraph::SerializeToText( const char * title, const Dependencies & dependencies, uint32_t depth, AString & outBuffer )
-{
-    if ( dependencies.IsEmpty() == false )
+    // Extended properties and dependencies of new and modified nodes
+    // (but not for FileNodes which have none)
+    stream.Write( numChangedNodes );
+    for ( uint32_t i = 0; i < numNodes; ++i )
     {
-        outBuffer.AppendFormat( "%*s%s\n", depth * 4 + 2, "", title );
-        for ( const Dependency & dep : dependencies )
+        const Node * node = m_AllNodes[ i ];
+        if ( ( node->GetType() != Node::FILE_NODE ) &&
+             ( node->m_ChangedSinceSave || ( i >= m_SavedNumNodes ) ) )
         {
-            SerializeToText( dep.GetNode(), depth + 1, outBuffer );
+            stream.Write( i );
+            Node::SaveExtended( stream, node );
         }
     }
 }
 
-// SerializeToDotFormat
+// OnSaved
+//  - Record state of a newly saved DB, which further changes can be journaled against
 //------------------------------------------------------------------------------
-void NodeGraph::SerializeToDotFormat( const Dependencies & deps,
-                                      const bool fullGraph,
-                                      AString & outBuffer ) const
+void NodeGraph::OnSaved( const char * nodeGraphDBFile, const ChainedMemoryStream & stream )
 {
-    s_BuildPassTag++; // Used to mark nodes as we sweep to visit each node only once
-
-    // Header of DOT format
-    outBuffer += "digraph G\n";
-    outBuffer += "{\n";
-    outBuffer += "\trankdir=LR\n";
-    outBuffer += "\tnode [shape=record;style=filled]\n";
-
-    if ( deps.IsEmpty() == false )
+    uint32_t dataSize = 0;
+    const NodeGraphHeader * header = reinterpret_cast<const NodeGraphHeader *>( const_cast<ChainedMemoryStream &>( stream ).GetPage( 0, dataSize ) );
+    ASSERT( dataSize >= sizeof( NodeGraphHeader ) );
+
+    m_SavedDBFile = nodeGraphDBFile;
+    NodeGraph::CleanPath( m_SavedDBFile );
+    m_SavedDBContentHash = header->GetContentHash();
+    m_SavedDBSize = stream.GetFileSize();
+    m_SavedJournalSize = 0;
+    m_SavedNumNodes = static_cast<uint32_t>( m_AllNodes.GetSize() );
+    for ( Node * node : m_AllNodes )
     {
-        // Emit subset of graph for specified targets
-        for ( const Dependency & dep : deps )
-        {
-            SerializeToDot( dep.GetNode(), fullGraph, outBuffer );
-        }
+        node->m_ChangedSinceSave = false;
     }
-    else
+
+    // Any previous journal is now obsolete
+    AStackString journalFileName;
+    GetJournalFileName( nodeGraphDBFile, journalFileName );
+    if ( FileIO::FileExists( journalFileName.Get() ) )
     {
-        // Emit entire graph
-        for ( Node * node : m_AllNodes )
-        {
-            SerializeToDot( node, fullGraph, outBuffer );
-        }
+        FileIO::FileDelete( journalFileName.Get() );
     }
+}
 
-    // Footer of DOT format
-    outBuffer += "}\n";
+// GetJournalFileName
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::GetJournalFileName( const char * nodeGraphDBFile, AString & outJournalFileName )
+{
+    outJournalFileName = nodeGraphDBFile;
+    outJournalFileName += ".journal";
 }
 
-// SerializeToDot
+// SyncFileWatcher
 //------------------------------------------------------------------------------
-/*static*/ void NodeGraph::SerializeToDot( Node * node,
-                                           const bool fullGraph,
-                                           AString & outBuffer )
+void NodeGraph::SyncFileWatcher( const char * nodeGraphDBFile )
 {
-    // Early out for nodes we've already visited
-    if ( node->GetBuildPassTag() == s_BuildPassTag )
+    PROFILE_FUNCTION;
+
+    // Wait for the FileWatcher to record all changes made up to now
+    AStackString instanceName;
+    FileWatcher::GetInstanceName( FBuild::Get().GetWorkingDir(), AStackString( nodeGraphDBFile ), instanceName );
+    FileWatcherClient client;
+    if ( client.Sync( instanceName, kFileWatcherTimeoutMS ) == false )
     {
+        FLOG_VERBOSE( "FileWatcher is not running - all input files will be checked" );
         return;
     }
-    node->SetBuildPassTag( s_BuildPassTag ); // Mark as visited
+    m_FileWatcherSynced = true;
+    m_FileWatcherInstanceName = instanceName;
+    m_FileWatcherToken = client.GetToken();
+    m_FileWatcherDirsHash = client.GetWatchedDirsHash();
 
-    // If outputting a reduced graph, prune out any leaf FileNodes.
-    // (i.e. files that exist outside of the build - typically source code files)
-    const bool isLeafFileNode = ( node->GetType() == Node::FILE_NODE );
-    if ( isLeafFileNode && ( fullGraph == false ) )
+    // Stamps saved by the previous build
+    AStackString stateFileName;
+    GetFileWatcherStateFileName( nodeGraphDBFile, stateFileName );
+    FileStream f;
+    if ( f.Open( stateFileName.Get(), FileStream::READ_ONLY ) == false )
     {
-        return; // Strip this node
+        return; // No previous build
+    }
+    NodeGraphFileWatcherHeader header;
+    if ( ( f.ReadBuffer( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( header.IsValid() == false ) )
+    {
+        return;
     }
 
-    // Name of this node
-    AStackString name( node->GetName() );
-    name.Replace( "\\", "\\\\" ); // Escape slashes in this name
-    outBuffer.AppendFormat( "\n\t\"%s\" %s // %s\n",
-                            name.Get(),
-                            isLeafFileNode ? "[style=none]" : "",
-                            node->GetTypeName() );
-
-    // Dependencies
+    // Stamps can only be matched to the nodes of the DB they were saved with
+    if ( ( header.m_DBContentHash == 0 ) || ( header.m_DBContentHash != m_SavedDBContentHash ) )
+    {
+        return;
+    }
+    const uint64_t entriesSize = ( static_cast<uint64_t>( header.m_NumEntries ) * sizeof( NodeGraphFileWatcherHeader::Entry ) );
+    if ( entriesSize != ( f.GetFileSize() - f.Tell() ) )
+    {
+        return; // Truncated or corrupt
+    }
+    Array<NodeGraphFileWatcherHeader::Entry> entries;
+    entries.SetSize( header.m_NumEntries );
+    if ( f.ReadBuffer( entries.Begin(), entriesSize ) != entriesSize )
+    {
+        return;
+    }
+
+    // Changes since the previous build
+    FileWatcherToken previousToken;
+    previousToken.m_Generation = header.m_Generation;
+    previousToken.m_Offset = header.m_Offset;
+    Array<AString> changedFiles;
+    Array<AString> changedDirs;
+    if ( client.GetChangesSince( previousToken, changedFiles, changedDirs ) == false )
+    {
+        FLOG_VERBOSE( "FileWatcher was restarted or overflowed - all input files will be checked" );
+        return;
+    }
+    if ( changedDirs.GetSize() > kFileWatcherMaxDirChanges )
+    {
+        FLOG_VERBOSE( "FileWatcher reported %u changed directories - all input files will be checked", static_cast<uint32_t>( changedDirs.GetSize() ) );
+        return;
+    }
+
+    // Tag files reported as changed
+    const uint32_t changedTag = ++s_BuildPassTag;
+    for ( const AString & changedFile : changedFiles )
+    {
+        Node * node = FindNodeExact( changedFile );
+        if ( node )
+        {
+            node->SetBuildPassTag( changedTag );
+        }
+    }
+
+    // Trust everything else
+    uint32_t numTrusted = 0;
+    for ( const NodeGraphFileWatcherHeader::Entry & entry : entries )
+    {
+        if ( entry.m_NodeIndex >= m_AllNodes.GetSize() )
+        {
+            continue;
+        }
+        Node * node = m_AllNodes[ entry.m_NodeIndex ];
+        if ( ( node->GetType() != Node::FILE_NODE ) ||
+             ( node->GetNameHash() != entry.m_NameHash ) ||
+             ( node->GetBuildPassTag() == changedTag ) )
+        {
+            continue;
+        }
+        bool inChangedDir = false;
+        for ( const AString & changedDir : changedDirs )
+        {
+            if ( node->GetName().BeginsWith( changedDir ) )
+            {
+                inChangedDir = true;
+                break;
+            }
+        }
+        if ( inChangedDir )
+        {
+            continue;
+        }
+        node->CastTo<FileNode>()->SetPrefetchedStamp( entry.m_Stamp );
+        ++numTrusted;
+    }
+    m_FileWatcherStampsPending = true;
+
+    FLOG_VERBOSE( "FileWatcher reported %u changed files and %u changed directories - %u input files unchanged",
+                  static_cast<uint32_t>( changedFiles.GetSize() ),
+                  static_cast<uint32_t>( changedDirs.GetSize() ),
+                  numTrusted );
+}
+
+// SaveFileWatcherState
+//------------------------------------------------------------------------------
+void NodeGraph::SaveFileWatcherState( const char * nodeGraphDBFile ) const
+{
+    PROFILE_FUNCTION;
+
+    // Stamps can only be trusted relative to a point in the FileWatcher's log
+    if ( ( m_FileWatcherSynced == false ) || ( m_SavedDBContentHash == 0 ) )
+    {
+        return;
+    }
+
+    // Stamps of all files checked after the sync, or known to be unchanged since.
+    // Changes made during the build are logged after our token, so will be checked
+    // by the next build.
+    struct DirEntry
+    {
+        uint64_t m_Hash;
+        uint32_t m_NodeIndex;
+        uint32_t m_DirLength;
+        bool operator<( const DirEntry & other ) const { return m_Hash < other.m_Hash; }
+    };
+    Array<NodeGraphFileWatcherHeader::Entry> entries;
+    Array<DirEntry> dirEntries;
+    entries.SetCapacity( m_AllNodes.GetSize() );
+    dirEntries.SetCapacity( m_AllNodes.GetSize() );
+    for ( size_t i = 0; i < m_AllNodes.GetSize(); ++i )
+    {
+        const Node * node = m_AllNodes[ i ];
+        if ( node->GetType() != Node::FILE_NODE )
+        {
+            continue;
+        }
+        const FileNode * fileNode = node->CastTo<FileNode>();
+        uint64_t stamp;
+        if ( fileNode->GetState() == Node::UP_TO_DATE )
+        {
+            stamp = fileNode->GetStamp();
+        }
+        else if ( fileNode->HasPrefetchedStamp() )
+        {
+            stamp = fileNode->GetPrefetchedStamp();
+        }
+        else
+        {
+            continue; // Unknown
+        }
+        const char * lastSlash = fileNode->GetName().FindLast( NATIVE_SLASH );
+        if ( lastSlash == nullptr )
+        {
+            continue; // Not a path, so can't be watched
+        }
+        const uint32_t dirLength = static_cast<uint32_t>( lastSlash - fileNode->GetName().Get() + 1 );
+        entries.Append( NodeGraphFileWatcherHeader::Entry{ static_cast<uint32_t>( i ), fileNode->GetNameHash(), stamp } );
+        dirEntries.Append( DirEntry{ xxHash3::Calc64( fileNode->GetName().Get(), dirLength ), static_cast<uint32_t>( i ), dirLength } );
+    }
+
+    // Tell the FileWatcher about directories it doesn't know about yet. Changes made
+    // before the watch is added are reported when the watch is added.
+    dirEntries.Sort();
+    Array<uint64_t> dirHashes;
+    dirHashes.SetCapacity( dirEntries.GetSize() );
+    Array<AString> dirs;
+    for ( const DirEntry & dirEntry : dirEntries )
+    {
+        if ( dirHashes.IsEmpty() || ( dirHashes.Top() != dirEntry.m_Hash ) )
+        {
+            dirHashes.Append( dirEntry.m_Hash );
+            const char * name = m_AllNodes[ dirEntry.m_NodeIndex ]->GetName().Get();
+            dirs.EmplaceBack( name, name + dirEntry.m_DirLength );
+        }
+    }
+    if ( FileWatcherClient::SetWatchedDirs( m_FileWatcherInstanceName, dirs, m_FileWatcherDirsHash ) == false )
+    {
+        FLOG_WARN( "Failed to update directories watched by FileWatcher" );
+        return;
+    }
+
+    NodeGraphFileWatcherHeader header;
+    header.m_NumEntries = static_cast<uint32_t>( entries.GetSize() );
+    header.m_DBContentHash = m_SavedDBContentHash;
+    header.m_Generation = m_FileWatcherToken.m_Generation;
+    header.m_Offset = m_FileWatcherToken.m_Offset;
+
+    AStackString stateFileName;
+    GetFileWatcherStateFileName( nodeGraphDBFile, stateFileName );
+    FileStream f;
+    const uint64_t entriesSize = ( entries.GetSize() * sizeof( NodeGraphFileWatcherHeader::Entry ) );
+    if ( ( f.Open( stateFileName.Get(), FileStream::WRITE_ONLY ) == false ) ||
+         ( f.WriteBuffer( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( f.WriteBuffer( entries.Begin(), entriesSize ) != entriesSize ) )
+    {
+        FLOG_WARN( "Failed to save FileWatcher state '%s'. Error: %s", stateFileName.Get(), LAST_ERROR_STR );
+        if ( f.IsOpen() )
+        {
+            f.Close();
+        }
+        FileIO::FileDelete( stateFileName.Get() ); // Don't leave partial state
+    }
+}
+
+// GetFileWatcherStateFileName
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::GetFileWatcherStateFileName( const char * nodeGraphDBFile, AString & outFileName )
+{
+    outFileName = nodeGraphDBFile;
+    outFileName += ".filewatcher";
+}
+
+// LoadContentHashes
+//------------------------------------------------------------------------------
+void NodeGraph::LoadContentHashes( const char * nodeGraphDBFile )
+{
+    PROFILE_FUNCTION;
+
+    m_ContentHashesLoaded = true;
+
+    AStackString fileName;
+    GetContentHashesFileName( nodeGraphDBFile, fileName );
+    FileStream f;
+    if ( f.Open( fileName.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return; // No previous build (every input file will be hashed)
+    }
+    NodeGraphContentHashHeader header;
+    if ( ( f.ReadBuffer( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( header.IsValid() == false ) )
+    {
+        return;
+    }
+    const uint64_t entriesSize = ( static_cast<uint64_t>( header.m_NumEntries ) * sizeof( NodeGraphContentHashHeader::Entry ) );
+    if ( entriesSize != ( f.GetFileSize() - f.Tell() ) )
+    {
+        return; // Truncated or corrupt
+    }
+    Array<NodeGraphContentHashHeader::Entry> entries;
+    entries.SetSize( header.m_NumEntries );
+    if ( f.ReadBuffer( entries.Begin(), entriesSize ) != entriesSize )
+    {
+        return;
+    }
+
+    // Entries are matched by name, so remain valid if the BFF is re-parsed
+    uint32_t numFound = 0;
+    for ( Node * node : m_AllNodes )
+    {
+        if ( node->GetType() != Node::FILE_NODE )
+        {
+            continue;
+        }
+        const uint64_t nameHash = xxHash3::Calc64( node->GetName() );
+        size_t low = 0;
+        size_t high = entries.GetSize();
+        while ( low < high )
+        {
+            const size_t mid = ( low + ( ( high - low ) / 2 ) );
+            if ( entries[ mid ].m_NameHash < nameHash )
+            {
+                low = ( mid + 1 );
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        if ( ( low < entries.GetSize() ) && ( entries[ low ].m_NameHash == nameHash ) )
+        {
+            node->CastTo<FileNode>()->SetContentHash( entries[ low ].m_LastWriteTime, entries[ low ].m_ContentHash );
+            ++numFound;
+        }
+    }
+
+    FLOG_VERBOSE( "Loaded content hashes for %u input files", numFound );
+}
+
+// SaveTokenCache
+//------------------------------------------------------------------------------
+void NodeGraph::SaveTokenCache( const char * nodeGraphDBFile )
+{
+    if ( m_TokenCache == nullptr )
+    {
+        return; // BFF was not parsed (or cache already saved)
+    }
+
+    AStackString tokenCacheFile;
+    BFFTokenCache::GetCacheFileName( nodeGraphDBFile, tokenCacheFile );
+    m_TokenCache->Save( tokenCacheFile.Get() );
+
+    // Not needed again for the lifetime of this graph
+    FDELETE( m_TokenCache );
+    m_TokenCache = nullptr;
+}
+
+// SaveContentHashes
+//------------------------------------------------------------------------------
+void NodeGraph::SaveContentHashes( const char * nodeGraphDBFile ) const
+{
+    PROFILE_FUNCTION;
+
+    if ( m_ContentHashesLoaded == false )
+    {
+        return;
+    }
+
+    Array<NodeGraphContentHashHeader::Entry> entries;
+    entries.SetCapacity( m_AllNodes.GetSize() );
+    for ( const Node * node : m_AllNodes )
+    {
+        if ( node->GetType() != Node::FILE_NODE )
+        {
+            continue;
+        }
+        const FileNode * fileNode = node->CastTo<FileNode>();
+        if ( fileNode->GetContentHash() == 0 )
+        {
+            continue; // Never hashed
+        }
+        entries.Append( NodeGraphContentHashHeader::Entry{ xxHash3::Calc64( fileNode->GetName() ),
+                                                           fileNode->GetContentHashLastWriteTime(),
+                                                           fileNode->GetContentHash() } );
+    }
+    entries.Sort();
+
+    NodeGraphContentHashHeader header;
+    header.m_NumEntries = static_cast<uint32_t>( entries.GetSize() );
+
+    AStackString fileName;
+    GetContentHashesFileName( nodeGraphDBFile, fileName );
+    FileStream f;
+    const uint64_t entriesSize = ( entries.GetSize() * sizeof( NodeGraphContentHashHeader::Entry ) );
+    if ( ( f.Open( fileName.Get(), FileStream::WRITE_ONLY ) == false ) ||
+         ( f.WriteBuffer( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( f.WriteBuffer( entries.Begin(), entriesSize ) != entriesSize ) )
+    {
+        FLOG_WARN( "Failed to save content hashes '%s'. Error: %s", fileName.Get(), LAST_ERROR_STR );
+        if ( f.IsOpen() )
+        {
+            f.Close();
+        }
+        FileIO::FileDelete( fileName.Get() ); // Don't leave partial state
+    }
+}
+
+// GetContentHashesFileName
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::GetContentHashesFileName( const char * nodeGraphDBFile, AString & outFileName )
+{
+    outFileName = nodeGraphDBFile;
+    outFileName += ".contenthash";
+}
+
+// ReplayJournal
+//------------------------------------------------------------------------------
+bool NodeGraph::ReplayJournal( const ConstMemoryStream & journalStream, uint64_t dbContentHash )
+{
+    PROFILE_FUNCTION;
+
+    // Check journal belongs to this DB
+    ConstMemoryStream journal( journalStream.GetData(), (size_t)journalStream.GetSize() );
+    NodeGraphJournalHeader header( 0 );
+    if ( ( journal.Read( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( header.IsValid() == false ) ||
+         ( header.IsCompatibleVersion() == false ) ||
+         ( header.GetDBContentHash() != dbContentHash ) )
+    {
+        return false;
+    }
+
+    // Apply each record in order
+    const char * data = static_cast<const char *>( journal.GetData() );
+    while ( journal.Tell() < journal.GetSize() )
+    {
+        uint32_t recordSize = 0;
+        uint64_t recordHash = 0;
+        if ( ( journal.Read( recordSize ) == false ) ||
+             ( journal.Read( recordHash ) == false ) ||
+             ( ( journal.GetSize() - journal.Tell() ) < recordSize ) )
+        {
+            return false; // Truncated
+        }
+        const char * recordData = ( data + journal.Tell() );
+        if ( xxHash3::Calc64Big( recordData, recordSize ) != recordHash )
+        {
+            return false; // Corrupt
+        }
+        ConstMemoryStream record( recordData, recordSize );
+        if ( ReplayJournalRecord( record ) == false )
+        {
+            return false;
+        }
+        VERIFY( journal.Seek( journal.Tell() + recordSize ) );
+    }
+    return true;
+}
+
+// ReplayJournalRecord
+//------------------------------------------------------------------------------
+bool NodeGraph::ReplayJournalRecord( ConstMemoryStream & record )
+{
+    // Records must be applied to the graph state they were saved against
+    uint32_t numNodesBefore = 0;
+    uint32_t numNewNodes = 0;
+    if ( ( record.Read( numNodesBefore ) == false ) ||
+         ( numNodesBefore != m_AllNodes.GetSize() ) ||
+         ( record.Read( numNewNodes ) == false ) )
+    {
+        return false;
+    }
+
+    // Create new nodes
+    m_AllNodes.SetCapacity( numNodesBefore + numNewNodes );
+    for ( uint32_t i = 0; i < numNewNodes; ++i )
+    {
+        AddNode( Node::Load( record ) );
+    }
+
+    // Replace extended properties and dependencies
+    uint32_t numChangedNodes = 0;
+    if ( record.Read( numChangedNodes ) == false )
+    {
+        return false;
+    }
+    for ( uint32_t i = 0; i < numChangedNodes; ++i )
+    {
+        uint32_t index = 0;
+        if ( ( record.Read( index ) == false ) ||
+             ( index >= m_AllNodes.GetSize() ) )
+        {
+            return false;
+        }
+        Node * node = m_AllNodes[ index ];
+        if ( node->GetType() == Node::FILE_NODE )
+        {
+            return false;
+        }
+        node->m_PreBuildDependencies.Clear();
+        node->m_StaticDependencies.Clear();
+        node->m_DynamicDependencies.Clear();
+        Node::LoadExtended( *this, node, record );
+    }
+    return true;
+}
+
+// SerializeToText
+//------------------------------------------------------------------------------
+void NodeGraph::SerializeToText( const Dependencies & deps, AString & outBuffer ) const
+{
+    s_BuildPassTag++;
+
+    if ( deps.IsEmpty() == false )
+    {
+        for ( const Dependency & dep : deps )
+        {
+            SerializeToText( dep.GetNode(), 0, outBuffer );
+        }
+    }
+    else
+    {
+        for ( Node * node : m_AllNodes )
+        {
+            SerializeToText( node, 0, outBuffer );
+        }
+    }
+}
+
+// SerializeToText
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::SerializeToText( Node * node, uint32_t depth, AString & outBuffer )
+{
+    // Print this even if it has been visited before so the edge is visible
+    outBuffer.AppendFormat( "%*s%s %s\n", depth * 4, "", node->GetTypeName(), node->GetName().Get() );
+
+    // Don't descend into already visited nodes
+    if ( node->GetBuildPassTag() == s_BuildPassTag )
+    {
+        if ( node->GetPreBuildDependencies().GetSize() ||
+             node->GetStaticDependencies().GetSize() ||
+             node->GetDynamicDependencies().GetSize() )
+        {
+            outBuffer.AppendFormat( "%*s...\n", ( depth + 1 ) * 4, "" );
+        }
+        return;
+    }
+    node->SetBuildPassTag( s_BuildPassTag );
+
+    // Dependencies
+    SerializeToText( "PreBuild", node->GetPreBuildDependencies(), depth, outBuffer );
+    SerializeToText( "Static", node->GetStaticDependencies(), depth, outBuffer );
+    SerializeToText( "Dynamic", node->GetDynamicDependencies(), depth, outBuffer );
+}
+
+// SerializeToText
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::SerializeToText( const char * title, const Dependencies & dependencies, uint32_t depth, AString & outBuffer )
+{
+    if ( dependencies.IsEmpty() == false )
+    {
+        outBuffer.AppendFormat( "%*s%s\n", depth * 4 + 2, "", title );
+        for ( const Dependency & dep : dependencies )
+        {
+            SerializeToText( dep.GetNode(), depth + 1, outBuffer );
+        }
+    }
+}
+
+// SerializeToDotFormat
+//------------------------------------------------------------------------------
+void NodeGraph::SerializeToDotFormat( const Dependencies & deps,
+                                      const bool fullGraph,
+                                      AString & outBuffer ) const
+{
+    s_BuildPassTag++; // Used to mark nodes as we sweep to visit each node only once
+
+    // Header of DOT format
+    outBuffer += "digraph G\n";
+    outBuffer += "{\n";
+    outBuffer += "\trankdir=LR\n";
+    outBuffer += "\tnode [shape=record;style=filled]\n";
+
+    if ( deps.IsEmpty() == false )
+    {
+        // Emit subset of graph for specified targets
+        for ( const Dependency & dep : deps )
+        {
+            SerializeToDot( dep.GetNode(), fullGraph, outBuffer );
+        }
+    }
+    else
+    {
+        // Emit entire graph
+        for ( Node * node : m_AllNodes )
+        {
+            SerializeToDot( node, fullGraph, outBuffer );
+        }
+    }
+
+    // Footer of DOT format
+    outBuffer += "}\n";
+}
+
+// SerializeToDot
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::SerializeToDot( Node * node,
+                                           const bool fullGraph,
+                                           AString & outBuffer )
+{
+    // Early out for nodes we've already visited
+    if ( node->GetBuildPassTag() == s_BuildPassTag )
+    {
+        return;
+    }
+    node->SetBuildPassTag( s_BuildPassTag ); // Mark as visited
+
+    // If outputting a reduced graph, prune out any leaf FileNodes.
+    // (i.e. files that exist outside of the build - typically source code files)
+    const bool isLeafFileNode = ( node->GetType() == Node::FILE_NODE );
+    if ( isLeafFileNode && ( fullGraph == false ) )
+    {
+        return; // Strip this node
+    }
+
+    // Name of this node
+    AStackString name( node->GetName() );
+    name.Replace( "\\", "\\\\" ); // Escape slashes in this name
+    outBuffer.AppendFormat( "\n\t\"%s\" %s // %s\n",
+                            name.Get(),
+                            isLeafFileNode ? "[style=none]" : "",
+                            node->GetTypeName() );
+
+    // Dependencies
     SerializeToDot( "PreBuild", "[style=dashed]", node, node->GetPreBuildDependencies(), fullGraph, outBuffer );
     SerializeToDot( "Static", nullptr, node, node->GetStaticDependencies(), fullGraph, outBuffer );
     SerializeToDot( "Dynamic", "[color=gray]", node, node->GetDynamicDependencies(), fullGraph, outBuffer );
@@ -862,6 +1787,17 @@ Node * NodeGraph::CreateNode( Node::Type type, AString && name, uint32_t nameHas
 {
     ASSERT( Thread::IsMainThread() );
 
+    Node * node = AllocateNode( type, Move( name ), nameHash );
+
+    // Track new node (or use a FileNode another thread created meanwhile)
+    return AddNode( node );
+}
+
+// AllocateNode
+//  - Create a node without registering it (safe to call from any thread)
+//------------------------------------------------------------------------------
+/*static*/ Node * NodeGraph::AllocateNode( Node::Type type, AString && name, uint32_t nameHash )
+{
     // Ensure provided hash is correct
     ASSERT( nameHash == Node::CalcNameHash( name ) );
 
@@ -906,121 +1842,543 @@ Node * NodeGraph::CreateNode( Node::Type type, AString && name, uint32_t nameHas
     // Names for files must be normalized by the time we get here
     ASSERT( !node->IsAFile() || IsCleanPath( name ) );
 
-    // Store name and track new node
+    // Store name
     node->SetName( Move( name ), nameHash );
-    AddNode( node );
 
-    return node;
+    return node;
+}
+
+// CreateNode
+//------------------------------------------------------------------------------
+Node * NodeGraph::CreateNode( Node::Type type, const AString & name, const BFFToken * sourceToken )
+{
+    // Where possible callers should call the move version to transfer ownership
+    // of strings, but callers don't always have a string to transfer so this
+    // helper can be called in those situations
+    AString nameCopy;
+
+    // TODO:C Eliminate special case handling of FileNode
+    // For historical reasons users of FileNodes don't clean paths so we have to
+    // do it here. Ideally this special case would be eliminated in the future.
+    if ( type == Node::FILE_NODE )
+    {
+        // Clean path
+        AStackString<512> cleanPath;
+        CleanPath( name, cleanPath );
+        nameCopy = cleanPath;
+    }
+    else
+    {
+        nameCopy = name;
+    }
+
+    const uint32_t nameHash = Node::CalcNameHash( nameCopy );
+    Node * node = CreateNode( type, Move( nameCopy ), nameHash );
+
+    RegisterSourceToken( node, sourceToken );
+
+    return node;
+}
+
+// AddNode
+//------------------------------------------------------------------------------
+Node * NodeGraph::AddNode( Node * node )
+{
+    ASSERT( Thread::IsMainThread() );
+
+    ASSERT( node );
+
+    ASSERT( node->GetNameHash() == Node::CalcNameHash( node->GetName() ) );
+
+    // track in NodeMap
+    // node name must be unique, but a job may have discovered the same file
+    // since the caller checked (see FindOrCreateFileNode)
+    Node * existing = m_NodeMap.FindOrInsert( node );
+    if ( existing != node )
+    {
+        ASSERT( ( existing->GetType() == Node::FILE_NODE ) && ( node->GetType() == Node::FILE_NODE ) );
+        FDELETE node;
+        return existing;
+    }
+
+    // add to list
+    m_AllNodes.Append( node );
+    return node;
+}
+
+// FindOrCreateFileNode
+//------------------------------------------------------------------------------
+Node * NodeGraph::FindOrCreateFileNode( const AString & fileName )
+{
+    // try to find node 'as is'
+    Node * node = FindNodeInternal( fileName, 0 );
+    if ( node )
+    {
+        return node;
+    }
+
+    // the expanding to a full path
+    AStackString<1024> fullPath;
+    CleanPath( fileName, fullPath );
+    const uint32_t nameHash = Node::CalcNameHash( fullPath );
+    node = FindNodeInternal( fullPath, nameHash );
+    if ( node )
+    {
+        return node;
+    }
+
+    // Record the stamp before other threads can see the node
+    Node * newNode = AllocateNode( Node::FILE_NODE, AString( fullPath ), nameHash );
+    newNode->DoBuild( nullptr );
+
+    // Another thread may have created it meanwhile
+    node = m_NodeMap.FindOrInsert( newNode );
+    if ( node != newNode )
+    {
+        FDELETE newNode;
+        return node;
+    }
+
+    MutexHolder mh( m_PendingNodesMutex );
+    m_PendingNodes.Append( newNode );
+    return newNode;
+}
+
+// CommitPendingNodes
+//------------------------------------------------------------------------------
+void NodeGraph::CommitPendingNodes()
+{
+    ASSERT( Thread::IsMainThread() );
+
+    MutexHolder mh( m_PendingNodesMutex );
+    for ( Node * node : m_PendingNodes )
+    {
+        m_AllNodes.Append( node );
+    }
+    m_PendingNodes.Clear();
+}
+
+// Build
+//------------------------------------------------------------------------------
+void NodeGraph::DoBuildPass( Node * nodeToBuild )
+{
+    PROFILE_FUNCTION;
+
+    s_BuildPassTag++;
+
+    // Resume nodes woken by completed dependencies since the last pass
+    // (Only populated when using event-driven scheduling)
+    ProcessReadyNodes();
+
+    if ( nodeToBuild->GetType() == Node::PROXY_NODE )
+    {
+        const size_t total = nodeToBuild->GetStaticDependencies().GetSize();
+        size_t failedCount = 0;
+        size_t upToDateCount = 0;
+        for ( const Dependency & dep : nodeToBuild->GetStaticDependencies() )
+        {
+            Node * n = dep.GetNode();
+            if ( ( n->GetState() < Node::BUILDING ) &&
+                 ( n->m_PendingDependencies == 0 ) ) // Waiting nodes will be woken
+            {
+                BuildRecurse( n, 0 );
+            }
+
+            // check result of recursion (which may or may not be complete)
+            if ( n->GetState() == Node::UP_TO_DATE )
+            {
+                upToDateCount++;
+            }
+            else if ( n->GetState() == Node::FAILED )
+            {
+                failedCount++;
+            }
+        }
+
+        // only mark as failed or completed when all children have reached their final state
+        if ( ( upToDateCount + failedCount ) == total )
+        {
+            // finished - mark with overall state
+            nodeToBuild->SetState( failedCount ? Node::FAILED : Node::UP_TO_DATE );
+        }
+    }
+    else
+    {
+        if ( ( nodeToBuild->GetState() < Node::BUILDING ) &&
+             ( nodeToBuild->m_PendingDependencies == 0 ) ) // Waiting nodes will be woken
+        {
+            BuildRecurse( nodeToBuild, 0 );
+        }
+    }
+
+    // Check for cyclic dependencies discoverable only at runtime
+    if ( CheckForCyclicDependencies( nodeToBuild ) )
+    {
+        FBuild::AbortBuild();
+    }
+
+    // Resume nodes woken by dependencies which completed during this pass
+    // (Rather than leaving them until the next pass)
+    ProcessReadyNodes();
+
+    // Make available all the jobs we discovered in this pass
+    ASSERT( m_Settings );
+    JobQueue::Get().FlushJobBatch( *m_Settings );
+}
+
+// FileNodePrefetchContext
+//------------------------------------------------------------------------------
+class FileNodePrefetchContext
+{
+public:
+    explicit FileNodePrefetchContext( const Array<FileNode *> & fileNodes )
+        : m_FileNodes( fileNodes )
+    {
+    }
+
+    void Process( ThreadPool * threadPool );
+
+private:
+    static void ThreadFunc( void * userData );
+    void ProcessBatches();
+
+    // Large enough to amortize the cost of claiming a batch, small enough to balance
+    static const uint32_t kFileNodesPerBatch = 256;
+
+    const Array<FileNode *> & m_FileNodes;
+    Atomic<uint32_t> m_NextBatch;
+    Semaphore m_ThreadsDone;
+};
+
+// Process
+//------------------------------------------------------------------------------
+void FileNodePrefetchContext::Process( ThreadPool * threadPool )
+{
+    m_NextBatch.Store( 0 );
+
+    // Main thread participates, so only enough threads for the remainder are needed
+    const uint32_t numBatches = static_cast<uint32_t>( ( m_FileNodes.GetSize() + kFileNodesPerBatch - 1 ) / kFileNodesPerBatch );
+    const uint32_t numThreads = ( threadPool && ( numBatches > 1 ) ) ? Math::Min( threadPool->GetNumThreads(), numBatches - 1 ) : 0;
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        threadPool->EnqueueJob( ThreadFunc, this );
+    }
+    ProcessBatches();
+
+    // Wait for other threads to finish
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        m_ThreadsDone.Wait();
+    }
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ void FileNodePrefetchContext::ThreadFunc( void * userData )
+{
+    FileNodePrefetchContext * context = static_cast<FileNodePrefetchContext *>( userData );
+    context->ProcessBatches();
+    context->m_ThreadsDone.Signal();
 }
 
-// CreateNode
+// ProcessBatches
 //------------------------------------------------------------------------------
-Node * NodeGraph::CreateNode( Node::Type type, const AString & name, const BFFToken * sourceToken )
+void FileNodePrefetchContext::ProcessBatches()
 {
-    // Where possible callers should call the move version to transfer ownership
-    // of strings, but callers don't always have a string to transfer so this
-    // helper can be called in those situations
-    AString nameCopy;
+    PROFILE_FUNCTION;
 
-    // TODO:C Eliminate special case handling of FileNode
-    // For historical reasons users of FileNodes don't clean paths so we have to
-    // do it here. Ideally this special case would be eliminated in the future.
-    if ( type == Node::FILE_NODE )
+    const uint32_t numFileNodes = static_cast<uint32_t>( m_FileNodes.GetSize() );
+    for ( ;; )
     {
-        // Clean path
-        AStackString<512> cleanPath;
-        CleanPath( name, cleanPath );
-        nameCopy = cleanPath;
+        const uint32_t begin = ( ( m_NextBatch.Increment() - 1 ) * kFileNodesPerBatch );
+        if ( begin >= numFileNodes )
+        {
+            return;
+        }
+
+        // Batches are contiguous in discovery order, which groups files
+        // from the same directory together
+        const uint32_t end = Math::Min( begin + kFileNodesPerBatch, numFileNodes );
+        for ( uint32_t i = begin; i < end; ++i )
+        {
+            m_FileNodes[ i ]->PrefetchStamp();
+        }
     }
-    else
+}
+
+// ComparePrefetchPaths
+//------------------------------------------------------------------------------
+static int32_t ComparePrefetchPaths( const AString & a, const AString & b )
+{
+#if defined( __LINUX__ )
+    return a.Compare( b ); // Case sensitive
+#else
+    return a.CompareI( b ); // Windows & OSX : Case insensitive
+#endif
+}
+
+// FileNodeNameCompare
+//------------------------------------------------------------------------------
+class FileNodeNameCompare
+{
+public:
+    bool operator()( const FileNode * a, const FileNode * b ) const
     {
-        nameCopy = name;
+        return ( ComparePrefetchPaths( a->GetName(), b->GetName() ) < 0 );
     }
+};
 
-    const uint32_t nameHash = Node::CalcNameHash( nameCopy );
-    Node * node = CreateNode( type, Move( nameCopy ), nameHash );
+// PrefetchFileNodeStamps
+//------------------------------------------------------------------------------
+void NodeGraph::PrefetchFileNodeStamps( Node * nodeToBuild, ThreadPool * threadPool )
+{
+    PROFILE_FUNCTION;
 
-    RegisterSourceToken( node, sourceToken );
+    // Every FileNode is always "built", which costs a stat and a Job each. Rather than
+    // pushing a Job per file through the JobQueue, gather stamps for all those we can
+    // already see in bulk. Nodes still complete in the order the build reaches them.
+    const uint32_t passTag = ++s_BuildPassTag;
 
-    return node;
-}
+    Array<FileNode *> fileNodes;
+    Array<FileNode *> trustedFileNodes;
+    uint32_t numTrusted = 0;
+    Array<Node *> stack;
+    stack.Append( nodeToBuild ); // (not tagged, as it may be an unregistered ProxyNode)
+    while ( stack.IsEmpty() == false )
+    {
+        Node * node = stack.Top();
+        stack.Pop();
 
-// AddNode
-//------------------------------------------------------------------------------
-void NodeGraph::AddNode( Node * node )
-{
-    ASSERT( Thread::IsMainThread() );
+        // Nodes from a previous build of a different target need no work
+        if ( node->GetState() != Node::NOT_PROCESSED )
+        {
+            continue;
+        }
 
-    ASSERT( node );
+        if ( node->GetType() == Node::FILE_NODE )
+        {
+            // Unchanged since the previous build according to the FileWatcher?
+            FileNode * fileNode = node->CastTo<FileNode>();
+            if ( m_FileWatcherStampsPending && fileNode->HasPrefetchedStamp() )
+            {
+                ++numTrusted;
+                trustedFileNodes.Append( fileNode );
+                continue;
+            }
+            fileNodes.Append( fileNode );
+            continue;
+        }
 
-    ASSERT( node->GetNameHash() == Node::CalcNameHash( node->GetName() ) );
-    ASSERT( FindNodeInternal( node->GetName(), node->GetNameHash() ) == nullptr ); // node name must be unique
+        // Dynamic dependencies are from the previous build. If they are regenerated
+        // this build, the prefetch was unnecessary but harmless.
+        const Dependencies * depsLists[] = { &node->GetPreBuildDependencies(),
+                                             &node->GetStaticDependencies(),
+                                             &node->GetDynamicDependencies() };
+        for ( const Dependencies * deps : depsLists )
+        {
+            for ( const Dependency & dep : *deps )
+            {
+                Node * depNode = dep.GetNode();
+                if ( depNode->GetBuildPassTag() != passTag )
+                {
+                    depNode->SetBuildPassTag( passTag );
+                    stack.Append( depNode );
+                }
+            }
+        }
+    }
 
-    // track in NodeMap
-    const size_t key = ( node->GetNameHash() & m_NodeMapMaxKey );
-    node->m_Next = m_NodeMap[ key ];
-    m_NodeMap[ key ] = node;
+    FileNodePrefetchContext context( fileNodes );
+    context.Process( threadPool );
+    m_PrefetchedStampsValid = true;
 
-    // add to list
-    m_AllNodes.Append( node );
+    // Keep stamps sorted by name, so those in directories written to by jobs can be found
+    m_PrefetchedFileNodes.Clear();
+    m_PrefetchedFileNodes.SetCapacity( fileNodes.GetSize() + trustedFileNodes.GetSize() );
+    m_PrefetchedFileNodes.Append( fileNodes );
+    m_PrefetchedFileNodes.Append( trustedFileNodes );
+    m_PrefetchedFileNodes.Sort( FileNodeNameCompare() );
+
+    FLOG_VERBOSE( "Prefetched stamps for %u input files", static_cast<uint32_t>( fileNodes.GetSize() ) );
+    if ( m_FileWatcherStampsPending )
+    {
+        // Further builds by this process must check again
+        m_FileWatcherStampsPending = false;
+        FLOG_VERBOSE( "Trusted stamps for %u input files unchanged according to FileWatcher", numTrusted );
+    }
 }
 
-// Build
+// OnJobFinalized
 //------------------------------------------------------------------------------
-void NodeGraph::DoBuildPass( Node * nodeToBuild )
+void NodeGraph::OnJobFinalized( const Node * node )
 {
-    PROFILE_FUNCTION;
-
-    s_BuildPassTag++;
+    if ( m_PrefetchedStampsValid == false )
+    {
+        return; // Nothing left to invalidate
+    }
 
-    if ( nodeToBuild->GetType() == Node::PROXY_NODE )
+    switch ( node->GetType() )
     {
-        const size_t total = nodeToBuild->GetStaticDependencies().GetSize();
-        size_t failedCount = 0;
-        size_t upToDateCount = 0;
-        for ( const Dependency & dep : nodeToBuild->GetStaticDependencies() )
+        // These write nothing, or only the file they represent (which therefore can't
+        // also be a FileNode)
+        case Node::FILE_NODE:
+        case Node::DIRECTORY_LIST_NODE:
+        case Node::ALIAS_NODE:
+        case Node::COPY_FILE_NODE:
+        case Node::TEXT_FILE_NODE:
+        case Node::OBJECT_LIST_NODE:
+        case Node::COPY_DIR_NODE:
+        case Node::COMPILER_NODE:
+        case Node::COMPILER_INFO_NODE:
+        case Node::SETTINGS_NODE:
+        case Node::SLN_NODE:
+        case Node::VCXPROJECT_NODE:
+        case Node::XCODEPROJECT_NODE:
+        case Node::VSPROJEXTERNAL_NODE:
+        case Node::LIST_DEPENDENCIES_NODE:
         {
-            Node * n = dep.GetNode();
-            if ( n->GetState() < Node::BUILDING )
+            return;
+        }
+        // These write additional files (pdbs, analysis results, import libraries etc)
+        // alongside their outputs or where their args specify, so only stamps in
+        // those directories can be stale. Side outputs are noted by the job itself
+        // (on its worker thread), for compilers and linkers whose args are understood.
+        // For others, only the output's directory is assumed to be written to.
+        case Node::OBJECT_NODE:
+        {
+            const ObjectNode * objectNode = node->CastTo<ObjectNode>();
+            if ( objectNode->AreExtraOutputFileNamesKnown() == false )
             {
-                BuildRecurse( n, 0 );
+                InvalidateAllPrefetchedStamps();
+                return;
             }
-
-            // check result of recursion (which may or may not be complete)
-            if ( n->GetState() == Node::UP_TO_DATE )
+            InvalidatePrefetchedStamps( objectNode->GetName() );
+            if ( objectNode->GetPCHObjectName().IsEmpty() == false )
             {
-                upToDateCount++;
+                InvalidatePrefetchedStamps( objectNode->GetPCHObjectName() );
             }
-            else if ( n->GetState() == Node::FAILED )
+            for ( const AString & extraFileName : objectNode->GetExtraOutputFileNames() )
             {
-                failedCount++;
+                InvalidatePrefetchedStamps( extraFileName );
+            }
+            return;
+        }
+        case Node::LIBRARY_NODE:
+        case Node::CS_NODE:
+        {
+            InvalidatePrefetchedStamps( node->GetName() );
+            return;
+        }
+        case Node::EXE_NODE:
+        case Node::DLL_NODE:
+        {
+            const LinkerNode * linkerNode = ( node->GetType() == Node::EXE_NODE )
+                                          ? static_cast<const LinkerNode *>( node->CastTo<ExeNode>() )
+                                          : static_cast<const LinkerNode *>( node->CastTo<DLLNode>() );
+            InvalidatePrefetchedStamps( linkerNode->GetName() );
+            if ( linkerNode->GetImportLibNameFromArgs().IsEmpty() == false )
+            {
+                AStackString importLibName;
+                CleanPath( linkerNode->GetImportLibNameFromArgs(), importLibName );
+                InvalidatePrefetchedStamps( importLibName );
+            }
+            for ( const AString & extraFileName : linkerNode->GetExtraOutputFileNames() )
+            {
+                InvalidatePrefetchedStamps( extraFileName );
+            }
+            return;
+        }
+        case Node::UNITY_NODE:
+        {
+            // Unity files (and stale ones which are removed) are all in the output path
+            const Array<AString> & unityFileNames = node->CastTo<UnityNode>()->GetUnityFileNames();
+            if ( unityFileNames.IsEmpty() == false )
+            {
+                InvalidatePrefetchedStamps( unityFileNames[ 0 ] );
             }
+            return;
         }
+        default:
+        {
+            // Others (e.g. Exec or Test) can run arbitrary commands writing files which
+            // are inputs for other nodes, so no stamps gathered before the build can
+            // be trusted any more
+            InvalidateAllPrefetchedStamps();
+            return;
+        }
+    }
+}
 
-        // only mark as failed or completed when all children have reached their final state
-        if ( ( upToDateCount + failedCount ) == total )
+// InvalidateAllPrefetchedStamps
+//------------------------------------------------------------------------------
+void NodeGraph::InvalidateAllPrefetchedStamps()
+{
+    m_PrefetchedStampsValid = false;
+    m_PrefetchedFileNodes.Clear();
+}
+
+// InvalidatePrefetchedStamps
+//------------------------------------------------------------------------------
+void NodeGraph::InvalidatePrefetchedStamps( const AString & outputFileName )
+{
+    // Everything in the directory of the output (and below) could have been written
+    const char * lastSlash = outputFileName.FindLast( NATIVE_SLASH );
+    if ( lastSlash == nullptr )
+    {
+        return;
+    }
+    const AStackString dir( outputFileName.Get(), lastSlash + 1 );
+
+    // Find the first stamp at or after the directory (names within it are contiguous)
+    size_t begin = 0;
+    size_t end = m_PrefetchedFileNodes.GetSize();
+    while ( begin < end )
+    {
+        const size_t mid = begin + ( ( end - begin ) / 2 );
+        if ( ComparePrefetchPaths( m_PrefetchedFileNodes[ mid ]->GetName(), dir ) < 0 )
         {
-            // finished - mark with overall state
-            nodeToBuild->SetState( failedCount ? Node::FAILED : Node::UP_TO_DATE );
+            begin = mid + 1;
+        }
+        else
+        {
+            end = mid;
         }
     }
-    else
+    for ( size_t i = begin; i < m_PrefetchedFileNodes.GetSize(); ++i )
     {
-        if ( nodeToBuild->GetState() < Node::BUILDING )
+        FileNode * fileNode = m_PrefetchedFileNodes[ i ];
+        if ( PathUtils::PathBeginsWith( fileNode->GetName(), dir ) == false )
         {
-            BuildRecurse( nodeToBuild, 0 );
+            break;
         }
+        fileNode->ClearPrefetchedStamp(); // Will be built as a Job
     }
+}
 
-    // Check for cyclic dependencies discoverable only at runtime
-    if ( CheckForCyclicDependencies( nodeToBuild ) )
+// CompleteFileNodeFromPrefetchedStamp
+//------------------------------------------------------------------------------
+bool NodeGraph::CompleteFileNodeFromPrefetchedStamp( Node * node )
+{
+    ASSERT( node->GetType() == Node::FILE_NODE );
+    ASSERT( node->GetState() == Node::NOT_PROCESSED );
+
+    FileNode * fileNode = node->CastTo<FileNode>();
+    if ( ( m_PrefetchedStampsValid == false ) || ( fileNode->HasPrefetchedStamp() == false ) )
     {
-        FBuild::AbortBuild();
+        return false; // Will be built as a Job
     }
 
-    // Make available all the jobs we discovered in this pass
-    ASSERT( m_Settings );
-    JobQueue::Get().FlushJobBatch( *m_Settings );
+    // Complete immediately, as if built
+    if ( fileNode->GetStamp() == 0 )
+    {
+        fileNode->SetStatFlag( Node::STATS_FIRST_BUILD );
+    }
+    fileNode->UsePrefetchedStamp();
+    fileNode->SetStatFlag( Node::STATS_PROCESSED );
+    fileNode->SetStatFlag( Node::STATS_BUILT );
+    fileNode->SetState( Node::UP_TO_DATE );
+    NodeCompleted( fileNode );
+    return true;
 }
 
 // BuildRecurse
@@ -1029,6 +2387,14 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
 {
     ASSERT( nodeToBuild );
 
+    // Input files which were stamped in bulk need no Job
+    if ( ( nodeToBuild->GetType() == Node::FILE_NODE ) &&
+         ( nodeToBuild->GetState() == Node::NOT_PROCESSED ) &&
+         CompleteFileNodeFromPrefetchedStamp( nodeToBuild ) )
+    {
+        return;
+    }
+
     // accumulate recursive cost
     cost += nodeToBuild->GetLastBuildTime();
 
@@ -1073,12 +2439,14 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
                     nodeToBuild->SetStatFlag( Node::STATS_FIRST_BUILD );
                 }
                 nodeToBuild->m_Stamp = 0;
+                nodeToBuild->m_ChangedSinceSave = true;
 
                 // Regenerate dynamic dependencies
                 nodeToBuild->m_DynamicDependencies.Clear();
                 if ( nodeToBuild->DoDynamicDependencies( *this ) == false )
                 {
                     nodeToBuild->SetState( Node::FAILED );
+                    NodeCompleted( nodeToBuild );
                     return;
                 }
 
@@ -1115,6 +2483,7 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
                     FLOG_BUILD_REASON( "Up-To-Date '%s'\n", nodeToBuild->GetName().Get() );
                 }
                 nodeToBuild->SetState( Node::UP_TO_DATE );
+                NodeCompleted( nodeToBuild );
             }
             break;
         }
@@ -1145,6 +2514,7 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
     uint32_t numberNodesUpToDate = 0;
     uint32_t numberNodesFailed = 0;
     const bool stopOnFirstError = FBuild::Get().GetOptions().m_StopOnFirstError;
+    const bool eventDriven = ( FBuild::Get().GetOptions().m_UseSweepScheduler == false );
 
     for ( const Dependency & dep : dependencies )
     {
@@ -1155,8 +2525,9 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
         // recurse into nodes which have not been processed yet
         if ( state < Node::BUILDING )
         {
-            // early out if already seen
-            if ( n->GetBuildPassTag() != passTag )
+            // early out if already seen, or if waiting to be woken
+            if ( ( n->GetBuildPassTag() != passTag ) &&
+                 ( n->m_PendingDependencies == 0 ) )
             {
                 // prevent multiple recursions in this pass
                 n->SetBuildPassTag( passTag );
@@ -1192,9 +2563,21 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
             {
                 // propagate failure state to this node
                 nodeToBuild->SetState( Node::FAILED );
+                NodeCompleted( nodeToBuild );
                 break;
             }
         }
+        else if ( eventDriven &&
+                  ( ( state == Node::BUILDING ) || ( n->m_PendingDependencies > 0 ) ) )
+        {
+            // Rather than re-checking this dependency on every sweep, wait
+            // to be woken when it completes
+            // (A dependency skipped due to a stale pass tag is neither, and will
+            // be visited on the next sweep instead)
+            n->m_WaitingNodes.Append( nodeToBuild );
+            ++nodeToBuild->m_PendingDependencies;
+            nodeToBuild->m_PendingCost = ( cost - nodeToBuild->GetLastBuildTime() );
+        }
 
         // keep trying to progress other nodes...
     }
@@ -1206,6 +2589,7 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
             if ( numberNodesFailed > 0 )
             {
                 nodeToBuild->SetState( Node::FAILED );
+                NodeCompleted( nodeToBuild );
             }
         }
     }
@@ -1213,6 +2597,81 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
     return allDependenciesUpToDate;
 }
 
+// ProcessReadyNodes
+//------------------------------------------------------------------------------
+void NodeGraph::ProcessReadyNodes()
+{
+    // Nodes can be woken while processing others, so the list can grow
+    for ( size_t i = 0; i < m_ReadyNodes.GetSize(); ++i )
+    {
+        Node * node = m_ReadyNodes[ i ];
+
+        // Node may have been progressed through another dependent already
+        if ( ( node->GetState() >= Node::BUILDING ) ||
+             ( node->m_PendingDependencies > 0 ) )
+        {
+            continue;
+        }
+
+        // prevent recursion back into this node in this pass
+        node->SetBuildPassTag( s_BuildPassTag );
+
+        BuildRecurse( node, node->m_PendingCost );
+    }
+    m_ReadyNodes.Clear();
+}
+
+// NodeCompleted
+//------------------------------------------------------------------------------
+void NodeGraph::NodeCompleted( Node * node )
+{
+    ASSERT( ( node->GetState() == Node::UP_TO_DATE ) || ( node->GetState() == Node::FAILED ) );
+
+    // Wake any nodes which are no longer waiting on any dependencies
+    for ( Node * waitingNode : node->m_WaitingNodes )
+    {
+        ASSERT( waitingNode->m_PendingDependencies > 0 );
+        if ( --waitingNode->m_PendingDependencies == 0 )
+        {
+            m_ReadyNodes.Append( waitingNode );
+        }
+    }
+    node->m_WaitingNodes.Clear();
+}
+
+// DispatchReadyNodes
+//------------------------------------------------------------------------------
+void NodeGraph::DispatchReadyNodes()
+{
+    if ( m_ReadyNodes.IsEmpty() )
+    {
+        return;
+    }
+
+    // Nodes resumed here are visited as part of a pass of their own
+    s_BuildPassTag++;
+
+    ProcessReadyNodes();
+
+    // Make available any jobs for the resumed nodes straight away
+    ASSERT( m_Settings );
+    JobQueue::Get().FlushJobBatch( *m_Settings );
+}
+
+// ClearPendingDependencies
+//------------------------------------------------------------------------------
+void NodeGraph::ClearPendingDependencies()
+{
+    // An interrupted build can leave nodes waiting on each other, so
+    // reset everything to allow subsequent builds in the same process
+    for ( Node * node : m_AllNodes )
+    {
+        node->m_PendingDependencies = 0;
+        node->m_WaitingNodes.Clear();
+    }
+    m_ReadyNodes.Clear();
+}
+
 //------------------------------------------------------------------------------
 void NodeGraph::SetBuildPassTagForAllNodes( uint32_t value ) const
 {
@@ -1410,25 +2869,10 @@ const BFFToken * NodeGraph::FindNodeSourceToken( const Node * node ) const
 //------------------------------------------------------------------------------
 Node * NodeGraph::FindNodeInternal( const AString & name, uint32_t nameHashHint ) const
 {
-    ASSERT( Thread::IsMainThread() );
     ASSERT( ( nameHashHint == 0 ) || ( nameHashHint == Node::CalcNameHash( name ) ) );
 
     const uint32_t hash = nameHashHint ? nameHashHint : Node::CalcNameHash( name );
-    const size_t key = ( hash & m_NodeMapMaxKey );
-
-    Node * n = m_NodeMap[ key ];
-    while ( n )
-    {
-        if ( n->GetNameHash() == hash )
-        {
-            if ( n->GetName().EqualsI( name ) )
-            {
-                return n;
-            }
-        }
-        n = n->m_Next;
-    }
-    return nullptr;
+    return m_NodeMap.Find( name, hash );
 }
 
 // FindNearestNodesInternal
@@ -1446,74 +2890,71 @@ void NodeGraph::FindNearestNodesInternal( const AString & fullPath, Array<NodeWi
 
     uint32_t worstMinDistance = fullPath.GetLength() + 1;
 
-    for ( size_t i = 0; i <= m_NodeMapMaxKey; i++ )
+    for ( Node * node : m_AllNodes )
     {
-        for ( Node * node = m_NodeMap[ i ]; nullptr != node; node = node->m_Next )
-        {
-            const uint32_t d = LevenshteinDistance::DistanceI( fullPath, node->GetName() );
+        const uint32_t d = LevenshteinDistance::DistanceI( fullPath, node->GetName() );
 
-            if ( d > maxDistance )
-            {
-                continue;
-            }
+        if ( d > maxDistance )
+        {
+            continue;
+        }
 
-            // skips nodes which don't share any character with fullpath
-            if ( fullPath.GetLength() < node->GetName().GetLength() )
+        // skips nodes which don't share any character with fullpath
+        if ( fullPath.GetLength() < node->GetName().GetLength() )
+        {
+            if ( d > node->GetName().GetLength() - fullPath.GetLength() )
             {
-                if ( d > node->GetName().GetLength() - fullPath.GetLength() )
-                {
-                    continue; // completely different <=> d deletions
-                }
+                continue; // completely different <=> d deletions
             }
-            else
+        }
+        else
+        {
+            if ( d > fullPath.GetLength() - node->GetName().GetLength() )
             {
-                if ( d > fullPath.GetLength() - node->GetName().GetLength() )
-                {
-                    continue; // completely different <=> d deletions
-                }
+                continue; // completely different <=> d deletions
             }
+        }
 
-            if ( nodes.IsEmpty() )
+        if ( nodes.IsEmpty() )
+        {
+            nodes.EmplaceBack( node, d );
+            worstMinDistance = nodes.Top().m_Distance;
+        }
+        else if ( d >= worstMinDistance )
+        {
+            ASSERT( nodes.IsEmpty() || nodes.Top().m_Distance == worstMinDistance );
+            if ( false == nodes.IsAtCapacity() )
             {
                 nodes.EmplaceBack( node, d );
-                worstMinDistance = nodes.Top().m_Distance;
+                worstMinDistance = d;
             }
-            else if ( d >= worstMinDistance )
+        }
+        else
+        {
+            ASSERT( nodes.Top().m_Distance > d );
+            const size_t count = nodes.GetSize();
+
+            if ( false == nodes.IsAtCapacity() )
             {
-                ASSERT( nodes.IsEmpty() || nodes.Top().m_Distance == worstMinDistance );
-                if ( false == nodes.IsAtCapacity() )
-                {
-                    nodes.EmplaceBack( node, d );
-                    worstMinDistance = d;
-                }
+                nodes.EmplaceBack();
             }
-            else
-            {
-                ASSERT( nodes.Top().m_Distance > d );
-                const size_t count = nodes.GetSize();
 
-                if ( false == nodes.IsAtCapacity() )
+            size_t pos = count;
+            for ( ; pos > 0; pos-- )
+            {
+                if ( nodes[ pos - 1 ].m_Distance <= d )
                 {
-                    nodes.EmplaceBack();
+                    break;
                 }
-
-                size_t pos = count;
-                for ( ; pos > 0; pos-- )
+                else if ( pos < nodes.GetSize() )
                 {
-                    if ( nodes[ pos - 1 ].m_Distance <= d )
-                    {
-                        break;
-                    }
-                    else if ( pos < nodes.GetSize() )
-                    {
-                        nodes[ pos ] = nodes[ pos - 1 ];
-                    }
+                    nodes[ pos ] = nodes[ pos - 1 ];
                 }
-
-                ASSERT( pos < count );
-                nodes[ pos ] = NodeWithDistance( node, d );
-                worstMinDistance = nodes.Top().m_Distance;
             }
+
+            ASSERT( pos < count );
+            nodes[ pos ] = NodeWithDistance( node, d );
+            worstMinDistance = nodes.Top().m_Distance;
         }
     }
 }
@@ -1712,7 +3153,13 @@ void NodeGraph::FindNearestNodesInternal( const AString & fullPath, Array<NodeWi
 
 // ReadHeaderAndUsedFiles
 //------------------------------------------------------------------------------
-bool NodeGraph::ReadHeaderAndUsedFiles( ConstMemoryStream & nodeGraphStream, const char * nodeGraphDBFile, Array<UsedFile> & files, bool & compatibleDB, bool & movedDB ) const
+bool NodeGraph::ReadHeaderAndUsedFiles( ConstMemoryStream & nodeGraphStream,
+                                        const char * nodeGraphDBFile,
+                                        Array<UsedFile> & files,
+                                        bool & compatibleDB,
+                                        bool & movedDB,
+                                        Array<NodeChunk> & outNodeChunks,
+                                        uint64_t & outContentHash ) const
 {
     // Assume good DB by default (cases below will change flags if needed)
     compatibleDB = true;
@@ -1744,6 +3191,36 @@ bool NodeGraph::ReadHeaderAndUsedFiles( ConstMemoryStream & nodeGraphStream, con
         {
             return false; // DB is corrupt
         }
+        outContentHash = hash;
+    }
+
+    // Read chunk table from end of stream
+    {
+        const uint64_t tell = nodeGraphStream.Tell();
+        const uint64_t nodeChunksOffset = ngh.GetNodeChunksOffset();
+        uint32_t nodesPerChunk = 0;
+        uint32_t numChunks = 0;
+        if ( ( nodeChunksOffset < tell ) ||
+             ( nodeGraphStream.Seek( nodeChunksOffset ) == false ) ||
+             ( nodeGraphStream.Read( nodesPerChunk ) == false ) ||
+             ( nodeGraphStream.Read( numChunks ) == false ) ||
+             ( nodesPerChunk != kNodesPerLoadChunk ) ||
+             ( ( nodeGraphStream.GetSize() - nodeGraphStream.Tell() ) != ( numChunks * sizeof( NodeChunk ) ) ) )
+        {
+            return false; // DB is corrupt
+        }
+        outNodeChunks.SetSize( numChunks );
+        for ( NodeChunk & chunk : outNodeChunks )
+        {
+            VERIFY( nodeGraphStream.Read( chunk.m_BasicOffset ) ); // Size validated above
+            VERIFY( nodeGraphStream.Read( chunk.m_ExtendedOffset ) );
+            if ( ( chunk.m_BasicOffset < tell ) || ( chunk.m_BasicOffset >= nodeChunksOffset ) ||
+                 ( chunk.m_ExtendedOffset < tell ) || ( chunk.m_ExtendedOffset > nodeChunksOffset ) )
+            {
+                return false; // DB is corrupt
+            }
+        }
+        VERIFY( nodeGraphStream.Seek( tell ) );
     }
 
     // Read location where .fdb was originally saved
@@ -7,11 +7,14 @@
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/BFF/BFFFileExists.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeMap.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FileWatcher.h"
 #include "Tools/FBuild/FBuildCore/Helpers/SLNGenerator.h"
 #include "Tools/FBuild/FBuildCore/Helpers/VSProjectGenerator.h"
 
 // Core
 #include "Core/Containers/Array.h"
+#include "Core/Process/Mutex.h"
 #include "Core/Strings/AString.h"
 #include "Core/Time/Timer.h"
 
@@ -19,6 +22,7 @@
 //------------------------------------------------------------------------------
 class AliasNode;
 class AString;
+class BFFTokenCache;
 class ChainedMemoryStream;
 class CompilerNode;
 class ConstMemoryStream;
@@ -44,6 +48,7 @@ class RemoveDirNode;
 class SettingsNode;
 class SLNNode;
 class TestNode;
+class ThreadPool;
 class TextFileNode;
 class UnityNode;
 class VCXProjectNode;
@@ -63,10 +68,11 @@ public:
         m_Version = kCurrentVersion;
         m_Padding = 0;
         m_ContentHash = 0;
+        m_NodeChunksOffset = 0;
     }
     ~NodeGraphHeader() = default;
 
-    inline static const uint8_t kCurrentVersion = 194;
+    inline static const uint8_t kCurrentVersion = 197;
 
     bool IsValid() const;
     bool IsCompatibleVersion() const { return m_Version == kCurrentVersion; }
@@ -74,11 +80,113 @@ public:
     uint64_t GetContentHash() const { return m_ContentHash; }
     void SetContentHash( uint64_t hash ) { m_ContentHash = hash; }
 
+    uint64_t GetNodeChunksOffset() const { return m_NodeChunksOffset; }
+    void SetNodeChunksOffset( uint64_t offset ) { m_NodeChunksOffset = offset; }
+
 private:
     char m_Identifier[ 3 ];
     uint8_t m_Version;
     uint32_t m_Padding; // Unused
     uint64_t m_ContentHash; // Hash of data excluding this header
+    uint64_t m_NodeChunksOffset; // Offset of table of node chunk offsets (for parallel loading)
+};
+
+// NodeGraphJournalHeader
+//  - Header for journal of changes appended to a DB after it was saved
+//------------------------------------------------------------------------------
+class NodeGraphJournalHeader
+{
+public:
+    explicit NodeGraphJournalHeader( uint64_t dbContentHash )
+    {
+        m_Identifier[ 0 ] = 'N';
+        m_Identifier[ 1 ] = 'G';
+        m_Identifier[ 2 ] = 'J';
+        m_Version = NodeGraphHeader::kCurrentVersion;
+        m_Padding = 0;
+        m_DBContentHash = dbContentHash;
+    }
+    ~NodeGraphJournalHeader() = default;
+
+    bool IsValid() const;
+    bool IsCompatibleVersion() const { return m_Version == NodeGraphHeader::kCurrentVersion; }
+
+    uint64_t GetDBContentHash() const { return m_DBContentHash; }
+
+private:
+    char m_Identifier[ 3 ];
+    uint8_t m_Version;
+    uint32_t m_Padding; // Unused
+    uint64_t m_DBContentHash; // Content hash of the DB this journal extends
+};
+
+// NodeGraphFileWatcherHeader
+//  - Header for input file stamps saved alongside a DB, trusted by the next
+//    build unless reported as changed by the FileWatcher
+//------------------------------------------------------------------------------
+class NodeGraphFileWatcherHeader
+{
+public:
+    NodeGraphFileWatcherHeader()
+    {
+        m_Identifier[ 0 ] = 'N';
+        m_Identifier[ 1 ] = 'G';
+        m_Identifier[ 2 ] = 'W';
+        m_Version = NodeGraphHeader::kCurrentVersion;
+        m_NumEntries = 0;
+        m_DBContentHash = 0;
+        m_Generation = 0;
+        m_Offset = 0;
+    }
+    ~NodeGraphFileWatcherHeader() = default;
+
+    bool IsValid() const;
+
+    struct Entry
+    {
+        uint32_t m_NodeIndex;
+        uint32_t m_NameHash; // Guards against nodes having been re-ordered
+        uint64_t m_Stamp;
+    };
+
+    char m_Identifier[ 3 ];
+    uint8_t m_Version;
+    uint32_t m_NumEntries; // Entries follow the header
+    uint64_t m_DBContentHash; // Content hash of the DB the node indices refer to
+    uint64_t m_Generation; // FileWatcherToken at the start of the build which saved the stamps
+    uint64_t m_Offset;
+};
+
+// NodeGraphContentHashHeader
+//  - Header for content hashes of input files saved alongside a DB, so files
+//    need only be re-hashed when modified (see -contenthash)
+//------------------------------------------------------------------------------
+class NodeGraphContentHashHeader
+{
+public:
+    NodeGraphContentHashHeader()
+    {
+        m_Identifier[ 0 ] = 'N';
+        m_Identifier[ 1 ] = 'G';
+        m_Identifier[ 2 ] = 'C';
+        m_Version = NodeGraphHeader::kCurrentVersion;
+        m_NumEntries = 0;
+    }
+    ~NodeGraphContentHashHeader() = default;
+
+    bool IsValid() const;
+
+    struct Entry
+    {
+        uint64_t m_NameHash; // Entries are sorted by this
+        uint64_t m_LastWriteTime;
+        uint64_t m_ContentHash;
+        bool operator<( const Entry & other ) const { return m_NameHash < other.m_NameHash; }
+    };
+
+    char m_Identifier[ 3 ];
+    uint8_t m_Version;
+    uint32_t m_NumEntries; // Entries follow the header
 };
 
 // NodeGraph
@@ -86,7 +194,7 @@ private:
 class NodeGraph
 {
 public:
-    explicit NodeGraph( unsigned nodeMapHashBits = 16 );
+    explicit NodeGraph( size_t expectedNumNodes = 0 );
     ~NodeGraph();
 
     static NodeGraph * Initialize( const char * bffFile, const char * nodeGraphDBFile, bool forceMigration );
@@ -101,8 +209,15 @@ public:
     };
     NodeGraph::LoadResult Load( const char * nodeGraphDBFile );
 
-    LoadResult Load( ConstMemoryStream & stream, const char * nodeGraphDBFile );
+    LoadResult Load( ConstMemoryStream & stream,
+                     const char * nodeGraphDBFile,
+                     const ConstMemoryStream * journalStream = nullptr );
     void Save( ChainedMemoryStream & stream, const char * nodeGraphDBFile ) const;
+
+    // Incremental saving: append changes since the last save to a journal
+    bool SaveJournal( const char * nodeGraphDBFile );
+    void OnSaved( const char * nodeGraphDBFile, const ChainedMemoryStream & stream );
+    static void GetJournalFileName( const char * nodeGraphDBFile, AString & outJournalFileName );
     void SerializeToText( const Dependencies & dependencies, AString & outBuffer ) const;
     void SerializeToDotFormat( const Dependencies & deps, const bool fullGraph, AString & outBuffer ) const;
 
@@ -124,6 +239,15 @@ public:
     Node * CreateNode( Node::Type type,
                        const AString & name,
                        const BFFToken * sourceToken = nullptr );
+    static Node * AllocateNode( Node::Type type, // Create without registering (thread-safe)
+                                AString && name,
+                                uint32_t nameHash );
+
+    // Find or create a FileNode from any thread (i.e. for dependencies discovered
+    // by a job). Nodes created by other threads are tracked by the main thread
+    // in CommitPendingNodes.
+    Node * FindOrCreateFileNode( const AString & fileName );
+    void CommitPendingNodes();
     template <class T>
     T * CreateNode( const AString & name,
                     const BFFToken * sourceToken = nullptr )
@@ -133,6 +257,29 @@ public:
 
     void DoBuildPass( Node * nodeToBuild );
 
+    // Gather stamps of input files reachable from a target up front, in parallel batches
+    void PrefetchFileNodeStamps( Node * nodeToBuild, ThreadPool * threadPool );
+    void OnJobFinalized( const Node * node );
+
+    // Trust input file stamps from the previous build, except for changes reported
+    // by the FileWatcher (see Helpers/FileWatcher.h)
+    void SyncFileWatcher( const char * nodeGraphDBFile );
+    void SaveFileWatcherState( const char * nodeGraphDBFile ) const;
+    static void GetFileWatcherStateFileName( const char * nodeGraphDBFile, AString & outFileName );
+
+    // Content hashes of input files from previous builds (see -contenthash)
+    void LoadContentHashes( const char * nodeGraphDBFile );
+    void SaveContentHashes( const char * nodeGraphDBFile ) const;
+    static void GetContentHashesFileName( const char * nodeGraphDBFile, AString & outFileName );
+
+    // Tokens of BFF files, re-used by the next parse (see BFFTokenCache)
+    void SaveTokenCache( const char * nodeGraphDBFile );
+
+    // Event-driven scheduling: wake nodes waiting on a node which has reached a final state
+    void NodeCompleted( Node * node );
+    void DispatchReadyNodes(); // Queue jobs for woken nodes outside of a build pass
+    void ClearPendingDependencies();
+
     // Non-build operations that use the BuildPassTag can set it to a known value
     void SetBuildPassTagForAllNodes( uint32_t value ) const;
 
@@ -151,12 +298,16 @@ public:
 private:
     friend class FBuild;
 
-    bool ParseFromRoot( const char * bffFile );
+    bool ParseFromRoot( const char * bffFile, const char * nodeGraphDBFile );
 
-    void AddNode( Node * node );
+    Node * AddNode( Node * node );
 
     void BuildRecurse( Node * nodeToBuild, uint32_t cost );
     bool CheckDependencies( Node * nodeToBuild, const Dependencies & dependencies, uint32_t cost );
+    void ProcessReadyNodes();
+    bool CompleteFileNodeFromPrefetchedStamp( Node * node );
+    void InvalidatePrefetchedStamps( const AString & outputFileName );
+    void InvalidateAllPrefetchedStamps();
     static void UpdateBuildStatusRecurse( const Node * node,
                                           uint32_t & nodesBuiltTime,
                                           uint32_t & totalNodeTime );
@@ -186,11 +337,21 @@ private:
     void FindNearestNodesInternal( const AString & fullPath, Array<NodeWithDistance> & nodes, const uint32_t maxDistance = 5 ) const;
 
     struct UsedFile;
+    struct NodeChunk;
     bool ReadHeaderAndUsedFiles( ConstMemoryStream & nodeGraphStream,
                                  const char * nodeGraphDBFile,
                                  Array<UsedFile> & files,
                                  bool & compatibleDB,
-                                 bool & movedDB ) const;
+                                 bool & movedDB,
+                                 Array<NodeChunk> & outNodeChunks,
+                                 uint64_t & outContentHash ) const;
+    void LoadNodesParallel( ConstMemoryStream & stream,
+                            uint32_t numNodes,
+                            const Array<NodeChunk> & nodeChunks,
+                            ThreadPool & threadPool );
+    bool ReplayJournal( const ConstMemoryStream & journalStream, uint64_t dbContentHash );
+    bool ReplayJournalRecord( ConstMemoryStream & record );
+    void SaveJournalRecord( ChainedMemoryStream & stream ) const;
     uint32_t GetLibEnvVarHash() const;
 
     void RegisterSourceToken( const Node * node, const BFFToken * sourceToken );
@@ -220,9 +381,25 @@ private:
     static bool AreNodesTheSame( const void * baseA, const void * baseB, const ReflectedProperty & property );
     static bool DoDependenciesMatch( const Dependencies & depsA, const Dependencies & depsB );
 
-    Node ** m_NodeMap;
-    uint32_t m_NodeMapMaxKey; // Always equals to some power of 2 minus 1, can be used as mask.
+    NodeMap m_NodeMap;
     Array<Node *> m_AllNodes;
+    Mutex m_PendingNodesMutex;
+    Array<Node *> m_PendingNodes; // Created by other threads, not yet in m_AllNodes
+    Array<Node *> m_ReadyNodes; // Event-driven scheduling: nodes whose dependencies have completed
+    bool m_PrefetchedStampsValid = false; // Cleared once a job which might modify any input file completes
+    Array<FileNode *> m_PrefetchedFileNodes; // Sorted by name, to invalidate stamps by directory
+
+    // FileWatcher state, if synced at the start of this build
+    inline static const uint32_t kFileWatcherTimeoutMS = 2000;
+    inline static const uint32_t kFileWatcherMaxDirChanges = 64; // Beyond this, check all files
+    bool m_FileWatcherSynced = false;
+    bool m_FileWatcherStampsPending = false; // Trusted stamps not yet consumed by PrefetchFileNodeStamps
+    AString m_FileWatcherInstanceName;
+    FileWatcherToken m_FileWatcherToken;
+    uint64_t m_FileWatcherDirsHash = 0;
+
+    bool m_ContentHashesLoaded = false; // Content hashes are saved only if used
+    BFFTokenCache * m_TokenCache = nullptr; // Only if the BFF was parsed this build
 
     Timer m_Timer;
 
@@ -242,6 +419,23 @@ private:
     };
     Array<UsedFile> m_UsedFiles;
 
+    // nodes are saved in fixed size chunks, the offsets of which are recorded so that
+    // chunks can be loaded independently (and in parallel)
+    inline static const uint32_t kNodesPerLoadChunk = 1024;
+    struct NodeChunk
+    {
+        uint64_t m_BasicOffset;     // Offset of first node's basic info
+        uint64_t m_ExtendedOffset;  // Offset of first node's extended info
+    };
+
+    // state of the DB on disk, for incremental saving
+    inline static const uint32_t kJournalCompactionRatio = 4; // Resave whole DB once journal exceeds 1/4 of its size
+    AString m_SavedDBFile; // Empty if no DB which can be extended by the journal
+    uint64_t m_SavedDBContentHash = 0;
+    uint64_t m_SavedDBSize = 0;
+    uint64_t m_SavedJournalSize = 0;
+    uint32_t m_SavedNumNodes = 0; // Nodes in DB + journal
+
     Array<const BFFToken *> m_NodeSourceTokens;
 
     const SettingsNode * m_Settings;
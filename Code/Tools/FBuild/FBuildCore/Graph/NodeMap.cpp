@@ -0,0 +1,173 @@
+// NodeMap - Lookup of nodes by name
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "NodeMap.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Graph/Node.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Mem/Mem.h"
+
+// system
+#include <string.h> // for memset
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+NodeMap::NodeMap() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+NodeMap::~NodeMap() = default;
+
+// Reserve
+//------------------------------------------------------------------------------
+void NodeMap::Reserve( size_t numNodes )
+{
+    // Allow for uneven distribution between shards
+    const size_t numPerShard = ( ( numNodes + ( numNodes / 4 ) ) / kNumShards );
+
+    // Keep load at or below 1/2
+    uint32_t capacity = 16;
+    while ( capacity < ( numPerShard * 2 ) )
+    {
+        capacity *= 2;
+    }
+
+    for ( Shard & shard : m_Shards )
+    {
+        MutexHolder mh( shard.m_Mutex );
+        if ( capacity > shard.m_Capacity )
+        {
+            shard.Grow( capacity );
+        }
+    }
+}
+
+// Find
+//------------------------------------------------------------------------------
+Node * NodeMap::Find( const AString & name, uint32_t nameHash ) const
+{
+    const Shard & shard = GetShard( nameHash );
+    MutexHolder mh( shard.m_Mutex );
+    return shard.Find( name, nameHash );
+}
+
+// FindOrInsert
+//------------------------------------------------------------------------------
+Node * NodeMap::FindOrInsert( Node * node )
+{
+    Shard & shard = GetShard( node->GetNameHash() );
+    MutexHolder mh( shard.m_Mutex );
+    Node * existing = shard.Find( node->GetName(), node->GetNameHash() );
+    if ( existing )
+    {
+        return existing;
+    }
+    shard.Insert( node );
+    return node;
+}
+
+// GetSize
+//------------------------------------------------------------------------------
+size_t NodeMap::GetSize() const
+{
+    size_t size = 0;
+    for ( const Shard & shard : m_Shards )
+    {
+        MutexHolder mh( shard.m_Mutex );
+        size += shard.m_Size;
+    }
+    return size;
+}
+
+// Shard DESTRUCTOR
+//------------------------------------------------------------------------------
+NodeMap::Shard::~Shard()
+{
+    FREE( m_Entries );
+}
+
+// Shard::Find
+//------------------------------------------------------------------------------
+Node * NodeMap::Shard::Find( const AString & name, uint32_t nameHash ) const
+{
+    if ( m_Size == 0 )
+    {
+        return nullptr;
+    }
+
+    const uint32_t mask = ( m_Capacity - 1 );
+    for ( uint32_t i = ( nameHash & mask );; i = ( ( i + 1 ) & mask ) )
+    {
+        const Entry & entry = m_Entries[ i ];
+        if ( entry.m_Node == nullptr )
+        {
+            return nullptr;
+        }
+        if ( ( entry.m_Hash == nameHash ) && entry.m_Node->GetName().EqualsI( name ) )
+        {
+            return entry.m_Node;
+        }
+    }
+}
+
+// Shard::Insert
+//------------------------------------------------------------------------------
+void NodeMap::Shard::Insert( Node * node )
+{
+    // Keep load at or below 1/2 so probe sequences stay short
+    if ( ( ( m_Size + 1 ) * 2 ) > m_Capacity )
+    {
+        Grow( m_Capacity ? ( m_Capacity * 2 ) : 16 );
+    }
+
+    const uint32_t nameHash = node->GetNameHash();
+    const uint32_t mask = ( m_Capacity - 1 );
+    uint32_t i = ( nameHash & mask );
+    while ( m_Entries[ i ].m_Node )
+    {
+        i = ( ( i + 1 ) & mask );
+    }
+    m_Entries[ i ].m_Hash = nameHash;
+    m_Entries[ i ].m_Node = node;
+    ++m_Size;
+}
+
+// Shard::Grow
+//------------------------------------------------------------------------------
+void NodeMap::Shard::Grow( uint32_t newCapacity )
+{
+    ASSERT( newCapacity > m_Capacity );
+    ASSERT( ( newCapacity & ( newCapacity - 1 ) ) == 0 ); // Must be a power of 2
+
+    Entry * oldEntries = m_Entries;
+    const uint32_t oldCapacity = m_Capacity;
+
+    m_Entries = static_cast<Entry *>( ALLOC( sizeof( Entry ) * newCapacity ) );
+    memset( static_cast<void *>( m_Entries ), 0, sizeof( Entry ) * newCapacity );
+    m_Capacity = newCapacity;
+
+    // Re-insert existing entries
+    const uint32_t mask = ( newCapacity - 1 );
+    for ( uint32_t j = 0; j < oldCapacity; ++j )
+    {
+        const Entry & entry = oldEntries[ j ];
+        if ( entry.m_Node )
+        {
+            uint32_t i = ( entry.m_Hash & mask );
+            while ( m_Entries[ i ].m_Node )
+            {
+                i = ( ( i + 1 ) & mask );
+            }
+            m_Entries[ i ] = entry;
+        }
+    }
+
+    FREE( oldEntries );
+}
+
+//------------------------------------------------------------------------------
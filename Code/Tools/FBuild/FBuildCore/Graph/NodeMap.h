@@ -0,0 +1,71 @@
+// NodeMap - Lookup of nodes by name
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+class Node;
+
+// NodeMap
+//  - Open addressing with linear probing; name hashes are stored alongside the
+//    node pointers so most mismatches are rejected without touching the node
+//  - Grows with the number of nodes, or can be sized up front
+//  - Split into shards by hash, each with its own lock, so jobs can look up
+//    and add nodes concurrently
+//  - Nodes are never removed
+//------------------------------------------------------------------------------
+class NodeMap
+{
+public:
+    explicit NodeMap();
+    ~NodeMap();
+
+    // Size for the expected number of nodes to avoid growing while adding them
+    void Reserve( size_t numNodes );
+
+    Node * Find( const AString & name, uint32_t nameHash ) const;
+
+    // Add node, unless one with the same name exists. Returns the node in the map.
+    Node * FindOrInsert( Node * node );
+
+    size_t GetSize() const;
+
+private:
+    class Entry
+    {
+    public:
+        uint32_t m_Hash;
+        Node * m_Node; // nullptr = empty slot
+    };
+
+    class Shard
+    {
+    public:
+        ~Shard();
+
+        Node * Find( const AString & name, uint32_t nameHash ) const;
+        void Insert( Node * node );
+        void Grow( uint32_t newCapacity );
+
+        mutable Mutex m_Mutex;
+        Entry * m_Entries = nullptr;
+        uint32_t m_Capacity = 0; // Always 0 or a power of 2
+        uint32_t m_Size = 0;
+    };
+
+    // Top bits select the shard, leaving the low bits to select the slot
+    inline static const uint32_t kNumShardsBits = 6;
+    inline static const uint32_t kNumShards = ( 1u << kNumShardsBits );
+    Shard & GetShard( uint32_t nameHash ) const { return m_Shards[ nameHash >> ( 32 - kNumShardsBits ) ]; }
+
+    mutable Shard m_Shards[ kNumShards ];
+};
+
+//------------------------------------------------------------------------------
@@ -7,6 +7,8 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/BFF/Functions/FunctionObjectList.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheProbe.h"
+#include "Tools/FBuild/FBuildCore/Cache/CachePublishQueue.h"
 #include "Tools/FBuild/FBuildCore/Cache/ICache.h"
 #include "Tools/FBuild/FBuildCore/Cache/LightCache.h"
 #include "Tools/FBuild/FBuildCore/ExeDrivers/Compiler/CompilerDriverBase.h"
@@ -30,6 +32,7 @@
 #include "Tools/FBuild/FBuildCore/Helpers/Args.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
 #include "Tools/FBuild/FBuildCore/Helpers/CIncludeParser.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ResponseFile.h"
@@ -162,6 +165,16 @@ ObjectNode::~ObjectNode() = default;
     // for various cases
     job->GetBuildProfilerScope()->SetStepName( "Compile" );
 
+    // Note files written outside the object's directory, so stamps for them gathered
+    // before the build can be discarded (see NodeGraph::OnJobFinalized). Only the args
+    // of these compilers are understood well enough to find them.
+    m_ExtraOutputFileNames.Clear();
+    m_ExtraOutputFileNamesKnown = true;
+    if ( IsMSVC() || IsClangCl() || IsClang() || IsGCC() )
+    {
+        m_ExtraOutputFileNamesKnown = DetermineExtraOutputFileNames( m_ExtraOutputFileNames );
+    }
+
     // Delete previous file(s) if doing a clean build
     if ( FBuild::Get().GetOptions().m_ForceCleanBuild )
     {
@@ -232,6 +245,26 @@ ObjectNode::~ObjectNode() = default;
     return DoBuildWithPreProcessor2( job, useDeoptimization, stealingRemoteJob, racingRemoteJob, isFollowingLightCacheMiss );
 }
 
+// PrepareFinalize
+//------------------------------------------------------------------------------
+/*virtual*/ void ObjectNode::PrepareFinalize( NodeGraph & nodeGraph )
+{
+    // Resolve includes to nodes here, rather than serially on the main thread
+    // (new FileNodes have their stamp recorded as they are created)
+    m_IncludeNodes.Clear();
+    m_IncludeNodes.SetCapacity( m_Includes.GetSize() );
+    for ( const AString & include : m_Includes )
+    {
+        Node * fn = nodeGraph.FindOrCreateFileNode( include );
+        if ( fn->IsAFile() == false )
+        {
+            return; // Finalize will report the error
+        }
+        m_IncludeNodes.Append( fn );
+    }
+    m_IncludeNodesPrepared = true;
+}
+
 // Finalize
 //------------------------------------------------------------------------------
 /*virtual*/ bool ObjectNode::Finalize( NodeGraph & nodeGraph )
@@ -239,21 +272,27 @@ ObjectNode::~ObjectNode() = default;
     ASSERT( Thread::IsMainThread() );
 
     // convert includes to nodes
-    m_DynamicDependencies.Clear();
-    m_DynamicDependencies.SetCapacity( m_Includes.GetSize() );
-    for ( const AString & include : m_Includes )
+    if ( m_IncludeNodesPrepared == false )
     {
-        Node * fn = nodeGraph.FindNode( include );
-        if ( fn == nullptr )
-        {
-            fn = nodeGraph.CreateNode<FileNode>( include );
-        }
-        else if ( fn->IsAFile() == false )
+        m_IncludeNodes.Clear();
+        m_IncludeNodes.SetCapacity( m_Includes.GetSize() );
+        for ( const AString & include : m_Includes )
         {
-            FLOG_ERROR( "'%s' is not a FileNode (type: %s)", fn->GetName().Get(), fn->GetTypeName() );
-            return false;
+            Node * fn = nodeGraph.FindOrCreateFileNode( include );
+            if ( fn->IsAFile() == false )
+            {
+                FLOG_ERROR( "'%s' is not a FileNode (type: %s)", fn->GetName().Get(), fn->GetTypeName() );
+                return false;
+            }
+            m_IncludeNodes.Append( fn );
         }
+    }
+    m_IncludeNodesPrepared = false;
 
+    m_DynamicDependencies.Clear();
+    m_DynamicDependencies.SetCapacity( m_IncludeNodes.GetSize() );
+    for ( Node * fn : m_IncludeNodes )
+    {
         // Ensure files that are seen for the first time here have their
         // mod time recorded in the database
         if ( ( fn->GetType() == Node::FILE_NODE ) &&
@@ -265,6 +304,7 @@ ObjectNode::~ObjectNode() = default;
 
         m_DynamicDependencies.Add( fn );
     }
+    m_IncludeNodes.Destruct(); // Free memory (ObjectNodes are numerous)
 
     Node::Finalize( nodeGraph );
 
@@ -370,6 +410,11 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
 {
     job->GetBuildProfilerScope()->SetStepName( "Preprocess" );
 
+    // Take the result of any lookup done ahead of time (only valid for normal args)
+    CacheProbe * cacheProbe = FBuild::Get().GetCacheProbe();
+    const CacheProbe::State probeState = cacheProbe ? cacheProbe->Claim( this ) : CacheProbe::NONE;
+    m_CacheProbeState = useDeoptimization ? CacheProbe::NONE : probeState;
+
     Args fullArgs;
     const bool showIncludes( false );
     const bool useSourceMapping( true );
@@ -384,11 +429,13 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
     if ( useCache && GetCompiler()->GetUseLightCache() )
     {
         LightCache lc;
-        if ( lc.Hash( this,
-                      GetOwnerObjectList().GetCompilerInfo(),
-                      fullArgs.GetRawArgs(),
-                      m_LightCacheKey,
-                      m_Includes ) == false )
+        const bool alreadyHashed = ( m_CacheProbeState >= CacheProbe::KEYED );
+        if ( ( alreadyHashed == false ) &&
+             ( lc.Hash( this,
+                        GetOwnerObjectList().GetCompilerInfo(),
+                        fullArgs.GetRawArgs(),
+                        m_LightCacheKey,
+                        m_Includes ) == false ) )
         {
             // Light cache could not be used (can't parse includes)
             if ( FBuild::Get().GetOptions().m_CacheVerbose )
@@ -407,6 +454,10 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
             SetStatFlag( Node::STATS_LIGHT_CACHE ); // Light compatible
 
             // Try retrieve from cache
+            if ( alreadyHashed )
+            {
+                job->SetCacheName( m_CacheProbeName );
+            }
             GetCacheName( job ); // Prepare the cache key (always done here even if write only mode)
             if ( RetrieveFromCache( job ) )
             {
@@ -479,7 +530,24 @@ Node::BuildResult ObjectNode::DoBuildWithPreProcessor( Job * job, bool useDeopti
     {
         // compress job data
         Compressor c;
-        c.Compress( job->GetData(), job->GetDataSize(), FBuild::Get().GetOptions().m_DistributionCompressionLevel );
+        const int16_t compressionLevel = FBuild::Get().GetOptions().m_DistributionCompressionLevel;
+        CompressionDictionaryTrainer * trainer = FBuild::Get().GetCompressionDictionaryTrainer();
+        const CompressionDictionary * dictionary = ( trainer && ( compressionLevel != 0 ) )
+                                                 ? trainer->AddSample( job->GetData(), job->GetDataSize() )
+                                                 : nullptr;
+        if ( dictionary )
+        {
+            // LZ4 acceleration levels (negative) have no Zstd equivalent, so use the fastest level
+            c.CompressZstd( job->GetData(), job->GetDataSize(), Math::Max<int16_t>( compressionLevel, 1 ), dictionary );
+            if ( Compressor::GetDictionaryId( c.GetResult(), c.GetResultSize() ) != 0 )
+            {
+                job->SetCompressionDictionary( dictionary );
+            }
+        }
+        else
+        {
+            c.Compress( job->GetData(), job->GetDataSize(), compressionLevel );
+        }
         const size_t compressedSize = c.GetResultSize();
         job->OwnData( c.ReleaseResult(), compressedSize, true );
 
@@ -1327,6 +1395,80 @@ void ObjectNode::GetAltObjPath( AString & altObjName ) const
     altObjName += ".alt.obj";
 }
 
+// DetermineExtraOutputFileNames
+//------------------------------------------------------------------------------
+bool ObjectNode::DetermineExtraOutputFileNames( Array<AString> & outFileNames ) const
+{
+    // Files the compiler writes in addition to the object, at locations given by the args
+    // (Files written alongside the object, like those from GetExtraCacheFilePaths, are not included)
+    static const char * const msvcOptions[] = { "Fd", "Fa", "Fp", "Fi", "FR", "Fr", "doc", "ifcOutput",
+                                                "sourceDependencies:directives", "sourceDependencies",
+                                                "analyze:log" };
+    static const char * const gccOptions[] = { "MF", "-serialize-diagnostics", "ftime-trace=", "dumpdir" };
+
+    const bool msvcStyle = ( IsMSVC() || IsClangCl() );
+    const char * const * options = msvcStyle ? msvcOptions : gccOptions;
+    const size_t numOptions = msvcStyle ? ( sizeof( msvcOptions ) / sizeof( msvcOptions[ 0 ] ) )
+                                        : ( sizeof( gccOptions ) / sizeof( gccOptions[ 0 ] ) );
+
+    StackArray<AString> tokens;
+    GetCommandLine( false, false ).Tokenize( tokens );
+
+    const AString * const end = tokens.End();
+    for ( const AString * it = tokens.Begin(); it != end; ++it )
+    {
+        // Temporary files written to the working dir can't be tracked
+        if ( ( msvcStyle == false ) &&
+             IsStartOfCompilerArg_MSVC( *it, "save-temps" ) &&
+             ( IsCompilerArg_MSVC( *it, "save-temps=obj" ) == false ) )
+        {
+            return false;
+        }
+
+        for ( size_t i = 0; i < numOptions; ++i )
+        {
+            if ( IsStartOfCompilerArg_MSVC( *it, options[ i ] ) == false )
+            {
+                continue;
+            }
+
+            const char * valueStart = it->Get() + AString::StrLen( options[ i ] ) + 1; // +1 for - or /
+            const char * valueEnd = it->GetEnd();
+            if ( ( valueStart < valueEnd ) && ( ( *valueStart == ':' ) || ( *valueStart == '=' ) ) )
+            {
+                ++valueStart;
+            }
+
+            // if token is exactly matched then value is next token
+            if ( valueStart == valueEnd )
+            {
+                if ( ( it + 1 ) == end )
+                {
+                    break; // we just pretend it doesn't exist and let the compiler complain
+                }
+                ++it;
+                valueStart = it->Get();
+                valueEnd = it->GetEnd();
+            }
+
+            AStackString value;
+            Args::StripQuotes( valueStart, valueEnd, value );
+
+            // Apply the same substitutions as when building the args
+            value.Replace( "%1", GetSourceFile()->GetName().Get() );
+            value.Replace( "%2", m_Name.Get() );
+            if ( GetPCHObjectName().IsEmpty() == false )
+            {
+                value.Replace( "%3", GetPCHObjectName().Get() );
+            }
+
+            NodeGraph::CleanPath( value, outFileNames.EmplaceBack() );
+            break;
+        }
+    }
+    return true;
+}
+
 //------------------------------------------------------------------------------
 const AString & ObjectNode::GetPCHObjectName() const
 {
@@ -1426,7 +1568,21 @@ bool ObjectNode::RetrieveFromCache( Job * job )
 
     void * cacheData( nullptr );
     size_t cacheDataSize( 0 );
-    if ( cache->Retrieve( cacheFileName, cacheData, cacheDataSize ) )
+    bool retrieved;
+    if ( m_CacheProbeState == CacheProbe::MISS )
+    {
+        retrieved = false; // Already known to be missing
+    }
+    else if ( ( m_CacheProbeState == CacheProbe::FETCHED ) && m_CacheProbeData )
+    {
+        FBuild::Get().GetCacheProbe()->TakeData( this, cacheData, cacheDataSize );
+        retrieved = true;
+    }
+    else
+    {
+        retrieved = cache->Retrieve( cacheFileName, cacheData, cacheDataSize );
+    }
+    if ( retrieved )
     {
         const uint32_t retrieveTime = uint32_t( t.GetElapsedMS() );
 
@@ -1578,23 +1734,21 @@ void ObjectNode::WriteToCache_FromUncompressedData( Job * job,
         return;
     }
 
-    // Compress
-    const Timer t;
-    const uint32_t startCompress( (uint32_t)t.GetElapsedMS() );
-    Compressor c;
-    const int16_t compressionLevel = FBuild::Get().GetOptions().m_CacheCompressionLevel;
-    if ( compressionLevel <= 0 )
+    // Compress and store in the background if possible
+    if ( ShouldPublishToCacheAsync() &&
+         FBuild::Get().GetCachePublishQueue()->Enqueue( this,
+                                                        GetCacheName( job ),
+                                                        uncompressedData,
+                                                        uncompressedDataSize,
+                                                        false, // isCompressed
+                                                        0 ) )
     {
-        // Use LZ4 for low compression levels (level < 0)
-        // This call also handles disabled compression (level 0)
-        c.Compress( uncompressedData, uncompressedDataSize, compressionLevel );
-    }
-    else
-    {
-        // Use Ztd for higher compression levels (level > 0)
-        c.CompressZstd( uncompressedData, uncompressedDataSize, compressionLevel );
+        return;
     }
-    const uint32_t compressionTime = ( (uint32_t)t.GetElapsedMS() - startCompress );
+
+    // Compress
+    Compressor c;
+    const uint32_t compressionTime = CompressForCache( uncompressedData, uncompressedDataSize, c );
 
     WriteToCache_FromCompressedData( job,
                                      c.GetResult(),
@@ -1619,6 +1773,69 @@ void ObjectNode::WriteToCache_FromCompressedData( Job * job,
 
     const AString & cacheFileName = GetCacheName( job );
 
+    // Store in the background if possible
+    if ( ShouldPublishToCacheAsync() &&
+         FBuild::Get().GetCachePublishQueue()->Enqueue( this,
+                                                        cacheFileName,
+                                                        compressedData,
+                                                        compressedDataSize,
+                                                        true, // isCompressed
+                                                        compressionTimeMS ) )
+    {
+        return;
+    }
+
+    uint32_t cachingTime;
+    if ( PublishToCache( cacheFileName, compressedData, compressedDataSize, compressionTimeMS, cachingTime ) )
+    {
+        SetStatFlag( Node::STATS_CACHE_STORE );
+        AddCachingTime( cachingTime );
+    }
+}
+
+// ShouldPublishToCacheAsync
+//------------------------------------------------------------------------------
+bool ObjectNode::ShouldPublishToCacheAsync() const
+{
+    // Dependent objects need to know the PCH key to be able to pull from the cache
+    // so it must be known before this node completes
+    if ( IsCreatingPCH() && IsMSVC() )
+    {
+        return false;
+    }
+    return ( FBuild::Get().GetCachePublishQueue() != nullptr );
+}
+
+// CompressForCache
+//------------------------------------------------------------------------------
+/*static*/ uint32_t ObjectNode::CompressForCache( const void * uncompressedData,
+                                                  uint64_t uncompressedDataSize,
+                                                  Compressor & outCompressor )
+{
+    const Timer t;
+    const int16_t compressionLevel = FBuild::Get().GetOptions().m_CacheCompressionLevel;
+    if ( compressionLevel <= 0 )
+    {
+        // Use LZ4 for low compression levels (level < 0)
+        // This call also handles disabled compression (level 0)
+        outCompressor.Compress( uncompressedData, uncompressedDataSize, compressionLevel );
+    }
+    else
+    {
+        // Use Ztd for higher compression levels (level > 0)
+        outCompressor.CompressZstd( uncompressedData, uncompressedDataSize, compressionLevel );
+    }
+    return (uint32_t)t.GetElapsedMS();
+}
+
+// PublishToCache
+//------------------------------------------------------------------------------
+bool ObjectNode::PublishToCache( const AString & cacheFileName,
+                                 const void * compressedData,
+                                 uint64_t compressedDataSize,
+                                 uint32_t compressionTimeMS,
+                                 uint32_t & outCachingTimeMS )
+{
     // Commit to cache
     const Timer t;
     const uint32_t startPublish( (uint32_t)t.GetElapsedMS() );
@@ -1627,8 +1844,6 @@ void ObjectNode::WriteToCache_FromCompressedData( Job * job,
         // cache store complete
         const uint32_t publishTime = ( (uint32_t)t.GetElapsedMS() - startPublish );
 
-        SetStatFlag( Node::STATS_CACHE_STORE );
-
         // Dependent objects need to know the PCH key to be able to pull from the cache
         if ( IsCreatingPCH() && IsMSVC() )
         {
@@ -1636,7 +1851,7 @@ void ObjectNode::WriteToCache_FromCompressedData( Job * job,
         }
 
         const uint32_t cachingTime = uint32_t( t.GetElapsedMS() );
-        AddCachingTime( cachingTime );
+        outCachingTimeMS = cachingTime;
 
         // Output
         if ( FBuild::Get().GetOptions().m_CacheVerbose )
@@ -1658,21 +1873,21 @@ void ObjectNode::WriteToCache_FromCompressedData( Job * job,
             }
             FLOG_OUTPUT( output );
         }
+        return true;
     }
-    else
-    {
-        // Cache store failed
 
-        // Output
-        if ( FBuild::Get().GetOptions().m_CacheVerbose )
-        {
-            FLOG_OUTPUT( "Obj: %s\n"
-                         " - Cache Store Fail: %u ms '%s'\n",
-                         GetName().Get(),
-                         uint32_t( t.GetElapsedMS() ),
-                         cacheFileName.Get() );
-        }
+    // Cache store failed
+
+    // Output
+    if ( FBuild::Get().GetOptions().m_CacheVerbose )
+    {
+        FLOG_OUTPUT( "Obj: %s\n"
+                     " - Cache Store Fail: %u ms '%s'\n",
+                     GetName().Get(),
+                     uint32_t( t.GetElapsedMS() ),
+                     cacheFileName.Get() );
     }
+    return false;
 }
 
 // GetExtraCacheFilePaths
@@ -2188,22 +2403,13 @@ bool ObjectNode::WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpF
         }
     }
 
-    void const * dataToWrite = job->GetData();
-    size_t dataToWriteSize = job->GetDataSize();
-
     // handle compressed data
-    Compressor c; // scoped here so we can access decompression buffer
-    if ( job->IsDataCompressed() )
+    if ( job->IsDataCompressed() && ( Compressor::IsValidData( job->GetData(), job->GetDataSize() ) == false ) )
     {
-        if ( c.Decompress( dataToWrite ) == false )
-        {
-            // Decompression failure would indicate a bug
-            job->Error( "Decompression failed. Target: '%s'", GetName().Get() );
-            job->OnSystemError();
-            return false;
-        }
-        dataToWrite = c.GetResult();
-        dataToWriteSize = c.GetResultSize();
+        // Decompression failure would indicate a bug
+        job->Error( "Decompression failed. Target: '%s'", GetName().Get() );
+        job->OnSystemError();
+        return false;
     }
 
     const CompilerNode * compiler = job->GetNode()->CastTo<ObjectNode>()->GetCompiler();
@@ -2243,8 +2449,19 @@ bool ObjectNode::WriteTmpFile( Job * job, AString & tmpDirectory, AString & tmpF
             return false;
         }
     }
-    if ( tmpFile.Write( dataToWrite, dataToWriteSize ) != dataToWriteSize )
+    // Compressed data is decompressed straight to the file
+    Compressor c;
+    const bool written = job->IsDataCompressed() ? c.DecompressToFile( job->GetData(), tmpFile, job->GetCompressionDictionary() )
+                                                 : ( tmpFile.Write( job->GetData(), job->GetDataSize() ) == job->GetDataSize() );
+    if ( written == false )
     {
+        if ( c.IsDataCorrupt() )
+        {
+            // Decompression failure would indicate a bug
+            job->Error( "Decompression failed. Target: '%s'", GetName().Get() );
+            job->OnSystemError();
+            return false;
+        }
         job->Error( "Failed to write to temp file. Error: %s TmpFile: '%s' Target: '%s'", LAST_ERROR_STR, tmpFileName.Get(), GetName().Get() );
         job->OnSystemError();
         return false;
@@ -17,6 +17,7 @@
 //------------------------------------------------------------------------------
 class Args;
 class CompilerDriverBase;
+class Compressor;
 class ConstMemoryStream;
 class Function;
 class MultiBuffer;
@@ -168,6 +169,8 @@ public:
     void GetNativeAnalysisXMLPath( AString & outXMLFileName ) const;
     void GetGCNOPath( AString & gcnoFileName ) const;
     void GetAltObjPath( AString & altObjName ) const;
+    const Array<AString> & GetExtraOutputFileNames() const { return m_ExtraOutputFileNames; } // Noted by the last DoBuild
+    bool AreExtraOutputFileNamesKnown() const { return m_ExtraOutputFileNamesKnown; }
 
     const AString & GetPCHObjectName() const;
     const AString & GetPrecompiledHeaderName() const;
@@ -190,6 +193,7 @@ public:
 protected:
     virtual BuildResult DoBuild( Job * job ) override;
     virtual BuildResult DoBuild2( Job * job, bool racingRemoteJob ) override;
+    virtual void PrepareFinalize( NodeGraph & nodeGraph ) override;
     virtual bool Finalize( NodeGraph & nodeGraph ) override;
 
     virtual void Migrate( const Node & oldNode ) override;
@@ -220,7 +224,18 @@ protected:
                                           const void * compressedData,
                                           uint64_t compressedDataSize,
                                           uint32_t compressionTimeMS );
+    bool ShouldPublishToCacheAsync() const;
+    static uint32_t CompressForCache( const void * uncompressedData,
+                                      uint64_t uncompressedDataSize,
+                                      Compressor & outCompressor );
+    bool PublishToCache( const AString & cacheFileName,
+                         const void * compressedData,
+                         uint64_t compressedDataSize,
+                         uint32_t compressionTimeMS,
+                         uint32_t & outCachingTimeMS );
+    friend class CachePublishQueue;
     void GetExtraCacheFilePaths( const Job * job, Array<AString> & outFileNames ) const;
+    [[nodiscard]] bool DetermineExtraOutputFileNames( Array<AString> & outFileNames ) const; // Returns false if any can't be determined
 
     void EmitCompilationMessage( const Args & fullArgs, bool useDeoptimization, bool stealingRemoteJob = false, bool racingRemoteJob = false, bool useDedicatedPreprocessor = false, bool isRemote = false ) const;
 
@@ -308,6 +323,18 @@ protected:
 
     // Not serialized
     Array<AString> m_Includes;
+    Array<Node *> m_IncludeNodes; // m_Includes resolved by PrepareFinalize
+    bool m_IncludeNodesPrepared = false;
+    Array<AString> m_ExtraOutputFileNames; // Side outputs at locations given by the args
+    bool m_ExtraOutputFileNamesKnown = true;
+
+    // Lookup ahead of compilation (see CacheProbe)
+    friend class CacheProbe;
+    uint8_t m_CacheProbeState = 0; // CacheProbe::State
+    bool m_CacheProbeClaimed = false; // Owned by worker once claimed
+    AString m_CacheProbeName;
+    void * m_CacheProbeData = nullptr;
+    size_t m_CacheProbeDataSize = 0;
 
 #if defined( ENABLE_FAKE_SYSTEM_FAILURE )
     // Fake system failure for tests
@@ -325,6 +352,8 @@ public:
                       uint32_t flags );
     virtual ~ObjectNodeRemote() override;
 
+    const AString & GetCompilerOptions() const { return m_CompilerOptions; }
+
 protected:
     virtual const AString & GetCommandLine( bool useDedicatedPreprocessor,
                                             bool useDeoptimization ) const override;
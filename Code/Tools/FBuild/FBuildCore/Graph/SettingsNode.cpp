@@ -31,6 +31,9 @@ REFLECT_NODE_BEGIN( SettingsNode, Node )
     REFLECT( m_CachePathMountPoint )
     REFLECT( m_CachePluginDLL )
     REFLECT( m_CachePluginDLLConfig )
+    REFLECT( m_CachePacked )
+    REFLECT( m_CacheLocalPath )
+    REFLECT( m_CacheLocalSizeMiB, MetaRange( 1, 0x7FFFFFFF ) )
     REFLECT( m_Workers )
     REFLECT( m_WorkerConnectionLimit )
     REFLECT( m_DistributableJobMemoryLimitMiB, MetaRange( DIST_MEMORY_LIMIT_MIN, DIST_MEMORY_LIMIT_MAX ) )
@@ -50,12 +53,15 @@ REFLECT_END( ConcurrencyGroup )
 //------------------------------------------------------------------------------
 SettingsNode::SettingsNode()
     : Node( Node::SETTINGS_NODE )
+    , m_CachePacked( false )
+    , m_CacheLocalSizeMiB( 10 * 1024 )
     , m_WorkerConnectionLimit( 15 )
     , m_DistributableJobMemoryLimitMiB( DIST_MEMORY_LIMIT_DEFAULT )
 {
     // Cache path from environment
     Env::GetEnvVariable( "FASTBUILD_CACHE_PATH", m_CachePathFromEnvVar );
     Env::GetEnvVariable( "FASTBUILD_CACHE_PATH_MOUNT_POINT", m_CachePathMountPointFromEnvVar );
+    Env::GetEnvVariable( "FASTBUILD_CACHE_LOCAL_PATH", m_CacheLocalPathFromEnvVar );
 }
 
 // Initialize
@@ -121,6 +127,18 @@ const AString & SettingsNode::GetCachePathMountPoint() const
     return m_CachePathMountPointFromEnvVar;
 }
 
+// GetCacheLocalPath
+//------------------------------------------------------------------------------
+const AString & SettingsNode::GetCacheLocalPath() const
+{
+    // Settings() bff option overrides environment variable
+    if ( m_CacheLocalPath.IsEmpty() == false )
+    {
+        return m_CacheLocalPath;
+    }
+    return m_CacheLocalPathFromEnvVar;
+}
+
 // GetCachePluginDLL
 //------------------------------------------------------------------------------
 const AString & SettingsNode::GetCachePluginDLL() const
@@ -30,6 +30,9 @@ public:
     const AString & GetCachePathMountPoint() const;
     const AString & GetCachePluginDLL() const;
     const AString & GetCachePluginDLLConfig() const;
+    bool GetCachePacked() const { return m_CachePacked; }
+    const AString & GetCacheLocalPath() const;
+    uint32_t GetCacheLocalSizeMiB() const { return m_CacheLocalSizeMiB; }
     const Array<AString> & GetWorkerList() const { return m_Workers; }
     uint32_t GetWorkerConnectionLimit() const { return m_WorkerConnectionLimit; }
     uint32_t GetDistributableJobMemoryLimitMiB() const { return m_DistributableJobMemoryLimitMiB; }
@@ -46,6 +49,7 @@ private:
     // Settings from environment variables
     AString m_CachePathFromEnvVar;
     AString m_CachePathMountPointFromEnvVar;
+    AString m_CacheLocalPathFromEnvVar;
 
     // Exposed settings
     Array<AString> m_Environment;
@@ -53,6 +57,9 @@ private:
     AString m_CachePathMountPoint;
     AString m_CachePluginDLL;
     AString m_CachePluginDLLConfig;
+    bool m_CachePacked;
+    AString m_CacheLocalPath;
+    uint32_t m_CacheLocalSizeMiB;
     Array<AString> m_Workers;
     uint32_t m_WorkerConnectionLimit;
     uint32_t m_DistributableJobMemoryLimitMiB;
@@ -0,0 +1,282 @@
+// CompressionDictionary
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CompressionDictionary.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Helpers/ContentChunker.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+
+// External
+#include "zstd.h"
+
+// DictionarySegment
+//  - A run of bytes in a sample, with boundaries chosen by content so that the
+//    same text in different samples produces the same segments regardless of
+//    what precedes it
+//------------------------------------------------------------------------------
+class DictionarySegment
+{
+public:
+    uint64_t m_Hash;
+    uint32_t m_Sample;
+    uint32_t m_Offset;
+    uint32_t m_Length;
+    uint32_t m_Score; // Bytes saved if in dictionary (after grouping)
+
+    bool operator<( const DictionarySegment & other ) const
+    {
+        return ( m_Hash != other.m_Hash ) ? ( m_Hash < other.m_Hash )
+                                          : ( m_Sample < other.m_Sample );
+    }
+};
+
+// Static
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CompressionDictionaryTrainer::s_NumSamples( 16 );
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CompressionDictionary::CompressionDictionary() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CompressionDictionary::~CompressionDictionary()
+{
+    for ( const CDict & cdict : m_CDicts )
+    {
+        ZSTD_freeCDict( cdict.m_CDict );
+    }
+    ZSTD_freeDDict( m_DDict );
+}
+
+// Release
+//------------------------------------------------------------------------------
+void CompressionDictionary::Release() const
+{
+    ASSERT( m_RefCount.Load() > 0 );
+    if ( m_RefCount.Decrement() == 0 )
+    {
+        FDELETE this;
+    }
+}
+
+// Train
+//------------------------------------------------------------------------------
+bool CompressionDictionary::Train( const Array<AString> & samples, size_t maxSize )
+{
+    PROFILE_FUNCTION;
+
+    // Segments of 128 bytes on average (a few lines of source)
+    const ContentChunker chunker( 32, 128, 1024 );
+
+    Array<DictionarySegment> segments;
+    for ( size_t sampleIndex = 0; sampleIndex < samples.GetSize(); ++sampleIndex )
+    {
+        const AString & sample = samples[ sampleIndex ];
+        const uint32_t size = sample.GetLength();
+        for ( uint32_t offset = 0; offset < size; )
+        {
+            const uint32_t length = chunker.GetChunkSize( sample.Get() + offset, size - offset );
+            DictionarySegment & segment = segments.EmplaceBack();
+            segment.m_Hash = xxHash3::Calc64( sample.Get() + offset, length );
+            segment.m_Sample = (uint32_t)sampleIndex;
+            segment.m_Offset = offset;
+            segment.m_Length = length;
+            segment.m_Score = 0;
+            offset += length;
+        }
+    }
+
+    // Keep segments that occur in more than one sample, scored by how much
+    // data the dictionary would save
+    segments.Sort();
+    Array<DictionarySegment> candidates;
+    for ( size_t i = 0; i < segments.GetSize(); )
+    {
+        const DictionarySegment & first = segments[ i ];
+        uint32_t numSamples = 0;
+        uint32_t lastSample = 0xFFFFFFFF;
+        size_t j = i;
+        for ( ; ( j < segments.GetSize() ) && ( segments[ j ].m_Hash == first.m_Hash ); ++j )
+        {
+            if ( segments[ j ].m_Sample != lastSample )
+            {
+                lastSample = segments[ j ].m_Sample;
+                ++numSamples;
+            }
+        }
+        if ( numSamples > 1 )
+        {
+            DictionarySegment & candidate = candidates.EmplaceBack( first );
+            candidate.m_Score = ( ( numSamples - 1 ) * first.m_Length );
+        }
+        i = j;
+    }
+    if ( candidates.IsEmpty() )
+    {
+        return false; // Nothing in common
+    }
+
+    // Take the most valuable segments
+    candidates.Sort( []( const DictionarySegment & a, const DictionarySegment & b ) { return ( a.m_Score > b.m_Score ); } );
+    size_t totalSize = 0;
+    size_t numToKeep = 0;
+    for ( ; numToKeep < candidates.GetSize(); ++numToKeep )
+    {
+        if ( ( totalSize + candidates[ numToKeep ].m_Length ) > maxSize )
+        {
+            break;
+        }
+        totalSize += candidates[ numToKeep ].m_Length;
+    }
+    candidates.SetSize( numToKeep );
+
+    // Keep the original order so adjacent segments form longer matches
+    candidates.Sort( []( const DictionarySegment & a, const DictionarySegment & b ) {
+        return ( a.m_Sample != b.m_Sample ) ? ( a.m_Sample < b.m_Sample ) : ( a.m_Offset < b.m_Offset );
+    } );
+    AString content;
+    content.SetReserved( totalSize );
+    for ( const DictionarySegment & segment : candidates )
+    {
+        const char * start = ( samples[ segment.m_Sample ].Get() + segment.m_Offset );
+        content.Append( start, segment.m_Length );
+    }
+
+    Load( content.Get(), content.GetLength() );
+    return true;
+}
+
+// Load
+//------------------------------------------------------------------------------
+void CompressionDictionary::Load( const void * data, size_t dataSize )
+{
+    ASSERT( m_Content.IsEmpty() ); // Should only be loaded once
+    m_Content.Assign( (const char *)data, (const char *)data + dataSize );
+    m_Id = xxHash3::Calc32Big( data, dataSize );
+    if ( m_Id == 0 )
+    {
+        m_Id = 1; // 0 means "no dictionary"
+    }
+}
+
+// Compress
+//------------------------------------------------------------------------------
+size_t CompressionDictionary::Compress( void * dst, size_t dstCapacity, const void * src, size_t srcSize, int32_t compressionLevel ) const
+{
+    ZSTD_CCtx * context = ZSTD_createCCtx();
+    const size_t result = ZSTD_compress_usingCDict( context, dst, dstCapacity, src, srcSize, GetCDict( compressionLevel ) );
+    ZSTD_freeCCtx( context );
+    return ZSTD_isError( result ) ? 0 : result;
+}
+
+// Decompress
+//------------------------------------------------------------------------------
+size_t CompressionDictionary::Decompress( void * dst, size_t dstCapacity, const void * src, size_t srcSize ) const
+{
+    ZSTD_DCtx * context = ZSTD_createDCtx();
+    const size_t result = ZSTD_decompress_usingDDict( context, dst, dstCapacity, src, srcSize, GetDDict() );
+    ZSTD_freeDCtx( context );
+    return ZSTD_isError( result ) ? 0 : result;
+}
+
+// GetCDict
+//------------------------------------------------------------------------------
+const ZSTD_CDict_s * CompressionDictionary::GetCDict( int32_t compressionLevel ) const
+{
+    // Preparing the dictionary for a compression level is expensive, but the
+    // result can be shared by all threads
+    MutexHolder mh( m_Mutex );
+    for ( const CDict & cdict : m_CDicts )
+    {
+        if ( cdict.m_CompressionLevel == compressionLevel )
+        {
+            return cdict.m_CDict;
+        }
+    }
+    CDict & cdict = m_CDicts.EmplaceBack();
+    cdict.m_CompressionLevel = compressionLevel;
+    cdict.m_CDict = ZSTD_createCDict( m_Content.Get(), m_Content.GetLength(), compressionLevel );
+    return cdict.m_CDict;
+}
+
+// GetDDict
+//------------------------------------------------------------------------------
+const ZSTD_DDict_s * CompressionDictionary::GetDDict() const
+{
+    MutexHolder mh( m_Mutex );
+    if ( m_DDict == nullptr )
+    {
+        m_DDict = ZSTD_createDDict( m_Content.Get(), m_Content.GetLength() );
+    }
+    return m_DDict;
+}
+
+// CONSTRUCTOR (CompressionDictionaryTrainer)
+//------------------------------------------------------------------------------
+CompressionDictionaryTrainer::CompressionDictionaryTrainer() = default;
+
+// DESTRUCTOR (CompressionDictionaryTrainer)
+//------------------------------------------------------------------------------
+CompressionDictionaryTrainer::~CompressionDictionaryTrainer()
+{
+    if ( m_Dictionary )
+    {
+        m_Dictionary->Release(); // Jobs may still hold references
+    }
+}
+
+// AddSample
+//------------------------------------------------------------------------------
+const CompressionDictionary * CompressionDictionaryTrainer::AddSample( const void * data, size_t dataSize )
+{
+    Array<AString> samples;
+    {
+        MutexHolder mh( m_Mutex );
+        if ( m_Done )
+        {
+            return m_Dictionary;
+        }
+
+        AString & sample = m_Samples.EmplaceBack();
+        const size_t sampleSize = Math::Min( dataSize, kMaxSampleSize );
+        sample.Assign( (const char *)data, (const char *)data + sampleSize );
+        if ( m_Samples.GetSize() < s_NumSamples )
+        {
+            return nullptr;
+        }
+
+        // Train outside the lock (other jobs compress without a dictionary meanwhile)
+        m_Done = true;
+        samples.Swap( m_Samples );
+    }
+
+    CompressionDictionary * dictionary = FNEW( CompressionDictionary );
+    if ( dictionary->Train( samples ) == false )
+    {
+        dictionary->Release();
+        return nullptr;
+    }
+
+    MutexHolder mh( m_Mutex );
+    m_Dictionary = dictionary;
+    return m_Dictionary;
+}
+
+// GetDictionary
+//------------------------------------------------------------------------------
+const CompressionDictionary * CompressionDictionaryTrainer::GetDictionary() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_Dictionary;
+}
+
+//------------------------------------------------------------------------------
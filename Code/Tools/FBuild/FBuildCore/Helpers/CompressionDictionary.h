@@ -0,0 +1,101 @@
+// CompressionDictionary
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+// CompressionDictionary
+//  - Content shared by many small inputs (such as common headers in preprocessed
+//    translation units) which Zstd can reference instead of storing again
+//  - Identified by a hash of the content, so all parties agree on the id
+//  - Heap allocated dictionaries are reference counted (the creator holds the
+//    first reference) so jobs can keep them alive after their owner lets go
+//------------------------------------------------------------------------------
+class CompressionDictionary
+{
+public:
+    explicit CompressionDictionary();
+    ~CompressionDictionary();
+
+    void AddRef() const { m_RefCount.Increment(); }
+    void Release() const; // Deletes on last reference
+
+    // Build from samples of typical data
+    bool Train( const Array<AString> & samples, size_t maxSize = kDefaultMaxSize );
+
+    // Use content built elsewhere (i.e. received from a remote client)
+    void Load( const void * data, size_t dataSize );
+
+    uint32_t GetId() const { return m_Id; }
+    bool operator==( uint32_t id ) const { return ( m_Id == id ); }
+    const void * GetData() const { return m_Content.Get(); }
+    size_t GetSize() const { return m_Content.GetLength(); }
+
+    // Zstd compression using the dictionary. Returns 0 on failure.
+    size_t Compress( void * dst, size_t dstCapacity, const void * src, size_t srcSize, int32_t compressionLevel ) const;
+    size_t Decompress( void * dst, size_t dstCapacity, const void * src, size_t srcSize ) const;
+
+    inline static const size_t kDefaultMaxSize = ( 256 * 1024 );
+
+private:
+    const ZSTD_CDict_s * GetCDict( int32_t compressionLevel ) const;
+    const ZSTD_DDict_s * GetDDict() const;
+
+    AString m_Content;
+    uint32_t m_Id = 0;
+    mutable Atomic<uint32_t> m_RefCount{ 1 };
+
+    // Prepared dictionaries, created on first use
+    class CDict
+    {
+    public:
+        int32_t m_CompressionLevel;
+        ZSTD_CDict_s * m_CDict;
+    };
+    mutable Mutex m_Mutex;
+    mutable Array<CDict> m_CDicts;
+    mutable ZSTD_DDict_s * m_DDict = nullptr;
+};
+
+// CompressionDictionaryTrainer
+//  - Collects samples until there are enough to build a dictionary
+//  - Thread-safe
+//------------------------------------------------------------------------------
+class CompressionDictionaryTrainer
+{
+public:
+    explicit CompressionDictionaryTrainer();
+    ~CompressionDictionaryTrainer();
+
+    // Returns the dictionary once trained, or nullptr
+    const CompressionDictionary * AddSample( const void * data, size_t dataSize );
+    const CompressionDictionary * GetDictionary() const;
+
+    inline static const size_t kMaxSampleSize = ( 1024 * 1024 ); // Common headers are at the start
+
+    // For tests
+    static void SetNumSamples( uint32_t n ) { s_NumSamples = n; }
+    static uint32_t GetNumSamples() { return s_NumSamples; }
+
+private:
+    mutable Mutex m_Mutex;
+    Array<AString> m_Samples;
+    bool m_Done = false; // Enough samples collected
+    CompressionDictionary * m_Dictionary = nullptr;
+
+    static uint32_t s_NumSamples; // Samples to collect before training
+};
+
+//------------------------------------------------------------------------------
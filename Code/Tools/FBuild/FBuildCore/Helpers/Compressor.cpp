@@ -6,14 +6,22 @@
 #include "Compressor.h"
 
 // FBuildCore
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 
 // Core
+#include "Core/Containers/Array.h"
 #include "Core/Containers/UniquePtr.h"
 #include "Core/Env/Assert.h"
+#include "Core/Env/CPUInfo.h"
 #include "Core/Env/Types.h"
+#include "Core/FileIO/FileStream.h"
 #include "Core/Math/Conversions.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/ThreadPool.h"
 #include "Core/Profile/Profile.h"
 
 // External
@@ -23,10 +31,243 @@
 
 #include <memory.h>
 
+// ChunkJobs
+//  - Processes a range of chunks on the shared pool of helper threads, with
+//    the calling thread also participating
+//  - Helpers are not tied to the caller which queued them; each one joins
+//    whichever active caller still has chunks left, so a caller never waits
+//    for helpers stuck behind another caller's work
 //------------------------------------------------------------------------------
-Compressor::Compressor()
+class Compressor::ChunkJobs
+{
+public:
+    using ChunkFunc = bool ( * )( void * userData, size_t chunkIndex );
+
+    explicit ChunkJobs( uint64_t numChunks );
+
+    bool Process( size_t firstChunk, size_t numChunks, ChunkFunc func, void * userData );
+
+    uint32_t GetNumThreads() const { return ( m_MaxHelpers + 1 ); }
+
+private:
+    static ThreadPool * GetSharedThreadPool();
+    static void HelperJob( void * userData );
+    void ProcessChunks();
+
+    // Callers with chunks which helpers can join (protected by s_Mutex)
+    static Mutex s_Mutex;
+    static ChunkJobs * s_Active;
+    ChunkJobs * m_NextActive = nullptr;
+    uint32_t m_NumHelpersActive = 0;
+    bool m_WaitingForHelpers = false;
+
+    ThreadPool * m_ThreadPool = nullptr;
+    uint32_t m_MaxHelpers = 0;
+    Semaphore m_HelpersDone;
+    ChunkFunc m_Func = nullptr;
+    void * m_UserData = nullptr;
+    size_t m_FirstChunk = 0;
+    uint32_t m_NumChunks = 0;
+    Atomic<uint32_t> m_NextChunk;
+    Atomic<bool> m_Failed;
+};
+
+// ChunkContext
+//------------------------------------------------------------------------------
+class Compressor::ChunkContext
+{
+public:
+    void InitForDecompression( const void * framedData )
+    {
+        const FramedHeader * header = (const FramedHeader *)framedData;
+        const uint64_t numChunks = GetNumChunks( *header );
+        m_ChunkSize = header->m_ChunkSize;
+        m_UncompressedSize = header->m_UncompressedSize;
+        m_Src = (const char *)framedData;
+        m_Chunks = const_cast<ChunkHeader *>( (const ChunkHeader *)( header + 1 ) );
+
+        // Find the data for each chunk
+        m_ChunkOffsets.SetSize( (size_t)numChunks );
+        uint64_t offset = sizeof( FramedHeader ) + ( numChunks * sizeof( ChunkHeader ) );
+        for ( size_t i = 0; i < numChunks; ++i )
+        {
+            m_ChunkOffsets[ i ] = offset;
+            offset += m_Chunks[ i ].m_CompressedSize;
+        }
+    }
+
+    // Size of uncompressed chunk
+    size_t GetChunkSize( size_t chunkIndex ) const
+    {
+        return (size_t)Math::Min<uint64_t>( m_ChunkSize, m_UncompressedSize - ( (uint64_t)chunkIndex * m_ChunkSize ) );
+    }
+
+    CompressionType m_Type = eUncompressed;     // Compression only
+    int32_t m_CompressionLevel = 0;             // Compression only
+    uint32_t m_ChunkSize = 0;
+    uint64_t m_UncompressedSize = 0;
+    const char * m_Src = nullptr;               // Uncompressed data, or framed data
+    char * m_Dst = nullptr;                     // Compression slots, or uncompressed window
+    size_t m_DstSlotSize = 0;                   // Compression only
+    size_t m_DstFirstChunk = 0;                 // Chunk at start of uncompressed window
+    ChunkHeader * m_Chunks = nullptr;
+    Array<uint64_t> m_ChunkOffsets;             // Decompression only
+};
+
+// Static Data (ChunkJobs)
+//------------------------------------------------------------------------------
+/*static*/ Mutex Compressor::ChunkJobs::s_Mutex;
+/*static*/ Compressor::ChunkJobs * Compressor::ChunkJobs::s_Active = nullptr;
+
+// CONSTRUCTOR (ChunkJobs)
+//------------------------------------------------------------------------------
+Compressor::ChunkJobs::ChunkJobs( uint64_t numChunks )
+    : m_ThreadPool( ( numChunks > 1 ) ? GetSharedThreadPool() : nullptr )
+{
+    if ( m_ThreadPool )
+    {
+        m_MaxHelpers = (uint32_t)Math::Min<uint64_t>( numChunks - 1, m_ThreadPool->GetNumThreads() );
+    }
+}
+
+// GetSharedThreadPool (ChunkJobs)
+//------------------------------------------------------------------------------
+/*static*/ ThreadPool * Compressor::ChunkJobs::GetSharedThreadPool()
+{
+    // Created on first use and shared by all concurrent compressions for the
+    // lifetime of the process. Helper jobs from concurrent users queue behind
+    // each other, which is fine as each caller also processes its own chunks.
+    const uint32_t numThreads = Math::Min( CPUInfo::Get().GetNumUsefulCores(), kMaxThreads );
+    if ( numThreads <= 1 )
+    {
+        return nullptr;
+    }
+    static ThreadPool sThreadPool( numThreads - 1 ); // Calling thread does work too
+    return &sThreadPool;
+}
+
+// Process (ChunkJobs)
+//------------------------------------------------------------------------------
+bool Compressor::ChunkJobs::Process( size_t firstChunk, size_t numChunks, ChunkFunc func, void * userData )
+{
+    m_Func = func;
+    m_UserData = userData;
+    m_FirstChunk = firstChunk;
+    m_NumChunks = (uint32_t)numChunks;
+    m_NextChunk.Store( 0 );
+    m_Failed.Store( false );
+
+    m_NumHelpersActive = 0;
+    m_WaitingForHelpers = false;
+
+    // Helpers which start after all chunks are taken will have nothing to do,
+    // so don't create more than could be useful
+    const uint32_t numHelpers = ( m_NumChunks > 1 ) ? Math::Min( m_MaxHelpers, m_NumChunks - 1 ) : 0;
+    if ( numHelpers > 0 )
+    {
+        {
+            MutexHolder mh( s_Mutex );
+            m_NextActive = s_Active;
+            s_Active = this;
+        }
+        for ( uint32_t i = 0; i < numHelpers; ++i )
+        {
+            m_ThreadPool->EnqueueJob( HelperJob, nullptr );
+        }
+    }
+
+    ProcessChunks();
+
+    if ( numHelpers > 0 )
+    {
+        // Stop further helpers joining, then wait only for those still
+        // working on our chunks (helpers which haven't started yet will join
+        // another caller, or find nothing to do)
+        uint32_t numHelpersActive = 0;
+        {
+            MutexHolder mh( s_Mutex );
+            ChunkJobs ** link = &s_Active;
+            while ( *link != this )
+            {
+                link = &( *link )->m_NextActive;
+            }
+            *link = m_NextActive;
+            m_NextActive = nullptr;
+            numHelpersActive = m_NumHelpersActive;
+            m_WaitingForHelpers = true;
+        }
+        for ( uint32_t i = 0; i < numHelpersActive; ++i )
+        {
+            m_HelpersDone.Wait();
+        }
+    }
+
+    return ( m_Failed.Load() == false );
+}
+
+// HelperJob (ChunkJobs)
+//------------------------------------------------------------------------------
+/*static*/ void Compressor::ChunkJobs::HelperJob( void * /*userData*/ )
+{
+    // Join the oldest caller with chunks left
+    ChunkJobs * jobs = nullptr;
+    {
+        MutexHolder mh( s_Mutex );
+        for ( ChunkJobs * active = s_Active; active; active = active->m_NextActive )
+        {
+            if ( ( active->m_NextChunk.Load() < active->m_NumChunks ) && ( active->m_Failed.Load() == false ) )
+            {
+                jobs = active;
+            }
+        }
+        if ( jobs == nullptr )
+        {
+            return; // Nothing left to do
+        }
+        ++jobs->m_NumHelpersActive;
+    }
+
+    jobs->ProcessChunks();
+
+    // Only signal a caller which is waiting for us (it may not touch jobs after)
+    bool signal = false;
+    {
+        MutexHolder mh( s_Mutex );
+        --jobs->m_NumHelpersActive;
+        signal = jobs->m_WaitingForHelpers;
+    }
+    if ( signal )
+    {
+        jobs->m_HelpersDone.Signal();
+    }
+}
+
+// ProcessChunks (ChunkJobs)
+//------------------------------------------------------------------------------
+void Compressor::ChunkJobs::ProcessChunks()
+{
+    PROFILE_FUNCTION;
+
+    for ( ;; )
+    {
+        const uint32_t index = ( m_NextChunk.Increment() - 1 );
+        if ( ( index >= m_NumChunks ) || m_Failed.Load() )
+        {
+            return;
+        }
+        if ( m_Func( m_UserData, m_FirstChunk + index ) == false )
+        {
+            m_Failed.Store( true );
+        }
+    }
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+Compressor::Compressor( bool allowFraming )
     : m_Result( nullptr )
     , m_ResultSize( 0 )
+    , m_AllowFraming( allowFraming )
 {
 }
 
@@ -50,11 +291,16 @@ Compressor::~Compressor()
     }
 
     const Header * header = (const Header *)data;
-    if ( header->m_CompressionType > eZstd )
+    if ( header->m_CompressionType == eFramed )
+    {
+        return IsValidFramedData( data, dataSize );
+    }
+    if ( header->m_CompressionType > eZstdDictionary )
     {
         return false;
     }
-    if ( ( header->m_CompressedSize + sizeof( Header ) ) != dataSize )
+    const size_t headerSize = ( header->m_CompressionType == eZstdDictionary ) ? sizeof( DictionaryHeader ) : sizeof( Header );
+    if ( ( header->m_CompressedSize + headerSize ) != dataSize )
     {
         return false;
     }
@@ -65,18 +311,105 @@ Compressor::~Compressor()
     return true;
 }
 
+// IsValidFramedData
+//------------------------------------------------------------------------------
+/*static*/ bool Compressor::IsValidFramedData( const void * data, size_t dataSize )
+{
+    if ( dataSize < sizeof( FramedHeader ) )
+    {
+        return false;
+    }
+
+    const FramedHeader * header = (const FramedHeader *)data;
+    ASSERT( header->m_CompressionType == eFramed );
+    if ( ( header->m_ChunkSize == 0 ) || ( header->m_UncompressedSize == 0 ) )
+    {
+        return false;
+    }
+    if ( header->m_CompressedSize != ( dataSize - sizeof( FramedHeader ) ) )
+    {
+        return false;
+    }
+
+    // Chunk table must fit
+    const uint64_t numChunks = GetNumChunks( *header );
+    if ( numChunks > ( header->m_CompressedSize / sizeof( ChunkHeader ) ) )
+    {
+        return false;
+    }
+
+    // Chunks must exactly fill the remaining space
+    const ChunkHeader * chunks = (const ChunkHeader *)( header + 1 );
+    uint64_t totalChunkSize = 0;
+    uint64_t remainingSize = header->m_UncompressedSize;
+    for ( uint64_t i = 0; i < numChunks; ++i )
+    {
+        const ChunkHeader & chunk = chunks[ i ];
+        const uint64_t chunkSize = Math::Min<uint64_t>( header->m_ChunkSize, remainingSize );
+        remainingSize -= chunkSize;
+        if ( chunk.m_CompressionType > eZstd )
+        {
+            return false;
+        }
+        if ( chunk.m_CompressedSize > chunkSize )
+        {
+            return false;
+        }
+        if ( ( chunk.m_CompressionType == eUncompressed ) && ( chunk.m_CompressedSize != chunkSize ) )
+        {
+            return false;
+        }
+        totalChunkSize += chunk.m_CompressedSize;
+    }
+    return ( totalChunkSize == ( header->m_CompressedSize - ( numChunks * sizeof( ChunkHeader ) ) ) );
+}
+
+// IsFramedData
+//------------------------------------------------------------------------------
+/*static*/ bool Compressor::IsFramedData( const void * data, size_t dataSize )
+{
+    return IsValidData( data, dataSize ) && ( ( (const Header *)data )->m_CompressionType == eFramed );
+}
+
 // GetUncompressedSize
 //------------------------------------------------------------------------------
-/*static*/ uint32_t Compressor::GetUncompressedSize( const void * data, size_t dataSize )
+/*static*/ uint64_t Compressor::GetUncompressedSize( const void * data, size_t dataSize )
 {
     // Only valid to call on data that is known to be compressor format
     ASSERT( IsValidData( data, dataSize ) );
     (void)dataSize;
 
     const Header * header = (const Header *)data;
+    if ( header->m_CompressionType == eFramed )
+    {
+        return ( (const FramedHeader *)data )->m_UncompressedSize;
+    }
     return header->m_UncompressedSize;
 }
 
+// GetDictionaryId
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Compressor::GetDictionaryId( const void * data, size_t dataSize )
+{
+    // Only valid to call on data that is known to be compressor format
+    ASSERT( IsValidData( data, dataSize ) );
+    (void)dataSize;
+
+    const Header * header = (const Header *)data;
+    if ( header->m_CompressionType == eZstdDictionary )
+    {
+        return ( (const DictionaryHeader *)data )->m_DictionaryId;
+    }
+    return 0;
+}
+
+// GetNumChunks
+//------------------------------------------------------------------------------
+/*static*/ uint64_t Compressor::GetNumChunks( const FramedHeader & header )
+{
+    return ( ( header.m_UncompressedSize + header.m_ChunkSize - 1 ) / header.m_ChunkSize );
+}
+
 // Compress
 //------------------------------------------------------------------------------
 bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressionLevel )
@@ -86,6 +419,13 @@ bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressi
     ASSERT( data );
     ASSERT( m_Result == nullptr );
 
+    // Large data is split into chunks
+    if ( m_AllowFraming && ( dataSize > kChunkSize ) )
+    {
+        return CompressFramed( data, dataSize, eLZ4, compressionLevel );
+    }
+    ASSERT( dataSize <= 0x7FFFFFFF ); // LZ4 limit
+
     // allocate worst case output size for LZ4
     const int worstCaseSize = LZ4_compressBound( (int)dataSize );
     ASSERT( worstCaseSize > 0 );
@@ -142,7 +482,7 @@ bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressi
 
 // Decompress
 //------------------------------------------------------------------------------
-bool Compressor::Decompress( const void * data )
+bool Compressor::Decompress( const void * data, const CompressionDictionary * dictionary )
 {
     PROFILE_FUNCTION;
 
@@ -151,6 +491,30 @@ bool Compressor::Decompress( const void * data )
 
     const Header * header = (const Header *)data;
 
+    // handle chunked data
+    if ( header->m_CompressionType == eFramed )
+    {
+        ChunkContext context;
+        context.InitForDecompression( data );
+        const size_t numChunks = context.m_ChunkOffsets.GetSize();
+
+        m_ResultSize = (size_t)context.m_UncompressedSize;
+        m_Result = ALLOC( m_ResultSize );
+        context.m_Dst = (char *)m_Result;
+
+        ChunkJobs jobs( numChunks );
+        if ( jobs.Process( 0, numChunks, DecompressChunk, &context ) )
+        {
+            return true;
+        }
+
+        // Data is corrupt
+        FREE( m_Result );
+        m_Result = nullptr;
+        m_ResultSize = 0;
+        return false;
+    }
+
     // handle uncompressed case
     if ( header->m_CompressionType == eUncompressed )
     {
@@ -160,6 +524,32 @@ bool Compressor::Decompress( const void * data )
         return true;
     }
 
+    // data compressed with a dictionary can only be decompressed with the same one
+    if ( header->m_CompressionType == eZstdDictionary )
+    {
+        const DictionaryHeader * dictionaryHeader = (const DictionaryHeader *)data;
+        if ( ( dictionary == nullptr ) || ( dictionary->GetId() != dictionaryHeader->m_DictionaryId ) )
+        {
+            return false;
+        }
+        m_Result = ALLOC( dictionaryHeader->m_UncompressedSize );
+        m_ResultSize = dictionaryHeader->m_UncompressedSize;
+        const size_t bytesDecompressed = dictionary->Decompress( m_Result,
+                                                                 m_ResultSize,
+                                                                 dictionaryHeader + 1,
+                                                                 dictionaryHeader->m_CompressedSize );
+        if ( bytesDecompressed == m_ResultSize )
+        {
+            return true;
+        }
+
+        // Data is corrupt
+        FREE( m_Result );
+        m_Result = nullptr;
+        m_ResultSize = 0;
+        return false;
+    }
+
     // uncompressed size
     const uint32_t uncompressedSize = header->m_UncompressedSize;
     m_Result = ALLOC( uncompressedSize );
@@ -206,13 +596,21 @@ bool Compressor::Decompress( const void * data )
 //------------------------------------------------------------------------------
 bool Compressor::CompressZstd( const void * data,
                                size_t dataSize,
-                               int32_t compressionLevel )
+                               int32_t compressionLevel,
+                               const CompressionDictionary * dictionary )
 {
     PROFILE_FUNCTION;
 
     ASSERT( data );
     ASSERT( m_Result == nullptr );
 
+    // Large data is split into chunks
+    if ( m_AllowFraming && ( dataSize > kChunkSize ) )
+    {
+        return CompressFramed( data, dataSize, eZstd, compressionLevel );
+    }
+    ASSERT( dataSize <= 0xFFFFFFFF ); // Header limit
+
     // allocate worst case output size for LZ4
     const size_t worstCaseSize = ZSTD_compressBound( dataSize );
     UniquePtr<char, FreeDeletor> output( (char *)ALLOC( worstCaseSize ) );
@@ -220,7 +618,15 @@ bool Compressor::CompressZstd( const void * data,
     size_t compressedSize;
 
     // do compression
-    if ( compressionLevel > 0 )
+    if ( ( compressionLevel > 0 ) && dictionary )
+    {
+        compressedSize = dictionary->Compress( output.Get(), worstCaseSize, data, dataSize, compressionLevel );
+        if ( compressedSize == 0 )
+        {
+            compressedSize = dataSize; // Act as if compression achieved nothing
+        }
+    }
+    else if ( compressionLevel > 0 )
     {
         compressedSize = ZSTD_compress( output.Get(),
                                         worstCaseSize,
@@ -236,29 +642,231 @@ bool Compressor::CompressZstd( const void * data,
 
     // did the compression yield any benefit?
     const bool compressed = ( compressedSize < dataSize );
+    const bool usedDictionary = ( compressed && dictionary );
+    const size_t headerSize = usedDictionary ? sizeof( DictionaryHeader ) : sizeof( Header );
 
     if ( compressed )
     {
         // trim memory usage to compressed size
-        m_Result = ALLOC( compressedSize + sizeof( Header ) );
-        memcpy( (char *)m_Result + sizeof( Header ), output.Get(), (size_t)compressedSize );
-        m_ResultSize = compressedSize + sizeof( Header );
+        m_Result = ALLOC( compressedSize + headerSize );
+        memcpy( (char *)m_Result + headerSize, output.Get(), (size_t)compressedSize );
+        m_ResultSize = compressedSize + headerSize;
     }
     else
     {
         // compression failed, so just copy the old data
-        m_Result = ALLOC( dataSize + sizeof( Header ) );
-        memcpy( (char *)m_Result + sizeof( Header ), data, dataSize );
-        m_ResultSize = dataSize + sizeof( Header );
+        m_Result = ALLOC( dataSize + headerSize );
+        memcpy( (char *)m_Result + headerSize, data, dataSize );
+        m_ResultSize = dataSize + headerSize;
     }
 
     // fill out header
     Header * header = (Header *)m_Result;
-    header->m_CompressionType = compressed ? eZstd : eUncompressed;   // compression type
+    header->m_CompressionType = usedDictionary ? eZstdDictionary : ( compressed ? eZstd : eUncompressed );   // compression type
     header->m_UncompressedSize = (uint32_t)dataSize;    // input size
     header->m_CompressedSize = compressed ? (uint32_t)compressedSize : (uint32_t)dataSize; // output size
+    if ( usedDictionary )
+    {
+        ( (DictionaryHeader *)m_Result )->m_DictionaryId = dictionary->GetId();
+    }
 
     return compressed;
 }
 
+// DecompressToFile
+//------------------------------------------------------------------------------
+bool Compressor::DecompressToFile( const void * data, FileStream & file, const CompressionDictionary * dictionary )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( data );
+    ASSERT( m_Result == nullptr );
+
+    m_DataCorrupt = false;
+    const Header * header = (const Header *)data;
+
+    // Uncompressed data can be written directly
+    if ( header->m_CompressionType == eUncompressed )
+    {
+        const void * uncompressedData = ( (const char *)data + sizeof( Header ) );
+        return ( file.WriteBuffer( uncompressedData, header->m_UncompressedSize ) == header->m_UncompressedSize );
+    }
+
+    // Single block formats must be fully decompressed
+    if ( header->m_CompressionType != eFramed )
+    {
+        if ( Decompress( data, dictionary ) == false )
+        {
+            m_DataCorrupt = true;
+            return false;
+        }
+        const bool ok = ( file.WriteBuffer( m_Result, m_ResultSize ) == m_ResultSize );
+        FREE( m_Result );
+        m_Result = nullptr;
+        m_ResultSize = 0;
+        return ok;
+    }
+
+    ChunkContext context;
+    context.InitForDecompression( data );
+    const size_t numChunks = context.m_ChunkOffsets.GetSize();
+
+    // Decompress a window of chunks at a time (enough to keep all threads busy)
+    // and write them out in order
+    ChunkJobs jobs( numChunks );
+    const size_t windowChunks = Math::Min<size_t>( numChunks, jobs.GetNumThreads() * 2 );
+    UniquePtr<char, FreeDeletor> window( (char *)ALLOC( windowChunks * context.m_ChunkSize ) );
+    context.m_Dst = window.Get();
+
+    for ( size_t firstChunk = 0; firstChunk < numChunks; firstChunk += windowChunks )
+    {
+        const size_t numWindowChunks = Math::Min( windowChunks, numChunks - firstChunk );
+        context.m_DstFirstChunk = firstChunk;
+        if ( jobs.Process( firstChunk, numWindowChunks, DecompressChunk, &context ) == false )
+        {
+            m_DataCorrupt = true;
+            return false;
+        }
+
+        const uint64_t windowStart = ( (uint64_t)firstChunk * context.m_ChunkSize );
+        const uint64_t windowSize = Math::Min<uint64_t>( (uint64_t)numWindowChunks * context.m_ChunkSize,
+                                                         context.m_UncompressedSize - windowStart );
+        if ( file.WriteBuffer( window.Get(), windowSize ) != windowSize )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// CompressFramed
+//------------------------------------------------------------------------------
+bool Compressor::CompressFramed( const void * data, size_t dataSize, CompressionType type, int32_t compressionLevel )
+{
+    PROFILE_FUNCTION;
+
+    const uint64_t numChunks = ( ( (uint64_t)dataSize + kChunkSize - 1 ) / kChunkSize );
+
+    // Each chunk is compressed into its own worst case sized slot
+    const size_t slotSize = ( type == eZstd ) ? ZSTD_compressBound( kChunkSize )
+                                              : (size_t)LZ4_compressBound( (int)kChunkSize );
+    UniquePtr<char, FreeDeletor> slots( (char *)ALLOC( (size_t)numChunks * slotSize ) );
+    Array<ChunkHeader> chunks;
+    chunks.SetSize( (size_t)numChunks );
+
+    ChunkContext context;
+    context.m_Type = type;
+    context.m_CompressionLevel = compressionLevel;
+    context.m_ChunkSize = kChunkSize;
+    context.m_UncompressedSize = dataSize;
+    context.m_Src = (const char *)data;
+    context.m_Dst = slots.Get();
+    context.m_DstSlotSize = slotSize;
+    context.m_Chunks = chunks.Begin();
+
+    ChunkJobs jobs( numChunks );
+    VERIFY( jobs.Process( 0, (size_t)numChunks, CompressChunk, &context ) ); // Compression can't fail
+
+    // Gather chunks into final result, trimming memory usage
+    uint64_t compressedSize = ( numChunks * sizeof( ChunkHeader ) );
+    for ( const ChunkHeader & chunk : chunks )
+    {
+        compressedSize += chunk.m_CompressedSize;
+    }
+    m_ResultSize = (size_t)( sizeof( FramedHeader ) + compressedSize );
+    m_Result = ALLOC( m_ResultSize );
+
+    FramedHeader * header = (FramedHeader *)m_Result;
+    header->m_CompressionType = eFramed;
+    header->m_ChunkSize = kChunkSize;
+    header->m_UncompressedSize = dataSize;
+    header->m_CompressedSize = compressedSize;
+    memcpy( header + 1, chunks.Begin(), (size_t)numChunks * sizeof( ChunkHeader ) );
+
+    char * dst = ( (char *)( header + 1 ) + ( numChunks * sizeof( ChunkHeader ) ) );
+    for ( size_t i = 0; i < numChunks; ++i )
+    {
+        const ChunkHeader & chunk = chunks[ i ];
+        const char * src = ( chunk.m_CompressionType == eUncompressed )
+                         ? ( (const char *)data + ( i * kChunkSize ) ) // Stored as-is
+                         : ( slots.Get() + ( i * slotSize ) );
+        memcpy( dst, src, chunk.m_CompressedSize );
+        dst += chunk.m_CompressedSize;
+    }
+
+    // did the compression yield any benefit?
+    return ( compressedSize < dataSize );
+}
+
+// CompressChunk
+//------------------------------------------------------------------------------
+/*static*/ bool Compressor::CompressChunk( void * userData, size_t chunkIndex )
+{
+    const ChunkContext & context = *static_cast<const ChunkContext *>( userData );
+    const size_t srcSize = context.GetChunkSize( chunkIndex );
+    const char * src = ( context.m_Src + ( (uint64_t)chunkIndex * context.m_ChunkSize ) );
+    char * dst = ( context.m_Dst + ( chunkIndex * context.m_DstSlotSize ) );
+
+    // Compression levels are interpreted as per Compress and CompressZstd
+    size_t compressedSize = srcSize; // Act as if compression achieved nothing
+    if ( context.m_Type == eZstd )
+    {
+        if ( context.m_CompressionLevel > 0 )
+        {
+            compressedSize = ZSTD_compress( dst, context.m_DstSlotSize, src, srcSize, context.m_CompressionLevel );
+            if ( ZSTD_isError( compressedSize ) )
+            {
+                compressedSize = srcSize;
+            }
+        }
+    }
+    else if ( context.m_CompressionLevel > 0 )
+    {
+        compressedSize = (size_t)LZ4_compress_HC( src, dst, (int)srcSize, (int)context.m_DstSlotSize, context.m_CompressionLevel );
+    }
+    else if ( context.m_CompressionLevel < 0 )
+    {
+        const int32_t acceleration = ( 0 - context.m_CompressionLevel );
+        compressedSize = (size_t)LZ4_compress_fast( src, dst, (int)srcSize, (int)context.m_DstSlotSize, acceleration );
+    }
+
+    // Chunks which don't benefit from compression are stored as-is
+    ChunkHeader & chunk = context.m_Chunks[ chunkIndex ];
+    const bool compressed = ( compressedSize > 0 ) && ( compressedSize < srcSize );
+    chunk.m_CompressionType = compressed ? context.m_Type : eUncompressed;
+    chunk.m_CompressedSize = compressed ? (uint32_t)compressedSize : (uint32_t)srcSize;
+    return true;
+}
+
+// DecompressChunk
+//------------------------------------------------------------------------------
+/*static*/ bool Compressor::DecompressChunk( void * userData, size_t chunkIndex )
+{
+    const ChunkContext & context = *static_cast<const ChunkContext *>( userData );
+    const ChunkHeader & chunk = context.m_Chunks[ chunkIndex ];
+    const size_t dstSize = context.GetChunkSize( chunkIndex );
+    const char * src = ( context.m_Src + context.m_ChunkOffsets[ chunkIndex ] );
+    char * dst = ( context.m_Dst + ( ( chunkIndex - context.m_DstFirstChunk ) * context.m_ChunkSize ) );
+
+    switch ( chunk.m_CompressionType )
+    {
+        case eUncompressed:
+        {
+            memcpy( dst, src, dstSize );
+            return true;
+        }
+        case eLZ4:
+        {
+            const int bytesDecompressed = LZ4_decompress_safe( src, dst, (int)chunk.m_CompressedSize, (int)dstSize );
+            return ( bytesDecompressed == (int)dstSize );
+        }
+        case eZstd:
+        {
+            const size_t bytesDecompressed = ZSTD_decompress( dst, dstSize, src, chunk.m_CompressedSize );
+            return ( bytesDecompressed == dstSize );
+        }
+        default: return false;
+    }
+}
+
 //------------------------------------------------------------------------------
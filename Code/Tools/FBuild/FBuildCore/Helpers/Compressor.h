@@ -6,16 +6,27 @@
 //------------------------------------------------------------------------------
 #include "Core/Env/Types.h"
 
+// Forward Declarations
+//------------------------------------------------------------------------------
+class CompressionDictionary;
+class FileStream;
+
 // Compressor
+//  - Data larger than kChunkSize is split into independently compressed chunks
+//    with 64-bit sizes ("framed"), which are compressed and decompressed in
+//    parallel on a shared, process lifetime pool of threads
 //------------------------------------------------------------------------------
 class Compressor
 {
 public:
-    explicit Compressor();
+    // allowFraming: Receivers prior to protocol 22.7 can't read framed data
+    explicit Compressor( bool allowFraming = true );
     ~Compressor();
 
     static bool IsValidData( const void * data, size_t dataSize );
-    static uint32_t GetUncompressedSize( const void * data, size_t dataSize );
+    static bool IsFramedData( const void * data, size_t dataSize );
+    static uint64_t GetUncompressedSize( const void * data, size_t dataSize );
+    static uint32_t GetDictionaryId( const void * data, size_t dataSize ); // 0 if no dictionary is needed
 
     // compressionLevel:
     //   < 0 : use LZ4, with values directly mapping to "acceleration level"
@@ -24,10 +35,21 @@ public:
     bool Compress( const void * data, size_t dataSize, int32_t compressionLevel = -1 ); // -1 = default LZ4 compression level
 
     // Zstd
-    bool CompressZstd( const void * data, size_t dataSize, int32_t compressionLevel = -1 ); // -1 = default Zstd compression level
+    //  - An optional dictionary is used for data which is not framed, and must
+    //    then also be supplied to decompress (receivers prior to protocol 22.8
+    //    can't read it)
+    bool CompressZstd( const void * data,
+                       size_t dataSize,
+                       int32_t compressionLevel = -1, // -1 = default Zstd compression level
+                       const CompressionDictionary * dictionary = nullptr );
 
     // Decompress (handled all formats including uncompressed)
-    bool Decompress( const void * data );
+    bool Decompress( const void * data, const CompressionDictionary * dictionary = nullptr );
+
+    // Decompress directly to a file, holding only a few chunks in memory at a time
+    //  - On failure, IsDataCorrupt() distinguishes bad data from a write error
+    bool DecompressToFile( const void * data, FileStream & file, const CompressionDictionary * dictionary = nullptr );
+    bool IsDataCorrupt() const { return m_DataCorrupt; }
 
     const void * GetResult() const { return m_Result; }
     size_t GetResultSize() const { return m_ResultSize; }
@@ -40,12 +62,17 @@ public:
         return r;
     }
 
+    inline static const uint32_t kChunkSize = ( 4 * 1024 * 1024 );
+    inline static const uint32_t kMaxThreads = 16;
+
 private:
     enum CompressionType : uint32_t
     {
         eUncompressed = 0,
         eLZ4 = 1,
         eZstd = 2,
+        eFramed = 3,
+        eZstdDictionary = 4,
     };
     struct Header
     {
@@ -53,8 +80,39 @@ private:
         uint32_t m_UncompressedSize;
         uint32_t m_CompressedSize;
     };
+    struct DictionaryHeader // Header, plus the id of the required dictionary
+    {
+        uint32_t m_CompressionType; // eZstdDictionary
+        uint32_t m_UncompressedSize;
+        uint32_t m_CompressedSize;
+        uint32_t m_DictionaryId;
+    };
+    struct FramedHeader // Followed by a ChunkHeader per chunk, then chunk data
+    {
+        uint32_t m_CompressionType; // eFramed
+        uint32_t m_ChunkSize;
+        uint64_t m_UncompressedSize;
+        uint64_t m_CompressedSize; // Chunk table and chunk data
+    };
+    struct ChunkHeader
+    {
+        uint32_t m_CompressionType;
+        uint32_t m_CompressedSize;
+    };
+
+    class ChunkJobs;
+    class ChunkContext;
+
+    bool CompressFramed( const void * data, size_t dataSize, CompressionType type, int32_t compressionLevel );
+    static bool CompressChunk( void * userData, size_t chunkIndex );
+    static bool DecompressChunk( void * userData, size_t chunkIndex );
+    static uint64_t GetNumChunks( const FramedHeader & header );
+    static bool IsValidFramedData( const void * data, size_t dataSize );
+
     void * m_Result;
     size_t m_ResultSize;
+    bool m_AllowFraming;
+    bool m_DataCorrupt = false;
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,78 @@
+// ContentChunker
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ContentChunker.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Math/Conversions.h"
+
+// GearTable
+//------------------------------------------------------------------------------
+class GearTable
+{
+public:
+    GearTable()
+    {
+        // splitmix64 sequence, so the table (and chunk boundaries) are the same
+        // on all machines
+        uint64_t x = 0x9E3779B97F4A7C15ULL;
+        for ( uint64_t & entry : m_Table )
+        {
+            x += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = x;
+            z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+            z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+            entry = z ^ ( z >> 31 );
+        }
+    }
+
+    uint64_t m_Table[ 256 ];
+};
+static const GearTable sGearTable;
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+ContentChunker::ContentChunker( uint32_t minSize, uint32_t averageSize, uint32_t maxSize )
+    : m_MinSize( minSize )
+    , m_MaxSize( maxSize )
+    , m_BoundaryMask( 0 )
+{
+    ASSERT( Math::IsPowerOf2( averageSize ) );
+    ASSERT( ( minSize > 0 ) && ( minSize <= averageSize ) && ( averageSize <= maxSize ) );
+
+    // A boundary occurs where the chosen bits of the hash are all zero. The top
+    // bits are used as they are influenced by the most preceding bytes.
+    uint32_t numBits = 0;
+    while ( ( 1u << numBits ) < averageSize )
+    {
+        ++numBits;
+    }
+    m_BoundaryMask = ( numBits > 0 ) ? ( ~0ULL << ( 64 - numBits ) ) : 0;
+}
+
+// GetChunkSize
+//------------------------------------------------------------------------------
+uint32_t ContentChunker::GetChunkSize( const void * data, size_t dataSize ) const
+{
+    const uint8_t * bytes = static_cast<const uint8_t *>( data );
+    const uint32_t size = (uint32_t)Math::Min<size_t>( dataSize, m_MaxSize );
+
+    // Each byte is shifted out of the hash after 64 more bytes, so bytes before
+    // that don't influence the first possible boundary
+    const uint32_t start = ( m_MinSize > 64 ) ? ( m_MinSize - 64 ) : 0;
+    uint64_t hash = 0;
+    for ( uint32_t i = start; i < size; ++i )
+    {
+        hash = ( hash << 1 ) + sGearTable.m_Table[ bytes[ i ] ];
+        if ( ( ( i + 1 ) >= m_MinSize ) && ( ( hash & m_BoundaryMask ) == 0 ) )
+        {
+            return ( i + 1 );
+        }
+    }
+    return size; // Max size, or end of data
+}
+
+//------------------------------------------------------------------------------
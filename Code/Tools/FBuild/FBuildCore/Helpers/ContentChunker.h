@@ -0,0 +1,30 @@
+// ContentChunker
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// ContentChunker
+//  - Splits data into chunks with boundaries chosen by content (using a "gear"
+//    rolling hash), so that an insertion or removal only changes the chunks
+//    around it, and identical content in different data produces identical
+//    chunks
+//------------------------------------------------------------------------------
+class ContentChunker
+{
+public:
+    // averageSize must be a power of 2
+    explicit ContentChunker( uint32_t minSize, uint32_t averageSize, uint32_t maxSize );
+
+    // Size of the chunk at the start of the data
+    uint32_t GetChunkSize( const void * data, size_t dataSize ) const;
+
+private:
+    uint32_t m_MinSize;
+    uint32_t m_MaxSize;
+    uint64_t m_BoundaryMask;
+};
+
+//------------------------------------------------------------------------------
@@ -39,6 +39,18 @@ FBuildStats::FBuildStats()
     , m_TotalBuildTime( 0.0f )
     , m_TotalLocalCPUTimeMS( 0 )
     , m_TotalRemoteCPUTimeMS( 0 )
+    , m_BuildPassTime( 0.0f )
+    , m_NumCacheStoresQueued( 0 )
+    , m_NumCacheStoresQueueFull( 0 )
+    , m_CacheStoreQueueMaxDepth( 0 )
+    , m_CacheStoreQueueTimeMS( 0 )
+    , m_CacheStoreFlushTimeMS( 0 )
+    , m_NumCacheProbeKeyed( 0 )
+    , m_NumCacheProbeHits( 0 )
+    , m_NumCacheProbeMisses( 0 )
+    , m_NumCacheProbeFetched( 0 )
+    , m_CacheTiered( false )
+    , m_CachePromotions( 0 )
     , m_RootNode( nullptr )
 {
     m_NodesByTime.SetCapacity( 100 * 1000 );
@@ -202,6 +214,14 @@ void FBuildStats::OutputSummary( const FBuildOptions & options ) const
             output.AppendFormat( " - Misses     : %u (%u Light)\n",
                                  m_Totals.m_NumCacheMisses,
                                  m_Totals.m_NumLightCacheMisses );
+            if ( m_NumCacheProbeKeyed > 0 )
+            {
+                output.AppendFormat( " - Probed     : %u (Hits: %u - Misses: %u - Prefetched: %u)\n",
+                                     m_NumCacheProbeKeyed,
+                                     m_NumCacheProbeHits,
+                                     m_NumCacheProbeMisses,
+                                     m_NumCacheProbeFetched );
+            }
         }
         else
         {
@@ -213,11 +233,44 @@ void FBuildStats::OutputSummary( const FBuildOptions & options ) const
             output.AppendFormat( " - Stores     : %u (%u Light)\n",
                                  m_Totals.m_NumCacheStores,
                                  m_Totals.m_NumLightCacheStores );
+            if ( ( m_NumCacheStoresQueued + m_NumCacheStoresQueueFull ) > 0 )
+            {
+                AStackString storeTime;
+                AStackString flushTime;
+                FormatTime( (float)( (double)m_CacheStoreQueueTimeMS / (double)1000 ), storeTime );
+                FormatTime( (float)( (double)m_CacheStoreFlushTimeMS / (double)1000 ), flushTime );
+                output.AppendFormat( " - Queued     : %u (%u Queue Full) (Max Depth: %u) (Store: %s - Flush: %s)\n",
+                                     m_NumCacheStoresQueued,
+                                     m_NumCacheStoresQueueFull,
+                                     m_CacheStoreQueueMaxDepth,
+                                     storeTime.Get(),
+                                     flushTime.Get() );
+            }
         }
         else
         {
             output.AppendFormat( " - Stores     : DISABLED\n" );
         }
+        if ( m_CacheTiered )
+        {
+            const char * const tierNames[] = { " - L1 (Local) :", " - L2 (Shared):" };
+            for ( uint32_t tier = 0; tier < 2; ++tier )
+            {
+                const CacheTierStats & tierStats = m_CacheTiers[ tier ];
+                AStackString retrieveTime;
+                AStackString storeTime;
+                FormatTime( (float)( (double)tierStats.m_RetrieveTimeMS / (double)1000 ), retrieveTime );
+                FormatTime( (float)( (double)tierStats.m_StoreTimeMS / (double)1000 ), storeTime );
+                output.AppendFormat( "%s Hits %u/%u (Retrieve: %s) - Stores %u (Store: %s)\n",
+                                     tierNames[ tier ],
+                                     tierStats.m_Hits,
+                                     tierStats.m_Lookups,
+                                     retrieveTime.Get(),
+                                     tierStats.m_Stores,
+                                     storeTime.Get() );
+            }
+            output.AppendFormat( " - Promoted   : %u\n", m_CachePromotions );
+        }
     }
 
     // Time totals
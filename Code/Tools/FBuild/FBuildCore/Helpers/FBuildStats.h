@@ -33,6 +33,34 @@ public:
     float m_TotalBuildTime; // Total time taken
     uint32_t m_TotalLocalCPUTimeMS; // Total CPU time on local host
     uint32_t m_TotalRemoteCPUTimeMS; // Total CPU time on remote workers
+    float m_BuildPassTime; // Main thread time progressing the graph (see NodeGraph::DoBuildPass)
+
+    // cache stores in the background (see CachePublishQueue)
+    uint32_t m_NumCacheStoresQueued; // Stored in the background
+    uint32_t m_NumCacheStoresQueueFull; // Stored synchronously because queue was full
+    uint32_t m_CacheStoreQueueMaxDepth; // Max entries waiting to be stored
+    uint32_t m_CacheStoreQueueTimeMS; // Total time storing in the background
+    uint32_t m_CacheStoreFlushTimeMS; // Time waiting for stores to complete at build end
+
+    // cache lookups ahead of compilation (see CacheProbe)
+    uint32_t m_NumCacheProbeKeyed; // Keys calculated before a worker needed them
+    uint32_t m_NumCacheProbeHits; // Found to exist
+    uint32_t m_NumCacheProbeMisses; // Found not to exist
+    uint32_t m_NumCacheProbeFetched; // Retrieved before a worker needed them
+
+    // cache tiers (see TieredCache)
+    class CacheTierStats
+    {
+    public:
+        uint32_t m_Lookups = 0;
+        uint32_t m_Hits = 0;
+        uint64_t m_RetrieveTimeMS = 0; // Total, including misses
+        uint32_t m_Stores = 0; // Including promotions
+        uint64_t m_StoreTimeMS = 0;
+    };
+    bool m_CacheTiered;
+    CacheTierStats m_CacheTiers[ 2 ]; // L1 (local), L2 (shared)
+    uint32_t m_CachePromotions; // Entries copied from L2 to L1
 
     // after the build it complete, accumulate all the stats
     void GatherPostBuildStatistics( const NodeGraph & nodeGraph, Node * node );
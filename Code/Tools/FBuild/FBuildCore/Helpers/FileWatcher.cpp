@@ -0,0 +1,722 @@
+// FileWatcher - Long lived process recording changes to files used by builds
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FileWatcher.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Env/ErrorFormat.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Process.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+
+// system
+#include <string.h> // for memcpy
+#if defined( __LINUX__ )
+    #include <errno.h>
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+// Defines
+//------------------------------------------------------------------------------
+#define FILEWATCHER_SYNC_FILE "sync"
+#define FILEWATCHER_DIRS_FILE "dirs"
+#define FILEWATCHER_DIRS_TMP_FILE "dirs.tmp"
+
+// Helpers
+//------------------------------------------------------------------------------
+namespace
+{
+    const uint32_t kSharedMemorySize = ( sizeof( FileWatcherLog ) + FileWatcherLog::kLogSize );
+    const uint32_t kEntryHeaderSize = ( sizeof( uint8_t ) + sizeof( uint16_t ) );
+#if defined( __LINUX__ )
+    const uint32_t kWatchMask = ( IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                                  IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR );
+
+    bool IsInSortedList( const Array<AString> & sortedList, const AString & item )
+    {
+        size_t low = 0;
+        size_t high = sortedList.GetSize();
+        while ( low < high )
+        {
+            const size_t mid = ( low + high ) / 2;
+            const int32_t result = sortedList[ mid ].Compare( item );
+            if ( result == 0 )
+            {
+                return true;
+            }
+            if ( result < 0 )
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return false;
+    }
+#endif
+
+    // Readers must not see a log overwritten by a reset as being unchanged
+    inline void FullMemoryBarrier()
+    {
+#if defined( __WINDOWS__ )
+        MemoryBarrier();
+#else
+        __atomic_thread_fence( __ATOMIC_SEQ_CST );
+#endif
+    }
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+FileWatcher::FileWatcher() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+FileWatcher::~FileWatcher()
+{
+#if defined( __LINUX__ )
+    if ( m_INotifyFD != -1 )
+    {
+        close( m_INotifyFD );
+    }
+    if ( m_Header )
+    {
+        // Builds in progress must not trust anything logged so far
+        AtomicInc( &m_Header->m_Generation );
+    }
+    FDELETE m_InstanceMutex;
+#endif
+}
+
+// GetInstanceName
+//------------------------------------------------------------------------------
+/*static*/ void FileWatcher::GetInstanceName( const AString & workingDir,
+                                              const AString & nodeGraphDBFile,
+                                              AString & outName )
+{
+    AStackString fullPath;
+    if ( PathUtils::IsFullPath( nodeGraphDBFile ) == false )
+    {
+        fullPath = workingDir;
+        PathUtils::EnsureTrailingSlash( fullPath );
+    }
+    fullPath += nodeGraphDBFile;
+
+    // Short enough to be a portable SharedMemory name
+    outName.Format( "fbwatch_%016" PRIx64, xxHash3::Calc64( fullPath ) );
+}
+
+// GetControlDir
+//------------------------------------------------------------------------------
+/*static*/ bool FileWatcher::GetControlDir( const AString & instanceName, AString & outDir )
+{
+    if ( FBuild::GetTempDir( outDir ) == false )
+    {
+        return false;
+    }
+    outDir += instanceName;
+    outDir += NATIVE_SLASH;
+    return true;
+}
+
+// IsSupported
+//------------------------------------------------------------------------------
+/*static*/ bool FileWatcher::IsSupported()
+{
+#if defined( __LINUX__ )
+    return true;
+#else
+    return false; // inotify only - see FileWatcher.h
+#endif
+}
+
+// Init
+//------------------------------------------------------------------------------
+bool FileWatcher::Init( const AString & instanceName )
+{
+#if defined( __LINUX__ )
+    // Only one watcher per DB
+    m_InstanceMutex = FNEW( SystemMutex( instanceName.Get() ) );
+    if ( m_InstanceMutex->TryLock() == false )
+    {
+        FLOG_ERROR( "FileWatcher is already running for this DB (%s)", instanceName.Get() );
+        return false;
+    }
+
+    // Private dir, used by builds to communicate with the watcher
+    if ( ( GetControlDir( instanceName, m_ControlDir ) == false ) ||
+         ( FileIO::EnsurePathExists( m_ControlDir ) == false ) )
+    {
+        FLOG_ERROR( "Failed to create FileWatcher dir '%s'. Error: %s", m_ControlDir.Get(), LAST_ERROR_STR );
+        return false;
+    }
+
+    // Log shared with builds
+    m_SharedMemory.Create( instanceName.Get(), kSharedMemorySize );
+    if ( ( m_SharedMemory.GetPtr() == nullptr ) || ( m_SharedMemory.GetPtr() == MAP_FAILED ) )
+    {
+        FLOG_ERROR( "Failed to create FileWatcher shared memory. Error: %s", LAST_ERROR_STR );
+        return false;
+    }
+    m_Header = static_cast<FileWatcherLog *>( m_SharedMemory.GetPtr() );
+    m_Log = reinterpret_cast<char *>( m_Header + 1 );
+
+    // Tokens saved against a previous watcher must not be trusted
+    const uint64_t seed[ 2 ] = { static_cast<uint64_t>( Timer::GetNow() ), Process::GetCurrentId() };
+    m_Header->m_Generation = xxHash3::Calc64( seed, sizeof( seed ) );
+    m_Header->m_Size = 0;
+    m_Header->m_SyncRequest = 0;
+    m_Header->m_SyncAck = 0;
+    m_Header->m_DirsHash = 0;
+    m_Header->m_Version = FileWatcherLog::kVersion;
+    AtomicStoreRelease( &m_Header->m_Magic, FileWatcherLog::kMagic ); // Publish last
+
+    m_INotifyFD = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if ( m_INotifyFD == -1 )
+    {
+        FLOG_ERROR( "Failed to initialize inotify. Error: %s", LAST_ERROR_STR );
+        return false;
+    }
+    m_ControlDirWD = inotify_add_watch( m_INotifyFD, m_ControlDir.Get(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF );
+    if ( m_ControlDirWD == -1 )
+    {
+        FLOG_ERROR( "Failed to watch '%s'. Error: %s", m_ControlDir.Get(), LAST_ERROR_STR );
+        return false;
+    }
+
+    // Directories from the last build (if any)
+    LoadWatchedDirs();
+    Reset(); // Nothing logged so far is of interest to anyone
+
+    FLOG_OUTPUT( "FileWatcher: Watching %u directories for '%s'\n", m_NumWatches, instanceName.Get() );
+    return true;
+#else
+    (void)instanceName;
+    FLOG_ERROR( "FileWatcher is not supported on this platform" );
+    return false;
+#endif
+}
+
+// Update
+//------------------------------------------------------------------------------
+void FileWatcher::Update( uint32_t timeoutMS )
+{
+#if defined( __LINUX__ )
+    pollfd pfd;
+    pfd.fd = m_INotifyFD;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if ( poll( &pfd, 1, static_cast<int>( timeoutMS ) ) <= 0 )
+    {
+        return; // Timeout or interrupted
+    }
+
+    alignas( inotify_event ) char buffer[ 4096 ]; // Modest, as may be called on a thread with a small stack
+    for ( ;; )
+    {
+        const ssize_t len = read( m_INotifyFD, buffer, sizeof( buffer ) );
+        if ( len <= 0 )
+        {
+            return; // Nothing left to read
+        }
+        const char * pos = buffer;
+        const char * const end = ( buffer + len );
+        while ( pos < end )
+        {
+            const inotify_event * event = reinterpret_cast<const inotify_event *>( pos );
+            HandleEvent( event->wd, event->mask, ( event->len > 0 ) ? event->name : nullptr );
+            pos += ( sizeof( inotify_event ) + event->len );
+        }
+    }
+#else
+    Thread::Sleep( timeoutMS );
+#endif
+}
+
+#if defined( __LINUX__ )
+// Reset
+//------------------------------------------------------------------------------
+void FileWatcher::Reset()
+{
+    // Changing the generation invalidates all tokens, so the log can be reused
+    AtomicInc( &m_Header->m_Generation );
+    AtomicStoreRelease( &m_Header->m_Size, static_cast<uint64_t>( 0 ) );
+    m_LastEntry.Clear();
+}
+
+// Log
+//------------------------------------------------------------------------------
+void FileWatcher::Log( FileWatcherLog::EntryType type, const AString & path )
+{
+    // Editors often generate several events per save
+    if ( path == m_LastEntry )
+    {
+        return;
+    }
+
+    const uint32_t len = path.GetLength();
+    if ( len > 0xFFFF )
+    {
+        Reset(); // Can't be logged, so nothing can be trusted
+        return;
+    }
+
+    uint64_t size = m_Header->m_Size;
+    const uint32_t entrySize = ( kEntryHeaderSize + len );
+    if ( ( size + entrySize ) > FileWatcherLog::kLogSize )
+    {
+        // Builds with a token from before now will check all files
+        Reset();
+        size = 0;
+    }
+
+    char * dst = ( m_Log + size );
+    const uint16_t len16 = static_cast<uint16_t>( len );
+    dst[ 0 ] = static_cast<char>( type );
+    memcpy( dst + 1, &len16, sizeof( uint16_t ) );
+    memcpy( dst + kEntryHeaderSize, path.Get(), len );
+    AtomicStoreRelease( &m_Header->m_Size, size + entrySize ); // Publish entry
+
+    m_LastEntry = path;
+}
+
+// LoadWatchedDirs
+//------------------------------------------------------------------------------
+void FileWatcher::LoadWatchedDirs()
+{
+    AStackString dirsFile( m_ControlDir );
+    dirsFile += FILEWATCHER_DIRS_FILE;
+    FileStream f;
+    if ( f.Open( dirsFile.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return; // No build has told us what to watch yet
+    }
+    AString contents;
+    contents.SetLength( static_cast<uint32_t>( f.GetFileSize() ) );
+    if ( f.ReadBuffer( contents.Get(), contents.GetLength() ) != contents.GetLength() )
+    {
+        return;
+    }
+
+    Array<AString> dirs;
+    contents.Tokenize( dirs, '\n' );
+    dirs.Sort();
+
+    // Stop watching dirs no longer used by builds, so they stop reporting changes
+    // and watches don't accumulate
+    for ( const AString & dir : m_WatchedDirs )
+    {
+        if ( IsInSortedList( dirs, dir ) == false )
+        {
+            RemoveWatch( dir );
+        }
+    }
+    for ( const AString & dir : m_ParentDirs )
+    {
+        if ( IsInSortedList( dirs, dir ) == false )
+        {
+            RemoveWatch( dir ); // Re-added by RefreshPendingDirs if still needed
+        }
+    }
+    m_ParentDirs.Clear();
+    for ( size_t i = 0; i < m_PendingDirs.GetSize(); )
+    {
+        if ( IsInSortedList( dirs, m_PendingDirs[ i ] ) == false )
+        {
+            m_PendingDirs.EraseIndex( i );
+            continue;
+        }
+        ++i;
+    }
+    for ( size_t i = 0; i < m_UnwatchableDirs.GetSize(); )
+    {
+        if ( IsInSortedList( dirs, m_UnwatchableDirs[ i ] ) == false )
+        {
+            m_UnwatchableDirs.EraseIndex( i );
+            continue;
+        }
+        ++i;
+    }
+
+    m_WatchedDirs = Move( dirs );
+    for ( const AString & dir : m_WatchedDirs )
+    {
+        AddWatch( dir );
+    }
+    RefreshPendingDirs();
+
+    // Let builds know what we're watching, so a restarted watcher is re-told
+    AtomicStoreRelease( &m_Header->m_DirsHash, xxHash3::Calc64( contents.Get(), contents.GetLength() ) );
+}
+
+// AddWatch
+//------------------------------------------------------------------------------
+void FileWatcher::AddWatch( const AString & dir )
+{
+    const int wd = inotify_add_watch( m_INotifyFD, dir.Get(), kWatchMask );
+    if ( wd < 0 )
+    {
+        if ( ( errno == ENOENT ) || ( errno == ENOTDIR ) )
+        {
+            // Watched once created (outputs of other nodes etc.)
+            if ( m_PendingDirs.Find( dir ) == nullptr )
+            {
+                m_PendingDirs.Append( dir );
+            }
+        }
+        else if ( m_UnwatchableDirs.Find( dir ) == nullptr )
+        {
+            // Out of watches (see /proc/sys/fs/inotify/max_user_watches) or similar
+            FLOG_WARN( "FileWatcher: Failed to watch '%s'. Error: %s", dir.Get(), LAST_ERROR_STR );
+            m_UnwatchableDirs.Append( dir );
+        }
+        return;
+    }
+
+    const auto * watchPath = m_WatchPaths.Find( wd );
+    if ( watchPath == nullptr )
+    {
+        m_WatchPaths.Insert( wd, dir );
+        m_WatchDescriptors.Insert( dir, wd );
+        ++m_NumWatches;
+
+        // Changes made before the watch was added are unknown
+        Log( FileWatcherLog::ENTRY_DIR, dir );
+    }
+    else if ( ( watchPath->m_Value != dir ) && ( m_UnwatchableDirs.Find( dir ) == nullptr ) )
+    {
+        // Same dir via a different path (symlink etc) - events only report one of them
+        m_UnwatchableDirs.Append( dir );
+    }
+}
+
+// RemoveWatch
+//------------------------------------------------------------------------------
+void FileWatcher::RemoveWatch( const AString & dir )
+{
+    const auto * descriptor = m_WatchDescriptors.Find( dir );
+    if ( descriptor == nullptr )
+    {
+        return; // Not watched (pending, or watched via another path)
+    }
+    const int32_t wd = descriptor->m_Value;
+    inotify_rm_watch( m_INotifyFD, wd ); // IN_IGNORED which follows is ignored, as the wd is unknown
+    m_WatchDescriptors.Erase( dir );
+    m_WatchPaths.Erase( wd );
+    --m_NumWatches;
+}
+
+// RefreshPendingDirs
+//------------------------------------------------------------------------------
+void FileWatcher::RefreshPendingDirs()
+{
+    for ( size_t i = 0; i < m_PendingDirs.GetSize(); )
+    {
+        const AString dir( m_PendingDirs[ i ] );
+        if ( FileIO::DirectoryExists( dir ) )
+        {
+            m_PendingDirs.EraseIndex( i );
+            AddWatch( dir );
+            continue;
+        }
+
+        // Watch nearest existing parent to see when the dir is created
+        // (fully, as it may also be needed for its own files later)
+        AStackString parent( dir );
+        for ( ;; )
+        {
+            parent.SetLength( parent.GetLength() - 1 ); // Remove trailing slash
+            const char * lastSlash = parent.FindLast( NATIVE_SLASH );
+            if ( lastSlash == nullptr )
+            {
+                break;
+            }
+            parent.SetLength( static_cast<uint32_t>( lastSlash - parent.Get() + 1 ) );
+            if ( FileIO::DirectoryExists( parent ) )
+            {
+                const int wd = inotify_add_watch( m_INotifyFD, parent.Get(), kWatchMask );
+                if ( ( wd >= 0 ) && ( m_WatchPaths.Find( wd ) == nullptr ) )
+                {
+                    m_WatchPaths.Insert( wd, parent );
+                    m_WatchDescriptors.Insert( parent, wd );
+                    m_ParentDirs.Append( parent );
+                    ++m_NumWatches;
+                }
+                break;
+            }
+        }
+        ++i;
+    }
+}
+
+// HandleEvent
+//------------------------------------------------------------------------------
+void FileWatcher::HandleEvent( int32_t wd, uint32_t mask, const char * name )
+{
+    // Events were lost
+    if ( mask & IN_Q_OVERFLOW )
+    {
+        Reset();
+        return;
+    }
+
+    // Requests from builds
+    if ( wd == m_ControlDirWD )
+    {
+        if ( mask & ( IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED ) )
+        {
+            // Temp dir was cleaned - recreate it so builds can still reach us
+            Reset();
+            FileIO::EnsurePathExists( m_ControlDir );
+            m_ControlDirWD = inotify_add_watch( m_INotifyFD, m_ControlDir.Get(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF );
+            return;
+        }
+        if ( name && ( AString::StrNCmp( name, FILEWATCHER_SYNC_FILE, sizeof( FILEWATCHER_SYNC_FILE ) ) == 0 ) )
+        {
+            HandleSync();
+        }
+        else if ( name && ( AString::StrNCmp( name, FILEWATCHER_DIRS_FILE, sizeof( FILEWATCHER_DIRS_FILE ) ) == 0 ) )
+        {
+            LoadWatchedDirs();
+        }
+        return;
+    }
+
+    const auto * watch = m_WatchPaths.Find( wd );
+    if ( watch == nullptr )
+    {
+        return; // Watch was already removed
+    }
+    const AString & watchPath = watch->m_Value;
+
+    // Watched dir was deleted or renamed
+    if ( mask & ( IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED ) )
+    {
+        if ( ( mask & IN_IGNORED ) == 0 )
+        {
+            inotify_rm_watch( m_INotifyFD, wd ); // Renamed dirs would otherwise report the old path
+        }
+        const AString dir( watchPath );
+        m_WatchPaths.Erase( wd ); // Descriptors may be reused by later watches
+        m_WatchDescriptors.Erase( dir );
+        --m_NumWatches;
+        Log( FileWatcherLog::ENTRY_DIR, dir );
+        if ( m_ParentDirs.FindAndErase( dir ) == false )
+        {
+            m_PendingDirs.Append( dir );
+        }
+        RefreshPendingDirs(); // Pending dirs may now need a different parent watched
+        return;
+    }
+
+    if ( name == nullptr )
+    {
+        return;
+    }
+
+    AStackString path( watchPath );
+    path += name;
+    if ( mask & IN_ISDIR )
+    {
+        // Only creation/deletion of a subdir can affect files within it
+        if ( mask & ( IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO ) )
+        {
+            path += NATIVE_SLASH;
+            Log( FileWatcherLog::ENTRY_DIR, path );
+            RefreshPendingDirs();
+        }
+        return;
+    }
+    Log( FileWatcherLog::ENTRY_FILE, path );
+}
+
+// HandleSync
+//------------------------------------------------------------------------------
+void FileWatcher::HandleSync()
+{
+    // Dirs we can't watch may always have changed
+    for ( const AString & dir : m_UnwatchableDirs )
+    {
+        Log( FileWatcherLog::ENTRY_DIR, dir );
+    }
+
+    // Modifications after the sync must be logged even if the same as the last
+    m_LastEntry.Clear();
+
+    // inotify events are ordered, so everything before the request is now logged
+    AtomicStoreRelease( &m_Header->m_SyncAck, AtomicLoadAcquire( &m_Header->m_SyncRequest ) );
+}
+#endif
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+FileWatcherClient::FileWatcherClient() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+FileWatcherClient::~FileWatcherClient() = default;
+
+// Sync
+//------------------------------------------------------------------------------
+bool FileWatcherClient::Sync( const AString & instanceName, uint32_t timeoutMS )
+{
+    if ( FileWatcher::IsSupported() == false )
+    {
+        return false;
+    }
+
+    // The watcher holds this lock for its lifetime
+    {
+        SystemMutex instanceMutex( instanceName.Get() );
+        if ( instanceMutex.TryLock() )
+        {
+            return false; // Not running
+        }
+    }
+
+    if ( m_SharedMemory.Open( instanceName.Get(), kSharedMemorySize ) == false )
+    {
+        return false;
+    }
+    const FileWatcherLog * header = static_cast<const FileWatcherLog *>( m_SharedMemory.GetPtr() );
+    if ( ( AtomicLoadAcquire( &header->m_Magic ) != FileWatcherLog::kMagic ) ||
+         ( header->m_Version != FileWatcherLog::kVersion ) )
+    {
+        return false;
+    }
+
+    // Post request, then poke the watcher through the file system, so that all
+    // changes made before this point are seen by the watcher before the request
+    FileWatcherLog * mutableHeader = const_cast<FileWatcherLog *>( header );
+    const uint64_t request = AtomicInc( &mutableHeader->m_SyncRequest );
+    AStackString syncFile;
+    if ( FileWatcher::GetControlDir( instanceName, syncFile ) == false )
+    {
+        return false;
+    }
+    syncFile += FILEWATCHER_SYNC_FILE;
+    FileStream f;
+    if ( ( f.Open( syncFile.Get(), FileStream::WRITE_ONLY ) == false ) ||
+         ( f.WriteBuffer( &request, sizeof( request ) ) != sizeof( request ) ) )
+    {
+        return false;
+    }
+    f.Close();
+
+    const Timer t;
+    while ( AtomicLoadAcquire( &header->m_SyncAck ) < request )
+    {
+        if ( t.GetElapsedMS() > static_cast<float>( timeoutMS ) )
+        {
+            FLOG_WARN( "FileWatcher did not respond within %u ms", timeoutMS );
+            return false;
+        }
+        Thread::Sleep( 1 );
+    }
+
+    m_Token.m_Generation = AtomicLoadAcquire( &header->m_Generation );
+    m_Token.m_Offset = AtomicLoadAcquire( &header->m_Size );
+    m_WatchedDirsHash = AtomicLoadAcquire( &header->m_DirsHash );
+    FullMemoryBarrier();
+    if ( AtomicLoadAcquire( &header->m_Generation ) != m_Token.m_Generation )
+    {
+        return false; // Reset while reading token
+    }
+
+    m_Header = header;
+    return true;
+}
+
+// GetChangesSince
+//------------------------------------------------------------------------------
+bool FileWatcherClient::GetChangesSince( const FileWatcherToken & token,
+                                         Array<AString> & outFiles,
+                                         Array<AString> & outDirs ) const
+{
+    ASSERT( m_Header ); // Must Sync first
+
+    // Changes after our own token will be seen by the next build
+    if ( ( token.m_Generation != m_Token.m_Generation ) || ( token.m_Offset > m_Token.m_Offset ) )
+    {
+        return false;
+    }
+
+    const char * const log = reinterpret_cast<const char *>( m_Header + 1 );
+    uint64_t pos = token.m_Offset;
+    while ( pos < m_Token.m_Offset )
+    {
+        uint16_t len;
+        memcpy( &len, log + pos + 1, sizeof( uint16_t ) );
+        const char * path = ( log + pos + kEntryHeaderSize );
+        if ( ( pos + kEntryHeaderSize + len ) > m_Token.m_Offset )
+        {
+            return false; // Overwritten by a reset
+        }
+        Array<AString> & dst = ( log[ pos ] == FileWatcherLog::ENTRY_DIR ) ? outDirs : outFiles;
+        dst.EmplaceBack( path, path + len );
+        pos += ( kEntryHeaderSize + len );
+    }
+
+    // If the log was reset while reading, what was read can't be trusted
+    FullMemoryBarrier();
+    return ( AtomicLoadAcquire( &m_Header->m_Generation ) == m_Token.m_Generation );
+}
+
+// SetWatchedDirs
+//------------------------------------------------------------------------------
+/*static*/ bool FileWatcherClient::SetWatchedDirs( const AString & instanceName,
+                                                  const Array<AString> & dirs,
+                                                  uint64_t watchedDirsHash )
+{
+    AString contents( 64 * 1024 );
+    for ( const AString & dir : dirs )
+    {
+        contents += dir;
+        contents += '\n';
+    }
+    if ( xxHash3::Calc64( contents.Get(), contents.GetLength() ) == watchedDirsHash )
+    {
+        return true; // Watcher already watches these
+    }
+
+    AStackString controlDir;
+    if ( ( FileWatcher::GetControlDir( instanceName, controlDir ) == false ) ||
+         ( FileIO::EnsurePathExists( controlDir ) == false ) )
+    {
+        return false;
+    }
+
+    // Replace atomically, so the watcher never reads a partial list
+    AStackString tmpFile( controlDir );
+    tmpFile += FILEWATCHER_DIRS_TMP_FILE;
+    AStackString dirsFile( controlDir );
+    dirsFile += FILEWATCHER_DIRS_FILE;
+    FileStream f;
+    if ( ( f.Open( tmpFile.Get(), FileStream::WRITE_ONLY ) == false ) ||
+         ( f.WriteBuffer( contents.Get(), contents.GetLength() ) != contents.GetLength() ) )
+    {
+        return false;
+    }
+    f.Close();
+    return FileIO::FileMove( tmpFile, dirsFile );
+}
+
+//------------------------------------------------------------------------------
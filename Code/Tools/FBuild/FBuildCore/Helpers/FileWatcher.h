@@ -0,0 +1,133 @@
+// FileWatcher - Long lived process recording changes to files used by builds
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Containers/UnorderedMap.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/SharedMemory.h"
+#include "Core/Process/SystemMutex.h"
+#include "Core/Strings/AString.h"
+
+// FileWatcherLog
+//  - Header of the SharedMemory through which changes are reported to builds
+//  - Followed by kLogSize bytes of entries: [uint8_t type][uint16_t len][path]
+//------------------------------------------------------------------------------
+class FileWatcherLog
+{
+public:
+    static const uint32_t kMagic = ( 'F' | ( 'B' << 8 ) | ( 'F' << 16 ) | ( 'W' << 24 ) );
+    static const uint32_t kVersion = 2;
+    static const uint32_t kLogSize = ( 16 * 1024 * 1024 );
+
+    enum EntryType : uint8_t
+    {
+        ENTRY_FILE = 0, // A file was modified, created or deleted
+        ENTRY_DIR = 1, // Anything within a directory may have changed
+    };
+
+    volatile uint32_t m_Magic; // Written last, once initialized
+    uint32_t m_Version;
+    volatile uint64_t m_Generation; // Changes whenever the log is reset
+    volatile uint64_t m_Size; // Bytes of log in use
+    volatile uint64_t m_SyncRequest; // Written by builds
+    volatile uint64_t m_SyncAck; // Written by watcher once all prior changes are logged
+    volatile uint64_t m_DirsHash; // Hash of the directory list the watcher last loaded (0 if none)
+};
+
+// FileWatcherToken
+//  - A position in the log, saved between builds
+//------------------------------------------------------------------------------
+class FileWatcherToken
+{
+public:
+    uint64_t m_Generation = 0;
+    uint64_t m_Offset = 0;
+};
+
+// FileWatcher
+//  - Watches directories used by builds (run with -filewatcherdaemon)
+//  - Linux only (inotify). On other platforms IsSupported() is false, and builds
+//    using -filewatcher check all files as usual.
+//------------------------------------------------------------------------------
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    // Watchers are identified by the DB they serve
+    static void GetInstanceName( const AString & workingDir, const AString & nodeGraphDBFile, AString & outName );
+    static bool GetControlDir( const AString & instanceName, AString & outDir );
+
+    static bool IsSupported();
+
+    bool Init( const AString & instanceName );
+    void Update( uint32_t timeoutMS );
+
+    uint32_t GetNumWatches() const { return m_NumWatches; }
+
+private:
+#if defined( __LINUX__ )
+    void Reset();
+    void Log( FileWatcherLog::EntryType type, const AString & path );
+    void LoadWatchedDirs();
+    void AddWatch( const AString & dir );
+    void RemoveWatch( const AString & dir );
+    void RefreshPendingDirs();
+    void HandleEvent( int32_t wd, uint32_t mask, const char * name );
+    void HandleSync();
+
+    int m_INotifyFD = -1;
+    int32_t m_ControlDirWD = -1;
+    AString m_ControlDir;
+    SharedMemory m_SharedMemory;
+    FileWatcherLog * m_Header = nullptr;
+    char * m_Log = nullptr;
+    SystemMutex * m_InstanceMutex = nullptr;
+    UnorderedMap<int32_t, AString> m_WatchPaths; // Keyed by watch descriptor
+    UnorderedMap<AString, int32_t> m_WatchDescriptors; // Keyed by path
+    Array<AString> m_WatchedDirs; // Sorted list last loaded from builds
+    Array<AString> m_ParentDirs; // Watched only to see pending dirs being created
+    Array<AString> m_PendingDirs; // Missing dirs, awaiting creation
+    Array<AString> m_UnwatchableDirs; // Reported as changed on every sync
+    AString m_LastEntry; // Avoid logging repeated modifications
+#endif
+    uint32_t m_NumWatches = 0;
+};
+
+// FileWatcherClient
+//  - Used by builds to query changes since a previous build
+//------------------------------------------------------------------------------
+class FileWatcherClient
+{
+public:
+    FileWatcherClient();
+    ~FileWatcherClient();
+
+    // Wait for the watcher to log all changes made before now
+    bool Sync( const AString & instanceName, uint32_t timeoutMS );
+    const FileWatcherToken & GetToken() const { return m_Token; }
+    uint64_t GetWatchedDirsHash() const { return m_WatchedDirsHash; }
+
+    // Fails if the log was reset since the token was obtained
+    bool GetChangesSince( const FileWatcherToken & token,
+                          Array<AString> & outFiles,
+                          Array<AString> & outDirs ) const;
+
+    // Tell watcher which directories to watch (slash terminated), unless the
+    // list matches what the watcher reported from GetWatchedDirsHash()
+    static bool SetWatchedDirs( const AString & instanceName,
+                                const Array<AString> & dirs,
+                                uint64_t watchedDirsHash );
+
+private:
+    SharedMemory m_SharedMemory;
+    const FileWatcherLog * m_Header = nullptr;
+    FileWatcherToken m_Token;
+    uint64_t m_WatchedDirsHash = 0;
+};
+
+//------------------------------------------------------------------------------
@@ -157,12 +157,12 @@ bool MultiBuffer::ExtractFile( size_t index, const AString & fileName ) const
 
 // Compress
 //------------------------------------------------------------------------------
-void MultiBuffer::Compress( int32_t compressionLevel, bool allowZstdUse )
+void MultiBuffer::Compress( int32_t compressionLevel, bool allowZstdUse, bool allowFraming )
 {
     ASSERT( m_WriteStream ); // Data needs to be populated
 
     // Compress the data
-    Compressor c;
+    Compressor c( allowFraming );
     if ( allowZstdUse )
     {
         c.CompressZstd( m_WriteStream->GetData(), m_WriteStream->GetSize(), compressionLevel );
@@ -26,7 +26,7 @@ public:
     bool CreateFromFiles( const Array<AString> & fileNames, size_t * outProblemFileIndex = nullptr );
     bool ExtractFile( size_t index, const AString & fileName ) const;
 
-    void Compress( int32_t compressionLevel, bool allowZstdUse );
+    void Compress( int32_t compressionLevel, bool allowZstdUse, bool allowFraming );
     bool Decompress();
 
     const void * GetData() const;
@@ -319,7 +319,7 @@ void HTMLReport::CreateOverview( const FBuildStats & stats )
 
 // DoCacheStats
 //------------------------------------------------------------------------------
-void HTMLReport::DoCacheStats( const FBuildStats & /*stats*/ )
+void HTMLReport::DoCacheStats( const FBuildStats & stats )
 {
     DoSectionTitle( "Cache Stats", "cacheStats" );
 
@@ -349,6 +349,27 @@ void HTMLReport::DoCacheStats( const FBuildStats & /*stats*/ )
         pieItems.EmplaceBack( "Cache Hit", (float)totalCacheHits, (uint32_t)0x88FF88 );
         DoPieChart( pieItems, "" );
 
+        // local and shared cache tiers
+        if ( stats.m_CacheTiered )
+        {
+            DoTableStart();
+            Write( "<tr><th>Tier</th><th style=\"width:70px;\">Lookups</th><th style=\"width:70px;\">Hits</th><th style=\"width:100px;\">Retrieve Time</th><th style=\"width:60px;\">Stores</th><th style=\"width:100px;\">Store Time</th></tr>\n" );
+            const char * const tierNames[] = { "L1 (Local)", "L2 (Shared)" };
+            for ( uint32_t tier = 0; tier < 2; ++tier )
+            {
+                const FBuildStats::CacheTierStats & tierStats = stats.m_CacheTiers[ tier ];
+                Write( "<tr><td>%s</td><td>%u</td><td>%u</td><td>%2.3fs</td><td>%u</td><td>%2.3fs</td></tr>\n",
+                       tierNames[ tier ],
+                       tierStats.m_Lookups,
+                       tierStats.m_Hits,
+                       (double)tierStats.m_RetrieveTimeMS / 1000.0,
+                       tierStats.m_Stores,
+                       (double)tierStats.m_StoreTimeMS / 1000.0 );
+            }
+            DoTableStop();
+            Write( "Promoted to L1: %u\n", stats.m_CachePromotions );
+        }
+
         DoTableStart();
 
         // Headings
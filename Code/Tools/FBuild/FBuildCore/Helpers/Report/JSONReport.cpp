@@ -232,7 +232,7 @@ void JSONReport::DoCPUTimeByType( const FBuildStats & stats )
 
 // DoCacheStats
 //------------------------------------------------------------------------------
-void JSONReport::DoCacheStats( const FBuildStats & /*stats*/ )
+void JSONReport::DoCacheStats( const FBuildStats & stats )
 {
     Write( "\"Cache Stats\": {\n" );
 
@@ -287,6 +287,26 @@ void JSONReport::DoCacheStats( const FBuildStats & /*stats*/ )
         // end of summary section
         Write( "\n\t\t}," );
 
+        // local and shared cache tiers
+        if ( stats.m_CacheTiered )
+        {
+            Write( "\n\t\t\"tiers\": {" );
+            const char * const tierNames[] = { "L1 (Local)", "L2 (Shared)" };
+            for ( uint32_t tier = 0; tier < 2; ++tier )
+            {
+                const FBuildStats::CacheTierStats & tierStats = stats.m_CacheTiers[ tier ];
+                Write( "\n\t\t\t\"%s\": {", tierNames[ tier ] );
+                Write( "\n\t\t\t\t\"Lookups\": %u,", tierStats.m_Lookups );
+                Write( "\n\t\t\t\t\"Hits\": %u,", tierStats.m_Hits );
+                Write( "\n\t\t\t\t\"Retrieve Time (s)\": %.3f,", (double)tierStats.m_RetrieveTimeMS / 1000.0 );
+                Write( "\n\t\t\t\t\"Stores\": %u,", tierStats.m_Stores );
+                Write( "\n\t\t\t\t\"Store Time (s)\": %.3f", (double)tierStats.m_StoreTimeMS / 1000.0 );
+                Write( "\n\t\t\t}," );
+            }
+            Write( "\n\t\t\t\"Promoted\": %u", stats.m_CachePromotions );
+            Write( "\n\t\t}," );
+        }
+
         // library stats information
         Write( "\n\t\t\"details\": [\n\t\t\t" );
 
@@ -0,0 +1,171 @@
+// ToolChunkStore
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ToolChunkStore.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Strings/AStackString.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+ToolChunkStore::ToolChunkStore()
+{
+    VERIFY( FBuild::GetTempDir( m_Path ) );
+#if defined( __WINDOWS__ )
+    m_Path += ".fbuild.tmp\\worker\\chunks\\";
+#else
+    m_Path += "_fbuild.tmp/worker/chunks/";
+#endif
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+ToolChunkStore::~ToolChunkStore() = default;
+
+// Has
+//------------------------------------------------------------------------------
+bool ToolChunkStore::Has( uint64_t hash, uint32_t size ) const
+{
+    AStackString chunkPath;
+    GetChunkPath( hash, chunkPath );
+
+    // Content is verified, so a damaged chunk is requested again rather than
+    // failing the file which uses it
+    UniquePtr<void, FreeDeletor> buffer( ALLOC( size ) );
+    if ( ReadChunk( chunkPath, hash, size, buffer.Get() ) == false )
+    {
+        return false;
+    }
+
+    // Keep chunks in use from being cleaned up with other old temp files (or
+    // trimmed from the ToolchainStore, in which case the chunk is gone now)
+    return FileIO::SetFileLastWriteTimeToNow( chunkPath );
+}
+
+// Read
+//------------------------------------------------------------------------------
+bool ToolChunkStore::Read( uint64_t hash, uint32_t size, void * outData ) const
+{
+    AStackString chunkPath;
+    GetChunkPath( hash, chunkPath );
+
+    if ( ReadChunk( chunkPath, hash, size, outData ) == false )
+    {
+        return false;
+    }
+
+    // The time stamp records last use, so least recently used chunks are the
+    // ones trimmed from the ToolchainStore
+    FileIO::SetFileLastWriteTimeToNow( chunkPath );
+    return true;
+}
+
+// Write
+//------------------------------------------------------------------------------
+bool ToolChunkStore::Write( uint64_t hash, const void * data, uint32_t size )
+{
+    ASSERT( xxHash3::Calc64Big( data, size ) == hash );
+
+    AStackString chunkPath;
+    GetChunkPath( hash, chunkPath );
+
+    // Several connections can receive the same chunk at the same time
+    MutexHolder mh( m_Mutex );
+
+    if ( Has( hash, size ) )
+    {
+        return true; // Another toolchain already provided this chunk
+    }
+
+    // Write to a temp file and rename, so a partially written chunk is never
+    // seen under its final name
+    if ( FileIO::EnsurePathExists( m_Path ) == false )
+    {
+        return false;
+    }
+    AStackString tmpPath( chunkPath );
+    tmpPath += ".tmp";
+    FileStream fs;
+    if ( fs.Open( tmpPath.Get(), FileStream::WRITE_ONLY ) == false )
+    {
+        return false;
+    }
+    if ( fs.Write( data, size ) != size )
+    {
+        fs.Close();
+        FileIO::FileDelete( tmpPath.Get() );
+        return false;
+    }
+    fs.Close();
+    if ( FileIO::FileMove( tmpPath, chunkPath ) == false )
+    {
+        FileIO::FileDelete( tmpPath.Get() );
+        return false;
+    }
+
+    ++m_NumChunksWritten;
+    return true;
+}
+
+// GetNumChunksWritten
+//------------------------------------------------------------------------------
+uint32_t ToolChunkStore::GetNumChunksWritten() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_NumChunksWritten;
+}
+
+// GetChunkPath
+//------------------------------------------------------------------------------
+void ToolChunkStore::GetChunkPath( uint64_t hash, AString & outPath ) const
+{
+    outPath.Format( "%s%016" PRIx64, m_Path.Get(), hash );
+}
+
+// ReadChunk
+//------------------------------------------------------------------------------
+bool ToolChunkStore::ReadChunk( const AString & chunkPath, uint64_t hash, uint32_t size, void * outData ) const
+{
+    if ( ReadChunkFile( chunkPath, hash, size, outData ) )
+    {
+        return true;
+    }
+    if ( FileIO::FileExists( chunkPath.Get() ) == false )
+    {
+        return false; // Not received yet
+    }
+
+    // Remove a damaged chunk (for example from an interrupted write) so it
+    // will be requested again. Writes hold the mutex, so check again while
+    // holding it in case the chunk has just been replaced.
+    MutexHolder mh( m_Mutex );
+    if ( ReadChunkFile( chunkPath, hash, size, outData ) )
+    {
+        return true;
+    }
+    FileIO::FileDelete( chunkPath.Get() );
+    return false;
+}
+
+// ReadChunkFile
+//------------------------------------------------------------------------------
+/*static*/ bool ToolChunkStore::ReadChunkFile( const AString & chunkPath, uint64_t hash, uint32_t size, void * outData )
+{
+    FileStream fs;
+    return ( fs.Open( chunkPath.Get(), FileStream::READ_ONLY ) &&
+             ( fs.GetFileSize() == size ) &&
+             ( fs.Read( outData, size ) == size ) &&
+             ( xxHash3::Calc64Big( outData, size ) == hash ) );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,45 @@
+// ToolChunkStore
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// ToolChunkStore
+//  - Chunks of toolchain files received by a worker, shared by all toolchains
+//    so that a new version of a toolchain only needs the chunks that changed
+//  - One file per chunk, named by the hash of its content
+//  - A chunk's time stamp is updated whenever it is used (Has, Read or Write),
+//    so it records when the chunk was last used
+//  - A chunk whose content doesn't match its hash (for example after an
+//    interrupted write) is removed, so it will be requested again
+//------------------------------------------------------------------------------
+class ToolChunkStore
+{
+public:
+    explicit ToolChunkStore();
+    ~ToolChunkStore();
+
+    bool Has( uint64_t hash, uint32_t size ) const; // Verifies content
+    bool Read( uint64_t hash, uint32_t size, void * outData ) const;
+    bool Write( uint64_t hash, const void * data, uint32_t size );
+
+    const AString & GetPath() const { return m_Path; }
+
+    // Stats
+    uint32_t GetNumChunksWritten() const;
+
+private:
+    void GetChunkPath( uint64_t hash, AString & outPath ) const;
+    bool ReadChunk( const AString & chunkPath, uint64_t hash, uint32_t size, void * outData ) const;
+    static bool ReadChunkFile( const AString & chunkPath, uint64_t hash, uint32_t size, void * outData );
+
+    AString m_Path;
+    mutable Mutex m_Mutex;
+    uint32_t m_NumChunksWritten = 0;
+};
+
+//------------------------------------------------------------------------------
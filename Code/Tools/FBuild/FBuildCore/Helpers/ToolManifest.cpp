@@ -14,6 +14,7 @@
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Math/xxHash.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
@@ -22,6 +23,8 @@
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/FileNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ContentChunker.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolChunkStore.h"
 
 // system
 #include <memory.h> // memcpy
@@ -101,7 +104,7 @@ void ToolManifestFile::StoreCompressedContent( const void * uncompressedData, co
 {
     ASSERT( m_CompressedContent == nullptr );
     m_UncompressedContentSize = uncompressedDataSize;
-    Compressor c;
+    Compressor c( false ); // Workers prior to protocol 22.7 can't read chunked data
     c.Compress( uncompressedData, m_UncompressedContentSize );
     m_CompressedContentSize = (uint32_t)c.GetResultSize();
     m_CompressedContent = c.ReleaseResult();
@@ -522,6 +525,24 @@ bool ToolManifest::GetSynchronizationStatus( uint32_t & syncDone, uint32_t & syn
     return synching;
 }
 
+// GetChunksInUse
+//------------------------------------------------------------------------------
+void ToolManifest::GetChunksInUse( Array<uint64_t> & outChunkHashes ) const
+{
+    MutexHolder mh( m_Mutex );
+
+    for ( const ToolManifestFile & file : m_Files )
+    {
+        if ( file.GetSyncState() == ToolManifestFile::SYNCHRONIZING )
+        {
+            for ( const ToolManifestChunk & chunk : file.GetRemoteChunks() )
+            {
+                outChunkHashes.Append( chunk.m_Hash );
+            }
+        }
+    }
+}
+
 // CancelSynchronizingFiles
 //------------------------------------------------------------------------------
 void ToolManifest::CancelSynchronizingFiles()
@@ -545,6 +566,8 @@ void ToolManifest::CancelSynchronizingFiles()
         if ( file.GetSyncState() == ToolManifestFile::SYNCHRONIZING )
         {
             file.SetSyncState( ToolManifestFile::NOT_SYNCHRONIZED );
+            file.GetRemoteChunks().Clear();
+            file.GetMissingChunks().Clear();
             atLeastOneFileCancelled = true;
         }
     }
@@ -592,6 +615,79 @@ const void * ToolManifestFile::GetFileData( size_t & outDataSize ) const
     return m_CompressedContent;
 }
 
+// GetChunks (ToolManifestFile)
+//------------------------------------------------------------------------------
+const Array<ToolManifestChunk> * ToolManifestFile::GetChunks() const
+{
+    // Should only be possible to access data if we know it's up-to-date
+    ASSERT( m_TimeStamp );
+    ASSERT( m_Hash );
+
+    if ( m_Chunks.IsEmpty() )
+    {
+        void * uncompressedContent;
+        uint32_t uncompressedContentSize;
+        if ( LoadFile( uncompressedContent, uncompressedContentSize ) == false )
+        {
+            return nullptr; // LoadFile emits an error
+        }
+        UniquePtr<void, FreeDeletor> content( uncompressedContent );
+
+        // We should have previously recorded the uncompressed size
+        ASSERT( uncompressedContentSize == m_UncompressedContentSize );
+
+        // Split by content so an updated toolchain shares most chunks with
+        // the previous version
+        const ContentChunker chunker( ToolManifest::kChunkMinSize, ToolManifest::kChunkAverageSize, ToolManifest::kChunkMaxSize );
+        const char * data = static_cast<const char *>( uncompressedContent );
+        for ( uint32_t offset = 0; offset < uncompressedContentSize; )
+        {
+            ToolManifestChunk & chunk = m_Chunks.EmplaceBack();
+            chunk.m_Size = chunker.GetChunkSize( data + offset, uncompressedContentSize - offset );
+            chunk.m_Hash = xxHash3::Calc64Big( data + offset, chunk.m_Size );
+            offset += chunk.m_Size;
+        }
+    }
+    return &m_Chunks;
+}
+
+// GetChunkData (ToolManifestFile)
+//------------------------------------------------------------------------------
+bool ToolManifestFile::GetChunkData( const Array<uint32_t> & chunkIndices, MemoryStream & outData ) const
+{
+    ASSERT( m_Chunks.IsEmpty() == false ); // GetChunks must be called first
+
+    void * uncompressedContent;
+    uint32_t uncompressedContentSize;
+    if ( LoadFile( uncompressedContent, uncompressedContentSize ) == false )
+    {
+        return false; // LoadFile emits an error
+    }
+    UniquePtr<void, FreeDeletor> content( uncompressedContent );
+
+    // File must not have changed since chunks were calculated
+    const char * data = static_cast<const char *>( uncompressedContent );
+    Array<uint32_t> chunkOffsets;
+    chunkOffsets.SetCapacity( m_Chunks.GetSize() );
+    uint32_t offset = 0;
+    for ( const ToolManifestChunk & chunk : m_Chunks )
+    {
+        chunkOffsets.Append( offset );
+        offset += chunk.m_Size;
+    }
+    if ( offset != uncompressedContentSize )
+    {
+        return false;
+    }
+
+    for ( const uint32_t chunkIndex : chunkIndices )
+    {
+        const ToolManifestChunk & chunk = m_Chunks[ chunkIndex ];
+        outData.WriteBuffer( data + chunkOffsets[ chunkIndex ], chunk.m_Size );
+    }
+    return true;
+}
+
 // ReceiveFileData
 //------------------------------------------------------------------------------
 bool ToolManifest::ReceiveFileData( uint32_t fileId,
@@ -611,11 +707,9 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId,
 
     ASSERT( f.GetSyncState() == ToolManifestFile::SYNCHRONIZING );
 
-    // do decompression
+    // validate data
     outCorruptData = false;
-    Compressor c;
-    if ( ( Compressor::IsValidData( data, dataSize ) == false ) ||
-         ( c.Decompress( data ) == false ) )
+    if ( Compressor::IsValidData( data, dataSize ) == false )
     {
         // NOTE: In clients prior to v1.07 a bug could cause ToolFiles to be
         //       corrupt so we try to gracefully handle corrupt data.
@@ -631,8 +725,6 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId,
         outCorruptData = true;
         return false;
     }
-    const void * uncompressedData = c.GetResult();
-    const size_t uncompressedDataSize = c.GetResultSize();
 
     // prepare name for this file
     AStackString fileName;
@@ -645,18 +737,283 @@ bool ToolManifest::ReceiveFileData( uint32_t fileId,
         return false; // FAILED
     }
 
-    // write to disk
+    // decompress to disk
     FileStream fs;
     if ( !fs.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
     {
         return false; // FAILED
     }
-    if ( fs.Write( uncompressedData, uncompressedDataSize ) != uncompressedDataSize )
+    Compressor c;
+    if ( c.DecompressToFile( data, fs ) == false )
     {
+        // A body which fails to decompress is corrupt, as for a bad header
+        ASSERT( ( c.IsDataCorrupt() == false ) && "Corrupt file data" ); // Catch errors during development
+        outCorruptData = c.IsDataCorrupt();
+        fs.Close();
+        FileIO::FileDelete( fileName.Get() ); // Don't leave a partial file
         return false; // FAILED
     }
     fs.Close();
 
+    return FinalizeReceivedFile( fileId, fileName );
+}
+
+// GetFileChunkList
+//------------------------------------------------------------------------------
+bool ToolManifest::GetFileChunkList( uint32_t fileId, MemoryStream & outChunkList ) const
+{
+    MutexHolder mh( m_Mutex );
+
+    if ( fileId >= m_Files.GetSize() )
+    {
+        return false;
+    }
+    const Array<ToolManifestChunk> * chunks = m_Files[ fileId ].GetChunks();
+    if ( chunks == nullptr )
+    {
+        return false; // GetChunks emits an error
+    }
+
+    outChunkList.Write( (uint32_t)chunks->GetSize() );
+    for ( const ToolManifestChunk & chunk : *chunks )
+    {
+        outChunkList.Write( chunk.m_Hash );
+        outChunkList.Write( chunk.m_Size );
+    }
+    return true;
+}
+
+// GetFileChunkData
+//------------------------------------------------------------------------------
+bool ToolManifest::GetFileChunkData( uint32_t fileId, const void * request, size_t requestSize, MemoryStream & outData ) const
+{
+    MutexHolder mh( m_Mutex );
+
+    if ( fileId >= m_Files.GetSize() )
+    {
+        return false;
+    }
+
+    // Worker should only ask for chunks of files whose chunk list it has
+    const ToolManifestFile & f = m_Files[ fileId ];
+    const Array<ToolManifestChunk> * chunks = f.GetChunks();
+    if ( chunks == nullptr )
+    {
+        return false;
+    }
+
+    // Read the indices of the requested chunks
+    ConstMemoryStream ms( request, requestSize );
+    uint32_t numChunks = 0;
+    if ( ( ms.Read( numChunks ) == false ) || ( numChunks == 0 ) || ( numChunks > chunks->GetSize() ) )
+    {
+        return false;
+    }
+    Array<uint32_t> chunkIndices;
+    chunkIndices.SetCapacity( numChunks );
+    for ( uint32_t i = 0; i < numChunks; ++i )
+    {
+        uint32_t chunkIndex = 0;
+        if ( ( ms.Read( chunkIndex ) == false ) || ( chunkIndex >= chunks->GetSize() ) )
+        {
+            return false;
+        }
+        chunkIndices.Append( chunkIndex );
+    }
+
+    return f.GetChunkData( chunkIndices, outData );
+}
+
+// ReceiveFileChunkList
+//------------------------------------------------------------------------------
+bool ToolManifest::ReceiveFileChunkList( uint32_t fileId,
+                                         const void * data,
+                                         size_t dataSize,
+                                         const ToolChunkStore & chunkStore,
+                                         Array<uint32_t> & outMissingChunks,
+                                         bool & outCorruptData )
+{
+    MutexHolder mh( m_Mutex );
+
+    outCorruptData = false;
+    outMissingChunks.Clear();
+
+    ToolManifestFile & f = m_Files[ fileId ];
+
+    // gracefully handle multiple receipts of the same data
+    if ( f.GetSyncState() == ToolManifestFile::SYNCHRONIZED )
+    {
+        return true;
+    }
+
+    ASSERT( f.GetSyncState() == ToolManifestFile::SYNCHRONIZING );
+
+    // Read the chunk list, which must describe the whole file
+    ConstMemoryStream ms( data, dataSize );
+    uint32_t numChunks = 0;
+    if ( ( ms.Read( numChunks ) == false ) || ( numChunks > f.GetUncompressedContentSize() ) )
+    {
+        outCorruptData = true;
+        return false;
+    }
+    Array<ToolManifestChunk> chunks;
+    chunks.SetCapacity( numChunks );
+    uint64_t totalSize = 0;
+    for ( uint32_t i = 0; i < numChunks; ++i )
+    {
+        ToolManifestChunk & chunk = chunks.EmplaceBack();
+        if ( ( ms.Read( chunk.m_Hash ) == false ) ||
+             ( ms.Read( chunk.m_Size ) == false ) ||
+             ( chunk.m_Size == 0 ) )
+        {
+            outCorruptData = true;
+            return false;
+        }
+        totalSize += chunk.m_Size;
+    }
+    if ( totalSize != f.GetUncompressedContentSize() )
+    {
+        outCorruptData = true;
+        return false;
+    }
+
+    // Find the chunks we don't already have from this or another toolchain
+    for ( uint32_t i = 0; i < numChunks; ++i )
+    {
+        if ( chunkStore.Has( chunks[ i ].m_Hash, chunks[ i ].m_Size ) == false )
+        {
+            outMissingChunks.Append( i );
+        }
+    }
+
+    f.GetRemoteChunks() = Move( chunks );
+    if ( outMissingChunks.IsEmpty() )
+    {
+        return AssembleFileFromChunks( fileId, chunkStore );
+    }
+    f.GetMissingChunks() = outMissingChunks;
+    return true; // Caller must request the missing chunks
+}
+
+// ReceiveFileChunks
+//------------------------------------------------------------------------------
+bool ToolManifest::ReceiveFileChunks( uint32_t fileId,
+                                      const void * data,
+                                      size_t dataSize,
+                                      ToolChunkStore & chunkStore,
+                                      bool & outCorruptData )
+{
+    MutexHolder mh( m_Mutex );
+
+    outCorruptData = false;
+
+    ToolManifestFile & f = m_Files[ fileId ];
+
+    // gracefully handle multiple receipts of the same data
+    if ( f.GetSyncState() == ToolManifestFile::SYNCHRONIZED )
+    {
+        return true;
+    }
+
+    ASSERT( f.GetSyncState() == ToolManifestFile::SYNCHRONIZING );
+
+    // Chunks must be ones we asked for
+    const Array<uint32_t> & missingChunks = f.GetMissingChunks();
+    const Array<ToolManifestChunk> & chunks = f.GetRemoteChunks();
+    if ( missingChunks.IsEmpty() || ( Compressor::IsValidData( data, dataSize ) == false ) )
+    {
+        outCorruptData = true;
+        return false;
+    }
+    Compressor c;
+    if ( c.Decompress( data ) == false )
+    {
+        outCorruptData = true;
+        return false;
+    }
+
+    // Chunks are sent in the order they were requested
+    uint64_t expectedSize = 0;
+    for ( const uint32_t chunkIndex : missingChunks )
+    {
+        expectedSize += chunks[ chunkIndex ].m_Size;
+    }
+    if ( c.GetResultSize() != expectedSize )
+    {
+        outCorruptData = true;
+        return false;
+    }
+
+    // Verify and store
+    const char * pos = static_cast<const char *>( c.GetResult() );
+    for ( const uint32_t chunkIndex : missingChunks )
+    {
+        const ToolManifestChunk & chunk = chunks[ chunkIndex ];
+        if ( xxHash3::Calc64Big( pos, chunk.m_Size ) != chunk.m_Hash )
+        {
+            outCorruptData = true;
+            return false;
+        }
+        if ( chunkStore.Write( chunk.m_Hash, pos, chunk.m_Size ) == false )
+        {
+            return false; // FAILED
+        }
+        pos += chunk.m_Size;
+    }
+    f.GetMissingChunks().Clear();
+
+    return AssembleFileFromChunks( fileId, chunkStore );
+}
+
+// AssembleFileFromChunks
+//------------------------------------------------------------------------------
+bool ToolManifest::AssembleFileFromChunks( uint32_t fileId, const ToolChunkStore & chunkStore )
+{
+    ToolManifestFile & f = m_Files[ fileId ];
+
+    // prepare name for this file
+    AStackString fileName;
+    GetRemoteFilePath( fileId, fileName );
+
+    // prepare destination
+    AStackString pathOnly( fileName.Get(), fileName.FindLast( NATIVE_SLASH ) );
+    if ( !FileIO::EnsurePathExists( pathOnly ) )
+    {
+        return false; // FAILED
+    }
+
+    // copy chunks from the store
+    FileStream fs;
+    if ( !fs.Open( fileName.Get(), FileStream::WRITE_ONLY ) )
+    {
+        return false; // FAILED
+    }
+    uint32_t bufferSize = 0;
+    for ( const ToolManifestChunk & chunk : f.GetRemoteChunks() )
+    {
+        bufferSize = Math::Max( bufferSize, chunk.m_Size );
+    }
+    UniquePtr<void, FreeDeletor> buffer( ALLOC( bufferSize ) );
+    for ( const ToolManifestChunk & chunk : f.GetRemoteChunks() )
+    {
+        if ( ( chunkStore.Read( chunk.m_Hash, chunk.m_Size, buffer.Get() ) == false ) ||
+             ( fs.Write( buffer.Get(), chunk.m_Size ) != chunk.m_Size ) )
+        {
+            return false; // FAILED
+        }
+    }
+    fs.Close();
+    f.GetRemoteChunks().Clear(); // No longer needed
+
+    return FinalizeReceivedFile( fileId, fileName );
+}
+
+// FinalizeReceivedFile
+//------------------------------------------------------------------------------
+bool ToolManifest::FinalizeReceivedFile( uint32_t fileId, const AString & fileName )
+{
+    ToolManifestFile & f = m_Files[ fileId ];
+
     // mark executable
 #if defined( __LINUX__ ) || defined( __OSX__ )
     FileIO::SetExecutable( fileName.Get() );
@@ -7,7 +7,9 @@
 class Dependencies;
 class FileStream;
 class IOStream;
+class MemoryStream;
 class Node;
+class ToolChunkStore;
 
 // Includes
 //------------------------------------------------------------------------------
@@ -18,6 +20,16 @@ class Node;
 #include "Core/Reflection/Struct.h"
 #include "Core/Strings/AString.h"
 
+// ToolManifestChunk
+//  - Part of a file, so that only parts a worker doesn't have need to be sent
+//------------------------------------------------------------------------------
+class ToolManifestChunk
+{
+public:
+    uint64_t m_Hash;
+    uint32_t m_Size;
+};
+
 // ToolManifestFile
 //------------------------------------------------------------------------------
 class ToolManifestFile : public Struct
@@ -40,6 +52,8 @@ public:
     void Migrate( const ToolManifestFile & oldFile );
 
     const void * GetFileData( size_t & outDataSize ) const;
+    const Array<ToolManifestChunk> * GetChunks() const;
+    bool GetChunkData( const Array<uint32_t> & chunkIndices, MemoryStream & outData ) const;
 
     // Access state
     const AString & GetName() const { return m_Name; }
@@ -51,6 +65,9 @@ public:
     // Modify state
     void SetSyncState( SyncState state ) { m_SyncState = state; }
     void SetFileLock( FileStream * fileLock ) { m_FileLock = fileLock; }
+    Array<ToolManifestChunk> & GetRemoteChunks() { return m_Chunks; }
+    const Array<ToolManifestChunk> & GetRemoteChunks() const { return m_Chunks; }
+    Array<uint32_t> & GetMissingChunks() { return m_MissingChunks; }
 
 protected:
     bool LoadFile( void *& uncompressedContent, uint32_t & uncompressedContentSize ) const;
@@ -62,11 +79,15 @@ protected:
     mutable uint32_t m_UncompressedContentSize = 0;
     mutable uint32_t m_CompressedContentSize = 0;
 
+    // "local" and "remote" members
+    mutable Array<ToolManifestChunk> m_Chunks; // Created on first request (local) or received (remote)
+
     // "local" members
     mutable void * m_CompressedContent = nullptr;
 
     // "remote" members
     SyncState m_SyncState = NOT_SYNCHRONIZED;
+    Array<uint32_t> m_MissingChunks; // Chunks requested from the client
     FileStream * m_FileLock = nullptr; // keep the file locked when sync'd
 };
 
@@ -113,6 +134,17 @@ public:
     const void * GetFileData( uint32_t fileId, size_t & dataSize ) const;
     bool ReceiveFileData( uint32_t fileId, const void * data, size_t & dataSize, bool & outCorruptData );
 
+    // Synchronization of files in chunks (protocol v22.9 or later)
+    bool GetFileChunkList( uint32_t fileId, MemoryStream & outChunkList ) const;
+    bool GetFileChunkData( uint32_t fileId, const void * request, size_t requestSize, MemoryStream & outData ) const;
+    bool ReceiveFileChunkList( uint32_t fileId, const void * data, size_t dataSize, const ToolChunkStore & chunkStore, Array<uint32_t> & outMissingChunks, bool & outCorruptData );
+    bool ReceiveFileChunks( uint32_t fileId, const void * data, size_t dataSize, ToolChunkStore & chunkStore, bool & outCorruptData );
+    void GetChunksInUse( Array<uint64_t> & outChunkHashes ) const; // Chunks files being synchronized will be assembled from
+
+    inline static const uint32_t kChunkMinSize = ( 16 * 1024 );
+    inline static const uint32_t kChunkAverageSize = ( 64 * 1024 );
+    inline static const uint32_t kChunkMaxSize = ( 256 * 1024 );
+
     void GetRemotePath( AString & path ) const;
     void GetRemoteFilePath( uint32_t fileId, AString & exe ) const;
     const char * GetRemoteEnvironmentString() const { return m_RemoteEnvironmentString; }
@@ -124,6 +156,9 @@ public:
 #endif
 
 private:
+    bool AssembleFileFromChunks( uint32_t fileId, const ToolChunkStore & chunkStore );
+    bool FinalizeReceivedFile( uint32_t fileId, const AString & fileName );
+
     mutable Mutex m_Mutex;
 
     // Reflected
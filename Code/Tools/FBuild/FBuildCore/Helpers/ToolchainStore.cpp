@@ -0,0 +1,321 @@
+// ToolchainStore
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ToolchainStore.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/Containers/UnorderedMap.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+
+// system
+#include <stdlib.h> // for strtoull
+
+// Static
+//------------------------------------------------------------------------------
+/*static*/ uint32_t ToolchainStore::s_MaxSizeMiB( 10 * 1024 );
+
+// StoreItem
+//  - A toolchain (all files and the manifest), or a chunk
+//------------------------------------------------------------------------------
+class StoreItem
+{
+public:
+    uint64_t m_ToolId = 0; // 0 for chunks
+    uint64_t m_ChunkHash = 0; // Chunks only
+    uint64_t m_LastUseTime = 0;
+    uint64_t m_Size = 0;
+    Array<FileIO::FileInfo> m_Files;
+};
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+ToolchainStore::ToolchainStore()
+{
+    VERIFY( FBuild::GetTempDir( m_Path ) );
+#if defined( __WINDOWS__ )
+    m_Path += ".fbuild.tmp\\worker\\";
+#else
+    m_Path += "_fbuild.tmp/worker/";
+#endif
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+ToolchainStore::~ToolchainStore() = default;
+
+// LoadManifest
+//------------------------------------------------------------------------------
+bool ToolchainStore::LoadManifest( ToolManifest & manifest )
+{
+    PROFILE_FUNCTION;
+
+    // Trim can't remove the toolchain until it has been loaded and touched
+    MutexHolder mh( m_Mutex );
+
+    AStackString manifestPath;
+    GetManifestPath( manifest.GetToolId(), manifestPath );
+
+    FileStream fs;
+    if ( fs.Open( manifestPath.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false; // Not stored
+    }
+    const size_t size = (size_t)fs.GetFileSize();
+    UniquePtr<void, FreeDeletor> mem( ALLOC( size ) );
+    const bool readOk = ( fs.Read( mem.Get(), size ) == size );
+    fs.Close();
+
+    ConstMemoryStream ms( mem.Get(), size );
+    if ( ( readOk == false ) || ( manifest.DeserializeFromRemote( ms ) == false ) )
+    {
+        // Damaged, so get it from the client again
+        FileIO::FileDelete( manifestPath.Get() );
+        return false;
+    }
+
+    Touch( manifest );
+    m_NumManifestsLoaded.Increment();
+    return true;
+}
+
+// SaveManifest
+//------------------------------------------------------------------------------
+void ToolchainStore::SaveManifest( const ToolManifest & manifest ) const
+{
+    PROFILE_FUNCTION;
+
+    AStackString manifestPath;
+    GetManifestPath( manifest.GetToolId(), manifestPath );
+
+    MemoryStream ms;
+    manifest.SerializeForRemote( ms );
+
+    // Write to a temp file and rename, so a partially written manifest is
+    // never seen by a later session
+    if ( FileIO::EnsurePathExists( m_Path ) == false )
+    {
+        return;
+    }
+    AStackString tmpPath( manifestPath );
+    tmpPath += ".tmp";
+    FileStream fs;
+    if ( fs.Open( tmpPath.Get(), FileStream::WRITE_ONLY ) == false )
+    {
+        return;
+    }
+    const bool writeOk = ( fs.Write( ms.GetData(), ms.GetSize() ) == ms.GetSize() );
+    fs.Close();
+    if ( ( writeOk == false ) || ( FileIO::FileMove( tmpPath, manifestPath ) == false ) )
+    {
+        FileIO::FileDelete( tmpPath.Get() );
+    }
+}
+
+// Touch
+//------------------------------------------------------------------------------
+void ToolchainStore::Touch( const ToolManifest & manifest ) const
+{
+    AStackString manifestPath;
+    GetManifestPath( manifest.GetToolId(), manifestPath );
+    FileIO::SetFileLastWriteTimeToNow( manifestPath );
+}
+
+// Trim
+//------------------------------------------------------------------------------
+void ToolchainStore::Trim( const Array<uint64_t> & toolIdsInUse,
+                           const Array<uint64_t> & chunkHashesInUse,
+                           uint64_t usedSinceTime,
+                           const AString & chunkPath ) const
+{
+    if ( s_MaxSizeMiB == 0 )
+    {
+        return; // Unlimited
+    }
+
+    PROFILE_FUNCTION;
+
+    // Everything in the store
+    Array<FileIO::FileInfo> files;
+    FileIO::GetFilesEx( m_Path, nullptr, true, &files );
+
+    // Group files by toolchain. Each chunk is a separate item.
+    Array<StoreItem> items;
+    UnorderedMap<uint64_t, size_t> toolchainItems; // ToolId -> index in items
+    uint64_t totalSize = 0; // Of files we own (others are never removed)
+    const AStackString toolchainPrefix( "toolchain." );
+    for ( const FileIO::FileInfo & file : files )
+    {
+        if ( file.m_Name.BeginsWith( chunkPath ) )
+        {
+            // Chunks are named by their hash
+            char * end = nullptr;
+            const uint64_t hash = strtoull( file.m_Name.Get() + chunkPath.GetLength(), &end, 16 );
+            if ( *end != 0 )
+            {
+                continue; // Not ours
+            }
+            StoreItem & item = items.EmplaceBack();
+            item.m_ChunkHash = hash;
+            item.m_LastUseTime = file.m_LastWriteTime;
+            item.m_Size = file.m_Size;
+            item.m_Files.Append( file );
+            totalSize += file.m_Size;
+            continue;
+        }
+
+        // Toolchain files are in "toolchain.<toolId>/" or are "toolchain.<toolId>.manifest"
+        const char * relativePath = ( file.m_Name.Get() + m_Path.GetLength() );
+        if ( AString::StrNCmp( relativePath, toolchainPrefix.Get(), toolchainPrefix.GetLength() ) != 0 )
+        {
+            continue; // Not ours
+        }
+        char * end = nullptr;
+        const uint64_t toolId = strtoull( relativePath + toolchainPrefix.GetLength(), &end, 16 );
+        if ( ( toolId == 0 ) || ( ( *end != NATIVE_SLASH ) && ( *end != '.' ) ) )
+        {
+            continue; // Not ours
+        }
+
+        const UnorderedMap<uint64_t, size_t>::KeyValue * existing = toolchainItems.Find( toolId );
+        const size_t itemIndex = existing ? existing->m_Value : items.GetSize();
+        if ( existing == nullptr )
+        {
+            items.EmplaceBack().m_ToolId = toolId;
+            toolchainItems.Insert( toolId, itemIndex );
+        }
+        StoreItem & item = items[ itemIndex ];
+        item.m_LastUseTime = Math::Max( item.m_LastUseTime, file.m_LastWriteTime );
+        item.m_Size += file.m_Size;
+        item.m_Files.Append( file );
+        totalSize += file.m_Size;
+    }
+
+    const uint64_t maxSize = ( (uint64_t)s_MaxSizeMiB * MEGABYTE );
+    if ( totalSize <= maxSize )
+    {
+        return;
+    }
+
+    UnorderedMap<uint64_t, bool> chunksInUse;
+    for ( const uint64_t hash : chunkHashesInUse )
+    {
+        if ( chunksInUse.Find( hash ) == nullptr ) // Toolchains can share chunks
+        {
+            chunksInUse.Insert( hash, true );
+        }
+    }
+
+    // Remove least recently used first
+    items.Sort( []( const StoreItem & a, const StoreItem & b ) { return ( a.m_LastUseTime < b.m_LastUseTime ); } );
+    for ( const StoreItem & item : items )
+    {
+        if ( totalSize <= maxSize )
+        {
+            break;
+        }
+        if ( item.m_ToolId && toolIdsInUse.Find( item.m_ToolId ) )
+        {
+            continue; // Can't remove toolchains being used
+        }
+        if ( ( item.m_ToolId == 0 ) && chunksInUse.Find( item.m_ChunkHash ) )
+        {
+            continue; // Can't remove chunks a toolchain being synchronized needs
+        }
+        if ( item.m_LastUseTime >= usedSinceTime )
+        {
+            continue; // Used since the in-use lists were gathered
+        }
+
+        // Loading a manifest touches it, so checking again and deleting under
+        // the lock ensures a toolchain can't be removed while being loaded
+        MutexHolder mh( m_Mutex );
+        if ( GetLastUseTime( item.m_ToolId, item.m_Files[ 0 ].m_Name ) >= usedSinceTime )
+        {
+            continue; // Used during the scan
+        }
+
+        // Some files may be in use (i.e. by another worker process), so only
+        // those actually removed count
+        bool deletedAll = true;
+        for ( const FileIO::FileInfo & file : item.m_Files )
+        {
+            if ( FileIO::FileDelete( file.m_Name.Get() ) )
+            {
+                totalSize -= file.m_Size;
+            }
+            else
+            {
+                deletedAll = false;
+            }
+        }
+        if ( deletedAll == false )
+        {
+            continue;
+        }
+
+        // Remove toolchain directories, deepest first
+        if ( item.m_ToolId )
+        {
+            Array<AString> dirs;
+            for ( const FileIO::FileInfo & file : item.m_Files )
+            {
+                const char * lastSlash = file.m_Name.FindLast( NATIVE_SLASH );
+                for ( AStackString dir( file.m_Name.Get(), lastSlash ); dir.GetLength() > m_Path.GetLength(); )
+                {
+                    if ( dirs.Find( dir ) == nullptr )
+                    {
+                        dirs.Append( dir );
+                    }
+                    const char * parentSlash = dir.FindLast( NATIVE_SLASH );
+                    dir.SetLength( (uint32_t)( parentSlash - dir.Get() ) );
+                }
+            }
+            dirs.Sort( []( const AString & a, const AString & b ) { return ( a.GetLength() > b.GetLength() ); } );
+            for ( const AString & dir : dirs )
+            {
+                FileIO::DirectoryDelete( dir );
+            }
+        }
+
+        FLOG_VERBOSE( "Removed %s from worker toolchain store (%u KiB)\n", item.m_ToolId ? "toolchain" : "chunk", (uint32_t)( item.m_Size / KILOBYTE ) );
+    }
+}
+
+// GetManifestPath
+//------------------------------------------------------------------------------
+void ToolchainStore::GetManifestPath( uint64_t toolId, AString & outPath ) const
+{
+    outPath.Format( "%stoolchain.%016" PRIx64 ".manifest", m_Path.Get(), toolId );
+}
+
+// GetLastUseTime
+//------------------------------------------------------------------------------
+uint64_t ToolchainStore::GetLastUseTime( uint64_t toolId, const AString & chunkFile ) const
+{
+    // Uses of a toolchain touch its manifest, and uses of a chunk touch the chunk
+    if ( toolId == 0 )
+    {
+        return FileIO::GetFileLastWriteTime( chunkFile );
+    }
+    AStackString manifestPath;
+    GetManifestPath( toolId, manifestPath );
+    return FileIO::GetFileLastWriteTime( manifestPath );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,66 @@
+// ToolchainStore
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ToolManifest;
+
+// ToolchainStore
+//  - Toolchains synchronized by a worker, kept on disk so they can be used
+//    again after the worker restarts without asking the client for them
+//  - Each toolchain is a directory of files, with the manifest stored next
+//    to it (the manifest's time stamp records when it was last used)
+//  - Least recently used toolchains and chunks (by manifest and chunk time
+//    stamps) are removed to stay within a size limit
+//------------------------------------------------------------------------------
+class ToolchainStore
+{
+public:
+    explicit ToolchainStore();
+    ~ToolchainStore();
+
+    // Restore a previously stored manifest (files are verified as the
+    // manifest is deserialized, so only missing files need synchronizing)
+    bool LoadManifest( ToolManifest & manifest );
+    void SaveManifest( const ToolManifest & manifest ) const;
+    void Touch( const ToolManifest & manifest ) const;
+
+    // Remove least recently used items until within the size limit
+    //  - Toolchains and chunks in use are kept, as are those used at or after
+    //    usedSinceTime (when the in-use lists were gathered), so new uses can
+    //    start during the call
+    //  - Each item is re-checked and removed under the same lock LoadManifest
+    //    holds, so a toolchain being loaded is never removed
+    void Trim( const Array<uint64_t> & toolIdsInUse,
+               const Array<uint64_t> & chunkHashesInUse,
+               uint64_t usedSinceTime,
+               const AString & chunkPath ) const;
+
+    // Stats
+    uint32_t GetNumManifestsLoaded() const { return m_NumManifestsLoaded.Load(); }
+
+    // Size limit (0 means unlimited)
+    static void SetMaxSizeMiB( uint32_t maxSizeMiB ) { s_MaxSizeMiB = maxSizeMiB; }
+    static uint32_t GetMaxSizeMiB() { return s_MaxSizeMiB; }
+
+private:
+    void GetManifestPath( uint64_t toolId, AString & outPath ) const;
+    uint64_t GetLastUseTime( uint64_t toolId, const AString & chunkFile ) const;
+
+    AString m_Path;
+    mutable Mutex m_Mutex; // Serializes loading manifests with removing items
+    Atomic<uint32_t> m_NumManifestsLoaded;
+
+    static uint32_t s_MaxSizeMiB;
+};
+
+//------------------------------------------------------------------------------
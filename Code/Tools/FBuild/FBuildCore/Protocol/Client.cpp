@@ -13,6 +13,8 @@
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include "Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
@@ -114,13 +116,19 @@ private:
     virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
 
     void Process( const Protocol::MsgRequestJob * msg );
+    void Process( const Protocol::MsgRequestJobs * msg );
     void Process( const Protocol::MsgJobResult *, const void * payload, size_t payloadSize );
     void Process( const Protocol::MsgJobResultCompressed * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestManifest * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestFile * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestFileChunks * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestChunks * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestDictionary * msg );
     void Process( const Protocol::MsgConnectionAck * msg );
 
     void ProcessJobResultCommon( bool isCompressed, const void * payload, size_t payloadSize );
+    uint32_t SendJobs( uint32_t maxJobs );
+    void SendJob( Job * job );
 
     const ToolManifest * FindManifest( uint64_t toolId ) const;
     bool WriteFileToDisk( const AString & fileName, const MultiBuffer & multiBuffer, size_t index ) const;
@@ -512,6 +520,12 @@ void Client::CommunicateJobAvailability()
             Process( msg );
             break;
         }
+        case Protocol::MSG_REQUEST_JOBS:
+        {
+            const Protocol::MsgRequestJobs * msg = static_cast<const Protocol::MsgRequestJobs *>( imsg );
+            Process( msg );
+            break;
+        }
         case Protocol::MSG_JOB_RESULT:
         {
             const Protocol::MsgJobResult * msg = static_cast<const Protocol::MsgJobResult *>( imsg );
@@ -536,6 +550,24 @@ void Client::CommunicateJobAvailability()
             Process( connection, msg );
             break;
         }
+        case Protocol::MSG_REQUEST_FILE_CHUNKS:
+        {
+            const Protocol::MsgRequestFileChunks * msg = static_cast<const Protocol::MsgRequestFileChunks *>( imsg );
+            Process( connection, msg );
+            break;
+        }
+        case Protocol::MSG_REQUEST_CHUNKS:
+        {
+            const Protocol::MsgRequestChunks * msg = static_cast<const Protocol::MsgRequestChunks *>( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_REQUEST_DICTIONARY:
+        {
+            const Protocol::MsgRequestDictionary * msg = static_cast<const Protocol::MsgRequestDictionary *>( imsg );
+            Process( connection, msg );
+            break;
+        }
         case Protocol::MSG_CONNECTION_ACK:
         {
             const Protocol::MsgConnectionAck * msg = static_cast<const Protocol::MsgConnectionAck *>( imsg );
@@ -564,31 +596,75 @@ void ClientToWorkerConnection::Process( const Protocol::MsgRequestJob * )
 {
     PROFILE_SECTION( "MsgRequestJob" );
 
+    if ( SendJobs( 1 ) == 0 )
+    {
+        PROFILE_SECTION( "NoJob" );
+        // tell the client we don't have anything right now
+        // (we completed or gave away the job already)
+        EnqueueSend( Protocol::MsgNoJobAvailable() );
+    }
+}
+
+// Process( MsgRequestJobs )
+//------------------------------------------------------------------------------
+void ClientToWorkerConnection::Process( const Protocol::MsgRequestJobs * msg )
+{
+    PROFILE_SECTION( "MsgRequestJobs" );
+
+    // Every credit must be answered with a job or returned, so the
+    // worker's count of in-flight requests remains consistent
+    const uint32_t numJobs = msg->GetNumJobs();
+    const uint32_t numJobsSent = SendJobs( numJobs );
+    if ( numJobsSent < numJobs )
+    {
+        PROFILE_SECTION( "NoJobs" );
+        EnqueueSend( Protocol::MsgNoJobsAvailable( numJobs - numJobsSent ) );
+    }
+}
+
+// SendJobs
+//------------------------------------------------------------------------------
+uint32_t ClientToWorkerConnection::SendJobs( uint32_t maxJobs )
+{
     // no jobs for deny listed workers
     if ( m_Worker->m_DenyListed )
     {
-        EnqueueSend( Protocol::MsgNoJobAvailable() );
-        return;
+        return 0;
     }
 
     // Some jobs require Server (Worker) changes which can be validated by
     // comparing the minor protocol version.
     const uint8_t workerMinorProtocolVersion = m_ProtocolVersionMinor.Load();
 
-    Job * job = JobQueue::Get().GetDistributableJobToProcess( true, workerMinorProtocolVersion );
+    StackArray<Job *> jobs;
+    if ( maxJobs == 1 )
+    {
+        Job * job = JobQueue::Get().GetDistributableJobToProcess( true, workerMinorProtocolVersion );
+        if ( job )
+        {
+            jobs.Append( job );
+        }
+    }
+    else
+    {
+        JobQueue::Get().GetDistributableJobsToProcess( workerMinorProtocolVersion, maxJobs, jobs );
+    }
 
-    if ( job == nullptr )
+    for ( Job * job : jobs )
     {
-        PROFILE_SECTION( "NoJob" );
-        // tell the client we don't have anything right now
-        // (we completed or gave away the job already)
-        EnqueueSend( Protocol::MsgNoJobAvailable() );
-        return;
+        SendJob( job );
     }
+    return static_cast<uint32_t>( jobs.GetSize() );
+}
 
+// SendJob
+//------------------------------------------------------------------------------
+void ClientToWorkerConnection::SendJob( Job * job )
+{
     // send the job to the client
     MemoryStream stream;
-    job->Serialize( stream );
+    const bool allowDictionary = ( m_ProtocolVersionMinor.Load() >= 8 ); // Dictionaries supported from v22.8
+    job->Serialize( stream, allowDictionary );
 
     MutexHolder mh( m_Mutex );
 
@@ -631,7 +707,8 @@ void ClientToWorkerConnection::Process( const Protocol::MsgRequestJob * )
     // Take note of the results compression level so we know to expect
     // compressed results
     const bool allowZstdUse = true; // We can accept Zstd results
-    job->SetResultCompressionLevel( resultCompressionLevel, allowZstdUse );
+    const bool allowFramedCompression = true; // We can accept chunked results
+    job->SetResultCompressionLevel( resultCompressionLevel, allowZstdUse, allowFramedCompression );
 
     EnqueueSend( Protocol::MsgJob( toolId, resultCompressionLevel ),
                  Move( ConstMemoryStream( Move( stream ) ) ) );
@@ -1111,6 +1188,94 @@ void ClientToWorkerConnection::Process( const ConnectionInfo * connection,
                  Move( ms ) );
 }
 
+// Process ( MsgRequestFileChunks )
+//------------------------------------------------------------------------------
+void ClientToWorkerConnection::Process( const ConnectionInfo * connection,
+                                        const Protocol::MsgRequestFileChunks * msg )
+{
+    PROFILE_SECTION( "MsgRequestFileChunks" );
+
+    // find a job associated with this client with this toolId
+    const uint64_t toolId = msg->GetToolId();
+    ASSERT( toolId != 0 ); // server should not request 'no sync' tool id
+    const ToolManifest * manifest = FindManifest( toolId );
+
+    MemoryStream ms;
+    if ( ( manifest == nullptr ) || ( manifest->GetFileChunkList( msg->GetFileId(), ms ) == false ) )
+    {
+        ASSERT( false ); // something is terribly wrong
+        Disconnect( connection );
+        return;
+    }
+
+    // Send chunk list to worker
+    EnqueueSend( Protocol::MsgFileChunks( toolId, msg->GetFileId() ),
+                 Move( ConstMemoryStream( Move( ms ) ) ) );
+}
+
+// Process ( MsgRequestChunks )
+//------------------------------------------------------------------------------
+void ClientToWorkerConnection::Process( const ConnectionInfo * connection,
+                                        const Protocol::MsgRequestChunks * msg,
+                                        const void * payload,
+                                        size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgRequestChunks" );
+
+    // find a job associated with this client with this toolId
+    const uint64_t toolId = msg->GetToolId();
+    ASSERT( toolId != 0 ); // server should not request 'no sync' tool id
+    const ToolManifest * manifest = FindManifest( toolId );
+
+    MemoryStream chunkData;
+    if ( ( manifest == nullptr ) || ( manifest->GetFileChunkData( msg->GetFileId(), payload, payloadSize, chunkData ) == false ) )
+    {
+        ASSERT( false ); // something is terribly wrong
+        Disconnect( connection );
+        return;
+    }
+
+    // Compress for transfer
+    Compressor c;
+    c.Compress( chunkData.GetData(), chunkData.GetSize() );
+    ConstMemoryStream ms;
+    ms.Replace( c.GetResult(), c.GetResultSize(), true ); // Take ownership
+    c.ReleaseResult();
+
+    // Send chunks to worker
+    EnqueueSend( Protocol::MsgChunks( toolId, msg->GetFileId() ),
+                 Move( ms ) );
+}
+
+// Process ( MsgRequestDictionary )
+//------------------------------------------------------------------------------
+void ClientToWorkerConnection::Process( const ConnectionInfo * connection,
+                                        const Protocol::MsgRequestDictionary * msg )
+{
+    PROFILE_SECTION( "MsgRequestDictionary" );
+
+    // Dictionaries are only requested for jobs we compressed with one
+    const CompressionDictionaryTrainer * trainer = FBuild::Get().GetCompressionDictionaryTrainer();
+    const CompressionDictionary * dictionary = trainer ? trainer->GetDictionary() : nullptr;
+    if ( ( dictionary == nullptr ) || ( dictionary->GetId() != msg->GetDictionaryId() ) )
+    {
+        ASSERT( false ); // this indicates a logic bug
+        Disconnect( connection );
+        return;
+    }
+
+    // Compress for transfer
+    Compressor c;
+    c.Compress( dictionary->GetData(), dictionary->GetSize() );
+    ConstMemoryStream ms;
+    ms.Replace( c.GetResult(), c.GetResultSize(), true ); // Take ownership
+    c.ReleaseResult();
+
+    // Send dictionary to worker
+    EnqueueSend( Protocol::MsgDictionary( dictionary->GetId() ),
+                 Move( ms ) );
+}
+
 // FindManifest
 //------------------------------------------------------------------------------
 const ToolManifest * ClientToWorkerConnection::FindManifest( uint64_t toolId ) const
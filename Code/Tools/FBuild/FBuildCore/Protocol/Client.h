@@ -29,8 +29,12 @@ namespace Protocol
     class MsgJobResult;
     class MsgJobResultCompressed;
     class MsgRequestJob;
+    class MsgRequestJobs;
     class MsgRequestManifest;
+    class MsgRequestDictionary;
+    class MsgRequestChunks;
     class MsgRequestFile;
+    class MsgRequestFileChunks;
     class MsgServerStatus;
 }
 class ToolManifest;
@@ -42,6 +42,14 @@ const char * GetProtocolMessageDebugName( Protocol::MessageType msgType )
         "File",
         "JobResultCompressed",
         "ConnectionAck",
+        "RequestJobs",
+        "NoJobsAvailable",
+        "RequestDictionary",
+        "Dictionary",
+        "RequestFileChunks",
+        "FileChunks",
+        "RequestChunks",
+        "Chunks",
     };
     // clang-format on
     static_assert( ( sizeof( msgNames ) / sizeof( const char * ) ) == Protocol::NUM_MESSAGES, "msgNames item count doesn't match NUM_MESSAGES" );
@@ -154,6 +162,22 @@ Protocol::MsgNoJobAvailable::MsgNoJobAvailable()
 {
 }
 
+// MsgRequestJobs
+//------------------------------------------------------------------------------
+Protocol::MsgRequestJobs::MsgRequestJobs( uint32_t numJobs )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_JOBS, sizeof( MsgRequestJobs ), false )
+    , m_NumJobs( numJobs )
+{
+}
+
+// MsgNoJobsAvailable
+//------------------------------------------------------------------------------
+Protocol::MsgNoJobsAvailable::MsgNoJobsAvailable( uint32_t numJobs )
+    : Protocol::IMessage( Protocol::MSG_NO_JOBS_AVAILABLE, sizeof( MsgNoJobsAvailable ), false )
+    , m_NumJobs( numJobs )
+{
+}
+
 // MsgJob
 //------------------------------------------------------------------------------
 Protocol::MsgJob::MsgJob( uint64_t toolId, int16_t resultCompressionLevel )
@@ -197,6 +221,22 @@ Protocol::MsgManifest::MsgManifest( uint64_t toolId )
     memset( m_Padding2, 0, sizeof( m_Padding2 ) );
 }
 
+// MsgRequestDictionary
+//------------------------------------------------------------------------------
+Protocol::MsgRequestDictionary::MsgRequestDictionary( uint32_t dictionaryId )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_DICTIONARY, sizeof( MsgRequestDictionary ), false )
+    , m_DictionaryId( dictionaryId )
+{
+}
+
+// MsgDictionary
+//------------------------------------------------------------------------------
+Protocol::MsgDictionary::MsgDictionary( uint32_t dictionaryId )
+    : Protocol::IMessage( Protocol::MSG_DICTIONARY, sizeof( MsgDictionary ), true )
+    , m_DictionaryId( dictionaryId )
+{
+}
+
 // MsgRequestFile
 //------------------------------------------------------------------------------
 Protocol::MsgRequestFile::MsgRequestFile( uint64_t toolId, uint32_t fileId )
@@ -215,4 +255,40 @@ Protocol::MsgFile::MsgFile( uint64_t toolId, uint32_t fileId )
 {
 }
 
+// MsgRequestFileChunks
+//------------------------------------------------------------------------------
+Protocol::MsgRequestFileChunks::MsgRequestFileChunks( uint64_t toolId, uint32_t fileId )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_FILE_CHUNKS, sizeof( MsgRequestFileChunks ), false )
+    , m_FileId( fileId )
+    , m_ToolId( toolId )
+{
+}
+
+// MsgFileChunks
+//------------------------------------------------------------------------------
+Protocol::MsgFileChunks::MsgFileChunks( uint64_t toolId, uint32_t fileId )
+    : Protocol::IMessage( Protocol::MSG_FILE_CHUNKS, sizeof( MsgFileChunks ), true )
+    , m_FileId( fileId )
+    , m_ToolId( toolId )
+{
+}
+
+// MsgRequestChunks
+//------------------------------------------------------------------------------
+Protocol::MsgRequestChunks::MsgRequestChunks( uint64_t toolId, uint32_t fileId )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_CHUNKS, sizeof( MsgRequestChunks ), true )
+    , m_FileId( fileId )
+    , m_ToolId( toolId )
+{
+}
+
+// MsgChunks
+//------------------------------------------------------------------------------
+Protocol::MsgChunks::MsgChunks( uint64_t toolId, uint32_t fileId )
+    : Protocol::IMessage( Protocol::MSG_CHUNKS, sizeof( MsgChunks ), true )
+    , m_FileId( fileId )
+    , m_ToolId( toolId )
+{
+}
+
 //------------------------------------------------------------------------------
@@ -32,7 +32,7 @@ namespace Protocol
 
     // Protocol Version
     inline static const uint32_t kVersionMajor = 22; // Changes here make workers incompatible
-    inline static const uint8_t kVersionMinor = 5; // Changes must be forwards and backwards compatible
+    inline static const uint8_t kVersionMinor = 9; // Changes must be forwards and backwards compatible
 
     inline static const uint16_t kTestPort = kPort + 1; // Different port for use by tests
 
@@ -65,6 +65,22 @@ namespace Protocol
 
         // v22.5 or later support /dynamicdeopt for MSVC 2022 v17.44.x or later
 
+        // v22.6 or later
+        MSG_REQUEST_JOBS = 13,// Server -> Client : Ask for several jobs to do (credits)
+        MSG_NO_JOBS_AVAILABLE = 14,// Server <- Client : Return credits for which no jobs are available
+
+        // v22.7 or later supports framed compression (no packet changes)
+
+        // v22.8 or later
+        MSG_REQUEST_DICTIONARY = 15,// Server -> Client : Ask client for the compression dictionary used by a job
+        MSG_DICTIONARY = 16,// Server <- Client : Respond with the dictionary
+
+        // v22.9 or later
+        MSG_REQUEST_FILE_CHUNKS = 17,// Server -> Client : Ask client for the list of chunks in a file
+        MSG_FILE_CHUNKS = 18,// Server <- Client : Respond with the chunk list
+        MSG_REQUEST_CHUNKS = 19,// Server -> Client : Ask client for chunks the server doesn't have
+        MSG_CHUNKS = 20,// Server <- Client : Send the requested chunks
+
         NUM_MESSAGES            // leave last
     };
 }
@@ -172,6 +188,34 @@ namespace Protocol
     };
     static_assert( sizeof( MsgNoJobAvailable ) == sizeof( IMessage ), "MsgNoJobAvailable message has incorrect size" );
 
+    // MsgRequestJobs
+    //------------------------------------------------------------------------------
+    class MsgRequestJobs : public IMessage
+    {
+    public:
+        explicit MsgRequestJobs( uint32_t numJobs );
+
+        uint32_t GetNumJobs() const { return m_NumJobs; }
+
+    private:
+        uint32_t m_NumJobs;
+    };
+    static_assert( sizeof( MsgRequestJobs ) == sizeof( IMessage ) + 4, "MsgRequestJobs message has incorrect size" );
+
+    // MsgNoJobsAvailable
+    //------------------------------------------------------------------------------
+    class MsgNoJobsAvailable : public IMessage
+    {
+    public:
+        explicit MsgNoJobsAvailable( uint32_t numJobs );
+
+        uint32_t GetNumJobs() const { return m_NumJobs; }
+
+    private:
+        uint32_t m_NumJobs;
+    };
+    static_assert( sizeof( MsgNoJobsAvailable ) == sizeof( IMessage ) + 4, "MsgNoJobsAvailable message has incorrect size" );
+
     // MsgJob
     //------------------------------------------------------------------------------
     class MsgJob : public IMessage
@@ -237,6 +281,34 @@ namespace Protocol
     };
     static_assert( sizeof( MsgManifest ) == sizeof( IMessage ) + 4 /*alignment*/ + 8, "MsgManifest message has incorrect size" );
 
+    // MsgRequestDictionary
+    //------------------------------------------------------------------------------
+    class MsgRequestDictionary : public IMessage
+    {
+    public:
+        explicit MsgRequestDictionary( uint32_t dictionaryId );
+
+        uint32_t GetDictionaryId() const { return m_DictionaryId; }
+
+    private:
+        uint32_t m_DictionaryId;
+    };
+    static_assert( sizeof( MsgRequestDictionary ) == sizeof( IMessage ) + 4, "MsgRequestDictionary message has incorrect size" );
+
+    // MsgDictionary
+    //------------------------------------------------------------------------------
+    class MsgDictionary : public IMessage
+    {
+    public:
+        explicit MsgDictionary( uint32_t dictionaryId );
+
+        uint32_t GetDictionaryId() const { return m_DictionaryId; }
+
+    private:
+        uint32_t m_DictionaryId;
+    };
+    static_assert( sizeof( MsgDictionary ) == sizeof( IMessage ) + 4, "MsgDictionary message has incorrect size" );
+
     // MsgRequestFile
     //------------------------------------------------------------------------------
     class MsgRequestFile : public IMessage
@@ -269,6 +341,70 @@ namespace Protocol
     };
     static_assert( sizeof( MsgFile ) == sizeof( IMessage ) + 12, "MsgFile message has incorrect size" );
 
+    // MsgRequestFileChunks
+    //------------------------------------------------------------------------------
+    class MsgRequestFileChunks : public IMessage
+    {
+    public:
+        MsgRequestFileChunks( uint64_t toolId, uint32_t fileId );
+
+        uint64_t GetToolId() const { return m_ToolId; }
+        uint32_t GetFileId() const { return m_FileId; }
+
+    private:
+        uint32_t m_FileId;
+        uint64_t m_ToolId;
+    };
+    static_assert( sizeof( MsgRequestFileChunks ) == sizeof( IMessage ) + 12, "MsgRequestFileChunks message has incorrect size" );
+
+    // MsgFileChunks
+    //------------------------------------------------------------------------------
+    class MsgFileChunks : public IMessage
+    {
+    public:
+        MsgFileChunks( uint64_t toolId, uint32_t fileId );
+
+        uint64_t GetToolId() const { return m_ToolId; }
+        uint32_t GetFileId() const { return m_FileId; }
+
+    private:
+        uint32_t m_FileId;
+        uint64_t m_ToolId;
+    };
+    static_assert( sizeof( MsgFileChunks ) == sizeof( IMessage ) + 12, "MsgFileChunks message has incorrect size" );
+
+    // MsgRequestChunks
+    //------------------------------------------------------------------------------
+    class MsgRequestChunks : public IMessage
+    {
+    public:
+        MsgRequestChunks( uint64_t toolId, uint32_t fileId );
+
+        uint64_t GetToolId() const { return m_ToolId; }
+        uint32_t GetFileId() const { return m_FileId; }
+
+    private:
+        uint32_t m_FileId;
+        uint64_t m_ToolId;
+    };
+    static_assert( sizeof( MsgRequestChunks ) == sizeof( IMessage ) + 12, "MsgRequestChunks message has incorrect size" );
+
+    // MsgChunks
+    //------------------------------------------------------------------------------
+    class MsgChunks : public IMessage
+    {
+    public:
+        MsgChunks( uint64_t toolId, uint32_t fileId );
+
+        uint64_t GetToolId() const { return m_ToolId; }
+        uint32_t GetFileId() const { return m_FileId; }
+
+    private:
+        uint32_t m_FileId;
+        uint64_t m_ToolId;
+    };
+    static_assert( sizeof( MsgChunks ) == sizeof( IMessage ) + 12, "MsgChunks message has incorrect size" );
+
     // MsgServerStatus
     //------------------------------------------------------------------------------
     class MsgServerStatus : public IMessage
@@ -7,6 +7,8 @@
 #include "Protocol.h"
 
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
@@ -20,13 +22,14 @@
 #include "Core/Process/Atomic.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
 
 // Defines
 //------------------------------------------------------------------------------
-#if defined( __OSX__ ) || defined( __LINUX__ )
-    // Touch files every 4 hours
-    #define SERVER_TOOLCHAIN_TIMESTAMP_REFRESH_INTERVAL_SECS ( 60.0f * 60.0f * 4.0f )
-#endif
+// Touch files every 4 hours
+#define SERVER_TOOLCHAIN_TIMESTAMP_REFRESH_INTERVAL_SECS ( 60.0f * 60.0f * 4.0f )
+// Keep toolchain store within size limit
+#define SERVER_TOOLCHAIN_STORE_TRIM_INTERVAL_SECS ( 60.0f * 10.0f )
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
@@ -37,7 +40,10 @@ Server::Server( uint32_t numThreadsInJobQueue )
 
     const uint32_t numCores = numThreadsInJobQueue ? numThreadsInJobQueue
                                                    : CPUInfo::Get().GetNumUsefulCores();
-    m_JobQueueRemote = FNEW( JobQueueRemote( numCores ) );
+    m_JobQueueRemote = FNEW( JobQueueRemote( numCores, m_ResultCache.IsEnabled() ? &m_ResultCache : nullptr ) );
+
+    // Make space for new toolchains
+    TrimToolchainStore();
 
     m_Thread.Start( ThreadFuncStatic, "Server", this );
 }
@@ -176,6 +182,12 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             delete job;
         }
 
+        // release dictionaries (freed once no in-progress job references them)
+        for ( const CompressionDictionary * dictionary : cs->m_Dictionaries )
+        {
+            dictionary->Release();
+        }
+
         FDELETE cs;
     }
 }
@@ -235,6 +247,12 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             Process( connection, msg );
             break;
         }
+        case Protocol::MSG_NO_JOBS_AVAILABLE:
+        {
+            const Protocol::MsgNoJobsAvailable * msg = static_cast<const Protocol::MsgNoJobsAvailable *>( imsg );
+            Process( connection, msg );
+            break;
+        }
         case Protocol::MSG_JOB:
         {
             const Protocol::MsgJob * msg = static_cast<const Protocol::MsgJob *>( imsg );
@@ -253,6 +271,24 @@ bool Server::IsSynchingTool( AString & statusStr ) const
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_FILE_CHUNKS:
+        {
+            const Protocol::MsgFileChunks * msg = static_cast<const Protocol::MsgFileChunks *>( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_CHUNKS:
+        {
+            const Protocol::MsgChunks * msg = static_cast<const Protocol::MsgChunks *>( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_DICTIONARY:
+        {
+            const Protocol::MsgDictionary * msg = static_cast<const Protocol::MsgDictionary *>( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
         default:
         {
             // unknown message type
@@ -330,6 +366,16 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgNoJo
     cs->m_NumJobsRequested.Decrement();
 }
 
+// Process( MsgNoJobsAvailable )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgNoJobsAvailable * msg )
+{
+    // We requested several jobs, but the client didn't have enough
+    ClientState * cs = (ClientState *)connection->GetUserData();
+    ASSERT( cs->m_NumJobsRequested.Load() >= msg->GetNumJobs() );
+    cs->m_NumJobsRequested.Sub( msg->GetNumJobs() );
+}
+
 // Process( MsgJob )
 //------------------------------------------------------------------------------
 void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob * msg, const void * payload, size_t payloadSize )
@@ -349,10 +395,29 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob
         job->SetUserData( cs );
 
         // Take not of client support requirements
-        // - Zstd suport can become unconditional if protocol compatibility is broken
+        // - Zstd and chunked compression support can become unconditional if protocol compatibility is broken
         static_assert( Protocol::kVersionMajor == 22 );
         const bool allowZstdUse = ( cs->m_ProtocolVersionMinor >= 4 );
-        job->SetResultCompressionLevel( msg->GetResultCompressionLevel(), allowZstdUse );
+        const bool allowFramedCompression = ( cs->m_ProtocolVersionMinor >= 7 );
+        job->SetResultCompressionLevel( msg->GetResultCompressionLevel(), allowZstdUse, allowFramedCompression );
+
+        // Find the dictionary needed to decompress the job, requesting it once
+        // from the client if we don't have it
+        const uint32_t dictionaryId = GetDictionaryIdForJob( job );
+        if ( dictionaryId )
+        {
+            const CompressionDictionary * const * found = cs->m_Dictionaries.FindDeref( dictionaryId );
+            if ( found )
+            {
+                job->SetCompressionDictionary( *found );
+            }
+            else if ( cs->m_RequestedDictionaries.Find( dictionaryId ) == nullptr )
+            {
+                cs->m_RequestedDictionaries.Append( dictionaryId );
+                const Protocol::MsgRequestDictionary reqMsg( dictionaryId );
+                reqMsg.Send( connection );
+            }
+        }
 
         // Get ToolId
         const uint64_t toolId = msg->GetToolId();
@@ -371,17 +436,18 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob
                 // Is tool fully synchronized?
                 if ( manifest->IsSynchronized() )
                 {
-                    // we have all the files - we can do the job
-                    JobQueueRemote::Get().QueueJob( job );
-                    return;
+                    // we have all the files - we can do the job (if not waiting for a dictionary)
+                    if ( IsDictionaryReady( job ) )
+                    {
+                        JobQueueRemote::Get().QueueJob( job );
+                        return;
+                    }
                 }
-
-                // If we have an associated connection, we're already synchronizing
-                // on that connection and don't need to do anything.
-                // That may be a connection to another client or to the same client
-                const bool isSynchronizing = ( manifest->GetUserData() != nullptr );
-                if ( isSynchronizing )
+                else if ( manifest->GetUserData() != nullptr )
                 {
+                    // If we have an associated connection, we're already synchronizing
+                    // on that connection and don't need to do anything.
+                    // That may be a connection to another client or to the same client
                     // We just need to wait for synchronization to complete
                 }
                 else
@@ -412,13 +478,35 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob
 
                 // create manifest object
                 manifest = FNEW( ToolManifest( toolId ) );
-                manifest->SetUserData( (void *)connection ); // This connection owns synchronization
                 job->SetToolManifest( manifest );
                 m_Tools.Append( manifest );
 
-                // request manifest of tool chain
-                const Protocol::MsgRequestManifest reqMsg( toolId );
-                reqMsg.Send( connection );
+                // use the toolchain from a previous session if we have it
+                if ( m_ToolchainStore.LoadManifest( *manifest ) )
+                {
+                    if ( manifest->IsSynchronized() )
+                    {
+                        if ( IsDictionaryReady( job ) )
+                        {
+                            JobQueueRemote::Get().QueueJob( job );
+                            return;
+                        }
+                    }
+                    else
+                    {
+                        // Some files were removed - request them
+                        manifest->SetUserData( (void *)connection ); // This connection owns synchronization
+                        RequestMissingFiles( connection, manifest );
+                    }
+                }
+                else
+                {
+                    manifest->SetUserData( (void *)connection ); // This connection owns synchronization
+
+                    // request manifest of tool chain
+                    const Protocol::MsgRequestManifest reqMsg( toolId );
+                    reqMsg.Send( connection );
+                }
             }
 
             // can't start job yet - put it on hold
@@ -469,6 +557,9 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgMani
             Disconnect( connection );
             return;
         }
+
+        // Keep for future sessions
+        m_ToolchainStore.SaveManifest( *manifest );
     }
 
     // manifest has checked local files, from previous sessions and may
@@ -504,44 +595,103 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFile
         bool corruptData = false;
         if ( manifest->ReceiveFileData( fileId, payload, payloadSize, corruptData ) == false )
         {
-            if ( corruptData )
-            {
-                // NOTE: In clients prior to v1.07 a bug could cause MsgManifest messages to be
-                //       corrupt and for deserialization to corrupt internal state.
-                //       To maintain backwards compatibility we detect this case and disconnect
-                //       the worker (which can retry connecting).
-                //       The bug has been fixed so should not happen with latest code (only
-                //       when dealing with backwards compatibility with old workers)
-                // If we ever break protocol compatibility, we can remove special handling
-                static_assert( Protocol::kVersionMajor == 22, "Remove backwards compat shims" );
-
-                // This should not happen with latest code so we want to catch that when
-                // debugging
-                ASSERT( false && "MsgFile corrupt" );
-
-                // Disconnect to handle old workers misbehaving
-                ClientState * cs = (ClientState *)connection->GetUserData();
-                AStackString remoteAddr;
-                TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), remoteAddr );
-                FLOG_WARN( "Disconnecting '%s' (%s) due to corrupt MsgFile (Client protocol %u.%u)\n",
-                           remoteAddr.Get(),
-                           cs->m_HostName.Get(),
-                           Protocol::kVersionMajor,
-                           cs->m_ProtocolVersionMinor );
-            }
-            else
+            // NOTE: In clients prior to v1.07 a bug could cause MsgManifest messages to be
+            //       corrupt and for deserialization to corrupt internal state.
+            //       To maintain backwards compatibility we detect this case and disconnect
+            //       the worker (which can retry connecting).
+            //       The bug has been fixed so should not happen with latest code (only
+            //       when dealing with backwards compatibility with old workers)
+            // If we ever break protocol compatibility, we can remove special handling
+            static_assert( Protocol::kVersionMajor == 22, "Remove backwards compat shims" );
+            OnReceiveFileFailed( connection, manifest, fileId, corruptData, "MsgFile" );
+            return;
+        }
+
+        if ( manifest->IsSynchronized() == false )
+        {
+            // wait for more files
+            return;
+        }
+        manifest->SetUserData( nullptr );
+    }
+
+    // ToolChain is now synchronized
+    // Allow any jobs that were waiting on it to start
+    CheckWaitingJobs( manifest );
+}
+
+// Process( MsgFileChunks )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFileChunks * msg, const void * payload, size_t payloadSize )
+{
+    const uint64_t toolId = msg->GetToolId();
+    const uint32_t fileId = msg->GetFileId();
+
+    ToolManifest * manifest = nullptr;
+    {
+        MutexHolder manifestMH( m_ToolManifestsMutex );
+
+        ToolManifest ** found = m_Tools.FindDeref( toolId );
+        ASSERT( found );
+        manifest = *found;
+        ASSERT( manifest->GetUserData() == connection );
+
+        // Use chunks we already have (from this or any other toolchain)
+        Array<uint32_t> missingChunks;
+        bool corruptData = false;
+        if ( manifest->ReceiveFileChunkList( fileId, payload, payloadSize, m_ChunkStore, missingChunks, corruptData ) == false )
+        {
+            OnReceiveFileFailed( connection, manifest, fileId, corruptData, "MsgFileChunks" );
+            return;
+        }
+
+        // Request the rest
+        if ( missingChunks.IsEmpty() == false )
+        {
+            MemoryStream ms;
+            ms.Write( (uint32_t)missingChunks.GetSize() );
+            for ( const uint32_t chunkIndex : missingChunks )
             {
-                // something went wrong storing the file
-                AStackString fileName;
-                manifest->GetRemoteFilePath( fileId, fileName );
-                FLOG_WARN( "Failed to store fileId %u for manifest 0x%" PRIx64 "\n"
-                           " - %s\n",
-                           fileId,
-                           toolId,
-                           fileName.Get() );
+                ms.Write( chunkIndex );
             }
+            const Protocol::MsgRequestChunks reqChunksMsg( toolId, fileId );
+            reqChunksMsg.Send( connection, ms );
+            return;
+        }
 
-            Disconnect( connection );
+        if ( manifest->IsSynchronized() == false )
+        {
+            // wait for more files
+            return;
+        }
+        manifest->SetUserData( nullptr );
+    }
+
+    // ToolChain is now synchronized
+    // Allow any jobs that were waiting on it to start
+    CheckWaitingJobs( manifest );
+}
+
+// Process( MsgChunks )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgChunks * msg, const void * payload, size_t payloadSize )
+{
+    const uint64_t toolId = msg->GetToolId();
+    const uint32_t fileId = msg->GetFileId();
+
+    ToolManifest * manifest = nullptr;
+    {
+        MutexHolder manifestMH( m_ToolManifestsMutex );
+
+        ToolManifest ** found = m_Tools.FindDeref( toolId );
+        ASSERT( found );
+        manifest = *found;
+        ASSERT( manifest->GetUserData() == connection );
+
+        bool corruptData = false;
+        if ( manifest->ReceiveFileChunks( fileId, payload, payloadSize, m_ChunkStore, corruptData ) == false )
+        {
+            OnReceiveFileFailed( connection, manifest, fileId, corruptData, "MsgChunks" );
             return;
         }
 
@@ -558,13 +708,126 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgFile
     CheckWaitingJobs( manifest );
 }
 
+// OnReceiveFileFailed
+//------------------------------------------------------------------------------
+void Server::OnReceiveFileFailed( const ConnectionInfo * connection,
+                                  const ToolManifest * manifest,
+                                  uint32_t fileId,
+                                  bool corruptData,
+                                  const char * msgName )
+{
+    if ( corruptData )
+    {
+        // This should not happen with latest code so we want to catch that when
+        // debugging
+        ASSERT( false && "File data corrupt" );
+
+        // Disconnect to handle old workers misbehaving
+        const ClientState * cs = (const ClientState *)connection->GetUserData();
+        AStackString remoteAddr;
+        TCPConnectionPool::GetAddressAsString( connection->GetRemoteAddress(), remoteAddr );
+        FLOG_WARN( "Disconnecting '%s' (%s) due to corrupt %s (Client protocol %u.%u)\n",
+                   remoteAddr.Get(),
+                   cs->m_HostName.Get(),
+                   msgName,
+                   Protocol::kVersionMajor,
+                   cs->m_ProtocolVersionMinor );
+    }
+    else
+    {
+        // something went wrong storing the file
+        AStackString fileName;
+        manifest->GetRemoteFilePath( fileId, fileName );
+        FLOG_WARN( "Failed to store fileId %u for manifest 0x%" PRIx64 "\n"
+                   " - %s\n",
+                   fileId,
+                   manifest->GetToolId(),
+                   fileName.Get() );
+    }
+
+    Disconnect( connection );
+}
+
+// Process( MsgDictionary )
+//------------------------------------------------------------------------------
+void Server::Process( const ConnectionInfo * connection, const Protocol::MsgDictionary * msg, const void * payload, size_t payloadSize )
+{
+    ClientState * cs = (ClientState *)connection->GetUserData();
+    const uint32_t dictionaryId = msg->GetDictionaryId();
+
+    // Only accept dictionaries we asked for (once), which are intact
+    CompressionDictionary * dictionary = nullptr;
+    {
+        MutexHolder mh( cs->m_Mutex );
+        Compressor c;
+        if ( cs->m_RequestedDictionaries.Find( dictionaryId ) &&
+             ( cs->m_Dictionaries.FindDeref( dictionaryId ) == nullptr ) &&
+             Compressor::IsValidData( payload, payloadSize ) &&
+             c.Decompress( payload ) )
+        {
+            dictionary = FNEW( CompressionDictionary );
+            dictionary->Load( c.GetResult(), c.GetResultSize() );
+            if ( dictionary->GetId() != dictionaryId )
+            {
+                dictionary->Release();
+                dictionary = nullptr;
+            }
+        }
+    }
+    if ( dictionary == nullptr )
+    {
+        ASSERT( false && "MsgDictionary corrupt" ); // this indicates a protocol bug
+        Disconnect( connection );
+        return;
+    }
+
+    // Allow any jobs that were waiting for it (and have a synchronized toolchain) to start
+    MutexHolder mh( cs->m_Mutex );
+    cs->m_Dictionaries.Append( dictionary );
+    const int32_t numJobs = (int32_t)cs->m_WaitingJobs.GetSize();
+    for ( int32_t i = ( numJobs - 1 ); i >= 0; --i )
+    {
+        Job * job = cs->m_WaitingJobs[ (size_t)i ];
+        if ( GetDictionaryIdForJob( job ) != dictionaryId )
+        {
+            continue;
+        }
+        job->SetCompressionDictionary( dictionary );
+        if ( job->GetToolManifest()->IsSynchronized() )
+        {
+            cs->m_WaitingJobs.EraseIndex( (size_t)i );
+            JobQueueRemote::Get().QueueJob( job );
+            PROTOCOL_DEBUG( "Server: Job %x can now be started\n", job );
+        }
+    }
+}
+
+// GetDictionaryIdForJob
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Server::GetDictionaryIdForJob( const Job * job )
+{
+    // Invalid data is reported when the job is built
+    if ( job->IsDataCompressed() && Compressor::IsValidData( job->GetData(), job->GetDataSize() ) )
+    {
+        return Compressor::GetDictionaryId( job->GetData(), job->GetDataSize() );
+    }
+    return 0;
+}
+
+// IsDictionaryReady
+//------------------------------------------------------------------------------
+/*static*/ bool Server::IsDictionaryReady( const Job * job )
+{
+    return ( job->GetCompressionDictionary() != nullptr ) || ( GetDictionaryIdForJob( job ) == 0 );
+}
+
 // CheckWaitingJobs
 //------------------------------------------------------------------------------
 void Server::CheckWaitingJobs( const ToolManifest * manifest )
 {
     // queue for start any jobs that may now be ready
 #ifdef ASSERTS_ENABLED
-    bool atLeastOneJobStarted = false;
+    bool atLeastOneJobWaiting = false;
 #endif
 
     {
@@ -583,12 +846,16 @@ void Server::CheckWaitingJobs( const ToolManifest * manifest )
                 ASSERT( manifestForThisJob );
                 if ( manifestForThisJob == manifest )
                 {
+#ifdef ASSERTS_ENABLED
+                    atLeastOneJobWaiting = true;
+#endif
+                    if ( IsDictionaryReady( job ) == false )
+                    {
+                        continue; // Will be started when the dictionary arrives
+                    }
                     cs->m_WaitingJobs.EraseIndex( (size_t)i );
                     JobQueueRemote::Get().QueueJob( job );
                     PROTOCOL_DEBUG( "Server: Job %x can now be started\n", job );
-#ifdef ASSERTS_ENABLED
-                    atLeastOneJobStarted = true;
-#endif
                 }
             }
         }
@@ -596,7 +863,7 @@ void Server::CheckWaitingJobs( const ToolManifest * manifest )
 
     // We should only have called this function when a ToolChain sync was complete
     // so at least 1 job should have been waiting for it
-    ASSERT( atLeastOneJobStarted );
+    ASSERT( atLeastOneJobWaiting );
 }
 
 // ThreadFuncStatic
@@ -620,7 +887,7 @@ void Server::ThreadFunc()
 
         FindNeedyClients();
 
-        TouchToolchains();
+        MaintainToolchains();
 
         JobQueueRemote::Get().MainThreadWait( 100 );
     }
@@ -643,7 +910,10 @@ void Server::FindNeedyClients()
     {
         return;
     }
-    ++availableJobs; // over request to parallelize building/network transfers
+
+    // over request to hide the latency of obtaining jobs, so there is
+    // always work queued for a thread to start as soon as it's free
+    availableJobs += (int32_t)WorkerThreadRemote::GetNumJobsToPrefetch();
 
     {
         MutexHolder mh( m_ClientListMutex );
@@ -667,32 +937,29 @@ void Server::FindNeedyClients()
         // sort clients to find neediest first
         m_ClientList.SortDeref();
 
-        const Protocol::MsgRequestJob msg;
-
+        // spread requests over the clients
+        const size_t numClients = m_ClientList.GetSize();
+        StackArray<uint32_t> numJobsToRequest;
+        numJobsToRequest.SetCapacity( numClients );
+        for ( size_t i = 0; i < numClients; ++i )
+        {
+            numJobsToRequest.Append( 0 );
+        }
         while ( availableJobs > 0 )
         {
             bool anyJobsRequested = false;
 
-            for ( ClientState * cs : m_ClientList )
+            for ( size_t i = 0; i < numClients; ++i )
             {
-                const uint32_t reservedJobs = cs->m_NumJobsRequested.Load();
+                const ClientState * cs = m_ClientList[ i ];
+                const uint32_t reservedJobs = cs->m_NumJobsRequested.Load() + numJobsToRequest[ i ];
 
                 if ( reservedJobs >= cs->m_NumJobsAvailable.Load() )
                 {
                     continue; // we've maxed out the requests to this worker
                 }
 
-                // request job from this client
-                {
-                    // Acquire the lock but don't wait if unavailable
-                    TryMutexHolder tryLock( cs->m_Mutex );
-                    if ( tryLock.IsLocked() == false )
-                    {
-                        continue; // Skip this worker for now
-                    }
-                    cs->m_NumJobsRequested.Increment(); // Must be before Send() to ensure consistent counts
-                    msg.Send( cs->m_Connection );
-                }
+                numJobsToRequest[ i ]++;
                 availableJobs--;
                 anyJobsRequested = true;
 
@@ -709,6 +976,41 @@ void Server::FindNeedyClients()
                 break;
             }
         }
+
+        // request jobs from each client
+        for ( size_t i = 0; i < numClients; ++i )
+        {
+            const uint32_t numJobs = numJobsToRequest[ i ];
+            if ( numJobs == 0 )
+            {
+                continue;
+            }
+
+            ClientState * cs = m_ClientList[ i ];
+
+            // Acquire the lock but don't wait if unavailable
+            TryMutexHolder tryLock( cs->m_Mutex );
+            if ( tryLock.IsLocked() == false )
+            {
+                continue; // Skip this worker for now
+            }
+            cs->m_NumJobsRequested.Add( numJobs ); // Must be before Send() to ensure consistent counts
+
+            // Newer clients accept a batch of credits in a single message
+            if ( cs->m_ProtocolVersionMinor >= 6 )
+            {
+                const Protocol::MsgRequestJobs msg( numJobs );
+                msg.Send( cs->m_Connection );
+            }
+            else
+            {
+                const Protocol::MsgRequestJob msg;
+                for ( uint32_t j = 0; j < numJobs; ++j )
+                {
+                    msg.Send( cs->m_Connection );
+                }
+            }
+        }
     }
 }
 
@@ -778,25 +1080,62 @@ void Server::FinalizeCompletedJobs()
     }
 }
 
-// TouchToolchains
+// MaintainToolchains
 //------------------------------------------------------------------------------
-void Server::TouchToolchains()
+void Server::MaintainToolchains()
 {
-#if defined( __OSX__ ) || defined( __LINUX__ )
-    if ( m_TouchToolchainTimer.GetElapsed() < SERVER_TOOLCHAIN_TIMESTAMP_REFRESH_INTERVAL_SECS )
+    if ( m_TouchToolchainTimer.GetElapsed() >= SERVER_TOOLCHAIN_TIMESTAMP_REFRESH_INTERVAL_SECS )
     {
-        return;
+        m_TouchToolchainTimer.Restart();
+
+        MutexHolder manifestMH( m_ToolManifestsMutex );
+        for ( const ToolManifest * toolManifest : m_Tools )
+        {
+            // Mark as recently used so the store keeps it
+            m_ToolchainStore.Touch( *toolManifest );
+
+#if defined( __OSX__ ) || defined( __LINUX__ )
+            // Prevent periodic deletion of temp files by the OS
+            toolManifest->TouchFiles();
+#endif
+        }
     }
-    m_TouchToolchainTimer.Restart();
 
-    MutexHolder manifestMH( m_ToolManifestsMutex );
-    for ( const ToolManifest * toolManifest : m_Tools )
+    if ( m_TrimToolchainStoreTimer.GetElapsed() >= SERVER_TOOLCHAIN_STORE_TRIM_INTERVAL_SECS )
     {
-        toolManifest->TouchFiles();
+        m_TrimToolchainStoreTimer.Restart();
+        TrimToolchainStore();
     }
+}
+
+// TrimToolchainStore
+//------------------------------------------------------------------------------
+void Server::TrimToolchainStore()
+{
+    // Toolchains used by this session can't be removed, nor can chunks which
+    // files being synchronized will be assembled from. Only gathering these
+    // needs the lock: uses which start later update the time stamps of what
+    // they use, so the store keeps those too. (Time stamps are set by the file
+    // system, which can lag the clock by a few ms, hence the margin.)
+#if defined( __WINDOWS__ )
+    const uint64_t margin = ( 100 * 10000 ); // 100ms in 100ns units
 #else
-    // TODO:C we could update Windows timestamps too
+    const uint64_t margin = ( 100 * 1000000 ); // 100ms in ns
 #endif
+    const uint64_t usedSinceTime = ( Time::GetCurrentFileTime() - margin );
+    Array<uint64_t> toolIdsInUse;
+    Array<uint64_t> chunkHashesInUse;
+    {
+        MutexHolder manifestMH( m_ToolManifestsMutex );
+        toolIdsInUse.SetCapacity( m_Tools.GetSize() );
+        for ( const ToolManifest * toolManifest : m_Tools )
+        {
+            toolIdsInUse.Append( toolManifest->GetToolId() );
+            toolManifest->GetChunksInUse( chunkHashesInUse );
+        }
+    }
+
+    m_ToolchainStore.Trim( toolIdsInUse, chunkHashesInUse, usedSinceTime, m_ChunkStore.GetPath() );
 }
 
 // RequestMissingFiles
@@ -805,6 +1144,10 @@ void Server::RequestMissingFiles( const ConnectionInfo * connection, ToolManifes
 {
     MutexHolder manifestMH( m_ToolManifestsMutex );
 
+    // v22.9 or later clients can send files in chunks
+    const ClientState * cs = (const ClientState *)connection->GetUserData();
+    const bool useChunks = ( cs->m_ProtocolVersionMinor >= 9 );
+
     const Array<ToolManifestFile> & files = manifest->GetFiles();
     const size_t numFiles = files.GetSize();
     for ( size_t i = 0; i < numFiles; ++i )
@@ -813,8 +1156,17 @@ void Server::RequestMissingFiles( const ConnectionInfo * connection, ToolManifes
         if ( f.GetSyncState() == ToolManifestFile::NOT_SYNCHRONIZED )
         {
             // request this file
-            const Protocol::MsgRequestFile reqFileMsg( manifest->GetToolId(), (uint32_t)i );
-            reqFileMsg.Send( connection );
+            if ( useChunks )
+            {
+                // only the chunks we don't have will be sent
+                const Protocol::MsgRequestFileChunks reqFileMsg( manifest->GetToolId(), (uint32_t)i );
+                reqFileMsg.Send( connection );
+            }
+            else
+            {
+                const Protocol::MsgRequestFile reqFileMsg( manifest->GetToolId(), (uint32_t)i );
+                reqFileMsg.Send( connection );
+            }
 
             // prevent it being requested again
             manifest->MarkFileAsSynchronizing( i );
@@ -4,23 +4,32 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/Helpers/ToolChunkStore.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolchainStore.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobResultCache.h"
+
 #include "Core/Network/TCPConnectionPool.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Time/Timer.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class CompressionDictionary;
 class Job;
 class JobQueueRemote;
 namespace Protocol
 {
     class IMessage;
+    class MsgChunks;
     class MsgConnection;
+    class MsgDictionary;
     class MsgJob;
     class MsgManifest;
     class MsgNoJobAvailable;
+    class MsgNoJobsAvailable;
     class MsgStatus;
     class MsgFile;
+    class MsgFileChunks;
 }
 class ToolManifest;
 
@@ -36,6 +45,10 @@ public:
 
     bool IsSynchingTool( AString & statusStr ) const;
 
+    const ToolChunkStore & GetChunkStore() const { return m_ChunkStore; }
+    const ToolchainStore & GetToolchainStore() const { return m_ToolchainStore; }
+    const JobResultCache & GetResultCache() const { return m_ResultCache; }
+
 private:
     // TCPConnection interface
     virtual void OnConnected( const ConnectionInfo * connection ) override;
@@ -46,19 +59,27 @@ private:
     void Process( const ConnectionInfo * connection, const Protocol::MsgConnection * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgStatus * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgNoJobAvailable * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgNoJobsAvailable * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgJob * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgManifest * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgFile * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgFileChunks * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgChunks * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgDictionary * msg, const void * payload, size_t payloadSize );
 
     static uint32_t ThreadFuncStatic( void * param );
     void ThreadFunc();
 
     void FindNeedyClients();
     void FinalizeCompletedJobs();
-    void TouchToolchains();
+    void MaintainToolchains();
+    void TrimToolchainStore();
     void CheckWaitingJobs( const ToolManifest * manifest );
+    static uint32_t GetDictionaryIdForJob( const Job * job );
+    static bool IsDictionaryReady( const Job * job );
 
     void RequestMissingFiles( const ConnectionInfo * connection, ToolManifest * manifest ) const;
+    void OnReceiveFileFailed( const ConnectionInfo * connection, const ToolManifest * manifest, uint32_t fileId, bool corruptData, const char * msgName );
 
     struct ClientState
     {
@@ -81,7 +102,14 @@ private:
         uint8_t m_ProtocolVersionMinor = 0;
         AString m_HostName;
 
-        Array<Job *> m_WaitingJobs; // jobs waiting for manifests/toolchains
+        Array<Job *> m_WaitingJobs; // jobs waiting for manifests/toolchains/dictionaries
+        Array<uint32_t> m_RequestedDictionaries; // ids of dictionaries requested from this client
+
+        // Dictionaries received from this client (a reference is held to each)
+        //  - Not shared between clients, as ids are only 32-bit hashes and could
+        //    collide. Each client build uses at most one, so this is tiny.
+        //  - Released on disconnect (jobs still in progress hold their own reference)
+        Array<const CompressionDictionary *> m_Dictionaries;
 
         Timer m_StatusTimer;
     };
@@ -96,9 +124,16 @@ private:
     mutable Mutex m_ToolManifestsMutex;
     Array<ToolManifest *> m_Tools;
 
-#if defined( __OSX__ ) || defined( __LINUX__ )
+    // Chunks of toolchain files, shared by all toolchains
+    ToolChunkStore m_ChunkStore;
+
+    // Toolchains kept between worker sessions
+    ToolchainStore m_ToolchainStore;
     Timer m_TouchToolchainTimer;
-#endif
+    Timer m_TrimToolchainStoreTimer;
+
+    // Results of completed jobs, re-used for duplicate jobs from any client
+    JobResultCache m_ResultCache;
 };
 
 //------------------------------------------------------------------------------
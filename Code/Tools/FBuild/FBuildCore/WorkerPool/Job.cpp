@@ -8,6 +8,8 @@
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 
 // Core
 #include "Core/Env/Assert.h"
@@ -32,6 +34,7 @@ Job::Job( Node * node )
     , m_DataIsCompressed( false )
     , m_IsLocal( true )
     , m_AllowZstdUse( false )
+    , m_AllowFramedCompression( false )
 {
     // Constructor that assigns JobId can only be called on the main thread.
     ASSERT( Thread::IsMainThread() );
@@ -44,6 +47,7 @@ Job::Job( IOStream & stream )
     : m_DataIsCompressed( false )
     , m_IsLocal( false )
     , m_AllowZstdUse( false )
+    , m_AllowFramedCompression( false )
 {
     Deserialize( stream );
 }
@@ -62,6 +66,8 @@ Job::~Job()
         FDELETE m_Node;
     }
 
+    SetCompressionDictionary( nullptr );
+
     ASSERT( m_BuildProfilerScope == nullptr ); // If set, must be unhooked
 }
 
@@ -81,6 +87,22 @@ void Job::CancelDueToRemoteRaceWin()
     m_Abort.Store( true );
 }
 
+// SetCompressionDictionary
+//------------------------------------------------------------------------------
+void Job::SetCompressionDictionary( const CompressionDictionary * dictionary )
+{
+    // Reference new dictionary before releasing old one, in case they are the same
+    if ( dictionary )
+    {
+        dictionary->AddRef();
+    }
+    if ( m_CompressionDictionary )
+    {
+        m_CompressionDictionary->Release();
+    }
+    m_CompressionDictionary = dictionary;
+}
+
 // OwnData
 //------------------------------------------------------------------------------
 void Job::OwnData( void * data, size_t size, bool compressed )
@@ -166,7 +188,7 @@ void Job::SetMessages( const Array<AString> & messages )
 
 // Serialize
 //------------------------------------------------------------------------------
-void Job::Serialize( IOStream & stream )
+void Job::Serialize( IOStream & stream, bool allowDictionary )
 {
     PROFILE_FUNCTION;
 
@@ -182,6 +204,19 @@ void Job::Serialize( IOStream & stream )
 
     stream.Write( IsDataCompressed() );
 
+    // Recompress without the dictionary if the receiver can't use it
+    if ( m_CompressionDictionary && ( allowDictionary == false ) )
+    {
+        Compressor d;
+        VERIFY( d.Decompress( m_Data, m_CompressionDictionary ) ); // We compressed it, so it can't be corrupt
+        Compressor c( false ); // Receiver may also predate framing
+        c.Compress( d.GetResult(), d.GetResultSize() );
+        const uint32_t dataSize = (uint32_t)c.GetResultSize();
+        stream.Write( dataSize );
+        stream.Write( c.GetResult(), dataSize );
+        return;
+    }
+
     stream.Write( m_DataSize );
     stream.Write( m_Data, m_DataSize );
 }
@@ -12,6 +12,7 @@
 // Forward Declarations
 //------------------------------------------------------------------------------
 class BuildProfilerScope;
+class CompressionDictionary;
 class IOStream;
 class Node;
 class ToolManifest;
@@ -51,6 +52,10 @@ public:
     ToolManifest * GetToolManifest() const { return m_ToolManifest; }
 
     bool IsDataCompressed() const { return m_DataIsCompressed; }
+
+    // Dictionary needed to decompress the data (a reference is held)
+    void SetCompressionDictionary( const CompressionDictionary * dictionary );
+    const CompressionDictionary * GetCompressionDictionary() const { return m_CompressionDictionary; }
     bool IsLocal() const { return m_IsLocal; }
 
     const Array<AString> & GetMessages() const { return m_Messages; }
@@ -65,7 +70,8 @@ public:
     uint8_t GetSystemErrorCount() const { return m_SystemErrorCount; }
 
     // serialization for remote distribution
-    void Serialize( IOStream & stream );
+    //  - allowDictionary: Receivers prior to protocol 22.8 can't use dictionaries
+    void Serialize( IOStream & stream, bool allowDictionary = true );
     void Deserialize( IOStream & stream );
 
     void GetMessagesForLog( AString & buffer ) const;
@@ -76,13 +82,15 @@ public:
     void SetRemoteThreadIndex( uint16_t threadIndex ) { m_RemoteThreadIndex = threadIndex; }
     uint16_t GetRemoteThreadIndex() const { return m_RemoteThreadIndex; }
 
-    void SetResultCompressionLevel( int16_t compressionLevel, bool allowZstdUse )
+    void SetResultCompressionLevel( int16_t compressionLevel, bool allowZstdUse, bool allowFramedCompression )
     {
         m_ResultCompressionLevel = compressionLevel;
         m_AllowZstdUse = allowZstdUse;
+        m_AllowFramedCompression = allowFramedCompression;
     }
     int16_t GetResultCompressionLevel() const { return m_ResultCompressionLevel; }
     bool GetAllowZstdUse() const { return m_AllowZstdUse; }
+    bool GetAllowFramedCompression() const { return m_AllowFramedCompression; }
 
     enum DistributionState : uint8_t
     {
@@ -119,6 +127,7 @@ private:
     bool m_DataIsCompressed:1;
     bool m_IsLocal:1;
     bool m_AllowZstdUse:1; // Can client accept Zstd results?
+    bool m_AllowFramedCompression:1; // Can client accept chunked results?
     uint8_t m_SystemErrorCount = 0; // On client, the total error count, on the worker a flag for the current attempt
     DistributionState m_DistributionState = DIST_NONE;
     int16_t m_ResultCompressionLevel = 0; // Compression level of returned results
@@ -128,6 +137,7 @@ private:
     AString m_CacheName;
     BuildProfilerScope * m_BuildProfilerScope = nullptr; // Additional context when profiling a build
     ToolManifest * m_ToolManifest = nullptr;
+    const CompressionDictionary * m_CompressionDictionary = nullptr;
 
     Array<AString> m_Messages;
 
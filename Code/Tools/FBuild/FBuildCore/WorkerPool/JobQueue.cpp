@@ -8,15 +8,18 @@
 #include "WorkerThread.h"
 
 // FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/CacheProbe.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 
 // Core
 #include "Core/FileIO/FileIO.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/ThreadPool.h"
 #include "Core/Profile/Profile.h"
@@ -33,19 +36,57 @@ public:
     }
 };
 
+// ContainsNode
+//------------------------------------------------------------------------------
+static bool ContainsNode( const Array<const Node *> & sortedNodes, const Node * node )
+{
+    // Binary search
+    size_t first = 0;
+    size_t count = sortedNodes.GetSize();
+    while ( count > 0 )
+    {
+        const size_t half = ( count / 2 );
+        if ( sortedNodes[ first + half ] < node )
+        {
+            first += ( half + 1 );
+            count -= ( half + 1 );
+        }
+        else
+        {
+            count = half;
+        }
+    }
+    return ( first < sortedNodes.GetSize() ) && ( sortedNodes[ first ] == node );
+}
+
 // JobSubQueue CONSTRUCTOR
 //------------------------------------------------------------------------------
-JobSubQueue::JobSubQueue()
+JobSubQueue::JobSubQueue( uint32_t numLists )
     : m_Count( 0 )
+    , m_NextList( 0 )
+    , m_NonEmptyLists( 0 )
+    , m_NumPrioritized( 0 )
 {
+    ASSERT( numLists > 0 );
+    numLists = Math::Min( numLists, kMaxLists ); // Extra workers share lists
+    m_Lists.SetCapacity( numLists );
+    for ( uint32_t i = 0; i < numLists; ++i )
+    {
+        m_Lists.Append( FNEW( JobList ) );
+    }
 }
 
 // JobSubQueue DESTRUCTOR
 //------------------------------------------------------------------------------
 JobSubQueue::~JobSubQueue()
 {
-    ASSERT( m_Jobs.IsEmpty() );
     ASSERT( AtomicLoadRelaxed( &m_Count ) == 0 );
+    ASSERT( m_Prioritized.m_Jobs.IsEmpty() );
+    for ( JobList * list : m_Lists )
+    {
+        ASSERT( list->m_Jobs.IsEmpty() );
+        FDELETE list;
+    }
 }
 
 // GetCount
@@ -61,6 +102,11 @@ void JobSubQueue::QueueJobs( Array<Node *> & nodes )
 {
     PROFILE_FUNCTION;
 
+    if ( nodes.IsEmpty() )
+    {
+        return;
+    }
+
     // Create wrapper Jobs around Nodes
     Array<Job *> jobs;
     jobs.SetCapacity( nodes.GetSize() );
@@ -74,26 +120,63 @@ void JobSubQueue::QueueJobs( Array<Node *> & nodes )
     JobCostSorter sorter;
     jobs.Sort( sorter );
 
-    // lock to add job
-    MutexHolder mh( m_Mutex );
-    const bool wasEmpty = m_Jobs.IsEmpty();
+    // Deal jobs out to the lists, most expensive first, so the most expensive jobs
+    // are at the top of different lists. Each list receives a sorted subset, and
+    // each list is locked once per batch.
+    const uint32_t numLists = static_cast<uint32_t>( m_Lists.GetSize() );
+    const uint32_t numJobs = static_cast<uint32_t>( jobs.GetSize() );
+    const uint32_t numListsUsed = Math::Min( numLists, numJobs );
 
-    AtomicAdd( &m_Count, (uint32_t)jobs.GetSize() );
+    // Count before publishing, so the count is never less than the jobs available
+    AtomicAdd( &m_Count, numJobs );
 
-    if ( wasEmpty )
+    Array<Job *> listJobs;
+    listJobs.SetCapacity( ( numJobs / numListsUsed ) + 1 );
+    for ( uint32_t i = 0; i < numListsUsed; ++i )
     {
-        m_Jobs.Swap( jobs );
+        // Gather from least to most expensive
+        listJobs.Clear();
+        for ( uint32_t j = ( ( numJobs - 1 - i ) % numListsUsed ); j < numJobs; j += numListsUsed )
+        {
+            listJobs.Append( jobs[ j ] );
+        }
+
+        const uint32_t listIndex = ( ( m_NextList + i ) % numLists );
+        JobList * list = m_Lists[ listIndex ];
+        {
+            MutexHolder mh( list->m_Mutex );
+            const bool wasEmpty = list->m_Jobs.IsEmpty();
+            MergeJobs( list->m_Jobs, listJobs );
+            AtomicStoreRelaxed( &list->m_TopCost, list->m_Jobs.Top()->GetNode()->GetRecursiveCost() );
+            if ( wasEmpty )
+            {
+                // Only changed with the list's mutex held, so adding sets the bit
+                AtomicAdd( &m_NonEmptyLists, ( static_cast<uint64_t>( 1 ) << listIndex ) );
+            }
+        }
+    }
+    m_NextList = ( ( m_NextList + numListsUsed ) % numLists );
+}
+
+// MergeJobs
+//------------------------------------------------------------------------------
+/*static*/ void JobSubQueue::MergeJobs( Array<Job *> & jobs, Array<Job *> & newJobs )
+{
+    if ( jobs.IsEmpty() )
+    {
+        jobs.Swap( newJobs );
         return; // skip re-sorting
     }
 
     // Merge lists
+    JobCostSorter sorter;
     Array<Job *> mergedList;
-    mergedList.SetSize( m_Jobs.GetSize() + jobs.GetSize() );
+    mergedList.SetSize( jobs.GetSize() + newJobs.GetSize() );
     Job ** dst = mergedList.Begin();
-    Job ** src1 = m_Jobs.Begin();
-    const Job * const * end1 = m_Jobs.End();
-    Job ** src2 = jobs.Begin();
-    const Job * const * end2 = jobs.End();
+    Job ** src1 = jobs.Begin();
+    const Job * const * end1 = jobs.End();
+    Job ** src2 = newJobs.Begin();
+    const Job * const * end2 = newJobs.End();
     while ( ( src1 < end1 ) && ( src2 < end2 ) )
     {
         if ( sorter( *src1, *src2 ) )
@@ -114,40 +197,164 @@ void JobSubQueue::QueueJobs( Array<Node *> & nodes )
         *dst++ = *src2++;
     }
     ASSERT( dst == mergedList.End() );
-    m_Jobs.Swap( mergedList );
+    jobs.Swap( mergedList );
 }
 
 // RemoveJob
 //------------------------------------------------------------------------------
-Job * JobSubQueue::RemoveJob()
+Job * JobSubQueue::RemoveJob( uint32_t preferredList )
 {
-    // lock-free early out if there are no jobs
-    if ( AtomicLoadRelaxed( &m_Count ) == 0 )
+    const uint32_t numLists = static_cast<uint32_t>( m_Lists.GetSize() );
+    const uint32_t ownIndex = ( preferredList % numLists );
+    const uint64_t ownBit = ( static_cast<uint64_t>( 1 ) << ownIndex );
+    for ( ;; )
     {
-        return nullptr;
+        // lock-free early out if there are no jobs
+        if ( AtomicLoadRelaxed( &m_Count ) == 0 )
+        {
+            return nullptr;
+        }
+
+        // Prioritized jobs are taken first, most expensive first
+        if ( AtomicLoadRelaxed( &m_NumPrioritized ) > 0 )
+        {
+            MutexHolder mh( m_Prioritized.m_Mutex );
+            if ( m_Prioritized.m_Jobs.IsEmpty() == false )
+            {
+                Job * job = m_Prioritized.m_Jobs.Top();
+                m_Prioritized.m_Jobs.Pop();
+                AtomicDec( &m_NumPrioritized );
+                VERIFY( AtomicDec( &m_Count ) != static_cast<uint32_t>( -1 ) );
+                return job;
+            }
+        }
+
+        // Find the most expensive job. Only take from another list if its job is
+        // more expensive, so workers mostly use their own lists. Only lists with
+        // jobs are visited.
+        const uint64_t nonEmptyLists = AtomicLoadRelaxed( &m_NonEmptyLists );
+        if ( nonEmptyLists == 0 )
+        {
+            return nullptr;
+        }
+        uint32_t bestIndex = ownIndex;
+        uint32_t bestCost = 0;
+        bool found = false;
+        if ( nonEmptyLists & ownBit )
+        {
+            bestCost = AtomicLoadRelaxed( &m_Lists[ ownIndex ]->m_TopCost );
+            found = true;
+        }
+        for ( uint64_t bits = ( nonEmptyLists & ~ownBit ); bits != 0; bits &= ( bits - 1 ) )
+        {
+            const uint32_t index = Math::CountTrailingZeros( bits );
+            const uint32_t cost = AtomicLoadRelaxed( &m_Lists[ index ]->m_TopCost );
+            if ( ( found == false ) || ( cost > bestCost ) )
+            {
+                bestIndex = index;
+                bestCost = cost;
+                found = true;
+            }
+        }
+        JobList * bestList = m_Lists[ bestIndex ];
+
+        // lock to remove job
+        MutexHolder mh( bestList->m_Mutex );
+
+        // possible that job has been removed between job count check and mutex lock
+        if ( bestList->m_Jobs.IsEmpty() )
+        {
+            continue; // look again
+        }
+
+        Job * job = bestList->m_Jobs.Top();
+        bestList->m_Jobs.Pop();
+        if ( bestList->m_Jobs.IsEmpty() == false )
+        {
+            AtomicStoreRelaxed( &bestList->m_TopCost, bestList->m_Jobs.Top()->GetNode()->GetRecursiveCost() );
+        }
+        else
+        {
+            // Only changed with the list's mutex held, so subtracting clears the bit
+            AtomicSub( &m_NonEmptyLists, ( static_cast<uint64_t>( 1 ) << bestIndex ) );
+        }
+        VERIFY( AtomicDec( &m_Count ) != static_cast<uint32_t>( -1 ) );
+
+        return job;
     }
+}
 
-    // lock to remove job
-    MutexHolder mh( m_Mutex );
+// PrioritizeJobs
+//------------------------------------------------------------------------------
+void JobSubQueue::PrioritizeJobs( const Array<const Node *> & nodes )
+{
+    PROFILE_FUNCTION;
 
-    // possible that job has been removed between job count check and mutex lock
-    if ( m_Jobs.IsEmpty() )
+    if ( nodes.IsEmpty() || ( AtomicLoadRelaxed( &m_Count ) == 0 ) )
     {
-        return nullptr;
+        return;
     }
 
-    VERIFY( AtomicDec( &m_Count ) != static_cast<uint32_t>( -1 ) );
+    // Sorted for lookups as the lists are scanned
+    Array<const Node *> sortedNodes( nodes );
+    sortedNodes.Sort();
 
-    Job * job = m_Jobs.Top();
-    m_Jobs.Pop();
+    const uint32_t numLists = static_cast<uint32_t>( m_Lists.GetSize() );
+    Array<Job *> moved;
+    for ( uint32_t listIndex = 0; listIndex < numLists; ++listIndex )
+    {
+        if ( ( AtomicLoadRelaxed( &m_NonEmptyLists ) & ( static_cast<uint64_t>( 1 ) << listIndex ) ) == 0 )
+        {
+            continue;
+        }
 
-    return job;
+        // Both lists are locked so jobs are never missing from both (RemoveJob
+        // only ever holds one list's lock)
+        JobList * list = m_Lists[ listIndex ];
+        MutexHolder mh( list->m_Mutex );
+
+        // Remove matching jobs, keeping the rest in order
+        moved.Clear();
+        Job ** dst = list->m_Jobs.Begin();
+        for ( Job * job : list->m_Jobs )
+        {
+            if ( ContainsNode( sortedNodes, job->GetNode() ) )
+            {
+                moved.Append( job );
+            }
+            else
+            {
+                *dst++ = job;
+            }
+        }
+        if ( moved.IsEmpty() )
+        {
+            continue;
+        }
+        list->m_Jobs.SetSize( static_cast<size_t>( dst - list->m_Jobs.Begin() ) );
+
+        MutexHolder prioritizedMH( m_Prioritized.m_Mutex );
+        AtomicAdd( &m_NumPrioritized, static_cast<uint32_t>( moved.GetSize() ) );
+        MergeJobs( m_Prioritized.m_Jobs, moved ); // Both sorted by cost
+
+        if ( list->m_Jobs.IsEmpty() == false )
+        {
+            AtomicStoreRelaxed( &list->m_TopCost, list->m_Jobs.Top()->GetNode()->GetRecursiveCost() );
+        }
+        else
+        {
+            // Only changed with the list's mutex held, so subtracting clears the bit
+            AtomicSub( &m_NonEmptyLists, ( static_cast<uint64_t>( 1 ) << listIndex ) );
+        }
+    }
 }
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-JobQueue::JobQueue( uint32_t numWorkerThreads, ThreadPool * threadPool )
-    : m_NumLocalJobsActive( 0 )
+JobQueue::JobQueue( NodeGraph & nodeGraph, uint32_t numWorkerThreads, ThreadPool * threadPool )
+    : m_NodeGraph( nodeGraph )
+    , m_LocalJobs_Available( Math::Max( numWorkerThreads, 1U ) ) // A list per worker
+    , m_NumLocalJobsActive( 0 )
 #if defined( __WINDOWS__ )
     , m_MainThreadSemaphore( 1 ) // On Windows, take advantage of signalling limit
 #else
@@ -228,6 +435,8 @@ JobQueue::~JobQueue()
 //------------------------------------------------------------------------------
 void JobQueue::SignalStopWorkers()
 {
+    m_StopWorkersSignalled = true;
+
     const size_t numWorkerThreads = m_Workers.GetSize();
     for ( size_t i = 0; i < numWorkerThreads; ++i )
     {
@@ -329,6 +538,9 @@ void JobQueue::FlushJobBatch( const SettingsNode & settings )
 
     const uint32_t numWorkerThreads = FBuild::Get().GetOptions().m_NumWorkerThreads;
 
+    // Jobs from all groups are published together
+    Array<Node *> jobsToQueue;
+
     for ( ConcurrencyGroupState & groupState : m_ConcurrencyGroupsState )
     {
         // If there are no jobs to flush in this concurrency group
@@ -366,13 +578,19 @@ void JobQueue::FlushJobBatch( const SettingsNode & settings )
         // Queue as many new jobs as possible to reach the concurrency limit
         const uint32_t maxJobsToQueue = ( maxJobs - groupState.m_ActiveJobs );
 
-        // Make the jobs available
+        // Gather the jobs to make available
         if ( maxJobsToQueue >= groupState.m_LocalJobs_Staging.GetSize() )
         {
             // Flush all jobs
             const uint32_t numJobs = static_cast<uint32_t>( groupState.m_LocalJobs_Staging.GetSize() );
-            m_LocalJobs_Available.QueueJobs( groupState.m_LocalJobs_Staging );
-            m_WorkerThreadSemaphore.Signal( numJobs );
+            if ( jobsToQueue.IsEmpty() )
+            {
+                jobsToQueue.Swap( groupState.m_LocalJobs_Staging );
+            }
+            else
+            {
+                jobsToQueue.Append( groupState.m_LocalJobs_Staging );
+            }
             groupState.m_LocalJobs_Staging.Clear();
             groupState.m_ActiveJobs += numJobs;
         }
@@ -380,15 +598,26 @@ void JobQueue::FlushJobBatch( const SettingsNode & settings )
         {
             // Flush jobs to reach limit, taking jobs from tail of queue to
             // flush highest priority jobs first
-            StackArray<Node *> jobs;
-            jobs.Append( ( groupState.m_LocalJobs_Staging.End() - maxJobsToQueue ),
-                         groupState.m_LocalJobs_Staging.End() );
-            m_LocalJobs_Available.QueueJobs( jobs );
-            m_WorkerThreadSemaphore.Signal( maxJobsToQueue );
+            jobsToQueue.Append( ( groupState.m_LocalJobs_Staging.End() - maxJobsToQueue ),
+                                groupState.m_LocalJobs_Staging.End() );
             groupState.m_LocalJobs_Staging.SetSize( groupState.m_LocalJobs_Staging.GetSize() - maxJobsToQueue );
             groupState.m_ActiveJobs += maxJobsToQueue;
         }
     }
+
+    // Make the jobs available
+    if ( jobsToQueue.IsEmpty() == false )
+    {
+        // Start cache lookups before workers can take the jobs
+        if ( CacheProbe * cacheProbe = FBuild::Get().GetCacheProbe() )
+        {
+            cacheProbe->Queue( jobsToQueue );
+        }
+
+        const uint32_t numJobs = static_cast<uint32_t>( jobsToQueue.GetSize() );
+        m_LocalJobs_Available.QueueJobs( jobsToQueue );
+        m_WorkerThreadSemaphore.Signal( numJobs );
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -438,6 +667,36 @@ void JobQueue::QueueDistributableJob( Job * job )
 Job * JobQueue::GetDistributableJobToProcess( bool remote, uint8_t workerMinorProtocolVersion )
 {
     MutexHolder m( m_DistributedJobsMutex );
+    return GetDistributableJobToProcessNoLock( remote, workerMinorProtocolVersion );
+}
+
+// GetDistributableJobsToProcess
+//------------------------------------------------------------------------------
+void JobQueue::GetDistributableJobsToProcess( uint8_t workerMinorProtocolVersion, uint32_t maxJobs, Array<Job *> & outJobs )
+{
+    MutexHolder m( m_DistributedJobsMutex );
+
+    // Jobs beyond the first are reserved ahead of the worker having free CPUs.
+    // Don't let one worker reserve more than half of the remaining jobs, so other
+    // workers (and local threads) aren't left idle while it works through them.
+    const size_t maxToReserve = ( ( m_DistributableJobs_Available.GetSize() + 1 ) / 2 );
+    const size_t numToTake = Math::Min( (size_t)maxJobs, maxToReserve );
+    while ( outJobs.GetSize() < numToTake )
+    {
+        Job * job = GetDistributableJobToProcessNoLock( true, workerMinorProtocolVersion );
+        if ( job == nullptr )
+        {
+            break; // No more compatible jobs
+        }
+        outJobs.Append( job );
+    }
+}
+
+// GetDistributableJobToProcessNoLock
+//------------------------------------------------------------------------------
+Job * JobQueue::GetDistributableJobToProcessNoLock( bool remote, uint8_t workerMinorProtocolVersion )
+{
+    // NOTE: Called with m_DistributedJobsMutex held
 
     if ( m_DistributableJobs_Available.IsEmpty() )
     {
@@ -478,6 +737,14 @@ Job * JobQueue::GetDistributableJobToProcess( bool remote, uint8_t workerMinorPr
                 continue;
             }
 
+            // Chunked job data requires minor protocol 7 or later
+            if ( potentialJob->IsDataCompressed() &&
+                 ( workerMinorProtocolVersion < 7 ) &&
+                 Compressor::IsFramedData( potentialJob->GetData(), potentialJob->GetDataSize() ) )
+            {
+                continue;
+            }
+
             job = potentialJob;
             m_DistributableJobs_Available.EraseIndex( static_cast<size_t>( i ) );
             break;
@@ -702,6 +969,12 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
             const uint8_t groupIndex = n->GetConcurrencyGroupIndex();
             m_ConcurrencyGroupsState[ groupIndex ].m_ActiveJobs -= 1;
 
+            // Stamp, build time etc. will need saving
+            n->m_ChangedSinceSave = true;
+
+            // Files written by the job may invalidate stamps gathered before the build
+            nodeGraph.OnJobFinalized( n );
+
             if ( completedJob )
             {
                 // Finalize completed jobs
@@ -713,11 +986,13 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
                 {
                     n->SetState( Node::FAILED );
                 }
+                nodeGraph.NodeCompleted( n );
             }
             else if ( failedJob )
             {
                 // Mark failed jobs
                 n->SetState( Node::FAILED );
+                nodeGraph.NodeCompleted( n );
             }
 
             // Free normal jobs
@@ -769,6 +1044,16 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
         }
         jobArray->Clear();
     }
+
+    // Track nodes created by jobs (see PrepareFinalize)
+    nodeGraph.CommitPendingNodes();
+
+    // Dependents of the completed nodes can be queued immediately, rather
+    // than waiting for the next build pass
+    if ( m_StopWorkersSignalled == false )
+    {
+        nodeGraph.DispatchReadyNodes();
+    }
 }
 
 // MainThreadWait
@@ -792,7 +1077,7 @@ void JobQueue::WorkerThreadWait( uint32_t maxWaitMS )
 //------------------------------------------------------------------------------
 Job * JobQueue::GetJobToProcess()
 {
-    Job * job = m_LocalJobs_Available.RemoveJob();
+    Job * job = m_LocalJobs_Available.RemoveJob( WorkerThread::GetThreadIndex() );
     if ( job )
     {
         AtomicInc( &m_NumLocalJobsActive );
@@ -870,6 +1155,20 @@ void JobQueue::FinishedProcessingJob( Job * job, Node::BuildResult result, bool
         AtomicDec( &m_NumLocalJobsActive );
     }
 
+    // Resolve dependencies discovered by the job here, leaving less for the
+    // main thread to do in Finalize (racing jobs are left to the main thread,
+    // as both sides of the race could complete)
+    if ( result == Node::BuildResult::eOk )
+    {
+        const Job::DistributionState distState = job->GetDistributionState();
+        if ( ( distState == Job::DIST_NONE ) ||
+             ( distState == Job::DIST_COMPLETED_LOCALLY ) ||
+             ( distState == Job::DIST_COMPLETED_REMOTELY ) )
+        {
+            job->GetNode()->PrepareFinalize( m_NodeGraph );
+        }
+    }
+
     {
         MutexHolder m( m_CompletedJobsMutex );
         switch ( result )
@@ -23,11 +23,14 @@ class ThreadPool;
 class WorkerThread;
 
 // JobSubQueue
+//  - Jobs are spread over a list per worker, so workers rarely contend for a lock
+//  - Workers take the most expensive job from any list, preferring their own
+//  - Prioritized jobs are moved to a separate list, which is taken from first
 //------------------------------------------------------------------------------
 class JobSubQueue
 {
 public:
-    JobSubQueue();
+    explicit JobSubQueue( uint32_t numLists = 1 );
     ~JobSubQueue();
 
     uint32_t GetCount() const;
@@ -36,12 +39,30 @@ public:
     void QueueJobs( Array<Node *> & nodes );
 
     // jobs consumed by workers
-    Job * RemoveJob();
+    Job * RemoveJob( uint32_t preferredList = 0 );
+
+    // move queued jobs for these nodes ahead of all others
+    void PrioritizeJobs( const Array<const Node *> & nodes );
+
+    static const uint32_t kMaxLists = 64; // A bit each in m_NonEmptyLists
 
 private:
-    uint32_t m_Count; // access the current count
-    Mutex m_Mutex; // lock to add/remove jobs
-    Array<Job *> m_Jobs; // Sorted, most expensive at end
+    class JobList
+    {
+    public:
+        uint32_t m_TopCost = 0; // cost of the most expensive job (if non-empty)
+        Mutex m_Mutex; // lock to add/remove jobs
+        Array<Job *> m_Jobs; // Sorted, most expensive at end
+    };
+
+    static void MergeJobs( Array<Job *> & jobs, Array<Job *> & newJobs );
+
+    uint32_t m_Count; // access the current count (over all lists)
+    uint32_t m_NextList; // list to receive the next most expensive job queued
+    uint64_t m_NonEmptyLists; // bit per list with jobs, changed with the list's mutex held
+    Array<JobList *> m_Lists;
+    uint32_t m_NumPrioritized; // jobs in m_Prioritized (also included in m_Count)
+    JobList m_Prioritized;
 };
 
 // JobQueue
@@ -49,7 +70,7 @@ private:
 class JobQueue : public Singleton<JobQueue>
 {
 public:
-    explicit JobQueue( uint32_t numWorkerThreads, ThreadPool * threadPool );
+    explicit JobQueue( NodeGraph & nodeGraph, uint32_t numWorkerThreads, ThreadPool * threadPool );
     ~JobQueue();
 
     // main thread calls these
@@ -66,6 +87,10 @@ public:
     void SignalStopWorkers();
     bool HaveWorkersStopped() const;
 
+    // cache lookups (see CacheProbe) move jobs known to need compiling ahead,
+    // so they are ready for distribution sooner
+    void PrioritizeJobs( const Array<const Node *> & nodes ) { m_LocalJobs_Available.PrioritizeJobs( nodes ); }
+
     // access state
     size_t GetNumDistributableJobsAvailable() const;
 
@@ -89,6 +114,7 @@ private:
     // client side of protocol consumes jobs via this interface
     friend class ClientToWorkerConnection;
     Job * GetDistributableJobToProcess( bool remote, uint8_t workerMinorProtocolVersion );
+    void GetDistributableJobsToProcess( uint8_t workerMinorProtocolVersion, uint32_t maxJobs, Array<Job *> & outJobs );
     Job * OnReturnRemoteJob( uint32_t jobId,
                              bool systemError,
                              bool & outRaceLost,
@@ -97,9 +123,13 @@ private:
                              uint32_t & outJobSystemErrorCount );
     void ReturnUnfinishedDistributableJob( Job * job );
 
+    Job * GetDistributableJobToProcessNoLock( bool remote, uint8_t workerMinorProtocolVersion );
+
     // Semaphore to manage work
     Semaphore m_WorkerThreadSemaphore;
 
+    NodeGraph & m_NodeGraph;
+
     // Jobs available for local processing
     class ConcurrencyGroupState
     {
@@ -133,6 +163,7 @@ private:
     Array<Job *> m_CompletedJobsFailed2;
 
     Array<WorkerThread *> m_Workers;
+    bool m_StopWorkersSignalled = false;
 };
 
 //------------------------------------------------------------------------------
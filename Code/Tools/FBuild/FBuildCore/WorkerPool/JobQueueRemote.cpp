@@ -5,6 +5,7 @@
 //------------------------------------------------------------------------------
 #include "JobQueueRemote.h"
 #include "Job.h"
+#include "JobResultCache.h"
 #include "WorkerThreadRemote.h"
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
@@ -26,7 +27,8 @@
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-JobQueueRemote::JobQueueRemote( uint32_t numWorkerThreads )
+JobQueueRemote::JobQueueRemote( uint32_t numWorkerThreads, JobResultCache * resultCache )
+    : m_ResultCache( resultCache )
 {
     m_PendingJobs.SetCapacity( 1024 );
     m_CompletedJobs.SetCapacity( 1024 );
@@ -310,6 +312,27 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
         FLOG_MONITOR( "START_JOB local \"%s\" \n", job->GetNode()->GetName().Get() );
     }
 
+    // identical remote jobs can be answered without building
+    JobResultCache * resultCache = nullptr;
+    uint64_t resultCacheKey = 0;
+    if ( job->IsLocal() == false )
+    {
+        resultCache = JobQueueRemote::Get().m_ResultCache;
+        if ( resultCache && JobResultCache::GetKey( job, resultCacheKey ) )
+        {
+            uint32_t buildTimeMS = 0;
+            if ( resultCache->Retrieve( resultCacheKey, job, buildTimeMS ) )
+            {
+                node->SetLastBuildTime( buildTimeMS ); // original time, so client job ordering is unaffected
+                return Node::BuildResult::eOk;
+            }
+        }
+        else
+        {
+            resultCache = nullptr;
+        }
+    }
+
     // remote tasks must output to a tmp file
     if ( job->IsLocal() == false )
     {
@@ -397,6 +420,10 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
                 {
                     result = Node::BuildResult::eFailed;
                 }
+                else if ( resultCache )
+                {
+                    resultCache->Store( resultCacheKey, job );
+                }
             }
             break;
         }
@@ -490,7 +517,7 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, Node::BuildResult result
     const int32_t compressionLevel = job->GetResultCompressionLevel();
     if ( compressionLevel != 0 )
     {
-        mb.Compress( compressionLevel, job->GetAllowZstdUse() );
+        mb.Compress( compressionLevel, job->GetAllowZstdUse(), job->GetAllowFramedCompression() );
     }
 
     // transfer data to job
@@ -17,6 +17,7 @@
 //------------------------------------------------------------------------------
 class Node;
 class Job;
+class JobResultCache;
 class ThreadPool;
 class WorkerThread;
 
@@ -25,7 +26,7 @@ class WorkerThread;
 class JobQueueRemote : public Singleton<JobQueueRemote>
 {
 public:
-    explicit JobQueueRemote( uint32_t numWorkerThreads );
+    explicit JobQueueRemote( uint32_t numWorkerThreads, JobResultCache * resultCache = nullptr );
     ~JobQueueRemote();
 
     // main thread calls these
@@ -73,6 +74,8 @@ private:
 
     ThreadPool * m_ThreadPool;
     Array<WorkerThread *> m_Workers;
+
+    JobResultCache * m_ResultCache; // Optional, owned by Server
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,251 @@
+// JobResultCache - Results of remote jobs, re-used for identical jobs
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "JobResultCache.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolManifest.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+
+// Core
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+
+// system
+#include <string.h> // for memcpy
+
+// Static
+//------------------------------------------------------------------------------
+/*static*/ uint32_t JobResultCache::s_MaxSizeMiB( 0 );
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+JobResultCache::JobResultCache()
+    : m_MaxSize( (size_t)s_MaxSizeMiB * MEGABYTE )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+JobResultCache::~JobResultCache()
+{
+    while ( m_LeastRecentlyUsed )
+    {
+        Entry * entry = m_LeastRecentlyUsed;
+        Unlink( entry );
+        FDELETE entry;
+    }
+}
+
+// GetKey
+//------------------------------------------------------------------------------
+/*static*/ bool JobResultCache::GetKey( const Job * job, uint64_t & outKey )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( job->IsLocal() == false );
+    ASSERT( job->GetToolManifest() );
+
+    xxHash3Accumulator accumulator;
+
+    // Input is hashed decompressed, so identical source sent by clients with
+    // different compression settings (or dictionaries) gives the same key
+    if ( job->IsDataCompressed() )
+    {
+        Compressor c;
+        if ( ( Compressor::IsValidData( job->GetData(), job->GetDataSize() ) == false ) ||
+             ( c.Decompress( job->GetData(), job->GetCompressionDictionary() ) == false ) )
+        {
+            return false; // Reported when the job is built
+        }
+        accumulator.AddData( c.GetResult(), c.GetResultSize() );
+    }
+    else
+    {
+        accumulator.AddData( job->GetData(), job->GetDataSize() );
+    }
+
+    // Compiler
+    const uint64_t toolId = job->GetToolManifest()->GetToolId();
+    accumulator.AddData( &toolId, sizeof( toolId ) );
+
+    // Command line and source file names (which can be embedded in the output).
+    // The output name is not included, as it is only a temp file on the worker.
+    const ObjectNodeRemote * node = static_cast<const ObjectNodeRemote *>( job->GetNode() );
+    const uint32_t flags = node->GetCompilerFlags().m_Flags;
+    accumulator.AddData( &flags, sizeof( flags ) );
+    accumulator.AddData( node->GetCompilerOptions() );
+    accumulator.AddData( node->GetSourceFile()->GetName() );
+    accumulator.AddData( job->GetRemoteSourceRoot() );
+
+    // Results are stored compressed as requested by the client
+    const int16_t compressionLevel = job->GetResultCompressionLevel();
+    const bool allowZstdUse = job->GetAllowZstdUse();
+    const bool allowFramedCompression = job->GetAllowFramedCompression();
+    accumulator.AddData( &compressionLevel, sizeof( compressionLevel ) );
+    accumulator.AddData( &allowZstdUse, sizeof( allowZstdUse ) );
+    accumulator.AddData( &allowFramedCompression, sizeof( allowFramedCompression ) );
+
+    outKey = accumulator.Finalize64();
+    return true;
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+bool JobResultCache::Retrieve( uint64_t key, Job * job, uint32_t & outBuildTimeMS )
+{
+    PROFILE_FUNCTION;
+
+    void * data = nullptr;
+    size_t dataSize = 0;
+    {
+        MutexHolder mh( m_Mutex );
+        const UnorderedMap<uint64_t, Entry *>::KeyValue * found = m_Entries.Find( key );
+        if ( found == nullptr )
+        {
+            m_NumMisses.Increment();
+            return false;
+        }
+        Entry * entry = found->m_Value;
+        Unlink( entry );
+        Link( entry );
+
+        // Job takes ownership of a copy
+        dataSize = entry->m_DataSize;
+        data = ALLOC( dataSize );
+        memcpy( data, entry->m_Data, dataSize );
+        job->SetMessages( entry->m_Messages );
+        outBuildTimeMS = entry->m_BuildTimeMS;
+    }
+
+    job->OwnData( data, dataSize );
+
+    m_NumHits.Increment();
+    return true;
+}
+
+// Store
+//------------------------------------------------------------------------------
+void JobResultCache::Store( uint64_t key, const Job * job )
+{
+    PROFILE_FUNCTION;
+
+    // Copy outside the lock
+    Entry * newEntry = FNEW( Entry( key, job ) );
+    if ( newEntry->m_Size > m_MaxSize )
+    {
+        FDELETE newEntry;
+        return; // Would evict everything else
+    }
+
+    MutexHolder mh( m_Mutex );
+
+    // Identical job may have been completed by another thread
+    const UnorderedMap<uint64_t, Entry *>::KeyValue * found = m_Entries.Find( key );
+    if ( found )
+    {
+        Unlink( found->m_Value );
+        Link( found->m_Value );
+        FDELETE newEntry;
+        return;
+    }
+
+    Evict( newEntry->m_Size );
+
+    m_Entries.Insert( key, newEntry );
+    Link( newEntry );
+}
+
+// GetNumEntries
+//------------------------------------------------------------------------------
+size_t JobResultCache::GetNumEntries() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_NumEntries;
+}
+
+// GetSize
+//------------------------------------------------------------------------------
+size_t JobResultCache::GetSize() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_Size;
+}
+
+// Link
+//------------------------------------------------------------------------------
+void JobResultCache::Link( Entry * entry )
+{
+    ASSERT( ( entry->m_Prev == nullptr ) && ( entry->m_Next == nullptr ) );
+    entry->m_Prev = m_MostRecentlyUsed;
+    if ( m_MostRecentlyUsed )
+    {
+        m_MostRecentlyUsed->m_Next = entry;
+    }
+    else
+    {
+        m_LeastRecentlyUsed = entry;
+    }
+    m_MostRecentlyUsed = entry;
+    ++m_NumEntries;
+    m_Size += entry->m_Size;
+}
+
+// Unlink
+//------------------------------------------------------------------------------
+void JobResultCache::Unlink( Entry * entry )
+{
+    ( entry->m_Prev ? entry->m_Prev->m_Next : m_LeastRecentlyUsed ) = entry->m_Next;
+    ( entry->m_Next ? entry->m_Next->m_Prev : m_MostRecentlyUsed ) = entry->m_Prev;
+    entry->m_Prev = nullptr;
+    entry->m_Next = nullptr;
+    --m_NumEntries;
+    m_Size -= entry->m_Size;
+}
+
+// Evict
+//------------------------------------------------------------------------------
+void JobResultCache::Evict( size_t sizeNeeded )
+{
+    while ( ( m_Size + sizeNeeded ) > m_MaxSize )
+    {
+        ASSERT( m_LeastRecentlyUsed );
+
+        // Remove least recently used
+        Entry * oldest = m_LeastRecentlyUsed;
+        Unlink( oldest );
+        VERIFY( m_Entries.Erase( oldest->m_Key ) );
+        FDELETE oldest;
+    }
+}
+
+// Entry CONSTRUCTOR
+//------------------------------------------------------------------------------
+JobResultCache::Entry::Entry( uint64_t key, const Job * job )
+    : m_Key( key )
+    , m_Data( ALLOC( job->GetDataSize() ) )
+    , m_DataSize( job->GetDataSize() )
+    , m_Messages( job->GetMessages() )
+    , m_BuildTimeMS( job->GetNode()->GetLastBuildTime() )
+    , m_Size( sizeof( Entry ) + m_DataSize )
+{
+    memcpy( m_Data, job->GetData(), m_DataSize );
+    for ( const AString & message : m_Messages )
+    {
+        m_Size += message.GetLength();
+    }
+}
+
+// Entry DESTRUCTOR
+//------------------------------------------------------------------------------
+JobResultCache::Entry::~Entry()
+{
+    FREE( m_Data );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,90 @@
+// JobResultCache - Results of remote jobs, re-used for identical jobs
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Containers/UnorderedMap.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class Job;
+
+// JobResultCache
+//  - Many clients can send the same job (i.e. the same file compiled by
+//    several users, or a user rebuilding after a clean)
+//  - Successful results are kept in memory and returned without compiling
+//  - Least recently used results are removed to stay within the size limit
+//  - Thread-safe
+//------------------------------------------------------------------------------
+class JobResultCache
+{
+public:
+    explicit JobResultCache();
+    ~JobResultCache();
+
+    bool IsEnabled() const { return ( m_MaxSize > 0 ); }
+
+    // Hash everything which affects the result of a job
+    //  - Input is hashed decompressed, so clients using different compression
+    //    settings (or dictionaries) share results
+    //  - The client's object path is not included, as the compiler writes to a
+    //    temp file on the worker instead
+    static bool GetKey( const Job * job, uint64_t & outKey );
+
+    // Replace job input with cached result (returns false if not found)
+    bool Retrieve( uint64_t key, Job * job, uint32_t & outBuildTimeMS );
+
+    // Keep result of a successful job
+    void Store( uint64_t key, const Job * job );
+
+    uint32_t GetNumHits() const { return m_NumHits.Load(); }
+    uint32_t GetNumMisses() const { return m_NumMisses.Load(); }
+    size_t GetNumEntries() const;
+    size_t GetSize() const;
+
+    // Memory limit (0 = disabled), used by Servers created afterwards
+    static void SetMaxSizeMiB( uint32_t sizeMiB ) { s_MaxSizeMiB = sizeMiB; }
+    static uint32_t GetMaxSizeMiB() { return s_MaxSizeMiB; }
+
+private:
+    class Entry
+    {
+    public:
+        explicit Entry( uint64_t key, const Job * job );
+        ~Entry();
+
+        uint64_t m_Key;
+        Entry * m_Prev = nullptr; // Less recently used
+        Entry * m_Next = nullptr; // More recently used
+        void * m_Data;
+        size_t m_DataSize;
+        Array<AString> m_Messages;
+        uint32_t m_BuildTimeMS;
+        size_t m_Size; // Total memory used
+    };
+
+    void Link( Entry * entry ); // As most recently used
+    void Unlink( Entry * entry );
+    void Evict( size_t sizeNeeded );
+
+    mutable Mutex m_Mutex;
+    UnorderedMap<uint64_t, Entry *> m_Entries;
+    Entry * m_LeastRecentlyUsed = nullptr;
+    Entry * m_MostRecentlyUsed = nullptr;
+    size_t m_NumEntries = 0;
+    size_t m_Size = 0;
+    const size_t m_MaxSize;
+    Atomic<uint32_t> m_NumHits;
+    Atomic<uint32_t> m_NumMisses;
+
+    static uint32_t s_MaxSizeMiB;
+};
+
+//------------------------------------------------------------------------------
@@ -20,6 +20,7 @@
 // Static
 //------------------------------------------------------------------------------
 /*static*/ uint32_t WorkerThreadRemote::s_NumCPUsToUse( 999 ); // no limit
+/*static*/ uint32_t WorkerThreadRemote::s_NumJobsToPrefetch( 1 );
 
 //------------------------------------------------------------------------------
 WorkerThreadRemote::WorkerThreadRemote( uint16_t threadIndex )
@@ -27,6 +27,10 @@ public:
     static void SetNumCPUsToUse( uint32_t c ) { s_NumCPUsToUse = c; }
     static uint32_t GetNumCPUsToUse() { return s_NumCPUsToUse; }
 
+    // control jobs requested ahead of free CPUs, to hide network latency
+    static void SetNumJobsToPrefetch( uint32_t n ) { s_NumJobsToPrefetch = n; }
+    static uint32_t GetNumJobsToPrefetch() { return s_NumJobsToPrefetch; }
+
 private:
     virtual void Main() override;
 
@@ -37,6 +41,7 @@ private:
 
     // static
     static uint32_t s_NumCPUsToUse;
+    static uint32_t s_NumJobsToPrefetch;
 };
 
 //------------------------------------------------------------------------------
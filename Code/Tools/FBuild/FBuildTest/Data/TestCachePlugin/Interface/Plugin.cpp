@@ -118,6 +118,19 @@ bool STDCALL CacheTrim( bool /*showProgress*/, unsigned int /*sizeMiB*/ )
     return true; // Success
 }
 
+// CacheQuery
+//------------------------------------------------------------------------------
+bool STDCALL CacheQuery( const char * const * /*cacheIds*/, unsigned int /*numCacheIds*/, bool * /*found*/ )
+{
+    // DLL Export for Windows
+#if defined( __WINDOWS__ )
+    #pragma comment( linker, "/EXPORT:" __FUNCTION__ "=" __FUNCDNAME__ )
+#endif
+
+    ( *gOutputFunction )( "CacheQuery Called" );
+    return false; // Not supported
+}
+
 //------------------------------------------------------------------------------
 
 } // extern "C"
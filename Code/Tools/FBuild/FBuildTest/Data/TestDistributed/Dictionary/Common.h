@@ -0,0 +1,245 @@
+// Common.h - Content shared by all translation units
+//------------------------------------------------------------------------------
+#pragma once
+
+inline int CommonFunction00( int value )
+{
+    return ( value * 3 ) + ( value >> 1 ) - 0;
+}
+
+inline int CommonFunction01( int value )
+{
+    return ( value * 10 ) + ( value >> 2 ) - 13;
+}
+
+inline int CommonFunction02( int value )
+{
+    return ( value * 17 ) + ( value >> 3 ) - 26;
+}
+
+inline int CommonFunction03( int value )
+{
+    return ( value * 24 ) + ( value >> 4 ) - 39;
+}
+
+inline int CommonFunction04( int value )
+{
+    return ( value * 31 ) + ( value >> 5 ) - 52;
+}
+
+inline int CommonFunction05( int value )
+{
+    return ( value * 38 ) + ( value >> 1 ) - 65;
+}
+
+inline int CommonFunction06( int value )
+{
+    return ( value * 45 ) + ( value >> 2 ) - 78;
+}
+
+inline int CommonFunction07( int value )
+{
+    return ( value * 52 ) + ( value >> 3 ) - 91;
+}
+
+inline int CommonFunction08( int value )
+{
+    return ( value * 59 ) + ( value >> 4 ) - 104;
+}
+
+inline int CommonFunction09( int value )
+{
+    return ( value * 66 ) + ( value >> 5 ) - 117;
+}
+
+inline int CommonFunction10( int value )
+{
+    return ( value * 73 ) + ( value >> 1 ) - 130;
+}
+
+inline int CommonFunction11( int value )
+{
+    return ( value * 80 ) + ( value >> 2 ) - 143;
+}
+
+inline int CommonFunction12( int value )
+{
+    return ( value * 87 ) + ( value >> 3 ) - 156;
+}
+
+inline int CommonFunction13( int value )
+{
+    return ( value * 94 ) + ( value >> 4 ) - 169;
+}
+
+inline int CommonFunction14( int value )
+{
+    return ( value * 101 ) + ( value >> 5 ) - 182;
+}
+
+inline int CommonFunction15( int value )
+{
+    return ( value * 108 ) + ( value >> 1 ) - 195;
+}
+
+inline int CommonFunction16( int value )
+{
+    return ( value * 115 ) + ( value >> 2 ) - 208;
+}
+
+inline int CommonFunction17( int value )
+{
+    return ( value * 122 ) + ( value >> 3 ) - 221;
+}
+
+inline int CommonFunction18( int value )
+{
+    return ( value * 129 ) + ( value >> 4 ) - 234;
+}
+
+inline int CommonFunction19( int value )
+{
+    return ( value * 136 ) + ( value >> 5 ) - 247;
+}
+
+inline int CommonFunction20( int value )
+{
+    return ( value * 143 ) + ( value >> 1 ) - 260;
+}
+
+inline int CommonFunction21( int value )
+{
+    return ( value * 150 ) + ( value >> 2 ) - 273;
+}
+
+inline int CommonFunction22( int value )
+{
+    return ( value * 157 ) + ( value >> 3 ) - 286;
+}
+
+inline int CommonFunction23( int value )
+{
+    return ( value * 164 ) + ( value >> 4 ) - 299;
+}
+
+inline int CommonFunction24( int value )
+{
+    return ( value * 171 ) + ( value >> 5 ) - 312;
+}
+
+inline int CommonFunction25( int value )
+{
+    return ( value * 178 ) + ( value >> 1 ) - 325;
+}
+
+inline int CommonFunction26( int value )
+{
+    return ( value * 185 ) + ( value >> 2 ) - 338;
+}
+
+inline int CommonFunction27( int value )
+{
+    return ( value * 192 ) + ( value >> 3 ) - 351;
+}
+
+inline int CommonFunction28( int value )
+{
+    return ( value * 199 ) + ( value >> 4 ) - 364;
+}
+
+inline int CommonFunction29( int value )
+{
+    return ( value * 206 ) + ( value >> 5 ) - 377;
+}
+
+inline int CommonFunction30( int value )
+{
+    return ( value * 213 ) + ( value >> 1 ) - 390;
+}
+
+inline int CommonFunction31( int value )
+{
+    return ( value * 220 ) + ( value >> 2 ) - 403;
+}
+
+inline int CommonFunction32( int value )
+{
+    return ( value * 227 ) + ( value >> 3 ) - 416;
+}
+
+inline int CommonFunction33( int value )
+{
+    return ( value * 234 ) + ( value >> 4 ) - 429;
+}
+
+inline int CommonFunction34( int value )
+{
+    return ( value * 241 ) + ( value >> 5 ) - 442;
+}
+
+inline int CommonFunction35( int value )
+{
+    return ( value * 248 ) + ( value >> 1 ) - 455;
+}
+
+inline int CommonFunction36( int value )
+{
+    return ( value * 255 ) + ( value >> 2 ) - 468;
+}
+
+inline int CommonFunction37( int value )
+{
+    return ( value * 262 ) + ( value >> 3 ) - 481;
+}
+
+inline int CommonFunction38( int value )
+{
+    return ( value * 269 ) + ( value >> 4 ) - 494;
+}
+
+inline int CommonFunction39( int value )
+{
+    return ( value * 276 ) + ( value >> 5 ) - 507;
+}
+
+inline int CommonFunction40( int value )
+{
+    return ( value * 283 ) + ( value >> 1 ) - 520;
+}
+
+inline int CommonFunction41( int value )
+{
+    return ( value * 290 ) + ( value >> 2 ) - 533;
+}
+
+inline int CommonFunction42( int value )
+{
+    return ( value * 297 ) + ( value >> 3 ) - 546;
+}
+
+inline int CommonFunction43( int value )
+{
+    return ( value * 304 ) + ( value >> 4 ) - 559;
+}
+
+inline int CommonFunction44( int value )
+{
+    return ( value * 311 ) + ( value >> 5 ) - 572;
+}
+
+inline int CommonFunction45( int value )
+{
+    return ( value * 318 ) + ( value >> 1 ) - 585;
+}
+
+inline int CommonFunction46( int value )
+{
+    return ( value * 325 ) + ( value >> 2 ) - 598;
+}
+
+inline int CommonFunction47( int value )
+{
+    return ( value * 332 ) + ( value >> 3 ) - 611;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,6 @@
+#include "Common.h"
+
+int Function_a( int value )
+{
+    return CommonFunction00( value ) + CommonFunction47( value );
+}
@@ -0,0 +1,6 @@
+#include "Common.h"
+
+int Function_c( int value )
+{
+    return CommonFunction00( value ) + CommonFunction47( value );
+}
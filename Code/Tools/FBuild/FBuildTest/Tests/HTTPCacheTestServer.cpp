@@ -0,0 +1,477 @@
+// HTTPCacheTestServer - Minimal HTTP cache server for tests
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "HTTPCacheTestServer.h"
+
+// Core
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+
+// System
+#if defined( __WINDOWS__ )
+    #include "Core/Env/WindowsHeader.h"
+#else
+    #include <arpa/inet.h>
+    #include <netinet/in.h>
+    #include <sys/select.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+    #if !defined( INVALID_SOCKET )
+        #define INVALID_SOCKET ( -1 )
+    #endif
+#endif
+#include <stdlib.h> // for strtoull
+#include <string.h> // for memset
+
+// Helpers
+//------------------------------------------------------------------------------
+namespace
+{
+    void CloseTestSocket( TCPSocket socket )
+    {
+#if defined( __WINDOWS__ )
+        closesocket( socket );
+#else
+        close( socket );
+#endif
+    }
+
+    void ShutdownTestSocket( TCPSocket socket )
+    {
+#if defined( __WINDOWS__ )
+        shutdown( socket, SD_BOTH );
+#else
+        shutdown( socket, SHUT_RDWR );
+#endif
+    }
+
+    bool SendAll( TCPSocket socket, const void * data, size_t size )
+    {
+        const char * pos = static_cast<const char *>( data );
+        while ( size > 0 )
+        {
+#if defined( __WINDOWS__ )
+            const int sent = send( socket, pos, (int)size, 0 );
+#elif defined( __LINUX__ )
+            const ssize_t sent = send( socket, pos, size, MSG_NOSIGNAL );
+#else
+            const ssize_t sent = send( socket, pos, size, 0 );
+#endif
+            if ( sent <= 0 )
+            {
+                return false;
+            }
+            pos += sent;
+            size -= (size_t)sent;
+        }
+        return true;
+    }
+
+    bool RecvMore( TCPSocket socket, AString & buffer )
+    {
+        char data[ 16 * 1024 ];
+#if defined( __WINDOWS__ )
+        const int received = recv( socket, data, (int)sizeof( data ), 0 );
+#else
+        const ssize_t received = recv( socket, data, sizeof( data ), 0 );
+#endif
+        if ( received <= 0 )
+        {
+            return false;
+        }
+        buffer.Append( data, (size_t)received );
+        return true;
+    }
+
+    class ConnectionThreadParams
+    {
+    public:
+        HTTPCacheTestServer * m_Server;
+        TCPSocket m_Socket;
+    };
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+HTTPCacheTestServer::HTTPCacheTestServer()
+    : m_ListenSocket( (TCPSocket)INVALID_SOCKET )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+HTTPCacheTestServer::~HTTPCacheTestServer()
+{
+    Stop();
+}
+
+// Start
+//------------------------------------------------------------------------------
+bool HTTPCacheTestServer::Start()
+{
+    m_ListenSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    if ( m_ListenSocket == (TCPSocket)INVALID_SOCKET )
+    {
+        return false;
+    }
+
+    // Listen on any free port
+    struct sockaddr_in addr;
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    addr.sin_port = 0;
+    socklen_t addrLen = sizeof( addr );
+    if ( ( bind( m_ListenSocket, (struct sockaddr *)&addr, sizeof( addr ) ) != 0 ) ||
+         ( listen( m_ListenSocket, 16 ) != 0 ) ||
+         ( getsockname( m_ListenSocket, (struct sockaddr *)&addr, &addrLen ) != 0 ) )
+    {
+        CloseTestSocket( m_ListenSocket );
+        m_ListenSocket = (TCPSocket)INVALID_SOCKET;
+        return false;
+    }
+    m_Port = ntohs( addr.sin_port );
+
+    m_Quit.Store( false );
+    m_ListenThread = FNEW( Thread() );
+    m_ListenThread->Start( ListenThreadFuncStatic, "HTTPCacheTestServer", this );
+    return true;
+}
+
+// Stop
+//------------------------------------------------------------------------------
+void HTTPCacheTestServer::Stop()
+{
+    if ( m_ListenThread == nullptr )
+    {
+        return;
+    }
+
+    // Stop accepting connections
+    m_Quit.Store( true );
+    m_ListenThread->Join();
+    FDELETE m_ListenThread;
+    m_ListenThread = nullptr;
+    CloseTestSocket( m_ListenSocket );
+    m_ListenSocket = (TCPSocket)INVALID_SOCKET;
+
+    // Unblock and wait for connection threads
+    Array<Thread *> threads;
+    {
+        MutexHolder mh( m_Mutex );
+        for ( const TCPSocket socket : m_ConnectionSockets )
+        {
+            ShutdownTestSocket( socket );
+        }
+        threads.Swap( m_ConnectionThreads );
+    }
+    for ( Thread * thread : threads )
+    {
+        thread->Join();
+        FDELETE thread;
+    }
+}
+
+// GetURL
+//------------------------------------------------------------------------------
+void HTTPCacheTestServer::GetURL( AString & outURL ) const
+{
+    outURL.Format( "http://127.0.0.1:%u/cache", (uint32_t)m_Port );
+}
+
+// Clear
+//------------------------------------------------------------------------------
+void HTTPCacheTestServer::Clear()
+{
+    MutexHolder mh( m_Mutex );
+    m_Entries.Clear();
+}
+
+// CloseConnections
+//------------------------------------------------------------------------------
+void HTTPCacheTestServer::CloseConnections()
+{
+    // Connection threads exit once their socket is shut down
+    MutexHolder mh( m_Mutex );
+    for ( const TCPSocket socket : m_ConnectionSockets )
+    {
+        ShutdownTestSocket( socket );
+    }
+}
+
+// SetNumRequestsToDrop
+//------------------------------------------------------------------------------
+void HTTPCacheTestServer::SetNumRequestsToDrop( uint32_t count )
+{
+    MutexHolder mh( m_Mutex );
+    m_NumRequestsToDrop = count;
+}
+
+// GetNumRequests
+//------------------------------------------------------------------------------
+uint32_t HTTPCacheTestServer::GetNumRequests( const char * method ) const
+{
+    MutexHolder mh( m_Mutex );
+    const AStackString<8> m( method );
+    return ( m == "GET" ) ? m_NumGets : ( m == "PUT" ) ? m_NumPuts : ( m == "HEAD" ) ? m_NumHeads : 0;
+}
+
+// GetNumEntries
+//------------------------------------------------------------------------------
+size_t HTTPCacheTestServer::GetNumEntries() const
+{
+    MutexHolder mh( m_Mutex );
+    return m_Entries.GetSize();
+}
+
+// ListenThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t HTTPCacheTestServer::ListenThreadFuncStatic( void * param )
+{
+    static_cast<HTTPCacheTestServer *>( param )->ListenThreadFunc();
+    return 0;
+}
+
+// ListenThreadFunc
+//------------------------------------------------------------------------------
+void HTTPCacheTestServer::ListenThreadFunc()
+{
+    while ( m_Quit.Load() == false )
+    {
+        // Wait for a connection, periodically checking for shutdown
+        fd_set read;
+        FD_ZERO( &read );
+        FD_SET( m_ListenSocket, &read );
+        timeval timeout;
+        memset( &timeout, 0, sizeof( timeout ) );
+        timeout.tv_usec = ( 10 * 1000 );
+        if ( select( (int)m_ListenSocket + 1, &read, nullptr, nullptr, &timeout ) <= 0 )
+        {
+            continue;
+        }
+
+        const TCPSocket newSocket = accept( m_ListenSocket, nullptr, nullptr );
+        if ( newSocket == (TCPSocket)INVALID_SOCKET )
+        {
+            continue;
+        }
+        m_NumConnections.Increment();
+
+        ConnectionThreadParams * params = FNEW( ConnectionThreadParams );
+        params->m_Server = this;
+        params->m_Socket = newSocket;
+        Thread * thread = FNEW( Thread() );
+
+        MutexHolder mh( m_Mutex );
+        m_ConnectionSockets.Append( newSocket );
+        m_ConnectionThreads.Append( thread );
+        thread->Start( ConnectionThreadFuncStatic, "HTTPCacheTestConnection", params, ( 256 * 1024 ) );
+    }
+}
+
+// ConnectionThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t HTTPCacheTestServer::ConnectionThreadFuncStatic( void * param )
+{
+    ConnectionThreadParams * params = static_cast<ConnectionThreadParams *>( param );
+    params->m_Server->ConnectionThreadFunc( params->m_Socket );
+    FDELETE params;
+    return 0;
+}
+
+// ConnectionThreadFunc
+//------------------------------------------------------------------------------
+void HTTPCacheTestServer::ConnectionThreadFunc( TCPSocket socket )
+{
+    // Service requests until the client disconnects
+    AString buffer;
+    while ( HandleRequest( socket, buffer ) )
+    {
+    }
+
+    MutexHolder mh( m_Mutex );
+    VERIFY( m_ConnectionSockets.FindAndErase( socket ) );
+    CloseTestSocket( socket );
+}
+
+// HandleRequest
+//------------------------------------------------------------------------------
+bool HTTPCacheTestServer::HandleRequest( TCPSocket socket, AString & buffer )
+{
+    // Receive headers
+    const char * headersEnd;
+    while ( ( headersEnd = buffer.Find( "\r\n\r\n" ) ) == nullptr )
+    {
+        if ( RecvMore( socket, buffer ) == false )
+        {
+            return false;
+        }
+    }
+    const size_t headersLength = (size_t)( headersEnd - buffer.Get() ) + 4;
+
+    // Request line
+    AStackString<16> method;
+    AStackString path;
+    {
+        const char * methodEnd = buffer.Find( ' ' );
+        const char * pathEnd = methodEnd ? buffer.Find( ' ', methodEnd + 1 ) : nullptr;
+        if ( pathEnd == nullptr )
+        {
+            return false;
+        }
+        method.Assign( buffer.Get(), methodEnd );
+        path.Assign( methodEnd + 1, pathEnd );
+    }
+
+    // Body
+    size_t contentLength = 0;
+    const char * contentLengthHeader = buffer.FindI( "\r\nContent-Length:", nullptr, headersEnd );
+    if ( contentLengthHeader )
+    {
+        contentLength = (size_t)strtoull( contentLengthHeader + 17, nullptr, 10 );
+    }
+    while ( buffer.GetLength() < ( headersLength + contentLength ) )
+    {
+        if ( RecvMore( socket, buffer ) == false )
+        {
+            return false;
+        }
+    }
+
+    // Simulate a failure
+    {
+        MutexHolder mh( m_Mutex );
+        if ( m_NumRequestsToDrop > 0 )
+        {
+            --m_NumRequestsToDrop;
+            return false;
+        }
+    }
+
+    // Requests already received after this one were pipelined by the client
+    if ( buffer.GetLength() > ( headersLength + contentLength ) )
+    {
+        m_NumPipelinedRequests.Increment();
+    }
+
+    // Process
+    bool ok = false;
+    if ( method == "PUT" )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+            ++m_NumPuts;
+            Entry * entry = nullptr;
+            for ( Entry & e : m_Entries )
+            {
+                if ( e.m_Path == path )
+                {
+                    entry = &e;
+                    break;
+                }
+            }
+            if ( entry == nullptr )
+            {
+                entry = &m_Entries.EmplaceBack();
+                entry->m_Path = path;
+            }
+            entry->m_Data.Assign( buffer.Get() + headersLength, buffer.Get() + headersLength + contentLength );
+        }
+        ok = SendResponse( socket, 200, nullptr, 0, false );
+    }
+    else if ( ( method == "GET" ) || ( method == "HEAD" ) )
+    {
+        const bool isHead = ( method == "HEAD" );
+        AString data;
+        bool found = false;
+        {
+            MutexHolder mh( m_Mutex );
+            ++( isHead ? m_NumHeads : m_NumGets );
+            for ( const Entry & e : m_Entries )
+            {
+                if ( e.m_Path == path )
+                {
+                    data = e.m_Data;
+                    found = true;
+                    break;
+                }
+            }
+        }
+        const uint64_t advertisedContentLength = m_AdvertisedContentLength.Load();
+        if ( found && ( isHead == false ) && ( advertisedContentLength != 0 ) )
+        {
+            AStackString<256> headers;
+            headers.Format( "HTTP/1.1 200 OK\r\nContent-Length: %llu\r\n\r\n", (unsigned long long)advertisedContentLength );
+            ok = SendAll( socket, headers.Get(), headers.GetLength() );
+        }
+        else
+        {
+            ok = found ? SendResponse( socket, 200, data.Get(), data.GetLength(), isHead )
+                       : SendResponse( socket, 404, nullptr, 0, isHead );
+        }
+    }
+    else
+    {
+        ok = SendResponse( socket, 405, nullptr, 0, false );
+    }
+
+    // Retain data for the next request (if pipelined)
+    const AString remaining( buffer.Get() + headersLength + contentLength, buffer.GetEnd() );
+    buffer = remaining;
+    return ok;
+}
+
+// SendResponse
+//------------------------------------------------------------------------------
+bool HTTPCacheTestServer::SendResponse( TCPSocket socket, uint32_t status, const void * body, size_t bodySize, bool headersOnly ) const
+{
+    const char * reason = ( status == 200 ) ? "OK" : ( status == 404 ) ? "Not Found" : "Method Not Allowed";
+    const bool chunked = ( m_UseChunkedEncoding.Load() && ( status == 200 ) && ( headersOnly == false ) && ( bodySize > 0 ) );
+
+    AStackString<256> headers;
+    headers.Format( "HTTP/1.1 %u %s\r\n", status, reason );
+    if ( chunked )
+    {
+        headers += "Transfer-Encoding: chunked\r\n\r\n";
+    }
+    else
+    {
+        headers.AppendFormat( "Content-Length: %llu\r\n\r\n", (unsigned long long)bodySize );
+    }
+    if ( SendAll( socket, headers.Get(), headers.GetLength() ) == false )
+    {
+        return false;
+    }
+    if ( headersOnly || ( bodySize == 0 ) )
+    {
+        return true;
+    }
+    if ( chunked == false )
+    {
+        return SendAll( socket, body, bodySize );
+    }
+
+    // Send in small chunks, to exercise re-assembly
+    const char * pos = static_cast<const char *>( body );
+    const char * const end = ( pos + bodySize );
+    while ( pos < end )
+    {
+        const size_t chunkSize = Math::Min( (size_t)( end - pos ), (size_t)4096 );
+        AStackString<32> chunkHeader;
+        chunkHeader.Format( "%llx\r\n", (unsigned long long)chunkSize );
+        if ( ( SendAll( socket, chunkHeader.Get(), chunkHeader.GetLength() ) == false ) ||
+             ( SendAll( socket, pos, chunkSize ) == false ) ||
+             ( SendAll( socket, "\r\n", 2 ) == false ) )
+        {
+            return false;
+        }
+        pos += chunkSize;
+    }
+    return SendAll( socket, "0\r\n\r\n", 5 );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,86 @@
+// HTTPCacheTestServer - Minimal HTTP cache server for tests
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Network/NetworkStartupHelper.h"
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class Thread;
+
+// HTTPCacheTestServer
+//  - Stores entries in memory, supporting GET, PUT and HEAD
+//  - Listens on the loopback interface, on a port chosen by the OS
+//  - Connections are kept alive, each serviced on its own thread
+//------------------------------------------------------------------------------
+class HTTPCacheTestServer
+{
+public:
+    HTTPCacheTestServer();
+    ~HTTPCacheTestServer();
+
+    bool Start();
+    void Stop();
+
+    uint16_t GetPort() const { return m_Port; }
+    void GetURL( AString & outURL ) const;
+
+    // Options
+    void SetUseChunkedEncoding( bool chunked ) { m_UseChunkedEncoding.Store( chunked ); }
+    void SetAdvertisedContentLength( uint64_t size ) { m_AdvertisedContentLength.Store( size ); } // For GET responses, without sending the body (0 to disable)
+    void SetNumRequestsToDrop( uint32_t count ); // Connection is closed without a response
+    void Clear();
+    void CloseConnections(); // As if idle connections timed out
+
+    // Stats
+    uint32_t GetNumConnections() const { return m_NumConnections.Load(); }
+    uint32_t GetNumRequests( const char * method ) const;
+    size_t GetNumEntries() const;
+    uint32_t GetNumPipelinedRequests() const { return m_NumPipelinedRequests.Load(); } // Received before the previous response was sent
+
+private:
+    static uint32_t ListenThreadFuncStatic( void * param );
+    void ListenThreadFunc();
+    static uint32_t ConnectionThreadFuncStatic( void * param );
+    void ConnectionThreadFunc( TCPSocket socket );
+
+    bool HandleRequest( TCPSocket socket, AString & buffer );
+    bool SendResponse( TCPSocket socket, uint32_t status, const void * body, size_t bodySize, bool headersOnly ) const;
+
+    class Entry
+    {
+    public:
+        AString m_Path;
+        AString m_Data;
+    };
+
+    TCPSocket m_ListenSocket;
+    uint16_t m_Port = 0;
+    Atomic<bool> m_Quit;
+    Atomic<bool> m_UseChunkedEncoding;
+    Atomic<uint64_t> m_AdvertisedContentLength;
+    Thread * m_ListenThread = nullptr;
+
+    mutable Mutex m_Mutex; // Protects all below
+    Array<Thread *> m_ConnectionThreads;
+    Array<TCPSocket> m_ConnectionSockets;
+    Array<Entry> m_Entries;
+    uint32_t m_NumGets = 0;
+    uint32_t m_NumPuts = 0;
+    uint32_t m_NumHeads = 0;
+    uint32_t m_NumRequestsToDrop = 0;
+    Atomic<uint32_t> m_NumConnections;
+    Atomic<uint32_t> m_NumPipelinedRequests;
+
+    NetworkStartupHelper m_EnsureNetworkStarted;
+};
+
+//------------------------------------------------------------------------------
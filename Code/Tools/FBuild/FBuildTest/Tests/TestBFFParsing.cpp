@@ -7,6 +7,8 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/BFF/BFFParser.h"
+#include "Tools/FBuild/FBuildCore/BFF/Tokenizer/BFFTokenCache.h"
+#include "Tools/FBuild/FBuildCore/BFF/Tokenizer/BFFTokenizer.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 
@@ -14,13 +16,59 @@
 #include "Core/Env/Env.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/Mem/MemInfo.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+
+// system
+#include <string.h> // for memcmp
 
 //------------------------------------------------------------------------------
 TEST_GROUP( TestBFFParsing, FBuildTest )
 {
 public:
+    static void Tokenize( const char * fileName, BFFTokenCache * cache, Array<AString> & outTokens );
+    static void CheckTokensMatch( const Array<AString> & expected, const Array<AString> & tokens );
 };
 
+// Tokenize
+//  - Describe each token (tokens can't outlive the tokenizer which owns the
+//    files they refer to, and only one tokenizer can exist at a time)
+//------------------------------------------------------------------------------
+/*static*/ void TestBFFParsing::Tokenize( const char * fileName, BFFTokenCache * cache, Array<AString> & outTokens )
+{
+    BFFTokenizer tokenizer;
+    tokenizer.SetTokenCache( cache );
+    TEST_ASSERT( tokenizer.TokenizeFromFile( AStackString( fileName ) ) );
+
+    outTokens.SetCapacity( tokenizer.GetTokens().GetSize() );
+    for ( const BFFToken & token : tokenizer.GetTokens() )
+    {
+        AString & desc = outTokens.EmplaceBack();
+        desc.Format( "%u|%s|%u|%s|%u",
+                     (uint32_t)token.GetType(),
+                     token.GetSourceFileName().Get(),
+                     (uint32_t)( token.GetSourcePos() - token.GetSourceFileContents().Get() ),
+                     token.GetValueString().Get(),
+                     token.IsVariable() ? token.GetVariableNameHash() : 0 );
+        if ( token.IsNumber() )
+        {
+            desc.AppendFormat( "|%i", token.GetValueInt() );
+        }
+    }
+}
+
+// CheckTokensMatch
+//------------------------------------------------------------------------------
+/*static*/ void TestBFFParsing::CheckTokensMatch( const Array<AString> & expected, const Array<AString> & tokens )
+{
+    TEST_ASSERT( tokens.GetSize() == expected.GetSize() );
+    for ( size_t i = 0; i < tokens.GetSize(); ++i )
+    {
+        TEST_ASSERT( tokens[ i ] == expected[ i ] );
+    }
+}
+
 //------------------------------------------------------------------------------
 TEST_CASE( TestBFFParsing, Empty )
 {
@@ -1393,3 +1441,342 @@ TEST_CASE( TestBFFParsing, AlreadyDefined )
 }
 
 //------------------------------------------------------------------------------
+TEST_CASE( TestBFFParsing, ParseSpeed )
+{
+    // Generate a BFF with many variables per scope, as generated BFFs often have
+    const char * const bffFile = "../tmp/Test/BFFParsing/ParseSpeed/fbuild.bff";
+    const uint32_t numGlobals = 5000;
+    const uint32_t numItems = 2000;
+    const uint32_t numLocals = 50;
+    {
+        AString bff;
+        bff.SetReserved( 4 * 1024 * 1024 );
+        bff += "Settings {}\n";
+        for ( uint32_t i = 0; i < numGlobals; ++i )
+        {
+            bff.AppendFormat( ".Global%u = 'Value%u'\n", i, i );
+        }
+        bff += ".Items = { ";
+        for ( uint32_t i = 0; i < numItems; ++i )
+        {
+            bff.AppendFormat( "%s'Item%u'", ( i > 0 ) ? ", " : "", i );
+        }
+        bff += " }\n";
+        bff += "ForEach( .Item in .Items )\n"
+               "{\n";
+        for ( uint32_t i = 0; i < numLocals; ++i )
+        {
+            bff.AppendFormat( "    .Local%u = '$Item$_$Global%u$'\n", i, ( i * 97 ) % numGlobals );
+        }
+        bff.AppendFormat( "    TextFile( '$Item$' )\n"
+                          "    {\n"
+                          "        .TextFileOutput = '../tmp/Test/BFFParsing/ParseSpeed/$Item$.txt'\n"
+                          "        .TextFileInputStrings = { .Local%u, .Global0 }\n"
+                          "    }\n"
+                          "}\n",
+                          numLocals - 1 );
+
+        FileIO::EnsurePathExists( AStackString( "../tmp/Test/BFFParsing/ParseSpeed/" ) );
+        MakeFile( bffFile, bff.Get() );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = bffFile;
+    FBuildForTest fBuild( options );
+
+    const Timer t;
+    TEST_ASSERT( fBuild.Initialize() );
+    const float time = t.GetElapsed();
+
+    OUTPUT( "Variables     : %u global, %u per ForEach iteration\n", numGlobals, numLocals );
+    OUTPUT( "Iterations    : %u\n", numItems );
+    OUTPUT( "Parse         : %2.3f s\n", (double)time );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestBFFParsing, VariableCopySpeed )
+{
+    // Generate a BFF which passes large configs around, as generated BFFs often do
+    const char * const bffFile = "../tmp/Test/BFFParsing/VariableCopySpeed/fbuild.bff";
+    const uint32_t numOptions = 500;
+    const uint32_t numConfigs = 10;
+    const uint32_t numItems = 500;
+    {
+        AString bff;
+        bff.SetReserved( 1024 * 1024 );
+        bff += "Settings {}\n";
+
+        // A base config with a large array and string
+        bff += ".BaseConfig =\n"
+               "[\n"
+               "    .Defines = { ";
+        for ( uint32_t i = 0; i < numOptions; ++i )
+        {
+            bff.AppendFormat( "%s'-DSOME_REASONABLY_LONG_DEFINE_%u=1'", ( i > 0 ) ? ", " : "", i );
+        }
+        bff += " }\n"
+               "    .CompilerOptions = ''\n"
+               "    ForEach( .Define in .Defines ) { ^CompilerOptions + ' $Define$' }\n"
+               "]\n";
+
+        // Configs derived from it
+        bff += ".Configs = {}\n";
+        for ( uint32_t i = 0; i < numConfigs; ++i )
+        {
+            bff.AppendFormat( ".Config%u = [ Using( .BaseConfig ) .ConfigName = 'Config%u' ]\n"
+                              ".Configs + .Config%u\n",
+                              i, i, i );
+        }
+
+        // Keep a copy of a config for each item
+        for ( uint32_t i = 0; i < numItems; ++i )
+        {
+            bff.AppendFormat( ".ItemConfig%u = [ Using( .Config%u ) .ItemName = 'Item%u' ]\n", i, ( i % numConfigs ), i );
+        }
+
+        // Copy configs (and modify the copies) for each item
+        bff += ".Items = { ";
+        for ( uint32_t i = 0; i < numItems; ++i )
+        {
+            bff.AppendFormat( "%s'Item%u'", ( i > 0 ) ? ", " : "", i );
+        }
+        bff += " }\n"
+               "ForEach( .Item in .Items )\n"
+               "{\n"
+               "    ForEach( .Config in .Configs )\n"
+               "    {\n"
+               "        Using( .Config )\n"
+               "        .MyDefines = .Defines\n"
+               "        .MyDefines + '-DITEM=$Item$'\n"
+               "        .MyCompilerOptions = .CompilerOptions\n"
+               "        .MyCompilerOptions + ' -DITEM=$Item$'\n"
+               "    }\n"
+               "    TextFile( '$Item$' )\n"
+               "    {\n"
+               "        .TextFileOutput = '../tmp/Test/BFFParsing/VariableCopySpeed/$Item$.txt'\n"
+               "        .TextFileInputStrings = { .Item }\n"
+               "    }\n"
+               "}\n";
+
+        FileIO::EnsurePathExists( AStackString( "../tmp/Test/BFFParsing/VariableCopySpeed/" ) );
+        MakeFile( bffFile, bff.Get() );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = bffFile;
+    FBuildForTest fBuild( options );
+
+    const uint32_t memBefore = MemInfo::GetProcessInfo();
+    const Timer t;
+    TEST_ASSERT( fBuild.Initialize() );
+    const float time = t.GetElapsed();
+    const uint32_t memAfter = MemInfo::GetProcessInfo();
+
+    OUTPUT( "Configs       : %u, each with %u options\n", numConfigs, numOptions );
+    OUTPUT( "Iterations    : %u\n", numItems );
+    OUTPUT( "Parse         : %2.3f s\n", (double)time );
+    OUTPUT( "Memory        : %u MiB\n", ( memAfter > memBefore ) ? ( memAfter - memBefore ) : 0 );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestBFFParsing, TokenCache )
+{
+    // Generate a large bff and a small one which both include directives
+    const char * const rootFile = "../tmp/Test/BFFParsing/TokenCache/fbuild.bff";
+    const char * const largeFile = "../tmp/Test/BFFParsing/TokenCache/large.bff";
+    const char * const leafFile = "../tmp/Test/BFFParsing/TokenCache/leaf.bff";
+    const char * const cacheFile = "../tmp/Test/BFFParsing/TokenCache/fbuild.fdb.bfftokens";
+    const uint32_t numItems = 20000;
+    {
+        FileIO::EnsurePathExists( AStackString( "../tmp/Test/BFFParsing/TokenCache/" ) );
+        FileIO::FileDelete( cacheFile );
+
+        AString bff;
+        bff.SetReserved( 2 * 1024 * 1024 );
+        bff += ".Items = {}\n";
+        for ( uint32_t i = 0; i < numItems; ++i )
+        {
+            bff.AppendFormat( ".Item%u = [ .Name = 'Item%u' .Index = %u .Enabled = true ] // Item %u\n"
+                              ".Items + .Item%u\n",
+                              i, i, i, i, i );
+            if ( ( i % 1000 ) == 0 )
+            {
+                bff.AppendFormat( "#if !LEAF_DEFINE\n"
+                                  "    Print( 'Item%u' )\n"
+                                  "#endif\n",
+                                  i );
+            }
+        }
+        MakeFile( largeFile, bff.Get() );
+
+        MakeFile( leafFile, "#define LEAF_DEFINE\n"
+                            ".Leaf = 'Leaf'\n" );
+        MakeFile( rootFile, "#include \"leaf.bff\"\n"
+                            "#include \"large.bff\"\n"
+                            ".Root = .Leaf + 'Root'\n" );
+    }
+
+    FBuild fBuild; // needed for FBuild::GetEnvironmentString() etc
+
+    // Tokenize without the cache, for reference
+    Array<AString> expected;
+    const Timer t;
+    Tokenize( rootFile, nullptr, expected );
+    const float uncachedTime = t.GetElapsed();
+
+    // First tokenization populates the cache
+    {
+        BFFTokenCache cache;
+        TEST_ASSERT( cache.Load( cacheFile ) == false ); // Doesn't exist yet
+        Array<AString> tokens;
+        Tokenize( rootFile, &cache, tokens );
+        CheckTokensMatch( expected, tokens );
+        TEST_ASSERT( cache.GetNumHits() == 0 );
+        TEST_ASSERT( cache.GetNumMisses() > 0 );
+        TEST_ASSERT( cache.IsDirty() );
+        TEST_ASSERT( cache.Save( cacheFile ) );
+    }
+
+    // Second tokenization uses the cache entirely
+    float cachedTime;
+    {
+        const Timer t2;
+        BFFTokenCache cache;
+        TEST_ASSERT( cache.Load( cacheFile ) );
+        Array<AString> tokens;
+        Tokenize( rootFile, &cache, tokens );
+        cachedTime = t2.GetElapsed();
+        CheckTokensMatch( expected, tokens );
+        TEST_ASSERT( cache.GetNumHits() > 0 );
+        TEST_ASSERT( cache.GetNumMisses() == 0 );
+        TEST_ASSERT( cache.IsDirty() == false );
+        TEST_ASSERT( cache.Save( cacheFile ) ); // Nothing to do
+    }
+
+    // Modify the leaf (removing the define changes directive outcomes in the
+    // large file, which must be re-evaluated)
+    MakeFile( leafFile, ".Leaf = 'Modified'\n" );
+    {
+        Array<AString> modifiedExpected;
+        Tokenize( rootFile, nullptr, modifiedExpected );
+        TEST_ASSERT( modifiedExpected.GetSize() > expected.GetSize() ); // Print() calls now active
+
+        BFFTokenCache cache;
+        TEST_ASSERT( cache.Load( cacheFile ) );
+        Array<AString> tokens;
+        Tokenize( rootFile, &cache, tokens );
+        CheckTokensMatch( modifiedExpected, tokens );
+
+        // Only the leaf and the newly active #if blocks are tokenized
+        TEST_ASSERT( cache.GetNumMisses() == ( 1 + ( numItems / 1000 ) ) );
+        TEST_ASSERT( cache.GetNumHits() > 0 );
+        TEST_ASSERT( cache.Save( cacheFile ) );
+    }
+
+    OUTPUT( "Tokens        : %zu\n", expected.GetSize() );
+    OUTPUT( "Uncached      : %2.3f s\n", (double)uncachedTime );
+    OUTPUT( "Cached        : %2.3f s\n", (double)cachedTime );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestBFFParsing, TokenCache_Corrupt )
+{
+    const char * const bffFile = "../tmp/Test/BFFParsing/TokenCache_Corrupt/fbuild.bff";
+    const char * const cacheFile = "../tmp/Test/BFFParsing/TokenCache_Corrupt/fbuild.fdb.bfftokens";
+    FileIO::EnsurePathExists( AStackString( "../tmp/Test/BFFParsing/TokenCache_Corrupt/" ) );
+    MakeFile( bffFile, ".A = ( in )\n" );
+
+    FBuild fBuild; // needed for FBuild::GetEnvironmentString() etc
+
+    Array<AString> expected;
+    Tokenize( bffFile, nullptr, expected );
+
+    // Records for an operator (=), brace (() and keyword (in): type, offset, value
+    const uint8_t records[][ 6 ] = {
+        { (uint8_t)BFFTokenType::Operator, 3, 0, 0, 0, (uint8_t)BFFOperator::Type::eAssign },
+        { (uint8_t)BFFTokenType::Brace, 5, 0, 0, 0, (uint8_t)BFFToken::BraceType::eRoundLeft },
+        { (uint8_t)BFFTokenType::Keyword, 7, 0, 0, 0, (uint8_t)BFFKeyword::Type::eIn },
+    };
+    for ( const uint8_t * record : records )
+    {
+        // Populate the cache
+        FileIO::FileDelete( cacheFile );
+        {
+            BFFTokenCache cache;
+            Array<AString> tokens;
+            Tokenize( bffFile, &cache, tokens );
+            TEST_ASSERT( cache.Save( cacheFile ) );
+        }
+
+        // Replace the value with one outside the range of its enum
+        {
+            AString contents;
+            {
+                FileStream f;
+                TEST_ASSERT( f.Open( cacheFile ) );
+                contents.SetLength( (uint32_t)f.GetFileSize() );
+                TEST_ASSERT( f.ReadBuffer( contents.Get(), contents.GetLength() ) == contents.GetLength() );
+            }
+            char * pos = nullptr;
+            for ( uint32_t i = 0; ( i + 6 ) <= contents.GetLength(); ++i )
+            {
+                if ( memcmp( contents.Get() + i, record, 6 ) == 0 )
+                {
+                    pos = ( contents.Get() + i + 5 );
+                    break;
+                }
+            }
+            TEST_ASSERT( pos );
+            *pos = (char)0xFE;
+            FileStream f;
+            TEST_ASSERT( f.Open( cacheFile, FileStream::WRITE_ONLY ) );
+            TEST_ASSERT( f.WriteBuffer( contents.Get(), contents.GetLength() ) == contents.GetLength() );
+        }
+
+        // Corrupt record is a miss, and the file is tokenized normally
+        BFFTokenCache cache;
+        TEST_ASSERT( cache.Load( cacheFile ) );
+        Array<AString> tokens;
+        Tokenize( bffFile, &cache, tokens );
+        CheckTokensMatch( expected, tokens );
+        TEST_ASSERT( cache.GetNumHits() == 0 );
+        TEST_ASSERT( cache.GetNumMisses() == 1 );
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestBFFParsing, TokenCache_SavedWithDB )
+{
+    const char * const dbFile = "../tmp/Test/BFFParsing/TokenCache_SavedWithDB/fbuild.fdb";
+    const char * const cacheFile = "../tmp/Test/BFFParsing/TokenCache_SavedWithDB/fbuild.fdb.bfftokens";
+    FileIO::EnsurePathExists( AStackString( "../tmp/Test/BFFParsing/TokenCache_SavedWithDB/" ) );
+    FileIO::FileDelete( dbFile );
+    FileIO::FileDelete( cacheFile );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestBFFParsing/include_once.bff";
+
+    // Cache is only saved with the DB
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+    }
+    TEST_ASSERT( FileIO::FileExists( cacheFile ) == false );
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+    }
+    TEST_ASSERT( FileIO::FileExists( cacheFile ) );
+
+    // Re-parsing (forced by deleting the DB) uses it
+    FileIO::FileDelete( dbFile );
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+    }
+    TEST_ASSERT( FileIO::FileExists( cacheFile ) );
+}
+
+//------------------------------------------------------------------------------
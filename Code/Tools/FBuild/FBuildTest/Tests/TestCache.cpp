@@ -4,19 +4,32 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "FBuildTest.h"
+#include "HTTPCacheTestServer.h"
 
 // FBuild
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheProbe.h"
+#include "Tools/FBuild/FBuildCore/Cache/HTTPCache.h"
+#include "Tools/FBuild/FBuildCore/Cache/PackedCache.h"
+#include "Tools/FBuild/FBuildCore/Cache/TieredCache.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FBuildStats.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 
 // Core
+#include "Core/Env/Env.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Tracing/Tracing.h"
 
+// system
+#include <string.h> // for memcmp
+
 //------------------------------------------------------------------------------
 TEST_GROUP( TestCache, FBuildTest )
 {
@@ -213,6 +226,742 @@ TEST_CASE( TestCache, ReadWrite )
 #endif
 }
 
+//------------------------------------------------------------------------------
+TEST_CASE( TestCache, WriteQueue )
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_UseCacheWrite = true;
+    options.m_CacheVerbose = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/cache.bff";
+
+    // Stores are made in the background, and complete by the end of the build
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheStores == objStats.m_NumProcessed );
+        TEST_ASSERT( fBuild.GetStats().m_NumCacheStoresQueued == objStats.m_NumCacheStores );
+        TEST_ASSERT( fBuild.GetStats().m_NumCacheStoresQueueFull == 0 );
+        TEST_ASSERT( fBuild.GetStats().m_CacheStoreQueueMaxDepth >= 1 );
+    }
+
+    // Stores are made synchronously when the queue is disabled
+    {
+        options.m_CacheWriteQueueMiB = 0;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheStores == objStats.m_NumProcessed );
+        TEST_ASSERT( fBuild.GetStats().m_NumCacheStoresQueued == 0 );
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestCache, Packed )
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/Packed/fbuild.bff";
+
+    // Write
+    {
+        options.m_UseCacheWrite = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheStores == objStats.m_NumProcessed );
+        TEST_ASSERT( objStats.m_NumBuilt == objStats.m_NumProcessed );
+    }
+
+    // Read (in a new process, so via the index written on shutdown)
+    {
+        options.m_UseCacheRead = true;
+        options.m_UseCacheWrite = false;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits == objStats.m_NumProcessed );
+        TEST_ASSERT( objStats.m_NumBuilt == 0 );
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestCache, PackedStore )
+{
+    const AStackString cachePath( "../tmp/Test/Cache/PackedStore" );
+
+    // Start empty
+    {
+        PackedCache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Trim( false, 0 ) );
+        cache.Shutdown();
+    }
+
+    const AStackString dataA( "Data for entry A" );
+    const AStackString dataB( "Data for entry B, which replaces A" );
+    const AStackString packedPath( "../tmp/Test/Cache/PackedStore/packed" );
+    const AStackString indexFile( "../tmp/Test/Cache/PackedStore/packed/index.fpci" );
+    const AStackString journalFile( "../tmp/Test/Cache/PackedStore/packed/index.fpcj" );
+    const uint64_t emptyIndexTime = FileIO::GetFileLastWriteTime( indexFile );
+    TEST_ASSERT( emptyIndexTime != 0 );
+
+    // Publish and retrieve
+    {
+        PackedCache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+        TEST_ASSERT( cache.Publish( AStackString( "EntryA" ), dataA.Get(), dataA.GetLength() ) );
+        TEST_ASSERT( cache.Publish( AStackString( "EntryB" ), dataA.Get(), dataA.GetLength() ) );
+        TEST_ASSERT( cache.Publish( AStackString( "EntryB" ), dataB.Get(), dataB.GetLength() ) );
+
+        void * data;
+        size_t dataSize;
+        TEST_ASSERT( cache.Retrieve( AStackString( "EntryB" ), data, dataSize ) );
+        TEST_ASSERT( ( dataSize == dataB.GetLength() ) && ( memcmp( data, dataB.Get(), dataSize ) == 0 ) );
+        cache.FreeMemory( data, dataSize );
+        TEST_ASSERT( cache.Retrieve( AStackString( "EntryC" ), data, dataSize ) == false );
+
+        cache.Shutdown();
+
+        // New entries are appended to the journal, leaving the index as-is
+        TEST_ASSERT( FileIO::GetFileLastWriteTime( indexFile ) == emptyIndexTime );
+        TEST_ASSERT( FileIO::FileExists( journalFile.Get() ) );
+    }
+
+    // Another process continues the same segment
+    {
+        PackedCache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Publish( AStackString( "EntryC" ), dataA.Get(), dataA.GetLength() ) );
+        cache.Shutdown();
+
+        Array<AString> segments;
+        FileIO::GetFiles( packedPath, AStackString( "*.fpcs" ), false, &segments );
+        TEST_ASSERT( segments.GetSize() == 1 );
+    }
+
+    // Uses of a read-only cache don't modify the index
+    {
+        const uint64_t indexTime = FileIO::GetFileLastWriteTime( indexFile );
+        FileIO::FileInfo journalInfo;
+        TEST_ASSERT( FileIO::GetFileInfo( journalFile, journalInfo ) );
+
+        PackedCache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, false, false, AString::GetEmpty() ) );
+
+        void * data;
+        size_t dataSize;
+        TEST_ASSERT( cache.Retrieve( AStackString( "EntryB" ), data, dataSize ) );
+        cache.FreeMemory( data, dataSize );
+
+        cache.Shutdown();
+
+        TEST_ASSERT( FileIO::GetFileLastWriteTime( indexFile ) == indexTime );
+        FileIO::FileInfo journalInfoAfter;
+        TEST_ASSERT( FileIO::GetFileInfo( journalFile, journalInfoAfter ) );
+        TEST_ASSERT( journalInfoAfter.m_LastWriteTime == journalInfo.m_LastWriteTime );
+        TEST_ASSERT( journalInfoAfter.m_Size == journalInfo.m_Size );
+    }
+
+    // Entries persist via the journal
+    {
+        PackedCache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, false, false, AString::GetEmpty() ) );
+
+        void * data;
+        size_t dataSize;
+        TEST_ASSERT( cache.Retrieve( AStackString( "EntryA" ), data, dataSize ) );
+        TEST_ASSERT( ( dataSize == dataA.GetLength() ) && ( memcmp( data, dataA.Get(), dataSize ) == 0 ) );
+        cache.FreeMemory( data, dataSize );
+        TEST_ASSERT( cache.Retrieve( AStackString( "EntryB" ), data, dataSize ) );
+        TEST_ASSERT( ( dataSize == dataB.GetLength() ) && ( memcmp( data, dataB.Get(), dataSize ) == 0 ) );
+        cache.FreeMemory( data, dataSize );
+
+        TEST_ASSERT( cache.OutputInfo( false ) );
+
+        // Trimming removes whole segments
+        TEST_ASSERT( cache.Trim( false, 0 ) );
+        TEST_ASSERT( cache.Retrieve( AStackString( "EntryA" ), data, dataSize ) == false );
+
+        cache.Shutdown();
+
+        // The journal has been merged into the index
+        TEST_ASSERT( FileIO::FileExists( journalFile.Get() ) == false );
+    }
+
+    // Trimmed entries are removed from the index
+    {
+        PackedCache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, false, false, AString::GetEmpty() ) );
+
+        void * data;
+        size_t dataSize;
+        TEST_ASSERT( cache.Retrieve( AStackString( "EntryB" ), data, dataSize ) == false );
+
+        cache.Shutdown();
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestCache, PackedIndex )
+{
+    const AStackString cachePath( "../tmp/Test/Cache/PackedIndex" );
+    const AStackString indexFile( "../tmp/Test/Cache/PackedIndex/packed/index.fpci" );
+    const AStackString journalFile( "../tmp/Test/Cache/PackedIndex/packed/index.fpcj" );
+
+    // Start empty
+    {
+        PackedCache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Trim( false, 0 ) );
+        cache.Shutdown();
+    }
+    FileIO::FileInfo emptyIndexInfo;
+    TEST_ASSERT( FileIO::GetFileInfo( indexFile, emptyIndexInfo ) );
+
+    // Enough entries that the journal is folded into the index
+    const uint32_t numEntries = 40000;
+    AStackString cacheId;
+    {
+        PackedCache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        for ( uint32_t i = 0; i < numEntries; ++i )
+        {
+            cacheId.Format( "Entry%u", i );
+            TEST_ASSERT( cache.Publish( cacheId, cacheId.Get(), cacheId.GetLength() ) );
+        }
+        cache.Shutdown();
+    }
+
+    // The index was updated in place (it didn't need to grow, so wasn't re-written)
+    TEST_ASSERT( FileIO::FileExists( journalFile.Get() ) == false );
+    FileIO::FileInfo indexInfo;
+    TEST_ASSERT( FileIO::GetFileInfo( indexFile, indexInfo ) );
+    TEST_ASSERT( indexInfo.m_Size == emptyIndexInfo.m_Size );
+
+    // Entries are found in the index
+    {
+        PackedCache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, false, false, AString::GetEmpty() ) );
+        for ( uint32_t i = 0; i < numEntries; ++i )
+        {
+            cacheId.Format( "Entry%u", i );
+            void * data;
+            size_t dataSize;
+            TEST_ASSERT( cache.Retrieve( cacheId, data, dataSize ) );
+            TEST_ASSERT( ( dataSize == cacheId.GetLength() ) && ( memcmp( data, cacheId.Get(), dataSize ) == 0 ) );
+            cache.FreeMemory( data, dataSize );
+        }
+        void * data;
+        size_t dataSize;
+        TEST_ASSERT( cache.Retrieve( AStackString( "Missing" ), data, dataSize ) == false );
+        cache.Shutdown();
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestCache, Query )
+{
+    const AStackString dataA( "Data for entry A" );
+
+    StackArray<AString> cacheIds;
+    cacheIds.EmplaceBack( "QueryEntryA" );
+    cacheIds.EmplaceBack( "QueryEntryB" );
+
+    // Default cache
+    {
+        Cache cache;
+        TEST_ASSERT( cache.Init( AStackString( "../tmp/Test/Cache/Query" ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Publish( cacheIds[ 0 ], dataA.Get(), dataA.GetLength() ) );
+
+        StackArray<bool> found;
+        TEST_ASSERT( cache.Query( cacheIds, found ) );
+        TEST_ASSERT( ( found.GetSize() == 2 ) && ( found[ 0 ] == true ) && ( found[ 1 ] == false ) );
+        cache.Shutdown();
+    }
+
+    // Packed cache
+    {
+        PackedCache cache;
+        TEST_ASSERT( cache.Init( AStackString( "../tmp/Test/Cache/QueryPacked" ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Publish( cacheIds[ 0 ], dataA.Get(), dataA.GetLength() ) );
+
+        StackArray<bool> found;
+        TEST_ASSERT( cache.Query( cacheIds, found ) );
+        TEST_ASSERT( ( found.GetSize() == 2 ) && ( found[ 0 ] == true ) && ( found[ 1 ] == false ) );
+        cache.Shutdown();
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestCache, Tiered )
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/Tiered/fbuild.bff";
+
+    // Write (through to both tiers)
+    {
+        options.m_UseCacheWrite = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats & stats = fBuild.GetStats();
+        const FBuildStats::Stats & objStats = stats.GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheStores == objStats.m_NumProcessed );
+        TEST_ASSERT( stats.m_CacheTiered );
+        TEST_ASSERT( stats.m_CacheTiers[ TieredCache::L1 ].m_Stores == objStats.m_NumProcessed );
+        TEST_ASSERT( stats.m_CacheTiers[ TieredCache::L2 ].m_Stores == objStats.m_NumProcessed );
+    }
+
+    // Read (served from the local cache)
+    {
+        options.m_UseCacheRead = true;
+        options.m_UseCacheWrite = false;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats & stats = fBuild.GetStats();
+        const FBuildStats::Stats & objStats = stats.GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits == objStats.m_NumProcessed );
+        TEST_ASSERT( objStats.m_NumBuilt == 0 );
+        TEST_ASSERT( stats.m_CacheTiers[ TieredCache::L1 ].m_Hits == objStats.m_NumProcessed );
+        TEST_ASSERT( stats.m_CacheTiers[ TieredCache::L2 ].m_Lookups == 0 );
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestCache, TieredStore )
+{
+    const AStackString localPath( "../tmp/Test/Cache/TieredStore/Local" );
+    const AStackString sharedPath( "../tmp/Test/Cache/TieredStore/Shared" );
+    const AStackString cacheIdA( "0123456789ABCDEF_EntryA" ); // Entries are stored by the leading hex digits
+    const AStackString cacheIdB( "0123456789ABCDEF_EntryB" );
+
+    // Start empty
+    {
+        Cache local;
+        TEST_ASSERT( local.Init( localPath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( local.Trim( false, 0 ) );
+        Cache shared;
+        TEST_ASSERT( shared.Init( sharedPath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( shared.Trim( false, 0 ) );
+    }
+
+    // Store an entry in the shared cache only (as if from another machine)
+    const AStackString dataA( "Data for entry A" );
+    {
+        Cache shared;
+        TEST_ASSERT( shared.Init( sharedPath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( shared.Publish( cacheIdA, dataA.Get(), dataA.GetLength() ) );
+        shared.Shutdown();
+    }
+
+    // Entry is retrieved from the shared cache and promoted
+    {
+        TieredCache cache( FNEW( Cache() ), localPath, 10 );
+        TEST_ASSERT( cache.Init( sharedPath, AString::GetEmpty(), true, false, true, AString::GetEmpty() ) );
+
+        void * data;
+        size_t dataSize;
+        TEST_ASSERT( cache.Retrieve( cacheIdA, data, dataSize ) );
+        TEST_ASSERT( ( dataSize == dataA.GetLength() ) && ( memcmp( data, dataA.Get(), dataSize ) == 0 ) );
+        cache.FreeMemory( data, dataSize );
+        TEST_ASSERT( cache.Retrieve( cacheIdB, data, dataSize ) == false );
+
+        FBuildStats stats;
+        cache.GetStats( stats );
+        TEST_ASSERT( stats.m_CacheTiers[ TieredCache::L1 ].m_Lookups == 2 );
+        TEST_ASSERT( stats.m_CacheTiers[ TieredCache::L1 ].m_Hits == 0 );
+        TEST_ASSERT( stats.m_CacheTiers[ TieredCache::L2 ].m_Hits == 1 );
+        TEST_ASSERT( stats.m_CachePromotions == 1 );
+
+        cache.Shutdown();
+    }
+
+    // Remove the entry from the shared cache
+    {
+        Cache shared;
+        TEST_ASSERT( shared.Init( sharedPath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( shared.Trim( false, 0 ) );
+    }
+
+    // Entry is still available locally
+    {
+        TieredCache cache( FNEW( Cache() ), localPath, 10 );
+        TEST_ASSERT( cache.Init( sharedPath, AString::GetEmpty(), true, false, true, AString::GetEmpty() ) );
+
+        void * data;
+        size_t dataSize;
+        TEST_ASSERT( cache.Retrieve( cacheIdA, data, dataSize ) );
+        TEST_ASSERT( ( dataSize == dataA.GetLength() ) && ( memcmp( data, dataA.Get(), dataSize ) == 0 ) );
+        cache.FreeMemory( data, dataSize );
+
+        FBuildStats stats;
+        cache.GetStats( stats );
+        TEST_ASSERT( stats.m_CacheTiers[ TieredCache::L1 ].m_Hits == 1 );
+        TEST_ASSERT( stats.m_CacheTiers[ TieredCache::L2 ].m_Lookups == 0 );
+
+        // Both tiers are queried
+        StackArray<AString> cacheIds;
+        cacheIds.Append( cacheIdA );
+        cacheIds.Append( cacheIdB );
+        StackArray<bool> found;
+        TEST_ASSERT( cache.Query( cacheIds, found ) );
+        TEST_ASSERT( ( found.GetSize() == 2 ) && ( found[ 0 ] == true ) && ( found[ 1 ] == false ) );
+
+        cache.Shutdown();
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestCache, HTTP )
+{
+    HTTPCacheTestServer server;
+    TEST_ASSERT( server.Start() );
+    AStackString url;
+    server.GetURL( url );
+
+    // Unreachable server
+    {
+        HTTPCache cache;
+        const AStackString badURL( "http://127.0.0.1:1/cache" ); // Nothing listening
+        TEST_ASSERT( cache.Init( badURL, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) == false );
+        TEST_ASSERT( cache.Init( AStackString( "http://" ), AString::GetEmpty(), true, true, false, AString::GetEmpty() ) == false );
+    }
+
+    HTTPCache cache;
+    TEST_ASSERT( cache.Init( url, AString::GetEmpty(), true, true, true, AString::GetEmpty() ) );
+
+    // Binary data
+    const char dataA[] = { 'A', '\0', '\r', '\n', '\r', '\n', 'B' };
+    const AStackString cacheIdA( "0123456789ABCDEF_EntryA" );
+    const AStackString cacheIdB( "0123456789ABCDEF_EntryB" );
+    TEST_ASSERT( cache.Publish( cacheIdA, dataA, sizeof( dataA ) ) );
+    {
+        void * data;
+        size_t dataSize;
+        TEST_ASSERT( cache.Retrieve( cacheIdA, data, dataSize ) );
+        TEST_ASSERT( ( dataSize == sizeof( dataA ) ) && ( memcmp( data, dataA, dataSize ) == 0 ) );
+        cache.FreeMemory( data, dataSize );
+        TEST_ASSERT( cache.Retrieve( cacheIdB, data, dataSize ) == false );
+    }
+
+    // Check for existence
+    {
+        StackArray<AString> cacheIds;
+        cacheIds.Append( cacheIdA );
+        cacheIds.Append( cacheIdB );
+        StackArray<bool> found;
+        TEST_ASSERT( cache.Query( cacheIds, found ) );
+        TEST_ASSERT( ( found.GetSize() == 2 ) && ( found[ 0 ] == true ) && ( found[ 1 ] == false ) );
+    }
+
+    // Checks for many entries are pipelined
+    {
+        Array<AString> cacheIds;
+        cacheIds.Append( cacheIdA );
+        for ( uint32_t i = 1; i < 100; ++i )
+        {
+            cacheIds.EmplaceBack().Format( "0123456789ABCDEF_Missing%u", i );
+        }
+        const uint32_t numHeads = server.GetNumRequests( "HEAD" );
+        Array<bool> found;
+        TEST_ASSERT( cache.Query( cacheIds, found ) );
+        TEST_ASSERT( ( found.GetSize() == 100 ) && ( found[ 0 ] == true ) && ( found.Find( true ) == found.Begin() ) );
+        TEST_ASSERT( server.GetNumRequests( "HEAD" ) == ( numHeads + 100 ) );
+        TEST_ASSERT( server.GetNumPipelinedRequests() > 0 );
+    }
+
+    // Large entries, with and without chunked transfer encoding
+    {
+        const size_t largeSize = ( 8 * 1024 * 1024 ) + 3;
+        char * largeData = static_cast<char *>( ALLOC( largeSize ) );
+        for ( size_t i = 0; i < largeSize; ++i )
+        {
+            largeData[ i ] = static_cast<char>( i * 7 );
+        }
+        TEST_ASSERT( cache.Publish( cacheIdB, largeData, largeSize ) );
+        for ( uint32_t pass = 0; pass < 2; ++pass )
+        {
+            server.SetUseChunkedEncoding( pass == 1 );
+            void * data;
+            size_t dataSize;
+            TEST_ASSERT( cache.Retrieve( cacheIdB, data, dataSize ) );
+            TEST_ASSERT( ( dataSize == largeSize ) && ( memcmp( data, largeData, dataSize ) == 0 ) );
+            cache.FreeMemory( data, dataSize );
+        }
+        server.SetUseChunkedEncoding( false );
+        FREE( largeData );
+    }
+
+    // All requests so far re-used one connection
+    TEST_ASSERT( cache.GetNumConnectionsOpened() == 1 );
+    TEST_ASSERT( server.GetNumConnections() == 1 );
+
+    // Concurrent requests
+    {
+        class ThreadContext
+        {
+        public:
+            HTTPCache * m_Cache;
+            uint32_t m_ThreadIndex;
+            Atomic<uint32_t> * m_NumFailures;
+        };
+        const uint32_t kNumThreads = 4;
+        Atomic<uint32_t> numFailures;
+        ThreadContext contexts[ kNumThreads ];
+        Thread threads[ kNumThreads ];
+        for ( uint32_t i = 0; i < kNumThreads; ++i )
+        {
+            contexts[ i ] = ThreadContext{ &cache, i, &numFailures };
+            threads[ i ].Start( []( void * param ) -> uint32_t
+                                {
+                                    ThreadContext & context = *static_cast<ThreadContext *>( param );
+                                    for ( uint32_t j = 0; j < 50; ++j )
+                                    {
+                                        AStackString cacheId;
+                                        cacheId.Format( "0123456789ABCDEF_Thread%u_%u", context.m_ThreadIndex, j );
+                                        void * data = nullptr;
+                                        size_t dataSize = 0;
+                                        if ( ( context.m_Cache->Publish( cacheId, cacheId.Get(), cacheId.GetLength() ) == false ) ||
+                                             ( context.m_Cache->Retrieve( cacheId, data, dataSize ) == false ) ||
+                                             ( dataSize != cacheId.GetLength() ) ||
+                                             ( memcmp( data, cacheId.Get(), dataSize ) != 0 ) )
+                                        {
+                                            context.m_NumFailures->Increment();
+                                        }
+                                        context.m_Cache->FreeMemory( data, dataSize );
+                                    }
+                                    return 0;
+                                },
+                                "HTTPCacheTest",
+                                &contexts[ i ] );
+        }
+        for ( Thread & thread : threads )
+        {
+            thread.Join();
+        }
+        TEST_ASSERT( numFailures.Load() == 0 );
+        TEST_ASSERT( server.GetNumEntries() == ( 2 + ( kNumThreads * 50 ) ) );
+        TEST_ASSERT( cache.GetNumConnectionsOpened() <= ( kNumThreads + 1 ) );
+    }
+
+    // Idle connections closed by the server are replaced
+    server.CloseConnections();
+    {
+        void * data;
+        size_t dataSize;
+        TEST_ASSERT( cache.Retrieve( cacheIdA, data, dataSize ) );
+        TEST_ASSERT( ( dataSize == sizeof( dataA ) ) && ( memcmp( data, dataA, dataSize ) == 0 ) );
+        cache.FreeMemory( data, dataSize );
+    }
+
+    // Responses which are too large are rejected without being received
+    {
+        server.SetAdvertisedContentLength( (uint64_t)1 << 40 );
+        void * data;
+        size_t dataSize;
+        TEST_ASSERT( cache.Retrieve( cacheIdA, data, dataSize ) == false );
+        server.SetAdvertisedContentLength( 0 );
+
+        // Cache remains usable
+        TEST_ASSERT( cache.Retrieve( cacheIdA, data, dataSize ) );
+        cache.FreeMemory( data, dataSize );
+    }
+
+    // Transient failures are retried
+    {
+        server.SetNumRequestsToDrop( 2 );
+        void * data;
+        size_t dataSize;
+        TEST_ASSERT( cache.Retrieve( cacheIdA, data, dataSize ) );
+        TEST_ASSERT( ( dataSize == sizeof( dataA ) ) && ( memcmp( data, dataA, dataSize ) == 0 ) );
+        cache.FreeMemory( data, dataSize );
+
+        server.SetNumRequestsToDrop( 2 );
+        StackArray<AString> cacheIds;
+        cacheIds.Append( cacheIdA );
+        cacheIds.Append( cacheIdB );
+        StackArray<bool> found;
+        TEST_ASSERT( cache.Query( cacheIds, found ) );
+        TEST_ASSERT( ( found.GetSize() == 2 ) && ( found[ 0 ] == true ) && ( found[ 1 ] == true ) );
+    }
+
+    // Once the server is gone, requests fail without further attempts
+    server.Stop();
+    {
+        void * data;
+        size_t dataSize;
+        TEST_ASSERT( cache.Retrieve( cacheIdA, data, dataSize ) == false );
+        const uint32_t numConnectionsOpened = cache.GetNumConnectionsOpened();
+        TEST_ASSERT( cache.Publish( cacheIdA, dataA, sizeof( dataA ) ) == false );
+        TEST_ASSERT( cache.GetNumConnectionsOpened() == numConnectionsOpened );
+    }
+
+    cache.Shutdown();
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestCache, HTTPBuild )
+{
+    HTTPCacheTestServer server;
+    TEST_ASSERT( server.Start() );
+    AStackString url;
+    server.GetURL( url );
+    TEST_ASSERT( Env::SetEnvVariable( "FASTBUILD_TEST_HTTP_CACHE_URL", url ) );
+
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/HTTP/fbuild.bff";
+
+    // Write
+    {
+        options.m_UseCacheWrite = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheStores == objStats.m_NumProcessed );
+        TEST_ASSERT( objStats.m_NumBuilt == objStats.m_NumProcessed );
+        TEST_ASSERT( server.GetNumEntries() == objStats.m_NumProcessed );
+    }
+
+    // Read
+    {
+        options.m_UseCacheRead = true;
+        options.m_UseCacheWrite = false;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+        const FBuildStats::Stats & objStats = fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE );
+        TEST_ASSERT( objStats.m_NumCacheHits == objStats.m_NumProcessed );
+        TEST_ASSERT( objStats.m_NumBuilt == 0 );
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestCache, Probe )
+{
+    FBuildTestOptions options;
+    options.m_ForceCleanBuild = true;
+    options.m_CacheVerbose = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/LightCache_IncludeHierarchy/fbuild.bff";
+
+    // Write
+    {
+        options.m_UseCacheWrite = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        CheckLightCacheStores( fBuild, 2 );
+
+        // Nothing is looked up when not reading from the cache
+        TEST_ASSERT( fBuild.GetStats().m_NumCacheProbeKeyed == 0 );
+    }
+
+    // Read, with lookups ahead of compilation
+    {
+        options.m_UseCacheRead = true;
+        options.m_UseCacheWrite = false;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        CheckLightCacheHits( fBuild, 2 );
+
+        // Workers race the lookups (taking over those not yet complete), so only
+        // the upper bounds are known
+        const FBuildStats & stats = fBuild.GetStats();
+        TEST_ASSERT( stats.m_NumCacheProbeKeyed <= 2 );
+        TEST_ASSERT( stats.m_NumCacheProbeMisses == 0 );
+        TEST_ASSERT( stats.m_NumCacheProbeHits <= stats.m_NumCacheProbeKeyed );
+        TEST_ASSERT( stats.m_NumCacheProbeFetched <= stats.m_NumCacheProbeHits );
+
+        // Without workers, every lookup completes
+        Array<const Node *> objects;
+        fBuild.GetNodesOfType( Node::OBJECT_NODE, objects );
+        TEST_ASSERT( objects.GetSize() == 2 );
+        Array<Node *> nodes;
+        for ( const Node * object : objects )
+        {
+            nodes.Append( const_cast<Node *>( object ) );
+        }
+        {
+            CacheProbe probe( fBuild.GetCache() );
+            probe.Queue( nodes );
+            FBuildStats probeStats;
+            probe.Flush( probeStats );
+            TEST_ASSERT( probeStats.m_NumCacheProbeKeyed == 2 );
+            TEST_ASSERT( probeStats.m_NumCacheProbeHits == 2 );
+            TEST_ASSERT( probeStats.m_NumCacheProbeMisses == 0 );
+            TEST_ASSERT( probeStats.m_NumCacheProbeFetched == 2 );
+        }
+
+        // Same lookups in an empty cache
+        {
+            Cache emptyCache;
+            TEST_ASSERT( emptyCache.Init( AStackString( "../tmp/Test/Cache/ProbeEmpty" ), AString::GetEmpty(), true, false, false, AString::GetEmpty() ) );
+            CacheProbe probe( &emptyCache );
+            probe.Queue( nodes );
+            FBuildStats probeStats;
+            probe.Flush( probeStats );
+            TEST_ASSERT( probeStats.m_NumCacheProbeKeyed == 2 );
+            TEST_ASSERT( probeStats.m_NumCacheProbeHits == 0 );
+            TEST_ASSERT( probeStats.m_NumCacheProbeMisses == 2 );
+            TEST_ASSERT( probeStats.m_NumCacheProbeFetched == 0 );
+            emptyCache.Shutdown();
+        }
+    }
+
+    // Read, without lookups ahead of compilation
+    {
+        options.m_CacheProbe = false;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        CheckLightCacheHits( fBuild, 2 );
+        TEST_ASSERT( fBuild.GetStats().m_NumCacheProbeKeyed == 0 );
+    }
+}
+
 //------------------------------------------------------------------------------
 TEST_CASE( TestCache, ConsistentCacheKeysWithDist )
 {
@@ -673,6 +1422,88 @@ TEST_CASE( TestCache, LightCache_IncludeHierarchy )
     }
 }
 
+//------------------------------------------------------------------------------
+TEST_CASE( TestCache, LightCache_PersistentIndex )
+{
+    // Files parsed by the LightCache are persisted alongside the DB and
+    // re-used by subsequent builds
+
+    FBuildTestOptions options;
+    options.m_CacheVerbose = true;
+    options.m_ForceCleanBuild = true;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/LightCache_IncludeHierarchy/fbuild.bff";
+
+    const char * const dbFile = "../tmp/Test/Cache/LightCache_PersistentIndex/fbuild.fdb";
+    const char * const indexFile = "../tmp/Test/Cache/LightCache_PersistentIndex/fbuild.fdb.lightcache";
+    EnsureFileDoesNotExist( indexFile );
+
+    const char * const expectedFiles[] = { "Folder1/file.cpp", "Folder1/file.h", "Folder2/file.cpp", "Folder2/file.h", "common.h" };
+
+    // Write, parsing files and creating the index
+    {
+        options.m_UseCacheRead = false;
+        options.m_UseCacheWrite = true;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+        CheckLightCacheStores( fBuild, 2 );
+
+        EnsureFileExists( indexFile );
+    }
+
+    // Read, using the index. The resulting keys and dependencies must be identical
+    {
+        options.m_UseCacheRead = true;
+        options.m_UseCacheWrite = false;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        CheckLightCacheHits( fBuild, 2 );
+
+        CheckForDependencies( fBuild, expectedFiles, sizeof( expectedFiles ) / sizeof( const char * ) );
+    }
+
+    // Entries not used by a build are kept in the index (for other targets)
+    {
+        FileIO::FileInfo fullInfo;
+        TEST_ASSERT( FileIO::GetFileInfo( AStackString( indexFile ), fullInfo ) );
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+
+        // Only one of the two files (and the headers it includes)
+#if defined( __WINDOWS__ )
+        TEST_ASSERT( fBuild.Build( "../tmp/Test/Cache/LightCache_IncludeHierarchy/Folder1/file.obj" ) );
+#else
+        TEST_ASSERT( fBuild.Build( "../tmp/Test/Cache/LightCache_IncludeHierarchy/Folder1/file.o" ) );
+#endif
+        CheckLightCacheHits( fBuild, 1 );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        FileIO::FileInfo info;
+        TEST_ASSERT( FileIO::GetFileInfo( AStackString( indexFile ), info ) );
+        TEST_ASSERT( info.m_Size == fullInfo.m_Size );
+    }
+
+    // A corrupt index is ignored
+    {
+        MakeFile( indexFile, "Corrupt" );
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        CheckLightCacheHits( fBuild, 2 );
+
+        CheckForDependencies( fBuild, expectedFiles, sizeof( expectedFiles ) / sizeof( const char * ) );
+    }
+}
+
 //------------------------------------------------------------------------------
 TEST_CASE( TestCache, LightCache_CyclicInclude )
 {
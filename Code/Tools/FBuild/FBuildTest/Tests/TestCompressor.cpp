@@ -5,11 +5,13 @@
 //------------------------------------------------------------------------------
 #include "FBuildTest.h"
 
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
 #include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 
 // Core
 #include "Core/Containers/UniquePtr.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Strings/AString.h"
 #include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
@@ -26,6 +28,7 @@ public:
                                bool shouldCompress,
                                bool useZstd = false ) const;
     void CompressHelper( const char * fileName ) const;
+    void CompressFramedHelper( const char * data, size_t dataSize, bool useZstd, int32_t compressionLevel ) const;
 };
 
 //------------------------------------------------------------------------------
@@ -257,6 +260,311 @@ void TestCompressor::CompressHelper( const char * fileName ) const
     OUTPUT( "------------------------------------------------\n" );
 }
 
+//------------------------------------------------------------------------------
+TEST_CASE( TestCompressor, CompressFramed )
+{
+    // Several chunks, with a partial last chunk, mixing compressible and
+    // incompressible data
+    const size_t dataSize = ( ( Compressor::kChunkSize * 3 ) + 12345 );
+    UniquePtr<char, FreeDeletor> data( (char *)ALLOC( dataSize ) );
+    uint32_t random = 0x12345678;
+    for ( size_t i = 0; i < dataSize; ++i )
+    {
+        if ( ( i / Compressor::kChunkSize ) == 1 )
+        {
+            random = ( random * 1103515245 ) + 12345;
+            data.Get()[ i ] = (char)( random >> 16 ); // Incompressible chunk
+        }
+        else
+        {
+            data.Get()[ i ] = (char)( 'A' + ( ( i / 7 ) % 26 ) );
+        }
+    }
+
+    CompressFramedHelper( data.Get(), dataSize, false, 0 );     // Disabled
+    CompressFramedHelper( data.Get(), dataSize, false, -1 );    // LZ4
+    CompressFramedHelper( data.Get(), dataSize, false, 3 );     // LZ4 HC
+    CompressFramedHelper( data.Get(), dataSize, true, 0 );      // Disabled
+    CompressFramedHelper( data.Get(), dataSize, true, 3 );      // Zstd
+
+    // Framing can be disabled for receivers that don't support it
+    {
+        Compressor c( false );
+        TEST_ASSERT( c.Compress( data.Get(), dataSize ) );
+        TEST_ASSERT( Compressor::IsValidData( c.GetResult(), c.GetResultSize() ) );
+        TEST_ASSERT( Compressor::IsFramedData( c.GetResult(), c.GetResultSize() ) == false );
+    }
+
+    // Data below the chunk size is not framed
+    {
+        Compressor c;
+        TEST_ASSERT( c.Compress( data.Get(), Compressor::kChunkSize ) );
+        TEST_ASSERT( Compressor::IsFramedData( c.GetResult(), c.GetResultSize() ) == false );
+    }
+
+    // Corrupt chunk tables are detected
+    {
+        Compressor c;
+        TEST_ASSERT( c.Compress( data.Get(), dataSize ) );
+        uint32_t * chunkTable = (uint32_t *)( (char *)c.GetResult() + 24 ); // After header
+        chunkTable[ 1 ] -= 1; // Compressed size of first chunk
+        TEST_ASSERT( Compressor::IsValidData( c.GetResult(), c.GetResultSize() ) == false );
+        chunkTable[ 1 ] += 1;
+        TEST_ASSERT( Compressor::IsValidData( c.GetResult(), c.GetResultSize() ) );
+        TEST_ASSERT( Compressor::IsValidData( c.GetResult(), c.GetResultSize() - 1 ) == false );
+    }
+
+    // Corrupt chunk data is reported as such when decompressing to a file
+    {
+        Compressor c;
+        TEST_ASSERT( c.Compress( data.Get(), dataSize ) );
+        const uint64_t numChunks = ( ( dataSize + Compressor::kChunkSize - 1 ) / Compressor::kChunkSize );
+        char * chunkData = ( (char *)c.GetResult() + 24 + ( numChunks * 8 ) ); // After header and chunk table
+        memset( chunkData, 0xFF, 64 );
+        TEST_ASSERT( Compressor::IsValidData( c.GetResult(), c.GetResultSize() ) ); // Only sizes are validated
+
+        EnsureDirExists( "../tmp/Test/Compressor/" );
+        FileStream f;
+        TEST_ASSERT( f.Open( "../tmp/Test/Compressor/Corrupt.bin", FileStream::WRITE_ONLY ) );
+        Compressor d;
+        TEST_ASSERT( d.DecompressToFile( c.GetResult(), f ) == false );
+        TEST_ASSERT( d.IsDataCorrupt() );
+    }
+}
+
+// CompressFramedHelper
+//------------------------------------------------------------------------------
+void TestCompressor::CompressFramedHelper( const char * data, size_t dataSize, bool useZstd, int32_t compressionLevel ) const
+{
+    // compress
+    Compressor c;
+    const bool compressed = useZstd ? c.CompressZstd( data, dataSize, compressionLevel )
+                                    : c.Compress( data, dataSize, compressionLevel );
+    TEST_ASSERT( compressed == ( compressionLevel != 0 ) );
+    TEST_ASSERT( Compressor::IsValidData( c.GetResult(), c.GetResultSize() ) );
+    TEST_ASSERT( Compressor::IsFramedData( c.GetResult(), c.GetResultSize() ) );
+    TEST_ASSERT( Compressor::GetUncompressedSize( c.GetResult(), c.GetResultSize() ) == dataSize );
+
+    // decompress to memory
+    {
+        Compressor d;
+        TEST_ASSERT( d.Decompress( c.GetResult() ) );
+        TEST_ASSERT( d.GetResultSize() == dataSize );
+        TEST_ASSERT( memcmp( data, d.GetResult(), dataSize ) == 0 );
+    }
+
+    // decompress to file
+    {
+        const char * fileName = "../tmp/Test/Compressor/Framed.bin";
+        EnsureDirExists( "../tmp/Test/Compressor/" );
+        {
+            FileStream f;
+            TEST_ASSERT( f.Open( fileName, FileStream::WRITE_ONLY ) );
+            Compressor d;
+            TEST_ASSERT( d.DecompressToFile( c.GetResult(), f ) );
+            TEST_ASSERT( d.GetResult() == nullptr ); // Nothing held in memory
+        }
+        FileStream f;
+        TEST_ASSERT( f.Open( fileName ) );
+        TEST_ASSERT( f.GetFileSize() == dataSize );
+        UniquePtr<char, FreeDeletor> readBack( (char *)ALLOC( dataSize ) );
+        TEST_ASSERT( f.ReadBuffer( readBack.Get(), dataSize ) == dataSize );
+        TEST_ASSERT( memcmp( data, readBack.Get(), dataSize ) == 0 );
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestCompressor, CompressFramedThroughput )
+{
+    // Build a large buffer from representative data
+    const char * fileName = "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii";
+    UniquePtr<char, FreeDeletor> fileData;
+    size_t fileSize;
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( fileName ) );
+        fileSize = (size_t)fs.GetFileSize();
+        fileData.Replace( (char *)ALLOC( fileSize ) );
+        TEST_ASSERT( fs.ReadBuffer( fileData.Get(), fileSize ) == fileSize );
+    }
+#if defined( __ASAN__ ) || defined( __TSAN__ ) || defined( __MSAN__ )
+    const size_t dataSize = ( 8 * MEGABYTE ); // Slow sanitizer configs use less data
+#else
+    const size_t dataSize = ( 32 * MEGABYTE );
+#endif
+    UniquePtr<char, FreeDeletor> data( (char *)ALLOC( dataSize ) );
+    for ( size_t i = 0; i < dataSize; ++i )
+    {
+        // Offset the bytes of each copy so copies don't match each other, which
+        // would favor the long match window of single block compression
+        const size_t copy = ( i / fileSize );
+        data.Get()[ i ] = (char)( fileData.Get()[ i % fileSize ] + (char)copy );
+    }
+
+    OUTPUT( "Size           : %u MiB\n", (uint32_t)( dataSize / MEGABYTE ) );
+    OUTPUT( "             |     Compression (MB/s)    |    Decompression (MB/s)\n" );
+    OUTPUT( "Level        |  Single   Framed  Speedup |  Single   Framed  Speedup\n" );
+    OUTPUT( "---------------------------------------------------------------------\n" );
+
+    // clang-format off
+    const struct
+    {
+        const char * m_Name;
+        bool m_UseZstd;
+        int32_t m_CompressionLevel;
+    } levels[] =
+    {
+        { "LZ4 -8", false, -8 },
+        { "LZ4 -1", false, -1 },
+        { "LZ4HC 3", false, 3 },
+        { "LZ4HC 9", false, 9 },
+        { "Zstd 1", true, 1 },
+        { "Zstd 3", true, 3 },
+        { "Zstd 9", true, 9 },
+    };
+    // clang-format on
+
+    for ( const auto & level : levels )
+    {
+        double compressMBs[ 2 ];
+        double decompressMBs[ 2 ];
+        for ( uint32_t pass = 0; pass < 2; ++pass )
+        {
+            const bool allowFraming = ( pass == 1 );
+
+            const Timer t;
+            Compressor c( allowFraming );
+            if ( level.m_UseZstd )
+            {
+                c.CompressZstd( data.Get(), dataSize, level.m_CompressionLevel );
+            }
+            else
+            {
+                c.Compress( data.Get(), dataSize, level.m_CompressionLevel );
+            }
+            const double compressTime = (double)t.GetElapsed();
+            TEST_ASSERT( Compressor::IsFramedData( c.GetResult(), c.GetResultSize() ) == allowFraming );
+
+            const Timer t2;
+            Compressor d;
+            TEST_ASSERT( d.Decompress( c.GetResult() ) );
+            const double decompressTime = (double)t2.GetElapsed();
+            TEST_ASSERT( memcmp( data.Get(), d.GetResult(), dataSize ) == 0 );
+
+            compressMBs[ pass ] = ( (double)dataSize / Math::Max( compressTime, 0.0001 ) ) / (double)MEGABYTE;
+            decompressMBs[ pass ] = ( (double)dataSize / Math::Max( decompressTime, 0.0001 ) ) / (double)MEGABYTE;
+        }
+
+        OUTPUT( "%-12s | %7.1f  %7.1f  %6.2fx | %7.1f  %7.1f  %6.2fx\n",
+                level.m_Name,
+                compressMBs[ 0 ],
+                compressMBs[ 1 ],
+                compressMBs[ 1 ] / compressMBs[ 0 ],
+                decompressMBs[ 0 ],
+                decompressMBs[ 1 ],
+                decompressMBs[ 1 ] / decompressMBs[ 0 ] );
+    }
+    OUTPUT( "---------------------------------------------------------------------\n" );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestCompressor, CompressDictionary )
+{
+    AString file;
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii" ) );
+        file.SetLength( (uint32_t)fs.GetFileSize() );
+        TEST_ASSERT( fs.Read( file.Get(), file.GetLength() ) == file.GetLength() );
+    }
+
+    // Simulate translation units which share the same headers, followed by
+    // their own unique code
+    const uint32_t kSharedSize = ( 32 * 1024 );
+    const uint32_t kUniqueSize = ( 32 * 1024 );
+    auto makeUnit = [ & ]( uint32_t index, AString & outUnit ) {
+        outUnit.Assign( file.Get(), file.Get() + kSharedSize );
+        const char * unique = ( file.Get() + kSharedSize + ( index * kUniqueSize ) );
+        outUnit.Append( unique, kUniqueSize );
+    };
+
+    // Train
+    CompressionDictionaryTrainer trainer;
+    const CompressionDictionary * dictionary = nullptr;
+    for ( uint32_t i = 0; i < CompressionDictionaryTrainer::GetNumSamples(); ++i )
+    {
+        TEST_ASSERT( dictionary == nullptr );
+        AString unit;
+        makeUnit( i, unit );
+        dictionary = trainer.AddSample( unit.Get(), unit.GetLength() );
+    }
+    TEST_ASSERT( dictionary );
+    TEST_ASSERT( dictionary == trainer.GetDictionary() );
+    TEST_ASSERT( dictionary->GetId() != 0 );
+    TEST_ASSERT( dictionary->GetSize() >= ( kSharedSize / 2 ) ); // Most of the shared content
+    TEST_ASSERT( dictionary->GetSize() <= CompressionDictionary::kDefaultMaxSize );
+
+    // Compress a unit not used for training
+    AString unit;
+    makeUnit( CompressionDictionaryTrainer::GetNumSamples(), unit );
+    Compressor plain;
+    TEST_ASSERT( plain.CompressZstd( unit.Get(), unit.GetLength(), 3 ) );
+    Compressor withDictionary;
+    TEST_ASSERT( withDictionary.CompressZstd( unit.Get(), unit.GetLength(), 3, dictionary ) );
+    const void * data = withDictionary.GetResult();
+    const size_t dataSize = withDictionary.GetResultSize();
+    TEST_ASSERT( Compressor::IsValidData( data, dataSize ) );
+    TEST_ASSERT( Compressor::GetDictionaryId( data, dataSize ) == dictionary->GetId() );
+    TEST_ASSERT( Compressor::GetDictionaryId( plain.GetResult(), plain.GetResultSize() ) == 0 );
+    OUTPUT( "Zstd                 : %zu\n", plain.GetResultSize() );
+    OUTPUT( "Zstd with dictionary : %zu\n", dataSize );
+    TEST_ASSERT( dataSize < ( plain.GetResultSize() * 3 / 4 ) );
+
+    // Decompress with the dictionary (received remotely)
+    {
+        CompressionDictionary received;
+        received.Load( dictionary->GetData(), dictionary->GetSize() );
+        TEST_ASSERT( received.GetId() == dictionary->GetId() );
+        Compressor d;
+        TEST_ASSERT( d.Decompress( data, &received ) );
+        TEST_ASSERT( d.GetResultSize() == unit.GetLength() );
+        TEST_ASSERT( memcmp( d.GetResult(), unit.Get(), unit.GetLength() ) == 0 );
+    }
+
+    // Dictionaries stay alive while referenced (i.e. by an in-progress job
+    // after the client which sent it has disconnected)
+    {
+        CompressionDictionary * received = FNEW( CompressionDictionary );
+        received->Load( dictionary->GetData(), dictionary->GetSize() );
+        received->AddRef(); // Job
+        received->Release(); // Owner
+        Compressor d;
+        TEST_ASSERT( d.Decompress( data, received ) );
+        TEST_ASSERT( d.GetResultSize() == unit.GetLength() );
+        received->Release(); // Job (frees)
+    }
+
+    // Decompression without the correct dictionary fails
+    {
+        Compressor d;
+        TEST_ASSERT( d.Decompress( data ) == false );
+        CompressionDictionary other;
+        other.Load( unit.Get(), 1024 );
+        TEST_ASSERT( d.Decompress( data, &other ) == false );
+    }
+
+    // Framed data doesn't use the dictionary
+    {
+        const size_t framedSize = ( Compressor::kChunkSize + 1 );
+        UniquePtr<char, FreeDeletor> framedData( (char *)ALLOC( framedSize ) );
+        memset( framedData.Get(), 'A', framedSize );
+        Compressor c;
+        TEST_ASSERT( c.CompressZstd( framedData.Get(), framedSize, 3, dictionary ) );
+        TEST_ASSERT( Compressor::IsFramedData( c.GetResult(), c.GetResultSize() ) );
+        TEST_ASSERT( Compressor::GetDictionaryId( c.GetResult(), c.GetResultSize() ) == 0 );
+    }
+}
+
 //------------------------------------------------------------------------------
 TEST_CASE( TestCompressor, TestHeaderValidity )
 {
@@ -0,0 +1,180 @@
+// TestContentChunker.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/Helpers/ContentChunker.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Math/Random.h"
+
+#include <memory.h>
+
+//------------------------------------------------------------------------------
+TEST_GROUP( TestContentChunker, FBuildTest )
+{
+public:
+    void GenerateData( uint32_t seed, size_t size, Array<uint8_t> & outData ) const;
+    void GetChunks( const ContentChunker & chunker, const Array<uint8_t> & data, Array<uint32_t> & outChunkSizes ) const;
+    void GetBoundaries( const Array<uint32_t> & chunkSizes, Array<uint64_t> & outBoundaries ) const;
+
+    static const uint32_t kMinSize = 256;
+    static const uint32_t kAverageSize = 1024;
+    static const uint32_t kMaxSize = 4096;
+};
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestContentChunker, Bounds )
+{
+    const ContentChunker chunker( kMinSize, kAverageSize, kMaxSize );
+
+    Array<uint8_t> data;
+    GenerateData( 1, 1024 * 1024, data );
+    Array<uint32_t> chunkSizes;
+    GetChunks( chunker, data, chunkSizes );
+
+    // Every chunk is within the limits (except the last, which can be short)
+    uint64_t totalSize = 0;
+    for ( size_t i = 0; i < chunkSizes.GetSize(); ++i )
+    {
+        TEST_ASSERT( chunkSizes[ i ] <= kMaxSize );
+        TEST_ASSERT( ( chunkSizes[ i ] >= kMinSize ) || ( ( i + 1 ) == chunkSizes.GetSize() ) );
+        totalSize += chunkSizes[ i ];
+    }
+    TEST_ASSERT( totalSize == data.GetSize() );
+
+    // Average is close to that requested (boundaries can't occur before the
+    // minimum size, so chunks are a bit larger on average)
+    const uint64_t averageSize = ( totalSize / chunkSizes.GetSize() );
+    TEST_ASSERT( averageSize >= ( kAverageSize / 2 ) );
+    TEST_ASSERT( averageSize <= ( kAverageSize * 2 ) );
+
+    // Data without any boundaries is split at the maximum size
+    Array<uint8_t> zeros;
+    zeros.SetSize( kMaxSize * 3 );
+    memset( zeros.Begin(), 0, zeros.GetSize() );
+    TEST_ASSERT( chunker.GetChunkSize( zeros.Begin(), zeros.GetSize() ) == kMaxSize );
+
+    // Data smaller than the minimum is a single chunk
+    TEST_ASSERT( chunker.GetChunkSize( data.Begin(), kMinSize - 1 ) == ( kMinSize - 1 ) );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestContentChunker, Deterministic )
+{
+    Array<uint8_t> data;
+    GenerateData( 2, 256 * 1024, data );
+
+    // Same data gives the same chunks, with separate chunker instances
+    Array<uint32_t> chunkSizesA;
+    Array<uint32_t> chunkSizesB;
+    GetChunks( ContentChunker( kMinSize, kAverageSize, kMaxSize ), data, chunkSizesA );
+    GetChunks( ContentChunker( kMinSize, kAverageSize, kMaxSize ), data, chunkSizesB );
+    TEST_ASSERT( chunkSizesA.GetSize() > 1 );
+    TEST_ASSERT( chunkSizesA.GetSize() == chunkSizesB.GetSize() );
+    for ( size_t i = 0; i < chunkSizesA.GetSize(); ++i )
+    {
+        TEST_ASSERT( chunkSizesA[ i ] == chunkSizesB[ i ] );
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestContentChunker, InsertionOnlyChangesNearbyChunks )
+{
+    const ContentChunker chunker( kMinSize, kAverageSize, kMaxSize );
+
+    Array<uint8_t> original;
+    GenerateData( 3, 256 * 1024, original );
+
+    // Insert some bytes part way through
+    const size_t insertPos = ( original.GetSize() / 2 );
+    const size_t insertSize = 100;
+    Array<uint8_t> modified;
+    modified.SetSize( original.GetSize() + insertSize );
+    memcpy( modified.Begin(), original.Begin(), insertPos );
+    memset( modified.Begin() + insertPos, 0xAB, insertSize );
+    memcpy( modified.Begin() + insertPos + insertSize, original.Begin() + insertPos, original.GetSize() - insertPos );
+
+    Array<uint32_t> originalSizes;
+    Array<uint32_t> modifiedSizes;
+    GetChunks( chunker, original, originalSizes );
+    GetChunks( chunker, modified, modifiedSizes );
+    Array<uint64_t> originalBoundaries;
+    Array<uint64_t> modifiedBoundaries;
+    GetBoundaries( originalSizes, originalBoundaries );
+    GetBoundaries( modifiedSizes, modifiedBoundaries );
+
+    // Boundaries before the insertion are unchanged
+    size_t numBefore = 0;
+    for ( const uint64_t boundary : originalBoundaries )
+    {
+        if ( boundary > insertPos )
+        {
+            break;
+        }
+        TEST_ASSERT( modifiedBoundaries.Find( boundary ) != nullptr );
+        ++numBefore;
+    }
+    TEST_ASSERT( numBefore > 0 );
+
+    // Boundaries after the insertion re-synchronize (shifted by the insertion),
+    // so almost all chunks are shared
+    size_t numAfter = 0;
+    size_t numShared = 0;
+    for ( const uint64_t boundary : originalBoundaries )
+    {
+        if ( boundary <= insertPos )
+        {
+            continue;
+        }
+        ++numAfter;
+        if ( modifiedBoundaries.Find( boundary + insertSize ) )
+        {
+            ++numShared;
+        }
+    }
+    TEST_ASSERT( numAfter > 0 );
+    TEST_ASSERT( ( numAfter - numShared ) <= 2 );
+}
+
+//------------------------------------------------------------------------------
+void TestContentChunker::GenerateData( uint32_t seed, size_t size, Array<uint8_t> & outData ) const
+{
+    Random r( seed );
+    outData.SetSize( size );
+    for ( uint8_t & byte : outData )
+    {
+        byte = (uint8_t)r.GetRand();
+    }
+}
+
+//------------------------------------------------------------------------------
+void TestContentChunker::GetChunks( const ContentChunker & chunker, const Array<uint8_t> & data, Array<uint32_t> & outChunkSizes ) const
+{
+    outChunkSizes.Clear();
+    size_t pos = 0;
+    while ( pos < data.GetSize() )
+    {
+        const uint32_t chunkSize = chunker.GetChunkSize( data.Begin() + pos, data.GetSize() - pos );
+        TEST_ASSERT( chunkSize > 0 );
+        outChunkSizes.Append( chunkSize );
+        pos += chunkSize;
+    }
+}
+
+//------------------------------------------------------------------------------
+void TestContentChunker::GetBoundaries( const Array<uint32_t> & chunkSizes, Array<uint64_t> & outBoundaries ) const
+{
+    outBoundaries.Clear();
+    uint64_t pos = 0;
+    for ( const uint32_t chunkSize : chunkSizes )
+    {
+        pos += chunkSize;
+        outBoundaries.Append( pos );
+    }
+}
+
+//------------------------------------------------------------------------------
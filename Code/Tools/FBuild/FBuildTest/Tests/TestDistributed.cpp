@@ -7,16 +7,25 @@
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/CompressionDictionary.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ToolchainStore.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobResultCache.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThreadRemote.h"
 
 // Core
 #include "Core/FileIO/FileIO.h"
+#include "Core/Math/xxHash.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
 #include "Core/Tracing/Tracing.h"
 
+// system
+#include <string.h> // for memset
+
 // Defines
 //------------------------------------------------------------------------------
 #if !defined( __has_feature )
@@ -31,6 +40,9 @@ public:
                      uint32_t numRemoteWorkers,
                      bool shouldFail = false,
                      bool allowRace = false ) const;
+    void GetWorkerFiles( Array<AString> & outFiles ) const;
+    void GetRemoteOnlyOptions( FBuildTestOptions & outOptions ) const;
+    void TrimChunksHelper( char fillA, char fillB, bool chunkAInUse, bool chunkAUsedLast ) const;
 };
 
 //------------------------------------------------------------------------------
@@ -73,6 +85,79 @@ void TestDistributed::TestHelper( const char * target, uint32_t numRemoteWorkers
     }
 }
 
+//------------------------------------------------------------------------------
+void TestDistributed::GetWorkerFiles( Array<AString> & outFiles ) const
+{
+    // Worker files for all toolchains
+    AStackString workerPath;
+    TEST_ASSERT( FBuild::GetTempDir( workerPath ) );
+#if defined( __WINDOWS__ )
+    workerPath += ".fbuild.tmp\\worker\\";
+#else
+    workerPath += "_fbuild.tmp/worker/";
+#endif
+    outFiles.Clear();
+    FileIO::GetFiles( workerPath, AStackString( "*" ), true, &outFiles );
+}
+
+//------------------------------------------------------------------------------
+void TestDistributed::GetRemoteOnlyOptions( FBuildTestOptions & outOptions ) const
+{
+    outOptions.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    outOptions.m_AllowDistributed = true;
+    outOptions.m_NumWorkerThreads = 1;
+    outOptions.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    outOptions.m_AllowLocalRace = false;
+}
+
+//------------------------------------------------------------------------------
+void TestDistributed::TrimChunksHelper( char fillA, char fillB, bool chunkAInUse, bool chunkAUsedLast ) const
+{
+    // Two chunks, which together exceed the size limit
+    ToolChunkStore chunkStore;
+    AString chunkA;
+    AString chunkB;
+    chunkA.SetLength( 768 * 1024 );
+    chunkB.SetLength( 768 * 1024 );
+    memset( chunkA.Get(), fillA, chunkA.GetLength() );
+    memset( chunkB.Get(), fillB, chunkB.GetLength() );
+    const uint64_t hashA = xxHash3::Calc64Big( chunkA.Get(), chunkA.GetLength() );
+    const uint64_t hashB = xxHash3::Calc64Big( chunkB.Get(), chunkB.GetLength() );
+    TEST_ASSERT( chunkStore.Write( hashA, chunkA.Get(), chunkA.GetLength() ) );
+    TEST_ASSERT( chunkStore.Write( hashB, chunkB.Get(), chunkB.GetLength() ) );
+
+    if ( chunkAUsedLast )
+    {
+        // A was written before B
+        AStackString chunkPathA;
+        AStackString chunkPathB;
+        chunkPathA.Format( "%s%016" PRIx64, chunkStore.GetPath().Get(), hashA );
+        chunkPathB.Format( "%s%016" PRIx64, chunkStore.GetPath().Get(), hashB );
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( chunkPathA, FileIO::GetFileLastWriteTime( chunkPathA ) - 2000000000 ) );
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( chunkPathB, FileIO::GetFileLastWriteTime( chunkPathB ) - 1000000000 ) );
+
+        // ...but was used more recently
+        AString data;
+        data.SetLength( chunkA.GetLength() );
+        TEST_ASSERT( chunkStore.Read( hashA, chunkA.GetLength(), data.Get() ) );
+    }
+
+    Array<uint64_t> chunkHashesInUse;
+    if ( chunkAInUse )
+    {
+        chunkHashesInUse.Append( hashA );
+    }
+
+    const uint32_t oldMaxSizeMiB = ToolchainStore::GetMaxSizeMiB();
+    ToolchainStore::SetMaxSizeMiB( 1 );
+    ToolchainStore().Trim( Array<uint64_t>(), chunkHashesInUse, Time::GetCurrentFileTime(), chunkStore.GetPath() );
+    ToolchainStore::SetMaxSizeMiB( oldMaxSizeMiB );
+
+    // Only B is removed
+    TEST_ASSERT( chunkStore.Has( hashA, chunkA.GetLength() ) );
+    TEST_ASSERT( chunkStore.Has( hashB, chunkB.GetLength() ) == false );
+}
+
 //------------------------------------------------------------------------------
 TEST_CASE( TestDistributed, TestWith1RemoteWorkerThread )
 {
@@ -94,6 +179,28 @@ TEST_CASE( TestDistributed, WithPCH )
     TestHelper( target, 4 );
 }
 
+//------------------------------------------------------------------------------
+TEST_CASE( TestDistributed, JobPrefetch )
+{
+    // Worker has a single CPU, but keeps several jobs queued ahead of it
+    const uint32_t oldNumCPUs = WorkerThreadRemote::GetNumCPUsToUse();
+    const uint32_t oldNumToPrefetch = WorkerThreadRemote::GetNumJobsToPrefetch();
+    WorkerThreadRemote::SetNumCPUsToUse( 1 );
+    WorkerThreadRemote::SetNumJobsToPrefetch( 4 );
+
+    {
+        const char * target( "../tmp/Test/Distributed/dist.lib" );
+        TestHelper( target, 1 );
+    }
+    {
+        const char * target( "badcode" );
+        TestHelper( target, 1, true ); // compilation should fail
+    }
+
+    WorkerThreadRemote::SetNumCPUsToUse( oldNumCPUs );
+    WorkerThreadRemote::SetNumJobsToPrefetch( oldNumToPrefetch );
+}
+
 //------------------------------------------------------------------------------
 TEST_CASE( TestDistributed, RegressionTest_RemoteCrashOnErrorFormatting )
 {
@@ -188,6 +295,178 @@ TEST_CASE( TestDistributed, AnonymousNamespaces )
     TestHelper( target, 1 );
 }
 
+//------------------------------------------------------------------------------
+TEST_CASE( TestDistributed, Dictionary )
+{
+    // Train on the first two jobs, so the remaining jobs use the dictionary
+    const uint32_t oldNumSamples = CompressionDictionaryTrainer::GetNumSamples();
+    CompressionDictionaryTrainer::SetNumSamples( 2 );
+
+    FBuildTestOptions options;
+    GetRemoteOnlyOptions( options );
+    options.m_DistributionDictionary = true;
+    FBuildForTest fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    Server s( 1 );
+    s.Listen( Protocol::kTestPort );
+
+    // The worker must obtain the dictionary to build the jobs which use it
+    const char * target( "../tmp/Test/Distributed/Dictionary/Dictionary.lib" );
+    FileIO::FileDelete( target );
+    TEST_ASSERT( fBuild.Build( target ) );
+    TEST_ASSERT( FileIO::FileExists( target ) );
+    TEST_ASSERT( fBuild.GetCompressionDictionaryTrainer()->GetDictionary() );
+
+    CompressionDictionaryTrainer::SetNumSamples( oldNumSamples );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestDistributed, ToolchainChunks )
+{
+    // Start with nothing on the worker
+    Array<AString> files;
+    GetWorkerFiles( files );
+    for ( const AString & file : files )
+    {
+        FileIO::FileDelete( file.Get() );
+    }
+
+    FBuildTestOptions options;
+    GetRemoteOnlyOptions( options );
+    options.m_ForceCleanBuild = true;
+    const char * target( "../tmp/Test/Distributed/dist.lib" );
+
+    // Toolchain is sent in chunks, which the worker keeps
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        Server s( 1 );
+        s.Listen( Protocol::kTestPort );
+
+        TEST_ASSERT( fBuild.Build( target ) );
+        TEST_ASSERT( s.GetChunkStore().GetNumChunksWritten() > 0 );
+    }
+
+    // Remove the toolchain, but not the chunks
+    GetWorkerFiles( files );
+    for ( const AString & file : files )
+    {
+        if ( file.Find( "toolchain." ) )
+        {
+            FileIO::FileDelete( file.Get() );
+        }
+    }
+
+    // Toolchain is rebuilt from chunks without any being sent
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        Server s( 1 );
+        s.Listen( Protocol::kTestPort );
+
+        TEST_ASSERT( fBuild.Build( target ) );
+        TEST_ASSERT( s.GetChunkStore().GetNumChunksWritten() == 0 );
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestDistributed, ToolchainStore )
+{
+    // Start with nothing on the worker
+    Array<AString> files;
+    GetWorkerFiles( files );
+    for ( const AString & file : files )
+    {
+        FileIO::FileDelete( file.Get() );
+    }
+
+    FBuildTestOptions options;
+    GetRemoteOnlyOptions( options );
+    options.m_ForceCleanBuild = true;
+    const char * target( "../tmp/Test/Distributed/dist.lib" );
+
+    // Worker keeps the toolchain it receives
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        Server s( 1 );
+        s.Listen( Protocol::kTestPort );
+
+        TEST_ASSERT( fBuild.Build( target ) );
+        TEST_ASSERT( s.GetToolchainStore().GetNumManifestsLoaded() == 0 );
+    }
+
+    // Restarted worker uses it without asking the client
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        Server s( 1 );
+        s.Listen( Protocol::kTestPort );
+
+        TEST_ASSERT( fBuild.Build( target ) );
+        TEST_ASSERT( s.GetToolchainStore().GetNumManifestsLoaded() == 1 );
+    }
+
+    // Unused toolchains are removed when over the size limit
+    const uint32_t oldMaxSizeMiB = ToolchainStore::GetMaxSizeMiB();
+    ToolchainStore::SetMaxSizeMiB( 1 );
+    {
+        const Server s( 1 ); // Store is trimmed on startup
+    }
+    ToolchainStore::SetMaxSizeMiB( oldMaxSizeMiB );
+    GetWorkerFiles( files );
+    for ( const AString & file : files )
+    {
+        TEST_ASSERT( file.Find( "toolchain." ) == nullptr );
+    }
+
+    // Chunks needed by a synchronization in progress are kept
+    TrimChunksHelper( 'A', 'B', true, false );
+
+    // Chunks read to assemble a toolchain count as recently used
+    TrimChunksHelper( 'C', 'D', false, true );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestDistributed, ResultCache )
+{
+    FBuildTestOptions options;
+    GetRemoteOnlyOptions( options );
+    options.m_ForceCleanBuild = true;
+    const char * target( "../tmp/Test/Distributed/dist.lib" );
+
+    const uint32_t oldMaxSizeMiB = JobResultCache::GetMaxSizeMiB();
+    JobResultCache::SetMaxSizeMiB( 64 );
+    Server s( 1 );
+    JobResultCache::SetMaxSizeMiB( oldMaxSizeMiB );
+    s.Listen( Protocol::kTestPort );
+
+    // Jobs are built and their results kept
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( target ) );
+        TEST_ASSERT( s.GetResultCache().GetNumHits() == 0 );
+        TEST_ASSERT( s.GetResultCache().GetNumEntries() > 0 );
+    }
+    const uint32_t numJobs = s.GetResultCache().GetNumMisses();
+    TEST_ASSERT( numJobs == s.GetResultCache().GetNumEntries() );
+
+    // Identical jobs from another client are answered from the cache
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( target ) );
+        TEST_ASSERT( s.GetResultCache().GetNumHits() == numJobs );
+        TEST_ASSERT( s.GetResultCache().GetNumMisses() == numJobs );
+    }
+}
+
 //------------------------------------------------------------------------------
 #if defined( __WINDOWS__ ) // TODO:B Enable for OSX and Linux
 TEST_CASE( TestDistributed, TestForceInclude )
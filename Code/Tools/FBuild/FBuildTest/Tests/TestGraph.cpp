@@ -23,7 +23,9 @@
 #include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/TestNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/UnityNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FileWatcher.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
 
 // Core
 #include "Core/Containers/UniquePtr.h"
@@ -33,14 +35,20 @@
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Math/Conversions.h"
 #include "Core/Math/xxHash.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Time/Timer.h"
 
+// system
+#include <string.h> // for memcmp
+
 //------------------------------------------------------------------------------
 TEST_GROUP( TestGraph, FBuildTest )
 {
 public:
+    void NoStopOnFirstError( bool useSweepScheduler ) const;
+    void SchedulerSpeed( const char * shape, uint32_t numLayers, uint32_t numNodesPerLayer ) const;
 };
 
 // NodeTestHelper
@@ -169,6 +177,65 @@ TEST_CASE( TestGraph, SingleFileNodeMissing )
     TEST_ASSERT( node->GetStamp() == 0 );
 }
 
+//------------------------------------------------------------------------------
+TEST_CASE( TestGraph, ConcurrentFileNodeCreation )
+{
+    NodeGraph ng;
+
+    // An existing node is found rather than replaced
+    const AStackString existingFileName( "Tools/FBuild/FBuildTest/Data/TestGraph/library.cpp" );
+    const FileNode * existingNode = ng.CreateNode<FileNode>( existingFileName );
+    TEST_ASSERT( ng.FindOrCreateFileNode( existingFileName ) == existingNode );
+
+    // Threads discovering the same files all get the same nodes
+    class ThreadContext
+    {
+    public:
+        NodeGraph * m_NodeGraph;
+        Array<Node *> m_Nodes;
+    };
+    const uint32_t kNumThreads = 4;
+    const uint32_t kNumFiles = 1000;
+    ThreadContext contexts[ kNumThreads ];
+    Thread threads[ kNumThreads ];
+    for ( uint32_t i = 0; i < kNumThreads; ++i )
+    {
+        contexts[ i ].m_NodeGraph = &ng;
+        threads[ i ].Start( []( void * param ) -> uint32_t
+                            {
+                                ThreadContext & context = *static_cast<ThreadContext *>( param );
+                                for ( uint32_t j = 0; j < kNumFiles; ++j )
+                                {
+                                    AStackString fileName;
+                                    fileName.Format( "../tmp/Test/Graph/ConcurrentFileNodeCreation/%u.h", j );
+                                    context.m_Nodes.Append( context.m_NodeGraph->FindOrCreateFileNode( fileName ) );
+                                }
+                                return 0;
+                            },
+                            "FileNodeCreation",
+                            &contexts[ i ] );
+    }
+    for ( Thread & thread : threads )
+    {
+        thread.Join();
+    }
+    for ( uint32_t j = 0; j < kNumFiles; ++j )
+    {
+        const Node * node = contexts[ 0 ].m_Nodes[ j ];
+        TEST_ASSERT( node->GetType() == Node::FILE_NODE );
+        for ( const ThreadContext & context : contexts )
+        {
+            TEST_ASSERT( context.m_Nodes[ j ] == node );
+        }
+        TEST_ASSERT( ng.FindNode( node->GetName() ) == node );
+    }
+
+    // Nodes are tracked once committed by the main thread
+    const size_t numNodes = ng.GetNodeCount();
+    ng.CommitPendingNodes();
+    TEST_ASSERT( ng.GetNodeCount() == ( numNodes + kNumFiles ) );
+}
+
 //------------------------------------------------------------------------------
 TEST_CASE( TestGraph, TestSerialization )
 {
@@ -458,10 +525,26 @@ TEST_CASE( TestGraph, TestDeepGraph )
 
 //------------------------------------------------------------------------------
 TEST_CASE( TestGraph, TestNoStopOnFirstError )
+{
+    NoStopOnFirstError( false );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestGraph, TestSweepScheduler )
+{
+    // The legacy sweep scheduler must produce the same results as the
+    // event-driven scheduler
+    NoStopOnFirstError( true );
+}
+
+// NoStopOnFirstError
+//------------------------------------------------------------------------------
+void TestGraph::NoStopOnFirstError( bool useSweepScheduler ) const
 {
     FBuildTestOptions options;
     options.m_NumWorkerThreads = 0; // ensure test behaves deterministically
     options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/NoStopOnFirstError/fbuild.bff";
+    options.m_UseSweepScheduler = useSweepScheduler;
 
     // "Stop On First Error" build (default behaviour)
     {
@@ -497,6 +580,640 @@ TEST_CASE( TestGraph, TestNoStopOnFirstError )
     }
 }
 
+//------------------------------------------------------------------------------
+TEST_CASE( TestGraph, SchedulerSpeed )
+{
+    // Main thread cost of progressing the graph should grow with the work
+    // done, not with the size of the graph times the number of passes
+#if defined( DEBUG )
+    const uint32_t graphSizes[] = { 256, 1024 };
+#else
+    const uint32_t graphSizes[] = { 1024, 4096, 8192 };
+#endif
+
+    OUTPUT( "Shape  Nodes    Event-driven  Sweep\n" );
+    for ( const uint32_t numNodes : graphSizes )
+    {
+        SchedulerSpeed( "Wide", 4, ( numNodes / 4 ) ); // Few layers, many independent nodes
+        SchedulerSpeed( "Deep", ( numNodes / 8 ), 8 ); // Long chains of dependent layers
+    }
+}
+
+// SchedulerSpeed
+//------------------------------------------------------------------------------
+void TestGraph::SchedulerSpeed( const char * shape, uint32_t numLayers, uint32_t numNodesPerLayer ) const
+{
+    // Generate a layered graph of cheap nodes, where each node depends on a
+    // couple of nodes of the previous layer
+    const char * const bffFile = "../tmp/Test/Graph/SchedulerSpeed/fbuild.bff";
+    const uint32_t numNodes = ( numLayers * numNodesPerLayer );
+    {
+        AString bff;
+        bff.SetReserved( (size_t)numNodes * 192 );
+        bff += "Settings {}\n";
+        for ( uint32_t layer = 0; layer < numLayers; ++layer )
+        {
+            for ( uint32_t i = 0; i < numNodesPerLayer; ++i )
+            {
+                bff.AppendFormat( "TextFile( 'T_%u_%u' ) { "
+                                  ".TextFileOutput = '../tmp/Test/Graph/SchedulerSpeed/%u/%u.txt' "
+                                  ".TextFileInputStrings = { '%u' } ",
+                                  layer, i, layer, i, i );
+                if ( layer > 0 )
+                {
+                    bff.AppendFormat( ".PreBuildDependencies = { 'T_%u_%u', 'T_%u_%u' } ",
+                                      layer - 1, i,
+                                      layer - 1, ( ( i * 7 ) + 1 ) % numNodesPerLayer );
+                }
+                bff += "}\n";
+            }
+        }
+        bff += "Alias( 'all' ) { .Targets = { ";
+        for ( uint32_t i = 0; i < numNodesPerLayer; ++i )
+        {
+            bff.AppendFormat( "%s'T_%u_%u'", ( i > 0 ) ? ", " : "", numLayers - 1, i );
+        }
+        bff += " } }\n";
+
+        FileIO::EnsurePathExists( AStackString( "../tmp/Test/Graph/SchedulerSpeed/" ) );
+        MakeFile( bffFile, bff.Get() );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = bffFile;
+
+    // Every node is built each time (no DB is saved). An untimed build first,
+    // so output dirs etc. exist for both timed builds.
+    float buildPassTimes[ 3 ];
+    for ( size_t i = 0; i < 3; ++i )
+    {
+        options.m_UseSweepScheduler = ( i == 2 );
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        buildPassTimes[ i ] = fBuild.GetStats().m_BuildPassTime;
+
+        CheckStatsNode( numNodes, numNodes, Node::TEXT_FILE_NODE );
+    }
+
+    OUTPUT( "%-6s %-8u %9.3f ms %9.3f ms\n",
+            shape,
+            numNodes,
+            (double)buildPassTimes[ 1 ] * 1000.0,
+            (double)buildPassTimes[ 2 ] * 1000.0 );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestGraph, JobPrioritization )
+{
+    NodeGraph ng;
+    Array<Node *> nodes;
+    for ( uint32_t i = 0; i < 100; ++i )
+    {
+        AStackString name;
+        name.Format( "../tmp/Test/Graph/JobPrioritization/File%u.cpp", i );
+        nodes.Append( ng.CreateNode<FileNode>( name ) );
+    }
+
+    // Jobs spread over several lists
+    JobSubQueue queue( 4 );
+    Array<Node *> toQueue( nodes );
+    queue.QueueJobs( toQueue );
+    TEST_ASSERT( queue.GetCount() == 100 );
+
+    // Prioritized jobs are taken first, from any list, and only once
+    Array<const Node *> prioritized;
+    prioritized.Append( nodes[ 70 ] );
+    prioritized.Append( nodes[ 3 ] );
+    prioritized.Append( nodes[ 41 ] );
+    queue.PrioritizeJobs( prioritized );
+    queue.PrioritizeJobs( prioritized ); // No longer in the lists, so no effect
+    TEST_ASSERT( queue.GetCount() == 100 );
+    for ( size_t i = 0; i < prioritized.GetSize(); ++i )
+    {
+        Job * job = queue.RemoveJob( static_cast<uint32_t>( i ) );
+        TEST_ASSERT( job && prioritized.Find( job->GetNode() ) );
+        FDELETE job;
+    }
+
+    // Everything else is still queued
+    uint32_t numRemaining = 0;
+    while ( Job * job = queue.RemoveJob() )
+    {
+        TEST_ASSERT( prioritized.Find( job->GetNode() ) == nullptr );
+        FDELETE job;
+        ++numRemaining;
+    }
+    TEST_ASSERT( numRemaining == 97 );
+    TEST_ASSERT( queue.GetCount() == 0 );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestGraph, NodeLookupSpeed )
+{
+    // Lookup cost should stay flat as the graph grows
+    const uint32_t graphSizes[] = { 1000, 10000, 100000, 400000 };
+    const uint32_t numLookups = 1000000;
+
+    OUTPUT( "Nodes    Create (grow)  Create (reserved)  Lookup\n" );
+    for ( const uint32_t numNodes : graphSizes )
+    {
+        Array<AString> names;
+        names.SetCapacity( numNodes );
+        for ( uint32_t i = 0; i < numNodes; ++i )
+        {
+            names.EmplaceBack().Format( "../tmp/Test/Graph/NodeLookupSpeed/Dir%u/File%u.cpp", ( i % 100 ), i );
+        }
+
+        float createTimes[ 2 ];
+        float lookupTime = 0.0f;
+        for ( size_t pass = 0; pass < 2; ++pass )
+        {
+            // Map grows as nodes are added, or is sized up front (as when loading a DB)
+            NodeGraph ng( ( pass == 0 ) ? 0 : numNodes );
+
+            const Timer t;
+            for ( AString & name : names )
+            {
+                name = ng.CreateNode<FileNode>( name )->GetName(); // Use cleaned name for lookups
+            }
+            createTimes[ pass ] = t.GetElapsed();
+
+            if ( pass == 1 )
+            {
+                const Timer t2;
+                for ( uint32_t i = 0; i < numLookups; ++i )
+                {
+                    const AString & name = names[ ( i * 7919u ) % numNodes ];
+                    TEST_ASSERT( ng.FindNodeExact( name ) );
+                }
+                lookupTime = t2.GetElapsed();
+
+                TEST_ASSERT( ng.FindNodeExact( AStackString( "../tmp/Test/Graph/NodeLookupSpeed/Missing.cpp" ) ) == nullptr );
+            }
+        }
+
+        OUTPUT( "%-8u %9.3f ms %14.3f ms %6.1f ns\n",
+                numNodes,
+                (double)createTimes[ 0 ] * 1000.0,
+                (double)createTimes[ 1 ] * 1000.0,
+                (double)lookupTime * 1000000000.0 / numLookups );
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestGraph, FileNodeStamping )
+{
+    // Input file stamps are gathered in bulk before the build starts
+    const char * const bffFile = "../tmp/Test/Graph/FileNodeStamping/fbuild.bff";
+    const char * const dbFile = "../tmp/Test/Graph/FileNodeStamping/fbuild.fdb";
+    const uint32_t numFiles = 1000;
+    {
+        FileIO::EnsurePathExists( AStackString( "../tmp/Test/Graph/FileNodeStamping/Src/" ) );
+
+        AString bff;
+        bff += "Settings {}\n";
+        for ( uint32_t i = 0; i < numFiles; ++i )
+        {
+            AStackString srcFile;
+            srcFile.Format( "../tmp/Test/Graph/FileNodeStamping/Src/%u.txt", i );
+            MakeFile( srcFile.Get(), "data" );
+
+            bff.AppendFormat( "Copy( 'C_%u' ) { .Source = '%s' "
+                              ".Dest = '../tmp/Test/Graph/FileNodeStamping/Dst/%u.txt' }\n",
+                              i, srcFile.Get(), i );
+        }
+        bff += "Alias( 'all' ) { .Targets = { ";
+        for ( uint32_t i = 0; i < numFiles; ++i )
+        {
+            bff.AppendFormat( "%s'C_%u'", ( i > 0 ) ? ", " : "", i );
+        }
+        bff += " } }\n";
+
+        MakeFile( bffFile, bff.Get() );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = bffFile;
+
+    // Initial build
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        CheckStatsNode( numFiles, numFiles, Node::FILE_NODE );
+        CheckStatsNode( numFiles, numFiles, Node::COPY_FILE_NODE );
+    }
+
+    // Changes are detected, both with and without worker threads
+    const uint32_t numWorkerThreads[] = { 4, 0 };
+    for ( const uint32_t numThreads : numWorkerThreads )
+    {
+        options.m_NumWorkerThreads = numThreads;
+        FBuildForTest fBuild( options );
+
+        // Change one file
+        AStackString changedFile( "../tmp/Test/Graph/FileNodeStamping/Src/123.txt" );
+        NodeGraph::CleanPath( changedFile ); // Make full path
+        const uint64_t changedTime = FileIO::GetFileLastWriteTime( changedFile ) + 10000000;
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( changedFile, changedTime ) );
+
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        CheckStatsNode( numFiles, numFiles, Node::FILE_NODE );
+        CheckStatsNode( numFiles, 1, Node::COPY_FILE_NODE );
+        TEST_ASSERT( fBuild.GetNode( changedFile.Get() )->GetStamp() == changedTime );
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestGraph, FileNodeStampingSideOutputs )
+{
+    // Stamps gathered before the build must not be used for files written by the
+    // compiler outside of the output dir (here, a dependency file)
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/PrefetchSideOutputs/fbuild.bff";
+    const char * const dbFile = "../tmp/Test/Graph/PrefetchSideOutputs/fbuild.fdb";
+#if defined( __WINDOWS__ )
+    const char * const objFile = "../tmp/Test/Graph/PrefetchSideOutputs/Out/a.obj";
+#else
+    const char * const objFile = "../tmp/Test/Graph/PrefetchSideOutputs/Out/a.o";
+#endif
+    FileIO::EnsurePathExists( AStackString( "../tmp/Test/Graph/PrefetchSideOutputs/Deps/" ) ); // Not created by FASTBuild
+
+    // Initial build
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "Copy" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        CheckStatsNode( 1, 1, Node::OBJECT_NODE );
+        CheckStatsNode( 1, 1, Node::COPY_FILE_NODE );
+    }
+
+    // No-op build, so the dependency file's stamp from the previous build is recorded
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "Copy" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        CheckStatsNode( 1, 0, Node::OBJECT_NODE );
+    }
+
+    // Recompile, re-writing the dependency file, which must then be copied again
+    {
+        EnsureFileDoesNotExist( objFile );
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "Copy" ) );
+
+        CheckStatsNode( 1, 1, Node::OBJECT_NODE );
+        CheckStatsNode( 1, 1, Node::COPY_FILE_NODE );
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestGraph, FileWatcher )
+{
+    if ( FileWatcher::IsSupported() == false )
+    {
+        return;
+    }
+
+    // Only files reported as changed by the FileWatcher are checked
+    const char * const bffFile = "../tmp/Test/Graph/FileWatcher/fbuild.bff";
+    const char * const dbFile = "../tmp/Test/Graph/FileWatcher/fbuild.fdb";
+    const uint32_t numFiles = 100;
+    {
+        EnsureFileDoesNotExist( dbFile );
+        AStackString stateFile;
+        NodeGraph::GetFileWatcherStateFileName( dbFile, stateFile );
+        EnsureFileDoesNotExist( stateFile );
+        FileIO::EnsurePathExists( AStackString( "../tmp/Test/Graph/FileWatcher/Src/" ) );
+
+        AString bff;
+        bff += "Settings {}\n";
+        for ( uint32_t i = 0; i < numFiles; ++i )
+        {
+            AStackString srcFile;
+            srcFile.Format( "../tmp/Test/Graph/FileWatcher/Src/%u.txt", i );
+            MakeFile( srcFile.Get(), "data" );
+
+            bff.AppendFormat( "Copy( 'C_%u' ) { .Source = '%s' "
+                              ".Dest = '../tmp/Test/Graph/FileWatcher/Dst/%u.txt' }\n",
+                              i, srcFile.Get(), i );
+        }
+        bff += "Alias( 'all' ) { .Targets = { ";
+        for ( uint32_t i = 0; i < numFiles; ++i )
+        {
+            bff.AppendFormat( "%s'C_%u'", ( i > 0 ) ? ", " : "", i );
+        }
+        bff += " } }\n";
+
+        MakeFile( bffFile, bff.Get() );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = bffFile;
+    options.m_UseFileWatcher = true;
+    options.m_ShowVerbose = true;
+
+    // Run watcher on a thread, as it would run in a separate process
+    class WatcherThread
+    {
+    public:
+        static uint32_t ThreadFunc( void * userData )
+        {
+            WatcherThread * self = static_cast<WatcherThread *>( userData );
+            while ( self->m_Stop.Load() == false )
+            {
+                self->m_Watcher.Update( 10 );
+            }
+            return 0;
+        }
+
+        FileWatcher m_Watcher;
+        Atomic<bool> m_Stop;
+    };
+    WatcherThread * watcher = FNEW( WatcherThread );
+    Thread thread;
+    {
+        AStackString instanceName;
+        FileWatcher::GetInstanceName( options.GetWorkingDir(), AStackString( dbFile ), instanceName );
+        TEST_ASSERT( watcher->m_Watcher.Init( instanceName ) );
+        thread.Start( WatcherThread::ThreadFunc, "FileWatcher", watcher );
+    }
+
+    // Initial build tells the watcher what to watch
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        CheckStatsNode( numFiles, numFiles, Node::COPY_FILE_NODE );
+    }
+
+    // Dirs newly watched since the last build are reported as changed (unless watched
+    // by a previous run of this test), so files may all be checked
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        CheckStatsNode( numFiles, 0, Node::COPY_FILE_NODE );
+    }
+
+    // No changes - no files need checking
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        TEST_ASSERT( GetRecordedOutput().Find( "Prefetched stamps for 0 input files" ) );
+        TEST_ASSERT( GetRecordedOutput().Find( "Trusted stamps for 100 input files" ) );
+        CheckStatsNode( numFiles, numFiles, Node::FILE_NODE );
+        CheckStatsNode( numFiles, 0, Node::COPY_FILE_NODE );
+    }
+
+    // Change one file - only it is checked
+    {
+        FBuildForTest fBuild( options );
+
+        AStackString changedFile( "../tmp/Test/Graph/FileWatcher/Src/12.txt" );
+        NodeGraph::CleanPath( changedFile ); // Make full path
+        const uint64_t changedTime = FileIO::GetFileLastWriteTime( changedFile ) + 10000000;
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( changedFile, changedTime ) );
+
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        TEST_ASSERT( GetRecordedOutput().Find( "Prefetched stamps for 1 input files" ) );
+        TEST_ASSERT( GetRecordedOutput().Find( "Trusted stamps for 99 input files" ) );
+        CheckStatsNode( numFiles, 1, Node::COPY_FILE_NODE );
+        TEST_ASSERT( fBuild.GetNode( changedFile.Get() )->GetStamp() == changedTime );
+    }
+
+    // Dirs no longer used by builds are no longer watched
+    {
+        TEST_ASSERT( watcher->m_Watcher.GetNumWatches() > 0 );
+
+        AStackString instanceName;
+        FileWatcher::GetInstanceName( options.GetWorkingDir(), AStackString( dbFile ), instanceName );
+        TEST_ASSERT( FileWatcherClient::SetWatchedDirs( instanceName, Array<AString>(), 0 ) );
+
+        const Timer t;
+        while ( ( watcher->m_Watcher.GetNumWatches() > 0 ) && ( t.GetElapsed() < 5.0f ) )
+        {
+            Thread::Sleep( 10 );
+        }
+        TEST_ASSERT( watcher->m_Watcher.GetNumWatches() == 0 );
+    }
+
+    // Stop the watcher
+    watcher->m_Stop.Store( true );
+    thread.Join();
+    FDELETE watcher;
+
+    // Without the watcher, all files are checked
+    {
+        FBuildForTest fBuild( options );
+
+        AStackString changedFile( "../tmp/Test/Graph/FileWatcher/Src/34.txt" );
+        NodeGraph::CleanPath( changedFile ); // Make full path
+        const uint64_t changedTime = FileIO::GetFileLastWriteTime( changedFile ) + 10000000;
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( changedFile, changedTime ) );
+
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+
+        TEST_ASSERT( GetRecordedOutput().Find( "FileWatcher is not running" ) );
+        CheckStatsNode( numFiles, 1, Node::COPY_FILE_NODE );
+    }
+
+    // Restart the watcher, having lost the directory list (temp dir cleaned)
+    {
+        AStackString instanceName;
+        FileWatcher::GetInstanceName( options.GetWorkingDir(), AStackString( dbFile ), instanceName );
+        AStackString controlDir;
+        TEST_ASSERT( FileWatcher::GetControlDir( instanceName, controlDir ) );
+        Array<AString> controlFiles;
+        FileIO::GetFiles( controlDir, AStackString( "*" ), false, &controlFiles );
+        for ( const AString & controlFile : controlFiles )
+        {
+            TEST_ASSERT( FileIO::FileDelete( controlFile.Get() ) );
+        }
+        TEST_ASSERT( FileIO::DirectoryDelete( controlDir ) );
+
+        watcher = FNEW( WatcherThread );
+        TEST_ASSERT( watcher->m_Watcher.Init( instanceName ) );
+        TEST_ASSERT( watcher->m_Watcher.GetNumWatches() == 0 );
+        thread.Start( WatcherThread::ThreadFunc, "FileWatcher", watcher );
+    }
+
+    // Restarted watcher invalidates saved state, and must be told what to watch again
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        TEST_ASSERT( GetRecordedOutput().Find( "FileWatcher was restarted or overflowed" ) );
+    }
+
+    // Changes are seen by the restarted watcher
+    {
+        FBuildForTest fBuild( options );
+
+        AStackString changedFile( "../tmp/Test/Graph/FileWatcher/Src/56.txt" );
+        NodeGraph::CleanPath( changedFile ); // Make full path
+        const uint64_t changedTime = FileIO::GetFileLastWriteTime( changedFile ) + 10000000;
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( changedFile, changedTime ) );
+
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+
+        TEST_ASSERT( GetRecordedOutput().Find( "Prefetched stamps for 1 input files" ) );
+        TEST_ASSERT( GetRecordedOutput().Find( "Trusted stamps for 99 input files" ) );
+        CheckStatsNode( numFiles, 1, Node::COPY_FILE_NODE );
+    }
+
+    watcher->m_Stop.Store( true );
+    thread.Join();
+    FDELETE watcher;
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestGraph, ContentHashStamps )
+{
+    // Input files which are modified without changing cause no rebuilds
+    const char * const bffFile = "../tmp/Test/Graph/ContentHashStamps/fbuild.bff";
+    const char * const dbFile = "../tmp/Test/Graph/ContentHashStamps/fbuild.fdb";
+    const uint32_t numFiles = 10;
+    {
+        EnsureFileDoesNotExist( dbFile );
+        AStackString hashesFile;
+        NodeGraph::GetContentHashesFileName( dbFile, hashesFile );
+        EnsureFileDoesNotExist( hashesFile );
+        FileIO::EnsurePathExists( AStackString( "../tmp/Test/Graph/ContentHashStamps/Src/" ) );
+
+        AString bff;
+        bff += "Settings {}\n";
+        for ( uint32_t i = 0; i < numFiles; ++i )
+        {
+            AStackString srcFile;
+            srcFile.Format( "../tmp/Test/Graph/ContentHashStamps/Src/%u.txt", i );
+            MakeFile( srcFile.Get(), "data" );
+
+            bff.AppendFormat( "Copy( 'C_%u' ) { .Source = '%s' "
+                              ".Dest = '../tmp/Test/Graph/ContentHashStamps/Dst/%u.txt' }\n",
+                              i, srcFile.Get(), i );
+        }
+        bff += "Alias( 'all' ) { .Targets = { ";
+        for ( uint32_t i = 0; i < numFiles; ++i )
+        {
+            bff.AppendFormat( "%s'C_%u'", ( i > 0 ) ? ", " : "", i );
+        }
+        bff += " } }\n";
+
+        MakeFile( bffFile, bff.Get() );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = bffFile;
+    options.m_UseContentHashStamps = true;
+    options.m_ShowVerbose = true;
+
+    // Initial build
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        CheckStatsNode( numFiles, numFiles, Node::COPY_FILE_NODE );
+    }
+
+    // Touching a file doesn't cause a rebuild, both with and without worker threads
+    const uint32_t numWorkerThreads[] = { 4, 0 };
+    for ( const uint32_t numThreads : numWorkerThreads )
+    {
+        options.m_NumWorkerThreads = numThreads;
+        FBuildForTest fBuild( options );
+
+        AStackString touchedFile;
+        touchedFile.Format( "../tmp/Test/Graph/ContentHashStamps/Src/%u.txt", numThreads );
+        NodeGraph::CleanPath( touchedFile ); // Make full path
+        const uint64_t touchedTime = FileIO::GetFileLastWriteTime( touchedFile ) + 10000000;
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( touchedFile, touchedTime ) );
+
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        TEST_ASSERT( GetRecordedOutput().Find( "Loaded content hashes for 10 input files" ) );
+        CheckStatsNode( numFiles, 0, Node::COPY_FILE_NODE );
+
+        // The new time is recorded, so the file needn't be hashed again
+        const FileNode * fileNode = fBuild.GetNode( touchedFile.Get() )->CastTo<FileNode>();
+        TEST_ASSERT( fileNode->GetContentHashLastWriteTime() == touchedTime );
+        TEST_ASSERT( fileNode->GetStamp() == fileNode->GetContentHash() );
+    }
+
+    // Changing a file does
+    {
+        FBuildForTest fBuild( options );
+
+        MakeFile( "../tmp/Test/Graph/ContentHashStamps/Src/7.txt", "changed" );
+
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+
+        CheckStatsNode( numFiles, 1, Node::COPY_FILE_NODE );
+    }
+
+    // Hashes are ignored if the entry count doesn't match the size of the file
+    {
+        AStackString hashesFile;
+        NodeGraph::GetContentHashesFileName( dbFile, hashesFile );
+        AString contents;
+        {
+            FileStream f;
+            TEST_ASSERT( f.Open( hashesFile.Get(), FileStream::READ_ONLY ) );
+            contents.SetLength( static_cast<uint32_t>( f.GetFileSize() ) );
+            TEST_ASSERT( f.ReadBuffer( contents.Get(), contents.GetLength() ) == contents.GetLength() );
+        }
+        {
+            const uint32_t junk = 0;
+            FileStream f;
+            TEST_ASSERT( f.Open( hashesFile.Get(), FileStream::WRITE_ONLY ) );
+            TEST_ASSERT( f.WriteBuffer( contents.Get(), contents.GetLength() ) == contents.GetLength() );
+            TEST_ASSERT( f.WriteBuffer( &junk, sizeof( junk ) ) == sizeof( junk ) );
+        }
+
+        const uint32_t outputSizeBefore = GetRecordedOutput().GetLength();
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+
+        const char * searchStart = ( GetRecordedOutput().Get() + outputSizeBefore );
+        TEST_ASSERT( GetRecordedOutput().Find( "Loaded content hashes", searchStart ) == nullptr );
+        CheckStatsNode( numFiles, 0, Node::COPY_FILE_NODE );
+    }
+}
+
 //------------------------------------------------------------------------------
 TEST_CASE( TestGraph, DBLocationChanged )
 {
@@ -553,12 +1270,13 @@ TEST_CASE( TestGraph, DBCorrupt )
     EnsureFileDoesNotExist( dbFileCorrupt );
 
     // Test corruption at various places in the file
-    static_assert( sizeof( NodeGraphHeader ) == 16, "Update test for DB format change" );
+    static_assert( sizeof( NodeGraphHeader ) == 24, "Update test for DB format change" );
     // clang-format off
     static const uint32_t corruptionOffsets[] =
     {
         0,      // Header - magic identifier
         8,      // Header - hash of content
+        16,     // Header - offset of node chunk table
         128,    // Arbitrary position in the file
     };
     // clang-format on
@@ -604,6 +1322,200 @@ TEST_CASE( TestGraph, DBCorrupt )
     }
 }
 
+//------------------------------------------------------------------------------
+TEST_CASE( TestGraph, DBParallelLoad )
+{
+    // Generate a graph large enough to be loaded in multiple chunks
+    const char * const bffFile = "../tmp/Test/Graph/DBParallelLoad/fbuild.bff";
+    const char * const dbFile = "../tmp/Test/Graph/DBParallelLoad/fbuild.fdb";
+    const uint32_t numNodes = 5000;
+    {
+        AString bff;
+        bff.SetReserved( 1024 * 1024 );
+        bff += "Settings {}\n";
+        for ( uint32_t i = 0; i < numNodes; ++i )
+        {
+            bff.AppendFormat( "TextFile( 'T_%u' ) { "
+                              ".TextFileOutput = '../tmp/Test/Graph/DBParallelLoad/%u.txt' "
+                              ".TextFileInputStrings = { '%u' } ",
+                              i, i, i );
+            if ( i > 0 )
+            {
+                // Depend on nodes which will be in other chunks
+                bff.AppendFormat( ".PreBuildDependencies = { 'T_%u' } ", ( ( i * 37 ) + 11 ) % i );
+            }
+            bff += "}\n";
+        }
+        bff += "Alias( 'all' ) { .Targets = { ";
+        for ( uint32_t i = 0; i < numNodes; ++i )
+        {
+            bff.AppendFormat( "%s'T_%u'", ( i > 0 ) ? ", " : "", i );
+        }
+        bff += " } }\n";
+
+        FileIO::EnsurePathExists( AStackString( "../tmp/Test/Graph/DBParallelLoad/" ) );
+        MakeFile( bffFile, bff.Get() );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = bffFile;
+
+    // Build and save DB
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+        CheckStatsNode( numNodes, numNodes, Node::TEXT_FILE_NODE );
+    }
+
+    // Load serially (no worker threads) and in parallel
+    AString dbContents[ 2 ];
+    for ( size_t i = 0; i < 2; ++i )
+    {
+        options.m_NumWorkerThreads = ( i == 0 ) ? 0 : 4;
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+
+        // Re-saved DB should be identical regardless of how it was loaded
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+        FileStream f;
+        TEST_ASSERT( f.Open( dbFile, FileStream::READ_ONLY ) );
+        dbContents[ i ].SetLength( (uint32_t)f.GetFileSize() );
+        TEST_ASSERT( f.ReadBuffer( dbContents[ i ].Get(), f.GetFileSize() ) == f.GetFileSize() );
+        f.Close();
+
+        // Nothing should need building
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        CheckStatsNode( numNodes, 0, Node::TEXT_FILE_NODE );
+    }
+    TEST_ASSERT( dbContents[ 0 ].GetLength() == dbContents[ 1 ].GetLength() );
+    TEST_ASSERT( memcmp( dbContents[ 0 ].Get(), dbContents[ 1 ].Get(), dbContents[ 0 ].GetLength() ) == 0 );
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestGraph, DBJournal )
+{
+    const char * const bffFile = "../tmp/Test/Graph/DBJournal/fbuild.bff";
+    const AStackString dbFile( "../tmp/Test/Graph/DBJournal/fbuild.fdb" );
+    const AStackString journalFile( "../tmp/Test/Graph/DBJournal/fbuild.fdb.journal" );
+    const uint32_t numTextFiles = 200;
+
+    // Generate a graph with some TextFiles and a CopyDir which creates nodes dynamically
+    {
+        AString bff;
+        bff += "Settings {}\n";
+        for ( uint32_t i = 0; i < numTextFiles; ++i )
+        {
+            bff.AppendFormat( "TextFile( 'T_%u' ) { "
+                              ".TextFileOutput = '../tmp/Test/Graph/DBJournal/Out/%u.txt' "
+                              ".TextFileInputStrings = { '%u' } }\n",
+                              i, i, i );
+        }
+        bff += "CopyDir( 'Copy' ) { .SourcePaths = '../tmp/Test/Graph/DBJournal/Src/' "
+               ".Dest = '../tmp/Test/Graph/DBJournal/Dst/' }\n";
+        bff += "Alias( 'all' ) { .Targets = { 'Copy'";
+        for ( uint32_t i = 0; i < numTextFiles; ++i )
+        {
+            bff.AppendFormat( ", 'T_%u'", i );
+        }
+        bff += " } }\n";
+
+        FileIO::EnsurePathExists( AStackString( "../tmp/Test/Graph/DBJournal/Src/" ) );
+        MakeFile( bffFile, bff.Get() );
+        MakeFile( "../tmp/Test/Graph/DBJournal/Src/a.txt", "a" );
+        EnsureFileDoesNotExist( "../tmp/Test/Graph/DBJournal/Src/b.txt" );
+        EnsureFileDoesNotExist( dbFile );
+        EnsureFileDoesNotExist( journalFile );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = bffFile;
+    options.m_UseDBJournal = true;
+
+    // Initial build saves a full DB
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile.Get() ) );
+        CheckStatsNode( 1, 1, Node::COPY_FILE_NODE );
+        TEST_ASSERT( FileIO::FileExists( journalFile.Get() ) == false );
+    }
+    const uint64_t dbTime = FileIO::GetFileLastWriteTime( dbFile );
+
+    // Changes (including newly created nodes) are appended to the journal
+    {
+        MakeFile( "../tmp/Test/Graph/DBJournal/Src/b.txt", "b" );
+        EnsureFileDoesNotExist( "../tmp/Test/Graph/DBJournal/Out/0.txt" );
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile.Get() ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile.Get() ) );
+        CheckStatsNode( 2, 1, Node::COPY_FILE_NODE );
+        CheckStatsNode( numTextFiles, 1, Node::TEXT_FILE_NODE );
+
+        // DB is untouched
+        EnsureFileExists( journalFile );
+        TEST_ASSERT( FileIO::GetFileLastWriteTime( dbFile ) == dbTime );
+    }
+
+    // Journal is replayed so nothing needs building
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile.Get() ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        CheckStatsNode( 2, 0, Node::COPY_FILE_NODE );
+        CheckStatsNode( numTextFiles, 0, Node::TEXT_FILE_NODE );
+
+        // Only the always-rebuilt DirectoryList is appended
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile.Get() ) );
+        TEST_ASSERT( FileIO::GetFileLastWriteTime( dbFile ) == dbTime );
+    }
+
+    // Corrupt the journal
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( journalFile.Get(), FileStream::OPEN_OR_CREATE_READ_WRITE ) );
+        TEST_ASSERT( f.Seek( f.GetFileSize() - 1 ) );
+        TEST_ASSERT( f.Truncate() );
+    }
+
+    // Records preceding the corrupt one are still applied and the full DB is saved
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile.Get() ) );
+        TEST_ASSERT( GetRecordedOutput().Find( "Database journal" ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        CheckStatsNode( 2, 0, Node::COPY_FILE_NODE );
+        CheckStatsNode( numTextFiles, 0, Node::TEXT_FILE_NODE );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile.Get() ) );
+        TEST_ASSERT( FileIO::FileExists( journalFile.Get() ) == false );
+    }
+
+    // Without journaling, the whole DB is saved
+    {
+        EnsureFileDoesNotExist( "../tmp/Test/Graph/DBJournal/Out/1.txt" );
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile.Get() ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile.Get() ) );
+        EnsureFileExists( journalFile );
+    }
+    {
+        options.m_UseDBJournal = false;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile.Get() ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        CheckStatsNode( numTextFiles, 0, Node::TEXT_FILE_NODE );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile.Get() ) );
+        TEST_ASSERT( FileIO::FileExists( journalFile.Get() ) == false );
+    }
+}
+
 //------------------------------------------------------------------------------
 TEST_CASE( TestGraph, BFFDirtied )
 {
@@ -703,7 +1615,7 @@ TEST_CASE( TestGraph, DBVersionChanged )
     ms.WriteBuffer( &header, sizeof( header ) );
 
     // Since we're poking this, we want to know if the layout ever changes somehow
-    TEST_ASSERT( ms.GetFileSize() == 16 );
+    TEST_ASSERT( ms.GetFileSize() == 24 );
     TEST_ASSERT( ( (const uint8_t *)ms.GetDataMutable() )[ 3 ] == NodeGraphHeader::kCurrentVersion );
 
     ( (uint8_t *)ms.GetDataMutable() )[ 3 ] = ( NodeGraphHeader::kCurrentVersion - 1 );
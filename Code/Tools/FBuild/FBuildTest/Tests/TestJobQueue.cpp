@@ -0,0 +1,176 @@
+// TestJobQueue.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Graph/FileNode.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
+
+// Core
+#include "Core/Env/CPUInfo.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
+#include "Core/Time/Timer.h"
+
+//------------------------------------------------------------------------------
+TEST_GROUP( TestJobQueue, FBuildTest )
+{
+public:
+};
+
+// CostTestNode
+//------------------------------------------------------------------------------
+class CostTestNode : public FileNode
+{
+public:
+    explicit CostTestNode( uint32_t cost ) { m_RecursiveCost = cost; }
+};
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestJobQueue, SubQueueOrdering )
+{
+    // Jobs are spread over several lists, but the most expensive job is
+    // always taken first, regardless of which list a worker prefers (including
+    // when there are more workers than lists)
+    const uint32_t numNodes = 100;
+    Array<CostTestNode *> nodes;
+    for ( uint32_t i = 0; i < numNodes; ++i )
+    {
+        nodes.Append( FNEW( CostTestNode( ( i * 37 ) % numNodes ) ) ); // Unsorted costs
+    }
+
+    const uint32_t listCounts[] = { 4, JobSubQueue::kMaxLists + 36 };
+    for ( const uint32_t numLists : listCounts )
+    {
+        JobSubQueue queue( numLists );
+
+        // Queue in two batches, so later jobs are merged with earlier ones
+        for ( uint32_t batch = 0; batch < 2; ++batch )
+        {
+            Array<Node *> batchNodes;
+            for ( uint32_t i = batch; i < numNodes; i += 2 )
+            {
+                batchNodes.Append( nodes[ i ] );
+            }
+            queue.QueueJobs( batchNodes );
+        }
+        TEST_ASSERT( queue.GetCount() == numNodes );
+
+        uint32_t lastCost = 0xFFFFFFFF;
+        for ( uint32_t i = 0; i < numNodes; ++i )
+        {
+            Job * job = queue.RemoveJob( i % numLists );
+            TEST_ASSERT( job );
+            const uint32_t cost = job->GetNode()->GetRecursiveCost();
+            TEST_ASSERT( cost <= lastCost );
+            lastCost = cost;
+            FDELETE job;
+        }
+        TEST_ASSERT( queue.GetCount() == 0 );
+        TEST_ASSERT( queue.RemoveJob( 0 ) == nullptr );
+    }
+
+    for ( CostTestNode * node : nodes )
+    {
+        FDELETE node;
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST_CASE( TestJobQueue, SubQueueContention )
+{
+    // Many threads consuming small jobs while new jobs are queued in batches,
+    // comparing a single shared list with a list per thread
+
+    const uint32_t numThreads = Math::Clamp( CPUInfo::Get().GetNumUsefulCores(), 2U, 32U );
+#if defined( DEBUG )
+    const uint32_t numBatches = 200;
+#else
+    const uint32_t numBatches = 2000;
+#endif
+    const uint32_t numJobsPerBatch = 64;
+    const uint32_t numJobs = ( numBatches * numJobsPerBatch );
+
+    Array<CostTestNode *> nodes;
+    nodes.SetCapacity( numJobsPerBatch );
+    for ( uint32_t i = 0; i < numJobsPerBatch; ++i )
+    {
+        nodes.Append( FNEW( CostTestNode( i ) ) );
+    }
+
+    class ConsumerState
+    {
+    public:
+        static uint32_t ThreadFunc( void * userData )
+        {
+            ConsumerState * self = static_cast<ConsumerState *>( userData );
+            const uint32_t threadIndex = self->m_NextThreadIndex.Increment();
+            while ( self->m_NumConsumed.Load() < self->m_NumToConsume )
+            {
+                Job * job = self->m_Queue->RemoveJob( threadIndex );
+                if ( job )
+                {
+                    FDELETE job;
+                    self->m_NumConsumed.Increment();
+                }
+            }
+            return 0;
+        }
+
+        JobSubQueue * m_Queue = nullptr;
+        uint32_t m_NumToConsume = 0;
+        Atomic<uint32_t> m_NumConsumed;
+        Atomic<uint32_t> m_NextThreadIndex;
+    };
+
+    float times[ 2 ];
+    for ( size_t i = 0; i < 2; ++i )
+    {
+        JobSubQueue queue( ( i == 0 ) ? 1 : numThreads );
+
+        ConsumerState state;
+        state.m_Queue = &queue;
+        state.m_NumToConsume = numJobs;
+
+        const Timer t;
+
+        Thread threads[ 32 ];
+        for ( uint32_t j = 0; j < numThreads; ++j )
+        {
+            threads[ j ].Start( ConsumerState::ThreadFunc, "Consumer", &state );
+        }
+
+        for ( uint32_t batch = 0; batch < numBatches; ++batch )
+        {
+            Array<Node *> batchNodes;
+            batchNodes.Append( nodes );
+            queue.QueueJobs( batchNodes );
+        }
+
+        for ( uint32_t j = 0; j < numThreads; ++j )
+        {
+            threads[ j ].Join();
+        }
+        times[ i ] = t.GetElapsed();
+
+        TEST_ASSERT( state.m_NumConsumed.Load() == numJobs );
+        TEST_ASSERT( queue.GetCount() == 0 );
+    }
+
+    for ( CostTestNode * node : nodes )
+    {
+        FDELETE node;
+    }
+
+    OUTPUT( "Threads       : %u\n", numThreads );
+    OUTPUT( "Jobs          : %u\n", numJobs );
+    OUTPUT( "Single list   : %2.3f s\n", (double)times[ 0 ] );
+    OUTPUT( "Per thread    : %2.3f s\n", (double)times[ 1 ] );
+}
+
+//------------------------------------------------------------------------------
@@ -142,3 +142,51 @@ TEST_CASE( TestVariableStack, TestStackFramesParent )
 }
 
 //------------------------------------------------------------------------------
+TEST_CASE( TestVariableStack, TestStackFramesManyVariables )
+{
+    // enough variables that frames are indexed by hash
+    const uint32_t numVars = 1000;
+
+    BFFStackFrame sf1;
+    for ( uint32_t i = 0; i < numVars; ++i )
+    {
+        AStackString name;
+        name.Format( ".Var%u", i );
+        BFFStackFrame::SetVarInt( name, BFFToken::GetBuiltInToken(), (int32_t)i, nullptr );
+    }
+
+    {
+        // replace every other variable in a child frame
+        BFFStackFrame sf2;
+        for ( uint32_t i = 0; i < numVars; i += 2 )
+        {
+            AStackString name;
+            name.Format( ".Var%u", i );
+            BFFStackFrame::SetVarInt( name, BFFToken::GetBuiltInToken(), (int32_t)( i + numVars ), nullptr );
+        }
+
+        for ( uint32_t i = 0; i < numVars; ++i )
+        {
+            AStackString name;
+            name.Format( ".Var%u", i );
+            const int32_t expected = (int32_t)( ( i % 2 ) ? i : ( i + numVars ) );
+            TEST_ASSERT( BFFStackFrame::GetVar( name )->GetInt() == expected );
+            TEST_ASSERT( BFFStackFrame::GetVarAny( AStackString( name.Get() + 1 ) )->GetInt() == expected );
+            TEST_ASSERT( BFFStackFrame::GetVar( name, &sf1 )->GetInt() == (int32_t)i );
+
+            const BFFVariable * v = nullptr;
+            TEST_ASSERT( BFFStackFrame::GetParentDeclaration( name, nullptr, v ) == &sf1 );
+        }
+        TEST_ASSERT( BFFStackFrame::GetVar( ".Var" ) == nullptr );
+        TEST_ASSERT( BFFStackFrame::GetVar( "^Var0" ) == nullptr );
+        TEST_ASSERT( BFFStackFrame::GetVar( AStackString().Format( ".Var%u", numVars ) ) == nullptr );
+    }
+
+    // modifying a variable doesn't affect the others
+    BFFStackFrame::SetVarInt( AStackString( ".Var7" ), BFFToken::GetBuiltInToken(), -1, nullptr );
+    TEST_ASSERT( BFFStackFrame::GetVar( ".Var7" )->GetInt() == -1 );
+    TEST_ASSERT( BFFStackFrame::GetVar( ".Var8" )->GetInt() == 8 );
+    TEST_ASSERT( sf1.GetLocalVariables().GetSize() == numVars );
+}
+
+//------------------------------------------------------------------------------
@@ -105,6 +105,37 @@ bool FBuildWorkerOptions::ProcessCommandLine( const AString & commandLine )
             m_PeriodicRestart = true;
             continue;
         }
+        else if ( token.BeginsWith( "-prefetch=" ) )
+        {
+            uint32_t num( 0 );
+            if ( AString::ScanS( token.Get() + 10, "%u", &num ) == 1 )
+            {
+                m_NumJobsToPrefetch = Math::Min( num, 256U );
+                continue;
+            }
+            // problem... fall through
+        }
+        else if ( token.BeginsWith( "-resultcache=" ) )
+        {
+            uint32_t num( 0 );
+            if ( AString::ScanS( token.Get() + 13, "%u", &num ) == 1 )
+            {
+                m_ResultCacheSizeMiB = num;
+                continue;
+            }
+            // problem... fall through
+        }
+        else if ( token.BeginsWith( "-toolchainstore=" ) )
+        {
+            uint32_t num( 0 );
+            if ( AString::ScanS( token.Get() + 16, "%u", &num ) == 1 )
+            {
+                m_OverrideToolchainStoreSize = true;
+                m_ToolchainStoreSizeMiB = num;
+                continue;
+            }
+            // problem... fall through
+        }
 #if defined( __WINDOWS__ )
         else if ( token.BeginsWith( "-minfreememory=" ) )
         {
@@ -169,6 +200,14 @@ void FBuildWorkerOptions::ShowUsageError()
                 "        (Windows) Don't spawn a sub-process worker copy.\n"
                 " -periodicrestart\n"
                 "        Worker will restart every 4 hours.\n"
+                " -prefetch=<n>\n"
+                "        Jobs to request ahead of free CPUs (default 1).\n"
+                " -resultcache=<MiB>\n"
+                "        Memory for results re-used by duplicate jobs\n"
+                "        (default 0 = disabled).\n"
+                " -toolchainstore=<MiB>\n"
+                "        Disk space for toolchains kept between sessions\n"
+                "        (default 10240, 0 = unlimited).\n"
                 "---------------------------------------------------------------------------\n" );
 
 #if defined( __WINDOWS__ )
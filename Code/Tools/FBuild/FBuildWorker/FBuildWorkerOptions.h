@@ -35,6 +35,10 @@ public:
     bool m_OverrideWorkMode = false;
     WorkerSettings::Mode m_WorkMode = WorkerSettings::WHEN_IDLE;
     uint32_t m_MinimumFreeMemoryMiB = 0; // Minimum OS free memory including virtual memory to let worker do its work
+    uint32_t m_NumJobsToPrefetch = 1; // Jobs requested ahead of free CPUs to hide network latency
+    bool m_OverrideToolchainStoreSize = false;
+    uint32_t m_ToolchainStoreSizeMiB = 0; // Disk space for toolchains kept between sessions (0 = unlimited)
+    uint32_t m_ResultCacheSizeMiB = 0; // Memory for results re-used by duplicate jobs (0 = disabled)
 
     // Console mode
     bool m_ConsoleMode = false;
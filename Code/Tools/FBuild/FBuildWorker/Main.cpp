@@ -8,6 +8,11 @@
 #include "Tools/FBuild/FBuildWorker/FBuildWorkerOptions.h"
 #include "Tools/FBuild/FBuildWorker/Worker/Worker.h"
 
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Helpers/ToolchainStore.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobResultCache.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThreadRemote.h"
+
 // Core
 #include "Core/Env/Assert.h"
 #include "Core/Env/Env.h"
@@ -119,6 +124,11 @@ int Main( const AString & args )
     // start the worker and wait for it to be closed
     int ret;
     {
+        if ( options.m_OverrideToolchainStoreSize )
+        {
+            ToolchainStore::SetMaxSizeMiB( options.m_ToolchainStoreSizeMiB ); // Before Worker creates the Server
+        }
+        JobResultCache::SetMaxSizeMiB( options.m_ResultCacheSizeMiB );
         Worker worker( args, options.m_ConsoleMode, options.m_PeriodicRestart );
         if ( options.m_OverrideCPUAllocation )
         {
@@ -132,6 +142,7 @@ int Main( const AString & args )
         {
             WorkerSettings::Get().SetMinimumFreeMemoryMiB( options.m_MinimumFreeMemoryMiB );
         }
+        WorkerThreadRemote::SetNumJobsToPrefetch( options.m_NumJobsToPrefetch );
         ret = worker.Work();
     }
 
@@ -388,6 +388,11 @@ void Worker::UpdateUI()
         status += " (Low Disk Space)";
     }
 #endif
+    const JobResultCache & resultCache = m_ConnectionPool->GetResultCache();
+    if ( resultCache.IsEnabled() )
+    {
+        status.AppendFormat( " (%u Cached Results Used)", resultCache.GetNumHits() );
+    }
     if ( InConsoleMode() )
     {
         status += '\n';